@@ -3,6 +3,49 @@
 //
 #pragma once
 
+#include <kivm/asm/register.h>
+
 namespace kivm {
-    using Address = void *;
+    /**
+     * A memory operand: [base + index * scale + disp].
+     */
+    class Address final {
+    public:
+        enum ScaleFactor {
+            times1 = 0,
+            times2 = 1,
+            times4 = 2,
+            times8 = 3,
+        };
+
+    private:
+        Register _base;
+        Register _index;
+        ScaleFactor _scale;
+        int _disp;
+
+    public:
+        explicit Address(Register base, int disp = 0)
+            : _base(base), _index(noreg), _scale(times1), _disp(disp) {
+        }
+
+        Address(Register base, Register index, ScaleFactor scale, int disp = 0)
+            : _base(base), _index(index), _scale(scale), _disp(disp) {
+        }
+
+        /**
+         * The same operand {@code offset} bytes further.
+         */
+        Address plusDisp(int offset) const {
+            return Address(_base, _index, _scale, _disp + offset);
+        }
+
+        Register getBase() const { return _base; }
+
+        Register getIndex() const { return _index; }
+
+        ScaleFactor getScale() const { return _scale; }
+
+        int getDisp() const { return _disp; }
+    };
 }
@@ -0,0 +1,335 @@
+//
+// Minimal x86_64 assembler for the template interpreter
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <kivm/asm/address.h>
+#include <kivm/asm/register.h>
+#include <kivm/bytecode2/defs.h>
+#include <vector>
+
+namespace kivm {
+    /**
+     * Executable memory that generated code is written to.
+     * It stays writable until {@code makeExecutable()}.
+     */
+    class CodeBuffer final {
+    private:
+        u1 *_start;
+        u1 *_end;
+        u1 *_pc;
+
+    public:
+        explicit CodeBuffer(size_t capacity);
+
+        ~CodeBuffer();
+
+        CodeBuffer(const CodeBuffer &) = delete;
+
+        CodeBuffer &operator=(const CodeBuffer &) = delete;
+
+        void makeExecutable();
+
+        inline u1 *getStart() const { return _start; }
+
+        inline u1 *getPc() const { return _pc; }
+
+        inline size_t getSize() const { return (size_t) (_pc - _start); }
+
+        inline void emit(u1 b) {
+            if (_pc >= _end) {
+                PANIC("CodeBuffer: out of space");
+            }
+            *_pc++ = b;
+        }
+    };
+
+    /**
+     * A position in the code, bound once. Jumps to a label
+     * that is not bound yet are patched by {@code Assembler::bind()}.
+     */
+    class Label final {
+        friend class Assembler;
+
+    private:
+        u1 *_target = nullptr;
+        std::vector<u1 *> _patches;
+
+    public:
+        inline bool isBound() const {
+            return _target != nullptr;
+        }
+    };
+
+    /**
+     * Encodes the x86_64 instructions the interpreter templates use.
+     * Instructions are named as in AT&T syntax, the size is the suffix
+     * (b, w, l, q), but operands are written destination first.
+     */
+    class Assembler {
+    public:
+        enum Condition {
+            overflow = 0x0,
+            noOverflow = 0x1,
+            below = 0x2,
+            aboveEqual = 0x3,
+            equal = 0x4,
+            notEqual = 0x5,
+            belowEqual = 0x6,
+            above = 0x7,
+            negative = 0x8,
+            positive = 0x9,
+            parity = 0xa,
+            noParity = 0xb,
+            less = 0xc,
+            greaterEqual = 0xd,
+            lessEqual = 0xe,
+            greater = 0xf,
+        };
+
+        static inline Condition negate(Condition cc) {
+            return (Condition) (cc ^ 1);
+        }
+
+    protected:
+        CodeBuffer *_code;
+
+    private:
+        inline void emitByte(int b) {
+            _code->emit((u1) b);
+        }
+
+        void emitInt32(int v);
+
+        void emitInt64(jlong v);
+
+        /**
+         * REX prefix for a register operand in ModRM.reg
+         * and another in ModRM.rm, emitted only when needed.
+         * {@code byteRegs} asks for one whenever the byte registers
+         * spl, bpl, sil or dil are involved.
+         */
+        void prefix(bool wide, int reg, Register rm, bool byteRegs = false);
+
+        void prefix(bool wide, int reg, const Address &address, bool byteRegs = false);
+
+        void emitModRM(int reg, Register rm);
+
+        void emitOperand(int reg, const Address &address);
+
+        /**
+         * {@code op} with a register operand, reg is {@code reg},
+         * rm is {@code rm}. {@code op} may be two bytes (0x0Fxx).
+         */
+        void emitOp(bool wide, int op, Register reg, Register rm, bool byteRegs = false);
+
+        void emitOp(bool wide, int op, Register reg, const Address &address, bool byteRegs = false);
+
+        void emitArith(bool wide, int digit, Register dst, int imm);
+
+        void emitShift(bool wide, int digit, Register dst);
+
+        void emitShift(bool wide, int digit, Register dst, int imm);
+
+        void emitSse(int prefix, int op, XMMRegister reg, const Address &address);
+
+        void emitSse(int prefix, int op, XMMRegister reg, Register rm, bool wide = false);
+
+        inline void emitSse(int prefix, int op, XMMRegister reg, XMMRegister rm) {
+            emitSse(prefix, op, reg, (Register) rm);
+        }
+
+        void emitRel32(Label &label);
+
+    public:
+        explicit Assembler(CodeBuffer *code)
+            : _code(code) {
+        }
+
+        inline address pc() const {
+            return _code->getPc();
+        }
+
+        void bind(Label &label);
+
+        // moves
+        void movl(Register dst, Register src);
+
+        void movl(Register dst, const Address &src);
+
+        void movl(const Address &dst, Register src);
+
+        void movl(Register dst, int imm);
+
+        void movq(Register dst, Register src);
+
+        void movq(Register dst, const Address &src);
+
+        void movq(const Address &dst, Register src);
+
+        void mov64(Register dst, jlong imm);
+
+        void movb(const Address &dst, Register src);
+
+        void movw(const Address &dst, Register src);
+
+        void movzbl(Register dst, const Address &src);
+
+        void movzbl(Register dst, Register src);
+
+        void movsbl(Register dst, const Address &src);
+
+        void movsbl(Register dst, Register src);
+
+        void movzwl(Register dst, const Address &src);
+
+        void movzwl(Register dst, Register src);
+
+        void movswl(Register dst, const Address &src);
+
+        void movswl(Register dst, Register src);
+
+        void movslq(Register dst, Register src);
+
+        void leaq(Register dst, const Address &src);
+
+        // arithmetic
+        void addl(Register dst, Register src);
+
+        void addl(const Address &dst, Register src);
+
+        void subl(Register dst, Register src);
+
+        void andl(Register dst, Register src);
+
+        void orl(Register dst, Register src);
+
+        void xorl(Register dst, Register src);
+
+        void cmpl(Register dst, Register src);
+
+        void cmpl(Register dst, const Address &src);
+
+        void cmpl(Register dst, int imm);
+
+        void testl(Register dst, Register src);
+
+        void imull(Register dst, Register src);
+
+        void negl(Register dst);
+
+        void idivl(Register src);
+
+        void cdql();
+
+        void addq(Register dst, Register src);
+
+        void addq(Register dst, int imm);
+
+        void subq(Register dst, Register src);
+
+        void subq(Register dst, int imm);
+
+        void andq(Register dst, Register src);
+
+        void orq(Register dst, Register src);
+
+        void xorq(Register dst, Register src);
+
+        void cmpq(Register dst, Register src);
+
+        void cmpq(Register dst, int imm);
+
+        void testq(Register dst, Register src);
+
+        void imulq(Register dst, Register src);
+
+        void negq(Register dst);
+
+        void idivq(Register src);
+
+        void cqto();
+
+        void cmpb(const Address &dst, int imm);
+
+        // shifts, by cl or an immediate
+        void shll(Register dst);
+
+        void sarl(Register dst);
+
+        void shrl(Register dst);
+
+        void sarl(Register dst, int imm);
+
+        void shlq(Register dst);
+
+        void sarq(Register dst);
+
+        void shrq(Register dst);
+
+        void shlq(Register dst, int imm);
+
+        void shrq(Register dst, int imm);
+
+        void bswapl(Register dst);
+
+        void setb(Condition cc, Register dst);
+
+        // control
+        void jcc(Condition cc, Label &label);
+
+        void jmp(Label &label);
+
+        void jmp(const Address &target);
+
+        void call(Register target);
+
+        void pushq(Register src);
+
+        void popq(Register dst);
+
+        void ret();
+
+        // SSE
+        void movss(XMMRegister dst, const Address &src);
+
+        void movss(const Address &dst, XMMRegister src);
+
+        void movsd(XMMRegister dst, const Address &src);
+
+        void movsd(const Address &dst, XMMRegister src);
+
+        void movdl(XMMRegister dst, Register src);
+
+        void movdl(Register dst, XMMRegister src);
+
+        void movdq(XMMRegister dst, Register src);
+
+        void movdq(Register dst, XMMRegister src);
+
+        void addss(XMMRegister dst, XMMRegister src);
+
+        void subss(XMMRegister dst, XMMRegister src);
+
+        void mulss(XMMRegister dst, XMMRegister src);
+
+        void addsd(XMMRegister dst, XMMRegister src);
+
+        void subsd(XMMRegister dst, XMMRegister src);
+
+        void mulsd(XMMRegister dst, XMMRegister src);
+
+        void cvtsi2ssl(XMMRegister dst, Register src);
+
+        void cvtsi2ssq(XMMRegister dst, Register src);
+
+        void cvtsi2sdl(XMMRegister dst, Register src);
+
+        void cvtsi2sdq(XMMRegister dst, Register src);
+
+        void cvtss2sd(XMMRegister dst, XMMRegister src);
+
+        void cvtsd2ss(XMMRegister dst, XMMRegister src);
+    };
+}
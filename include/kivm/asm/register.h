@@ -4,5 +4,36 @@
 #pragma once
 
 namespace kivm {
-    using Register = unsigned long;
+    /**
+     * x86_64 general purpose registers, numbered as they are encoded.
+     * An enum rather than an integer so that immediates never bind
+     * to register operands.
+     */
+    enum Register {
+        noreg = -1,
+        rax = 0,
+        rcx = 1,
+        rdx = 2,
+        rbx = 3,
+        rsp = 4,
+        rbp = 5,
+        rsi = 6,
+        rdi = 7,
+        r8 = 8,
+        r9 = 9,
+        r10 = 10,
+        r11 = 11,
+        r12 = 12,
+        r13 = 13,
+        r14 = 14,
+        r15 = 15,
+    };
+
+    /**
+     * SSE registers, only the low float or double is used.
+     */
+    enum XMMRegister {
+        xmm0 = 0,
+        xmm1 = 1,
+    };
 }
@@ -15,8 +15,9 @@ namespace kivm {
          * Run a thread method
          *
          * @param thread Java Thread that contains method
-         * @return method return value(nullptr if void) o
-         *         exception object(if thrown and not handled)
+         * @return returned reference, or exception object(if thrown and not handled),
+         *         nullptr otherwise, primitive results are left in
+         *         {@code JavaThread::_returnValue}
          */
         static oop interp(JavaThread *thread);
 
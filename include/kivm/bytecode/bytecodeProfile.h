@@ -0,0 +1,60 @@
+//
+// Profiles of adjacent instructions, for choosing superinstructions
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <string>
+
+namespace kivm {
+    class Method;
+
+    /**
+     * Counts how often each pair and each triple of instructions
+     * run one right after the other, to pick superinstructions from.
+     * Enabled by setting {@code RuntimeConfig::bytecodeProfilePath},
+     * the counts are written there when the VM exits, and
+     * {@code bytecode-stats} summarizes them.
+     *
+     * Only the threaded interpreter profiles. While it does, it runs
+     * the instructions of the class file, so they are counted as if
+     * nothing was quickened or fused. A sequence is broken by every
+     * taken branch, and by exceptions.
+     */
+    class BytecodeProfile final {
+    public:
+        /**
+         * The instructions an interpreter frame has just run.
+         */
+        struct Cursor {
+            int _previous;
+            int _beforePrevious;
+            u4 _nextPc;
+
+            Cursor() : _previous(-1), _beforePrevious(-1), _nextPc(0) {}
+        };
+
+        static bool isEnabled();
+
+        /**
+         * Count the instruction at {@code pc} of {@code method}.
+         */
+        static void record(Method *method, u4 pc, Cursor &cursor);
+
+        static u8 getPairCount(int first, int second);
+
+        static u8 getTripleCount(int first, int second, int third);
+
+        /**
+         * @return the mnemonic of {@code opcode}, or nullptr if there is none
+         */
+        static const char *getOpcodeName(int opcode);
+
+        /**
+         * Write every count that is not zero to {@code path}, one per line:
+         * {@code pair <first> <second> <count>} or
+         * {@code triple <first> <second> <third> <count>}.
+         */
+        static bool dump(const std::string &path);
+    };
+}
@@ -206,6 +206,37 @@
 #define OPC_GOTO_W                      200
 #define OPC_JSR_W                       201
 #define OPC_BREAKPOINT                  202
+
+// Quickened instructions, never found in class files.
+// The interpreter rewrites an instruction into one of them when it is
+// first executed, operands stay the same, see Quickener.
+#define OPC_FAST_AGETFIELD              203
+#define OPC_FAST_IGETFIELD              204
+#define OPC_FAST_LGETFIELD              205
+#define OPC_FAST_FGETFIELD              206
+#define OPC_FAST_DGETFIELD              207
+#define OPC_FAST_APUTFIELD              208
+#define OPC_FAST_IPUTFIELD              209
+#define OPC_FAST_LPUTFIELD              210
+#define OPC_FAST_FPUTFIELD              211
+#define OPC_FAST_DPUTFIELD              212
+#define OPC_FAST_GETSTATIC              213
+#define OPC_FAST_PUTSTATIC              214
+#define OPC_FAST_NEW                    215
+#define OPC_FAST_INVOKEVIRTUAL          216
+#define OPC_FAST_INVOKEDIRECT           217
+#define OPC_FAST_LDC                    218
+#define OPC_FAST_LDC_W                  219
+#define OPC_FAST_ALDC                   220
+#define OPC_FAST_ALDC_W                 221
+
+// Superinstructions, the first opcode of a sequence is rewritten
+// into one of them before the method first runs, see Superinstructions.
+#define OPC_ALOAD_0_GETFIELD            222
+#define OPC_ILOAD_ILOAD_IF_ICMPGE       223
+#define OPC_ILOAD_IINC_GOTO             224
+#define OPC_ALOAD_ILOAD_IALOAD          225
+
 #define OPC_IMPDEP1                     254
 #define OPC_IMPDEP2                     255
 #define OPC_NUM_OPCODES                 256
\ No newline at end of file
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <kivm/kivm.h>
+#include <cstring>
 
 namespace kivm {
     class CodeBlob final {
@@ -18,6 +19,15 @@ namespace kivm {
             this->_size = size;
         }
 
+        /**
+         * Take a private copy of {@code base}, so that it can be rewritten.
+         */
+        void initCopy(const u1 *base, u4 size) {
+            auto copy = new u1[size];
+            memcpy(copy, base, size);
+            init(copy, size);
+        }
+
     public:
         CodeBlob() : _base(nullptr), _size(0) {}
 
@@ -25,12 +35,33 @@ namespace kivm {
             return _base != nullptr && _size > 0;
         }
 
+        inline u4 getSize() const {
+            return _size;
+        }
+
         inline bool validateOffset(int offset) const {
             return offset >= 0 && offset < _size;
         }
 
+        /**
+         * For interpreters that run the code through pointers.
+         */
+        inline const u1 *getCode() const {
+            return _base;
+        }
+
         inline u1 operator[](int offset) const {
             return *(_base + offset);
         }
+
+        /**
+         * Replace the opcode at {@code offset}, only for blobs
+         * that own their code. The opcode is stored after everything
+         * the new instruction reads, so other threads running
+         * the same code see either the old or the new instruction.
+         */
+        inline void rewrite(int offset, u1 opcode) {
+            __atomic_store_n(_base + offset, opcode, __ATOMIC_RELEASE);
+        }
     };
 }
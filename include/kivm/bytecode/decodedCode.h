@@ -0,0 +1,136 @@
+//
+// Pre-decoded method code for the direct-threaded interpreter
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <deque>
+#include <vector>
+
+namespace kivm {
+    class Method;
+
+    struct ResolvedEntry;
+
+    struct DecodedInstruction;
+
+    /**
+     * Targets of a TABLESWITCH or LOOKUPSWITCH, the default
+     * target is the {@code _target} of the instruction.
+     */
+    struct DecodedSwitch {
+        /**
+         * Keys of a LOOKUPSWITCH in ascending order. A TABLESWITCH
+         * has none, its keys start at {@code _low}.
+         */
+        std::vector<jint> _keys;
+
+        /**
+         * Target of each key.
+         */
+        std::vector<DecodedInstruction *> _targets;
+
+        jint _low = 0;
+    };
+
+    /**
+     * An instruction as {@code DirectThreadedInterpreter} runs it,
+     * with everything the class file encodes in bytes decoded ahead.
+     */
+    struct DecodedInstruction {
+        /**
+         * Address of the interpreter code running this instruction,
+         * replaced by a quickened one after the first run.
+         */
+        void *_handler;
+
+        /**
+         * Where a branch goes, the default target of a switch.
+         */
+        DecodedInstruction *_target;
+
+        union {
+            /**
+             * Entry shared with quickened instructions, found by the constant index.
+             */
+            ResolvedEntry *_entry;
+
+            DecodedSwitch *_switch;
+        };
+
+        /**
+         * Local index, constant index, array type or immediate value,
+         * immediates are sign extended. The short forms carry
+         * their implicit operand here, e.g. 2 for ILOAD_2.
+         */
+        jint _operand;
+
+        /**
+         * Increment of IINC, count of INVOKEINTERFACE
+         * or dimensions of MULTIANEWARRAY.
+         */
+        jint _operand2;
+
+        u4 _bci;
+
+        /**
+         * The opcode in the class file.
+         */
+        u1 _opcode;
+    };
+
+    /**
+     * The code of a method translated into {@code DecodedInstruction}s,
+     * an instruction runs by jumping to its handler and the next one
+     * follows it in memory.
+     *
+     * The first record of a sequence fused by {@code Superinstructions}
+     * gets the handler of the superinstruction, which reads its operands
+     * from the records after it.
+     *
+     * A method that uses instructions without handlers is not translated,
+     * {@code isDecoded()} is false then, and another interpreter runs it.
+     */
+    class DecodedCode final {
+    private:
+        DecodedInstruction *_instructions = nullptr;
+        int _count = 0;
+
+        /**
+         * Instructions by bci, for exception handlers.
+         */
+        std::vector<DecodedInstruction *> _instructionAt;
+
+        /**
+         * Owned by this code, records point into it.
+         */
+        std::deque<DecodedSwitch> _switches;
+
+        DecodedCode() = default;
+
+    public:
+        /**
+         * @param handlers handler addresses of the interpreter by opcode,
+         *                 nullptr for instructions it cannot run
+         */
+        static DecodedCode *decode(Method *method, void *const *handlers);
+
+        ~DecodedCode();
+
+        inline bool isDecoded() const {
+            return _instructions != nullptr;
+        }
+
+        inline DecodedInstruction *getEntry() const {
+            return _instructions;
+        }
+
+        inline DecodedInstruction *getInstructionAt(int bci) const {
+            return _instructionAt[bci];
+        }
+
+        inline int getCount() const {
+            return _count;
+        }
+    };
+}
@@ -0,0 +1,69 @@
+//
+// Direct-threaded interpreter
+//
+#pragma once
+
+#include <compileTimeConfig.h>
+
+#if defined(KIVM_THREADED) && !defined(KIVM_DEBUG)
+
+#include <kivm/kivm.h>
+#include <kivm/oop/oop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/decodedCode.h>
+
+namespace kivm {
+    class Frame;
+
+    class Method;
+
+    class InstanceKlass;
+
+    /**
+     * Runs methods translated into {@code DecodedInstruction}s on their
+     * first call: every instruction is one indirect jump to its handler,
+     * which finds its operands decoded and its branch target resolved.
+     *
+     * Methods with instructions that have no handler here, e.g. WIDE or JSR,
+     * and every method while bytecodes are profiled, are run
+     * by {@code ThreadedInterpreter} from their bytecodes.
+     *
+     * {@code JavaThread::_pc} is only written when something may look at it,
+     * before calls, allocations, exceptions and safepoints.
+     */
+    class DirectThreadedInterpreter final {
+    public:
+        /**
+         * Run a thread method
+         *
+         * @param thread Java Thread that contains method
+         * @return returned reference, or exception object(if thrown and not handled),
+         *         nullptr otherwise, primitive results are left in
+         *         {@code JavaThread::_returnValue}
+         */
+        static oop interp(JavaThread *thread);
+
+        static void initialize();
+
+        /**
+         * @return the handler running {@code opcode}, nullptr if there is none
+         */
+        static inline void *getHandler(int opcode) {
+            return _handlers[opcode];
+        }
+
+    private:
+        static void *_handlers[OPC_NUM_OPCODES];
+
+        static oop directThreaded(JavaThread *thread,
+                                  Frame *currentFrame,
+                                  Method *currentMethod,
+                                  InstanceKlass *currentClass,
+                                  DecodedCode *decodedCode,
+                                  u4 &pc,
+                                  Stack &frameStack,
+                                  Locals &locals);
+    };
+}
+#endif
@@ -0,0 +1,123 @@
+//
+// Escape analysis for allocating objects in the frame arena
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <shared/lock.h>
+#include <atomic>
+#include <vector>
+
+namespace kivm {
+    class Method;
+
+    /**
+     * Finds NEW sites of a method whose objects never escape it, so that
+     * the interpreter can allocate them in the frame arena of the thread
+     * (see {@code FrameArena}) instead of the heap. They are freed when
+     * the frame returns.
+     *
+     * An object escapes when it is stored into a field, a static or an
+     * array, thrown, locked, returned, or passed to a method that is not
+     * known at this point. Calls that are bound without a receiver
+     * check (invokestatic, invokespecial, and invokevirtual of final or
+     * private methods) are followed: the callee is analyzed as well, and
+     * its summary tells which arguments escape from it and which ones
+     * it may return. Callees are only followed into classes that are
+     * already loaded, and only a few calls deep.
+     *
+     * Objects from a site whose previous object is dead whenever the site
+     * is reached again, as in most loops, share a single block of memory
+     * in each frame.
+     *
+     * Everything is computed lazily, the first time the method runs NEW.
+     */
+    class EscapeAnalysis final {
+        friend class EscapeAnalyzer;
+
+    public:
+        /**
+         * Reference arguments and NEW sites tracked in a method,
+         * the rest are treated as escaping.
+         */
+        static constexpr int MAX_TRACKED_VALUES = 64;
+
+        /**
+         * How deep calls are followed from the method being analyzed.
+         */
+        static constexpr int MAX_CALL_DEPTH = 6;
+
+    private:
+        Method *_method;
+
+        Lock _lock;
+        std::atomic<bool> _analyzed{false};
+
+        /**
+         * By argument, the receiver is the first one.
+         */
+        std::vector<bool> _escapingArguments;
+        std::vector<bool> _returnedArguments;
+
+        /**
+         * bci -> index of the frame local site at bci, or -1
+         */
+        std::vector<int> _frameLocalSites;
+
+        /**
+         * By frame local site index.
+         */
+        std::vector<bool> _reusableSites;
+
+    private:
+        void analyze();
+
+        inline void ensureAnalyzed() {
+            if (!_analyzed.load(std::memory_order_acquire)) {
+                analyze();
+            }
+        }
+
+    public:
+        explicit EscapeAnalysis(Method *method);
+
+        /**
+         * @return index of the NEW site at {@code bci} among frame local
+         *         sites of the method, or -1 if its objects may escape
+         */
+        inline int getFrameLocalSite(int bci) {
+            ensureAnalyzed();
+            return _frameLocalSites[bci];
+        }
+
+        inline int getFrameLocalSiteCount() {
+            ensureAnalyzed();
+            return (int) _reusableSites.size();
+        }
+
+        /**
+         * Whether objects of a frame local site can reuse the memory of
+         * the previous object from the same site in the same frame.
+         */
+        inline bool isReusableSite(int site) {
+            ensureAnalyzed();
+            return _reusableSites[site];
+        }
+
+        /**
+         * @param index index of the argument, the receiver is 0
+         */
+        inline bool isArgumentEscaping(int index) {
+            ensureAnalyzed();
+            return _escapingArguments[index];
+        }
+
+        /**
+         * @param index index of the argument, the receiver is 0
+         */
+        inline bool isArgumentReturned(int index) {
+            ensureAnalyzed();
+            return _returnedArguments[index];
+        }
+    };
+}
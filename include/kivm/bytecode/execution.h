@@ -60,6 +60,17 @@ namespace kivm {
         static oop invokeDynamic(JavaThread *thread, InstanceKlass *klass,
                                  Stack &stack, int constantIndex);
 
+        /**
+         * Quickened INVOKEVIRTUAL, the target is the method at the vtable
+         * index of {@code entry->_method} in the class of the receiver.
+         */
+        static oop invokeVirtual(JavaThread *thread, ResolvedEntry *entry, Stack &stack);
+
+        /**
+         * Quickened invoke of {@code entry->_method} itself.
+         */
+        static oop invokeDirect(JavaThread *thread, ResolvedEntry *entry, Stack &stack);
+
         static void putField(JavaThread *thread, RuntimeConstantPool *rt,
                              Stack &stack, int constantIndex, bool isStatic);
 
@@ -67,7 +78,18 @@ namespace kivm {
                              instanceOop receiver, Stack &stack,
                              int constantIndex);
 
-        static void loadConstant(RuntimeConstantPool *rt, Stack &stack,
+        /**
+         * Quickened GETSTATIC and PUTSTATIC.
+         */
+        static void getStatic(ResolvedEntry *entry, Stack &stack);
+
+        static void putStatic(ResolvedEntry *entry, Stack &stack);
+
+        /**
+         * Nothing is pushed when interning a string constant
+         * ran out of heap, the OutOfMemoryError is pending.
+         */
+        static void loadConstant(JavaThread *thread, RuntimeConstantPool *rt, Stack &stack,
                                  int constantIndex);
 
         static bool initializeClass(JavaThread *thread, InstanceKlass *klass);
@@ -81,6 +103,19 @@ namespace kivm {
         static instanceOop newInstance(JavaThread *thread, RuntimeConstantPool *rt,
                                        int constantIndex);
 
+        /**
+         * NEW at {@code bci} of {@code frame}. Objects that never escape
+         * the frame are allocated in the frame arena of the thread.
+         */
+        static instanceOop newInstance(JavaThread *thread, Frame *frame, RuntimeConstantPool *rt,
+                                       int constantIndex, int bci);
+
+        /**
+         * Quickened NEW, {@code instanceKlass} is initialized.
+         */
+        static instanceOop newInstance(JavaThread *thread, Frame *frame,
+                                       InstanceKlass *instanceKlass, int bci);
+
         static typeArrayOop newPrimitiveArray(JavaThread *thread,
                                               int arrayType, int length);
 
@@ -7,10 +7,10 @@
 
 #if defined(KIVM_THREADED) && !defined(KIVM_DEBUG)
 
-#include <kivm/bytecode/threadedInterpreter.h>
+#include <kivm/bytecode/directThreadedInterpreter.h>
 
 namespace kivm {
-    using DefaultInterpreter = ThreadedInterpreter;
+    using CppInterpreter = DirectThreadedInterpreter;
 }
 
 #else
@@ -18,8 +18,23 @@ namespace kivm {
 #include <kivm/bytecode/bytecodeInterpreter.h>
 
 namespace kivm {
-    using DefaultInterpreter = ByteCodeInterpreter;
+    using CppInterpreter = ByteCodeInterpreter;
 }
 
+#endif
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
+#include <kivm/bytecode2/templateInterpreter.h>
+
+namespace kivm {
+    using DefaultInterpreter = TemplateInterpreter;
+}
+
+#else
+
+namespace kivm {
+    using DefaultInterpreter = CppInterpreter;
+}
 
 #endif
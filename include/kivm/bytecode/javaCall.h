@@ -73,6 +73,18 @@ namespace kivm {
             return JavaCall(thread, method, stack).invokeSimple(forceNoResolve);
         }
 
+        /**
+         * Call {@code method} itself, whose class must be initialized.
+         * Used by quickened invokes, which have selected the target.
+         */
+        static inline oop withResolvedStack(JavaThread *thread, Method *method, Stack *stack) {
+            JavaCall call(thread, method, stack);
+            bool hasThis = !method->isStatic();
+            return method->isNative()
+                   ? call.invokeNative(hasThis, false)
+                   : call.invokeJava(hasThis, false);
+        }
+
         static inline oop withMethodHandle(JavaThread *thread, Method *invokeExact,
                                            Stack *stack, instanceOop MH,
                                            const String &descriptor) {
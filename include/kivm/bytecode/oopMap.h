@@ -0,0 +1,152 @@
+//
+// Per-method maps of frame slots holding references
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <shared/lock.h>
+#include <shared/hashMap.h>
+#include <map>
+#include <vector>
+
+namespace kivm {
+    class Method;
+
+    class CodeBlob;
+
+    struct StackMapTable_attribute;
+
+    /**
+     * Slots of a frame holding references, before the instruction at a bci.
+     */
+    class OopMapEntry final {
+        friend class OopMap;
+
+    private:
+        int _maxLocals;
+
+        /**
+         * Locals first, followed by the operand stack.
+         */
+        std::vector<bool> _oopSlots;
+
+        explicit OopMapEntry(int maxLocals)
+            : _maxLocals(maxLocals) {
+        }
+
+    public:
+        inline int getStackDepth() const {
+            return (int) _oopSlots.size() - _maxLocals;
+        }
+
+        inline bool isLocalOop(int index) const {
+            return index < _maxLocals && _oopSlots[index];
+        }
+
+        inline bool isStackOop(int index) const {
+            return index < getStackDepth() && _oopSlots[_maxLocals + index];
+        }
+    };
+
+    /**
+     * Tells which slots of an interpreted frame hold references,
+     * so that slots can be plain values without a type tag.
+     *
+     * Type states are known at checkpoints: the method entry, and
+     * every frame in the StackMapTable. When a method has no StackMapTable
+     * (class files older than version 50), states at the start of every
+     * basic block are inferred by data flow analysis instead.
+     * The state at any other bci is computed by interpreting types
+     * forward from the nearest checkpoint, and cached.
+     *
+     * Everything is computed lazily, the first time a GC finds the method
+     * on a thread stack. GC workers may look up the same map in parallel.
+     */
+    class OopMap final {
+    public:
+        /**
+         * Type of a slot. Long and double values take two VALUE slots.
+         */
+        enum SlotType : u1 {
+            SLOT_VALUE = 0,
+            SLOT_OOP = 1,
+        };
+
+        struct TypeState {
+            std::vector<u1> _locals;
+            std::vector<u1> _stack;
+        };
+
+    private:
+        Method *_method;
+        StackMapTable_attribute *_stackMapTable;
+
+        Lock _lock;
+        bool _analyzed = false;
+
+        /**
+         * Whether an instruction starts at a bci.
+         */
+        std::vector<bool> _instructionStarts;
+
+        /**
+         * bci -> type state before the instruction, sorted by bci.
+         */
+        std::map<int, TypeState> _checkpoints;
+
+        /**
+         * bci -> computed entry
+         */
+        HashMap<int, OopMapEntry *> _entries;
+
+    private:
+        void analyze();
+
+        /**
+         * Verification types of {@code this} and arguments.
+         */
+        std::vector<u1> getEntryLocalTags();
+
+        /**
+         * Expand verification types into slot types,
+         * long and double take two slots.
+         */
+        TypeState expandTags(const std::vector<u1> &localTags,
+                             const std::vector<u1> &stackTags);
+
+        TypeState getEntryState();
+
+        void loadStackMapTable();
+
+        void inferCheckpoints();
+
+        void interpret(int bci, TypeState &state);
+
+        OopMapEntry *computeEntry(int bci);
+
+        /**
+         * @return the bci of the instruction that {@code pc} is executing
+         */
+        int getBci(u4 pc);
+
+    public:
+        /**
+         * Length in bytes of the instruction at {@code bci}.
+         */
+        static int getInstructionLength(const CodeBlob &codeBlob, int bci);
+
+        OopMap(Method *method, StackMapTable_attribute *stackMapTable);
+
+        ~OopMap();
+
+        /**
+         * Look up reference slots of a frame of this method.
+         *
+         * @param pc the pc of the frame, as saved in {@code JavaThread::_pc}
+         *           or {@code Frame::_returnPc}: 0 at method entry, otherwise
+         *           past the opcode of the instruction being executed,
+         *           but not past the instruction
+         */
+        const OopMapEntry *lookup(u4 pc);
+    };
+}
@@ -0,0 +1,50 @@
+//
+// Rewriting of resolved instructions into quickened variants
+//
+#pragma once
+
+#include <kivm/bytecode/codeBlob.h>
+#include <kivm/runtime/constantPool.h>
+
+namespace kivm {
+    /**
+     * Rewrites instructions that have just run into quickened ones,
+     * which find what they need in {@code ResolvedEntry} by the same
+     * constant index, and so skip constant pool lookups and class
+     * initialization checks when they run again.
+     *
+     * An instruction is only quickened after it ran without an exception,
+     * when what it uses is resolved and its class is fully initialized.
+     * Otherwise it is left alone and tried again next time.
+     *
+     * Only the rewritten code of a method changes, see
+     * {@code Method::getRewrittenCode()}. Analyses read the original code.
+     */
+    class Quickener final {
+    public:
+        /**
+         * GETFIELD, PUTFIELD, GETSTATIC or PUTSTATIC at {@code bci}.
+         * Instance fields of byte, char, short and boolean types
+         * are not quickened.
+         */
+        static void quickenField(RuntimeConstantPool *rt, CodeBlob &code,
+                                 int bci, int constantIndex);
+
+        static void quickenNew(RuntimeConstantPool *rt, CodeBlob &code,
+                               int bci, int constantIndex);
+
+        /**
+         * INVOKEVIRTUAL, INVOKESPECIAL or INVOKESTATIC at {@code bci}.
+         * Virtual calls that need dispatching go through vtable indices,
+         * calls to methods declared in interfaces are not quickened.
+         */
+        static void quickenInvoke(RuntimeConstantPool *rt, CodeBlob &code,
+                                  int bci, int constantIndex);
+
+        /**
+         * LDC or LDC_W of int, float and string constants.
+         */
+        static void quickenLoadConstant(RuntimeConstantPool *rt, CodeBlob &code,
+                                        int bci, int constantIndex);
+    };
+}
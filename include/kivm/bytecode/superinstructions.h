@@ -0,0 +1,46 @@
+//
+// Superinstructions fused from hot instruction sequences
+//
+#pragma once
+
+#include <kivm/bytecode/codeBlob.h>
+#include <string>
+
+namespace kivm {
+    /**
+     * Sequences of instructions that the interpreter runs as one,
+     * saving the dispatches between them. Which sequences are fused is set by
+     * {@code RuntimeConfig::superinstructions}, the pair and triple
+     * statistics of {@code BytecodeProfile} tell which ones are worth it.
+     *
+     * Only the first opcode of a sequence is rewritten, its operands and
+     * the instructions after it stay where they were. A branch into
+     * the middle of a sequence still runs the instructions one by one.
+     *
+     * Sequences match the exact instructions, e.g. ILOAD but not ILOAD_1.
+     */
+    class Superinstructions final {
+    public:
+        struct Superinstruction {
+            const char *_name;
+            u1 _opcode;
+            int _length;
+            u1 _sequence[3];
+        };
+
+        static const Superinstruction *getAll(int *count);
+
+        /**
+         * Parse a comma-separated list of superinstruction names,
+         * or {@code all}, or {@code none}.
+         * @return false if a name is unknown
+         */
+        static bool parse(const std::string &names, u4 *set);
+
+        /**
+         * Rewrite every sequence found in {@code code} into {@code rewritten},
+         * the instructions are read from {@code code}.
+         */
+        static void fuse(const CodeBlob &code, CodeBlob &rewritten);
+    };
+}
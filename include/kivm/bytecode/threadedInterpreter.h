@@ -26,8 +26,9 @@ namespace kivm {
          * Run a thread method
          *
          * @param thread Java Thread that contains method
-         * @return method return value(nullptr if void) o
-         *         exception object(if thrown and not handled)
+         * @return returned reference, or exception object(if thrown and not handled),
+         *         nullptr otherwise, primitive results are left in
+         *         {@code JavaThread::_returnValue}
          */
         static oop interp(JavaThread *thread);
 
@@ -37,13 +38,19 @@ namespace kivm {
     private:
         static void *_jumpTable[OPC_NUM_OPCODES];
 
+        /**
+         * Every entry leads to {@code BytecodeProfile::record()},
+         * and from there to {@code _jumpTable}.
+         */
+        static void *_profilingJumpTable[OPC_NUM_OPCODES];
+
         static oop threaded(JavaThread *thread, void **jump,
                             Frame *currentFrame,
                             Method *currentMethod,
                             InstanceKlass *currentClass,
-                            const CodeBlob &codeBlob,
+                            CodeBlob &codeBlob,
                             u4 &pc,
-                            Stack &stack,
+                            Stack &frameStack,
                             Locals &locals);
     };
 }
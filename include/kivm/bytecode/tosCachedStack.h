@@ -0,0 +1,135 @@
+//
+// Operand stack with a cached top of stack
+//
+#pragma once
+
+#include <kivm/runtime/stack.h>
+#include <kivm/bytecode2/defs.h>
+
+namespace kivm {
+    /**
+     * The operand stack as the interpreter sees it: the top slot is cached
+     * in a local variable, which the compiler keeps in a register, so that
+     * a value pushed by one instruction and popped by the next one
+     * never goes through the frame.
+     *
+     * Only one-slot values are cached, {@code _state} tells whether
+     * the cached slot holds an int, a float or a reference. Longs and
+     * doubles take two slots and always live in the frame stack.
+     *
+     * GC only scans the frame stack, the interpreter must call
+     * {@code flush()} before anything that may reach a safepoint.
+     * Every pop leaves the cache empty, instructions that pop their
+     * operands before calling out need not flush.
+     */
+    class TosCachedStack final {
+    private:
+        Stack &_stack;
+        Slot _tos{};
+        TosState _state = vtos;
+
+        inline void cache(Slot slot, TosState state) {
+            flush();
+            _tos = slot;
+            _state = state;
+        }
+
+    public:
+        explicit TosCachedStack(Stack &stack)
+            : _stack(stack) {
+        }
+
+        /**
+         * Write the cached slot back to the frame stack.
+         * @return the frame stack, complete now
+         */
+        inline Stack &flush() {
+            if (_state != vtos) {
+                _stack.pushReference(_tos.ref);
+                _state = vtos;
+            }
+            return _stack;
+        }
+
+        inline void pushInt(jint v) {
+            Slot slot{};
+            slot.i32 = v;
+            cache(slot, itos);
+        }
+
+        inline void pushFloat(jfloat v) {
+            union {
+                jfloat f;
+                jint i32;
+            } X{};
+            X.f = v;
+            Slot slot{};
+            slot.i32 = X.i32;
+            cache(slot, ftos);
+        }
+
+        inline void pushReference(jobject v) {
+            Slot slot{};
+            slot.ref = v;
+            cache(slot, atos);
+        }
+
+        inline void pushLong(jlong v) {
+            flush().pushLong(v);
+        }
+
+        inline void pushDouble(jdouble v) {
+            flush().pushDouble(v);
+        }
+
+        inline jint popInt() {
+            if (_state == vtos) {
+                return _stack.popInt();
+            }
+            _state = vtos;
+            return _tos.i32;
+        }
+
+        inline jfloat popFloat() {
+            if (_state == vtos) {
+                return _stack.popFloat();
+            }
+            _state = vtos;
+            union {
+                jint i32;
+                jfloat f;
+            } X{};
+            X.i32 = _tos.i32;
+            return X.f;
+        }
+
+        inline jobject popReference() {
+            if (_state == vtos) {
+                return _stack.popReference();
+            }
+            _state = vtos;
+            return _tos.ref;
+        }
+
+        inline jlong popLong() {
+            return flush().popLong();
+        }
+
+        inline jdouble popDouble() {
+            return flush().popDouble();
+        }
+
+        inline void dropTop() {
+            if (_state == vtos) {
+                _stack.dropTop();
+            } else {
+                _state = vtos;
+            }
+        }
+
+        inline void clear() {
+            _state = vtos;
+            _stack.clear();
+        }
+    };
+}
@@ -7,9 +7,6 @@
 
 namespace kivm {
     class Bytecodes {
-    private:
-        constexpr static int BitsPerByte = 4;
-
     public:
         enum Code {
             _illegal = -1,
@@ -227,35 +224,83 @@ namespace kivm {
             number_of_codes,
         };
 
-        static bool _is_initialized;
-        static const char *_name[number_of_codes];
-        static ValueType _result_type[number_of_codes];
-        static signed char _depth[number_of_codes];
-        static unsigned char _lengths[number_of_codes];
-        static Code _java_code[number_of_codes];
-
-        // all second page for wide formats
-        static jchar _flags[(1 << BitsPerByte) * 2];
-
-        static void check(Code code) {
-            assert(isDefined(code));
-        }
-
-        static void wideCheck(Code code) {
-            assert(wideIsDefined(code));
-        }
-
         static bool isDefined(int code) {
-            return 0 <= code && code < number_of_codes && flags(code, false) != 0;
+            return 0 <= code && code < number_of_java_codes;
         }
 
-        static bool wideIsDefined(int code) {
-            return isDefined(code) && flags(code, true) != 0;
+        static void check(Code code) {
+            assert(isDefined(code));
         }
 
-        static int flags(int code, bool isWide) {
-            assert(code == (unsigned char) code);
-            return _flags[code + (isWide ? (1 << BitsPerByte) : 0)];
+        /**
+         * @return bytes taken by {@code code} and its operands,
+         *         0 for tableswitch, lookupswitch and wide
+         */
+        static int lengthFor(Code code) {
+            switch (code) {
+                case _bipush:
+                case _ldc:
+                case _iload:
+                case _lload:
+                case _fload:
+                case _dload:
+                case _aload:
+                case _istore:
+                case _lstore:
+                case _fstore:
+                case _dstore:
+                case _astore:
+                case _ret:
+                case _newarray:
+                    return 2;
+                case _sipush:
+                case _ldc_w:
+                case _ldc2_w:
+                case _iinc:
+                case _ifeq:
+                case _ifne:
+                case _iflt:
+                case _ifge:
+                case _ifgt:
+                case _ifle:
+                case _if_icmpeq:
+                case _if_icmpne:
+                case _if_icmplt:
+                case _if_icmpge:
+                case _if_icmpgt:
+                case _if_icmple:
+                case _if_acmpeq:
+                case _if_acmpne:
+                case _goto:
+                case _jsr:
+                case _getstatic:
+                case _putstatic:
+                case _getfield:
+                case _putfield:
+                case _invokevirtual:
+                case _invokespecial:
+                case _invokestatic:
+                case _new:
+                case _anewarray:
+                case _checkcast:
+                case _instanceof:
+                case _ifnull:
+                case _ifnonnull:
+                    return 3;
+                case _multianewarray:
+                    return 4;
+                case _invokeinterface:
+                case _invokedynamic:
+                case _goto_w:
+                case _jsr_w:
+                    return 5;
+                case _tableswitch:
+                case _lookupswitch:
+                case _wide:
+                    return 0;
+                default:
+                    return 1;
+            }
         }
     };
 }
@@ -3,9 +3,109 @@
 //
 #pragma once
 
+#include <kivm/asm/assembler.h>
+#include <kivm/bytecode2/defs.h>
+
 namespace kivm {
-    class InterpreterMacroAssembler {
+    // registers fixed while templates run
+    constexpr Register rstate = r15;     // InterpreterState *
+    constexpr Register rstack = r14;     // next free operand stack slot
+    constexpr Register rbcp = r13;       // current bytecode
+    constexpr Register rlocals = r12;    // local variable slots
+    constexpr Register rdispatch = rbx;  // dispatch table
+
+    /**
+     * Assembler with the operations templates are made of:
+     * moving the cached top of stack in and out of the operand stack,
+     * dispatching to the next bytecode and calling into the VM.
+     *
+     * The top of stack is cached in rax: ints and floats in eax,
+     * longs, doubles and references in rax. Floats and doubles
+     * are kept as their bits and only moved into xmm registers
+     * to compute with.
+     */
+    class InterpreterMacroAssembler : public Assembler {
+    private:
+        address _flushed;
+
+        // bound by the interpreter generator before templates are generated
+        Label _exit;
+        Label _exceptionExit;
+        Label _vmBytecode[number_of_states];
+
     public:
+        explicit InterpreterMacroAssembler(CodeBuffer *code)
+            : Assembler(code), _flushed(code->getPc()) {
+        }
+
+        /**
+         * Leaves generated code, returning eax.
+         */
+        inline Label &leave() {
+            return _exit;
+        }
+
+        /**
+         * Leaves generated code with the pending exception of the thread.
+         */
+        inline Label &exceptionExit() {
+            return _exceptionExit;
+        }
+
+        /**
+         * Runs the current bytecode in the VM, with the top of stack
+         * in {@code state} written back first.
+         * Templates jump here for cases they do not handle themselves.
+         */
+        inline Label &vmBytecode(TosState state) {
+            return _vmBytecode[state];
+        }
+
+        void pushI(Register r = rax);
+
+        void popI(Register r = rax);
+
+        void pushL(Register r = rax);
+
+        void popL(Register r = rax);
+
+        void pushPtr(Register r = rax);
+
+        void popPtr(Register r = rax);
+
+        void push(TosState state);
+
+        void pop(TosState state);
+
+        /**
+         * Longs and doubles take two slots, the high word in the first.
+         * Both use r11.
+         */
+        void loadLong(Register dst, const Address &slot);
+
+        void storeLong(const Address &slot, Register src);
+
+        /**
+         * Move {@code step} bytes forward and jump to the template
+         * of the bytecode there, the top of stack being {@code state}.
+         */
+        void dispatchNext(TosState state, int step);
+
+        /**
+         * Call {@code int entry(InterpreterState *)}, which returns
+         * non-zero when an exception is pending. The stack pointer
+         * and bcp are written to the state before and read back after.
+         */
+        void callVM(address entry);
+
+        /**
+         * Sets the flags to not equal when a safepoint is pending.
+         */
+        void testSafepointPoll();
+
+        /**
+         * Make code emitted since the last flush visible to execution.
+         */
         void flush();
     };
 }
@@ -0,0 +1,115 @@
+//
+// Template interpreter for x86_64
+//
+#pragma once
+
+#include <compileTimeConfig.h>
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
+#include <kivm/kivm.h>
+#include <kivm/oop/oop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/slot.h>
+#include <kivm/bytecode2/defs.h>
+
+namespace kivm {
+    class CodeBuffer;
+
+    class Frame;
+
+    class Method;
+
+    class RuntimeConstantPool;
+
+    class InterpreterMacroAssembler;
+
+    /**
+     * What generated code and the VM share while a method runs.
+     * Generated code keeps {@code _sp} and {@code _bcp} in registers
+     * and only writes them back when it calls into the VM.
+     */
+    struct InterpreterState {
+        Slot *_locals;
+        Slot *_sp;
+        const u1 *_bcp;
+        const u1 *_code;
+        JavaThread *_thread;
+        Frame *_frame;
+        Method *_method;
+        RuntimeConstantPool *_rt;
+        jvalue _result;
+    };
+
+    /**
+     * Runs methods in machine code generated at startup from
+     * {@code TemplateTable}, one template per bytecode and cached
+     * top of stack state, dispatching from one to the next through
+     * a table indexed by the state and the next bytecode.
+     *
+     * Bytecodes without a template, and the cases templates do not
+     * handle, e.g. exceptions, are run by {@code runtimeBytecode()}.
+     * While bytecodes are profiled, or when disabled, methods are
+     * run by {@code CppInterpreter} instead.
+     */
+    class TemplateInterpreter final {
+    public:
+        /**
+         * Exit code of generated code when an exception is pending,
+         * return bytecodes exit with their {@code TosState}.
+         */
+        static constexpr int EXIT_EXCEPTION = number_of_states;
+
+        /**
+         * Run a thread method
+         *
+         * @param thread Java Thread that contains method
+         * @return returned reference, or exception object(if thrown and not handled),
+         *         nullptr otherwise, primitive results are left in
+         *         {@code JavaThread::_returnValue}
+         */
+        static oop interp(JavaThread *thread);
+
+        static void initialize();
+
+        static bool isGenerated() {
+            return _entry != nullptr;
+        }
+
+    private:
+        friend class TemplateTable;
+
+        using EntryPoint = int (*)(InterpreterState *);
+
+        static CodeBuffer *_code;
+        static EntryPoint _entry;
+        static address _dispatchTable[number_of_states][OPC_NUM_OPCODES];
+
+        static void generate();
+
+        static void generateEntry(InterpreterMacroAssembler *masm);
+
+        static void generateExits(InterpreterMacroAssembler *masm);
+
+        static void generateVMBytecodes(InterpreterMacroAssembler *masm);
+
+        static void generateTemplates(InterpreterMacroAssembler *masm);
+
+        /**
+         * Write the operand stack pointer and pc back to the frame
+         * before running VM code.
+         */
+        static Stack &enterVM(InterpreterState *state);
+
+        static int leaveVM(InterpreterState *state, Stack &stack, bool exceptionPending);
+
+        // called from generated code
+        static int runtimeBytecode(InterpreterState *state);
+
+        static int safepoint(InterpreterState *state);
+
+        static int illegalBytecode(InterpreterState *state);
+    };
+}
+
+#endif
@@ -16,16 +16,12 @@ namespace kivm {
         enum Condition {
             equal, not_equal, less, less_equal, greater, greater_equal
         };
-        enum CacheByte {
-            f1_byte = 1, f2_byte = 2
-        };  // byteNo codes
 
     private:
         // true if TemplateTable has been initialized
         static bool _is_initialized;
 
         static Template _templateTable[Bytecodes::number_of_codes];
-        static Template _templateTableWide[Bytecodes::number_of_codes];
 
         // the current template to be generated
         static Template *_desc;
@@ -41,27 +37,7 @@ namespace kivm {
         // special registers
         static inline Address atBcp(int offset);
 
-        // helpers
-        static void unimplementedBytecode();
-
-        // C calls
-        static void call_VM(Register oopResult, address entryPoint);
-
-        static void call_VM(Register oopResult, address entryPoint, Register arg_1);
-
-        static void call_VM(Register oopResult, address entryPoint, Register arg_1, Register arg_2);
-
-        static void call_VM(Register oopResult, address entryPoint, Register arg_1, Register arg_2, Register arg_3);
-
-        static void call_VM(Register oopResult, Register lastJavaSp, address entryPoint);
-
-        static void call_VM(Register oopResult, Register lastJavaSp, address entryPoint, Register arg_1);
-
-        static void
-        call_VM(Register oopResult, Register lastJavaSp, address entryPoint, Register arg_1, Register arg_2);
-
-        static void call_VM(Register oopResult, Register lastJavaSp, address entryPoint, Register arg_1, Register arg_2,
-                            Register arg_3);
+        static inline Address atLocal(int n);
 
         // bytecodes
         static void nop();
@@ -80,22 +56,10 @@ namespace kivm {
 
         static void sipush();
 
-        static void ldc(bool wide);
-
-        static void ldc2_w();
-
-        static void fast_aldc(bool wide);
-
         static void locals_index(Register reg, int offset = 1);
 
         static void iload();
 
-        static void fast_iload();
-
-        static void fast_iload2();
-
-        static void fast_icaload();
-
         static void lload();
 
         static void fload();
@@ -104,18 +68,6 @@ namespace kivm {
 
         static void aload();
 
-        static void locals_index_wide(Register reg);
-
-        static void wide_iload();
-
-        static void wide_lload();
-
-        static void wide_fload();
-
-        static void wide_dload();
-
-        static void wide_aload();
-
         static void iaload();
 
         static void laload();
@@ -142,8 +94,6 @@ namespace kivm {
 
         static void aload(int n);
 
-        static void aload_0();
-
         static void istore();
 
         static void lstore();
@@ -154,16 +104,6 @@ namespace kivm {
 
         static void astore();
 
-        static void wide_istore();
-
-        static void wide_lstore();
-
-        static void wide_fstore();
-
-        static void wide_dstore();
-
-        static void wide_astore();
-
         static void iastore();
 
         static void lastore();
@@ -172,10 +112,6 @@ namespace kivm {
 
         static void dastore();
 
-        static void aastore();
-
-        static void bastore();
-
         static void castore();
 
         static void sastore();
@@ -220,8 +156,6 @@ namespace kivm {
 
         static void irem();
 
-        static void lmul();
-
         static void ldiv();
 
         static void lrem();
@@ -236,27 +170,13 @@ namespace kivm {
 
         static void lneg();
 
-        static void fneg();
-
-        static void dneg();
-
         static void iinc();
 
-        static void wide_iinc();
-
         static void convert();
 
         static void lcmp();
 
-        static void float_cmp(bool isFloat, int unorderedResult);
-
-        static void float_cmp(int unorderedResult);
-
-        static void double_cmp(int unorderedResult);
-
-        static void count_calls(Register method, Register temp);
-
-        static void branch(bool is_jsr, bool is_wide);
+        static void branch();
 
         static void if_0cmp(Condition cc);
 
@@ -268,111 +188,29 @@ namespace kivm {
 
         static void _goto();
 
-        static void jsr();
-
-        static void ret();
-
-        static void wide_ret();
-
-        static void goto_w();
-
-        static void jsr_w();
-
-        static void tableswitch();
-
-        static void lookupswitch();
-
-        static void fast_linearswitch();
-
-        static void fast_binaryswitch();
-
         static void _return(TosState state);
 
-        static void resolve_cache_and_index(int byteNo,       // one of 1,2,11
-                                            Register cache,    // output for CP cache
-                                            Register index,    // output for CP index
-                                            size_t indexSize); // one of 1,2,4
-
-        static void load_invoke_cp_cache_entry(int byteNo,
-                                               Register method,
-                                               Register itableIndex,
-                                               Register flags,
-                                               bool is_invokevirtual,
-                                               bool is_virtual_final,
-                                               bool is_invokedynamic);
-
-        static void load_field_cp_cache_entry(Register obj,
-                                              Register cache,
-                                              Register index,
-                                              Register offset,
-                                              Register flags,
-                                              bool isStatic);
-
-        static void invokevirtual(int byteNo);
-
-        static void invokespecial(int byteNo);
-
-        static void invokestatic(int byteNo);
-
-        static void invokeinterface(int byteNo);
-
-        static void invokedynamic(int byteNo);
-
-        static void invokehandle(int byteNo);
-
-        static void fast_invokevfinal(int byteNo);
-
-        static void getfield_or_static(int byteNo, bool isStatic);
-
-        static void putfield_or_static(int byteNo, bool isStatic);
-
-        static void getfield(int byteNo);
-
-        static void putfield(int byteNo);
-
-        static void getstatic(int byteNo);
-
-        static void putstatic(int byteNo);
-
-        static void pop_and_check_object(Register obj);
-
-        static void _new();
-
-        static void newarray();
-
-        static void anewarray();
-
         static void arraylength();
 
-        static void checkcast();
-
-        static void instanceof();
+        /**
+         * Bytecodes run by {@code TemplateInterpreter::runtimeBytecode()}.
+         */
+        static void vm_bytecode();
 
-        static void athrow();
+        // helpers for array templates
+        static void index_check(Register array, Register index);
 
-        static void monitorenter();
+        static void store_index_check(Register array, Register index);
 
-        static void monitorexit();
+        static void idiv_or_irem(bool isRem);
 
-        static void wide();
-
-        static void multianewarray();
-
-        static void _breakpoint();
-
-        static void shouldnotreachhere();
-
-        // debugging of TemplateGenerator
-        // checks if in/out states expected by template generator correspond to table entries
-        static void transition(TosState in, TosState out);
+        static void ldiv_or_lrem(bool isRem);
 
         // initialization helpers
         static void def(Bytecodes::Code code, int flags, TosState in, TosState out, void (*gen)(), char filler);
 
         static void def(Bytecodes::Code code, int flags, TosState in, TosState out, void (*gen)(int arg), int arg);
 
-        static void def(Bytecodes::Code code, int flags, TosState in, TosState out, void (*gen)(bool arg), bool arg);
-
         static void
         def(Bytecodes::Code code, int flags, TosState in, TosState out, void (*gen)(TosState tos), TosState tos);
 
@@ -384,9 +222,6 @@ namespace kivm {
 
         friend class Template;
 
-        // InterpreterMacroAssembler::is_a(), etc., need TemplateTable::call_VM().
-        friend class InterpreterMacroAssembler;
-
     public:
         // Initialization
         static void initialize();
@@ -396,12 +231,5 @@ namespace kivm {
             Bytecodes::check(code);
             return &_templateTable[code];
         }
-
-        static Template *templateForWide(Bytecodes::Code code) {
-            Bytecodes::wideCheck(code);
-            return &_templateTableWide[code];
-        }
-
-        // Platform specifics comes here
     };
 }
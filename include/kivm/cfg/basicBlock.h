@@ -0,0 +1,112 @@
+//
+// Basic blocks of a method
+//
+#pragma once
+
+#include <kivm/cfg/block.h>
+#include <list>
+
+namespace kivm {
+    namespace instr {
+        /**
+         * A basic block of a method, instruction numbers are bcis.
+         *
+         * An edge is shared by the blocks at both of its ends,
+         * and owned by the {@link ControlFlowGraph} that created them.
+         */
+        class BasicBlock : public IBlock {
+        private:
+            String _id;
+            std::set<int> _instructionNums;
+            std::set<Edge *> _edges;
+
+            /**
+             * Exception types referenced by CAUGHT_EXCEPTION edges,
+             * a list keeps their addresses stable.
+             */
+            std::list<String> _exceptionTypes;
+
+        private:
+            static BasicBlock *requireBasicBlock(IBlock *block);
+
+            void connect(IBlock *src, IBlock *dest, EdgeType type, Object metaData);
+
+        public:
+            BasicBlock() = default;
+
+            BasicBlock(const BasicBlock &) = delete;
+
+            BasicBlock &operator=(const BasicBlock &) = delete;
+
+            void addExceptionHandler(IBlock *block, String exceptionType) override;
+
+            void addInstructionNum(int num) override;
+
+            void addInstructionNums(IBlock *other) override;
+
+            void addPredecessor(IBlock *block, EdgeType type, Object metaData) override;
+
+            void addRegularPredecessor(IBlock *block) override;
+
+            void addRegularSuccessor(IBlock *block) override;
+
+            void addSuccessor(IBlock *block, EdgeType type, Object metaData) override;
+
+            void onBlockReplaced(IBlock *oldBlock, IBlock *newBlock) override;
+
+            bool containsInstructionNum(int num) override;
+
+            String disassemble(Method *method, bool includeVirtual, bool printInstrIndices) override;
+
+            int getByteCodeInstructionCount(Method *method) override;
+
+            std::set<Edge *> getEdges() override;
+
+            int getFirstByteCodeInstructionNum(Method *method) override;
+
+            int getFirstInstructionNum() override;
+
+            String getId() override;
+
+            int getIndexOfSuperConstructorCall(Method *method) override;
+
+            std::set<int> getInstructionNums() override;
+
+            IBlock *getRegularPredecessor() override;
+
+            int getRegularPredecessorCount() override;
+
+            std::set<IBlock *> getRegularPredecessors() override;
+
+            IBlock *getRegularSuccessor() override;
+
+            int getRegularSuccessorCount() override;
+
+            std::set<IBlock *> getRegularSuccessors() override;
+
+            bool hasRegularPredecessor() override;
+
+            bool hasRegularSuccessor() override;
+
+            bool isVirtual(Method *method) override;
+
+            bool removeRegularSuccessor(IBlock *block) override;
+
+            void setId(String id) override;
+
+            String toSimpleString() override;
+
+            String toString() override;
+
+            /**
+             * Successors of any edge type, exception handlers included.
+             */
+            std::set<BasicBlock *> getAllSuccessors();
+
+            /**
+             * @return the bci after the last instruction of this block
+             */
+            int getEndInstructionNum(Method *method);
+        };
+    }
+}
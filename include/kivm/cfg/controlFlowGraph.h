@@ -0,0 +1,86 @@
+//
+// Control flow graph of a method
+//
+#pragma once
+
+#include <kivm/cfg/basicBlock.h>
+#include <vector>
+
+namespace kivm {
+    namespace instr {
+        /**
+         * Basic blocks of a method and the edges between them.
+         *
+         * Blocks start at branch targets, after branches and returns,
+         * at exception handlers, and at both ends of every try range,
+         * so that a block is either covered by a handler or not at all.
+         * Every block covered by a handler has a CAUGHT_EXCEPTION edge to it.
+         * jsr is treated as a jump, like the interpreter does.
+         */
+        class ControlFlowGraph final {
+        private:
+            Method *_method;
+
+            /**
+             * Sorted by the bci of their first instruction.
+             */
+            std::vector<BasicBlock *> _blocks;
+
+            /**
+             * bci -> index in {@code _blocks} of the block containing it
+             */
+            std::vector<int> _blockIndexes;
+
+            /**
+             * Whether an instruction starts at a bci.
+             */
+            std::vector<bool> _instructionStarts;
+
+        private:
+            void buildBlocks();
+
+            void buildEdges();
+
+        public:
+            explicit ControlFlowGraph(Method *method);
+
+            ~ControlFlowGraph();
+
+            ControlFlowGraph(const ControlFlowGraph &) = delete;
+
+            ControlFlowGraph &operator=(const ControlFlowGraph &) = delete;
+
+            inline Method *getMethod() const {
+                return _method;
+            }
+
+            /**
+             * @return the block at bci 0, {@code nullptr} if the method has no code
+             */
+            inline BasicBlock *getEntryBlock() const {
+                return _blocks.empty() ? nullptr : _blocks.front();
+            }
+
+            inline const std::vector<BasicBlock *> &getBlocks() const {
+                return _blocks;
+            }
+
+            inline bool isInstructionStart(int bci) const {
+                return bci >= 0 && bci < (int) _instructionStarts.size() && _instructionStarts[bci];
+            }
+
+            /**
+             * @return the block containing {@code bci}, or {@code nullptr}
+             */
+            BasicBlock *getBlockAt(int bci) const;
+
+            /**
+             * Blocks reachable from the entry, exception edges included,
+             * each one before its successors except along back edges.
+             */
+            std::vector<BasicBlock *> getReversePostOrder() const;
+
+            String toString();
+        };
+    }
+}
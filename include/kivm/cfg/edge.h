@@ -78,7 +78,7 @@ namespace kivm {
             }
 
             bool isPredecessor(IBlock *block) {
-                return dest = block;
+                return dest == block;
             }
 
             bool hasType(EdgeType type) {
@@ -86,7 +86,11 @@ namespace kivm {
             }
 
             bool equals(Edge *other) {
-                // TODO
+                return other != nullptr
+                       && src == other->src
+                       && dest == other->dest
+                       && type == other->type
+                       && metaData == other->metaData;
             }
         };
     }
@@ -56,6 +56,22 @@
 namespace kivm {
     class InstanceKlass;
 
+    /**
+     * Round {@code size} up to a multiple of {@code alignment},
+     * which must be a power of 2.
+     */
+    inline size_t alignUp(size_t size, size_t alignment) {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    /**
+     * Round {@code size} down to a multiple of {@code alignment},
+     * which must be a power of 2.
+     */
+    inline size_t alignDown(size_t size, size_t alignment) {
+        return size & ~(alignment - 1);
+    }
+
     struct Global {
         static String SLASH;
         static String DOT;
@@ -74,9 +90,16 @@ namespace kivm {
         static InstanceKlass *_ClassNotFoundException;
         static InstanceKlass *_InternalError;
         static InstanceKlass *_IOException;
+        static InstanceKlass *_OutOfMemoryError;
 
         static JavaObject("java/nio/charset/Charset") DEFAULT_UTF8_CHARSET;
 
+        /**
+         * Thrown when the heap is exhausted, created in advance
+         * because there may be no room left for a new one.
+         */
+        static JavaObject("java/lang/OutOfMemoryError") OUT_OF_MEMORY_ERROR;
+
         static bool jvmBooted;
     };
 
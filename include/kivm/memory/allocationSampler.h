@@ -0,0 +1,52 @@
+//
+// Allocation sites sampled on allocation slow paths
+//
+#pragma once
+
+#include <kivm/memory/gcEvent.h>
+#include <atomic>
+
+namespace kivm {
+    class JavaThread;
+
+    /**
+     * Attributes the bytes taken from the heap outside a TLAB fast path,
+     * a TLAB refill or an object allocated directly in the heap,
+     * to the method and pc of the allocating thread.
+     * The TLAB fast path is never sampled, so sites are weighted
+     * by how fast they consume TLABs rather than by exact object sizes.
+     */
+    class AllocationSampler {
+    private:
+        static std::atomic<bool> sEnabled;
+
+    public:
+        /**
+         * Sampling is enabled while any GC listener is registered.
+         */
+        static void setEnabled(bool enabled);
+
+        static inline bool isEnabled() {
+            return sEnabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @param thread the allocating thread, may be {@code nullptr}
+         * @param bytes bytes taken from the heap
+         */
+        static inline void sample(JavaThread *thread, size_t bytes) {
+            if (isEnabled()) {
+                record(thread, bytes);
+            }
+        }
+
+        static void record(JavaThread *thread, size_t bytes);
+
+        /**
+         * Moves the heaviest sites recorded since the last call to {@code sites},
+         * heaviest first, and forgets the others.
+         * @return number of sites stored
+         */
+        static int takeTopSites(AllocationSite *sites, int max);
+    };
+}
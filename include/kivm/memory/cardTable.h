@@ -0,0 +1,96 @@
+//
+// Card table remembering old-to-young references
+//
+#pragma once
+
+#include <kivm/kivm.h>
+
+namespace kivm {
+    /**
+     * One byte per {@code CARD_SIZE} bytes of heap.
+     * A card is dirtied by the write barrier when a reference is stored
+     * into it, so minor collections only need to scan dirty cards of
+     * the old generation to find old-to-young references.
+     *
+     * To scan a card, we must know where objects start. Objects in the
+     * old generation are bump-allocated, so for each card we record
+     * the offset of the first object starting in it.
+     */
+    class CardTable final {
+    public:
+        static constexpr int CARD_SHIFT = 9;
+        static constexpr size_t CARD_SIZE = 1U << CARD_SHIFT;
+
+        static constexpr jbyte CLEAN_CARD = 0;
+        static constexpr jbyte DIRTY_CARD = 1;
+
+    private:
+        static constexpr u1 NO_OBJECT_START = 0xff;
+
+        jbyte *_coveredStart = nullptr;
+        jbyte *_coveredEnd = nullptr;
+        jbyte *_cards = nullptr;
+        u1 *_objectStarts = nullptr;
+
+    public:
+        CardTable() = default;
+
+        ~CardTable();
+
+        void initialize(jbyte *coveredStart, size_t coveredSize);
+
+        inline bool isCovered(const void *address) const {
+            return address >= _coveredStart && address < _coveredEnd;
+        }
+
+        inline size_t getCardIndex(const void *address) const {
+            return (size_t) (((jbyte *) address) - _coveredStart) >> CARD_SHIFT;
+        }
+
+        inline jbyte *getCardStart(size_t cardIndex) const {
+            return _coveredStart + (cardIndex << CARD_SHIFT);
+        }
+
+        inline void markCard(const void *address) {
+            if (isCovered(address)) {
+                _cards[getCardIndex(address)] = DIRTY_CARD;
+            }
+        }
+
+        void markCards(const void *start, size_t size);
+
+        inline bool isDirty(size_t cardIndex) const {
+            return _cards[cardIndex] != CLEAN_CARD;
+        }
+
+        inline void cleanCard(size_t cardIndex) {
+            _cards[cardIndex] = CLEAN_CARD;
+        }
+
+        /**
+         * Clean cards and forget object starts in {@code [start, start + size)}.
+         */
+        void reset(const void *start, size_t size);
+
+        /**
+         * Must be called for every object allocated in the old generation.
+         * Objects should be aligned to 8 bytes.
+         */
+        inline void recordObjectStart(const void *object) {
+            size_t cardIndex = getCardIndex(object);
+            if (_objectStarts[cardIndex] == NO_OBJECT_START) {
+                _objectStarts[cardIndex] = (u1) ((((jbyte *) object) - getCardStart(cardIndex))
+                                                 / sizeof(jlong));
+            }
+        }
+
+        /**
+         * Find the nearest recorded object that starts at or before the card start.
+         * Walking forward from it reaches the object covering the card start.
+         * @param cardIndex card to search
+         * @param spaceStart the first object of the space the card belongs to
+         * @return start address of the object
+         */
+        jbyte *findObjectStart(size_t cardIndex, jbyte *spaceStart) const;
+    };
+}
@@ -4,11 +4,107 @@
 #pragma once
 
 #include <kivm/kivm.h>
+#include <kivm/memory/cardTable.h>
+#include <kivm/memory/gcEvent.h>
+#include <kivm/memory/satbMarkQueue.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 namespace kivm {
+    class JavaThread;
+
+    struct HeapRegion;
+
+    class ReferenceProcessor;
+
     class CollectedHeap {
+    protected:
+        /**
+         * A heap grows when a full collection leaves it more than
+         * {@code GROW_OCCUPANCY} percent occupied, and shrinks after
+         * {@code SHRINK_DELAY} full collections in a row leaving it
+         * less than {@code SHRINK_OCCUPANCY} percent occupied.
+         */
+        static constexpr int GROW_OCCUPANCY = 70;
+        static constexpr int SHRINK_OCCUPANCY = 30;
+        static constexpr int SHRINK_DELAY = 3;
+
+    private:
+        std::chrono::steady_clock::time_point _createdAt = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point _pauseStartedAt;
+        size_t _collections = 0;
+
+        /**
+         * Time the pending GC request waited for threads to stop.
+         */
+        std::chrono::microseconds _timeToSafepoint{0};
+
+        /**
+         * Set by {@code collectClearingSoftReferences()} for the next collection.
+         */
+        std::atomic<bool> _clearAllSoftReferences{false};
+
+    protected:
+        ReferenceProcessor *_referenceProcessor;
+
+    protected:
+        /**
+         * Number the collection, start timing its roots,
+         * and send {@code GC_PAUSE_START} to GC listeners.
+         * @param collection kind of collection, see {@code GCEvent::_collection}
+         */
+        GCEvent beginPause(const char *collection, size_t usedBefore);
+
+        /**
+         * Send {@code GC_PAUSE_END} to GC listeners.
+         * @param event returned by {@code beginPause()}
+         */
+        void endPause(GCEvent &event, size_t usedAfter, size_t objectsCopied);
+
+        /**
+         * Wait for a collection triggered by current thread.
+         * @return false if there is no GC thread to run it
+         */
+        static bool collectAndWait(JavaThread *thread);
+
+        /**
+         * Like {@code collectAndWait()}, but the collection clears every soft
+         * reference. It is the last try before throwing OutOfMemoryError.
+         */
+        bool collectClearingSoftReferences(JavaThread *thread);
+
+        /**
+         * Start discovering references, called at the start of a pause.
+         * @param usedBefore used bytes of the heap at the start of the pause
+         * @param wholeHeap whether the pause collects the whole heap,
+         *                  only those clear all soft references on request
+         */
+        void beginReferenceDiscovery(size_t usedBefore, bool wholeHeap);
+
+        /**
+         * Request a heap dump if {@code RuntimeConfig::heapDumpOnOutOfMemory} is set.
+         */
+        static void dumpHeapOnOutOfMemory();
+
+        /**
+         * Throw the preallocated {@code OutOfMemoryError} to current thread.
+         * Panics if there is no Java code to receive it.
+         * @param size size of the allocation that cannot be satisfied
+         * @return {@code nullptr}, as the result of the failed allocation
+         */
+        static void *throwOutOfMemoryError(size_t size);
+
+        /**
+         * Visit objects between the start and the top of {@code region},
+         * skipping fillers. Allocation buffers in it must be retired.
+         */
+        static void walkRegion(const HeapRegion *region, const std::function<void(oop)> &callback);
+
     public:
-        virtual ~CollectedHeap() = default;
+        CollectedHeap();
+
+        virtual ~CollectedHeap();
 
         virtual void *allocate(size_t size) = 0;
 
@@ -23,5 +119,37 @@ namespace kivm {
         virtual bool isHeapObject(void *addr) = 0;
 
         virtual void doGarbageCollection() = 0;
+
+        /**
+         * Visit every object in the heap, unreachable ones included
+         * unless a collection has just run.
+         * Must be called while Java threads are stopped.
+         */
+        virtual void objectIterate(const std::function<void(oop)> &callback) = 0;
+
+        /**
+         * Called by GCThread before {@code doGarbageCollection()},
+         * reported with the pause.
+         */
+        inline void setTimeToSafepoint(std::chrono::microseconds timeToSafepoint) {
+            _timeToSafepoint = timeToSafepoint;
+        }
+
+        /**
+         * @return the card table used by write barriers,
+         *         or {@code nullptr} if no barrier is needed
+         */
+        virtual CardTable *getCardTable() {
+            return nullptr;
+        }
+
+        /**
+         * @return the queues filled by pre-write barriers while
+         *         marking concurrently, or {@code nullptr} if no
+         *         pre-write barrier is needed
+         */
+        virtual SatbMarkQueueSet *getSatbMarkQueueSet() {
+            return nullptr;
+        }
     };
 }
@@ -0,0 +1,462 @@
+//
+// Mostly-concurrent mark-sweep heap
+//
+#pragma once
+
+#include <kivm/memory/collectedHeap.h>
+#include <kivm/memory/heapRegion.h>
+#include <kivm/memory/gcRoots.h>
+#include <kivm/memory/gcTaskQueue.h>
+#include <kivm/memory/gcWorkerPool.h>
+#include <kivm/memory/oopClosure.h>
+#include <kivm/memory/satbMarkQueue.h>
+#include <kivm/memory/threadLocalAllocBuffer.h>
+#include <shared/lock.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace kivm {
+    class ConcurrentMarkSweepHeap;
+
+    class ConcurrentMarkThread;
+
+    /**
+     * Per-worker state of marking, in pauses and concurrently.
+     * As a closure, it marks the object referenced by a slot.
+     */
+    struct ConcurrentMarkingWorker final : public OopClosure {
+        ConcurrentMarkSweepHeap *_heap;
+        int _workerId;
+
+        /**
+         * Marked objects whose fields are not scanned yet.
+         * Kept between marking steps of a cycle.
+         */
+        GCTaskQueue _queue;
+
+        size_t _markedObjects = 0;
+
+        ConcurrentMarkingWorker(ConcurrentMarkSweepHeap *heap, int workerId)
+            : _heap(heap), _workerId(workerId) {
+        }
+
+        void doOop(oop *slot) override;
+    };
+
+    /**
+     * A mostly-concurrent mark-sweep heap.
+     *
+     * Objects never move. They live in a single space, allocated through
+     * TLABs from a free list of swept chunks, or by bumping the top of the
+     * space. A concurrent cycle starts when the space gets
+     * {@code INITIATING_OCCUPANCY} percent occupied:
+     *
+     *   1. initial mark, a pause: mark objects referenced by roots
+     *   2. concurrent mark: trace the object graph on GC workers,
+     *      while Java threads keep running
+     *   3. remark, a pause: trace what pre-write barriers logged
+     *   4. concurrent sweep: turn dead runs into free chunks,
+     *      while Java threads allocate from chunks already swept
+     *
+     * Marking is snapshot-at-the-beginning: from the initial mark until the
+     * remark, {@code Universe::preWriteBarrier()} logs every reference
+     * about to be overwritten, and new objects are allocated marked. So
+     * both pauses are short, stacks are never scanned again, and objects
+     * dying during a cycle are only freed by the next one.
+     *
+     * When an allocation cannot be satisfied, the cycle in progress is
+     * given up, and the whole heap is marked and swept in a single pause.
+     * Address space for the maximum heap size is reserved up front, the
+     * committed part grows by occupancy after cycles, and may only shrink
+     * in these pauses.
+     *
+     * Only these pauses clear soft, weak and phantom references. Concurrent
+     * cycles treat referents as strong: {@code Reference.get()} has no
+     * barrier, so a referent read while marking could be freed by the sweep.
+     */
+    class ConcurrentMarkSweepHeap : public CollectedHeap {
+        friend struct ConcurrentMarkingWorker;
+        friend class ConcurrentMarkThread;
+
+    private:
+        /**
+         * Occupancy in percent of the committed space
+         * at which a concurrent cycle is started.
+         */
+        static constexpr int INITIATING_OCCUPANCY = 45;
+
+        /**
+         * Dead runs smaller than it are left as fillers until
+         * their neighbours die too.
+         */
+        static constexpr size_t MIN_FREE_CHUNK = 128;
+
+        /**
+         * Blocks the sweeper walks between checks for a yield request.
+         */
+        static constexpr size_t SWEEP_YIELD_INTERVAL = 1024;
+
+        enum CyclePhase {
+            CYCLE_IDLE,
+            CYCLE_MARKING,
+            CYCLE_SWEEPING,
+        };
+
+        jbyte *_memoryStart = nullptr;
+        size_t _initialSize;
+        size_t _maxSize;
+        size_t _reservedSize = 0;
+
+        /**
+         * The whole heap, its size is the committed size.
+         * The current pointer is the top of the space, never used above.
+         */
+        HeapRegion _space;
+
+        /**
+         * One bit for every heap word, set at object starts.
+         */
+        u8 *_markBits = nullptr;
+        size_t _markBitsReservedSize = 0;
+
+        size_t _tlabSize;
+
+        /**
+         * Start of free chunks by their size, each one is a filler.
+         * Guarded by {@code _freeListLock}, Java threads waiting for the
+         * sweeper sleep on {@code _freeListCond}.
+         */
+        std::multimap<size_t, jbyte *> _freeChunks;
+        size_t _freeBytes = 0;
+        Lock _freeListLock;
+        std::condition_variable _freeListCond;
+
+        GCWorkerPool *_workerPool = nullptr;
+        std::vector<ConcurrentMarkingWorker *> _workers;
+        GCTaskQueueSet _queueSet;
+
+        std::vector<GCRoots::Task> _rootTasks;
+        std::atomic<size_t> _nextRootTask;
+
+        SatbMarkQueueSet _satbQueueSet;
+
+        /**
+         * Set from the initial mark until the remark,
+         * objects are marked when they are allocated.
+         */
+        std::atomic<bool> _allocateBlack;
+
+        std::atomic<CyclePhase> _phase;
+
+        /**
+         * Set when a collection in a pause gives up the cycle in progress.
+         */
+        std::atomic<bool> _cycleAborted;
+
+        /**
+         * Top of the space at the remark, the sweeper stops there.
+         */
+        jbyte *_sweepTop = nullptr;
+
+        /**
+         * Held through a whole cycle, one cycle runs at a time.
+         */
+        Lock _cycleLock;
+
+        /**
+         * Concurrent phases yield to pauses that touch the heap,
+         * like collections and heap dumps. Guarded by {@code _suspendLock}.
+         */
+        std::atomic<bool> _suspendRequested;
+        bool _concurrentWorkActive = false;
+        Lock _suspendLock;
+        std::condition_variable _suspendCond;
+
+        /**
+         * Set by a GC worker which gave up a marking step to yield.
+         */
+        std::atomic<bool> _markingInterrupted;
+
+        /**
+         * Runs cycles when they are requested, started
+         * on the first request. Guarded by {@code _markThreadLock}.
+         */
+        ConcurrentMarkThread *_markThread = nullptr;
+        std::atomic<bool> _cycleRequested;
+        bool _markThreadStopped = false;
+        Lock _markThreadLock;
+        std::condition_variable _markThreadCond;
+
+        size_t _markedObjects = 0;
+        size_t _concurrentCycles = 0;
+
+        /**
+         * Size of the allocation waiting for a collection.
+         */
+        size_t _requiredSize = 0;
+
+        /**
+         * Collections in a row that left the heap mostly empty.
+         */
+        int _lowOccupancyCollections = 0;
+
+    private:
+        void initializeSpace();
+
+        /**
+         * Commit or uncommit the tail of the space.
+         * @return false if more memory cannot be committed
+         */
+        bool resizeSpace(size_t newSize);
+
+        /**
+         * Grow or shrink the space by its occupancy,
+         * called after a collection in a pause.
+         */
+        void adjustSpace();
+
+        /**
+         * Grow the space by its occupancy,
+         * called after a concurrent cycle.
+         */
+        void growSpaceIfNeeded();
+
+        /**
+         * Allocate through the TLAB of {@code thread} if possible.
+         * @return {@code nullptr} if there is no free chunk large enough
+         *         and the space is full
+         */
+        void *allocateInSpace(JavaThread *thread, size_t size);
+
+        /**
+         * Allocate from the free list or from the top of the space.
+         */
+        void *allocateShared(size_t size);
+
+        /**
+         * Take a free chunk of at least {@code minSize} bytes, split down
+         * to {@code maxSize} bytes if it is much larger. Chunks that can
+         * hold {@code maxSize} bytes are preferred.
+         * @return false if no chunk is large enough
+         */
+        bool takeFreeChunk(size_t minSize, size_t maxSize, jbyte *&chunk, size_t &chunkSize);
+
+        /**
+         * Must be called inside {@code _freeListLock}.
+         */
+        void addFreeChunkLocked(jbyte *start, size_t size);
+
+        /**
+         * Wait until the sweeper frees a chunk that may fit {@code size}
+         * bytes and allocate in it, polling for safepoints meanwhile.
+         * @return {@code nullptr} if the sweep is over
+         */
+        void *waitForSweep(JavaThread *thread, size_t size);
+
+        /**
+         * Cover free parts of all TLABs with fillers and give them back,
+         * so that the space can be walked object by object.
+         */
+        void retireTlabs();
+
+        /**
+         * Start a concurrent cycle if the occupancy is high enough,
+         * on the background thread.
+         */
+        void startCycleIfNeeded();
+
+        /**
+         * Run {@code operation} while Java threads are stopped.
+         * @return false if it was not run, the VM is exiting
+         */
+        bool runPause(const std::function<void()> &operation);
+
+        /**
+         * Body of {@code ConcurrentMarkThread}.
+         */
+        void markThreadLoop();
+
+        void stopMarkThread();
+
+        /**
+         * Called by the background thread before a concurrent phase,
+         * waits for a suspension in progress.
+         */
+        void beginConcurrentWork();
+
+        void endConcurrentWork();
+
+        /**
+         * Called in a concurrent phase, waits while it is suspended.
+         * @return false if the cycle was given up meanwhile
+         */
+        bool yieldConcurrentWork();
+
+        inline bool shouldYield() const {
+            return _suspendRequested.load(std::memory_order_relaxed)
+                   || _cycleAborted.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Called in a pause, waits until the concurrent phase
+         * in progress yields, and keeps it from running.
+         */
+        void suspendConcurrentWork();
+
+        void resumeConcurrentWork();
+
+        /**
+         * Give up the cycle in progress.
+         * Must be called while concurrent work is suspended.
+         */
+        void abortCycle();
+
+        inline size_t getBitIndex(const void *addr) const {
+            return ((jbyte *) addr - _memoryStart) / sizeof(jlong);
+        }
+
+        inline bool isMarked(const void *addr) const {
+            size_t index = getBitIndex(addr);
+            return (_markBits[index / 64] & (1ULL << (index % 64))) != 0;
+        }
+
+        /**
+         * Set the mark bit of an object.
+         * @return false if it was already marked
+         */
+        bool tryMark(const void *addr);
+
+        /**
+         * Clear mark bits of {@code [start of the space, top)}.
+         */
+        void clearMarkBits(jbyte *top);
+
+        /**
+         * Mark an object, and queue it for scanning if it was not marked.
+         */
+        void markObject(ConcurrentMarkingWorker *worker, oop object);
+
+        /**
+         * Body of a GC worker: claim root tasks, then drain queues.
+         * In a concurrent step, it gives up when it should yield.
+         */
+        void workOn(ConcurrentMarkingWorker *worker, bool concurrent);
+
+        /**
+         * Mark references logged by pre-write barriers,
+         * and spread them over the queues of GC workers.
+         */
+        void markSatbBuffers();
+
+        /**
+         * Run root tasks and drain all queues on GC workers.
+         */
+        void runMarking(bool concurrent);
+
+        /**
+         * Clear references whose referents were not marked,
+         * must be called right after marking in a full pause.
+         * @return number of references cleared
+         */
+        size_t processReferences();
+
+        /**
+         * Free dead runs below {@code top}, with the monitors of dead
+         * objects. In a concurrent phase, Java threads allocate
+         * from chunks freed behind the sweeper.
+         * @return false if a concurrent sweep was given up
+         */
+        bool sweep(jbyte *top, bool concurrent);
+
+        /**
+         * Cover a dead run with a filler,
+         * and give it to the free list if it is large enough.
+         */
+        void freeRun(jbyte *start, size_t size);
+
+        size_t collectMarkedObjects();
+
+    public:
+        ConcurrentMarkSweepHeap();
+
+        ~ConcurrentMarkSweepHeap() override;
+
+        void *allocate(size_t size) override;
+
+        void initializeAll() override;
+
+        /**
+         * Give up the concurrent cycle in progress, then mark
+         * and sweep the whole heap in a single pause.
+         */
+        void doGarbageCollection() override;
+
+        /**
+         * Run a whole concurrent cycle on the calling thread, which must not
+         * be a Java thread. Pauses are run by the GC thread if there is one,
+         * on the calling thread otherwise.
+         */
+        void collectConcurrently();
+
+        /**
+         * Phases of a concurrent cycle, in the order
+         * {@code collectConcurrently()} runs them. A phase does nothing
+         * if the cycle was given up. {@code initialMark()} and
+         * {@code remark()} must be called while Java threads are stopped.
+         */
+        void initialMark();
+
+        /**
+         * @return false if the cycle was given up
+         */
+        bool concurrentMark();
+
+        void remark();
+
+        /**
+         * @return false if the cycle was given up
+         */
+        bool concurrentSweep();
+
+        void objectIterate(const std::function<void(oop)> &callback) override;
+
+        SatbMarkQueueSet *getSatbMarkQueueSet() override {
+            return &_satbQueueSet;
+        }
+
+        inline void *getHeapStart() override {
+            return _memoryStart;
+        }
+
+        inline void *getHeapEnd() override {
+            return _memoryStart + _reservedSize;
+        }
+
+        inline size_t getHeapSize() override {
+            return _space.getSize();
+        }
+
+        /**
+         * Bytes below the top of the space not in free chunks,
+         * unused parts of TLABs included.
+         */
+        inline size_t getHeapUsed() const {
+            return _space.getUsed() - _freeBytes;
+        }
+
+        inline bool isHeapObject(void *addr) override {
+            return addr >= getHeapStart() && addr < getHeapEnd();
+        }
+
+        inline size_t getConcurrentCycles() const {
+            return _concurrentCycles;
+        }
+
+        inline bool isMarkingActive() const {
+            return _phase.load() == CYCLE_MARKING;
+        }
+    };
+}
@@ -6,28 +6,319 @@
 #include <kivm/oop/klass.h>
 #include <kivm/memory/collectedHeap.h>
 #include <kivm/memory/heapRegion.h>
-#include <shared/hashMap.h>
-#include <kivm/runtime/stack.h>
+#include <kivm/memory/largeObjectSpace.h>
+#include <kivm/memory/cardTable.h>
+#include <kivm/memory/gcTaskQueue.h>
+#include <kivm/memory/gcWorkerPool.h>
+#include <kivm/memory/oopClosure.h>
+#include <kivm/memory/threadLocalAllocBuffer.h>
+#include <shared/lock.h>
+#include <functional>
+#include <vector>
 
 namespace kivm {
+    class CopyingHeap;
+
+    /**
+     * Per-worker state of a parallel copying collection.
+     * As a closure, it copies the object referenced by a root.
+     */
+    struct CopyingWorker final : public OopClosure {
+        CopyingHeap *_heap;
+        int _workerId;
+
+        /**
+         * Copied objects whose fields are not scanned yet.
+         */
+        GCTaskQueue _queue;
+
+        /**
+         * Promotion buffers, so that workers do not
+         * contend on the region top for every copy.
+         */
+        ThreadLocalAllocBuffer _survivorBuffer;
+        ThreadLocalAllocBuffer _oldBuffer;
+
+        size_t _copiedObjects = 0;
+
+        CopyingWorker(CopyingHeap *heap, int workerId)
+            : _heap(heap), _workerId(workerId) {
+        }
+
+        void doOop(oop *slot) override;
+    };
+
+    /**
+     * A generational copying heap.
+     *
+     * New objects are bump-allocated in eden. A minor collection copies
+     * live young objects into the empty survivor space, or promotes them
+     * into the old generation if they have already survived once.
+     * Old-to-young references are found through the card table.
+     *
+     * A full collection copies everything live into the other old
+     * semispace, it runs when the old generation cannot take
+     * the worst-case promotion of a minor collection.
+     *
+     * Both collections run on a pool of GC workers. Roots are split into
+     * tasks claimed by workers, copied objects are scanned from per-worker
+     * deques, and idle workers steal from others.
+     *
+     * Objects not smaller than {@code RuntimeConfig::largeObjectThresholdInBytes}
+     * are allocated in a large object space, where they never move.
+     * Full collections mark them instead of copying them, minor collections
+     * scan their dirty cards like those of the old generation.
+     *
+     * Address space for the maximum heap size is reserved up front,
+     * but the old semispaces only commit what they need. They grow
+     * after full collections that leave them crowded, and shrink
+     * after several full collections that leave them mostly empty.
+     */
     class CopyingHeap : public CollectedHeap {
+        friend struct CopyingWorker;
+
     private:
         jbyte *_memoryStart = nullptr;
-        size_t _totalSize;
+        size_t _initialSize;
+        size_t _maxSize;
+
+        /**
+         * Committed size of all regions.
+         */
+        size_t _totalSize = 0;
+        size_t _reservedSize = 0;
+
+        /**
+         * Committed size of each old semispace never goes below
+         * {@code _oldInitialSize} or above {@code _oldReservedSize}.
+         */
+        size_t _oldInitialSize = 0;
+        size_t _oldReservedSize = 0;
+
         HeapRegion *_regions = nullptr;
-        HeapRegion *_currentRegion = nullptr;
-        HeapRegion *_nextRegion = nullptr;
+
+        HeapRegion *_eden = nullptr;
+        HeapRegion *_survivorFrom = nullptr;
+        HeapRegion *_survivorTo = nullptr;
+        HeapRegion *_oldFrom = nullptr;
+        HeapRegion *_oldTo = nullptr;
+
+        LargeObjectSpace _largeObjects;
+
+        CardTable _cardTable;
+
+        /**
+         * Objects not smaller than this are allocated in the old generation.
+         */
+        size_t _pretenureThreshold = 0;
+
+        /**
+         * Objects not smaller than this are allocated in {@code _largeObjects}.
+         */
+        size_t _largeObjectThreshold;
+
+        size_t _tlabSize;
+
+        /**
+         * Guards mutator allocation in the old generation.
+         */
+        Lock _oldLock;
+
+        bool _fullCollectionRequired = false;
+        bool _fullCollection = false;
+        size_t _copiedObjects = 0;
+
+        GCWorkerPool *_workerPool = nullptr;
+        std::vector<CopyingWorker *> _workers;
+        GCTaskQueueSet _queueSet;
+
+        /**
+         * Where promoted objects go in current collection.
+         */
+        HeapRegion *_oldTarget = nullptr;
+
+        using RootTask = std::function<void(CopyingWorker *)>;
+        std::vector<RootTask> _rootTasks;
+        std::atomic<size_t> _nextRootTask;
+
+        /**
+         * Size of the old allocation waiting for a full collection.
+         */
+        size_t _requiredOldSize = 0;
+
+        /**
+         * Full collections in a row that left the old generation mostly empty.
+         */
+        int _lowOccupancyCollections = 0;
+
+        /**
+         * Set when the old generation, even at its maximum size, cannot take
+         * the worst-case promotion of the next minor collection.
+         * Allocations that require a collection fail with OutOfMemoryError then.
+         */
+        bool _heapExhausted = false;
+
+        /**
+         * What a full collection can copy at most: the old to-space
+         * at its maximum size and the survivor to-space, less what
+         * promotion buffers leave unused.
+         */
+        size_t _fullCollectionRoom = 0;
 
     private:
         void initializeRegions();
 
-        void copyObject(HeapRegion *newRegion, HashMap<oop, oop> &map, oop &target);
+        /**
+         * Commit or uncommit the tail of both old semispaces.
+         * @return false if more memory cannot be committed
+         */
+        bool resizeOldGeneration(size_t newSize);
+
+        /**
+         * Make sure the old to-space can take everything live,
+         * called before a full collection.
+         */
+        void expandForFullCollection();
+
+        /**
+         * Grow or shrink the old generation by its occupancy,
+         * called after a full collection.
+         */
+        void adjustOldGeneration();
+
+        /**
+         * Allocate in eden, through the TLAB of {@code thread} if possible.
+         * @return {@code nullptr} if eden is full
+         */
+        void *allocateYoung(JavaThread *thread, size_t size);
 
-        void copyClass(HeapRegion *newRegion, HashMap<oop, oop> &map, Klass *klass);
+        /**
+         * Allocate in eden directly, {@code nullptr} if eden is full
+         * or the next full collection could not copy the object.
+         */
+        void *allocateEden(size_t size);
 
-        void copyThread(HeapRegion *newRegion, HashMap<oop, oop> &map, JavaThread *thread);
+        /**
+         * Everything in eden and the old generation may be live,
+         * so {@code size} more bytes must still fit in a full collection.
+         * Without this check, allocations after an OutOfMemoryError
+         * would fill eden until the next collection overflows.
+         */
+        inline bool fitsFullCollection(size_t size) const {
+            return _eden->getUsed() + _survivorFrom->getUsed() + _oldFrom->getUsed() + size
+                   <= _fullCollectionRoom;
+        }
+
+        void *allocateOld(size_t size);
+
+        void *allocateLarge(size_t size);
+
+        /**
+         * Large objects may take what the regions have not committed.
+         */
+        inline size_t getLargeObjectLimit() const {
+            return _maxSize > _totalSize ? _maxSize - _totalSize : 0;
+        }
+
+        /**
+         * Give back TLABs of all threads, must be called when eden is reset.
+         */
+        void retireTlabs();
+
+        inline bool isYoung(const void *addr) const {
+            return _eden->contains(addr)
+                   || _survivorFrom->contains(addr)
+                   || _survivorTo->contains(addr);
+        }
+
+        /**
+         * Large objects count as old, they are never collected by minor collections.
+         */
+        inline bool isOld(const void *addr) const {
+            return _oldFrom->contains(addr) || _oldTo->contains(addr)
+                   || _largeObjects.contains(addr);
+        }
+
+        inline bool shouldCopy(const void *addr) const {
+            return _eden->contains(addr)
+                   || _survivorFrom->contains(addr)
+                   || (_fullCollection && _oldFrom->contains(addr));
+        }
+
+        /**
+         * Allocate room for a surviving object in to-space.
+         */
+        void *allocateCopy(CopyingWorker *worker, oop object, size_t size);
+
+        void *allocateCopyIn(CopyingWorker *worker, HeapRegion *region, size_t size);
+
+        /**
+         * Give back the unused part of a promotion buffer, or fill it.
+         */
+        void retireBuffer(ThreadLocalAllocBuffer &buffer, HeapRegion *region, bool giveBack);
+
+        /**
+         * Copy an object into to-space if it has not been copied yet,
+         * and update the reference to point to the new copy.
+         * The new copy is queued for {@code scanObject()}.
+         */
+        void copyObject(CopyingWorker *worker, oop &target);
 
-        void copySlotArray(HeapRegion *newRegion, HashMap<oop, oop> &map, SlotArray *slotArray, int size);
+        /**
+         * Copy the object referenced by a heap slot,
+         * and remember the slot if it is an old-to-young reference.
+         */
+        void copyField(CopyingWorker *worker, oop *slot);
+
+        /**
+         * Copy all objects directly referenced by an object,
+         * only slots within {@code [from, to)} are visited.
+         */
+        void scanObject(CopyingWorker *worker, oop object, jbyte *from, jbyte *to);
+
+        /**
+         * Treat references from dirty cards of old objects as roots.
+         * @param scanEnd old objects after this address were promoted
+         *                during current collection, and will be scanned anyway
+         */
+        void scanDirtyCards(CopyingWorker *worker, size_t firstCard, size_t lastCard, jbyte *scanEnd);
+
+        /**
+         * Treat references from dirty cards of a large object chunk as roots.
+         */
+        void scanLargeObjectCards(CopyingWorker *worker, jbyte *chunk, size_t size);
+
+        /**
+         * Clear references whose referents were not copied or marked,
+         * must be called right after {@code evacuate()}.
+         * @return number of references cleared
+         */
+        size_t processReferences();
+
+        /**
+         * Free monitors of young objects that died in a minor collection.
+         * @param youngOwners taken from {@code MonitorTable} before evacuation
+         * @return number of monitors freed
+         */
+        size_t freeYoungMonitors(const std::vector<std::pair<u4, markOop>> &youngOwners);
+
+        /**
+         * Split roots into tasks that can be claimed by workers.
+         * @param scanEnd end of old objects whose dirty cards should be scanned,
+         *                or {@code nullptr} in a full collection
+         */
+        void prepareRootTasks(jbyte *scanEnd);
+
+        /**
+         * Run root tasks and scan everything reachable from them on all workers.
+         * @param oldTarget where promoted objects go
+         */
+        void evacuate(HeapRegion *oldTarget);
+
+        /**
+         * Body of a GC worker: claim root tasks, then drain queues.
+         */
+        void workOn(CopyingWorker *worker);
 
     public:
         CopyingHeap();
@@ -38,18 +329,42 @@ namespace kivm {
 
         void initializeAll() override;
 
+        /**
+         * Run a minor collection, or a full collection
+         * if the old generation is running out of space.
+         */
         void doGarbageCollection() override;
 
+        /**
+         * Collect eden and survivor space only.
+         */
+        void doMinorCollection();
+
+        /**
+         * Collect the whole heap.
+         */
+        void doFullCollection();
+
+        void objectIterate(const std::function<void(oop)> &callback) override;
+
+        inline CardTable *getCardTable() override {
+            return &_cardTable;
+        }
+
         inline void *getHeapStart() override {
             return _memoryStart;
         }
 
         inline void *getHeapEnd() override {
-            return _memoryStart + getHeapSize();
+            return _memoryStart + _reservedSize;
         }
 
         inline size_t getHeapSize() override {
-            return _totalSize;
+            return _totalSize + _largeObjects.getUsed();
+        }
+
+        inline const LargeObjectSpace &getLargeObjectSpace() const {
+            return _largeObjects;
         }
 
         inline bool isHeapObject(void *addr) override {
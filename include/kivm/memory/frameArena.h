@@ -0,0 +1,99 @@
+//
+// Per-thread arena for objects that never escape their frame
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <kivm/oop/oopfwd.h>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace kivm {
+    /**
+     * Memory for objects that never escape the frame allocating them,
+     * owned by a single JavaThread.
+     *
+     * Allocation is a pointer bump like a TLAB. Frames take a mark when they
+     * are entered and release back to it when they return, so objects of
+     * a frame are freed at once, without the GC. The GC never moves or
+     * frees them, but fields of live ones are roots, see {@code GCRoots}.
+     *
+     * Memory is taken in chunks, which are kept for later frames.
+     */
+    class FrameArena final {
+    public:
+        static constexpr size_t CHUNK_SIZE = SIZE_KB(64);
+
+        struct Mark {
+            size_t _chunk;
+            jbyte *_top;
+        };
+
+    private:
+        struct Chunk {
+            jbyte *_start;
+            jbyte *_end;
+
+            /**
+             * Where allocation stopped when moving to the next chunk.
+             */
+            jbyte *_top;
+        };
+
+        std::vector<Chunk> _chunks;
+        size_t _current = 0;
+        jbyte *_top = nullptr;
+        jbyte *_end = nullptr;
+
+    private:
+        void *allocateSlow(size_t size);
+
+    public:
+        FrameArena() = default;
+
+        ~FrameArena();
+
+        FrameArena(const FrameArena &) = delete;
+
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        inline Mark mark() const {
+            return Mark{_current, _top};
+        }
+
+        /**
+         * Free everything allocated since {@code mark} was taken.
+         */
+        inline void release(const Mark &mark) {
+            _current = mark._chunk;
+            _top = mark._top;
+            _end = _top == nullptr ? nullptr : _chunks[_current]._end;
+        }
+
+        /**
+         * @return zeroed memory aligned to 8 bytes, or {@code nullptr}
+         *         if the arena is full, then the caller allocates in the heap
+         */
+        inline void *allocate(size_t size) {
+            size = alignUp(size, sizeof(jlong));
+            if (_top != nullptr && size <= (size_t) (_end - _top)) {
+                jbyte *m = _top;
+                _top += size;
+                memset(m, 0, size);
+                return m;
+            }
+            return allocateSlow(size);
+        }
+
+        bool contains(void *addr) const;
+
+        size_t getUsed() const;
+
+        /**
+         * Visit objects in allocation order. Only used at safepoints,
+         * or by the owner thread itself.
+         */
+        void objectIterate(const std::function<void(oop)> &callback) const;
+    };
+}
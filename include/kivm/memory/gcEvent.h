@@ -0,0 +1,126 @@
+//
+// GC pause events
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <chrono>
+
+namespace kivm {
+    class Method;
+
+    /**
+     * Kinds of roots, timed separately during a pause.
+     */
+    enum GCRootCategory {
+        ROOTS_GLOBALS,
+        ROOTS_INTERN_STRINGS,
+        ROOTS_CLASSES,
+        ROOTS_THREADS,
+        ROOTS_DIRTY_CARDS,
+        ROOT_CATEGORY_COUNT,
+    };
+
+    enum GCEventType {
+        GC_PAUSE_START,
+        GC_PAUSE_END,
+    };
+
+    /**
+     * Bytes a method took from the heap on allocation slow paths,
+     * see {@code AllocationSampler}.
+     */
+    struct AllocationSite {
+        Method *_method = nullptr;
+
+        /**
+         * The thread's pc in the method, at or just after the allocating instruction.
+         */
+        u4 _pc = 0;
+
+        size_t _bytes = 0;
+        size_t _samples = 0;
+    };
+
+    static constexpr int MAX_ALLOCATION_SITES = 8;
+
+    /**
+     * What a heap reports about a collection pause.
+     * Fields only known after the pause are 0 in {@code GC_PAUSE_START}.
+     */
+    struct GCEvent {
+        GCEventType _type;
+
+        /**
+         * Collections of a heap are numbered from 1.
+         */
+        size_t _id = 0;
+
+        /**
+         * "minor", "full", "mark-compact", "mark-sweep",
+         * or a pause of a concurrent cycle, "initial-mark" or "remark"
+         */
+        const char *_collection = nullptr;
+
+        /**
+         * Time since the heap was created, at the start of the pause.
+         */
+        std::chrono::microseconds _uptime{0};
+
+        /**
+         * Time from the GC request until all threads stopped,
+         * 0 if the collection was not requested through GCThread.
+         */
+        std::chrono::microseconds _timeToSafepoint{0};
+
+        std::chrono::microseconds _pauseTime{0};
+
+        size_t _usedBefore = 0;
+        size_t _usedAfter = 0;
+        size_t _heapSize = 0;
+
+        /**
+         * Live objects copied or slid by the collection.
+         */
+        size_t _objectsCopied = 0;
+
+        /**
+         * Summed over GC workers, so it may exceed the pause time.
+         */
+        std::chrono::microseconds _rootScanTime[ROOT_CATEGORY_COUNT] = {};
+
+        /**
+         * Heaviest allocation sites since the previous pause, heaviest first.
+         */
+        AllocationSite _allocationSites[MAX_ALLOCATION_SITES] = {};
+        int _allocationSiteCount = 0;
+
+        static inline const char *getRootCategoryName(GCRootCategory category) {
+            switch (category) {
+                case ROOTS_GLOBALS:
+                    return "globals";
+                case ROOTS_INTERN_STRINGS:
+                    return "intern_strings";
+                case ROOTS_CLASSES:
+                    return "classes";
+                case ROOTS_THREADS:
+                    return "threads";
+                case ROOTS_DIRTY_CARDS:
+                    return "dirty_cards";
+                default:
+                    SHOULD_NOT_REACH_HERE();
+            }
+        }
+    };
+
+    /**
+     * Receives GC events on the GC thread, while Java threads are stopped.
+     * Listeners must not allocate in the Java heap.
+     */
+    class GCListener {
+    public:
+        virtual ~GCListener() = default;
+
+        virtual void onGCEvent(const GCEvent &event) = 0;
+    };
+}
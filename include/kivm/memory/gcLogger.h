@@ -0,0 +1,34 @@
+//
+// JSON lines logger of GC events
+//
+#pragma once
+
+#include <kivm/memory/gcEvent.h>
+#include <cstdio>
+#include <string>
+
+namespace kivm {
+    /**
+     * Writes every GC event as a line of JSON, enabled by {@code -Xlog:gc}.
+     */
+    class GCLogger final : public GCListener {
+    private:
+        FILE *_file;
+        bool _ownsFile;
+
+        GCLogger(FILE *file, bool ownsFile)
+            : _file(file), _ownsFile(ownsFile) {
+        }
+
+    public:
+        /**
+         * @param path file to write, or empty for stdout
+         * @return {@code nullptr} if the file cannot be opened
+         */
+        static GCLogger *open(const std::string &path);
+
+        ~GCLogger() override;
+
+        void onGCEvent(const GCEvent &event) override;
+    };
+}
@@ -0,0 +1,96 @@
+//
+// Enumeration of GC roots
+//
+#pragma once
+
+#include <kivm/memory/oopClosure.h>
+#include <kivm/memory/gcEvent.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace kivm {
+    class JavaThread;
+
+    class Frame;
+
+    union Slot;
+
+    /**
+     * Root enumeration shared by all collectors.
+     *
+     * Roots are split into tasks, so that parallel GC workers
+     * can claim them one by one. A closure may update the slot
+     * it is given, the new value is written back to the root.
+     */
+    class GCRoots final {
+    public:
+        using Task = std::function<void(OopClosure *)>;
+
+    private:
+        static std::atomic<u8> sScanTimeNanos[ROOT_CATEGORY_COUNT];
+
+        /**
+         * Wrap {@code body}, so that the time it takes
+         * is added to the scan time of {@code category}.
+         */
+        static Task timed(GCRootCategory category, Task body);
+
+        static void doSlot(Slot *slot, OopClosure *closure);
+
+    public:
+        /**
+         * Objects held by {@code Global}, primitive type mirrors
+         * and references waiting for the reference handler.
+         */
+        static void doGlobals(OopClosure *closure);
+
+        static void doInternStrings(OopClosure *closure);
+
+        /**
+         * Java mirror, class loader, static fields and constant pool strings.
+         */
+        static void doClass(Klass *klass, OopClosure *closure);
+
+        /**
+         * Thread object, pending exception, arguments and all frames.
+         */
+        static void doThread(JavaThread *thread, OopClosure *closure);
+
+        /**
+         * Visit frames of {@code thread} from the top one, native frames
+         * included, each with the pc it is stopped at.
+         */
+        static void doFrames(JavaThread *thread, const std::function<void(Frame *, u4)> &visit);
+
+        /**
+         * Locals and stack slots that the oop map of the method
+         * says hold references at {@code pc}.
+         */
+        static void doFrame(Frame *frame, u4 pc, OopClosure *closure);
+
+        /**
+         * Append tasks covering all roots to {@code tasks}.
+         */
+        static void collectTasks(std::vector<Task> &tasks);
+
+        /**
+         * Visit all roots on current thread.
+         */
+        static void doAll(OopClosure *closure);
+
+        /**
+         * Called at the start of a pause.
+         */
+        static void resetScanTimes();
+
+        static void addScanTime(GCRootCategory category, std::chrono::nanoseconds time);
+
+        /**
+         * @return time spent on roots of {@code category} since
+         *         {@code resetScanTimes()}, summed over GC workers
+         */
+        static std::chrono::microseconds getScanTime(GCRootCategory category);
+    };
+}
@@ -0,0 +1,105 @@
+//
+// Work-stealing task queues of GC workers
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <atomic>
+#include <vector>
+
+namespace kivm {
+    /**
+     * A work-stealing deque of objects waiting to be scanned by a GC worker
+     * (Chase and Lev, "Dynamic Circular Work-Stealing Deque").
+     *
+     * The owner pushes and pops at the bottom without locking, idle workers
+     * steal from the top with a CAS. When the deque is full, objects go to
+     * an overflow stack that only the owner touches.
+     */
+    class GCTaskQueue final {
+    private:
+        static constexpr jlong CAPACITY = 1 << 14;
+        static constexpr jlong MASK = CAPACITY - 1;
+
+        std::atomic<jlong> _top;
+        std::atomic<jlong> _bottom;
+        std::atomic<oop> *_elements;
+        std::vector<oop> _overflow;
+
+    public:
+        GCTaskQueue();
+
+        GCTaskQueue(const GCTaskQueue &) = delete;
+
+        ~GCTaskQueue();
+
+        /**
+         * Called by the owner only.
+         */
+        void push(oop object);
+
+        /**
+         * Called by the owner only.
+         * @return false if there is nothing left
+         */
+        bool pop(oop &object);
+
+        /**
+         * Called by other workers.
+         * @return false if the deque is empty, or another thread won the race
+         */
+        bool steal(oop &object);
+
+        /**
+         * The overflow stack is not counted, it is private to the owner.
+         */
+        inline bool isEmpty() const {
+            return _top.load(std::memory_order_acquire) >= _bottom.load(std::memory_order_acquire);
+        }
+    };
+
+    /**
+     * Queues of all workers taking part in a collection,
+     * used to steal work and to decide when the collection is done.
+     */
+    class GCTaskQueueSet final {
+    private:
+        std::vector<GCTaskQueue *> _queues;
+        std::atomic<int> _offeredTermination;
+
+    public:
+        GCTaskQueueSet();
+
+        inline void addQueue(GCTaskQueue *queue) {
+            _queues.push_back(queue);
+        }
+
+        /**
+         * Must be called before every parallel phase.
+         */
+        inline void resetTermination() {
+            _offeredTermination = 0;
+        }
+
+        /**
+         * Try to steal from every other queue once.
+         */
+        bool steal(int workerId, oop &object);
+
+        /**
+         * Called by a worker which has run out of work.
+         * @return true if all workers have run out of work,
+         *         false if there is something to steal again
+         */
+        bool offerTermination();
+
+        /**
+         * Called by a worker which stops before all work is done,
+         * e.g. to yield to a pause. It counts as terminated, so that
+         * workers offering termination do not wait for it.
+         */
+        inline void abandonTermination() {
+            ++_offeredTermination;
+        }
+    };
+}
@@ -6,6 +6,10 @@
 #include <kivm/kivm.h>
 #include <kivm/runtime/vmThread.h>
 #include <shared/monitor.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
 
 namespace kivm {
     enum GCState {
@@ -21,11 +25,50 @@ namespace kivm {
         GC_CONCURRENT,
     };
 
+    /**
+     * Time from a GC request until all Java threads stopped.
+     */
+    struct SafepointStatistics {
+        size_t _safepoints = 0;
+        std::chrono::microseconds _totalTimeToSafepoint{0};
+        std::chrono::microseconds _maxTimeToSafepoint{0};
+    };
+
     class GCThread : public VMThread {
     private:
         static GCThread *sGCThreadInstance;
 
+        /**
+         * Armed while a GC is waiting for threads to stop,
+         * polled by the interpreter on backward branches and returns.
+         */
+        static std::atomic<bool> sSafepointPollArmed;
+
+        /**
+         * Set by the heap dump signal, turned into a heap dump
+         * request by the first Java thread that polls.
+         */
+        static std::atomic<bool> sHeapDumpSignaled;
+
     public:
+        /**
+         * Safepoint poll: a single relaxed load when no GC is pending.
+         */
+        inline static bool isSafepointPollArmed() {
+            return sSafepointPollArmed.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Generated code polls by comparing the byte here with zero.
+         */
+        inline static const std::atomic<bool> *getSafepointPollAddress() {
+            return &sSafepointPollArmed;
+        }
+
+        inline static bool isInitialized() {
+            return sGCThreadInstance != nullptr;
+        }
+
         inline static GCThread *get() {
             if (sGCThreadInstance == nullptr) {
                 WARN("GCThread not initialized");
@@ -36,28 +79,136 @@ namespace kivm {
 
         static void initialize();
 
+        /**
+         * Called from a signal handler, only touches atomics.
+         * Running threads stop at their next safepoint poll,
+         * and the heap is dumped to the default path.
+         */
+        static void onHeapDumpSignal();
+
     private:
         GCState _gcState;
-        Monitor _triggerMonitor;
-        Monitor _gcWaitMonitor;
+
+        /**
+         * Guards the GC state and the arrival counter.
+         * The GC thread sleeps on it until the last running Java thread
+         * parks, parked threads sleep on it until the collection is done.
+         */
+        Monitor _safepointMonitor;
+
+        /**
+         * Java threads parked in the pending safepoint,
+         * or blocked in a safe region.
+         */
+        int _threadsInSafepoint = 0;
+
+        /**
+         * Work pending for the next safepoint.
+         */
+        bool _collectionRequested = false;
+        bool _heapDumpRequested = false;
+        std::string _heapDumpPath;
+
+        /**
+         * Requested by a collector thread, see {@code runAtSafepoint()}.
+         */
+        const std::function<void()> *_pendingOperation = nullptr;
+        GCReason _pendingOperationReason = GC_CONCURRENT;
+
+        std::chrono::steady_clock::time_point _safepointRequestedAt;
+        SafepointStatistics _safepointStatistics;
 
     private:
+        /**
+         * Must be called inside {@code _safepointMonitor}.
+         */
         bool isAllThreadInSafePoint();
 
-        void doGarbageCollection();
+        /**
+         * Stop Java threads at their next safepoint poll.
+         * Must be called inside {@code _safepointMonitor}.
+         */
+        void requestSafepointLocked();
+
+        /**
+         * Run pending work, all Java threads are stopped.
+         */
+        void doSafepointOperations();
+
+        /**
+         * @return time from the GC request until now
+         */
+        std::chrono::microseconds recordTimeToSafepoint();
 
     protected:
         void run() override;
 
     public:
-        Monitor *required();
+        /**
+         * Request a collection and return at once.
+         * Running threads stop at their next safepoint poll.
+         */
+        void required();
 
+        /**
+         * Request a heap dump to {@code path} and return at once.
+         * Running threads stop at their next safepoint poll.
+         */
+        void requestHeapDump(const std::string &path);
+
+        /**
+         * Run {@code operation} while all Java threads are stopped, and
+         * return when it is done. Called by collector threads which are
+         * not Java threads, like the pauses of a concurrent collection.
+         * @return false if the GC thread stopped before running it
+         */
+        bool runAtSafepoint(GCReason reason, const std::function<void()> &operation);
+
+        /**
+         * Park the calling Java thread until the pending collection
+         * or heap dump is done, return at once if nothing is pending.
+         */
         void wait();
 
+        /**
+         * Count the calling Java thread as stopped at every safepoint
+         * from now on, it must not touch the heap until it leaves.
+         */
+        void enterSafeRegion();
+
+        /**
+         * Stop counting the calling Java thread as stopped.
+         * Waits for the collection in progress, if any.
+         */
+        void leaveSafeRegion();
+
+        /**
+         * Called when a Java thread exits, a pending collection
+         * may not have to wait for it any more.
+         */
+        void onJavaThreadExited();
+
+        /**
+         * Count a detached Java thread as running again, so that collections
+         * wait for it. Waits for the collection in progress, if any.
+         * @return false if the GC thread stopped, the VM is exiting
+         */
+        bool attachJavaThread();
+
+        /**
+         * Stop counting the calling Java thread as running,
+         * it must not touch the heap until it attaches again.
+         */
+        void detachJavaThread();
+
         void stop();
 
         inline GCState getState() const {
             return _gcState;
         }
+
+        inline const SafepointStatistics &getSafepointStatistics() const {
+            return _safepointStatistics;
+        }
     };
 }
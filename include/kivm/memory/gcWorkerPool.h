@@ -0,0 +1,57 @@
+//
+// Pool of parallel GC worker threads
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <kivm/runtime/vmThread.h>
+#include <shared/lock.h>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace kivm {
+    class GCWorkerThread;
+
+    /**
+     * Threads that run the parallel phases of a collection.
+     * The thread running the collection takes part as worker 0,
+     * so a pool of one worker starts no thread at all.
+     */
+    class GCWorkerPool final {
+        friend class GCWorkerThread;
+
+    public:
+        using Task = std::function<void(int workerId)>;
+
+    private:
+        int _workerCount;
+        std::vector<GCWorkerThread *> _threads;
+
+        Lock _lock;
+        std::condition_variable _taskCond;
+        std::condition_variable _doneCond;
+        const Task *_task = nullptr;
+        u8 _taskSerial = 0;
+        int _busyWorkers = 0;
+        bool _stopped = false;
+
+    private:
+        void workerLoop(int workerId);
+
+    public:
+        explicit GCWorkerPool(int workerCount);
+
+        ~GCWorkerPool();
+
+        inline int getWorkerCount() const {
+            return _workerCount;
+        }
+
+        /**
+         * Run {@code task} on every worker at the same time,
+         * and return when all of them have finished.
+         */
+        void runTask(const Task &task);
+    };
+}
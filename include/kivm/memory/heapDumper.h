@@ -0,0 +1,33 @@
+//
+// HPROF heap dumper
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <string>
+
+namespace kivm {
+    /**
+     * Writes the Java heap in the HPROF binary format,
+     * which is read by jhat, VisualVM and Eclipse MAT.
+     *
+     * Records are streamed to the file while the heap is walked,
+     * only the table of classes is kept in memory.
+     */
+    class HeapDumper final {
+    public:
+        /**
+         * Dump classes, objects, threads and roots to {@code path}.
+         * Must be called while Java threads are stopped,
+         * see {@code GCThread::requestHeapDump()}.
+         * @return false if the file cannot be written
+         */
+        static bool dump(const std::string &path);
+
+        /**
+         * @return {@code RuntimeConfig::heapDumpPath}, with
+         *         {@code java_pid<pid>.hprof} appended if it is a directory
+         */
+        static std::string getDefaultPath();
+    };
+}
@@ -4,9 +4,39 @@
 #pragma once
 
 #include <kivm/kivm.h>
+#include <shared/atomic.h>
 
 namespace kivm {
     struct HeapRegion final {
+        /**
+         * Space left unused inside a region, like the tail of a GC
+         * allocation buffer, is covered by a filler, so that the region
+         * can still be walked object by object. A filler starts with
+         * a word that can never be a vtable pointer of an object.
+         */
+        static constexpr u8 FILLER_WORD = 0x1;
+        static constexpr u8 FILLER_BLOCK = 0x3;
+
+        static inline void fill(jbyte *start, size_t size) {
+            if (size == sizeof(u8)) {
+                *(u8 *) start = FILLER_WORD;
+            } else if (size > sizeof(u8)) {
+                // the second word holds the size
+                ((u8 *) start)[0] = FILLER_BLOCK;
+                ((u8 *) start)[1] = size;
+            }
+        }
+
+        static inline bool isFiller(const jbyte *p) {
+            u8 word = *(const u8 *) p;
+            return word == FILLER_WORD || word == FILLER_BLOCK;
+        }
+
+        static inline size_t getFillerSize(const jbyte *p) {
+            const u8 *words = (const u8 *) p;
+            return words[0] == FILLER_WORD ? sizeof(u8) : words[1];
+        }
+
         size_t _regionSize{};
         jbyte *_regionStart = nullptr;
         jbyte *_current = nullptr;
@@ -23,6 +53,14 @@ namespace kivm {
             return _regionStart + getSize();
         }
 
+        inline size_t getFree() const {
+            return getRegionEnd() - _current;
+        }
+
+        inline bool contains(const void *addr) const {
+            return addr >= _regionStart && addr < getRegionEnd();
+        }
+
         inline bool shouldAllocate(size_t size) const {
             return (_current + size) < getRegionEnd();
         }
@@ -34,6 +72,22 @@ namespace kivm {
             return m;
         }
 
+        /**
+         * Bump the pointer with CAS, so that
+         * multiple threads can allocate in the same region.
+         * @return {@code nullptr} if no enough space
+         */
+        inline void *allocateAtomic(size_t size) {
+            jbyte *m;
+            do {
+                m = _current;
+                if (m + size >= getRegionEnd()) {
+                    return nullptr;
+                }
+            } while (cmpxchg(&_current, m, m + size) != m);
+            return m;
+        }
+
         inline void reset() {
             this->_current = this->_regionStart;
         }
@@ -0,0 +1,146 @@
+//
+// Non-moving space for large objects
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <shared/lock.h>
+#include <atomic>
+#include <functional>
+#include <map>
+
+namespace kivm {
+    /**
+     * A non-moving space for objects too large to be copied cheaply.
+     *
+     * Every object takes a chunk of whole pages, carved from address
+     * space reserved up front, and committed when it is allocated.
+     * Collectors never copy large objects, dead ones are found by marking.
+     * Their chunks are uncommitted and go back to a free list,
+     * merged with free neighbours.
+     */
+    class LargeObjectSpace final {
+    private:
+        struct Chunk {
+            size_t _size;
+            bool _free;
+            std::atomic<bool> _marked;
+
+            Chunk(size_t size, bool free)
+                : _size(size), _free(free), _marked(false) {
+            }
+        };
+
+        jbyte *_start = nullptr;
+        jbyte *_end = nullptr;
+
+        /**
+         * Chunks are carved below it, space above it was never used.
+         */
+        jbyte *_top = nullptr;
+
+        /**
+         * All chunks by address, free or not.
+         */
+        std::map<jbyte *, Chunk> _chunks;
+
+        /**
+         * Start of free chunks by their size.
+         */
+        std::multimap<size_t, jbyte *> _freeChunks;
+
+        /**
+         * Committed size of allocated chunks.
+         */
+        size_t _used = 0;
+        size_t _objectCount = 0;
+
+        /**
+         * Guards mutator allocation, collections run without it.
+         */
+        Lock _lock;
+
+    private:
+        void addFreeChunk(jbyte *start, size_t size);
+
+        void removeFreeChunk(jbyte *start, size_t size);
+
+        /**
+         * Take the smallest free chunk that fits, or carve a new one.
+         * @return {@code nullptr} if the reserved space is exhausted
+         */
+        jbyte *takeChunk(size_t size);
+
+        /**
+         * Uncommit an allocated chunk, and merge it with free neighbours.
+         */
+        void freeChunk(std::map<jbyte *, Chunk>::iterator chunk);
+
+    public:
+        LargeObjectSpace() = default;
+
+        LargeObjectSpace(const LargeObjectSpace &) = delete;
+
+        /**
+         * @param start reserved by the heap, aligned to pages
+         */
+        void initialize(jbyte *start, size_t reservedSize);
+
+        /**
+         * @param limit how much the space may commit in total
+         * @return {@code nullptr} if {@code limit} would be exceeded
+         *         or the reserved space is exhausted
+         */
+        void *allocate(size_t size, size_t limit);
+
+        inline bool contains(const void *addr) const {
+            return addr >= _start && addr < _end;
+        }
+
+        /**
+         * Mark a large object as reachable, may be called by many GC workers.
+         * @return true if it was not marked yet
+         */
+        bool mark(oop object);
+
+        bool isMarked(oop object) const;
+
+        /**
+         * Free unmarked objects and clear marks of others.
+         * Must be called while Java threads are stopped.
+         * @return bytes freed
+         */
+        size_t sweep();
+
+        /**
+         * Visit every allocated object.
+         * Must be called while Java threads are stopped.
+         */
+        void objectIterate(const std::function<void(oop)> &callback);
+
+        /**
+         * Visit every allocated chunk, without touching objects in them.
+         * Must be called while Java threads are stopped.
+         */
+        void chunkIterate(const std::function<void(jbyte *, size_t)> &callback);
+
+        inline jbyte *getStart() const {
+            return _start;
+        }
+
+        /**
+         * @return end of chunks ever carved, cards above it are never dirty
+         */
+        inline jbyte *getTop() const {
+            return _top;
+        }
+
+        inline size_t getUsed() const {
+            return _used;
+        }
+
+        inline size_t getObjectCount() const {
+            return _objectCount;
+        }
+    };
+}
@@ -0,0 +1,221 @@
+//
+// Mark-compact heap
+//
+#pragma once
+
+#include <kivm/memory/collectedHeap.h>
+#include <kivm/memory/heapRegion.h>
+#include <kivm/memory/gcRoots.h>
+#include <kivm/memory/gcTaskQueue.h>
+#include <kivm/memory/gcWorkerPool.h>
+#include <kivm/memory/oopClosure.h>
+#include <kivm/memory/threadLocalAllocBuffer.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace kivm {
+    class MarkCompactHeap;
+
+    /**
+     * Per-worker state of parallel marking.
+     * As a closure, it marks the object referenced by a slot.
+     */
+    struct MarkingWorker final : public OopClosure {
+        MarkCompactHeap *_heap;
+        int _workerId;
+
+        /**
+         * Marked objects whose fields are not scanned yet.
+         */
+        GCTaskQueue _queue;
+
+        size_t _markedObjects = 0;
+
+        MarkingWorker(MarkCompactHeap *heap, int workerId)
+            : _heap(heap), _workerId(workerId) {
+        }
+
+        void doOop(oop *slot) override;
+    };
+
+    /**
+     * A sliding mark-compact heap.
+     *
+     * All objects live in a single space, bump-allocated through TLABs.
+     * A collection always covers the whole heap:
+     *
+     *   1. mark live objects in a side bitmap, on all GC workers
+     *   2. compute new addresses and forward live objects to them,
+     *      dead runs are turned into fillers
+     *   3. adjust roots and fields to the new addresses
+     *   4. slide live objects towards the heap start, in address order
+     *
+     * Compared to {@code CopyingHeap}, no to-space is needed, which halves
+     * the footprint of long-lived data, but every collection touches the
+     * whole heap. There is no card table, and no write barrier.
+     *
+     * Like the old generation of {@code CopyingHeap}, address space for the
+     * maximum heap size is reserved up front, and the committed part grows
+     * or shrinks by occupancy after collections.
+     */
+    class MarkCompactHeap : public CollectedHeap {
+        friend struct MarkingWorker;
+
+    private:
+        jbyte *_memoryStart = nullptr;
+        size_t _initialSize;
+        size_t _maxSize;
+        size_t _reservedSize = 0;
+
+        /**
+         * The whole heap, its size is the committed size.
+         */
+        HeapRegion _space;
+
+        /**
+         * One bit for every heap word, set at object starts.
+         */
+        u8 *_markBits = nullptr;
+        size_t _markBitsReservedSize = 0;
+
+        size_t _tlabSize;
+
+        GCWorkerPool *_workerPool = nullptr;
+        std::vector<MarkingWorker *> _workers;
+        GCTaskQueueSet _queueSet;
+
+        std::vector<GCRoots::Task> _rootTasks;
+        std::atomic<size_t> _nextRootTask;
+
+        /**
+         * Headers with a hash or a monitor, stored aside while
+         * objects are forwarded, as pairs of (new address, header).
+         */
+        std::vector<std::pair<oop, u8>> _preservedHeaders;
+
+        size_t _markedObjects = 0;
+
+        /**
+         * Size of the allocation waiting for a collection.
+         */
+        size_t _requiredSize = 0;
+
+        /**
+         * Collections in a row that left the heap mostly empty.
+         */
+        int _lowOccupancyCollections = 0;
+
+    private:
+        void initializeSpace();
+
+        /**
+         * Commit or uncommit the tail of the space and its mark bits.
+         * @return false if more memory cannot be committed
+         */
+        bool resizeSpace(size_t newSize);
+
+        /**
+         * Grow or shrink the space by its occupancy,
+         * called after a collection.
+         */
+        void adjustSpace();
+
+        /**
+         * Allocate through the TLAB of {@code thread} if possible.
+         * @return {@code nullptr} if the space is full
+         */
+        void *allocateInSpace(JavaThread *thread, size_t size);
+
+        /**
+         * Cover free parts of all TLABs with fillers and give them back,
+         * so that the space can be walked object by object.
+         */
+        void retireTlabs();
+
+        /**
+         * @return the first byte of mark bits covering {@code heapOffset}
+         */
+        jbyte *getMarkBytes(size_t heapOffset) const;
+
+        inline size_t getBitIndex(const void *addr) const {
+            return ((jbyte *) addr - _memoryStart) / sizeof(jlong);
+        }
+
+        inline bool isMarked(const void *addr) const {
+            size_t index = getBitIndex(addr);
+            return (_markBits[index / 64] & (1ULL << (index % 64))) != 0;
+        }
+
+        /**
+         * Set the mark bit of an object.
+         * @return false if it was already marked
+         */
+        bool tryMark(const void *addr);
+
+        /**
+         * Mark an object, and queue it for scanning if it was not marked.
+         */
+        void markObject(MarkingWorker *worker, oop object);
+
+        /**
+         * Body of a GC worker: claim root tasks, then drain queues.
+         */
+        void workOn(MarkingWorker *worker);
+
+        void markLiveObjects();
+
+        /**
+         * Clear references whose referents were not marked,
+         * must be called right after {@code markLiveObjects()}.
+         * @return number of references cleared
+         */
+        size_t processReferences();
+
+        /**
+         * Forward every live object to its address after compaction.
+         * @return the new top of the space
+         */
+        jbyte *computeAddresses();
+
+        void adjustReferences();
+
+        void slideObjects();
+
+    public:
+        MarkCompactHeap();
+
+        ~MarkCompactHeap() override;
+
+        void *allocate(size_t size) override;
+
+        void initializeAll() override;
+
+        /**
+         * Collect the whole heap.
+         */
+        void doGarbageCollection() override;
+
+        void objectIterate(const std::function<void(oop)> &callback) override;
+
+        inline void *getHeapStart() override {
+            return _memoryStart;
+        }
+
+        inline void *getHeapEnd() override {
+            return _memoryStart + _reservedSize;
+        }
+
+        inline size_t getHeapSize() override {
+            return _space.getSize();
+        }
+
+        inline size_t getHeapUsed() const {
+            return _space.getUsed();
+        }
+
+        inline bool isHeapObject(void *addr) override {
+            return addr >= getHeapStart() && addr < getHeapEnd();
+        }
+    };
+}
@@ -0,0 +1,91 @@
+//
+// Closures applied to reference slots by collectors
+//
+#pragma once
+
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/instanceOop.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+
+namespace kivm {
+    /**
+     * Visits reference slots found by collectors.
+     */
+    class OopClosure {
+    public:
+        virtual ~OopClosure() = default;
+
+        /**
+         * @param slot never {@code nullptr}, but {@code *slot} may be
+         */
+        virtual void doOop(oop *slot) = 0;
+    };
+
+    /**
+     * Walks reference slots inside an object,
+     * shared by all collectors.
+     */
+    struct OopIterator final {
+        /**
+         * Call {@code visit(oop *slot)} for every reference slot
+         * of {@code object} within {@code [from, to)}.
+         */
+        template <typename Visitor>
+        static inline void iterate(oop object, jbyte *from, jbyte *to, Visitor &&visit) {
+            switch (object->getMarkOop()->getOopType()) {
+                case oopType::INSTANCE_OOP: {
+                    auto instance = (instanceOop) object;
+
+                    // instance fields, only references need to be followed
+                    auto instanceClass = instance->getInstanceClass();
+                    for (int offset : instanceClass->getInstanceOopOffsets()) {
+                        auto slot = instance->getFieldAddress<oop>(offset);
+                        if ((jbyte *) slot >= from && (jbyte *) slot < to) {
+                            visit(slot);
+                        }
+                    }
+                    break;
+                }
+
+                case oopType::OBJECT_ARRAY_OOP:
+                case oopType::TYPE_ARRAY_OOP: {
+                    auto array = (arrayOop) object;
+
+                    // array elements, primitive values need no visit
+                    if (((ArrayKlass *) array->getClass())->hasOopElements()) {
+                        auto elements = array->getElements();
+                        int begin = 0;
+                        int end = array->getLength();
+                        if (from > elements) {
+                            begin = (int) ((from - elements + sizeof(oop) - 1) / sizeof(oop));
+                        }
+                        if (to < elements + end * sizeof(oop)) {
+                            end = (int) ((to - elements + sizeof(oop) - 1) / sizeof(oop));
+                        }
+                        for (int i = begin; i < end; ++i) {
+                            visit(array->getElementAddress<oop>(i));
+                        }
+                    }
+                    break;
+                }
+
+                case oopType::PRIMITIVE_OOP:
+                    // primitive values hold no references
+                    break;
+
+                default:
+                    SHOULD_NOT_REACH_HERE();
+            }
+        }
+
+        /**
+         * Call {@code visit(oop *slot)} for every reference slot of {@code object}.
+         */
+        template <typename Visitor>
+        static inline void iterate(oop object, Visitor &&visit) {
+            auto start = (jbyte *) object;
+            iterate(object, start, start + object->getObjectSize(), visit);
+        }
+    };
+}
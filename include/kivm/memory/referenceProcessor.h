@@ -0,0 +1,157 @@
+//
+// Discovery and processing of soft, weak and phantom references
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/instanceOop.h>
+#include <shared/lock.h>
+#include <shared/monitor.h>
+#include <functional>
+#include <vector>
+
+namespace kivm {
+    /**
+     * Finds soft, weak and phantom references during a collection,
+     * and clears those whose referents are not strongly reachable.
+     *
+     * While tracing, a collector asks {@code discover()} about every object
+     * it scans. For a reference whose referent may die in this collection,
+     * the referent slot is handed back and must not be traced. After tracing,
+     * {@code process()} clears referents that were not reached otherwise,
+     * and links their references into the pending list, which is drained
+     * by the reference handler thread, see {@code ReferenceHandlerThread}.
+     *
+     * Soft references are only discovered when their referents have not
+     * been read recently: the allowed idle time is
+     * {@code RuntimeConfig::softRefLRUPolicyMSPerMB} for every free megabyte
+     * of the maximum heap, like the LRU policy of HotSpot. A collection run
+     * before giving up with OutOfMemoryError clears all of them.
+     *
+     * Finalization is not supported, final references are strong.
+     * Phantom referents are cleared when their references are queued.
+     */
+    class ReferenceProcessor final {
+        friend class GCRoots;
+
+    private:
+        /**
+         * Byte offsets of the fields of {@code java.lang.ref.Reference},
+         * -1 until the class is linked.
+         */
+        static int sReferentOffset;
+        static int sQueueOffset;
+        static int sDiscoveredOffset;
+
+        static InstanceKlass *sSoftReferenceClass;
+        static int sSoftClockOffset;
+        static int sSoftTimestampOffset;
+
+        /**
+         * Cleared references waiting for the reference handler,
+         * linked through {@code Reference.discovered}. It is a GC root.
+         */
+        static oop sPendingList;
+        static Monitor sPendingListMonitor;
+
+    private:
+        bool _discoveryEnabled = false;
+        bool _clearAllSoftReferences = false;
+
+        /**
+         * Value of {@code SoftReference.clock} when discovery began.
+         */
+        jlong _softClock = 0;
+        jlong _softMaxInterval = 0;
+
+        Lock _lock;
+        std::vector<instanceOop> _discovered;
+
+    private:
+        static jlong currentTimeMillis();
+
+        bool shouldDiscoverSoftReference(instanceOop reference) const;
+
+    public:
+        static void onReferenceClassLinked(InstanceKlass *referenceClass);
+
+        static void onSoftReferenceClassLinked(InstanceKlass *softReferenceClass);
+
+        static inline oop *getReferentAddress(instanceOop reference) {
+            return reference->getFieldAddress<oop>(sReferentOffset);
+        }
+
+        static inline oop *getQueueAddress(instanceOop reference) {
+            return reference->getFieldAddress<oop>(sQueueOffset);
+        }
+
+        static inline oop *getDiscoveredAddress(instanceOop reference) {
+            return reference->getFieldAddress<oop>(sDiscoveredOffset);
+        }
+
+        /**
+         * Block until the pending list is not empty.
+         */
+        static void waitForPendingReferences();
+
+        /**
+         * Take the whole pending list, must be called while the calling
+         * thread counts as running, so that no collection moves it.
+         * @return the first reference, or {@code nullptr} if there is none
+         */
+        static instanceOop takePendingList();
+
+        /**
+         * Turn discovery on, called at the start of a pause.
+         * @param freeBytes free bytes of the maximum heap size
+         * @param clearAllSoftReferences discover every soft reference,
+         *                               no matter how recently it was read
+         */
+        void beginDiscovery(size_t freeBytes, bool clearAllSoftReferences);
+
+        /**
+         * Called by GC workers for every object they scan.
+         * @param from only a referent slot within {@code [from, to)} is discovered
+         * @param isCandidate whether an object may die in this collection
+         * @return the referent slot the caller must skip, or {@code nullptr}
+         */
+        template <typename IsCandidate>
+        inline oop *discover(oop object, jbyte *from, jbyte *to, IsCandidate &&isCandidate) {
+            if (!_discoveryEnabled || object->getMarkOop()->getOopType() != oopType::INSTANCE_OOP) {
+                return nullptr;
+            }
+
+            auto reference = (instanceOop) object;
+            ReferenceType type = reference->getInstanceClass()->getReferenceType();
+            if (type == REF_NONE || type == REF_FINAL) {
+                return nullptr;
+            }
+
+            oop *slot = getReferentAddress(reference);
+            if ((jbyte *) slot < from || (jbyte *) slot >= to
+                || *slot == nullptr || !isCandidate(*slot)) {
+                return nullptr;
+            }
+
+            if (type == REF_SOFT && !shouldDiscoverSoftReference(reference)) {
+                return nullptr;
+            }
+
+            LockGuard guard(_lock);
+            _discovered.push_back(reference);
+            return slot;
+        }
+
+        /**
+         * Clear discovered references whose referents were not reached,
+         * and turn discovery off. Called on the GC thread after tracing.
+         * @param keepAlive whether the referent in a slot was reached,
+         *                  it may point the slot to the new address
+         * @param onStore called for every reference slot stored to
+         * @return number of references cleared
+         */
+        size_t process(const std::function<bool(oop *)> &keepAlive,
+                       const std::function<void(oop *)> &onStore);
+    };
+}
@@ -0,0 +1,101 @@
+//
+// Snapshot-at-the-beginning mark queues
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <shared/lock.h>
+#include <atomic>
+#include <vector>
+
+namespace kivm {
+    /**
+     * References overwritten by a single JavaThread while concurrent
+     * marking is active. Logging one is a push without synchronization,
+     * only handing a full buffer to the {@code SatbMarkQueueSet} locks.
+     */
+    struct SatbMarkQueue final {
+        static constexpr size_t CAPACITY = 256;
+
+        std::vector<oop> _buffer;
+    };
+
+    /**
+     * Snapshot-at-the-beginning marking: while it is active, the previous
+     * value of every reference field about to be overwritten is logged by
+     * {@code Universe::preWriteBarrier()}. A concurrent marker traces them
+     * like roots, so every object reachable when marking started is marked,
+     * however mutators change the object graph in the meantime.
+     */
+    class SatbMarkQueueSet final {
+    private:
+        std::atomic<bool> _active;
+
+        /**
+         * Guards the buffers below.
+         */
+        Lock _lock;
+
+        /**
+         * Full buffers waiting for the marker.
+         */
+        std::vector<std::vector<oop>> _completedBuffers;
+        std::atomic<size_t> _completedBufferCount;
+
+        /**
+         * Shared by threads other than JavaThreads.
+         */
+        std::vector<oop> _sharedBuffer;
+
+    private:
+        /**
+         * Must be called inside {@code _lock}.
+         */
+        void completeBufferLocked(std::vector<oop> &buffer);
+
+    public:
+        SatbMarkQueueSet();
+
+        SatbMarkQueueSet(const SatbMarkQueueSet &) = delete;
+
+        /**
+         * Barrier fast path: a single relaxed load when not marking.
+         */
+        inline bool isActive() const {
+            return _active.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Turn logging on or off.
+         * Must be called while Java threads are stopped.
+         */
+        void setActive(bool active);
+
+        /**
+         * Log a reference about to be overwritten, called by mutators.
+         */
+        void enqueue(oop previous);
+
+        inline bool hasCompletedBuffers() const {
+            return _completedBufferCount.load(std::memory_order_relaxed) != 0;
+        }
+
+        /**
+         * Called by the marker.
+         * @return every full buffer, they are removed from the set
+         */
+        std::vector<std::vector<oop>> takeCompletedBuffers();
+
+        /**
+         * Hand buffers of all threads to the set, even if they are not full.
+         * Must be called while Java threads are stopped.
+         */
+        void flushThreadBuffers();
+
+        /**
+         * Drop everything logged, when marking is given up.
+         * Must be called while Java threads are stopped.
+         */
+        void abandon();
+    };
+}
@@ -0,0 +1,53 @@
+//
+// Thread-local allocation buffer
+//
+#pragma once
+
+#include <kivm/kivm.h>
+
+namespace kivm {
+    /**
+     * A chunk of eden owned by a single JavaThread.
+     * Allocating in it is a plain pointer bump without synchronization,
+     * only refilling it from eden touches shared state.
+     */
+    struct ThreadLocalAllocBuffer final {
+        jbyte *_start = nullptr;
+        jbyte *_top = nullptr;
+        jbyte *_end = nullptr;
+
+        inline size_t getUsed() const {
+            return _top - _start;
+        }
+
+        inline size_t getFree() const {
+            return _end - _top;
+        }
+
+        inline void *allocate(size_t size) {
+            if (size > getFree()) {
+                return nullptr;
+            }
+
+            // bump the pointer
+            jbyte *m = _top;
+            _top += size;
+            return m;
+        }
+
+        inline void fill(jbyte *start, size_t size) {
+            this->_start = start;
+            this->_top = start;
+            this->_end = start + size;
+        }
+
+        /**
+         * Called when the chunk is given back to the heap, e.g. after GC.
+         */
+        inline void reset() {
+            this->_start = nullptr;
+            this->_top = nullptr;
+            this->_end = nullptr;
+        }
+    };
+}
@@ -5,6 +5,10 @@
 
 #include <kivm/kivm.h>
 #include <kivm/memory/collectedHeap.h>
+#include <kivm/memory/gcEvent.h>
+#include <kivm/memory/satbMarkQueue.h>
+#include <shared/lock.h>
+#include <vector>
 
 namespace kivm {
     class Universe final {
@@ -12,6 +16,18 @@ namespace kivm {
 
     private:
         static CollectedHeap *sCollectedHeapInstance;
+        static CardTable *sCardTable;
+        static SatbMarkQueueSet *sSatbMarkQueueSet;
+
+        static std::vector<GCListener *> &getGCListeners() {
+            static std::vector<GCListener *> listeners;
+            return listeners;
+        }
+
+        static Lock &gcListenerLock() {
+            static Lock lock;
+            return lock;
+        }
 
     public:
         static void initialize();
@@ -22,6 +38,50 @@ namespace kivm {
 
         static void deallocVirtual(void *memory);
 
+        /**
+         * Reserve address space without backing memory.
+         * Pages must be committed before they are accessed.
+         * @return page-aligned start address, or {@code nullptr} on failure
+         */
+        static void *reserveVirtual(size_t size);
+
+        /**
+         * Release address space obtained from {@code reserveVirtual()}.
+         */
+        static void releaseVirtual(void *memory, size_t size);
+
+        /**
+         * Reserve address space for the Java heap. Pages committed in it
+         * are backed by {@code RuntimeConfig::heapPageType}, placed on NUMA
+         * nodes by {@code heapNumaPolicy}, and touched at once if
+         * {@code heapPreTouch} is set. Options the system does not support
+         * are warned about and ignored.
+         * @return start aligned to {@code getLargePageSize()},
+         *         or {@code nullptr} on failure
+         */
+        static void *reserveHeapVirtual(size_t size);
+
+        /**
+         * Make {@code [memory, memory + size)} of reserved space accessible.
+         * Both ends are widened to page boundaries, or to large page
+         * boundaries in heaps backed by hugetlb pages.
+         * @return false if the system is out of memory
+         */
+        static bool commitVirtual(void *memory, size_t size);
+
+        /**
+         * Give back pages fully inside {@code [memory, memory + size)}
+         * to the system, their contents are lost.
+         */
+        static void uncommitVirtual(void *memory, size_t size);
+
+        static size_t getPageSize();
+
+        /**
+         * @return size of huge pages, 2MB if the system does not tell
+         */
+        static size_t getLargePageSize();
+
         static void *allocHeap(size_t size);
 
         static void *allocCObject(size_t size);
@@ -29,5 +89,70 @@ namespace kivm {
         static void deallocCObject(void *memory);
 
         static bool isHeapObject(void *addr);
+
+        /**
+         * Listeners are not owned, and must be removed before they are deleted.
+         */
+        static void addGCListener(GCListener *listener);
+
+        static void removeGCListener(GCListener *listener);
+
+        static void notifyGCListeners(const GCEvent &event);
+
+        static inline CollectedHeap *getCollectedHeap() {
+            return sCollectedHeapInstance;
+        }
+
+        /**
+         * Must be called before a reference stored in an instance field
+         * or an array element is overwritten. While a concurrent collector
+         * is marking, the previous value is logged, so that it is not lost
+         * when it was reachable only through this field.
+         * @param fieldAddress where the reference is about to be stored
+         */
+        static inline void preWriteBarrier(void *fieldAddress) {
+            if (sSatbMarkQueueSet != nullptr && sSatbMarkQueueSet->isActive()) {
+                oop previous = *(oop *) fieldAddress;
+                if (previous != nullptr) {
+                    sSatbMarkQueueSet->enqueue(previous);
+                }
+            }
+        }
+
+        /**
+         * Must be called before {@code count} references
+         * starting at {@code start} are overwritten in bulk.
+         */
+        static inline void preWriteBarrier(void *start, size_t count) {
+            if (sSatbMarkQueueSet != nullptr && sSatbMarkQueueSet->isActive()) {
+                for (size_t i = 0; i < count; ++i) {
+                    oop previous = ((oop *) start)[i];
+                    if (previous != nullptr) {
+                        sSatbMarkQueueSet->enqueue(previous);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Must be called after a reference is stored into
+         * an instance field or an array element.
+         * @param fieldAddress where the reference is stored
+         */
+        static inline void writeBarrier(void *fieldAddress) {
+            if (sCardTable != nullptr) {
+                sCardTable->markCard(fieldAddress);
+            }
+        }
+
+        /**
+         * Must be called after references are copied into
+         * {@code [start, start + size)} in bulk.
+         */
+        static inline void writeBarrier(void *start, size_t size) {
+            if (sCardTable != nullptr) {
+                sCardTable->markCards(start, size);
+            }
+        }
     };
 }
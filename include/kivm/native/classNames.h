@@ -28,3 +28,4 @@
 #define J_IOEXCEPTION L"java/io/IOException"
 #define J_ARRAY_INDEX_OUT_OF_BOUNDS L"java/lang/ArrayIndexOutOfBoundsException"
 #define J_CLASS_NOT_FOUND L"java/lang/ClassNotFoundException"
+#define J_OUT_OF_MEMORY_ERROR L"java/lang/OutOfMemoryError"
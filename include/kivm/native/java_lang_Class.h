@@ -12,11 +12,15 @@
 namespace kivm {
     class CopyingHeap;
 
+    class GCRoots;
+
     namespace java {
         namespace lang {
             class Class {
                 friend class kivm::CopyingHeap;
 
+                friend class kivm::GCRoots;
+
             private:
                 static HashMap<kivm::String, mirrorOop> _primitiveTypeMirrors;
 
@@ -10,6 +10,8 @@
 namespace kivm {
     class CopyingHeap;
 
+    class GCRoots;
+
     namespace java {
         namespace lang {
             struct StringHash {
@@ -25,6 +27,8 @@ namespace kivm {
             class InternStringPool {
                 friend class kivm::CopyingHeap;
 
+                friend class kivm::GCRoots;
+
             private:
                 // hash -> string
                 HashMap<int, instanceOop> _pool;
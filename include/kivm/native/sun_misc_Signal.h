@@ -0,0 +1,19 @@
+//
+// Natives of sun.misc.Signal
+//
+#pragma once
+
+namespace kivm {
+    namespace sun {
+        namespace misc {
+            class Signal final {
+            public:
+                /**
+                 * Install handlers of signals reserved by the VM:
+                 * SIGUSR1 dumps the heap at the next safepoint.
+                 */
+                static void initialize();
+            };
+        }
+    }
+}
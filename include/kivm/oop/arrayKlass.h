@@ -10,12 +10,17 @@ namespace kivm {
     class ArrayKlass : public Klass {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
     private:
         ClassLoader *_classLoader = nullptr;
         mirrorOop _javaLoader = nullptr;
 
         int _dimension;
 
+    protected:
+        size_t _elementSize = sizeof(oop);
+
     public:
         ArrayKlass(ClassLoader *classLoader, mirrorOop javaLoader,
                    int dimension, ClassType classType);
@@ -36,6 +41,21 @@ namespace kivm {
             return getClassType() == ClassType::OBJECT_ARRAY_CLASS;
         }
 
+        /**
+         * @return size of an unboxed element in bytes
+         */
+        size_t getElementSize() const {
+            return _elementSize;
+        }
+
+        /**
+         * Object arrays and multi-dimension type arrays hold references,
+         * only one-dimension type arrays hold primitive values.
+         */
+        bool hasOopElements() const {
+            return isObjectArray() || getDimension() > 1;
+        }
+
         void linkClass() override;
 
         void initClass() override;
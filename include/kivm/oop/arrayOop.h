@@ -6,30 +6,44 @@
 
 #include <kivm/oop/instanceOop.h>
 #include <kivm/oop/arrayKlass.h>
-#include <vector>
+#include <kivm/memory/universe.h>
 
 namespace kivm {
     class arrayOopDesc : public oopDesc {
-        // copyArrayTo() needs to use _elements
-        friend class TypeArrayKlass;
-        friend class ObjectArrayKlass;
-
         friend class CopyingHeap;
 
-    protected:
-        std::vector<oop> _elements;
-
     private:
-        explicit arrayOopDesc(arrayOop other)
-            : oopDesc(other->getClass(), other->getMarkOop()->getOopType()),
-              _elements(other->_elements) {
+        int _length;
+
+    public:
+        /**
+         * Array elements are stored unboxed right after the header,
+         * {@code ArrayKlass::getElementSize()} bytes each.
+         */
+        static constexpr size_t HEADER_SIZE = (sizeof(oopDesc) + sizeof(int) + sizeof(jlong) - 1)
+                                              & ~(sizeof(jlong) - 1);
+
+        /**
+         * @return bytes needed by elements of an array
+         */
+        static inline size_t getPayloadSize(size_t elementSize, int length) {
+            return alignUp(elementSize * (size_t) length, sizeof(jlong));
+        }
+
+        /**
+         * Where the length is, for generated code.
+         */
+        static inline int getLengthOffset() {
+            return (int) ((char *) &((arrayOopDesc *) HEADER_SIZE)->_length - (char *) HEADER_SIZE);
         }
 
     public:
         explicit arrayOopDesc(ArrayKlass *arrayClass, oopType type, int length);
 
-        inline arrayOop copy() override {
-            return new arrayOopDesc(this);
+        arrayOop copy() override;
+
+        inline size_t getObjectSize() const override {
+            return HEADER_SIZE + getPayloadSize(getElementSize(), getLength());
         }
 
         inline int getDimension() const {
@@ -37,22 +51,47 @@ namespace kivm {
         }
 
         inline int getLength() const {
-            return static_cast<int>(_elements.size());
+            return _length;
+        }
+
+        inline size_t getElementSize() const {
+            return ((ArrayKlass *) getClass())->getElementSize();
+        }
+
+        inline jbyte *getElements() {
+            return ((jbyte *) this) + HEADER_SIZE;
+        }
+
+        /**
+         * Get the raw address of an element.
+         * @param position element index
+         * @return typed pointer to element value
+         */
+        template <typename T>
+        inline T *getElementAddress(int position) {
+            assert(position >= 0 && position <= getLength());
+            return ((T *) getElements()) + position;
         }
 
-        inline oop getElementAt(int position) const {
+        inline oop getElementAt(int position) {
+            assert(((ArrayKlass *) getClass())->hasOopElements());
             assert(position >= 0 && position < getLength());
-            return _elements[position];
+            return *getElementAddress<oop>(position);
         }
 
         inline void setElementAt(int position, oop element) {
+            assert(((ArrayKlass *) getClass())->hasOopElements());
             assert(position >= 0 && position < getLength());
-            _elements[position] = element;
+            auto address = getElementAddress<oop>(position);
+            Universe::preWriteBarrier(address);
+            *address = element;
+            Universe::writeBarrier(address);
         }
 
-        inline oop* getElementUnsafe(int position) {
+        inline oop *getElementUnsafe(int position) {
+            assert(((ArrayKlass *) getClass())->hasOopElements());
             assert(position >= 0 && position < getLength());
-            return &_elements[position];
+            return getElementAddress<oop>(position);
         }
     };
 
@@ -3,83 +3,102 @@
 //
 #pragma once
 
-#include <vector>
 #include <kivm/oop/primitiveOop.h>
+#include <kivm/oop/reflection.h>
 #include <kivm/oop/field.h>
 #include <kivm/native/java_lang_String.h>
+#include <kivm/memory/universe.h>
 
 namespace kivm {
-    inline void helperInitField(std::vector<oop> &values, int offset, Field *field) {
-        if (values.size() <= offset) {
-            values.resize((unsigned long) offset + 1);
-        }
-        switch (field->getValueType()) {
+    /**
+     * Store an int-typed value (int, short, char, boolean, byte)
+     * into unboxed field storage, truncated to the field's width.
+     */
+    inline void helperStoreIntField(jbyte *address, ValueType valueType, jint value) {
+        switch (valueType) {
             case ValueType::INT:
-            case ValueType::SHORT:
-            case ValueType::CHAR:
-            case ValueType::BOOLEAN:
-            case ValueType::BYTE:
-                values[offset] = new intOopDesc(0);
+                *(jint *) address = value;
                 break;
-            case ValueType::LONG:
-                values[offset] = new longOopDesc(0L);
+            case ValueType::SHORT:
+                *(jshort *) address = (jshort) value;
                 break;
-            case ValueType::FLOAT:
-                values[offset] = new floatOopDesc(0.0f);
+            case ValueType::CHAR:
+                *(jchar *) address = (jchar) value;
                 break;
-            case ValueType::DOUBLE:
-                values[offset] = new doubleOopDesc(0.0);
+            case ValueType::BOOLEAN:
+                *(jboolean *) address = (jboolean) (value & 1);
                 break;
-            case ValueType::OBJECT:
-            case ValueType::ARRAY:
-                values[offset] = nullptr;
+            case ValueType::BYTE:
+                *(jbyte *) address = (jbyte) value;
                 break;
+            default:
+                SHOULD_NOT_REACH_HERE_M("int-typed field required");
+        }
+    }
 
-            case ValueType::VOID:
-                SHOULD_NOT_REACH_HERE_M("Field cannot be typed void");
-                break;
+    /**
+     * Load an int-typed value (int, short, char, boolean, byte)
+     * from unboxed field storage, extended to jint.
+     */
+    inline jint helperLoadIntField(jbyte *address, ValueType valueType) {
+        switch (valueType) {
+            case ValueType::INT:
+                return *(jint *) address;
+            case ValueType::SHORT:
+                return *(jshort *) address;
+            case ValueType::CHAR:
+                return *(jchar *) address;
+            case ValueType::BOOLEAN:
+                return *(jboolean *) address;
+            case ValueType::BYTE:
+                return *(jbyte *) address;
             default:
-                SHOULD_NOT_REACH_HERE_M("Unrecognized field value type");
-                break;
+                SHOULD_NOT_REACH_HERE_M("int-typed field required");
+        }
+    }
+
+    inline void helperInitField(jbyte *values, int offset, Field *field) {
+        ValueType valueType = field->getValueType();
+        if (valueType == ValueType::VOID) {
+            SHOULD_NOT_REACH_HERE_M("Field cannot be typed void");
         }
+        // zero is the default value of every field type
+        memset(values + offset, '\0', valueTypeSizeOf(valueType));
     }
 
-    inline bool helperInitConstantField(std::vector<oop> &values,
+    inline bool helperInitConstantField(jbyte *values,
                                         int offset,
                                         cp_info **pool,
                                         Field *field) {
-        if (values.size() <= offset) {
-            values.resize((unsigned long) offset + 1);
-        }
-
         ConstantValue_attribute *attr = field->getConstantAttribute();
         if (attr != nullptr) {
+            jbyte *address = values + offset;
             cp_info *constant_info = pool[attr->constant_index];
             switch (constant_info->tag) {
                 case CONSTANT_Long: {
                     auto *info = (CONSTANT_Long_info *) constant_info;
-                    values[offset] = new longOopDesc(info->getConstant());
+                    *(jlong *) address = info->getConstant();
                     break;
                 }
                 case CONSTANT_Float: {
                     auto *info = (CONSTANT_Float_info *) constant_info;
-                    values[offset] = new floatOopDesc(info->getConstant());
+                    *(jfloat *) address = info->getConstant();
                     break;
                 }
                 case CONSTANT_Double: {
                     auto *info = (CONSTANT_Double_info *) constant_info;
-                    values[offset] = new doubleOopDesc(info->getConstant());
+                    *(jdouble *) address = info->getConstant();
                     break;
                 }
                 case CONSTANT_Integer: {
                     auto *info = (CONSTANT_Integer_info *) constant_info;
-                    values[offset] = new intOopDesc(info->getConstant());
+                    helperStoreIntField(address, field->getValueType(), info->getConstant());
                     break;
                 }
                 case CONSTANT_String: {
                     auto *info = (CONSTANT_String_info *) constant_info;
                     auto *utf8 = (CONSTANT_Utf8_info *) pool[info->string_index];
-                    values[offset] = java::lang::String::intern(utf8->getConstant());
+                    *(oop *) address = java::lang::String::intern(utf8->getConstant());
                     break;
                 }
                 default: {
@@ -88,8 +107,76 @@ namespace kivm {
             }
             return true;
         }
-        
+
         return false;
     }
-}
 
+    /**
+     * Read a field value as an oop.
+     * Primitive values are boxed, int-typed ones into intOop.
+     */
+    inline oop helperLoadField(jbyte *values, int offset, Field *field) {
+        jbyte *address = values + offset;
+        switch (field->getValueType()) {
+            case ValueType::INT:
+            case ValueType::SHORT:
+            case ValueType::CHAR:
+            case ValueType::BOOLEAN:
+            case ValueType::BYTE:
+                return new intOopDesc(helperLoadIntField(address, field->getValueType()));
+            case ValueType::LONG:
+                return new longOopDesc(*(jlong *) address);
+            case ValueType::FLOAT:
+                return new floatOopDesc(*(jfloat *) address);
+            case ValueType::DOUBLE:
+                return new doubleOopDesc(*(jdouble *) address);
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                return *(oop *) address;
+            default:
+                SHOULD_NOT_REACH_HERE_M("Unrecognized field value type");
+        }
+    }
+
+    /**
+     * Write a field value from an oop.
+     * Primitive values are unboxed, a null box stores the default value.
+     */
+    inline void helperStoreField(jbyte *values, int offset, Field *field, oop value) {
+        jbyte *address = values + offset;
+        ValueType valueType = field->getValueType();
+        if (valueType == ValueType::OBJECT || valueType == ValueType::ARRAY) {
+            Universe::preWriteBarrier(address);
+        }
+        if (value == nullptr) {
+            memset(address, '\0', valueTypeSizeOf(valueType));
+            return;
+        }
+
+        switch (valueType) {
+            case ValueType::INT:
+            case ValueType::SHORT:
+            case ValueType::CHAR:
+            case ValueType::BOOLEAN:
+            case ValueType::BYTE:
+                helperStoreIntField(address, valueType, ((intOop) value)->getValue());
+                break;
+            case ValueType::LONG:
+                *(jlong *) address = ((longOop) value)->getValue();
+                break;
+            case ValueType::FLOAT:
+                *(jfloat *) address = ((floatOop) value)->getValue();
+                break;
+            case ValueType::DOUBLE:
+                *(jdouble *) address = ((doubleOop) value)->getValue();
+                break;
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                *(oop *) address = value;
+                Universe::writeBarrier(address);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE_M("Unrecognized field value type");
+        }
+    }
+}
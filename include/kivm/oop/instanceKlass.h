@@ -22,11 +22,27 @@ namespace kivm {
 
     class BootstrapMethods_attribute;
 
+    /**
+     * Subclasses of {@code java.lang.ref.Reference} whose referents
+     * are treated specially by collectors, see {@code ReferenceProcessor}.
+     */
+    enum ReferenceType {
+        REF_NONE,
+        REF_SOFT,
+        REF_WEAK,
+        REF_FINAL,
+        REF_PHANTOM,
+    };
+
     class InstanceKlass : public Klass {
         friend class instanceOopDesc;
 
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
+        friend class HprofWriter;
+
     private:
         ClassLoader *_classLoader = nullptr;
         mirrorOop _javaLoader = nullptr;
@@ -57,22 +73,55 @@ namespace kivm {
          */
         HashMap<String, MethodID *> _vtable;
 
+        /**
+         * methods of {@code _vtable} by {@code Method::getVtableIndex()},
+         * an overriding method takes the index of the overridden one.
+         */
+        std::vector<Method *> _vtableMethods;
+
         /**
          * static fields.
-         * map<className + " " + name + " " + descriptor, <vector-offset, Field*>>
+         * map<className + " " + name + " " + descriptor, <byte-offset, Field*>>
          */
         HashMap<String, FieldID *> _staticFields;
 
         /**
          * instance fields.
-         * map<className + " " + name + " " + descriptor, <vector-offset, Field*>>
+         * map<className + " " + name + " " + descriptor, <byte-offset, Field*>>
          */
         HashMap<String, FieldID *> _instanceFields;
 
         /**
-         * static fields' values.
+         * static fields' values, stored unboxed.
+         */
+        jbyte *_staticFieldValues = nullptr;
+
+        /**
+         * size of static field values in bytes.
+         */
+        size_t _staticFieldSize = 0;
+
+        /**
+         * size of instance field values in bytes,
+         * including fields inherited from superclasses.
+         */
+        size_t _instanceFieldSize = 0;
+
+        /**
+         * size of the C++ object header that precedes instance field values.
+         */
+        size_t _instanceHeaderSize = 0;
+
+        /**
+         * offsets of reference-typed static fields, used by GC.
+         */
+        std::vector<int> _staticOopOffsets;
+
+        /**
+         * offsets of reference-typed instance fields
+         * (including inherited ones), used by GC.
          */
-        std::vector<oop> _staticFieldValues;
+        std::vector<int> _instanceOopOffsets;
 
         /**
          * interfaces
@@ -80,6 +129,12 @@ namespace kivm {
          */
         HashMap<String, InstanceKlass *> _interfaces;
 
+        /**
+         * Inherited from the superclass, except for the
+         * reference classes in {@code java.lang.ref}.
+         */
+        ReferenceType _referenceType = REF_NONE;
+
     private:
         InstanceKlass *requireInstanceClass(u2 classInfoIndex);
 
@@ -93,6 +148,21 @@ namespace kivm {
 
         void linkFields(cp_info **pool);
 
+        /**
+         * Must be called after fields are linked.
+         */
+        void linkReferenceType();
+
+        /**
+         * Assign byte offsets to fields, starting at {@code start}.
+         * Wider fields are placed first so that every field is
+         * naturally aligned without padding between them.
+         * @return end of the layout, aligned to 8 bytes
+         */
+        size_t layoutFields(const std::vector<Field *> &fields, size_t start,
+                            HashMap<String, FieldID *> &fieldIDs,
+                            std::vector<int> &oopOffsets);
+
         void linkAttributes(cp_info **pool);
 
     public:
@@ -127,6 +197,36 @@ namespace kivm {
             return _instanceFields;
         }
 
+        inline size_t getInstanceFieldSize() const {
+            return _instanceFieldSize;
+        }
+
+        inline size_t getInstanceHeaderSize() const {
+            return _instanceHeaderSize;
+        }
+
+        inline const std::vector<int> &getInstanceOopOffsets() const {
+            return _instanceOopOffsets;
+        }
+
+        inline ReferenceType getReferenceType() const {
+            return _referenceType;
+        }
+
+        inline jbyte *getStaticFieldValues() const {
+            return _staticFieldValues;
+        }
+
+        /**
+         * Get the raw address of a static field.
+         * @param offset field offset in bytes, see {@code FieldID::_offset}
+         * @return typed pointer to field value
+         */
+        template <typename T>
+        inline T *getStaticFieldAddress(int offset) const {
+            return (T *) (_staticFieldValues + offset);
+        }
+
         inline const HashMap<String, MethodID *> &getDeclaredMethods() const {
             return _allMethods;
         }
@@ -163,7 +263,7 @@ namespace kivm {
          * @param className Where the wanted field belongs to
          * @param name Field name
          * @param descriptor Field descriptor
-         * @return vector offset if found, otherwise -1
+         * @return byte offset if found, otherwise -1
          */
         int getStaticFieldOffset(const String &className,
                                  const String &name,
@@ -207,6 +307,15 @@ namespace kivm {
          */
         Method *getVirtualMethod(const String &name, const String &descriptor) const;
 
+        /**
+         * Get virtual method by vtable index.
+         * @param vtableIndex index of a method of this class or a superclass
+         * @return the method which overrides it last
+         */
+        inline Method *getVirtualMethod(int vtableIndex) const {
+            return _vtableMethods[vtableIndex];
+        }
+
         /**
          * Get static method.
          * @param name Method name
@@ -309,15 +418,21 @@ namespace kivm {
         bool getInstanceFieldValue(instanceOop receiver, FieldID *fieldID, oop *result);
 
         /**
-         * Get instance field's value.
+         * Get instance field's raw address.
          * @param receiver Java object that contains the wanted field
          * @param offset field offset
          * @param result pointer to result
          * @return {@code true} if found, otherwise {@code false}
          */
-        bool getInstanceFieldValueUnsafe(instanceOop receiver, int offset, oop **result);
+        bool getInstanceFieldValueUnsafe(instanceOop receiver, int offset, jbyte **result);
 
-        bool getStaticFieldValueUnsafe(int offset, oop **result);
+        /**
+         * Get static field's raw address.
+         * @param offset field offset
+         * @param result pointer to result
+         * @return {@code true} if found, otherwise {@code false}
+         */
+        bool getStaticFieldValueUnsafe(int offset, jbyte **result);
 
         instanceOop newInstance();
 
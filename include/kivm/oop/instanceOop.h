@@ -5,21 +5,12 @@
 
 #include <kivm/oop/oop.h>
 #include <kivm/oop/instanceKlass.h>
-#include <vector>
 
 namespace kivm {
     class instanceOopDesc : public oopDesc {
         friend class InstanceKlass;
         friend class CopyingHeap;
 
-        std::vector<oop> _instanceFieldValues;
-
-    private:
-        explicit instanceOopDesc(instanceOop other)
-            : oopDesc(other->getClass(), other->getMarkOop()->getOopType()),
-              _instanceFieldValues(other->_instanceFieldValues) {
-        }
-
     public:
         explicit instanceOopDesc(InstanceKlass *klass);
 
@@ -29,8 +20,30 @@ namespace kivm {
             return (InstanceKlass *) getClass();
         }
 
-        inline instanceOop copy() override {
-            return new instanceOopDesc(this);
+        instanceOop copy() override;
+
+        inline size_t getObjectSize() const override {
+            auto klass = getInstanceClass();
+            return klass->getInstanceHeaderSize() + klass->getInstanceFieldSize();
+        }
+
+        /**
+         * Instance fields are stored unboxed right after the object header,
+         * using the layout computed in {@code InstanceKlass::linkFields()}.
+         * @return start address of instance field values
+         */
+        inline jbyte *getFieldValues() {
+            return ((jbyte *) this) + getInstanceClass()->getInstanceHeaderSize();
+        }
+
+        /**
+         * Get the raw address of an instance field.
+         * @param offset field offset in bytes, see {@code FieldID::_offset}
+         * @return typed pointer to field value
+         */
+        template <typename T>
+        inline T *getFieldAddress(int offset) {
+            return (T *) (getFieldValues() + offset);
         }
 
         /**
@@ -88,13 +101,12 @@ namespace kivm {
 
         /**
          * Mirrored from {@code InstanceKlass}
-         * Get instance field's value.
-         * @param receiver Java object that contains the wanted field
+         * Get instance field's raw address.
          * @param offset field offset
          * @param result pointer to result
          * @return {@code true} if found, otherwise {@code false}
          */
-        inline bool getFieldValueUnsafe(int offset, oop **result) {
+        inline bool getFieldValueUnsafe(int offset, jbyte **result) {
             return getInstanceClass()->getInstanceFieldValueUnsafe(this, offset, result);
         }
     };
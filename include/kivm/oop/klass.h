@@ -28,6 +28,8 @@ namespace kivm {
     class Klass {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
     private:
         ClassState _state;
         u2 _accessFlag;
@@ -25,7 +25,17 @@ namespace kivm {
 
     class JavaNativeMethod;
 
+    class OopMap;
+
+    class EscapeAnalysis;
+
+    class DecodedCode;
+
     class Method {
+        friend class OopMap;
+
+        friend class InstanceKlass;
+
     public:
         static bool isSame(const Method *lhs, const Method *rhs);
 
@@ -43,6 +53,18 @@ namespace kivm {
          */
         CodeBlob _codeBlob;
         method_info *_methodInfo = nullptr;
+
+        /**
+         * a private copy of the code, which the interpreter
+         * rewrites into quickened instructions as it runs
+         */
+        CodeBlob _rewrittenCode;
+
+        /**
+         * index in the vtable of the class, -1 for static methods
+         */
+        int _vtableIndex = -1;
+
         Exceptions_attribute *_exceptionAttr = nullptr;
         Code_attribute *_codeAttr = nullptr;
 
@@ -51,6 +73,24 @@ namespace kivm {
          */
         JavaNativeMethod *_nativePointer = nullptr;
 
+        /**
+         * reference slots of frames, only available when
+         * this method has code
+         */
+        OopMap *_oopMap = nullptr;
+
+        /**
+         * NEW sites whose objects never escape, only available
+         * when this method has code
+         */
+        EscapeAnalysis *_escapeAnalysis = nullptr;
+
+        /**
+         * code for the direct threaded interpreter,
+         * translated on the first call
+         */
+        DecodedCode *_decodedCode = nullptr;
+
         /**
          * flags related to descriptor parsing
          */
@@ -153,6 +193,35 @@ namespace kivm {
          */
         const std::list<InstanceKlass *> &getCheckedExceptions();
 
+        /**
+         * Used by GC to find references in frames of this method
+         * @return the oop map, {@code nullptr} if this method has no code
+         */
+        OopMap *getOopMap() const {
+            return _oopMap;
+        }
+
+        /**
+         * Used by the interpreter to allocate objects in frames
+         * @return the escape analysis, {@code nullptr} if this method has no code
+         */
+        EscapeAnalysis *getEscapeAnalysis() const {
+            return _escapeAnalysis;
+        }
+
+        /**
+         * @return the decoded code, {@code nullptr} if this method was not called yet
+         */
+        DecodedCode *getDecodedCode() const {
+            return __atomic_load_n(&_decodedCode, __ATOMIC_ACQUIRE);
+        }
+
+        /**
+         * Keep {@code code} unless another thread decoded this method first.
+         * @return the decoded code this method keeps
+         */
+        DecodedCode *installDecodedCode(DecodedCode *code);
+
     public:
         int findExceptionHandler(u4 currentPc, InstanceKlass *exceptionClass);
 
@@ -184,10 +253,35 @@ namespace kivm {
             return _accessFlag;
         }
 
+        /**
+         * Code in the class file, which analyses read.
+         * @return the original code
+         */
         const CodeBlob &getCodeBlob() const {
             return _codeBlob;
         }
 
+        /**
+         * Code that the interpreter runs, see {@code Quickener}.
+         * Instructions are only ever replaced by quickened ones
+         * of the same length.
+         * @return the rewritten code
+         */
+        CodeBlob &getRewrittenCode() {
+            return _rewrittenCode;
+        }
+
+        int getVtableIndex() const {
+            return _vtableIndex;
+        }
+
+        /**
+         * @return the Code attribute, {@code nullptr} if this method has no code
+         */
+        Code_attribute *getCodeAttribute() const {
+            return _codeAttr;
+        }
+
         bool isLinked() const {
             return _linked;
         }
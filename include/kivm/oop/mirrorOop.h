@@ -15,7 +15,9 @@ namespace kivm {
         ValueType _mirroringPrimitiveType;
 
     public:
-        explicit mirrorOopDesc(Klass *mirror);
+        mirrorOopDesc(InstanceKlass *javaLangClass, Klass *mirror);
+
+        mirrorOop copy() override;
 
         Klass *getTarget() const {
             return _mirrorTarget;
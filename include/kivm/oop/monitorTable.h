@@ -0,0 +1,86 @@
+//
+// Side table of inflated object monitors
+//
+#pragma once
+
+#include <kivm/kivm.h>
+#include <kivm/oop/oopfwd.h>
+#include <shared/monitor.h>
+#include <shared/lock.h>
+#include <utility>
+#include <vector>
+
+namespace kivm {
+    /**
+     * Side table of inflated object monitors.
+     * An object header only stores the index of its monitor,
+     * see {@code markOopDesc}. Index 0 is never used.
+     *
+     * Monitors are stored in fixed-size chunks which never move,
+     * so looking up a monitor needs no lock.
+     *
+     * Headers of young objects with monitors are recorded, so that
+     * minor collections can free monitors of young objects that died,
+     * without waiting for a full collection to sweep the whole table.
+     */
+    class MonitorTable final {
+    private:
+        static constexpr u4 CHUNK_BITS = 12;
+        static constexpr u4 CHUNK_SIZE = 1U << CHUNK_BITS;
+        static constexpr u4 MAX_CHUNKS = 1U << 12;
+
+        static Lock &getLock();
+
+        static Monitor ***getChunks();
+
+        static std::vector<u4> &getFreeIndexes();
+
+        static std::vector<bool> &getLiveIndexes();
+
+        static u4 &getNextIndex();
+
+        static std::vector<std::pair<u4, markOop>> &getYoungOwners();
+
+    public:
+        /**
+         * Create a monitor.
+         * @return index of the monitor
+         */
+        static u4 allocate();
+
+        /**
+         * Delete a monitor that has not been published to any object header,
+         * or whose object is known to be dead.
+         */
+        static void release(u4 index);
+
+        /**
+         * Record the header of an object that may be young,
+         * after its monitor was published.
+         */
+        static void recordYoungOwner(u4 index, markOop owner);
+
+        /**
+         * Called by GC before objects are moved. Survivors that
+         * are still young must be recorded again by the collector.
+         * @return every recorded header, the records are cleared
+         */
+        static std::vector<std::pair<u4, markOop>> takeYoungOwners();
+
+        static inline Monitor *get(u4 index) {
+            return getChunks()[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+        }
+
+        /**
+         * Called by GC for every surviving object that has a monitor.
+         */
+        static void markLive(u4 index);
+
+        /**
+         * Called by GC after all surviving objects are marked,
+         * deletes monitors of dead objects.
+         * @return number of monitors deleted
+         */
+        static size_t sweep();
+    };
+}
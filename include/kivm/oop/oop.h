@@ -9,6 +9,7 @@
 #include <kivm/oop/klass.h>
 #include <shared/lock.h>
 #include <shared/monitor.h>
+#include <shared/atomic.h>
 #include <list>
 
 namespace kivm {
@@ -25,6 +26,12 @@ namespace kivm {
 
         static void *operator new(size_t size, bool = true) noexcept;
 
+        /**
+         * Allocate an object with {@code extraSize} bytes of
+         * trailing storage (instance fields, array elements).
+         */
+        static void *operator new(size_t size, size_t extraSize) noexcept;
+
         static void *operator new(size_t size, const std::nothrow_t &) noexcept = delete;
 
         static void *operator new[](size_t size, bool = true) throw();
@@ -36,58 +43,153 @@ namespace kivm {
         static void operator delete[](void *ptr);
     };
 
+    /**
+     * The object header word, embedded in every object.
+     *
+     *   63         62 ...... 32      31 ...... 3     2             1 ... 0
+     *   [forwarded] [identity hash] [monitor index] [has monitor] [oop type]
+     *
+     * Monitors are inflated into {@code MonitorTable} only when an object
+     * is actually synchronized on or waited on.
+     *
+     * During GC, the header of an evacuated object is overwritten with
+     * the address of its new copy and the forwarded bit. The original
+     * header word lives on in the copy. A compacting collector keeps
+     * the oop type as well, and preserves other bits aside.
+     *
+     * Parallel GC workers race to evacuate the same object, the winner
+     * claims it first by installing the forwarded bit alone, others wait
+     * until the forwarding address is published.
+     */
     class markOopDesc final {
     private:
-        oopType _type;
-        Monitor _monitor;
-        jint _hash;
+        static constexpr u8 TYPE_MASK = 0x3;
+        static constexpr u8 MONITOR_BIT = 0x4;
+        static constexpr int MONITOR_SHIFT = 3;
+        static constexpr u8 MONITOR_MASK = 0x1fffffff;
+        static constexpr int HASH_SHIFT = 32;
+        static constexpr u8 FORWARDED_BIT = 1ULL << 63;
+
+    public:
+        static constexpr u8 HASH_MASK = 0x7fffffff;
+
+    private:
+        volatile u8 _value;
 
     public:
         explicit markOopDesc(oopType type);
 
-        oopType getOopType() const { return _type; }
+        /**
+         * Get the monitor of this object, inflate one if not exists.
+         * The monitor stays where it is when the object moves.
+         */
+        Monitor *getMonitor();
+
+        oopType getOopType() const { return (oopType) (_value & TYPE_MASK); }
+
+        inline u8 getValue() const {
+            return _value;
+        }
+
+        inline void setValue(u8 value) {
+            this->_value = value;
+        }
+
+        inline bool hasMonitor() const {
+            return (_value & MONITOR_BIT) != 0;
+        }
+
+        inline u4 getMonitorIndex() const {
+            return (u4) ((_value >> MONITOR_SHIFT) & MONITOR_MASK);
+        }
 
         void monitorEnter() {
-            _monitor.enter();
+            getMonitor()->enter();
         }
 
         void monitorExit() {
-            _monitor.leave();
+            getMonitor()->leave();
         }
 
-        inline void setHash(jint hash) {
-            this->_hash = hash;
-        }
+        /**
+         * Only the lower 31 bits of hash are kept.
+         */
+        void setHash(jint hash);
 
         inline jint getHash() const {
-            return this->_hash;
+            return (jint) ((_value >> HASH_SHIFT) & HASH_MASK);
+        }
+
+        inline bool isForwarded() const {
+            return (_value & FORWARDED_BIT) != 0;
+        }
+
+        inline oop getForwardee() const {
+            assert(isForwarded());
+            return (oop) (_value & ~(FORWARDED_BIT | TYPE_MASK));
+        }
+
+        inline void forwardTo(oop forwardee) {
+            this->_value = FORWARDED_BIT | (u8) forwardee;
         }
 
-        inline void wait() { _monitor.wait(); }
+        /**
+         * Like {@code forwardTo()}, but {@code getOopType()} still works,
+         * for collectors that walk forwarded objects in place.
+         */
+        inline void forwardKeepingType(oop forwardee) {
+            this->_value = FORWARDED_BIT | (u8) forwardee | (_value & TYPE_MASK);
+        }
+
+        /**
+         * Claim this object for evacuation.
+         * @param value the header word read before, which must not be forwarded
+         * @return false if another thread claimed it first
+         */
+        inline bool tryClaim(u8 value) {
+            return cmpxchg(&_value, value, FORWARDED_BIT) == value;
+        }
 
-        inline void wait(jlong timeout) { _monitor.wait((jlong) timeout); }
+        /**
+         * Wait until the claiming thread publishes the forwarding address.
+         */
+        inline oop waitForForwardee() const {
+            while (_value == FORWARDED_BIT) {
+                std::this_thread::yield();
+            }
+            return getForwardee();
+        }
 
-        inline void notify() { _monitor.notify(); }
+        inline void wait() { getMonitor()->wait(); }
 
-        inline void notifyAll() { _monitor.notifyAll(); }
+        inline void wait(jlong timeout) { getMonitor()->wait((jlong) timeout); }
 
-        inline void forceUnlockWhenExceptionOccurred() { _monitor.forceUnlock(); }
+        inline void notify() { getMonitor()->notify(); }
+
+        inline void notifyAll() { getMonitor()->notifyAll(); }
+
+        inline void forceUnlockWhenExceptionOccurred() { getMonitor()->forceUnlock(); }
     };
 
     class oopDesc : public GCJavaObject {
     private:
-        markOop _mark = nullptr;
+        mutable markOopDesc _mark;
         Klass *_klass = nullptr;
 
     public:
         explicit oopDesc(Klass *klass, oopType type);
 
-        ~oopDesc() override;
+        ~oopDesc() override = default;
 
-        markOop getMarkOop() const { return _mark; }
+        markOop getMarkOop() const { return &_mark; }
 
         Klass *getClass() const { return _klass; }
 
         virtual oop copy() = 0;
+
+        /**
+         * @return bytes occupied by this object in heap, including header
+         */
+        virtual size_t getObjectSize() const = 0;
     };
 }
@@ -49,6 +49,10 @@ namespace kivm {
             : oopDesc(nullptr, oopType::PRIMITIVE_OOP), _value(value) {
         }
 
+        size_t getObjectSize() const override {
+            return sizeof(primitiveOopDesc<T>);
+        }
+
         ValueType getPrimitiveType() const {
             return PrimitiveHelper<T>::getValueType();
         }
@@ -9,6 +9,11 @@
 
 namespace kivm {
     struct FieldID {
+        /**
+         * Byte offset of the field value, relative to
+         * {@code instanceOopDesc::getFieldValues()} for instance fields
+         * or {@code InstanceKlass::getStaticFieldValues()} for static fields.
+         */
         int _offset;
         Field *_field = nullptr;
 
@@ -149,6 +154,35 @@ namespace kivm {
         }
     }
 
+    /**
+     * Size of a field value of type {@code v} stored unboxed.
+     */
+    inline size_t valueTypeSizeOf(ValueType v) {
+        switch (v) {
+            case ValueType::BOOLEAN:
+                return sizeof(jboolean);
+            case ValueType::BYTE:
+                return sizeof(jbyte);
+            case ValueType::CHAR:
+                return sizeof(jchar);
+            case ValueType::SHORT:
+                return sizeof(jshort);
+            case ValueType::INT:
+                return sizeof(jint);
+            case ValueType::FLOAT:
+                return sizeof(jfloat);
+            case ValueType::LONG:
+                return sizeof(jlong);
+            case ValueType::DOUBLE:
+                return sizeof(jdouble);
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                return sizeof(oop);
+            default:
+                SHOULD_NOT_REACH_HERE_M("field type required");
+        }
+    }
+
     mirrorOop getClassFromConstructor(instanceOop ctorOop);
 
     jint getSlotFromConstructor(instanceOop ctorOop);
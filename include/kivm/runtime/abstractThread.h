@@ -23,6 +23,11 @@ namespace kivm {
 
         virtual void onThreadLaunched();
 
+        /**
+         * Called in the new thread, right before {@code run()}.
+         */
+        virtual void onThreadStarted();
+
     public:
         AbstractThread();
 
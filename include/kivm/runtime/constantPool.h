@@ -11,6 +11,7 @@
 #include <kivm/oop/method.h>
 #include <kivm/oop/field.h>
 #include <kivm/memory/universe.h>
+#include <cstring>
 
 namespace kivm {
     class Klass;
@@ -62,14 +63,6 @@ namespace kivm {
             }
         };
 
-        template<typename PrimitiveType, typename EntryType>
-        struct PrimitiveConstantCreator {
-            inline PrimitiveType *operator()(RuntimeConstantPool *rt, cp_info **pool, int index) {
-                auto primitiveInfo = (EntryType *) pool[index];
-                return new PrimitiveType(primitiveInfo->getConstant());
-            }
-        };
-
         struct Utf8ConstantCreator {
             inline String *operator()(RuntimeConstantPool *rt, cp_info **pool, int index) {
                 auto primitiveInfo = (CONSTANT_Utf8_info *) pool[index];
@@ -106,10 +99,6 @@ namespace kivm {
         };
 
 
-        using IntegerPool = Pool<jint *, PrimitiveConstantCreator<jint, CONSTANT_Integer_info>, CONSTANT_Integer>;
-        using FloatPool = Pool<jfloat *, PrimitiveConstantCreator<jfloat, CONSTANT_Float_info>, CONSTANT_Float>;
-        using LongPool = Pool<jlong *, PrimitiveConstantCreator<jlong, CONSTANT_Long_info>, CONSTANT_Long>;
-        using DoublePool = Pool<jdouble *, PrimitiveConstantCreator<jdouble, CONSTANT_Double_info>, CONSTANT_Double>;
         using Utf8Pool = Pool<Utf8PoolEntry, Utf8ConstantCreator, CONSTANT_Utf8>;
         using NameAndTypePool = Pool<NameAndTypePoolEntry, NameAndTypeCreator, CONSTANT_NameAndType>;
         using InvokeDynamicPool = Pool<InvokeDynamicPoolEntry, InvokeDynamicCreator, CONSTANT_InvokeDynamic>;
@@ -121,15 +110,50 @@ namespace kivm {
         using InstanceFieldPool = Pool<FieldPoolEntry, InstanceFieldCreator, CONSTANT_Fieldref>;
     }
 
+    /**
+     * What a quickened instruction needs from a field, class or method
+     * constant, filled in when an instruction using the constant is
+     * first executed, see {@code Quickener}. Entries hold no oops.
+     */
+    struct ResolvedEntry {
+        /**
+         * class of NEW, holder of a static field
+         */
+        InstanceKlass *_klass = nullptr;
+
+        /**
+         * method called directly, or the one whose vtable index is used
+         */
+        Method *_method = nullptr;
+
+        /**
+         * byte offset of a field
+         */
+        int _offset = 0;
+        ValueType _valueType = ValueType::VOID;
+
+        /**
+         * slots taken by the arguments of {@code _method},
+         * the receiver of a virtual call is right below them
+         */
+        int _argumentSlots = 0;
+    };
+
     class RuntimeConstantPool final {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
+        friend class HprofWriter;
+
     private:
         ClassLoader *_classLoader = nullptr;
         cp_info **_rawPool = nullptr;
         // constant-pool-index -> constant
         void **_pool = nullptr;
         int _entryCount;
+        // constant-pool-index -> resolved entry
+        ResolvedEntry *_resolvedEntries = nullptr;
 
         pools::ClassPool _classPool;
         pools::StringPool _stringPool;
@@ -139,10 +163,23 @@ namespace kivm {
         pools::NameAndTypePool _nameAndTypePool;
         pools::InvokeDynamicPool _invokeDynamicPool;
         pools::Utf8Pool _utf8Pool;
-        pools::IntegerPool _intPool;
-        pools::FloatPool _floatPool;
-        pools::LongPool _longPool;
-        pools::DoublePool _doublePool;
+
+        /**
+         * Numeric constants are decoded once, into their own slots
+         * of {@code _pool}, instead of being boxed.
+         */
+        void decodePrimitiveConstants();
+
+        template<typename T>
+        inline T getPrimitive(int index, int tag) {
+            assert(this->_rawPool != nullptr);
+            if (_rawPool[index]->tag != tag) {
+                PANIC("Accessing an incompatible constant entry may cause undefined behavior, panicked.");
+            }
+            T value;
+            memcpy(&value, &_pool[index], sizeof(T));
+            return value;
+        }
 
     public:
         explicit RuntimeConstantPool(InstanceKlass *instanceKlass);
@@ -151,18 +188,16 @@ namespace kivm {
             this->_entryCount = count;
             this->_rawPool = rawPool;
             this->_pool = (void **) Universe::allocCObject(sizeof(void *) * count);
+            this->_resolvedEntries = new ResolvedEntry[count];
             _classPool.setRawPool(rawPool, _pool);
             _stringPool.setRawPool(rawPool, _pool);
             _methodPool.setRawPool(rawPool, _pool);
             _staticFieldPool.setRawPool(rawPool, _pool);
             _instanceFieldPool.setRawPool(rawPool, _pool);
-            _intPool.setRawPool(rawPool, _pool);
-            _floatPool.setRawPool(rawPool, _pool);
-            _longPool.setRawPool(rawPool, _pool);
-            _doublePool.setRawPool(rawPool, _pool);
             _utf8Pool.setRawPool(rawPool, _pool);
             _nameAndTypePool.setRawPool(rawPool, _pool);
             _invokeDynamicPool.setRawPool(rawPool, _pool);
+            decodePrimitiveConstants();
         }
 
         inline cp_info **getRawPool() {
@@ -213,24 +248,35 @@ namespace kivm {
             return _invokeDynamicPool.findOrNew(this, index);
         }
 
+        inline ResolvedEntry *getResolvedEntry(int index) {
+            return _resolvedEntries + index;
+        }
+
+        /**
+         * Read a constant that has been loaded before, by a quickened
+         * instruction, so the tag is not checked again.
+         */
+        template<typename T>
+        inline T getResolved(int index) {
+            T value;
+            memcpy(&value, &_pool[index], sizeof(T));
+            return value;
+        }
+
         inline jint getInt(int index) {
-            assert(this->_rawPool != nullptr);
-            return *_intPool.findOrNew(this, index);
+            return getPrimitive<jint>(index, CONSTANT_Integer);
         }
 
         inline jlong getLong(int index) {
-            assert(this->_rawPool != nullptr);
-            return *_longPool.findOrNew(this, index);
+            return getPrimitive<jlong>(index, CONSTANT_Long);
         }
 
         inline jfloat getFloat(int index) {
-            assert(this->_rawPool != nullptr);
-            return *_floatPool.findOrNew(this, index);
+            return getPrimitive<jfloat>(index, CONSTANT_Float);
         }
 
         inline jdouble getDouble(int index) {
-            assert(this->_rawPool != nullptr);
-            return *_doublePool.findOrNew(this, index);
+            return getPrimitive<jdouble>(index, CONSTANT_Double);
         }
     };
 }
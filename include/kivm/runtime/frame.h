@@ -5,6 +5,7 @@
 
 #include <kivm/runtime/stack.h>
 #include <cassert>
+#include <vector>
 
 namespace kivm {
     class Method;
@@ -14,6 +15,8 @@ namespace kivm {
 
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
     private:
         Frame *_previous = nullptr;
         Method *_method = nullptr;
@@ -25,6 +28,12 @@ namespace kivm {
         Locals _locals;
         Stack _stack;
 
+        /**
+         * Objects of reusable frame local sites, by site index,
+         * allocated in the frame arena. See EscapeAnalysis.
+         */
+        std::vector<void *> _frameLocalObjects;
+
     public:
         Frame(int maxLocals, int maxStacks);
 
@@ -71,11 +80,24 @@ namespace kivm {
         inline void setExceptionThrownHere(bool here) {
             this->_exceptionThrownHere = here;
         }
+
+        inline void *getFrameLocalObject(int site) const {
+            return site < (int) _frameLocalObjects.size() ? _frameLocalObjects[site] : nullptr;
+        }
+
+        inline void setFrameLocalObject(int site, int siteCount, void *object) {
+            if (_frameLocalObjects.empty()) {
+                _frameLocalObjects.resize((size_t) siteCount, nullptr);
+            }
+            _frameLocalObjects[site] = object;
+        }
     };
 
     struct FrameList {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
     private:
         int _max_frames;
         int _size;
@@ -7,8 +7,13 @@
 #include <kivm/oop/instanceOop.h>
 #include <kivm/runtime/stack.h>
 #include <kivm/runtime/frame.h>
+#include <kivm/memory/threadLocalAllocBuffer.h>
+#include <kivm/memory/frameArena.h>
+#include <kivm/memory/satbMarkQueue.h>
+#include <kivm/memory/gcThread.h>
 #include <list>
 #include <functional>
+#include <condition_variable>
 
 namespace kivm {
     // The Java app thread
@@ -21,6 +26,10 @@ namespace kivm {
 
         friend class ThreadedInterpreter;
 
+        friend class DirectThreadedInterpreter;
+
+        friend class TemplateInterpreter;
+
         friend class ScratchInterpreter;
 
         friend class JavaCall;
@@ -29,8 +38,14 @@ namespace kivm {
 
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
+        friend class HprofWriter;
+
         friend class FrameWalker;
 
+        friend class RecoverableAllocation;
+
     protected:
         FrameList _frames;
         std::list<oop> _args;
@@ -40,6 +55,28 @@ namespace kivm {
         instanceOop _javaThreadObject = nullptr;
         instanceOop _exceptionOop = nullptr;
 
+        /**
+         * Object whose monitor the thread blocks on, see {@code blockInSafeRegion()}.
+         * Nothing else may hold it while the thread blocks.
+         */
+        oop _blockedOn = nullptr;
+
+        /**
+         * Primitive result of the method the interpreter returned from,
+         * {@code JavaCall} pushes it onto the caller's stack without a box.
+         */
+        jvalue _returnValue{};
+
+        ThreadLocalAllocBuffer _tlab;
+        SatbMarkQueue _satbQueue;
+        FrameArena _frameArena;
+
+        /**
+         * Non-zero while the caller of an allocation checks for nullptr,
+         * see {@code RecoverableAllocation}.
+         */
+        int _recoverableAllocations = 0;
+
         // note: this is not the current method
         // use getCurrentMethod() instead
         Method *_method = nullptr;
@@ -47,8 +84,17 @@ namespace kivm {
     protected:
         void run() override;
 
+        void onThreadStarted() override;
+
         int tryHandleException(instanceOop exceptionOop);
 
+        /**
+         * Run {@code operation}, which blocks without touching the heap,
+         * as if the thread were stopped at a safepoint, so that collections
+         * need not wait for it. {@code object} is kept alive meanwhile.
+         */
+        void blockInSafeRegion(oop object, const std::function<void()> &operation);
+
         void setJavaThreadObject(instanceOop javaThread) {
             this->_javaThreadObject = javaThread;
         }
@@ -70,7 +116,34 @@ namespace kivm {
 
         void enterSafepoint();
 
-        void enterSafepointIfNeeded();
+        /**
+         * Enter the monitor of {@code object}, collections may run
+         * while another thread owns it.
+         */
+        void monitorEnter(oop object);
+
+        void monitorExit(oop object);
+
+        /**
+         * {@code Object.wait()}, which waits forever if {@code timeout} is 0.
+         */
+        void monitorWait(oop object, jlong timeout);
+
+        /**
+         * {@code Thread.sleep()}
+         */
+        void sleep(jlong millis);
+
+        /**
+         * Safepoint poll, cheap enough for every backward branch
+         * and method return: only a load of the global poll flag
+         * unless a GC is waiting for threads to stop.
+         */
+        inline void enterSafepointIfNeeded() {
+            if (GCThread::isSafepointPollArmed()) {
+                enterSafepoint();
+            }
+        }
 
         inline u4 getPc() const {
             return _pc;
@@ -95,6 +168,22 @@ namespace kivm {
             return _frames.getCurrentFrame()->getMethod();
         }
 
+        inline ThreadLocalAllocBuffer &getTlab() {
+            return _tlab;
+        }
+
+        inline SatbMarkQueue &getSatbQueue() {
+            return _satbQueue;
+        }
+
+        inline FrameArena &getFrameArena() {
+            return _frameArena;
+        }
+
+        inline bool isAllocationRecoverable() const {
+            return _recoverableAllocations > 0;
+        }
+
         inline bool isExceptionOccurred() const {
             return _exceptionOop != nullptr;
         }
@@ -104,6 +193,36 @@ namespace kivm {
         }
     };
 
+    /**
+     * Allocations made while this is alive return nullptr with a pending
+     * OutOfMemoryError when the heap is exhausted. Anywhere else running
+     * out of heap is fatal, because the VM does not check the result.
+     * Keep the scope around the allocation only: Java code called from
+     * inside it would make every allocation it reaches recoverable.
+     */
+    class RecoverableAllocation final {
+    private:
+        JavaThread *_thread;
+
+    public:
+        explicit RecoverableAllocation(JavaThread *thread)
+            : _thread(thread) {
+            if (_thread != nullptr) {
+                ++_thread->_recoverableAllocations;
+            }
+        }
+
+        ~RecoverableAllocation() {
+            if (_thread != nullptr) {
+                --_thread->_recoverableAllocations;
+            }
+        }
+
+        RecoverableAllocation(const RecoverableAllocation &) = delete;
+
+        RecoverableAllocation &operator=(const RecoverableAllocation &) = delete;
+    };
+
     // The Java main thread
     // implemented in src/kivm/runtime/init.cpp
     class JavaMainThread : public JavaThread {
@@ -138,6 +257,11 @@ namespace kivm {
             return appThreadCount;
         }
 
+        static std::condition_variable &getJavaThreadDeadCondition() {
+            static std::condition_variable condition;
+            return condition;
+        }
+
         static std::vector<JavaThread *> &getJavaThreadList() {
             static std::vector<JavaThread *> appThreads;
             return appThreads;
@@ -147,10 +271,25 @@ namespace kivm {
 
         static void hackJavaClasses(BootstrapClassLoader *cl, JavaMainThread *thread);
 
+        static JavaThread *&getCurrentThreadLocal() {
+            static thread_local JavaThread *currentThread = nullptr;
+            return currentThread;
+        }
+
     public:
         static void initializeJVM(JavaMainThread *thread);
 
-        static JavaThread *currentThread();
+        /**
+         * @return the JavaThread running on the calling native thread,
+         *         or {@code nullptr} if it is not a JavaThread
+         */
+        static inline JavaThread *currentThread() {
+            return getCurrentThreadLocal();
+        }
+
+        static inline void setCurrentThread(JavaThread *javaThread) {
+            getCurrentThreadLocal() = javaThread;
+        }
 
         static JavaThread *searchNativeThread(instanceOop threadObject);
 
@@ -180,6 +319,27 @@ namespace kivm {
             ++Threads::getRunningJavaThreadCount();
         }
 
+        /**
+         * Like {@code addJavaThread()}, but the thread only counts as
+         * running while it is attached, see {@code GCThread::attachJavaThread()}.
+         */
+        static inline void addDetachedJavaThread(JavaThread *javaThread) {
+            LockGuard lockGuard(appThreadLock());
+            D("Adding detached thread: %p", javaThread);
+            getJavaThreadList().push_back(javaThread);
+        }
+
+        static inline void attachJavaThreadLocked() {
+            LockGuard lockGuard(appThreadLock());
+            ++Threads::getRunningJavaThreadCount();
+        }
+
+        static inline void detachJavaThreadLocked() {
+            LockGuard lockGuard(appThreadLock());
+            --Threads::getRunningJavaThreadCount();
+            getJavaThreadDeadCondition().notify_all();
+        }
+
         static inline int getRunningJavaThreadCountLocked() {
             LockGuard lockGuard(appThreadLock());
             int threads = Threads::getRunningJavaThreadCount();
@@ -189,6 +349,17 @@ namespace kivm {
         static inline void notifyJavaThreadDeadLocked(JavaThread *javaThread) {
             LockGuard lockGuard(appThreadLock());
             --Threads::getRunningJavaThreadCount();
+            getJavaThreadDeadCondition().notify_all();
+        }
+
+        /**
+         * Block until no Java thread is running.
+         */
+        static inline void waitForJavaThreadsDeadLocked() {
+            std::unique_lock<Lock> lock(appThreadLock());
+            getJavaThreadDeadCondition().wait(lock, [] {
+                return Threads::getRunningJavaThreadCount() <= 0;
+            });
         }
 
         static inline void setThreadStateLocked(JavaThread *javaThread, ThreadState newState) {
@@ -0,0 +1,44 @@
+//
+// Thread running Cleaners and enqueueing processed references
+//
+#pragma once
+
+#include <kivm/runtime/javaThread.h>
+
+namespace kivm {
+    /**
+     * Takes references cleared by collectors from the pending list
+     * of {@code ReferenceProcessor}, and enqueues them onto their
+     * ReferenceQueues. {@code sun.misc.Cleaner}s are run instead.
+     *
+     * It replaces {@code java.lang.ref.Reference$ReferenceHandler}, which
+     * waits in {@code Object.wait()} as a running thread, and would keep
+     * every collection from reaching its safepoint. This one is detached
+     * while it waits, and only counts as running while it calls Java code.
+     */
+    class ReferenceHandlerThread : public JavaThread {
+    private:
+        /**
+         * Run {@code Cleaner.clean()} or {@code ReferenceQueue.enqueue()}.
+         */
+        void handle(instanceOop reference);
+
+        /**
+         * Handle every reference in the pending list.
+         */
+        void handlePendingList();
+
+    protected:
+        void run() override;
+
+    public:
+        ReferenceHandlerThread();
+
+        /**
+         * @param javaThread the {@code Reference$ReferenceHandler} object
+         */
+        void start(instanceOop javaThread);
+
+        void onDestroy() override;
+    };
+}
@@ -4,12 +4,109 @@
 #pragma once
 
 #include <shared/types.h>
+#include <string>
 
 namespace kivm {
+    enum HeapType {
+        HEAP_COPYING,
+        HEAP_MARK_COMPACT,
+        HEAP_CONCURRENT_MARK_SWEEP,
+    };
+
+    enum HeapPageType {
+        HEAP_PAGES_DEFAULT,
+        /**
+         * Ask the kernel for transparent huge pages with madvise().
+         */
+        HEAP_PAGES_TRANSPARENT,
+        /**
+         * Take huge pages from the hugetlb pool,
+         * falls back to default pages if the pool is empty.
+         */
+        HEAP_PAGES_HUGETLB,
+    };
+
+    enum HeapNumaPolicy {
+        HEAP_NUMA_DEFAULT,
+        HEAP_NUMA_INTERLEAVE,
+        HEAP_NUMA_BIND,
+    };
+
     struct RuntimeConfig final {
         int threadMaxStackFrames;
         size_t initialHeapSizeInBytes;
         size_t maxHeapSizeInBytes;
+        size_t tlabSizeInBytes;
+
+        /**
+         * Objects at least this large are never copied by the collector,
+         * they live in the large object space of the copying heap.
+         */
+        size_t largeObjectThresholdInBytes;
+        int gcWorkerThreads;
+        HeapType heapType;
+
+        /**
+         * How the Java heap is backed, see {@code Universe::reserveHeapVirtual()}.
+         * {@code heapNumaNode} is only used by {@code HEAP_NUMA_BIND}.
+         */
+        HeapPageType heapPageType;
+        bool heapPreTouch;
+        HeapNumaPolicy heapNumaPolicy;
+        int heapNumaNode;
+
+        /**
+         * Write GC events as JSON lines, to {@code gcLogPath}
+         * or to stdout if it is empty.
+         */
+        bool gcLogEnabled;
+        std::string gcLogPath;
+
+        /**
+         * Where heap dumps are written, a file or a directory.
+         * If it is empty, dumps are written to {@code java_pid<pid>.hprof}.
+         */
+        std::string heapDumpPath;
+        bool heapDumpOnOutOfMemory;
+        bool heapDumpAtExit;
+
+        /**
+         * Objects that never escape the method allocating them are
+         * allocated in the frame arena of the thread, see {@code EscapeAnalysis}.
+         * When an arena is full, such objects go to the heap instead.
+         */
+        bool doEscapeAnalysis;
+        size_t frameArenaSizeInBytes;
+
+        /**
+         * Soft references are cleared when their referents have not been
+         * read for this many milliseconds per free megabyte of the heap.
+         */
+        jlong softRefLRUPolicyMSPerMB;
+
+        /**
+         * Bit set of the superinstructions to fuse, in the order of
+         * {@code Superinstructions::getAll()}.
+         */
+        u4 superinstructions;
+
+        /**
+         * Run methods from pre-decoded instructions, see
+         * {@code DirectThreadedInterpreter}. Only used by threaded builds.
+         */
+        bool useDirectThreading;
+
+        /**
+         * Run methods in code generated by {@code TemplateInterpreter}.
+         * Only used by builds the template interpreter supports.
+         */
+        bool useTemplateInterpreter;
+
+        /**
+         * Where to write the counts of {@code BytecodeProfile} at exit.
+         * If it is empty, bytecodes are not profiled.
+         */
+        std::string bytecodeProfilePath;
 
         static RuntimeConfig &get();
 
@@ -6,11 +6,12 @@
 #include <shared/types.h>
 
 namespace kivm {
-    struct Slot final {
-        bool isObject;
-        union {
-            jint i32;
-            jobject ref;
-        };
+    /**
+     * A local variable or an operand stack entry.
+     * Slots carry no type, GC finds references in frames with {@code OopMap}.
+     */
+    union Slot {
+        jint i32;
+        jobject ref;
     };
 }
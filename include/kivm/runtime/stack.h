@@ -11,6 +11,10 @@ namespace kivm {
     class SlotArray final {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
+        friend class TemplateInterpreter;
+
     protected:
         Slot *_elements = nullptr;
         int _size;
@@ -21,7 +25,6 @@ namespace kivm {
         inline void setInt(int position, jint i) {
             assert(position >= 0 && position < _size);
             _elements[position].i32 = i;
-            _elements[position].isObject = false;
         }
 
         inline jint getInt(int position) {
@@ -100,7 +103,6 @@ namespace kivm {
         inline void setReference(int position, jobject l) {
             assert(position >= 0 && position < _size);
             _elements[position].ref = l;
-            _elements[position].isObject = true;
         }
 
         inline jobject getReference(int position) {
@@ -115,6 +117,10 @@ namespace kivm {
     class Stack final {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
+        friend class TemplateInterpreter;
+
     private:
         SlotArray _array;
         int _sp;
@@ -168,6 +174,14 @@ namespace kivm {
             return _array.getLong(_sp);
         }
 
+        /**
+         * Read a reference without popping it.
+         * @param depth number of slots above it
+         */
+        inline jobject peekReference(int depth) {
+            return _array.getReference(_sp - 1 - depth);
+        }
+
         inline void dropTop() {
             --_sp;
         }
@@ -180,6 +194,10 @@ namespace kivm {
     class Locals final {
         friend class CopyingHeap;
 
+        friend class GCRoots;
+
+        friend class TemplateInterpreter;
+
     private:
         SlotArray _array;
 
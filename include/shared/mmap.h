@@ -31,5 +31,6 @@ int munmap(void *start, size_t length);
 
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #endif
@@ -39,6 +39,10 @@ namespace kivm {
             _lock.lock();
         }
 
+        bool tryEnter() {
+            return _lock.try_lock();
+        }
+
         void wait() {
             _cond.wait(_lock);
         }
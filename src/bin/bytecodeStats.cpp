@@ -0,0 +1,108 @@
+//
+// Summarizes bytecode profiles written by -XX:BytecodeProfilePath=,
+// the most frequent pairs and triples are the candidates for superinstructions.
+//
+#include <bin/clipp.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+typedef std::map<std::string, unsigned long long> Counts;
+
+static bool readProfile(const std::string &path, Counts &pairs, Counts &triples) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+
+        int length = kind == "pair" ? 2 : kind == "triple" ? 3 : 0;
+        if (length == 0) {
+            continue;
+        }
+
+        std::string sequence;
+        for (int i = 0; i < length; ++i) {
+            std::string opcode;
+            fields >> opcode;
+            sequence += (i == 0 ? "" : " ") + opcode;
+        }
+
+        unsigned long long count = 0;
+        if (fields >> count) {
+            (length == 2 ? pairs : triples)[sequence] += count;
+        }
+    }
+    return true;
+}
+
+static void printTop(const char *title, const Counts &counts, size_t top) {
+    std::vector<std::pair<std::string, unsigned long long>> sorted(counts.begin(), counts.end());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const std::pair<std::string, unsigned long long> &a,
+           const std::pair<std::string, unsigned long long> &b) {
+            return a.second > b.second;
+        });
+
+    unsigned long long total = 0;
+    for (const auto &e : sorted) {
+        total += e.second;
+    }
+
+    std::cout << title << " (" << total << " in total)" << std::endl;
+    for (size_t i = 0; i < sorted.size() && i < top; ++i) {
+        std::cout << std::setw(16) << sorted[i].second
+                  << std::setw(8) << std::fixed << std::setprecision(2)
+                  << 100.0 * sorted[i].second / total << "%  "
+                  << sorted[i].first << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+    using namespace clipp;
+
+    std::vector<std::string> optFiles;
+    std::string optTop = "20";
+    bool optShowHelp = false;
+
+    auto cli = (
+        option("-h", "-help").set(optShowHelp) % "show help",
+        (option("-n") & value("count").set(optTop)) % "number of pairs and triples to show",
+        values("profile", optFiles) % "profiles to sum up"
+    );
+
+    if (!parse(argc, argv, cli) || optShowHelp) {
+        std::cerr << "Usage:\n" << usage_lines(cli, argv[0]) << "\n\n"
+                  << "Options:\n" << documentation(cli) << std::endl;
+        return optShowHelp ? 0 : 1;
+    }
+
+    int top = atoi(optTop.c_str());
+    if (top <= 0) {
+        std::cerr << "Error: invalid count: " << optTop << std::endl;
+        return 1;
+    }
+
+    Counts pairs;
+    Counts triples;
+    for (const auto &file : optFiles) {
+        if (!readProfile(file, pairs, triples)) {
+            std::cerr << "Error: cannot read " << file << std::endl;
+            return 1;
+        }
+    }
+
+    printTop("Pairs", pairs, (size_t) top);
+    printTop("Triples", triples, (size_t) top);
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <kivm/runtime/javaThread.h>
 #include <kivm/classpath/classPathManager.h>
 #include <kivm/runtime/runtimeConfig.h>
+#include <kivm/bytecode/superinstructions.h>
 #include <kivm/test/testFramework.h>
 #include <bin/clipp.h>
 #include <iostream>
@@ -17,6 +18,25 @@ int main(int argc, char **argv) {
     bool optShowHelp = false;
     bool optTestMode = false;
     std::string optTestName;
+    std::string optGCThreads;
+    bool optMarkCompact = false;
+    bool optConcMarkSweep = false;
+    bool optGCLog = false;
+    std::string optGCLogPath;
+    std::string optHeapDumpPath;
+    bool optHeapDumpOnOOM = false;
+    bool optHeapDumpAtExit = false;
+    bool optTransparentHugePages = false;
+    bool optLargePages = false;
+    bool optPreTouch = false;
+    bool optNumaInterleave = false;
+    std::string optNumaNode;
+    bool optNoEscapeAnalysis = false;
+    std::string optSoftRefLRUPolicy;
+    std::string optSuperinstructions;
+    std::string optBytecodeProfilePath;
+    bool optNoDirectThreading = false;
+    bool optNoTemplateInterpreter = false;
 
     auto cli = (
             option("-h", "-help").call([&]() { optShowHelp = true; }) % "show help",
@@ -24,6 +44,26 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "%s: %s\n", argv[0], KIVM_VERSION_STRING);
             }) % "show version",
             (option("-cp") & value("path").set(optClassPath)) % "class search path",
+            (option("-XX:ParallelGCThreads=") & value("count").set(optGCThreads)) % "number of GC worker threads",
+            option("-XX:+UseMarkCompactGC").set(optMarkCompact) % "use the mark-compact heap instead of the copying heap",
+            option("-XX:+UseConcMarkSweepGC").set(optConcMarkSweep) % "use the mostly-concurrent mark-sweep heap instead of the copying heap",
+            // before -Xlog:gc, which would take -Xlog:gc:file as a prefix
+            (option("-Xlog:gc:") & value("file").set(optGCLogPath)) % "write GC events to a file as JSON lines",
+            option("-Xlog:gc").set(optGCLog) % "write GC events to stdout as JSON lines",
+            (option("-XX:HeapDumpPath=") & value("path").set(optHeapDumpPath)) % "file or directory to write heap dumps to",
+            option("-XX:+HeapDumpOnOutOfMemoryError").set(optHeapDumpOnOOM) % "dump the heap on the first OutOfMemoryError",
+            option("-XX:+HeapDumpAtExit").set(optHeapDumpAtExit) % "dump the heap after the last Java thread exits",
+            option("-XX:+UseTransparentHugePages").set(optTransparentHugePages) % "back the heap with transparent huge pages",
+            option("-XX:+UseLargePages").set(optLargePages) % "back the heap with pages from the hugetlb pool",
+            option("-XX:+AlwaysPreTouch").set(optPreTouch) % "touch every heap page when it is committed",
+            option("-XX:+UseNUMAInterleaving").set(optNumaInterleave) % "interleave the heap across NUMA nodes",
+            (option("-XX:NUMANode=") & value("node").set(optNumaNode)) % "bind the heap to a NUMA node",
+            option("-XX:-DoEscapeAnalysis").set(optNoEscapeAnalysis) % "allocate every object in the heap, even if it never escapes its method",
+            (option("-XX:SoftRefLRUPolicyMSPerMB=") & value("ms").set(optSoftRefLRUPolicy)) % "idle time a soft reference survives per free megabyte of heap",
+            (option("-XX:Superinstructions=") & value("names").set(optSuperinstructions)) % "superinstructions to fuse, comma-separated, all or none",
+            (option("-XX:BytecodeProfilePath=") & value("file").set(optBytecodeProfilePath)) % "count bytecode pairs and triples, write them to a file at exit",
+            option("-XX:-UseDirectThreading").set(optNoDirectThreading) % "interpret the bytecodes as they are in class files",
+            option("-XX:-UseTemplateInterpreter").set(optNoTemplateInterpreter) % "interpret the bytecodes in C++ instead of generated code",
             (option("--test") & value("test-name").set(optTestName).call([&]() { optTestMode = true; })) % "run C++ test mode",
             opt_value("class-name", optClassName),
             opt_values("args", optArgs)
@@ -44,6 +84,80 @@ int main(int argc, char **argv) {
         return optShowHelp ? 0 : 1;
     }
 
+    if (!optGCThreads.empty()) {
+        int gcThreads = atoi(optGCThreads.c_str());
+        if (gcThreads <= 0) {
+            std::cerr << "Error: invalid GC thread count: " << optGCThreads << std::endl;
+            return 1;
+        }
+        RuntimeConfig::get().gcWorkerThreads = gcThreads;
+    }
+
+    if (optMarkCompact) {
+        RuntimeConfig::get().heapType = HEAP_MARK_COMPACT;
+    }
+
+    if (optConcMarkSweep) {
+        RuntimeConfig::get().heapType = HEAP_CONCURRENT_MARK_SWEEP;
+    }
+
+    if (optGCLog || !optGCLogPath.empty()) {
+        RuntimeConfig::get().gcLogEnabled = true;
+        RuntimeConfig::get().gcLogPath = optGCLogPath;
+    }
+
+    if (optLargePages) {
+        RuntimeConfig::get().heapPageType = HEAP_PAGES_HUGETLB;
+    } else if (optTransparentHugePages) {
+        RuntimeConfig::get().heapPageType = HEAP_PAGES_TRANSPARENT;
+    }
+    RuntimeConfig::get().heapPreTouch = optPreTouch;
+
+    if (!optNumaNode.empty()) {
+        int node = atoi(optNumaNode.c_str());
+        if (node < 0 || (node == 0 && optNumaNode != "0")) {
+            std::cerr << "Error: invalid NUMA node: " << optNumaNode << std::endl;
+            return 1;
+        }
+        RuntimeConfig::get().heapNumaPolicy = HEAP_NUMA_BIND;
+        RuntimeConfig::get().heapNumaNode = node;
+    } else if (optNumaInterleave) {
+        RuntimeConfig::get().heapNumaPolicy = HEAP_NUMA_INTERLEAVE;
+    }
+
+    // the heap can also be dumped at any time with SIGUSR1
+    RuntimeConfig::get().heapDumpPath = optHeapDumpPath;
+    RuntimeConfig::get().heapDumpOnOutOfMemory = optHeapDumpOnOOM;
+    RuntimeConfig::get().heapDumpAtExit = optHeapDumpAtExit;
+
+    if (optNoEscapeAnalysis) {
+        RuntimeConfig::get().doEscapeAnalysis = false;
+    }
+
+    if (!optSoftRefLRUPolicy.empty()) {
+        long ms = atol(optSoftRefLRUPolicy.c_str());
+        if (ms < 0 || (ms == 0 && optSoftRefLRUPolicy != "0")) {
+            std::cerr << "Error: invalid SoftRefLRUPolicyMSPerMB: " << optSoftRefLRUPolicy << std::endl;
+            return 1;
+        }
+        RuntimeConfig::get().softRefLRUPolicyMSPerMB = ms;
+    }
+
+    if (!optSuperinstructions.empty()
+        && !Superinstructions::parse(optSuperinstructions, &RuntimeConfig::get().superinstructions)) {
+        std::cerr << "Error: unknown superinstruction in: " << optSuperinstructions << std::endl;
+        return 1;
+    }
+    RuntimeConfig::get().bytecodeProfilePath = optBytecodeProfilePath;
+
+    if (optNoDirectThreading) {
+        RuntimeConfig::get().useDirectThreading = false;
+    }
+
+    if (optNoTemplateInterpreter) {
+        RuntimeConfig::get().useTemplateInterpreter = false;
+    }
+
     // Handle test mode
     if (optTestMode) {
         std::cout << "=== KiVM C++ Test Mode ===" << std::endl;
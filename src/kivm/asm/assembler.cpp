@@ -0,0 +1,574 @@
+//
+// Minimal x86_64 assembler for the template interpreter
+//
+#include <compileTimeConfig.h>
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
+#include <kivm/asm/assembler.h>
+#include <sys/mman.h>
+#include <cstring>
+
+namespace kivm {
+    static inline bool isByte(int v) {
+        return v >= -128 && v <= 127;
+    }
+
+    CodeBuffer::CodeBuffer(size_t capacity) {
+        void *memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            PANIC("CodeBuffer: cannot map %zu bytes", capacity);
+        }
+        _start = (u1 *) memory;
+        _end = _start + capacity;
+        _pc = _start;
+    }
+
+    CodeBuffer::~CodeBuffer() {
+        munmap(_start, (size_t) (_end - _start));
+    }
+
+    void CodeBuffer::makeExecutable() {
+        if (mprotect(_start, (size_t) (_end - _start), PROT_READ | PROT_EXEC) != 0) {
+            PANIC("CodeBuffer: cannot make code executable");
+        }
+    }
+
+    void Assembler::emitInt32(int v) {
+        for (int i = 0; i < 4; ++i) {
+            emitByte((v >> (i * 8)) & 0xff);
+        }
+    }
+
+    void Assembler::emitInt64(jlong v) {
+        for (int i = 0; i < 8; ++i) {
+            emitByte((int) ((v >> (i * 8)) & 0xff));
+        }
+    }
+
+    static inline bool isByteReg(int r) {
+        return r >= rsp && r <= rdi;
+    }
+
+    void Assembler::prefix(bool wide, int reg, Register rm, bool byteRegs) {
+        int rex = 0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((rm >> 3) & 1);
+        if (rex != 0x40 || (byteRegs && (isByteReg(reg) || isByteReg(rm)))) {
+            emitByte(rex);
+        }
+    }
+
+    void Assembler::prefix(bool wide, int reg, const Address &address, bool byteRegs) {
+        Register index = address.getIndex();
+        int rex = 0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2
+                  | (index == noreg ? 0 : ((index >> 3) & 1) << 1)
+                  | ((address.getBase() >> 3) & 1);
+        if (rex != 0x40 || (byteRegs && isByteReg(reg))) {
+            emitByte(rex);
+        }
+    }
+
+    void Assembler::emitModRM(int reg, Register rm) {
+        emitByte(0xc0 | (reg & 7) << 3 | (int) (rm & 7));
+    }
+
+    void Assembler::emitOperand(int reg, const Address &address) {
+        int base = (int) (address.getBase() & 7);
+        int disp = address.getDisp();
+        bool hasIndex = address.getIndex() != noreg;
+
+        // [rbp] and [r13] only exist with a displacement
+        int mod;
+        if (disp == 0 && base != rbp) {
+            mod = 0;
+        } else if (isByte(disp)) {
+            mod = 1;
+        } else {
+            mod = 2;
+        }
+
+        // [rsp] and [r12] need a SIB byte
+        if (hasIndex || base == rsp) {
+            int index = hasIndex ? (int) (address.getIndex() & 7) : rsp;
+            emitByte(mod << 6 | (reg & 7) << 3 | rsp);
+            emitByte(address.getScale() << 6 | index << 3 | base);
+        } else {
+            emitByte(mod << 6 | (reg & 7) << 3 | base);
+        }
+
+        if (mod == 1) {
+            emitByte(disp & 0xff);
+        } else if (mod == 2) {
+            emitInt32(disp);
+        }
+    }
+
+    void Assembler::emitOp(bool wide, int op, Register reg, Register rm, bool byteRegs) {
+        prefix(wide, reg, rm, byteRegs);
+        if (op > 0xff) {
+            emitByte(op >> 8);
+        }
+        emitByte(op & 0xff);
+        emitModRM((int) reg, rm);
+    }
+
+    void Assembler::emitOp(bool wide, int op, Register reg, const Address &address, bool byteRegs) {
+        prefix(wide, reg, address, byteRegs);
+        if (op > 0xff) {
+            emitByte(op >> 8);
+        }
+        emitByte(op & 0xff);
+        emitOperand((int) reg, address);
+    }
+
+    void Assembler::emitArith(bool wide, int digit, Register dst, int imm) {
+        prefix(wide, 0, dst);
+        if (isByte(imm)) {
+            emitByte(0x83);
+            emitModRM(digit, dst);
+            emitByte(imm & 0xff);
+        } else {
+            emitByte(0x81);
+            emitModRM(digit, dst);
+            emitInt32(imm);
+        }
+    }
+
+    void Assembler::emitShift(bool wide, int digit, Register dst) {
+        prefix(wide, 0, dst);
+        emitByte(0xd3);
+        emitModRM(digit, dst);
+    }
+
+    void Assembler::emitShift(bool wide, int digit, Register dst, int imm) {
+        prefix(wide, 0, dst);
+        emitByte(0xc1);
+        emitModRM(digit, dst);
+        emitByte(imm & 0xff);
+    }
+
+    void Assembler::emitSse(int prefixByte, int op, XMMRegister reg, const Address &address) {
+        emitByte(prefixByte);
+        prefix(false, reg, address);
+        emitByte(0x0f);
+        emitByte(op);
+        emitOperand((int) reg, address);
+    }
+
+    void Assembler::emitSse(int prefixByte, int op, XMMRegister reg, Register rm, bool wide) {
+        emitByte(prefixByte);
+        prefix(wide, reg, rm);
+        emitByte(0x0f);
+        emitByte(op);
+        emitModRM((int) reg, rm);
+    }
+
+    void Assembler::emitRel32(Label &label) {
+        if (label.isBound()) {
+            emitInt32((int) (label._target - ((u1 *) pc() + 4)));
+        } else {
+            label._patches.push_back(_code->getPc());
+            emitInt32(0);
+        }
+    }
+
+    void Assembler::bind(Label &label) {
+        label._target = _code->getPc();
+        for (u1 *patch : label._patches) {
+            int rel = (int) (label._target - (patch + 4));
+            memcpy(patch, &rel, sizeof(rel));
+        }
+        label._patches.clear();
+    }
+
+    void Assembler::movl(Register dst, Register src) {
+        emitOp(false, 0x8b, dst, src);
+    }
+
+    void Assembler::movl(Register dst, const Address &src) {
+        emitOp(false, 0x8b, dst, src);
+    }
+
+    void Assembler::movl(const Address &dst, Register src) {
+        emitOp(false, 0x89, src, dst);
+    }
+
+    void Assembler::movl(Register dst, int imm) {
+        prefix(false, 0, dst);
+        emitByte(0xb8 | (int) (dst & 7));
+        emitInt32(imm);
+    }
+
+    void Assembler::movq(Register dst, Register src) {
+        emitOp(true, 0x8b, dst, src);
+    }
+
+    void Assembler::movq(Register dst, const Address &src) {
+        emitOp(true, 0x8b, dst, src);
+    }
+
+    void Assembler::movq(const Address &dst, Register src) {
+        emitOp(true, 0x89, src, dst);
+    }
+
+    void Assembler::mov64(Register dst, jlong imm) {
+        if (imm >= 0 && imm <= 0xffffffffL) {
+            // upper half cleared by the 32-bit move
+            movl(dst, (int) imm);
+        } else if (imm >= INT32_MIN && imm <= INT32_MAX) {
+            prefix(true, 0, dst);
+            emitByte(0xc7);
+            emitModRM(0, dst);
+            emitInt32((int) imm);
+        } else {
+            prefix(true, 0, dst);
+            emitByte(0xb8 | (int) (dst & 7));
+            emitInt64(imm);
+        }
+    }
+
+    void Assembler::movb(const Address &dst, Register src) {
+        emitOp(false, 0x88, src, dst, true);
+    }
+
+    void Assembler::movw(const Address &dst, Register src) {
+        emitByte(0x66);
+        emitOp(false, 0x89, src, dst);
+    }
+
+    void Assembler::movzbl(Register dst, const Address &src) {
+        emitOp(false, 0x0fb6, dst, src);
+    }
+
+    void Assembler::movzbl(Register dst, Register src) {
+        emitOp(false, 0x0fb6, dst, src, true);
+    }
+
+    void Assembler::movsbl(Register dst, const Address &src) {
+        emitOp(false, 0x0fbe, dst, src);
+    }
+
+    void Assembler::movsbl(Register dst, Register src) {
+        emitOp(false, 0x0fbe, dst, src, true);
+    }
+
+    void Assembler::movzwl(Register dst, const Address &src) {
+        emitOp(false, 0x0fb7, dst, src);
+    }
+
+    void Assembler::movzwl(Register dst, Register src) {
+        emitOp(false, 0x0fb7, dst, src);
+    }
+
+    void Assembler::movswl(Register dst, const Address &src) {
+        emitOp(false, 0x0fbf, dst, src);
+    }
+
+    void Assembler::movswl(Register dst, Register src) {
+        emitOp(false, 0x0fbf, dst, src);
+    }
+
+    void Assembler::movslq(Register dst, Register src) {
+        emitOp(true, 0x63, dst, src);
+    }
+
+    void Assembler::leaq(Register dst, const Address &src) {
+        emitOp(true, 0x8d, dst, src);
+    }
+
+    void Assembler::addl(Register dst, Register src) {
+        emitOp(false, 0x01, src, dst);
+    }
+
+    void Assembler::addl(const Address &dst, Register src) {
+        emitOp(false, 0x01, src, dst);
+    }
+
+    void Assembler::subl(Register dst, Register src) {
+        emitOp(false, 0x29, src, dst);
+    }
+
+    void Assembler::andl(Register dst, Register src) {
+        emitOp(false, 0x21, src, dst);
+    }
+
+    void Assembler::orl(Register dst, Register src) {
+        emitOp(false, 0x09, src, dst);
+    }
+
+    void Assembler::xorl(Register dst, Register src) {
+        emitOp(false, 0x31, src, dst);
+    }
+
+    void Assembler::cmpl(Register dst, Register src) {
+        emitOp(false, 0x39, src, dst);
+    }
+
+    void Assembler::cmpl(Register dst, const Address &src) {
+        emitOp(false, 0x3b, dst, src);
+    }
+
+    void Assembler::cmpl(Register dst, int imm) {
+        emitArith(false, 7, dst, imm);
+    }
+
+    void Assembler::testl(Register dst, Register src) {
+        emitOp(false, 0x85, src, dst);
+    }
+
+    void Assembler::imull(Register dst, Register src) {
+        emitOp(false, 0x0faf, dst, src);
+    }
+
+    void Assembler::negl(Register dst) {
+        prefix(false, 0, dst);
+        emitByte(0xf7);
+        emitModRM(3, dst);
+    }
+
+    void Assembler::idivl(Register src) {
+        prefix(false, 0, src);
+        emitByte(0xf7);
+        emitModRM(7, src);
+    }
+
+    void Assembler::cdql() {
+        emitByte(0x99);
+    }
+
+    void Assembler::addq(Register dst, Register src) {
+        emitOp(true, 0x01, src, dst);
+    }
+
+    void Assembler::addq(Register dst, int imm) {
+        emitArith(true, 0, dst, imm);
+    }
+
+    void Assembler::subq(Register dst, Register src) {
+        emitOp(true, 0x29, src, dst);
+    }
+
+    void Assembler::subq(Register dst, int imm) {
+        emitArith(true, 5, dst, imm);
+    }
+
+    void Assembler::andq(Register dst, Register src) {
+        emitOp(true, 0x21, src, dst);
+    }
+
+    void Assembler::orq(Register dst, Register src) {
+        emitOp(true, 0x09, src, dst);
+    }
+
+    void Assembler::xorq(Register dst, Register src) {
+        emitOp(true, 0x31, src, dst);
+    }
+
+    void Assembler::cmpq(Register dst, Register src) {
+        emitOp(true, 0x39, src, dst);
+    }
+
+    void Assembler::cmpq(Register dst, int imm) {
+        emitArith(true, 7, dst, imm);
+    }
+
+    void Assembler::testq(Register dst, Register src) {
+        emitOp(true, 0x85, src, dst);
+    }
+
+    void Assembler::imulq(Register dst, Register src) {
+        emitOp(true, 0x0faf, dst, src);
+    }
+
+    void Assembler::negq(Register dst) {
+        prefix(true, 0, dst);
+        emitByte(0xf7);
+        emitModRM(3, dst);
+    }
+
+    void Assembler::idivq(Register src) {
+        prefix(true, 0, src);
+        emitByte(0xf7);
+        emitModRM(7, src);
+    }
+
+    void Assembler::cqto() {
+        emitByte(0x48);
+        emitByte(0x99);
+    }
+
+    void Assembler::cmpb(const Address &dst, int imm) {
+        prefix(false, 0, dst);
+        emitByte(0x80);
+        emitOperand(7, dst);
+        emitByte(imm & 0xff);
+    }
+
+    void Assembler::shll(Register dst) {
+        emitShift(false, 4, dst);
+    }
+
+    void Assembler::sarl(Register dst) {
+        emitShift(false, 7, dst);
+    }
+
+    void Assembler::shrl(Register dst) {
+        emitShift(false, 5, dst);
+    }
+
+    void Assembler::sarl(Register dst, int imm) {
+        emitShift(false, 7, dst, imm);
+    }
+
+    void Assembler::shlq(Register dst) {
+        emitShift(true, 4, dst);
+    }
+
+    void Assembler::sarq(Register dst) {
+        emitShift(true, 7, dst);
+    }
+
+    void Assembler::shrq(Register dst) {
+        emitShift(true, 5, dst);
+    }
+
+    void Assembler::shlq(Register dst, int imm) {
+        emitShift(true, 4, dst, imm);
+    }
+
+    void Assembler::shrq(Register dst, int imm) {
+        emitShift(true, 5, dst, imm);
+    }
+
+    void Assembler::bswapl(Register dst) {
+        prefix(false, 0, dst);
+        emitByte(0x0f);
+        emitByte(0xc8 | (int) (dst & 7));
+    }
+
+    void Assembler::setb(Condition cc, Register dst) {
+        prefix(false, 0, dst, true);
+        emitByte(0x0f);
+        emitByte(0x90 | cc);
+        emitModRM(0, dst);
+    }
+
+    void Assembler::jcc(Condition cc, Label &label) {
+        emitByte(0x0f);
+        emitByte(0x80 | cc);
+        emitRel32(label);
+    }
+
+    void Assembler::jmp(Label &label) {
+        emitByte(0xe9);
+        emitRel32(label);
+    }
+
+    void Assembler::jmp(const Address &target) {
+        prefix(false, 0, target);
+        emitByte(0xff);
+        emitOperand(4, target);
+    }
+
+    void Assembler::call(Register target) {
+        prefix(false, 0, target);
+        emitByte(0xff);
+        emitModRM(2, target);
+    }
+
+    void Assembler::pushq(Register src) {
+        prefix(false, 0, src);
+        emitByte(0x50 | (int) (src & 7));
+    }
+
+    void Assembler::popq(Register dst) {
+        prefix(false, 0, dst);
+        emitByte(0x58 | (int) (dst & 7));
+    }
+
+    void Assembler::ret() {
+        emitByte(0xc3);
+    }
+
+    void Assembler::movss(XMMRegister dst, const Address &src) {
+        emitSse(0xf3, 0x10, dst, src);
+    }
+
+    void Assembler::movss(const Address &dst, XMMRegister src) {
+        emitSse(0xf3, 0x11, src, dst);
+    }
+
+    void Assembler::movsd(XMMRegister dst, const Address &src) {
+        emitSse(0xf2, 0x10, dst, src);
+    }
+
+    void Assembler::movsd(const Address &dst, XMMRegister src) {
+        emitSse(0xf2, 0x11, src, dst);
+    }
+
+    void Assembler::movdl(XMMRegister dst, Register src) {
+        emitSse(0x66, 0x6e, dst, src);
+    }
+
+    void Assembler::movdl(Register dst, XMMRegister src) {
+        emitSse(0x66, 0x7e, src, dst);
+    }
+
+    void Assembler::movdq(XMMRegister dst, Register src) {
+        emitSse(0x66, 0x6e, dst, src, true);
+    }
+
+    void Assembler::movdq(Register dst, XMMRegister src) {
+        emitSse(0x66, 0x7e, src, dst, true);
+    }
+
+    void Assembler::addss(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf3, 0x58, dst, src);
+    }
+
+    void Assembler::subss(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf3, 0x5c, dst, src);
+    }
+
+    void Assembler::mulss(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf3, 0x59, dst, src);
+    }
+
+    void Assembler::addsd(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf2, 0x58, dst, src);
+    }
+
+    void Assembler::subsd(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf2, 0x5c, dst, src);
+    }
+
+    void Assembler::mulsd(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf2, 0x59, dst, src);
+    }
+
+    void Assembler::cvtsi2ssl(XMMRegister dst, Register src) {
+        emitSse(0xf3, 0x2a, dst, src);
+    }
+
+    void Assembler::cvtsi2ssq(XMMRegister dst, Register src) {
+        emitSse(0xf3, 0x2a, dst, src, true);
+    }
+
+    void Assembler::cvtsi2sdl(XMMRegister dst, Register src) {
+        emitSse(0xf2, 0x2a, dst, src);
+    }
+
+    void Assembler::cvtsi2sdq(XMMRegister dst, Register src) {
+        emitSse(0xf2, 0x2a, dst, src, true);
+    }
+
+    void Assembler::cvtss2sd(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf3, 0x5a, dst, src);
+    }
+
+    void Assembler::cvtsd2ss(XMMRegister dst, XMMRegister src) {
+        emitSse(0xf2, 0x5a, dst, src);
+    }
+}
+
+#endif
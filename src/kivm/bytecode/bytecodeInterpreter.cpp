@@ -5,6 +5,8 @@
 #include <kivm/bytecode/bytecodeInterpreter.h>
 #include <kivm/bytecode/bytecodes.h>
 #include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/quickener.h>
+#include <kivm/bytecode/tosCachedStack.h>
 #include <kivm/oop/instanceOop.h>
 #include <kivm/oop/arrayOop.h>
 #include <kivm/oop/primitiveOop.h>
@@ -42,7 +44,8 @@ namespace kivm {
         Frame *currentFrame = thread->getCurrentFrame();
         auto currentMethod = currentFrame->getMethod();
         auto currentClass = currentMethod->getClass();
-        const CodeBlob &codeBlob = currentMethod->getCodeBlob();
+        auto rt = currentClass->getRuntimeConstantPool();
+        CodeBlob &codeBlob = currentMethod->getRewrittenCode();
         u4 &pc = thread->_pc;
 
         D("currentMethod: %S.%S:%S",
@@ -50,7 +53,7 @@ namespace kivm {
             (currentMethod->getName()).c_str(),
             (currentMethod->getDescriptor()).c_str());
 
-        Stack &stack = currentFrame->getStack();
+        TosCachedStack stack(currentFrame->getStack());
         Locals &locals = currentFrame->getLocals();
 
         thread->enterSafepointIfNeeded();
@@ -0,0 +1,129 @@
+//
+// Profiles of adjacent instructions, for choosing superinstructions
+//
+
+#include <kivm/bytecode/bytecodeProfile.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/oop/method.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <cstdio>
+#include <cstdlib>
+
+namespace kivm {
+    static const char *OPCODE_NAMES[256] = {
+        "nop", "aconst_null", "iconst_m1", "iconst_0", "iconst_1", "iconst_2", "iconst_3",
+        "iconst_4", "iconst_5", "lconst_0", "lconst_1", "fconst_0", "fconst_1", "fconst_2",
+        "dconst_0", "dconst_1", "bipush", "sipush", "ldc", "ldc_w", "ldc2_w", "iload", "lload",
+        "fload", "dload", "aload", "iload_0", "iload_1", "iload_2", "iload_3", "lload_0",
+        "lload_1", "lload_2", "lload_3", "fload_0", "fload_1", "fload_2", "fload_3", "dload_0",
+        "dload_1", "dload_2", "dload_3", "aload_0", "aload_1", "aload_2", "aload_3", "iaload",
+        "laload", "faload", "daload", "aaload", "baload", "caload", "saload", "istore", "lstore",
+        "fstore", "dstore", "astore", "istore_0", "istore_1", "istore_2", "istore_3", "lstore_0",
+        "lstore_1", "lstore_2", "lstore_3", "fstore_0", "fstore_1", "fstore_2", "fstore_3",
+        "dstore_0", "dstore_1", "dstore_2", "dstore_3", "astore_0", "astore_1", "astore_2",
+        "astore_3", "iastore", "lastore", "fastore", "dastore", "aastore", "bastore", "castore",
+        "sastore", "pop", "pop2", "dup", "dup_x1", "dup_x2", "dup2", "dup2_x1", "dup2_x2", "swap",
+        "iadd", "ladd", "fadd", "dadd", "isub", "lsub", "fsub", "dsub", "imul", "lmul", "fmul",
+        "dmul", "idiv", "ldiv", "fdiv", "ddiv", "irem", "lrem", "frem", "drem", "ineg", "lneg",
+        "fneg", "dneg", "ishl", "lshl", "ishr", "lshr", "iushr", "lushr", "iand", "land", "ior",
+        "lor", "ixor", "lxor", "iinc", "i2l", "i2f", "i2d", "l2i", "l2f", "l2d", "f2i", "f2l",
+        "f2d", "d2i", "d2l", "d2f", "i2b", "i2c", "i2s", "lcmp", "fcmpl", "fcmpg", "dcmpl",
+        "dcmpg", "ifeq", "ifne", "iflt", "ifge", "ifgt", "ifle", "if_icmpeq", "if_icmpne",
+        "if_icmplt", "if_icmpge", "if_icmpgt", "if_icmple", "if_acmpeq", "if_acmpne", "goto",
+        "jsr", "ret", "tableswitch", "lookupswitch", "ireturn", "lreturn", "freturn", "dreturn",
+        "areturn", "return", "getstatic", "putstatic", "getfield", "putfield", "invokevirtual",
+        "invokespecial", "invokestatic", "invokeinterface", "invokedynamic", "new", "newarray",
+        "anewarray", "arraylength", "athrow", "checkcast", "instanceof", "monitorenter",
+        "monitorexit", "wide", "multianewarray", "ifnull", "ifnonnull", "goto_w", "jsr_w",
+        "breakpoint", "fast_agetfield", "fast_igetfield", "fast_lgetfield", "fast_fgetfield",
+        "fast_dgetfield", "fast_aputfield", "fast_iputfield", "fast_lputfield", "fast_fputfield",
+        "fast_dputfield", "fast_getstatic", "fast_putstatic", "fast_new", "fast_invokevirtual",
+        "fast_invokedirect", "fast_ldc", "fast_ldc_w", "fast_aldc", "fast_aldc_w",
+        "aload_0_getfield", "iload_iload_if_icmpge", "iload_iinc_goto", "aload_iload_iaload",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "impdep1",
+        "impdep2"
+    };
+
+    static u8 PAIR_COUNTS[256 * 256];
+
+    /**
+     * Too large to be static, but calloc() leaves pages that
+     * are never counted into uncommitted.
+     */
+    static u8 *getTripleCounts() {
+        static u8 *tripleCounts = (u8 *) calloc(256 * 256 * 256, sizeof(u8));
+        return tripleCounts;
+    }
+
+    static inline void increment(u8 *count) {
+        __atomic_fetch_add(count, 1, __ATOMIC_RELAXED);
+    }
+
+    bool BytecodeProfile::isEnabled() {
+        return !RuntimeConfig::get().bytecodeProfilePath.empty();
+    }
+
+    void BytecodeProfile::record(Method *method, u4 pc, Cursor &cursor) {
+        const CodeBlob &code = method->getCodeBlob();
+        int opcode = code[pc];
+
+        if (pc != cursor._nextPc) {
+            cursor._previous = -1;
+            cursor._beforePrevious = -1;
+        }
+
+        if (cursor._previous >= 0) {
+            increment(&PAIR_COUNTS[cursor._previous << 8 | opcode]);
+            if (cursor._beforePrevious >= 0) {
+                increment(&getTripleCounts()[cursor._beforePrevious << 16 | cursor._previous << 8 | opcode]);
+            }
+        }
+
+        cursor._beforePrevious = cursor._previous;
+        cursor._previous = opcode;
+        cursor._nextPc = pc + OopMap::getInstructionLength(code, pc);
+    }
+
+    u8 BytecodeProfile::getPairCount(int first, int second) {
+        return __atomic_load_n(&PAIR_COUNTS[first << 8 | second], __ATOMIC_RELAXED);
+    }
+
+    u8 BytecodeProfile::getTripleCount(int first, int second, int third) {
+        return __atomic_load_n(&getTripleCounts()[first << 16 | second << 8 | third], __ATOMIC_RELAXED);
+    }
+
+    const char *BytecodeProfile::getOpcodeName(int opcode) {
+        return opcode >= 0 && opcode < 256 ? OPCODE_NAMES[opcode] : nullptr;
+    }
+
+    bool BytecodeProfile::dump(const std::string &path) {
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            WARN("bytecode profile: cannot open %s", path.c_str());
+            return false;
+        }
+
+        for (int pair = 0; pair < 256 * 256; ++pair) {
+            u8 count = getPairCount(pair >> 8, pair & 0xff);
+            if (count != 0) {
+                fprintf(file, "pair %s %s %llu\n",
+                    OPCODE_NAMES[pair >> 8], OPCODE_NAMES[pair & 0xff],
+                    (unsigned long long) count);
+            }
+        }
+
+        for (int triple = 0; triple < 256 * 256 * 256; ++triple) {
+            u8 count = getTripleCount(triple >> 16, (triple >> 8) & 0xff, triple & 0xff);
+            if (count != 0) {
+                fprintf(file, "triple %s %s %s %llu\n",
+                    OPCODE_NAMES[triple >> 16], OPCODE_NAMES[(triple >> 8) & 0xff],
+                    OPCODE_NAMES[triple & 0xff], (unsigned long long) count);
+            }
+        }
+
+        fclose(file);
+        return true;
+    }
+}
@@ -0,0 +1,309 @@
+//
+// Pre-decoded method code for the direct-threaded interpreter
+//
+
+#include <kivm/bytecode/decodedCode.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/bytecode/superinstructions.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/method.h>
+#include <kivm/runtime/constantPool.h>
+
+namespace kivm {
+    static inline jint readS2(const CodeBlob &code, int offset) {
+        return (short) (code[offset] << 8 | code[offset + 1]);
+    }
+
+    static inline jint readU2(const CodeBlob &code, int offset) {
+        return code[offset] << 8 | code[offset + 1];
+    }
+
+    static inline jint readS4(const CodeBlob &code, int offset) {
+        return (jint) ((u4) code[offset] << 24 | (u4) code[offset + 1] << 16
+                       | (u4) code[offset + 2] << 8 | (u4) code[offset + 3]);
+    }
+
+    static inline int getSwitchBase(int bci) {
+        return (bci + 4) & ~3;
+    }
+
+    /**
+     * Decode the operands of the instruction at {@code bci} into {@code instruction},
+     * a branch leaves its target bci in {@code _operand}, a switch its default one.
+     *
+     * @return the opcode whose handler runs the instruction,
+     *         -1 if the operands are not understood
+     */
+    static int decodeInstruction(RuntimeConstantPool *rt, const CodeBlob &code,
+                                 int bci, DecodedInstruction *instruction) {
+        int opcode = code[bci];
+        instruction->_target = nullptr;
+        instruction->_entry = nullptr;
+        instruction->_operand = 0;
+        instruction->_operand2 = 0;
+
+        switch (opcode) {
+            case OPC_ICONST_M1:
+            case OPC_ICONST_0:
+            case OPC_ICONST_1:
+            case OPC_ICONST_2:
+            case OPC_ICONST_3:
+            case OPC_ICONST_4:
+            case OPC_ICONST_5:
+                instruction->_operand = opcode - OPC_ICONST_0;
+                return OPC_BIPUSH;
+
+            case OPC_BIPUSH:
+                instruction->_operand = (signed char) code[bci + 1];
+                return OPC_BIPUSH;
+
+            case OPC_SIPUSH:
+                instruction->_operand = readS2(code, bci + 1);
+                return OPC_BIPUSH;
+
+            case OPC_LDC:
+                instruction->_operand = code[bci + 1];
+                instruction->_entry = rt->getResolvedEntry(instruction->_operand);
+                return OPC_LDC;
+
+            case OPC_LDC_W:
+                instruction->_operand = readU2(code, bci + 1);
+                instruction->_entry = rt->getResolvedEntry(instruction->_operand);
+                return OPC_LDC;
+
+            case OPC_ILOAD:
+            case OPC_LLOAD:
+            case OPC_FLOAD:
+            case OPC_DLOAD:
+            case OPC_ALOAD:
+            case OPC_ISTORE:
+            case OPC_LSTORE:
+            case OPC_FSTORE:
+            case OPC_DSTORE:
+            case OPC_ASTORE:
+            case OPC_NEWARRAY:
+                instruction->_operand = code[bci + 1];
+                return opcode;
+
+            case OPC_IINC:
+                instruction->_operand = code[bci + 1];
+                instruction->_operand2 = (signed char) code[bci + 2];
+                return opcode;
+
+            case OPC_IFEQ:
+            case OPC_IFNE:
+            case OPC_IFLT:
+            case OPC_IFGE:
+            case OPC_IFGT:
+            case OPC_IFLE:
+            case OPC_IF_ICMPEQ:
+            case OPC_IF_ICMPNE:
+            case OPC_IF_ICMPLT:
+            case OPC_IF_ICMPGE:
+            case OPC_IF_ICMPGT:
+            case OPC_IF_ICMPLE:
+            case OPC_IF_ACMPEQ:
+            case OPC_IF_ACMPNE:
+            case OPC_GOTO:
+            case OPC_IFNULL:
+            case OPC_IFNONNULL:
+                instruction->_operand = bci + readS2(code, bci + 1);
+                return opcode;
+
+            case OPC_GOTO_W:
+                instruction->_operand = bci + readS4(code, bci + 1);
+                return OPC_GOTO;
+
+            case OPC_LDC2_W:
+            case OPC_GETSTATIC:
+            case OPC_PUTSTATIC:
+            case OPC_GETFIELD:
+            case OPC_PUTFIELD:
+            case OPC_INVOKEVIRTUAL:
+            case OPC_INVOKESPECIAL:
+            case OPC_INVOKESTATIC:
+            case OPC_NEW:
+            case OPC_ANEWARRAY:
+            case OPC_CHECKCAST:
+            case OPC_INSTANCEOF:
+                instruction->_operand = readU2(code, bci + 1);
+                instruction->_entry = rt->getResolvedEntry(instruction->_operand);
+                return opcode;
+
+            case OPC_INVOKEINTERFACE:
+            case OPC_MULTIANEWARRAY:
+                instruction->_operand = readU2(code, bci + 1);
+                instruction->_operand2 = code[bci + 3];
+                return opcode;
+
+            case OPC_TABLESWITCH:
+            case OPC_LOOKUPSWITCH:
+                // the targets are decoded with the other branches
+                instruction->_operand = bci + readS4(code, getSwitchBase(bci));
+                return opcode;
+
+            default:
+                break;
+        }
+
+        // the short forms of loads and stores
+        if (opcode >= OPC_ILOAD_0 && opcode <= OPC_ALOAD_3) {
+            instruction->_operand = (opcode - OPC_ILOAD_0) % 4;
+            return OPC_ILOAD + (opcode - OPC_ILOAD_0) / 4;
+        }
+        if (opcode >= OPC_ISTORE_0 && opcode <= OPC_ASTORE_3) {
+            instruction->_operand = (opcode - OPC_ISTORE_0) % 4;
+            return OPC_ISTORE + (opcode - OPC_ISTORE_0) / 4;
+        }
+
+        return OopMap::getInstructionLength(code, bci) == 1 ? opcode : -1;
+    }
+
+    /**
+     * @return the number of instructions fused at {@code bci}, 0 if none are
+     */
+    static int getFusedLength(const CodeBlob &rewritten, int bci) {
+        int count = 0;
+        auto superinstructions = Superinstructions::getAll(&count);
+        for (int i = 0; i < count; ++i) {
+            if (rewritten[bci] == superinstructions[i]._opcode) {
+                return superinstructions[i]._length;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Decode the keys and targets of the switch at {@code bci}.
+     * @return false if a target is not the start of an instruction
+     */
+    static bool decodeSwitch(const CodeBlob &code, int bci,
+                             const std::vector<DecodedInstruction *> &instructionAt,
+                             DecodedSwitch *decodedSwitch) {
+        auto addTarget = [&](int target) {
+            if (target < 0 || target >= (int) instructionAt.size() || instructionAt[target] == nullptr) {
+                return false;
+            }
+            decodedSwitch->_targets.push_back(instructionAt[target]);
+            return true;
+        };
+
+        int base = getSwitchBase(bci);
+        if (code[bci] == OPC_TABLESWITCH) {
+            int low = readS4(code, base + 4);
+            int high = readS4(code, base + 8);
+            decodedSwitch->_low = low;
+            for (int i = 0; i <= high - low; ++i) {
+                if (!addTarget(bci + readS4(code, base + 12 + i * 4))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        int pairs = readS4(code, base + 4);
+        for (int i = 0; i < pairs; ++i) {
+            decodedSwitch->_keys.push_back(readS4(code, base + 8 + i * 8));
+            if (!addTarget(bci + readS4(code, base + 8 + i * 8 + 4))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    DecodedCode *DecodedCode::decode(Method *method, void *const *handlers) {
+        auto decoded = new DecodedCode;
+        const CodeBlob &code = method->getCodeBlob();
+        int size = code.getSize();
+
+        int count = 0;
+        for (int bci = 0; bci < size; bci += OopMap::getInstructionLength(code, bci)) {
+            ++count;
+        }
+
+        auto instructions = new DecodedInstruction[count];
+        decoded->_instructionAt.assign((size_t) size, nullptr);
+
+        auto fail = [&]() {
+            delete[] instructions;
+            decoded->_instructionAt.clear();
+            decoded->_switches.clear();
+            return decoded;
+        };
+
+        auto rt = method->getClass()->getRuntimeConstantPool();
+        const CodeBlob &rewritten = method->getRewrittenCode();
+        int bci = 0;
+        for (int i = 0; i < count; ++i) {
+            auto instruction = instructions + i;
+            int handlerOpcode = decodeInstruction(rt, code, bci, instruction);
+            if (handlerOpcode < 0 || handlers[handlerOpcode] == nullptr) {
+                return fail();
+            }
+
+            instruction->_handler = handlers[handlerOpcode];
+            // the first record runs the whole sequence, the records after it
+            // stay for branches into the middle
+            int fused = getFusedLength(rewritten, bci);
+            if (fused > 0 && i + fused <= count && handlers[rewritten[bci]] != nullptr) {
+                instruction->_handler = handlers[rewritten[bci]];
+            }
+            instruction->_bci = (u4) bci;
+            instruction->_opcode = code[bci];
+            decoded->_instructionAt[bci] = instruction;
+            bci += OopMap::getInstructionLength(code, bci);
+        }
+
+        for (int i = 0; i < count; ++i) {
+            auto instruction = instructions + i;
+            switch (instruction->_opcode) {
+                case OPC_IFEQ:
+                case OPC_IFNE:
+                case OPC_IFLT:
+                case OPC_IFGE:
+                case OPC_IFGT:
+                case OPC_IFLE:
+                case OPC_IF_ICMPEQ:
+                case OPC_IF_ICMPNE:
+                case OPC_IF_ICMPLT:
+                case OPC_IF_ICMPGE:
+                case OPC_IF_ICMPGT:
+                case OPC_IF_ICMPLE:
+                case OPC_IF_ACMPEQ:
+                case OPC_IF_ACMPNE:
+                case OPC_GOTO:
+                case OPC_GOTO_W:
+                case OPC_IFNULL:
+                case OPC_IFNONNULL:
+                case OPC_TABLESWITCH:
+                case OPC_LOOKUPSWITCH: {
+                    int target = instruction->_operand;
+                    if (target < 0 || target >= size || decoded->_instructionAt[target] == nullptr) {
+                        return fail();
+                    }
+                    instruction->_target = decoded->_instructionAt[target];
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            if (instruction->_opcode == OPC_TABLESWITCH || instruction->_opcode == OPC_LOOKUPSWITCH) {
+                decoded->_switches.emplace_back();
+                instruction->_switch = &decoded->_switches.back();
+                if (!decodeSwitch(code, (int) instruction->_bci, decoded->_instructionAt, instruction->_switch)) {
+                    return fail();
+                }
+            }
+        }
+
+        decoded->_instructions = instructions;
+        decoded->_count = count;
+        return decoded;
+    }
+
+    DecodedCode::~DecodedCode() {
+        delete[] _instructions;
+    }
+}
@@ -0,0 +1,1221 @@
+//
+// Direct-threaded interpreter
+//
+
+#include <kivm/bytecode/directThreadedInterpreter.h>
+
+#if defined(KIVM_THREADED) && !defined(KIVM_DEBUG)
+
+#include <kivm/bytecode/threadedInterpreter.h>
+#include <kivm/bytecode/bytecodeProfile.h>
+#include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/quickener.h>
+#include <kivm/bytecode/tosCachedStack.h>
+#include <kivm/oop/instanceOop.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/oop/primitiveOop.h>
+#include <kivm/oop/mirrorOop.h>
+#include <kivm/oop/method.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <algorithm>
+#include <climits>
+#include <deque>
+
+// what the other interpreters would have in pc while running this instruction
+#define SYNC_PC() \
+    pc = ip->_bci + 1
+
+#include "sharedInterpreter.h"
+
+#define OPCODE_LABEL(opcode) \
+    label_OPC_##opcode
+
+#define OPCODE(opcode) \
+    OPCODE_LABEL(opcode):
+
+#define DISPATCH() \
+    goto *ip->_handler
+
+#define NEXT() \
+    ++ip; \
+    DISPATCH()
+
+#define BRANCH_TO(target) \
+    if ((target) <= ip) { \
+        SAFEPOINT_POLL(); \
+    } \
+    ip = (target); \
+    DISPATCH()
+
+#define BRANCH() \
+    BRANCH_TO(ip->_target)
+
+#define IF_ZERO_BRANCH(popFunc, zero, op) \
+    if (stack.popFunc() op zero) { \
+        BRANCH(); \
+    }
+
+#define IF_CMP_BRANCH(popFunc, op) \
+    auto v2 = stack.popFunc(); \
+    auto v1 = stack.popFunc(); \
+    if (v1 op v2) { \
+        BRANCH(); \
+    }
+
+// The bytecode may have been quickened by ThreadedInterpreter already,
+// otherwise it is quickened here. Either way the handler follows it.
+#define QUICKEN(quickenFunc) \
+    if (rewrittenCode[ip->_bci] == ip->_opcode) { \
+        Quickener::quickenFunc(rt, rewrittenCode, ip->_bci, ip->_operand); \
+    } \
+    if (rewrittenCode[ip->_bci] != ip->_opcode \
+        && _handlers[rewrittenCode[ip->_bci]] != nullptr) { \
+        __atomic_store_n(&ip->_handler, _handlers[rewrittenCode[ip->_bci]], __ATOMIC_RELEASE); \
+    }
+
+namespace kivm {
+    void *DirectThreadedInterpreter::_handlers[OPC_NUM_OPCODES] = {nullptr};
+
+    void DirectThreadedInterpreter::initialize() {
+        static u4 emptyPc;
+        static Stack emptyStack(0);
+        static Locals emptyLocals(0);
+
+        ThreadedInterpreter::initialize();
+        directThreaded(nullptr, nullptr, nullptr, nullptr, nullptr,
+            emptyPc, emptyStack, emptyLocals);
+    }
+
+    oop DirectThreadedInterpreter::interp(JavaThread *thread) {
+        Frame *currentFrame = thread->getCurrentFrame();
+        auto currentMethod = currentFrame->getMethod();
+
+        // profiles count the bytecodes
+        if (!RuntimeConfig::get().useDirectThreading || BytecodeProfile::isEnabled()) {
+            return ThreadedInterpreter::interp(thread);
+        }
+
+        auto decodedCode = currentMethod->getDecodedCode();
+        if (decodedCode == nullptr) {
+            decodedCode = currentMethod->installDecodedCode(
+                DecodedCode::decode(currentMethod, _handlers));
+        }
+        if (!decodedCode->isDecoded()) {
+            return ThreadedInterpreter::interp(thread);
+        }
+
+        auto currentClass = currentMethod->getClass();
+        u4 &pc = thread->_pc;
+        Stack &stack = currentFrame->getStack();
+        Locals &locals = currentFrame->getLocals();
+
+        D("currentMethod: %s.%s:%s",
+            strings::toStdString(currentClass->getName()).c_str(),
+            strings::toStdString(currentMethod->getName()).c_str(),
+            strings::toStdString(currentMethod->getDescriptor()).c_str());
+
+        thread->enterSafepointIfNeeded();
+
+        return directThreaded(thread, currentFrame, currentMethod, currentClass,
+            decodedCode, pc, stack, locals);
+    }
+
+    oop DirectThreadedInterpreter::directThreaded(JavaThread *thread,
+                                                  Frame *currentFrame,
+                                                  Method *currentMethod,
+                                                  InstanceKlass *currentClass,
+                                                  DecodedCode *decodedCode,
+                                                  u4 &pc,
+                                                  Stack &frameStack,
+                                                  Locals &locals) {
+        TosCachedStack stack(frameStack);
+
+        if (thread != nullptr) {
+            DecodedInstruction *ip = decodedCode->getEntry();
+            RuntimeConstantPool *rt = currentClass->getRuntimeConstantPool();
+            CodeBlob &rewrittenCode = currentMethod->getRewrittenCode();
+            DISPATCH();
+
+OPCODE(NOP)
+    {
+        NEXT();
+    }
+OPCODE(ACONST_NULL)
+    {
+        stack.pushReference(nullptr);
+        NEXT();
+    }
+OPCODE(BIPUSH)
+    {
+        // also ICONST_<n> and SIPUSH
+        stack.pushInt(ip->_operand);
+        NEXT();
+    }
+OPCODE(LCONST_0)
+    {
+        stack.pushLong(0);
+        NEXT();
+    }
+OPCODE(LCONST_1)
+    {
+        stack.pushLong(1);
+        NEXT();
+    }
+OPCODE(FCONST_0)
+    {
+        stack.pushFloat(0);
+        NEXT();
+    }
+OPCODE(FCONST_1)
+    {
+        stack.pushFloat(1);
+        NEXT();
+    }
+OPCODE(FCONST_2)
+    {
+        stack.pushFloat(2);
+        NEXT();
+    }
+OPCODE(DCONST_0)
+    {
+        stack.pushDouble(0);
+        NEXT();
+    }
+OPCODE(DCONST_1)
+    {
+        stack.pushDouble(1);
+        NEXT();
+    }
+OPCODE(LDC)
+    {
+        // also LDC_W
+        LOAD_CONSTANT_OP(ip->_operand);
+        QUICKEN(quickenLoadConstant);
+        NEXT();
+    }
+OPCODE(LDC2_W)
+    {
+        LOAD_CONSTANT_OP(ip->_operand);
+        NEXT();
+    }
+OPCODE(ILOAD)
+    {
+        stack.pushInt(locals.getInt(ip->_operand));
+        NEXT();
+    }
+OPCODE(LLOAD)
+    {
+        stack.pushLong(locals.getLong(ip->_operand));
+        NEXT();
+    }
+OPCODE(FLOAD)
+    {
+        stack.pushFloat(locals.getFloat(ip->_operand));
+        NEXT();
+    }
+OPCODE(DLOAD)
+    {
+        stack.pushDouble(locals.getDouble(ip->_operand));
+        NEXT();
+    }
+OPCODE(ALOAD)
+    {
+        stack.pushReference(locals.getReference(ip->_operand));
+        NEXT();
+    }
+OPCODE(IALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jint, typeArray, pushInt);
+        NEXT();
+    }
+OPCODE(LALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jlong, typeArray, pushLong);
+        NEXT();
+    }
+OPCODE(FALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jfloat, typeArray, pushFloat);
+        NEXT();
+    }
+OPCODE(DALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jdouble, typeArray, pushDouble);
+        NEXT();
+    }
+OPCODE(AALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(oop, objectArray, pushReference);
+        NEXT();
+    }
+OPCODE(BALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jbyte, typeArray, pushInt);
+        NEXT();
+    }
+OPCODE(CALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jchar, typeArray, pushInt);
+        NEXT();
+    }
+OPCODE(SALOAD)
+    {
+        LOAD_ARRAY_ELEMENT(jshort, typeArray, pushInt);
+        NEXT();
+    }
+OPCODE(ISTORE)
+    {
+        locals.setInt(ip->_operand, stack.popInt());
+        NEXT();
+    }
+OPCODE(LSTORE)
+    {
+        locals.setLong(ip->_operand, stack.popLong());
+        NEXT();
+    }
+OPCODE(FSTORE)
+    {
+        locals.setFloat(ip->_operand, stack.popFloat());
+        NEXT();
+    }
+OPCODE(DSTORE)
+    {
+        locals.setDouble(ip->_operand, stack.popDouble());
+        NEXT();
+    }
+OPCODE(ASTORE)
+    {
+        locals.setReference(ip->_operand, stack.popReference());
+        NEXT();
+    }
+OPCODE(IASTORE)
+    {
+        STORE_ARRAY_ELEMENT(jint, value, typeArray, popInt, value);
+        NEXT();
+    }
+OPCODE(LASTORE)
+    {
+        STORE_ARRAY_ELEMENT(jlong, value, typeArray, popLong, value);
+        NEXT();
+    }
+OPCODE(FASTORE)
+    {
+        STORE_ARRAY_ELEMENT(jfloat, value, typeArray, popFloat, value);
+        NEXT();
+    }
+OPCODE(DASTORE)
+    {
+        STORE_ARRAY_ELEMENT(jdouble, value, typeArray, popDouble, value);
+        NEXT();
+    }
+OPCODE(AASTORE)
+    {
+        STORE_ARRAY_ELEMENT(oop, value, objectArray, popReference, Resolver::javaOop(value));
+        Universe::writeBarrier(array->getElementAddress<oop>(index));
+        NEXT();
+    }
+OPCODE(BASTORE)
+    {
+        // boolean[] only keeps the lowest bit
+        STORE_ARRAY_ELEMENT(jbyte, value, typeArray, popInt,
+            ((TypeArrayKlass *) array->getClass())->getComponentType() == ValueType::BOOLEAN
+            ? (value & 1) : value);
+        NEXT();
+    }
+OPCODE(CASTORE)
+    {
+        STORE_ARRAY_ELEMENT(jchar, value, typeArray, popInt, value);
+        NEXT();
+    }
+OPCODE(SASTORE)
+    {
+        STORE_ARRAY_ELEMENT(jshort, value, typeArray, popInt, value);
+        NEXT();
+    }
+OPCODE(POP)
+    {
+        stack.dropTop();
+        NEXT();
+    }
+OPCODE(POP2)
+    {
+        stack.dropTop();
+        stack.dropTop();
+        NEXT();
+    }
+OPCODE(DUP)
+    {
+        STACK_DUP();
+        NEXT();
+    }
+OPCODE(DUP_X1)
+    {
+        STACK_DUP_X1();
+        NEXT();
+    }
+OPCODE(DUP_X2)
+    {
+        STACK_DUP_X2();
+        NEXT();
+    }
+OPCODE(DUP2)
+    {
+        STACK_DUP2();
+        NEXT();
+    }
+OPCODE(DUP2_X1)
+    {
+        STACK_DUP2_X1();
+        NEXT();
+    }
+OPCODE(DUP2_X2)
+    {
+        STACK_DUP2_X2();
+        NEXT();
+    }
+OPCODE(SWAP)
+    {
+        STACK_SWAP();
+        NEXT();
+    }
+OPCODE(IADD)
+    {
+        BINARY_OP(popInt, pushInt, +);
+        NEXT();
+    }
+OPCODE(LADD)
+    {
+        BINARY_OP(popLong, pushLong, +);
+        NEXT();
+    }
+OPCODE(FADD)
+    {
+        BINARY_OP(popFloat, pushFloat, +);
+        NEXT();
+    }
+OPCODE(DADD)
+    {
+        BINARY_OP(popDouble, pushDouble, +);
+        NEXT();
+    }
+OPCODE(ISUB)
+    {
+        BINARY_OP(popInt, pushInt, -);
+        NEXT();
+    }
+OPCODE(LSUB)
+    {
+        BINARY_OP(popLong, pushLong, -);
+        NEXT();
+    }
+OPCODE(FSUB)
+    {
+        BINARY_OP(popFloat, pushFloat, -);
+        NEXT();
+    }
+OPCODE(DSUB)
+    {
+        BINARY_OP(popDouble, pushDouble, -);
+        NEXT();
+    }
+OPCODE(IMUL)
+    {
+        BINARY_OP(popInt, pushInt, *);
+        NEXT();
+    }
+OPCODE(LMUL)
+    {
+        BINARY_OP(popLong, pushLong, *);
+        NEXT();
+    }
+OPCODE(FMUL)
+    {
+        BINARY_OP(popFloat, pushFloat, *);
+        NEXT();
+    }
+OPCODE(DMUL)
+    {
+        BINARY_OP(popDouble, pushDouble, *);
+        NEXT();
+    }
+OPCODE(IDIV)
+    {
+        DIVIDE_OP(popInt, pushInt);
+        NEXT();
+    }
+OPCODE(LDIV)
+    {
+        DIVIDE_OP(popLong, pushLong);
+        NEXT();
+    }
+OPCODE(FDIV)
+    {
+        DIVIDE_OP(popFloat, pushFloat);
+        NEXT();
+    }
+OPCODE(DDIV)
+    {
+        DIVIDE_OP(popDouble, pushDouble);
+        NEXT();
+    }
+OPCODE(IREM)
+    {
+        REMAINDER_OP(popInt, pushInt);
+        NEXT();
+    }
+OPCODE(LREM)
+    {
+        REMAINDER_OP(popLong, pushLong);
+        NEXT();
+    }
+OPCODE(INEG)
+    {
+        stack.pushInt(-stack.popInt());
+        NEXT();
+    }
+OPCODE(LNEG)
+    {
+        stack.pushLong(-stack.popLong());
+        NEXT();
+    }
+OPCODE(ISHL)
+    {
+        SHIFT_OP(popInt, pushInt, 0x1F, <<);
+        NEXT();
+    }
+OPCODE(LSHL)
+    {
+        SHIFT_OP(popLong, pushLong, 0x3F, <<);
+        NEXT();
+    }
+OPCODE(ISHR)
+    {
+        SHIFT_OP(popInt, pushInt, 0x1F, >>);
+        NEXT();
+    }
+OPCODE(LSHR)
+    {
+        SHIFT_OP(popLong, pushLong, 0x3F, >>);
+        NEXT();
+    }
+OPCODE(IUSHR)
+    {
+        UNSIGNED_SHIFT_OP(popInt, pushInt, 0x1F);
+        NEXT();
+    }
+OPCODE(LUSHR)
+    {
+        UNSIGNED_SHIFT_OP(popLong, pushLong, 0x3F);
+        NEXT();
+    }
+OPCODE(IAND)
+    {
+        BINARY_OP(popInt, pushInt, &);
+        NEXT();
+    }
+OPCODE(LAND)
+    {
+        BINARY_OP(popLong, pushLong, &);
+        NEXT();
+    }
+OPCODE(IOR)
+    {
+        BINARY_OP(popInt, pushInt, |);
+        NEXT();
+    }
+OPCODE(LOR)
+    {
+        BINARY_OP(popLong, pushLong, |);
+        NEXT();
+    }
+OPCODE(IXOR)
+    {
+        BINARY_OP(popInt, pushInt, ^);
+        NEXT();
+    }
+OPCODE(LXOR)
+    {
+        BINARY_OP(popLong, pushLong, ^);
+        NEXT();
+    }
+OPCODE(IINC)
+    {
+        INCREMENT_LOCAL(ip->_operand, ip->_operand2);
+        NEXT();
+    }
+OPCODE(I2L)
+    {
+        CONVERT(popInt, pushLong, jlong);
+        NEXT();
+    }
+OPCODE(I2F)
+    {
+        CONVERT(popInt, pushFloat, jfloat);
+        NEXT();
+    }
+OPCODE(I2D)
+    {
+        CONVERT(popInt, pushDouble, jdouble);
+        NEXT();
+    }
+OPCODE(L2I)
+    {
+        CONVERT(popLong, pushInt, jint);
+        NEXT();
+    }
+OPCODE(L2F)
+    {
+        CONVERT(popLong, pushFloat, jfloat);
+        NEXT();
+    }
+OPCODE(L2D)
+    {
+        CONVERT(popLong, pushDouble, jdouble);
+        NEXT();
+    }
+OPCODE(F2I)
+    {
+        CONVERT_FLOATING(popFloat, pushInt, jint, FLOAT, INT_MAX, INT_MIN);
+        NEXT();
+    }
+OPCODE(F2L)
+    {
+        CONVERT_FLOATING(popFloat, pushLong, jlong, FLOAT, LONG_MAX, LONG_MIN);
+        NEXT();
+    }
+OPCODE(F2D)
+    {
+        CONVERT(popFloat, pushDouble, jdouble);
+        NEXT();
+    }
+OPCODE(D2I)
+    {
+        CONVERT_FLOATING(popDouble, pushInt, jint, DOUBLE, INT_MAX, INT_MIN);
+        NEXT();
+    }
+OPCODE(D2L)
+    {
+        CONVERT_FLOATING(popDouble, pushLong, jlong, DOUBLE, LONG_MAX, LONG_MIN);
+        NEXT();
+    }
+OPCODE(D2F)
+    {
+        CONVERT(popDouble, pushFloat, jfloat);
+        NEXT();
+    }
+OPCODE(I2B)
+    {
+        CONVERT(popInt, pushInt, jbyte);
+        NEXT();
+    }
+OPCODE(I2C)
+    {
+        CONVERT(popInt, pushInt, jchar);
+        NEXT();
+    }
+OPCODE(I2S)
+    {
+        CONVERT(popInt, pushInt, jshort);
+        NEXT();
+    }
+OPCODE(LCMP)
+    {
+        COMPARE_OP(popLong);
+        NEXT();
+    }
+OPCODE(FCMPL)
+    {
+        COMPARE_FLOATING_OP(popFloat, FLOAT, -1);
+        NEXT();
+    }
+OPCODE(FCMPG)
+    {
+        COMPARE_FLOATING_OP(popFloat, FLOAT, 1);
+        NEXT();
+    }
+OPCODE(DCMPL)
+    {
+        COMPARE_FLOATING_OP(popDouble, DOUBLE, -1);
+        NEXT();
+    }
+OPCODE(DCMPG)
+    {
+        COMPARE_FLOATING_OP(popDouble, DOUBLE, 1);
+        NEXT();
+    }
+OPCODE(IFEQ)
+    {
+        IF_ZERO_BRANCH(popInt, 0, ==);
+        NEXT();
+    }
+OPCODE(IFNE)
+    {
+        IF_ZERO_BRANCH(popInt, 0, !=);
+        NEXT();
+    }
+OPCODE(IFLT)
+    {
+        IF_ZERO_BRANCH(popInt, 0, <);
+        NEXT();
+    }
+OPCODE(IFGE)
+    {
+        IF_ZERO_BRANCH(popInt, 0, >=);
+        NEXT();
+    }
+OPCODE(IFGT)
+    {
+        IF_ZERO_BRANCH(popInt, 0, >);
+        NEXT();
+    }
+OPCODE(IFLE)
+    {
+        IF_ZERO_BRANCH(popInt, 0, <=);
+        NEXT();
+    }
+OPCODE(IF_ICMPEQ)
+    {
+        IF_CMP_BRANCH(popInt, ==);
+        NEXT();
+    }
+OPCODE(IF_ICMPNE)
+    {
+        IF_CMP_BRANCH(popInt, !=);
+        NEXT();
+    }
+OPCODE(IF_ICMPLT)
+    {
+        IF_CMP_BRANCH(popInt, <);
+        NEXT();
+    }
+OPCODE(IF_ICMPGE)
+    {
+        IF_CMP_BRANCH(popInt, >=);
+        NEXT();
+    }
+OPCODE(IF_ICMPGT)
+    {
+        IF_CMP_BRANCH(popInt, >);
+        NEXT();
+    }
+OPCODE(IF_ICMPLE)
+    {
+        IF_CMP_BRANCH(popInt, <=);
+        NEXT();
+    }
+OPCODE(IF_ACMPEQ)
+    {
+        IF_CMP_BRANCH(popReference, ==);
+        NEXT();
+    }
+OPCODE(IF_ACMPNE)
+    {
+        IF_CMP_BRANCH(popReference, !=);
+        NEXT();
+    }
+OPCODE(IFNULL)
+    {
+        IF_ZERO_BRANCH(popReference, nullptr, ==);
+        NEXT();
+    }
+OPCODE(IFNONNULL)
+    {
+        IF_ZERO_BRANCH(popReference, nullptr, !=);
+        NEXT();
+    }
+OPCODE(GOTO)
+    {
+        // also GOTO_W
+        BRANCH();
+    }
+OPCODE(TABLESWITCH)
+    {
+        const DecodedSwitch *table = ip->_switch;
+        // one unsigned compare for both bounds
+        auto index = (u4) stack.popInt() - (u4) table->_low;
+        DecodedInstruction *target = index < table->_targets.size()
+                                     ? table->_targets[index]
+                                     : ip->_target;
+        BRANCH_TO(target);
+    }
+OPCODE(LOOKUPSWITCH)
+    {
+        const DecodedSwitch *table = ip->_switch;
+        jint key = stack.popInt();
+        auto found = std::lower_bound(table->_keys.begin(), table->_keys.end(), key);
+        DecodedInstruction *target = found != table->_keys.end() && *found == key
+                                     ? table->_targets[found - table->_keys.begin()]
+                                     : ip->_target;
+        BRANCH_TO(target);
+    }
+OPCODE(IRETURN)
+    {
+        SAFEPOINT_POLL();
+        thread->_returnValue.i = stack.popInt();
+        return nullptr;
+    }
+OPCODE(LRETURN)
+    {
+        SAFEPOINT_POLL();
+        thread->_returnValue.j = stack.popLong();
+        return nullptr;
+    }
+OPCODE(FRETURN)
+    {
+        SAFEPOINT_POLL();
+        thread->_returnValue.f = stack.popFloat();
+        return nullptr;
+    }
+OPCODE(DRETURN)
+    {
+        SAFEPOINT_POLL();
+        thread->_returnValue.d = stack.popDouble();
+        return nullptr;
+    }
+OPCODE(ARETURN)
+    {
+        SAFEPOINT_POLL();
+        return Resolver::javaOop(stack.popReference());
+    }
+OPCODE(RETURN)
+    {
+        SAFEPOINT_POLL();
+        // monitor released in invokeXXX
+        return nullptr;
+    }
+OPCODE(GETSTATIC)
+    {
+        GETSTATIC_OP(ip->_operand);
+        QUICKEN(quickenField);
+        NEXT();
+    }
+OPCODE(PUTSTATIC)
+    {
+        PUTSTATIC_OP(ip->_operand);
+        QUICKEN(quickenField);
+        NEXT();
+    }
+OPCODE(GETFIELD)
+    {
+        GETFIELD_OP(ip->_operand);
+        QUICKEN(quickenField);
+        NEXT();
+    }
+OPCODE(PUTFIELD)
+    {
+        PUTFIELD_OP(ip->_operand);
+        QUICKEN(quickenField);
+        NEXT();
+    }
+OPCODE(INVOKEVIRTUAL)
+    {
+        INVOKE_OP(invokeVirtual, rt, ip->_operand);
+        QUICKEN(quickenInvoke);
+        NEXT();
+    }
+OPCODE(INVOKESPECIAL)
+    {
+        INVOKE_OP(invokeSpecial, rt, ip->_operand);
+        QUICKEN(quickenInvoke);
+        NEXT();
+    }
+OPCODE(INVOKESTATIC)
+    {
+        INVOKE_OP(invokeStatic, rt, ip->_operand);
+        QUICKEN(quickenInvoke);
+        NEXT();
+    }
+OPCODE(INVOKEINTERFACE)
+    {
+        INVOKE_OP(invokeInterface, rt, ip->_operand, ip->_operand2);
+        NEXT();
+    }
+OPCODE(NEW)
+    {
+        NEW_OP(rt, ip->_operand, ip->_bci);
+        QUICKEN(quickenNew);
+        NEXT();
+    }
+OPCODE(NEWARRAY)
+    {
+        NEWARRAY_OP(ip->_operand);
+        NEXT();
+    }
+OPCODE(ANEWARRAY)
+    {
+        ANEWARRAY_OP(ip->_operand);
+        NEXT();
+    }
+OPCODE(MULTIANEWARRAY)
+    {
+        MULTIANEWARRAY_OP(ip->_operand, ip->_operand2);
+        NEXT();
+    }
+OPCODE(ARRAYLENGTH)
+    {
+        ARRAYLENGTH_OP();
+        NEXT();
+    }
+OPCODE(ATHROW)
+    {
+        goto exceptionHandler;
+    }
+OPCODE(CHECKCAST)
+    {
+        INSTANCEOF_OP(ip->_operand, true);
+        NEXT();
+    }
+OPCODE(INSTANCEOF)
+    {
+        INSTANCEOF_OP(ip->_operand, false);
+        NEXT();
+    }
+OPCODE(MONITORENTER)
+    {
+        MONITOR_OP(monitorEnter);
+        NEXT();
+    }
+OPCODE(MONITOREXIT)
+    {
+        MONITOR_OP(monitorExit);
+        NEXT();
+    }
+OPCODE(FAST_AGETFIELD)
+    {
+        GETFIELD_AT(ip->_entry, oop, pushReference);
+        NEXT();
+    }
+OPCODE(FAST_IGETFIELD)
+    {
+        GETFIELD_AT(ip->_entry, jint, pushInt);
+        NEXT();
+    }
+OPCODE(FAST_LGETFIELD)
+    {
+        GETFIELD_AT(ip->_entry, jlong, pushLong);
+        NEXT();
+    }
+OPCODE(FAST_FGETFIELD)
+    {
+        GETFIELD_AT(ip->_entry, jfloat, pushFloat);
+        NEXT();
+    }
+OPCODE(FAST_DGETFIELD)
+    {
+        GETFIELD_AT(ip->_entry, jdouble, pushDouble);
+        NEXT();
+    }
+OPCODE(FAST_APUTFIELD)
+    {
+        PUTFIELD_AT(ip->_entry, oop, popReference);
+        NEXT();
+    }
+OPCODE(FAST_IPUTFIELD)
+    {
+        PUTFIELD_AT(ip->_entry, jint, popInt);
+        NEXT();
+    }
+OPCODE(FAST_LPUTFIELD)
+    {
+        PUTFIELD_AT(ip->_entry, jlong, popLong);
+        NEXT();
+    }
+OPCODE(FAST_FPUTFIELD)
+    {
+        PUTFIELD_AT(ip->_entry, jfloat, popFloat);
+        NEXT();
+    }
+OPCODE(FAST_DPUTFIELD)
+    {
+        PUTFIELD_AT(ip->_entry, jdouble, popDouble);
+        NEXT();
+    }
+OPCODE(FAST_GETSTATIC)
+    {
+        Execution::getStatic(ip->_entry, stack.flush());
+        NEXT();
+    }
+OPCODE(FAST_PUTSTATIC)
+    {
+        Execution::putStatic(ip->_entry, stack.flush());
+        NEXT();
+    }
+OPCODE(FAST_NEW)
+    {
+        NEW_OP(ip->_entry->_klass, ip->_bci);
+        NEXT();
+    }
+OPCODE(FAST_INVOKEVIRTUAL)
+    {
+        INVOKE_OP(invokeVirtual, ip->_entry);
+        NEXT();
+    }
+OPCODE(FAST_INVOKEDIRECT)
+    {
+        INVOKE_OP(invokeDirect, ip->_entry);
+        NEXT();
+    }
+OPCODE(FAST_LDC)
+    {
+        // also FAST_LDC_W, float constants are pushed as their bits
+        stack.pushInt(rt->getResolved<jint>(ip->_operand));
+        NEXT();
+    }
+OPCODE(FAST_ALDC)
+    {
+        // also FAST_ALDC_W
+        stack.pushReference(rt->getResolved<jobject>(ip->_operand));
+        NEXT();
+    }
+OPCODE(ALOAD_0_GETFIELD)
+    {
+        stack.pushReference(locals.getReference(0));
+        // the GETFIELD runs here once it is quickened
+        ++ip;
+        switch (rewrittenCode[ip->_bci]) {
+            case OPC_FAST_AGETFIELD: {
+                GETFIELD_AT(ip->_entry, oop, pushReference);
+                break;
+            }
+            case OPC_FAST_IGETFIELD: {
+                GETFIELD_AT(ip->_entry, jint, pushInt);
+                break;
+            }
+            case OPC_FAST_LGETFIELD: {
+                GETFIELD_AT(ip->_entry, jlong, pushLong);
+                break;
+            }
+            case OPC_FAST_FGETFIELD: {
+                GETFIELD_AT(ip->_entry, jfloat, pushFloat);
+                break;
+            }
+            case OPC_FAST_DGETFIELD: {
+                GETFIELD_AT(ip->_entry, jdouble, pushDouble);
+                break;
+            }
+            default:
+                DISPATCH();
+        }
+        NEXT();
+    }
+OPCODE(ILOAD_ILOAD_IF_ICMPGE)
+    {
+        auto v1 = locals.getInt(ip->_operand);
+        auto v2 = locals.getInt(ip[1]._operand);
+        // branches from the IF_ICMPGE, polling as it does on its own
+        ip += 2;
+        if (v1 >= v2) {
+            BRANCH();
+        }
+        NEXT();
+    }
+OPCODE(ILOAD_IINC_GOTO)
+    {
+        stack.pushInt(locals.getInt(ip->_operand));
+        INCREMENT_LOCAL(ip[1]._operand, ip[1]._operand2);
+        // branches from the GOTO, polling as it does on its own
+        ip += 2;
+        BRANCH();
+    }
+OPCODE(ALOAD_ILOAD_IALOAD)
+    {
+        jobject ref = locals.getReference(ip->_operand);
+        int index = locals.getInt(ip[1]._operand);
+        ip += 2;
+        LOAD_ARRAY_ELEMENT_AT(jint, typeArray, pushInt);
+        NEXT();
+    }
+
+            exceptionHandler:
+            {
+                SYNC_PC();
+                auto exceptionOop = Resolver::instance(stack.popReference());
+                if (exceptionOop == nullptr) {
+                    THROW_NULL_POINTER();
+                }
+
+                int handler = thread->tryHandleException(exceptionOop);
+                if (handler > 0) {
+                    D("athrow: exception handler found at offset: %d", handler);
+                    stack.clear();
+                    stack.pushReference(exceptionOop);
+                    ip = decodedCode->getInstructionAt(handler);
+                    DISPATCH();
+                }
+
+                D("athrow: exception handler not found, rethrowing it to caller");
+                return exceptionOop;
+            }
+        }
+
+        _handlers[OPC_NOP] = &&OPCODE_LABEL(NOP);
+        _handlers[OPC_ACONST_NULL] = &&OPCODE_LABEL(ACONST_NULL);
+        _handlers[OPC_BIPUSH] = &&OPCODE_LABEL(BIPUSH);
+        _handlers[OPC_LCONST_0] = &&OPCODE_LABEL(LCONST_0);
+        _handlers[OPC_LCONST_1] = &&OPCODE_LABEL(LCONST_1);
+        _handlers[OPC_FCONST_0] = &&OPCODE_LABEL(FCONST_0);
+        _handlers[OPC_FCONST_1] = &&OPCODE_LABEL(FCONST_1);
+        _handlers[OPC_FCONST_2] = &&OPCODE_LABEL(FCONST_2);
+        _handlers[OPC_DCONST_0] = &&OPCODE_LABEL(DCONST_0);
+        _handlers[OPC_DCONST_1] = &&OPCODE_LABEL(DCONST_1);
+        _handlers[OPC_LDC] = &&OPCODE_LABEL(LDC);
+        _handlers[OPC_LDC2_W] = &&OPCODE_LABEL(LDC2_W);
+        _handlers[OPC_ILOAD] = &&OPCODE_LABEL(ILOAD);
+        _handlers[OPC_LLOAD] = &&OPCODE_LABEL(LLOAD);
+        _handlers[OPC_FLOAD] = &&OPCODE_LABEL(FLOAD);
+        _handlers[OPC_DLOAD] = &&OPCODE_LABEL(DLOAD);
+        _handlers[OPC_ALOAD] = &&OPCODE_LABEL(ALOAD);
+        _handlers[OPC_IALOAD] = &&OPCODE_LABEL(IALOAD);
+        _handlers[OPC_LALOAD] = &&OPCODE_LABEL(LALOAD);
+        _handlers[OPC_FALOAD] = &&OPCODE_LABEL(FALOAD);
+        _handlers[OPC_DALOAD] = &&OPCODE_LABEL(DALOAD);
+        _handlers[OPC_AALOAD] = &&OPCODE_LABEL(AALOAD);
+        _handlers[OPC_BALOAD] = &&OPCODE_LABEL(BALOAD);
+        _handlers[OPC_CALOAD] = &&OPCODE_LABEL(CALOAD);
+        _handlers[OPC_SALOAD] = &&OPCODE_LABEL(SALOAD);
+        _handlers[OPC_ISTORE] = &&OPCODE_LABEL(ISTORE);
+        _handlers[OPC_LSTORE] = &&OPCODE_LABEL(LSTORE);
+        _handlers[OPC_FSTORE] = &&OPCODE_LABEL(FSTORE);
+        _handlers[OPC_DSTORE] = &&OPCODE_LABEL(DSTORE);
+        _handlers[OPC_ASTORE] = &&OPCODE_LABEL(ASTORE);
+        _handlers[OPC_IASTORE] = &&OPCODE_LABEL(IASTORE);
+        _handlers[OPC_LASTORE] = &&OPCODE_LABEL(LASTORE);
+        _handlers[OPC_FASTORE] = &&OPCODE_LABEL(FASTORE);
+        _handlers[OPC_DASTORE] = &&OPCODE_LABEL(DASTORE);
+        _handlers[OPC_AASTORE] = &&OPCODE_LABEL(AASTORE);
+        _handlers[OPC_BASTORE] = &&OPCODE_LABEL(BASTORE);
+        _handlers[OPC_CASTORE] = &&OPCODE_LABEL(CASTORE);
+        _handlers[OPC_SASTORE] = &&OPCODE_LABEL(SASTORE);
+        _handlers[OPC_POP] = &&OPCODE_LABEL(POP);
+        _handlers[OPC_POP2] = &&OPCODE_LABEL(POP2);
+        _handlers[OPC_DUP] = &&OPCODE_LABEL(DUP);
+        _handlers[OPC_DUP_X1] = &&OPCODE_LABEL(DUP_X1);
+        _handlers[OPC_DUP_X2] = &&OPCODE_LABEL(DUP_X2);
+        _handlers[OPC_DUP2] = &&OPCODE_LABEL(DUP2);
+        _handlers[OPC_DUP2_X1] = &&OPCODE_LABEL(DUP2_X1);
+        _handlers[OPC_DUP2_X2] = &&OPCODE_LABEL(DUP2_X2);
+        _handlers[OPC_SWAP] = &&OPCODE_LABEL(SWAP);
+        _handlers[OPC_IADD] = &&OPCODE_LABEL(IADD);
+        _handlers[OPC_LADD] = &&OPCODE_LABEL(LADD);
+        _handlers[OPC_FADD] = &&OPCODE_LABEL(FADD);
+        _handlers[OPC_DADD] = &&OPCODE_LABEL(DADD);
+        _handlers[OPC_ISUB] = &&OPCODE_LABEL(ISUB);
+        _handlers[OPC_LSUB] = &&OPCODE_LABEL(LSUB);
+        _handlers[OPC_FSUB] = &&OPCODE_LABEL(FSUB);
+        _handlers[OPC_DSUB] = &&OPCODE_LABEL(DSUB);
+        _handlers[OPC_IMUL] = &&OPCODE_LABEL(IMUL);
+        _handlers[OPC_LMUL] = &&OPCODE_LABEL(LMUL);
+        _handlers[OPC_FMUL] = &&OPCODE_LABEL(FMUL);
+        _handlers[OPC_DMUL] = &&OPCODE_LABEL(DMUL);
+        _handlers[OPC_IDIV] = &&OPCODE_LABEL(IDIV);
+        _handlers[OPC_LDIV] = &&OPCODE_LABEL(LDIV);
+        _handlers[OPC_FDIV] = &&OPCODE_LABEL(FDIV);
+        _handlers[OPC_DDIV] = &&OPCODE_LABEL(DDIV);
+        _handlers[OPC_IREM] = &&OPCODE_LABEL(IREM);
+        _handlers[OPC_LREM] = &&OPCODE_LABEL(LREM);
+        _handlers[OPC_INEG] = &&OPCODE_LABEL(INEG);
+        _handlers[OPC_LNEG] = &&OPCODE_LABEL(LNEG);
+        _handlers[OPC_ISHL] = &&OPCODE_LABEL(ISHL);
+        _handlers[OPC_LSHL] = &&OPCODE_LABEL(LSHL);
+        _handlers[OPC_ISHR] = &&OPCODE_LABEL(ISHR);
+        _handlers[OPC_LSHR] = &&OPCODE_LABEL(LSHR);
+        _handlers[OPC_IUSHR] = &&OPCODE_LABEL(IUSHR);
+        _handlers[OPC_LUSHR] = &&OPCODE_LABEL(LUSHR);
+        _handlers[OPC_IAND] = &&OPCODE_LABEL(IAND);
+        _handlers[OPC_LAND] = &&OPCODE_LABEL(LAND);
+        _handlers[OPC_IOR] = &&OPCODE_LABEL(IOR);
+        _handlers[OPC_LOR] = &&OPCODE_LABEL(LOR);
+        _handlers[OPC_IXOR] = &&OPCODE_LABEL(IXOR);
+        _handlers[OPC_LXOR] = &&OPCODE_LABEL(LXOR);
+        _handlers[OPC_IINC] = &&OPCODE_LABEL(IINC);
+        _handlers[OPC_I2L] = &&OPCODE_LABEL(I2L);
+        _handlers[OPC_I2F] = &&OPCODE_LABEL(I2F);
+        _handlers[OPC_I2D] = &&OPCODE_LABEL(I2D);
+        _handlers[OPC_L2I] = &&OPCODE_LABEL(L2I);
+        _handlers[OPC_L2F] = &&OPCODE_LABEL(L2F);
+        _handlers[OPC_L2D] = &&OPCODE_LABEL(L2D);
+        _handlers[OPC_F2I] = &&OPCODE_LABEL(F2I);
+        _handlers[OPC_F2L] = &&OPCODE_LABEL(F2L);
+        _handlers[OPC_F2D] = &&OPCODE_LABEL(F2D);
+        _handlers[OPC_D2I] = &&OPCODE_LABEL(D2I);
+        _handlers[OPC_D2L] = &&OPCODE_LABEL(D2L);
+        _handlers[OPC_D2F] = &&OPCODE_LABEL(D2F);
+        _handlers[OPC_I2B] = &&OPCODE_LABEL(I2B);
+        _handlers[OPC_I2C] = &&OPCODE_LABEL(I2C);
+        _handlers[OPC_I2S] = &&OPCODE_LABEL(I2S);
+        _handlers[OPC_LCMP] = &&OPCODE_LABEL(LCMP);
+        _handlers[OPC_FCMPL] = &&OPCODE_LABEL(FCMPL);
+        _handlers[OPC_FCMPG] = &&OPCODE_LABEL(FCMPG);
+        _handlers[OPC_DCMPL] = &&OPCODE_LABEL(DCMPL);
+        _handlers[OPC_DCMPG] = &&OPCODE_LABEL(DCMPG);
+        _handlers[OPC_IFEQ] = &&OPCODE_LABEL(IFEQ);
+        _handlers[OPC_IFNE] = &&OPCODE_LABEL(IFNE);
+        _handlers[OPC_IFLT] = &&OPCODE_LABEL(IFLT);
+        _handlers[OPC_IFGE] = &&OPCODE_LABEL(IFGE);
+        _handlers[OPC_IFGT] = &&OPCODE_LABEL(IFGT);
+        _handlers[OPC_IFLE] = &&OPCODE_LABEL(IFLE);
+        _handlers[OPC_IF_ICMPEQ] = &&OPCODE_LABEL(IF_ICMPEQ);
+        _handlers[OPC_IF_ICMPNE] = &&OPCODE_LABEL(IF_ICMPNE);
+        _handlers[OPC_IF_ICMPLT] = &&OPCODE_LABEL(IF_ICMPLT);
+        _handlers[OPC_IF_ICMPGE] = &&OPCODE_LABEL(IF_ICMPGE);
+        _handlers[OPC_IF_ICMPGT] = &&OPCODE_LABEL(IF_ICMPGT);
+        _handlers[OPC_IF_ICMPLE] = &&OPCODE_LABEL(IF_ICMPLE);
+        _handlers[OPC_IF_ACMPEQ] = &&OPCODE_LABEL(IF_ACMPEQ);
+        _handlers[OPC_IF_ACMPNE] = &&OPCODE_LABEL(IF_ACMPNE);
+        _handlers[OPC_IFNULL] = &&OPCODE_LABEL(IFNULL);
+        _handlers[OPC_IFNONNULL] = &&OPCODE_LABEL(IFNONNULL);
+        _handlers[OPC_GOTO] = &&OPCODE_LABEL(GOTO);
+        _handlers[OPC_TABLESWITCH] = &&OPCODE_LABEL(TABLESWITCH);
+        _handlers[OPC_LOOKUPSWITCH] = &&OPCODE_LABEL(LOOKUPSWITCH);
+        _handlers[OPC_IRETURN] = &&OPCODE_LABEL(IRETURN);
+        _handlers[OPC_LRETURN] = &&OPCODE_LABEL(LRETURN);
+        _handlers[OPC_FRETURN] = &&OPCODE_LABEL(FRETURN);
+        _handlers[OPC_DRETURN] = &&OPCODE_LABEL(DRETURN);
+        _handlers[OPC_ARETURN] = &&OPCODE_LABEL(ARETURN);
+        _handlers[OPC_RETURN] = &&OPCODE_LABEL(RETURN);
+        _handlers[OPC_GETSTATIC] = &&OPCODE_LABEL(GETSTATIC);
+        _handlers[OPC_PUTSTATIC] = &&OPCODE_LABEL(PUTSTATIC);
+        _handlers[OPC_GETFIELD] = &&OPCODE_LABEL(GETFIELD);
+        _handlers[OPC_PUTFIELD] = &&OPCODE_LABEL(PUTFIELD);
+        _handlers[OPC_INVOKEVIRTUAL] = &&OPCODE_LABEL(INVOKEVIRTUAL);
+        _handlers[OPC_INVOKESPECIAL] = &&OPCODE_LABEL(INVOKESPECIAL);
+        _handlers[OPC_INVOKESTATIC] = &&OPCODE_LABEL(INVOKESTATIC);
+        _handlers[OPC_INVOKEINTERFACE] = &&OPCODE_LABEL(INVOKEINTERFACE);
+        _handlers[OPC_NEW] = &&OPCODE_LABEL(NEW);
+        _handlers[OPC_NEWARRAY] = &&OPCODE_LABEL(NEWARRAY);
+        _handlers[OPC_ANEWARRAY] = &&OPCODE_LABEL(ANEWARRAY);
+        _handlers[OPC_MULTIANEWARRAY] = &&OPCODE_LABEL(MULTIANEWARRAY);
+        _handlers[OPC_ARRAYLENGTH] = &&OPCODE_LABEL(ARRAYLENGTH);
+        _handlers[OPC_ATHROW] = &&OPCODE_LABEL(ATHROW);
+        _handlers[OPC_CHECKCAST] = &&OPCODE_LABEL(CHECKCAST);
+        _handlers[OPC_INSTANCEOF] = &&OPCODE_LABEL(INSTANCEOF);
+        _handlers[OPC_MONITORENTER] = &&OPCODE_LABEL(MONITORENTER);
+        _handlers[OPC_MONITOREXIT] = &&OPCODE_LABEL(MONITOREXIT);
+        _handlers[OPC_FAST_AGETFIELD] = &&OPCODE_LABEL(FAST_AGETFIELD);
+        _handlers[OPC_FAST_IGETFIELD] = &&OPCODE_LABEL(FAST_IGETFIELD);
+        _handlers[OPC_FAST_LGETFIELD] = &&OPCODE_LABEL(FAST_LGETFIELD);
+        _handlers[OPC_FAST_FGETFIELD] = &&OPCODE_LABEL(FAST_FGETFIELD);
+        _handlers[OPC_FAST_DGETFIELD] = &&OPCODE_LABEL(FAST_DGETFIELD);
+        _handlers[OPC_FAST_APUTFIELD] = &&OPCODE_LABEL(FAST_APUTFIELD);
+        _handlers[OPC_FAST_IPUTFIELD] = &&OPCODE_LABEL(FAST_IPUTFIELD);
+        _handlers[OPC_FAST_LPUTFIELD] = &&OPCODE_LABEL(FAST_LPUTFIELD);
+        _handlers[OPC_FAST_FPUTFIELD] = &&OPCODE_LABEL(FAST_FPUTFIELD);
+        _handlers[OPC_FAST_DPUTFIELD] = &&OPCODE_LABEL(FAST_DPUTFIELD);
+        _handlers[OPC_FAST_GETSTATIC] = &&OPCODE_LABEL(FAST_GETSTATIC);
+        _handlers[OPC_FAST_PUTSTATIC] = &&OPCODE_LABEL(FAST_PUTSTATIC);
+        _handlers[OPC_FAST_NEW] = &&OPCODE_LABEL(FAST_NEW);
+        _handlers[OPC_FAST_INVOKEVIRTUAL] = &&OPCODE_LABEL(FAST_INVOKEVIRTUAL);
+        _handlers[OPC_FAST_INVOKEDIRECT] = &&OPCODE_LABEL(FAST_INVOKEDIRECT);
+        _handlers[OPC_FAST_LDC] = &&OPCODE_LABEL(FAST_LDC);
+        _handlers[OPC_FAST_LDC_W] = &&OPCODE_LABEL(FAST_LDC);
+        _handlers[OPC_FAST_ALDC] = &&OPCODE_LABEL(FAST_ALDC);
+        _handlers[OPC_FAST_ALDC_W] = &&OPCODE_LABEL(FAST_ALDC);
+        _handlers[OPC_ALOAD_0_GETFIELD] = &&OPCODE_LABEL(ALOAD_0_GETFIELD);
+        _handlers[OPC_ILOAD_ILOAD_IF_ICMPGE] = &&OPCODE_LABEL(ILOAD_ILOAD_IF_ICMPGE);
+        _handlers[OPC_ILOAD_IINC_GOTO] = &&OPCODE_LABEL(ILOAD_IINC_GOTO);
+        _handlers[OPC_ALOAD_ILOAD_IALOAD] = &&OPCODE_LABEL(ALOAD_ILOAD_IALOAD);
+        return nullptr;
+    }
+}
+
+#endif
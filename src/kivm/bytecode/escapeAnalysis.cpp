@@ -0,0 +1,1009 @@
+//
+// Escape analysis for allocating objects in the frame arena
+//
+
+#include <kivm/bytecode/escapeAnalysis.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/codeBlob.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/cfg/controlFlowGraph.h>
+#include <kivm/classfile/attributeInfo.h>
+#include <kivm/classfile/constantPool.h>
+#include <kivm/classpath/system.h>
+#include <kivm/oop/method.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/runtime/constantPool.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+
+// Values are sets of tracked objects, one bit each: reference arguments
+// first, then NEW sites. A slot holds the set of objects it may refer to,
+// merges are unions. Everything that is not tracked is the empty set,
+// since nothing tracked is ever stored into an object, a static or an
+// array without escaping, so loads from them never produce one.
+
+namespace kivm {
+    using ValueSet = u8;
+
+    struct EscapeState {
+        std::vector<ValueSet> _locals;
+        std::vector<ValueSet> _stack;
+    };
+
+    struct ArgumentSlot {
+        int _slots;
+        bool _reference;
+    };
+
+    static inline int readU2(const CodeBlob &code, int offset) {
+        return code[offset] << 8 | code[offset + 1];
+    }
+
+    /**
+     * Arguments of a method descriptor.
+     * @return the first character of the return type
+     */
+    static wchar_t parseArguments(const String &descriptor, std::vector<ArgumentSlot> &arguments) {
+        size_t offset = 1;
+        while (descriptor[offset] != L')') {
+            wchar_t type = descriptor[offset];
+            while (descriptor[offset] == L'[') {
+                ++offset;
+            }
+            if (descriptor[offset] == L'L') {
+                offset = descriptor.find(L';', offset);
+            }
+            ++offset;
+
+            bool reference = type == L'L' || type == L'[';
+            arguments.push_back(ArgumentSlot{type == L'J' || type == L'D' ? 2 : 1, reference});
+        }
+        return descriptor[offset + 1];
+    }
+
+    static CONSTANT_Utf8_info *getMemberDescriptor(cp_info **pool, int index) {
+        int nameAndTypeIndex = 0;
+        switch (pool[index]->tag) {
+            case CONSTANT_Fieldref:
+                nameAndTypeIndex = ((CONSTANT_Fieldref_info *) pool[index])->name_and_type_index;
+                break;
+            case CONSTANT_Methodref:
+                nameAndTypeIndex = ((CONSTANT_Methodref_info *) pool[index])->name_and_type_index;
+                break;
+            case CONSTANT_InterfaceMethodref:
+                nameAndTypeIndex = ((CONSTANT_InterfaceMethodref_info *) pool[index])->name_and_type_index;
+                break;
+            case CONSTANT_InvokeDynamic:
+                nameAndTypeIndex = ((CONSTANT_InvokeDynamic_info *) pool[index])->name_and_type_index;
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE_M("not a member reference: %d", index);
+        }
+        auto nameAndType = requireConstant<CONSTANT_NameAndType_info>(pool, nameAndTypeIndex);
+        return requireConstant<CONSTANT_Utf8_info>(pool, nameAndType->descriptor_index);
+    }
+
+    static inline void push(EscapeState &state, ValueSet value, int count = 1) {
+        state._stack.insert(state._stack.end(), (size_t) count, value);
+    }
+
+    static inline ValueSet pop(EscapeState &state, int count = 1) {
+        assert(state._stack.size() >= (size_t) count);
+        ValueSet popped = 0;
+        for (int i = 0; i < count && !state._stack.empty(); ++i) {
+            popped |= state._stack.back();
+            state._stack.pop_back();
+        }
+        return popped;
+    }
+
+    static inline void setLocal(EscapeState &state, int index, ValueSet value) {
+        if (index >= 0 && index < (int) state._locals.size()) {
+            state._locals[index] = value;
+        }
+    }
+
+    /**
+     * Copy the top {@code count} slots, and insert them
+     * {@code depth} slots below the top.
+     */
+    static void dup(EscapeState &state, int count, int depth) {
+        auto &stack = state._stack;
+        assert(stack.size() >= (size_t) depth);
+        std::vector<ValueSet> copied(stack.end() - count, stack.end());
+        stack.insert(stack.end() - depth, copied.begin(), copied.end());
+    }
+
+    /**
+     * Merge {@code from} into {@code to}.
+     * @return whether {@code to} changed
+     */
+    static bool merge(std::vector<ValueSet> &to, const std::vector<ValueSet> &from) {
+        bool changed = false;
+        if (to.size() < from.size()) {
+            to.resize(from.size(), 0);
+            changed = true;
+        }
+        for (size_t i = 0; i < from.size(); ++i) {
+            if ((to[i] | from[i]) != to[i]) {
+                to[i] |= from[i];
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    struct LocalAccess {
+        int _index;
+        int _slots;
+        bool _store;
+    };
+
+    /**
+     * The local variable read or written by the instruction at {@code bci},
+     * {@code _index} is -1 if there is none.
+     */
+    static LocalAccess getLocalAccess(const CodeBlob &code, int bci) {
+        int opcode = code[bci];
+        int index = -1;
+        bool wide = opcode == OPC_WIDE;
+        if (wide) {
+            opcode = code[bci + 1];
+        }
+
+        int type = 0;
+        bool store = false;
+        if (opcode >= OPC_ILOAD && opcode <= OPC_ALOAD) {
+            type = opcode - OPC_ILOAD;
+            index = wide ? readU2(code, bci + 2) : code[bci + 1];
+        } else if (opcode >= OPC_ILOAD_0 && opcode <= OPC_ALOAD_3) {
+            type = (opcode - OPC_ILOAD_0) / 4;
+            index = (opcode - OPC_ILOAD_0) % 4;
+        } else if (opcode >= OPC_ISTORE && opcode <= OPC_ASTORE) {
+            type = opcode - OPC_ISTORE;
+            index = wide ? readU2(code, bci + 2) : code[bci + 1];
+            store = true;
+        } else if (opcode >= OPC_ISTORE_0 && opcode <= OPC_ASTORE_3) {
+            type = (opcode - OPC_ISTORE_0) / 4;
+            index = (opcode - OPC_ISTORE_0) % 4;
+            store = true;
+        } else if (opcode == OPC_IINC) {
+            index = wide ? readU2(code, bci + 2) : code[bci + 1];
+        }
+
+        // long and double are the second and the fourth type
+        return LocalAccess{index, type == 1 || type == 3 ? 2 : 1, store};
+    }
+
+    static std::vector<EscapeAnalysis *> &getAnalyzingMethods() {
+        static thread_local std::vector<EscapeAnalysis *> analyzing;
+        return analyzing;
+    }
+
+    class EscapeAnalyzer final {
+    private:
+        Method *_method;
+        const CodeBlob &_code;
+        RuntimeConstantPool *_rt;
+        cp_info **_pool;
+
+        std::vector<ArgumentSlot> _arguments;
+
+        /**
+         * By argument and by bci, -1 if not tracked.
+         */
+        std::vector<int> _argumentBits;
+        std::vector<int> _siteBits;
+
+        /**
+         * By bci, values held by any slot when NEW is reached,
+         * ignoring locals that are stored before they are read again.
+         */
+        std::vector<ValueSet> _liveAtSites;
+
+        /**
+         * By bci of NEW sites, locals that may be read later.
+         */
+        std::map<int, std::vector<bool>> _liveLocalsAtSites;
+
+        ValueSet _escaped = 0;
+        ValueSet _returned = 0;
+
+    private:
+        static inline ValueSet bit(int index) {
+            return index < 0 ? 0 : 1ULL << index;
+        }
+
+        EscapeState getEntryState();
+
+        /**
+         * Backward liveness of locals, only kept at NEW sites.
+         */
+        void computeLiveLocals(const instr::ControlFlowGraph &cfg);
+
+        void interpret(int bci, EscapeState &state);
+
+        void doInvoke(int opcode, int bci, EscapeState &state);
+
+        /**
+         * @return the method a call runs, if it is known without
+         *         looking at the receiver, otherwise {@code nullptr}
+         */
+        Method *resolveBoundCallee(int opcode, int index);
+
+        /**
+         * @return the analysis of {@code callee} if it can be used now
+         */
+        static EscapeAnalysis *followCallee(Method *callee);
+
+    public:
+        explicit EscapeAnalyzer(Method *method);
+
+        /**
+         * @return false if the method is not supported, then all
+         *         arguments and objects are treated as escaping
+         */
+        bool run();
+
+        void publish(EscapeAnalysis *analysis, bool supported);
+    };
+
+    EscapeAnalyzer::EscapeAnalyzer(Method *method)
+        : _method(method), _code(method->getCodeBlob()),
+          _rt(method->getClass()->getRuntimeConstantPool()),
+          _pool(_rt->getRawPool()) {
+        if (!method->isStatic()) {
+            _arguments.push_back(ArgumentSlot{1, true});
+        }
+        parseArguments(method->getDescriptor(), _arguments);
+
+        int tracked = 0;
+        for (const auto &argument : _arguments) {
+            bool track = argument._reference && tracked < EscapeAnalysis::MAX_TRACKED_VALUES;
+            _argumentBits.push_back(track ? tracked++ : -1);
+        }
+
+        int codeLength = method->getCodeAttribute()->code_length;
+        _siteBits.assign((size_t) codeLength, -1);
+        _liveAtSites.assign((size_t) codeLength, 0);
+    }
+
+    EscapeState EscapeAnalyzer::getEntryState() {
+        EscapeState state;
+        state._locals.assign((size_t) _method->getMaxLocals(), 0);
+
+        int slot = 0;
+        for (size_t i = 0; i < _arguments.size(); ++i) {
+            setLocal(state, slot, bit(_argumentBits[i]));
+            slot += _arguments[i]._slots;
+        }
+        return state;
+    }
+
+    void EscapeAnalyzer::computeLiveLocals(const instr::ControlFlowGraph &cfg) {
+        size_t maxLocals = (size_t) _method->getMaxLocals();
+        std::map<instr::BasicBlock *, std::vector<bool>> liveIn;
+        for (auto block : cfg.getBlocks()) {
+            liveIn[block].assign(maxLocals, false);
+        }
+
+        auto unionInto = [](std::vector<bool> &to, const std::vector<bool> &from) {
+            for (size_t i = 0; i < to.size(); ++i) {
+                if (from[i]) {
+                    to[i] = true;
+                }
+            }
+        };
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto iter = cfg.getBlocks().rbegin(); iter != cfg.getBlocks().rend(); ++iter) {
+                auto block = *iter;
+
+                // any instruction may throw into the handlers of the block
+                std::vector<bool> handlersLive(maxLocals, false);
+                std::vector<bool> live(maxLocals, false);
+                for (auto edge : block->getEdges()) {
+                    if (!edge->isSuccessor(block)) {
+                        continue;
+                    }
+                    const auto &successorLive = liveIn[(instr::BasicBlock *) edge->dest];
+                    unionInto(edge->hasType(instr::CAUGHT_EXCEPTION) ? handlersLive : live, successorLive);
+                }
+
+                const auto &instructions = block->getInstructionNums();
+                for (auto bci = instructions.rbegin(); bci != instructions.rend(); ++bci) {
+                    auto access = getLocalAccess(_code, *bci);
+                    for (int i = 0; i < access._slots; ++i) {
+                        size_t index = (size_t) (access._index + i);
+                        if (access._index >= 0 && index < maxLocals) {
+                            live[index] = !access._store;
+                        }
+                    }
+                    unionInto(live, handlersLive);
+
+                    if (_siteBits[*bci] >= 0) {
+                        _liveLocalsAtSites[*bci] = live;
+                    }
+                }
+
+                if (live != liveIn[block]) {
+                    liveIn[block] = std::move(live);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    bool EscapeAnalyzer::run() {
+        int codeLength = _method->getCodeAttribute()->code_length;
+        int tracked = (int) std::count_if(_argumentBits.begin(), _argumentBits.end(),
+            [](int bit) { return bit >= 0; });
+
+        for (int bci = 0; bci < codeLength; bci += OopMap::getInstructionLength(_code, bci)) {
+            switch (_code[bci]) {
+                case OPC_NEW:
+                    if (tracked < EscapeAnalysis::MAX_TRACKED_VALUES) {
+                        _siteBits[bci] = tracked++;
+                    }
+                    break;
+
+                // subroutines break the frame structure this relies on
+                case OPC_JSR:
+                case OPC_JSR_W:
+                case OPC_RET:
+                    return false;
+                case OPC_WIDE:
+                    if (_code[bci + 1] == OPC_RET) {
+                        return false;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        instr::ControlFlowGraph cfg(_method);
+        computeLiveLocals(cfg);
+
+        std::map<instr::BasicBlock *, EscapeState> entryStates;
+        std::deque<instr::BasicBlock *> worklist;
+
+        auto mergeInto = [&](instr::BasicBlock *block, const EscapeState &state) {
+            auto iter = entryStates.find(block);
+            bool changed = false;
+            if (iter == entryStates.end()) {
+                entryStates[block] = state;
+                changed = true;
+            } else {
+                changed = merge(iter->second._locals, state._locals);
+                changed = merge(iter->second._stack, state._stack) || changed;
+            }
+            if (changed && std::find(worklist.begin(), worklist.end(), block) == worklist.end()) {
+                worklist.push_back(block);
+            }
+        };
+
+        mergeInto(cfg.getEntryBlock(), getEntryState());
+        while (!worklist.empty()) {
+            auto block = worklist.front();
+            worklist.pop_front();
+
+            std::vector<instr::BasicBlock *> handlers;
+            std::vector<instr::BasicBlock *> successors;
+            for (auto edge : block->getEdges()) {
+                if (edge->isSuccessor(block)) {
+                    auto dest = (instr::BasicBlock *) edge->dest;
+                    if (edge->hasType(instr::CAUGHT_EXCEPTION)) {
+                        handlers.push_back(dest);
+                    } else {
+                        successors.push_back(dest);
+                    }
+                }
+            }
+
+            // handlers are entered with the locals of any instruction
+            // in range, and only the exception on the stack
+            EscapeState handlerState;
+            handlerState._stack.push_back(0);
+            auto mergeIntoHandlers = [&](const EscapeState &state) {
+                if (handlers.empty()) {
+                    return;
+                }
+                handlerState._locals = state._locals;
+                for (auto handler : handlers) {
+                    mergeInto(handler, handlerState);
+                }
+            };
+
+            EscapeState state = entryStates[block];
+            for (int bci : block->getInstructionNums()) {
+                if (_siteBits[bci] >= 0) {
+                    const auto &liveLocals = _liveLocalsAtSites[bci];
+                    for (size_t i = 0; i < state._locals.size(); ++i) {
+                        if (liveLocals[i]) {
+                            _liveAtSites[bci] |= state._locals[i];
+                        }
+                    }
+                    for (ValueSet value : state._stack) {
+                        _liveAtSites[bci] |= value;
+                    }
+                }
+
+                mergeIntoHandlers(state);
+                interpret(bci, state);
+                mergeIntoHandlers(state);
+            }
+
+            for (auto successor : successors) {
+                mergeInto(successor, state);
+            }
+        }
+        return true;
+    }
+
+    void EscapeAnalyzer::publish(EscapeAnalysis *analysis, bool supported) {
+        size_t argumentCount = _arguments.size();
+        analysis->_escapingArguments.assign(argumentCount, false);
+        analysis->_returnedArguments.assign(argumentCount, false);
+        for (size_t i = 0; i < argumentCount; ++i) {
+            if (!_arguments[i]._reference) {
+                continue;
+            }
+            ValueSet value = bit(_argumentBits[i]);
+            analysis->_escapingArguments[i] = !supported || value == 0 || (_escaped & value) != 0;
+            analysis->_returnedArguments[i] = supported && (_returned & value) != 0;
+        }
+
+        analysis->_frameLocalSites.assign(_siteBits.size(), -1);
+        analysis->_reusableSites.clear();
+        if (!supported) {
+            return;
+        }
+
+        for (size_t bci = 0; bci < _siteBits.size(); ++bci) {
+            ValueSet value = bit(_siteBits[bci]);
+            if (value == 0 || ((_escaped | _returned) & value) != 0) {
+                continue;
+            }
+            analysis->_frameLocalSites[bci] = (int) analysis->_reusableSites.size();
+            analysis->_reusableSites.push_back((_liveAtSites[bci] & value) == 0);
+        }
+    }
+
+    EscapeAnalysis *EscapeAnalyzer::followCallee(Method *callee) {
+        if (callee == nullptr || callee->isNative() || callee->isAbstract()) {
+            return nullptr;
+        }
+
+        auto analysis = callee->getEscapeAnalysis();
+        if (analysis == nullptr) {
+            return nullptr;
+        }
+
+        if (!analysis->_analyzed.load(std::memory_order_acquire)) {
+            const auto &analyzing = getAnalyzingMethods();
+            if (analyzing.size() >= EscapeAnalysis::MAX_CALL_DEPTH
+                || std::find(analyzing.begin(), analyzing.end(), analysis) != analyzing.end()) {
+                return nullptr;
+            }
+            analysis->analyze();
+        }
+        return analysis;
+    }
+
+    Method *EscapeAnalyzer::resolveBoundCallee(int opcode, int index) {
+        if (_pool[index]->tag != CONSTANT_Methodref && _pool[index]->tag != CONSTANT_InterfaceMethodref) {
+            return nullptr;
+        }
+
+        // never load classes here, a class that is not loaded
+        // yet has not been called either
+        auto methodRef = (CONSTANT_Methodref_info *) _pool[index];
+        auto classInfo = requireConstant<CONSTANT_Class_info>(_pool, methodRef->class_index);
+        auto klass = SystemDictionary::get()->find(
+            requireConstant<CONSTANT_Utf8_info>(_pool, classInfo->name_index)->getConstant());
+        if (klass == nullptr || klass->getClassType() != ClassType::INSTANCE_CLASS) {
+            return nullptr;
+        }
+
+        Method *callee = _rt->getMethod(index);
+        if (callee == nullptr || callee->isStatic() != (opcode == OPC_INVOKESTATIC)) {
+            return nullptr;
+        }
+
+        // the same rule as JavaCall::invokeSimple()
+        if (opcode == OPC_INVOKEVIRTUAL
+            && (callee->isAbstract() || (callee->isPublic() && !callee->isFinal()))) {
+            if (!klass->isFinal()) {
+                return nullptr;
+            }
+            callee = ((InstanceKlass *) klass)->getVirtualMethod(callee->getName(), callee->getDescriptor());
+        }
+        return callee;
+    }
+
+    void EscapeAnalyzer::doInvoke(int opcode, int bci, EscapeState &state) {
+        int index = readU2(_code, bci + 1);
+        std::vector<ArgumentSlot> arguments;
+        bool hasReceiver = opcode != OPC_INVOKESTATIC && opcode != OPC_INVOKEDYNAMIC;
+        if (hasReceiver) {
+            arguments.push_back(ArgumentSlot{1, true});
+        }
+        wchar_t returnType = parseArguments(getMemberDescriptor(_pool, index)->getConstant(), arguments);
+
+        std::vector<ValueSet> values(arguments.size(), 0);
+        for (size_t i = arguments.size(); i-- > 0;) {
+            values[i] = pop(state, arguments[i]._slots);
+        }
+
+        Method *callee = nullptr;
+        if (opcode != OPC_INVOKEINTERFACE && opcode != OPC_INVOKEDYNAMIC) {
+            callee = resolveBoundCallee(opcode, index);
+        }
+        auto summary = followCallee(callee);
+
+        ValueSet result = 0;
+        for (size_t i = 0; i < arguments.size(); ++i) {
+            if (!arguments[i]._reference) {
+                continue;
+            }
+
+            // synchronized methods lock the receiver
+            if (summary == nullptr
+                || summary->_escapingArguments[i]
+                || (i == 0 && hasReceiver && callee->isSynchronized())) {
+                _escaped |= values[i];
+            } else if (summary->_returnedArguments[i]) {
+                result |= values[i];
+            }
+        }
+
+        switch (returnType) {
+            case L'V':
+                break;
+            case L'J':
+            case L'D':
+                push(state, 0, 2);
+                break;
+            case L'L':
+            case L'[':
+                push(state, result);
+                break;
+            default:
+                push(state, 0);
+                break;
+        }
+    }
+
+    void EscapeAnalyzer::interpret(int bci, EscapeState &state) {
+        int opcode = _code[bci];
+        switch (opcode) {
+            case OPC_NOP:
+            case OPC_INEG:
+            case OPC_LNEG:
+            case OPC_FNEG:
+            case OPC_DNEG:
+            case OPC_IINC:
+            case OPC_I2F:
+            case OPC_L2D:
+            case OPC_F2I:
+            case OPC_D2L:
+            case OPC_I2B:
+            case OPC_I2C:
+            case OPC_I2S:
+            case OPC_GOTO:
+            case OPC_GOTO_W:
+            case OPC_CHECKCAST:
+                break;
+
+            case OPC_NEW:
+                push(state, bit(_siteBits[bci]));
+                break;
+
+            case OPC_ACONST_NULL:
+            case OPC_ICONST_M1:
+            case OPC_ICONST_0:
+            case OPC_ICONST_1:
+            case OPC_ICONST_2:
+            case OPC_ICONST_3:
+            case OPC_ICONST_4:
+            case OPC_ICONST_5:
+            case OPC_FCONST_0:
+            case OPC_FCONST_1:
+            case OPC_FCONST_2:
+            case OPC_BIPUSH:
+            case OPC_SIPUSH:
+            case OPC_LDC:
+            case OPC_LDC_W:
+                push(state, 0);
+                break;
+
+            case OPC_LCONST_0:
+            case OPC_LCONST_1:
+            case OPC_DCONST_0:
+            case OPC_DCONST_1:
+            case OPC_LDC2_W:
+                push(state, 0, 2);
+                break;
+
+            case OPC_ILOAD:
+            case OPC_FLOAD:
+                push(state, 0);
+                break;
+            case OPC_LLOAD:
+            case OPC_DLOAD:
+                push(state, 0, 2);
+                break;
+            case OPC_ALOAD:
+                push(state, state._locals[_code[bci + 1]]);
+                break;
+
+            case OPC_ILOAD_0:
+            case OPC_ILOAD_1:
+            case OPC_ILOAD_2:
+            case OPC_ILOAD_3:
+            case OPC_FLOAD_0:
+            case OPC_FLOAD_1:
+            case OPC_FLOAD_2:
+            case OPC_FLOAD_3:
+                push(state, 0);
+                break;
+            case OPC_LLOAD_0:
+            case OPC_LLOAD_1:
+            case OPC_LLOAD_2:
+            case OPC_LLOAD_3:
+            case OPC_DLOAD_0:
+            case OPC_DLOAD_1:
+            case OPC_DLOAD_2:
+            case OPC_DLOAD_3:
+                push(state, 0, 2);
+                break;
+            case OPC_ALOAD_0:
+            case OPC_ALOAD_1:
+            case OPC_ALOAD_2:
+            case OPC_ALOAD_3:
+                push(state, state._locals[opcode - OPC_ALOAD_0]);
+                break;
+
+            case OPC_IALOAD:
+            case OPC_FALOAD:
+            case OPC_AALOAD:
+            case OPC_BALOAD:
+            case OPC_CALOAD:
+            case OPC_SALOAD:
+                pop(state, 2);
+                push(state, 0);
+                break;
+            case OPC_LALOAD:
+            case OPC_DALOAD:
+                pop(state, 2);
+                push(state, 0, 2);
+                break;
+
+            case OPC_ISTORE:
+            case OPC_FSTORE:
+                pop(state);
+                setLocal(state, _code[bci + 1], 0);
+                break;
+            case OPC_LSTORE:
+            case OPC_DSTORE:
+                pop(state, 2);
+                setLocal(state, _code[bci + 1], 0);
+                setLocal(state, _code[bci + 1] + 1, 0);
+                break;
+            case OPC_ASTORE:
+                setLocal(state, _code[bci + 1], pop(state));
+                break;
+
+            case OPC_ISTORE_0:
+            case OPC_ISTORE_1:
+            case OPC_ISTORE_2:
+            case OPC_ISTORE_3:
+                pop(state);
+                setLocal(state, opcode - OPC_ISTORE_0, 0);
+                break;
+            case OPC_FSTORE_0:
+            case OPC_FSTORE_1:
+            case OPC_FSTORE_2:
+            case OPC_FSTORE_3:
+                pop(state);
+                setLocal(state, opcode - OPC_FSTORE_0, 0);
+                break;
+            case OPC_LSTORE_0:
+            case OPC_LSTORE_1:
+            case OPC_LSTORE_2:
+            case OPC_LSTORE_3:
+                pop(state, 2);
+                setLocal(state, opcode - OPC_LSTORE_0, 0);
+                setLocal(state, opcode - OPC_LSTORE_0 + 1, 0);
+                break;
+            case OPC_DSTORE_0:
+            case OPC_DSTORE_1:
+            case OPC_DSTORE_2:
+            case OPC_DSTORE_3:
+                pop(state, 2);
+                setLocal(state, opcode - OPC_DSTORE_0, 0);
+                setLocal(state, opcode - OPC_DSTORE_0 + 1, 0);
+                break;
+            case OPC_ASTORE_0:
+            case OPC_ASTORE_1:
+            case OPC_ASTORE_2:
+            case OPC_ASTORE_3:
+                setLocal(state, opcode - OPC_ASTORE_0, pop(state));
+                break;
+
+            case OPC_AASTORE:
+                _escaped |= pop(state);
+                pop(state, 2);
+                break;
+            case OPC_IASTORE:
+            case OPC_FASTORE:
+            case OPC_BASTORE:
+            case OPC_CASTORE:
+            case OPC_SASTORE:
+                pop(state, 3);
+                break;
+            case OPC_LASTORE:
+            case OPC_DASTORE:
+                pop(state, 4);
+                break;
+
+            case OPC_POP:
+            case OPC_IFEQ:
+            case OPC_IFNE:
+            case OPC_IFLT:
+            case OPC_IFGE:
+            case OPC_IFGT:
+            case OPC_IFLE:
+            case OPC_IFNULL:
+            case OPC_IFNONNULL:
+            case OPC_TABLESWITCH:
+            case OPC_LOOKUPSWITCH:
+                pop(state);
+                break;
+
+            case OPC_POP2:
+            case OPC_IF_ICMPEQ:
+            case OPC_IF_ICMPNE:
+            case OPC_IF_ICMPLT:
+            case OPC_IF_ICMPGE:
+            case OPC_IF_ICMPGT:
+            case OPC_IF_ICMPLE:
+            case OPC_IF_ACMPEQ:
+            case OPC_IF_ACMPNE:
+                pop(state, 2);
+                break;
+
+            case OPC_DUP:
+                dup(state, 1, 1);
+                break;
+            case OPC_DUP_X1:
+                dup(state, 1, 2);
+                break;
+            case OPC_DUP_X2:
+                dup(state, 1, 3);
+                break;
+            case OPC_DUP2:
+                dup(state, 2, 2);
+                break;
+            case OPC_DUP2_X1:
+                dup(state, 2, 3);
+                break;
+            case OPC_DUP2_X2:
+                dup(state, 2, 4);
+                break;
+            case OPC_SWAP: {
+                auto &stack = state._stack;
+                assert(stack.size() >= 2);
+                std::swap(stack[stack.size() - 1], stack[stack.size() - 2]);
+                break;
+            }
+
+            case OPC_IADD:
+            case OPC_FADD:
+            case OPC_ISUB:
+            case OPC_FSUB:
+            case OPC_IMUL:
+            case OPC_FMUL:
+            case OPC_IDIV:
+            case OPC_FDIV:
+            case OPC_IREM:
+            case OPC_FREM:
+            case OPC_ISHL:
+            case OPC_ISHR:
+            case OPC_IUSHR:
+            case OPC_IAND:
+            case OPC_IOR:
+            case OPC_IXOR:
+            case OPC_FCMPL:
+            case OPC_FCMPG:
+            case OPC_L2I:
+            case OPC_L2F:
+            case OPC_D2I:
+            case OPC_D2F:
+                pop(state, 2);
+                push(state, 0);
+                break;
+
+            case OPC_LADD:
+            case OPC_DADD:
+            case OPC_LSUB:
+            case OPC_DSUB:
+            case OPC_LMUL:
+            case OPC_DMUL:
+            case OPC_LDIV:
+            case OPC_DDIV:
+            case OPC_LREM:
+            case OPC_DREM:
+            case OPC_LAND:
+            case OPC_LOR:
+            case OPC_LXOR:
+                pop(state, 4);
+                push(state, 0, 2);
+                break;
+
+            case OPC_LSHL:
+            case OPC_LSHR:
+            case OPC_LUSHR:
+                pop(state, 3);
+                push(state, 0, 2);
+                break;
+
+            case OPC_I2L:
+            case OPC_I2D:
+            case OPC_F2L:
+            case OPC_F2D:
+                pop(state);
+                push(state, 0, 2);
+                break;
+
+            case OPC_LCMP:
+            case OPC_DCMPL:
+            case OPC_DCMPG:
+                pop(state, 4);
+                push(state, 0);
+                break;
+
+            case OPC_ARETURN:
+                _returned |= pop(state);
+                state._stack.clear();
+                break;
+
+            case OPC_ATHROW:
+                _escaped |= pop(state);
+                state._stack.clear();
+                break;
+
+            case OPC_IRETURN:
+            case OPC_LRETURN:
+            case OPC_FRETURN:
+            case OPC_DRETURN:
+            case OPC_RETURN:
+                state._stack.clear();
+                break;
+
+            case OPC_MONITORENTER:
+            case OPC_MONITOREXIT:
+                _escaped |= pop(state);
+                break;
+
+            case OPC_GETSTATIC: {
+                wchar_t type = getMemberDescriptor(_pool, readU2(_code, bci + 1))->getConstant()[0];
+                push(state, 0, type == L'J' || type == L'D' ? 2 : 1);
+                break;
+            }
+
+            case OPC_PUTSTATIC: {
+                wchar_t type = getMemberDescriptor(_pool, readU2(_code, bci + 1))->getConstant()[0];
+                _escaped |= pop(state, type == L'J' || type == L'D' ? 2 : 1);
+                break;
+            }
+
+            case OPC_GETFIELD: {
+                wchar_t type = getMemberDescriptor(_pool, readU2(_code, bci + 1))->getConstant()[0];
+                pop(state);
+                push(state, 0, type == L'J' || type == L'D' ? 2 : 1);
+                break;
+            }
+
+            case OPC_PUTFIELD: {
+                // only the value escapes, not the object written to
+                wchar_t type = getMemberDescriptor(_pool, readU2(_code, bci + 1))->getConstant()[0];
+                _escaped |= pop(state, type == L'J' || type == L'D' ? 2 : 1);
+                pop(state);
+                break;
+            }
+
+            case OPC_INVOKEVIRTUAL:
+            case OPC_INVOKESPECIAL:
+            case OPC_INVOKESTATIC:
+            case OPC_INVOKEINTERFACE:
+            case OPC_INVOKEDYNAMIC:
+                doInvoke(opcode, bci, state);
+                break;
+
+            case OPC_NEWARRAY:
+            case OPC_ANEWARRAY:
+            case OPC_ARRAYLENGTH:
+            case OPC_INSTANCEOF:
+                pop(state);
+                push(state, 0);
+                break;
+
+            case OPC_MULTIANEWARRAY:
+                pop(state, _code[bci + 3]);
+                push(state, 0);
+                break;
+
+            case OPC_WIDE: {
+                int widened = _code[bci + 1];
+                int index = readU2(_code, bci + 2);
+                switch (widened) {
+                    case OPC_ILOAD:
+                    case OPC_FLOAD:
+                        push(state, 0);
+                        break;
+                    case OPC_LLOAD:
+                    case OPC_DLOAD:
+                        push(state, 0, 2);
+                        break;
+                    case OPC_ALOAD:
+                        push(state, state._locals[index]);
+                        break;
+                    case OPC_ISTORE:
+                    case OPC_FSTORE:
+                        pop(state);
+                        setLocal(state, index, 0);
+                        break;
+                    case OPC_LSTORE:
+                    case OPC_DSTORE:
+                        pop(state, 2);
+                        setLocal(state, index, 0);
+                        setLocal(state, index + 1, 0);
+                        break;
+                    case OPC_ASTORE:
+                        setLocal(state, index, pop(state));
+                        break;
+                    default:
+                        // iinc
+                        break;
+                }
+                break;
+            }
+
+            default:
+                PANIC("EscapeAnalysis: unknown bytecode %d at %d", opcode, bci);
+        }
+    }
+
+    EscapeAnalysis::EscapeAnalysis(Method *method)
+        : _method(method) {
+    }
+
+    void EscapeAnalysis::analyze() {
+        // Callees are analyzed on the way, without holding the lock:
+        // two threads may analyze the same method, the first result wins.
+        auto &analyzing = getAnalyzingMethods();
+        analyzing.push_back(this);
+        EscapeAnalyzer analyzer(_method);
+        bool supported = analyzer.run();
+        analyzing.pop_back();
+
+        LockGuard lockGuard(_lock);
+        if (_analyzed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        analyzer.publish(this, supported);
+        _analyzed.store(true, std::memory_order_release);
+
+        D("EscapeAnalysis: %S.%S:%S analyzed, frame local sites: %zd",
+            _method->getClass()->getName().c_str(),
+            _method->getName().c_str(),
+            _method->getDescriptor().c_str(),
+            _reusableSites.size());
+    }
+}
@@ -7,6 +7,13 @@
 #include <kivm/oop/primitiveOop.h>
 #include <kivm/oop/arrayOop.h>
 #include <kivm/oop/method.h>
+#include <kivm/oop/helper.h>
+#include <kivm/memory/universe.h>
+#include <kivm/bytecode/escapeAnalysis.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <cstring>
+#include <new>
 
 namespace kivm {
     static bool checkInherit(Klass *S, Klass *T) {
@@ -48,7 +55,7 @@ namespace kivm {
         return true;
     }
 
-    void Execution::loadConstant(RuntimeConstantPool *rt, Stack &stack, int constantIndex) {
+    void Execution::loadConstant(JavaThread *thread, RuntimeConstantPool *rt, Stack &stack, int constantIndex) {
         switch (rt->getConstantTag(constantIndex)) {
             case CONSTANT_Integer: {
                 stack.pushInt(rt->getInt(constantIndex));
@@ -67,7 +74,17 @@ namespace kivm {
                 break;
             }
             case CONSTANT_String: {
-                stack.pushReference(rt->getString(constantIndex));
+                instanceOop string = nullptr;
+                {
+                    // interning a new string allocates
+                    RecoverableAllocation recoverable(thread);
+                    string = rt->getString(constantIndex);
+                }
+                if (string == nullptr) {
+                    // OutOfMemoryError thrown
+                    return;
+                }
+                stack.pushReference(string);
                 break;
             }
             case CONSTANT_Class: {
@@ -221,41 +238,11 @@ namespace kivm {
         return false;
     }
 
-    void Execution::getField(JavaThread *thread, RuntimeConstantPool *rt, instanceOop receiver, Stack &stack,
-                             int constantIndex) {
-        bool isStatic = receiver == nullptr;
-        auto field = isStatic
-                     ? rt->getStaticField(constantIndex)
-                     : rt->getInstanceField(constantIndex);
-
-        if (field == nullptr) {
-            // TODO: NoSuchFieldException
-            PANIC("FieldID is null, constantIndex: %d", constantIndex);
-        }
-
-        auto instanceKlass = field->_field->getClass();
-        if (!Execution::initializeClass(thread, instanceKlass)) {
-            return;
-        }
-
-        oop fieldValue = nullptr;
-
-        // We are getting a static field.
-        if (receiver == nullptr) {
-            if (!instanceKlass->getStaticFieldValue(field, &fieldValue)) {
-                PANIC("Cannot get static field value, constantIndex: %d", constantIndex);
-            }
-        } else {
-            // We are getting an instance field.
-            if (!instanceKlass->getInstanceFieldValue(receiver, field, &fieldValue)) {
-                PANIC("Cannot get instance field value, constantIndex: %d", constantIndex);
-            }
-        }
-
-        switch (field->_field->getValueType()) {
+    static void pushFieldValue(Stack &stack, jbyte *address, ValueType valueType) {
+        switch (valueType) {
             case ValueType::OBJECT:
             case ValueType::ARRAY: {
-                stack.pushReference(fieldValue);
+                stack.pushReference(*(oop *) address);
                 break;
             }
 
@@ -264,26 +251,22 @@ namespace kivm {
             case ValueType::CHAR:
             case ValueType::BOOLEAN:
             case ValueType::BYTE: {
-                auto intObject = (intOop) fieldValue;
-                stack.pushInt(intObject->getValue());
+                stack.pushInt(helperLoadIntField(address, valueType));
                 break;
             }
 
             case ValueType::FLOAT: {
-                auto floatObject = (floatOop) fieldValue;
-                stack.pushFloat(floatObject->getValue());
+                stack.pushFloat(*(jfloat *) address);
                 break;
             }
 
             case ValueType::DOUBLE: {
-                auto doubleObject = (doubleOop) fieldValue;
-                stack.pushDouble(doubleObject->getValue());
+                stack.pushDouble(*(jdouble *) address);
                 break;
             }
 
             case ValueType::LONG: {
-                auto longObject = (longOop) fieldValue;
-                stack.pushLong(longObject->getValue());
+                stack.pushLong(*(jlong *) address);
                 break;
             }
 
@@ -294,16 +277,47 @@ namespace kivm {
         }
     }
 
-#define PUTFIELD(value) \
+    void Execution::getField(JavaThread *thread, RuntimeConstantPool *rt, instanceOop receiver, Stack &stack,
+                             int constantIndex) {
+        bool isStatic = receiver == nullptr;
+        auto field = isStatic
+                     ? rt->getStaticField(constantIndex)
+                     : rt->getInstanceField(constantIndex);
+
+        if (field == nullptr) {
+            // TODO: NoSuchFieldException
+            PANIC("FieldID is null, constantIndex: %d", constantIndex);
+        }
+
+        auto instanceKlass = field->_field->getClass();
+        if (!Execution::initializeClass(thread, instanceKlass)) {
+            return;
+        }
+
+        // Field values are stored unboxed, we access them in place.
+        jbyte *address = receiver == nullptr
+                         ? instanceKlass->getStaticFieldAddress<jbyte>(field->_offset)
+                         : receiver->getFieldAddress<jbyte>(field->_offset);
+
+        pushFieldValue(stack, address, field->_field->getValueType());
+    }
+
+#define PUTFIELD(TYPE, value) \
         if (isStatic) { \
-            instanceKlass->setStaticFieldValue(field, value); \
+            *instanceKlass->getStaticFieldAddress<TYPE>(field->_offset) = (value); \
         } else { \
             jobject receiverRef = stack.popReference(); \
             instanceOop receiver = Resolver::instance(receiverRef); \
             if (receiver == nullptr) { \
                 thread->throwException(Global::_NullPointerException, false); \
             } else { \
-                instanceKlass->setInstanceFieldValue(receiver, field, value); \
+                if (std::is_same<TYPE, oop>::value) { \
+                    Universe::preWriteBarrier(receiver->getFieldAddress<TYPE>(field->_offset)); \
+                } \
+                *receiver->getFieldAddress<TYPE>(field->_offset) = (value); \
+                if (std::is_same<TYPE, oop>::value) { \
+                    Universe::writeBarrier(receiver->getFieldAddress<TYPE>(field->_offset)); \
+                } \
             } \
         }
 
@@ -330,35 +344,55 @@ namespace kivm {
             case ValueType::ARRAY: {
                 jobject ref = stack.popReference();
                 oop value = Resolver::javaOop(ref);
-                PUTFIELD(value);
+                PUTFIELD(oop, value);
+                break;
+            }
+
+            case ValueType::INT: {
+                jint value = stack.popInt();
+                PUTFIELD(jint, value);
+                break;
+            }
+
+            case ValueType::SHORT: {
+                auto value = (jshort) stack.popInt();
+                PUTFIELD(jshort, value);
+                break;
+            }
+
+            case ValueType::CHAR: {
+                auto value = (jchar) stack.popInt();
+                PUTFIELD(jchar, value);
+                break;
+            }
+
+            case ValueType::BOOLEAN: {
+                auto value = (jboolean) (stack.popInt() & 1);
+                PUTFIELD(jboolean, value);
                 break;
             }
 
-            case ValueType::INT:
-            case ValueType::SHORT:
-            case ValueType::CHAR:
-            case ValueType::BOOLEAN:
             case ValueType::BYTE: {
-                auto intObject = new intOopDesc(stack.popInt());
-                PUTFIELD(intObject);
+                auto value = (jbyte) stack.popInt();
+                PUTFIELD(jbyte, value);
                 break;
             }
 
             case ValueType::FLOAT: {
-                auto floatObject = new floatOopDesc(stack.popFloat());
-                PUTFIELD(floatObject);
+                jfloat value = stack.popFloat();
+                PUTFIELD(jfloat, value);
                 break;
             }
 
             case ValueType::DOUBLE: {
-                auto doubleObject = new doubleOopDesc(stack.popDouble());
-                PUTFIELD(doubleObject);
+                jdouble value = stack.popDouble();
+                PUTFIELD(jdouble, value);
                 break;
             }
 
             case ValueType::LONG: {
-                auto longObject = new longOopDesc(stack.popLong());
-                PUTFIELD(longObject);
+                jlong value = stack.popLong();
+                PUTFIELD(jlong, value);
                 break;
             }
 
@@ -369,7 +403,52 @@ namespace kivm {
         }
     }
 
-    instanceOop Execution::newInstance(JavaThread *thread, RuntimeConstantPool *rt, int constantIndex) {
+    void Execution::getStatic(ResolvedEntry *entry, Stack &stack) {
+        pushFieldValue(stack, entry->_klass->getStaticFieldAddress<jbyte>(entry->_offset),
+            entry->_valueType);
+    }
+
+#define PUTSTATIC(TYPE, value) \
+        *entry->_klass->getStaticFieldAddress<TYPE>(entry->_offset) = (value)
+
+    void Execution::putStatic(ResolvedEntry *entry, Stack &stack) {
+        switch (entry->_valueType) {
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                PUTSTATIC(oop, Resolver::javaOop(stack.popReference()));
+                break;
+            case ValueType::INT:
+                PUTSTATIC(jint, stack.popInt());
+                break;
+            case ValueType::SHORT:
+                PUTSTATIC(jshort, (jshort) stack.popInt());
+                break;
+            case ValueType::CHAR:
+                PUTSTATIC(jchar, (jchar) stack.popInt());
+                break;
+            case ValueType::BOOLEAN:
+                PUTSTATIC(jboolean, (jboolean) (stack.popInt() & 1));
+                break;
+            case ValueType::BYTE:
+                PUTSTATIC(jbyte, (jbyte) stack.popInt());
+                break;
+            case ValueType::FLOAT:
+                PUTSTATIC(jfloat, stack.popFloat());
+                break;
+            case ValueType::DOUBLE:
+                PUTSTATIC(jdouble, stack.popDouble());
+                break;
+            case ValueType::LONG:
+                PUTSTATIC(jlong, stack.popLong());
+                break;
+            case ValueType::VOID:
+            default:
+                SHOULD_NOT_REACH_HERE();
+                break;
+        }
+    }
+
+    static InstanceKlass *resolveInstanceClass(JavaThread *thread, RuntimeConstantPool *rt, int constantIndex) {
         auto klass = rt->getClass(constantIndex);
         if (klass == nullptr) {
             PANIC("Cannot get class info from constant pool");
@@ -383,9 +462,61 @@ namespace kivm {
         if (!Execution::initializeClass(thread, instanceKlass)) {
             return nullptr;
         }
+        return instanceKlass;
+    }
+
+    instanceOop Execution::newInstance(JavaThread *thread, RuntimeConstantPool *rt, int constantIndex) {
+        auto instanceKlass = resolveInstanceClass(thread, rt, constantIndex);
+        if (instanceKlass == nullptr) {
+            return nullptr;
+        }
+        RecoverableAllocation recoverable(thread);
         return instanceKlass->newInstance();
     }
 
+    instanceOop Execution::newInstance(JavaThread *thread, Frame *frame, RuntimeConstantPool *rt,
+                                       int constantIndex, int bci) {
+        auto instanceKlass = resolveInstanceClass(thread, rt, constantIndex);
+        if (instanceKlass == nullptr) {
+            return nullptr;
+        }
+        return newInstance(thread, frame, instanceKlass, bci);
+    }
+
+    instanceOop Execution::newInstance(JavaThread *thread, Frame *frame,
+                                       InstanceKlass *instanceKlass, int bci) {
+        RecoverableAllocation recoverable(thread);
+        auto analysis = frame->getMethod()->getEscapeAnalysis();
+        if (!RuntimeConfig::get().doEscapeAnalysis || analysis == nullptr) {
+            return instanceKlass->newInstance();
+        }
+
+        int site = analysis->getFrameLocalSite(bci);
+        if (site < 0) {
+            return instanceKlass->newInstance();
+        }
+
+        // the previous object from a reusable site is dead by now
+        size_t size = instanceKlass->getInstanceHeaderSize() + instanceKlass->getInstanceFieldSize();
+        void *memory = nullptr;
+        if (analysis->isReusableSite(site)) {
+            memory = frame->getFrameLocalObject(site);
+            if (memory != nullptr) {
+                memset(memory, 0, alignUp(size, sizeof(jlong)));
+            } else {
+                memory = thread->getFrameArena().allocate(size);
+                frame->setFrameLocalObject(site, analysis->getFrameLocalSiteCount(), memory);
+            }
+        } else {
+            memory = thread->getFrameArena().allocate(size);
+        }
+
+        if (memory == nullptr) {
+            return instanceKlass->newInstance();
+        }
+        return ::new(memory) instanceOopDesc(instanceKlass);
+    }
+
     typeArrayOop Execution::newPrimitiveArray(JavaThread *thread, int arrayType, int length) {
         Klass *arrayClass = nullptr;
 
@@ -424,6 +555,7 @@ namespace kivm {
         }
 
         auto typeArrayClass = (TypeArrayKlass *) arrayClass;
+        RecoverableAllocation recoverable(thread);
         return typeArrayClass->newInstance(length);
     }
 
@@ -481,6 +613,7 @@ namespace kivm {
             PANIC("Cannot get component type of an object array");
         }
 
+        RecoverableAllocation recoverable(thread);
         return objectArrayKlass->newInstance(length);
     }
 
@@ -516,6 +649,7 @@ namespace kivm {
             PANIC("invalid dimension");
         }
 
+        RecoverableAllocation recoverable(thread);
         return newMultiObjectArrayHelper(arrayKlass, length, 0);
     }
 
@@ -541,7 +675,8 @@ namespace kivm {
         }
 
         if (array == nullptr) {
-            PANIC("Failed to allocate array");
+            // OutOfMemoryError thrown
+            return nullptr;
         }
 
         if (lengthIndex < length.size() - 1) {
@@ -550,6 +685,9 @@ namespace kivm {
             }
             for (int i = 0; i < array->getLength(); ++i) {
                 arrayOop elementArray = newMultiObjectArrayHelper(downDimensionType, length, lengthIndex + 1);
+                if (elementArray == nullptr) {
+                    return nullptr;
+                }
                 array->setElementAt(i, elementArray);
             }
 
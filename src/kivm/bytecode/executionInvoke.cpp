@@ -244,6 +244,25 @@ namespace kivm {
         return JavaCall::withStack(thread, method, &stack);
     }
 
+    oop Execution::invokeVirtual(JavaThread *thread, ResolvedEntry *entry, Stack &stack) {
+        Method *method = entry->_method;
+        jobject receiver = stack.peekReference(entry->_argumentSlots);
+
+        // a null receiver is thrown at by JavaCall,
+        // and arrays only have methods of java.lang.Object
+        if (receiver != nullptr) {
+            Klass *klass = ((oop) receiver)->getClass();
+            if (klass->getClassType() == ClassType::INSTANCE_CLASS) {
+                method = ((InstanceKlass *) klass)->getVirtualMethod(method->getVtableIndex());
+            }
+        }
+        return JavaCall::withResolvedStack(thread, method, &stack);
+    }
+
+    oop Execution::invokeDirect(JavaThread *thread, ResolvedEntry *entry, Stack &stack) {
+        return JavaCall::withResolvedStack(thread, entry->_method, &stack);
+    }
+
     oop Execution::invokeInterface(JavaThread *thread, RuntimeConstantPool *rt, Stack &stack,
                                    int constantIndex, int count) {
         // Do not use invokeVirtual()
@@ -15,6 +15,19 @@
 #include <kivm/bytecode/bytecodeInterpreter.h>
 
 namespace kivm {
+    /**
+     * Arguments are only read until they are copied into locals
+     * of the callee, their boxes are allocated in the frame arena.
+     */
+    template <typename T, typename V>
+    static inline oop boxArgument(FrameArena &arena, V value) {
+        void *memory = arena.allocate(sizeof(T));
+        if (memory == nullptr) {
+            return new T(value);
+        }
+        return ::new(memory) T(value);
+    }
+
     JavaCall::JavaCall(JavaThread *thread, Method *method, Stack *stack)
         : _thread(thread), _method(method), _stack(stack), _instanceKlass(_method->getClass()),
           _obtainArgsFromStack(true) {
@@ -33,9 +46,9 @@ namespace kivm {
         if (_method->isSynchronized()) {
             D("invocationContext: method is synchronized");
             if (_method->isStatic()) {
-                _method->getClass()->getJavaMirror()->getMarkOop()->monitorEnter();
+                _thread->monitorEnter(_method->getClass()->getJavaMirror());
             } else {
-                thisObject->getMarkOop()->monitorEnter();
+                _thread->monitorEnter(thisObject);
             }
         }
     }
@@ -43,9 +56,9 @@ namespace kivm {
     void JavaCall::finishSynchronized(oop thisObject) {
         if (_method->isSynchronized()) {
             if (_method->isStatic()) {
-                _method->getClass()->getJavaMirror()->getMarkOop()->monitorExit();
+                _thread->monitorExit(_method->getClass()->getJavaMirror());
             } else {
-                thisObject->getMarkOop()->monitorExit();
+                _thread->monitorExit(thisObject);
             }
         }
     }
@@ -121,10 +134,14 @@ namespace kivm {
         });
 
         _thread->_pc = 0;
+        auto arenaMark = _thread->getFrameArena().mark();
         oop result = DefaultInterpreter::interp(_thread);
         _thread->_frames.pop();
         _thread->_pc = frame.getReturnPc();
 
+        // objects allocated by the frame never escape it
+        _thread->getFrameArena().release(arenaMark);
+
         if (_thread->_frames.getSize() > 0) {
             auto returnTo = _thread->_frames.getCurrentFrame()->getMethod();
             D("returned from %S.%S:%S to %S.%S:%S",
@@ -165,21 +182,22 @@ namespace kivm {
 
     bool JavaCall::fillArguments(const std::vector<ValueType> &argTypes, bool hasThis) {
         std::list<oop> callingArgs;
+        FrameArena &arena = _thread->getFrameArena();
         for (auto it = argTypes.rbegin(); it != argTypes.rend(); ++it) {
             ValueType valueType = *it;
 
             switch (valueType) {
                 case ValueType::INT:
-                    callingArgs.push_front(new intOopDesc(_stack->popInt()));
+                    callingArgs.push_front(boxArgument<intOopDesc>(arena, _stack->popInt()));
                     break;
                 case ValueType::LONG:
-                    callingArgs.push_front(new longOopDesc(_stack->popLong()));
+                    callingArgs.push_front(boxArgument<longOopDesc>(arena, _stack->popLong()));
                     break;
                 case ValueType::FLOAT:
-                    callingArgs.push_front(new floatOopDesc(_stack->popFloat()));
+                    callingArgs.push_front(boxArgument<floatOopDesc>(arena, _stack->popFloat()));
                     break;
                 case ValueType::DOUBLE:
-                    callingArgs.push_front(new doubleOopDesc(_stack->popDouble()));
+                    callingArgs.push_front(boxArgument<doubleOopDesc>(arena, _stack->popDouble()));
                     break;
                 case ValueType::OBJECT:
                 case ValueType::ARRAY:
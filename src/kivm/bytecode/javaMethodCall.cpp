@@ -19,6 +19,8 @@ namespace kivm {
             _method->isNative() ? "true" : "false",
             descriptorMap.size());
 
+        // boxed arguments are freed when the call returns
+        auto arenaMark = _thread->getFrameArena().mark();
         if (_obtainArgsFromStack && _stack != nullptr) {
             if (!fillArguments(descriptorMap, hasThis)) {
                 SHOULD_NOT_REACH_HERE_M("Unknown value type");
@@ -29,6 +31,7 @@ namespace kivm {
         if (hasThis) {
             thisObject = *_args.begin();
             if (thisObject == nullptr) {
+                _thread->getFrameArena().release(arenaMark);
                 _thread->throwException(Global::_NullPointerException, false);
                 return nullptr;
             }
@@ -45,20 +48,22 @@ namespace kivm {
         prepareSynchronized(thisObject);
 
         oop result = callInterpreter();
+        bool returned = !_thread->isExceptionOccurred();
+        const jvalue &value = _thread->_returnValue;
 
-        if (_stack != nullptr && !_thread->isExceptionOccurred()) {
+        if (_stack != nullptr && returned) {
             switch (_method->getReturnType()) {
                 case ValueType::INT:
-                    _stack->pushInt(((intOop) result)->getValue());
+                    _stack->pushInt(value.i);
                     break;
                 case ValueType::LONG:
-                    _stack->pushLong(((longOop) result)->getValue());
+                    _stack->pushLong(value.j);
                     break;
                 case ValueType::FLOAT:
-                    _stack->pushFloat(((floatOop) result)->getValue());
+                    _stack->pushFloat(value.f);
                     break;
                 case ValueType::DOUBLE:
-                    _stack->pushDouble(((doubleOop) result)->getValue());
+                    _stack->pushDouble(value.d);
                     break;
                 case ValueType::OBJECT:
                 case ValueType::ARRAY:
@@ -72,6 +77,23 @@ namespace kivm {
             }
         }
         finishSynchronized(thisObject);
+        _thread->getFrameArena().release(arenaMark);
+
+        // only callers outside the interpreter need a box
+        if (_stack == nullptr && returned) {
+            switch (_method->getReturnType()) {
+                case ValueType::INT:
+                    return new intOopDesc(value.i);
+                case ValueType::LONG:
+                    return new longOopDesc(value.j);
+                case ValueType::FLOAT:
+                    return new floatOopDesc(value.f);
+                case ValueType::DOUBLE:
+                    return new doubleOopDesc(value.d);
+                default:
+                    break;
+            }
+        }
         return result;
     }
 }
@@ -25,8 +25,9 @@
             resultOop = exp; \
         }
 
-#define CALL(type, pushFunc, resultOopType) \
-        CALL_FACTORY(type, pushFunc, new resultOopType(r))
+// primitive results only go to the interpreter stack, they need no box
+#define CALL(type, pushFunc) \
+        CALL_FACTORY(type, pushFunc, nullptr)
 
 namespace kivm {
     static ffi_type *valueTypeToFFIType(ValueType valueType) {
@@ -298,35 +299,35 @@ namespace kivm {
                 break;
             }
             case ValueType::BOOLEAN: {
-                CALL(jint, pushInt, intOopDesc);
+                CALL(jint, pushInt);
                 break;
             }
             case ValueType::BYTE: {
-                CALL(jint, pushInt, intOopDesc);
+                CALL(jint, pushInt);
                 break;
             }
             case ValueType::CHAR: {
-                CALL(jint, pushInt, intOopDesc);
+                CALL(jint, pushInt);
                 break;
             }
             case ValueType::SHORT: {
-                CALL(jint, pushInt, intOopDesc);
+                CALL(jint, pushInt);
                 break;
             }
             case ValueType::INT: {
-                CALL(jint, pushInt, intOopDesc);
+                CALL(jint, pushInt);
                 break;
             }
             case ValueType::FLOAT: {
-                CALL(jfloat, pushFloat, floatOopDesc);
+                CALL(jfloat, pushFloat);
                 break;
             }
             case ValueType::LONG: {
-                CALL(jlong, pushLong, longOopDesc);
+                CALL(jlong, pushLong);
                 break;
             }
             case ValueType::DOUBLE: {
-                CALL(jdouble, pushDouble, doubleOopDesc);
+                CALL(jdouble, pushDouble);
                 break;
             }
             case ValueType::OBJECT:
@@ -0,0 +1,1065 @@
+//
+// Per-method maps of frame slots holding references
+//
+
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/codeBlob.h>
+#include <kivm/classfile/attributeInfo.h>
+#include <kivm/classfile/constantPool.h>
+#include <kivm/oop/method.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/runtime/constantPool.h>
+#include <algorithm>
+#include <deque>
+
+// Only two kinds of slots matter to the GC: references and everything else.
+// Where the verifier would see conflicting types at a merge point,
+// the slot becomes top, and bytecode can no longer use it as a reference
+// before storing into it again, so it is treated as a plain value.
+
+namespace kivm {
+    using SlotTypes = std::vector<u1>;
+
+    static inline int readU2(const CodeBlob &code, int offset) {
+        return code[offset] << 8 | code[offset + 1];
+    }
+
+    static inline int readS2(const CodeBlob &code, int offset) {
+        return (short) readU2(code, offset);
+    }
+
+    static inline int readS4(const CodeBlob &code, int offset) {
+        return (int) ((u4) code[offset] << 24
+                      | (u4) code[offset + 1] << 16
+                      | (u4) code[offset + 2] << 8
+                      | (u4) code[offset + 3]);
+    }
+
+    /**
+     * Operands of tableswitch and lookupswitch start at a multiple of 4.
+     */
+    static inline int getSwitchBase(int bci) {
+        return (bci + 4) & ~3;
+    }
+
+    static inline void push(SlotTypes &stack, u1 type, int count = 1) {
+        stack.insert(stack.end(), (size_t) count, type);
+    }
+
+    static inline void pop(SlotTypes &stack, int count) {
+        assert(stack.size() >= (size_t) count);
+        stack.resize(stack.size() >= (size_t) count ? stack.size() - count : 0);
+    }
+
+    static inline void setLocal(SlotTypes &locals, int index, u1 type) {
+        if (index >= 0 && index < (int) locals.size()) {
+            locals[index] = type;
+        }
+    }
+
+    /**
+     * Copy the top {@code count} slots, and insert them
+     * {@code depth} slots below the top. Covers the whole dup family.
+     */
+    static void dup(SlotTypes &stack, int count, int depth) {
+        assert(stack.size() >= (size_t) depth);
+        SlotTypes copied(stack.end() - count, stack.end());
+        stack.insert(stack.end() - depth, copied.begin(), copied.end());
+    }
+
+    static u1 getVerificationTag(u1 descriptorChar) {
+        switch (descriptorChar) {
+            case 'J':
+                return ITEM_Long;
+            case 'D':
+                return ITEM_Double;
+            case 'F':
+                return ITEM_Float;
+            case 'L':
+            case '[':
+                return ITEM_Object;
+            default:
+                return ITEM_Integer;
+        }
+    }
+
+    /**
+     * @return offset of the next field type in a descriptor
+     */
+    static int skipFieldType(const u1 *bytes, int offset) {
+        while (bytes[offset] == '[') {
+            ++offset;
+        }
+        if (bytes[offset] == 'L') {
+            while (bytes[offset] != ';') {
+                ++offset;
+            }
+        }
+        return offset + 1;
+    }
+
+    /**
+     * Verification tags of arguments in a method descriptor.
+     * @return offset of the return type
+     */
+    static int parseArgumentTags(const CONSTANT_Utf8_info *descriptor, std::vector<u1> &tags) {
+        const u1 *bytes = descriptor->bytes;
+        int offset = 1;
+        while (bytes[offset] != ')') {
+            tags.push_back(getVerificationTag(bytes[offset]));
+            offset = skipFieldType(bytes, offset);
+        }
+        return offset + 1;
+    }
+
+    static void appendSlots(u1 verificationTag, SlotTypes &slots) {
+        switch (verificationTag) {
+            case ITEM_Long:
+            case ITEM_Double:
+                push(slots, OopMap::SLOT_VALUE, 2);
+                break;
+            case ITEM_Null:
+            case ITEM_UninitializedThis:
+            case ITEM_Object:
+            case ITEM_Uninitialized:
+                push(slots, OopMap::SLOT_OOP);
+                break;
+            default:
+                push(slots, OopMap::SLOT_VALUE);
+                break;
+        }
+    }
+
+    /**
+     * Push a value of the type starting at {@code bytes[offset]}, if not void.
+     */
+    static void pushDescriptorType(SlotTypes &stack, const u1 *bytes, int offset) {
+        if (bytes[offset] != 'V') {
+            appendSlots(getVerificationTag(bytes[offset]), stack);
+        }
+    }
+
+    static int getSlotCount(u1 descriptorChar) {
+        return descriptorChar == 'J' || descriptorChar == 'D' ? 2 : 1;
+    }
+
+    /**
+     * Descriptor of a field, a method or an invokedynamic call site,
+     * read from the raw constant pool. Nothing is resolved or loaded,
+     * since this runs on GC threads.
+     */
+    static const CONSTANT_Utf8_info *getMemberDescriptor(cp_info **pool, int index) {
+        int nameAndTypeIndex = 0;
+        switch (pool[index]->tag) {
+            case CONSTANT_Fieldref:
+                nameAndTypeIndex = ((CONSTANT_Fieldref_info *) pool[index])->name_and_type_index;
+                break;
+            case CONSTANT_Methodref:
+                nameAndTypeIndex = ((CONSTANT_Methodref_info *) pool[index])->name_and_type_index;
+                break;
+            case CONSTANT_InterfaceMethodref:
+                nameAndTypeIndex = ((CONSTANT_InterfaceMethodref_info *) pool[index])->name_and_type_index;
+                break;
+            case CONSTANT_InvokeDynamic:
+                nameAndTypeIndex = ((CONSTANT_InvokeDynamic_info *) pool[index])->name_and_type_index;
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE_M("not a member reference: %d", index);
+        }
+        auto nameAndType = requireConstant<CONSTANT_NameAndType_info>(pool, nameAndTypeIndex);
+        return requireConstant<CONSTANT_Utf8_info>(pool, nameAndType->descriptor_index);
+    }
+
+    static void doInvoke(OopMap::TypeState &state, cp_info **pool, int index, bool hasReceiver) {
+        auto descriptor = getMemberDescriptor(pool, index);
+        std::vector<u1> argumentTags;
+        int returnOffset = parseArgumentTags(descriptor, argumentTags);
+
+        SlotTypes argumentSlots;
+        for (u1 tag : argumentTags) {
+            appendSlots(tag, argumentSlots);
+        }
+        pop(state._stack, (int) argumentSlots.size() + (hasReceiver ? 1 : 0));
+        pushDescriptorType(state._stack, descriptor->bytes, returnOffset);
+    }
+
+    /**
+     * @param opcode one of iload, lload, fload, dload and aload
+     */
+    static void doLoad(OopMap::TypeState &state, int opcode) {
+        switch (opcode) {
+            case OPC_LLOAD:
+            case OPC_DLOAD:
+                push(state._stack, OopMap::SLOT_VALUE, 2);
+                break;
+            case OPC_ALOAD:
+                push(state._stack, OopMap::SLOT_OOP);
+                break;
+            default:
+                push(state._stack, OopMap::SLOT_VALUE);
+                break;
+        }
+    }
+
+    /**
+     * @param opcode one of istore, lstore, fstore, dstore and astore
+     */
+    static void doStore(OopMap::TypeState &state, int opcode, int index) {
+        switch (opcode) {
+            case OPC_LSTORE:
+            case OPC_DSTORE:
+                pop(state._stack, 2);
+                setLocal(state._locals, index, OopMap::SLOT_VALUE);
+                setLocal(state._locals, index + 1, OopMap::SLOT_VALUE);
+                break;
+            case OPC_ASTORE: {
+                // may also be a return address pushed by jsr
+                u1 type = state._stack.empty() ? OopMap::SLOT_VALUE : state._stack.back();
+                pop(state._stack, 1);
+                setLocal(state._locals, index, type);
+                break;
+            }
+            default:
+                pop(state._stack, 1);
+                setLocal(state._locals, index, OopMap::SLOT_VALUE);
+                break;
+        }
+    }
+
+    /**
+     * Call {@code visitor} with every branch target of the instruction at {@code bci}.
+     */
+    template <typename Visitor>
+    static void forEachBranchTarget(const CodeBlob &code, int bci, Visitor &&visitor) {
+        int opcode = code[bci];
+        switch (opcode) {
+            case OPC_IFEQ:
+            case OPC_IFNE:
+            case OPC_IFLT:
+            case OPC_IFGE:
+            case OPC_IFGT:
+            case OPC_IFLE:
+            case OPC_IF_ICMPEQ:
+            case OPC_IF_ICMPNE:
+            case OPC_IF_ICMPLT:
+            case OPC_IF_ICMPGE:
+            case OPC_IF_ICMPGT:
+            case OPC_IF_ICMPLE:
+            case OPC_IF_ACMPEQ:
+            case OPC_IF_ACMPNE:
+            case OPC_GOTO:
+            case OPC_JSR:
+            case OPC_IFNULL:
+            case OPC_IFNONNULL:
+                visitor(bci + readS2(code, bci + 1));
+                break;
+
+            case OPC_GOTO_W:
+            case OPC_JSR_W:
+                visitor(bci + readS4(code, bci + 1));
+                break;
+
+            case OPC_TABLESWITCH: {
+                int base = getSwitchBase(bci);
+                visitor(bci + readS4(code, base));
+                int low = readS4(code, base + 4);
+                int high = readS4(code, base + 8);
+                for (int i = 0; i <= high - low; ++i) {
+                    visitor(bci + readS4(code, base + 12 + i * 4));
+                }
+                break;
+            }
+
+            case OPC_LOOKUPSWITCH: {
+                int base = getSwitchBase(bci);
+                visitor(bci + readS4(code, base));
+                int pairs = readS4(code, base + 4);
+                for (int i = 0; i < pairs; ++i) {
+                    visitor(bci + readS4(code, base + 8 + i * 8 + 4));
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    /**
+     * Whether execution may continue with the next instruction.
+     * jsr is treated as a jump, since subroutines are not supported
+     * by the interpreter.
+     */
+    static bool canFallThrough(const CodeBlob &code, int bci) {
+        switch (code[bci]) {
+            case OPC_GOTO:
+            case OPC_GOTO_W:
+            case OPC_JSR:
+            case OPC_JSR_W:
+            case OPC_RET:
+            case OPC_TABLESWITCH:
+            case OPC_LOOKUPSWITCH:
+            case OPC_IRETURN:
+            case OPC_LRETURN:
+            case OPC_FRETURN:
+            case OPC_DRETURN:
+            case OPC_ARETURN:
+            case OPC_RETURN:
+            case OPC_ATHROW:
+                return false;
+            case OPC_WIDE:
+                return code[bci + 1] != OPC_RET;
+            default:
+                return true;
+        }
+    }
+
+    /**
+     * Merge {@code from} into {@code to}.
+     * @return whether {@code to} changed
+     */
+    static bool mergeSlots(SlotTypes &to, const SlotTypes &from) {
+        bool changed = false;
+        if (to.size() > from.size()) {
+            to.resize(from.size());
+            changed = true;
+        }
+        for (size_t i = 0; i < to.size(); ++i) {
+            if (to[i] == OopMap::SLOT_OOP && from[i] != OopMap::SLOT_OOP) {
+                to[i] = OopMap::SLOT_VALUE;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    int OopMap::getInstructionLength(const CodeBlob &code, int bci) {
+        int opcode = code[bci];
+        switch (opcode) {
+            case OPC_BIPUSH:
+            case OPC_LDC:
+            case OPC_ILOAD:
+            case OPC_LLOAD:
+            case OPC_FLOAD:
+            case OPC_DLOAD:
+            case OPC_ALOAD:
+            case OPC_ISTORE:
+            case OPC_LSTORE:
+            case OPC_FSTORE:
+            case OPC_DSTORE:
+            case OPC_ASTORE:
+            case OPC_RET:
+            case OPC_NEWARRAY:
+                return 2;
+
+            case OPC_SIPUSH:
+            case OPC_LDC_W:
+            case OPC_LDC2_W:
+            case OPC_IINC:
+            case OPC_IFEQ:
+            case OPC_IFNE:
+            case OPC_IFLT:
+            case OPC_IFGE:
+            case OPC_IFGT:
+            case OPC_IFLE:
+            case OPC_IF_ICMPEQ:
+            case OPC_IF_ICMPNE:
+            case OPC_IF_ICMPLT:
+            case OPC_IF_ICMPGE:
+            case OPC_IF_ICMPGT:
+            case OPC_IF_ICMPLE:
+            case OPC_IF_ACMPEQ:
+            case OPC_IF_ACMPNE:
+            case OPC_GOTO:
+            case OPC_JSR:
+            case OPC_GETSTATIC:
+            case OPC_PUTSTATIC:
+            case OPC_GETFIELD:
+            case OPC_PUTFIELD:
+            case OPC_INVOKEVIRTUAL:
+            case OPC_INVOKESPECIAL:
+            case OPC_INVOKESTATIC:
+            case OPC_NEW:
+            case OPC_ANEWARRAY:
+            case OPC_CHECKCAST:
+            case OPC_INSTANCEOF:
+            case OPC_IFNULL:
+            case OPC_IFNONNULL:
+                return 3;
+
+            case OPC_MULTIANEWARRAY:
+                return 4;
+
+            case OPC_INVOKEINTERFACE:
+            case OPC_INVOKEDYNAMIC:
+            case OPC_GOTO_W:
+            case OPC_JSR_W:
+                return 5;
+
+            case OPC_WIDE:
+                return code[bci + 1] == OPC_IINC ? 6 : 4;
+
+            case OPC_TABLESWITCH: {
+                int base = getSwitchBase(bci);
+                int low = readS4(code, base + 4);
+                int high = readS4(code, base + 8);
+                return base + 12 + (high - low + 1) * 4 - bci;
+            }
+
+            case OPC_LOOKUPSWITCH: {
+                int base = getSwitchBase(bci);
+                int pairs = readS4(code, base + 4);
+                return base + 8 + pairs * 8 - bci;
+            }
+
+            default:
+                return 1;
+        }
+    }
+
+    OopMap::OopMap(Method *method, StackMapTable_attribute *stackMapTable)
+        : _method(method), _stackMapTable(stackMapTable) {
+    }
+
+    OopMap::~OopMap() {
+        for (auto &item : _entries) {
+            delete item.second;
+        }
+    }
+
+    const OopMapEntry *OopMap::lookup(u4 pc) {
+        LockGuard lockGuard(_lock);
+        if (!_analyzed) {
+            analyze();
+            _analyzed = true;
+        }
+
+        int bci = getBci(pc);
+        auto iter = _entries.find(bci);
+        if (iter != _entries.end()) {
+            return iter->second;
+        }
+
+        auto entry = computeEntry(bci);
+        _entries[bci] = entry;
+        return entry;
+    }
+
+    int OopMap::getBci(u4 pc) {
+        if (pc == 0) {
+            return 0;
+        }
+
+        int bci = std::min((int) pc - 1, (int) _instructionStarts.size() - 1);
+        while (bci > 0 && !_instructionStarts[bci]) {
+            --bci;
+        }
+        return bci;
+    }
+
+    void OopMap::analyze() {
+        const CodeBlob &code = _method->getCodeBlob();
+        int codeLength = _method->_codeAttr->code_length;
+
+        _instructionStarts.assign((size_t) codeLength, false);
+        for (int bci = 0; bci < codeLength; bci += getInstructionLength(code, bci)) {
+            _instructionStarts[bci] = true;
+        }
+
+        _checkpoints[0] = getEntryState();
+        if (_stackMapTable != nullptr) {
+            loadStackMapTable();
+        } else {
+            inferCheckpoints();
+        }
+
+        D("OopMap: %S.%S:%S analyzed, checkpoints: %zd",
+            _method->getClass()->getName().c_str(),
+            _method->getName().c_str(),
+            _method->getDescriptor().c_str(),
+            _checkpoints.size());
+    }
+
+    std::vector<u1> OopMap::getEntryLocalTags() {
+        std::vector<u1> tags;
+        if (!_method->isStatic()) {
+            tags.push_back(_method->getName() == L"<init>" ? ITEM_UninitializedThis : ITEM_Object);
+        }
+
+        auto pool = _method->getClass()->getRuntimeConstantPool()->getRawPool();
+        auto descriptor = requireConstant<CONSTANT_Utf8_info>(pool, _method->_methodInfo->descriptor_index);
+        parseArgumentTags(descriptor, tags);
+        return tags;
+    }
+
+    OopMap::TypeState OopMap::expandTags(const std::vector<u1> &localTags,
+                                         const std::vector<u1> &stackTags) {
+        TypeState state;
+        for (u1 tag : localTags) {
+            appendSlots(tag, state._locals);
+        }
+        state._locals.resize((size_t) _method->getMaxLocals(), SLOT_VALUE);
+
+        for (u1 tag : stackTags) {
+            appendSlots(tag, state._stack);
+        }
+        return state;
+    }
+
+    OopMap::TypeState OopMap::getEntryState() {
+        return expandTags(getEntryLocalTags(), {});
+    }
+
+    void OopMap::loadStackMapTable() {
+        using Table = StackMapTable_attribute;
+
+        std::vector<u1> localTags = getEntryLocalTags();
+        int bci = -1;
+
+        for (int i = 0; i < _stackMapTable->number_of_entries; ++i) {
+            auto frame = _stackMapTable->entries[i];
+            int frameType = frame->frame_type;
+            int offsetDelta = 0;
+            std::vector<u1> stackTags;
+
+            if (frameType <= 63) {
+                // same_frame
+                offsetDelta = frameType;
+
+            } else if (frameType <= 127) {
+                auto f = (Table::same_locals_1_stack_item_frame *) frame;
+                offsetDelta = frameType - 64;
+                stackTags.push_back(f->stack[0]->tag);
+
+            } else if (frameType == 247) {
+                auto f = (Table::same_locals_1_stack_item_frame_extended *) frame;
+                offsetDelta = f->offset_delta;
+                stackTags.push_back(f->stack[0]->tag);
+
+            } else if (frameType >= 248 && frameType <= 250) {
+                auto f = (Table::chop_frame *) frame;
+                offsetDelta = f->offset_delta;
+                size_t chopped = std::min((size_t) (251 - frameType), localTags.size());
+                localTags.resize(localTags.size() - chopped);
+
+            } else if (frameType == 251) {
+                auto f = (Table::same_frame_extended *) frame;
+                offsetDelta = f->offset_delta;
+
+            } else if (frameType >= 252 && frameType <= 254) {
+                auto f = (Table::append_frame *) frame;
+                offsetDelta = f->offset_delta;
+                for (int j = 0; j < frameType - 251; ++j) {
+                    localTags.push_back(f->locals[j]->tag);
+                }
+
+            } else if (frameType == 255) {
+                auto f = (Table::full_frame *) frame;
+                offsetDelta = f->offset_delta;
+                localTags.clear();
+                for (int j = 0; j < f->number_of_locals; ++j) {
+                    localTags.push_back(f->locals[j]->tag);
+                }
+                for (int j = 0; j < f->number_of_stack_items; ++j) {
+                    stackTags.push_back(f->stack[j]->tag);
+                }
+
+            } else {
+                PANIC("OopMap: reserved stack map frame type: %d", frameType);
+            }
+
+            bci = bci < 0 ? offsetDelta : bci + offsetDelta + 1;
+            _checkpoints[bci] = expandTags(localTags, stackTags);
+        }
+    }
+
+    void OopMap::inferCheckpoints() {
+        const CodeBlob &code = _method->getCodeBlob();
+        auto codeAttr = _method->_codeAttr;
+        int codeLength = codeAttr->code_length;
+
+        // basic blocks start at branch targets, exception handlers,
+        // and instructions following a branch
+        std::vector<bool> blockStarts((size_t) codeLength, false);
+        for (int bci = 0; bci < codeLength; bci += getInstructionLength(code, bci)) {
+            bool branches = false;
+            forEachBranchTarget(code, bci, [&](int target) {
+                if (target >= 0 && target < codeLength) {
+                    blockStarts[target] = true;
+                }
+                branches = true;
+            });
+
+            int next = bci + getInstructionLength(code, bci);
+            if ((branches || !canFallThrough(code, bci)) && next < codeLength) {
+                blockStarts[next] = true;
+            }
+        }
+        for (int i = 0; i < codeAttr->exception_table_length; ++i) {
+            blockStarts[codeAttr->exception_table[i].handler_pc] = true;
+        }
+
+        std::deque<int> worklist;
+        worklist.push_back(0);
+
+        auto mergeInto = [&](int target, const TypeState &state) {
+            auto iter = _checkpoints.find(target);
+            if (iter == _checkpoints.end()) {
+                _checkpoints[target] = state;
+                worklist.push_back(target);
+                return;
+            }
+
+            bool changed = mergeSlots(iter->second._locals, state._locals);
+            changed = mergeSlots(iter->second._stack, state._stack) || changed;
+            if (changed) {
+                worklist.push_back(target);
+            }
+        };
+
+        // handlers may be entered before or after any instruction in range
+        auto mergeIntoHandlers = [&](int bci, const TypeState &state) {
+            for (int i = 0; i < codeAttr->exception_table_length; ++i) {
+                const auto &entry = codeAttr->exception_table[i];
+                if (bci >= entry.start_pc && bci < entry.end_pc) {
+                    TypeState handlerState;
+                    handlerState._locals = state._locals;
+                    handlerState._stack.push_back(SLOT_OOP);
+                    mergeInto(entry.handler_pc, handlerState);
+                }
+            }
+        };
+
+        while (!worklist.empty()) {
+            int bci = worklist.front();
+            worklist.pop_front();
+            TypeState state = _checkpoints[bci];
+
+            while (true) {
+                TypeState next = state;
+                interpret(bci, next);
+                mergeIntoHandlers(bci, state);
+                mergeIntoHandlers(bci, next);
+
+                forEachBranchTarget(code, bci, [&](int target) {
+                    mergeInto(target, next);
+                });
+
+                if (!canFallThrough(code, bci)) {
+                    break;
+                }
+
+                bci += getInstructionLength(code, bci);
+                if (bci >= codeLength) {
+                    break;
+                }
+                if (blockStarts[bci]) {
+                    mergeInto(bci, next);
+                    break;
+                }
+                state = std::move(next);
+            }
+        }
+    }
+
+    OopMapEntry *OopMap::computeEntry(int bci) {
+        const CodeBlob &code = _method->getCodeBlob();
+
+        // the state at a checkpoint is known, instructions between
+        // two checkpoints never branch into each other
+        auto checkpoint = _checkpoints.upper_bound(bci);
+        assert(checkpoint != _checkpoints.begin());
+        --checkpoint;
+
+        TypeState state = checkpoint->second;
+        for (int current = checkpoint->first; current < bci;
+             current += getInstructionLength(code, current)) {
+            interpret(current, state);
+        }
+
+        int maxLocals = _method->getMaxLocals();
+        auto entry = new OopMapEntry(maxLocals);
+        entry->_oopSlots.resize(maxLocals + state._stack.size(), false);
+        for (int i = 0; i < maxLocals; ++i) {
+            entry->_oopSlots[i] = state._locals[i] == SLOT_OOP;
+        }
+        for (size_t i = 0; i < state._stack.size(); ++i) {
+            entry->_oopSlots[maxLocals + i] = state._stack[i] == SLOT_OOP;
+        }
+        return entry;
+    }
+
+    void OopMap::interpret(int bci, TypeState &state) {
+        const CodeBlob &code = _method->getCodeBlob();
+        cp_info **pool = _method->getClass()->getRuntimeConstantPool()->getRawPool();
+        SlotTypes &stack = state._stack;
+
+        int opcode = code[bci];
+        switch (opcode) {
+            case OPC_NOP:
+            case OPC_INEG:
+            case OPC_LNEG:
+            case OPC_FNEG:
+            case OPC_DNEG:
+            case OPC_IINC:
+            case OPC_I2F:
+            case OPC_L2D:
+            case OPC_F2I:
+            case OPC_D2L:
+            case OPC_I2B:
+            case OPC_I2C:
+            case OPC_I2S:
+            case OPC_GOTO:
+            case OPC_GOTO_W:
+            case OPC_RET:
+            case OPC_CHECKCAST:
+                break;
+
+            case OPC_ACONST_NULL:
+            case OPC_NEW:
+                push(stack, SLOT_OOP);
+                break;
+
+            case OPC_ICONST_M1:
+            case OPC_ICONST_0:
+            case OPC_ICONST_1:
+            case OPC_ICONST_2:
+            case OPC_ICONST_3:
+            case OPC_ICONST_4:
+            case OPC_ICONST_5:
+            case OPC_FCONST_0:
+            case OPC_FCONST_1:
+            case OPC_FCONST_2:
+            case OPC_BIPUSH:
+            case OPC_SIPUSH:
+            case OPC_JSR:
+            case OPC_JSR_W:
+                push(stack, SLOT_VALUE);
+                break;
+
+            case OPC_LCONST_0:
+            case OPC_LCONST_1:
+            case OPC_DCONST_0:
+            case OPC_DCONST_1:
+            case OPC_LDC2_W:
+                push(stack, SLOT_VALUE, 2);
+                break;
+
+            case OPC_LDC:
+            case OPC_LDC_W: {
+                int index = opcode == OPC_LDC ? code[bci + 1] : readU2(code, bci + 1);
+                int tag = pool[index]->tag;
+                push(stack, tag == CONSTANT_Integer || tag == CONSTANT_Float ? SLOT_VALUE : SLOT_OOP);
+                break;
+            }
+
+            case OPC_ILOAD:
+            case OPC_LLOAD:
+            case OPC_FLOAD:
+            case OPC_DLOAD:
+            case OPC_ALOAD:
+                doLoad(state, opcode);
+                break;
+
+            case OPC_ILOAD_0:
+            case OPC_ILOAD_1:
+            case OPC_ILOAD_2:
+            case OPC_ILOAD_3:
+            case OPC_LLOAD_0:
+            case OPC_LLOAD_1:
+            case OPC_LLOAD_2:
+            case OPC_LLOAD_3:
+            case OPC_FLOAD_0:
+            case OPC_FLOAD_1:
+            case OPC_FLOAD_2:
+            case OPC_FLOAD_3:
+            case OPC_DLOAD_0:
+            case OPC_DLOAD_1:
+            case OPC_DLOAD_2:
+            case OPC_DLOAD_3:
+            case OPC_ALOAD_0:
+            case OPC_ALOAD_1:
+            case OPC_ALOAD_2:
+            case OPC_ALOAD_3:
+                doLoad(state, OPC_ILOAD + (opcode - OPC_ILOAD_0) / 4);
+                break;
+
+            case OPC_IALOAD:
+            case OPC_FALOAD:
+            case OPC_BALOAD:
+            case OPC_CALOAD:
+            case OPC_SALOAD:
+                pop(stack, 2);
+                push(stack, SLOT_VALUE);
+                break;
+
+            case OPC_LALOAD:
+            case OPC_DALOAD:
+                pop(stack, 2);
+                push(stack, SLOT_VALUE, 2);
+                break;
+
+            case OPC_AALOAD:
+                pop(stack, 2);
+                push(stack, SLOT_OOP);
+                break;
+
+            case OPC_ISTORE:
+            case OPC_LSTORE:
+            case OPC_FSTORE:
+            case OPC_DSTORE:
+            case OPC_ASTORE:
+                doStore(state, opcode, code[bci + 1]);
+                break;
+
+            case OPC_ISTORE_0:
+            case OPC_ISTORE_1:
+            case OPC_ISTORE_2:
+            case OPC_ISTORE_3:
+            case OPC_LSTORE_0:
+            case OPC_LSTORE_1:
+            case OPC_LSTORE_2:
+            case OPC_LSTORE_3:
+            case OPC_FSTORE_0:
+            case OPC_FSTORE_1:
+            case OPC_FSTORE_2:
+            case OPC_FSTORE_3:
+            case OPC_DSTORE_0:
+            case OPC_DSTORE_1:
+            case OPC_DSTORE_2:
+            case OPC_DSTORE_3:
+            case OPC_ASTORE_0:
+            case OPC_ASTORE_1:
+            case OPC_ASTORE_2:
+            case OPC_ASTORE_3:
+                doStore(state, OPC_ISTORE + (opcode - OPC_ISTORE_0) / 4, (opcode - OPC_ISTORE_0) % 4);
+                break;
+
+            case OPC_IASTORE:
+            case OPC_FASTORE:
+            case OPC_AASTORE:
+            case OPC_BASTORE:
+            case OPC_CASTORE:
+            case OPC_SASTORE:
+                pop(stack, 3);
+                break;
+
+            case OPC_LASTORE:
+            case OPC_DASTORE:
+                pop(stack, 4);
+                break;
+
+            case OPC_POP:
+            case OPC_IFEQ:
+            case OPC_IFNE:
+            case OPC_IFLT:
+            case OPC_IFGE:
+            case OPC_IFGT:
+            case OPC_IFLE:
+            case OPC_IFNULL:
+            case OPC_IFNONNULL:
+            case OPC_TABLESWITCH:
+            case OPC_LOOKUPSWITCH:
+            case OPC_MONITORENTER:
+            case OPC_MONITOREXIT:
+                pop(stack, 1);
+                break;
+
+            case OPC_POP2:
+            case OPC_IF_ICMPEQ:
+            case OPC_IF_ICMPNE:
+            case OPC_IF_ICMPLT:
+            case OPC_IF_ICMPGE:
+            case OPC_IF_ICMPGT:
+            case OPC_IF_ICMPLE:
+            case OPC_IF_ACMPEQ:
+            case OPC_IF_ACMPNE:
+                pop(stack, 2);
+                break;
+
+            case OPC_DUP:
+                dup(stack, 1, 1);
+                break;
+            case OPC_DUP_X1:
+                dup(stack, 1, 2);
+                break;
+            case OPC_DUP_X2:
+                dup(stack, 1, 3);
+                break;
+            case OPC_DUP2:
+                dup(stack, 2, 2);
+                break;
+            case OPC_DUP2_X1:
+                dup(stack, 2, 3);
+                break;
+            case OPC_DUP2_X2:
+                dup(stack, 2, 4);
+                break;
+            case OPC_SWAP:
+                assert(stack.size() >= 2);
+                std::swap(stack[stack.size() - 1], stack[stack.size() - 2]);
+                break;
+
+            case OPC_IADD:
+            case OPC_FADD:
+            case OPC_ISUB:
+            case OPC_FSUB:
+            case OPC_IMUL:
+            case OPC_FMUL:
+            case OPC_IDIV:
+            case OPC_FDIV:
+            case OPC_IREM:
+            case OPC_FREM:
+            case OPC_ISHL:
+            case OPC_ISHR:
+            case OPC_IUSHR:
+            case OPC_IAND:
+            case OPC_IOR:
+            case OPC_IXOR:
+            case OPC_FCMPL:
+            case OPC_FCMPG:
+                pop(stack, 2);
+                push(stack, SLOT_VALUE);
+                break;
+
+            case OPC_LADD:
+            case OPC_DADD:
+            case OPC_LSUB:
+            case OPC_DSUB:
+            case OPC_LMUL:
+            case OPC_DMUL:
+            case OPC_LDIV:
+            case OPC_DDIV:
+            case OPC_LREM:
+            case OPC_DREM:
+            case OPC_LAND:
+            case OPC_LOR:
+            case OPC_LXOR:
+                pop(stack, 4);
+                push(stack, SLOT_VALUE, 2);
+                break;
+
+            case OPC_LSHL:
+            case OPC_LSHR:
+            case OPC_LUSHR:
+                pop(stack, 3);
+                push(stack, SLOT_VALUE, 2);
+                break;
+
+            case OPC_I2L:
+            case OPC_I2D:
+            case OPC_F2L:
+            case OPC_F2D:
+                pop(stack, 1);
+                push(stack, SLOT_VALUE, 2);
+                break;
+
+            case OPC_L2I:
+            case OPC_L2F:
+            case OPC_D2I:
+            case OPC_D2F:
+                pop(stack, 2);
+                push(stack, SLOT_VALUE);
+                break;
+
+            case OPC_LCMP:
+            case OPC_DCMPL:
+            case OPC_DCMPG:
+                pop(stack, 4);
+                push(stack, SLOT_VALUE);
+                break;
+
+            case OPC_IRETURN:
+            case OPC_LRETURN:
+            case OPC_FRETURN:
+            case OPC_DRETURN:
+            case OPC_ARETURN:
+            case OPC_RETURN:
+            case OPC_ATHROW:
+                stack.clear();
+                break;
+
+            case OPC_GETSTATIC: {
+                auto descriptor = getMemberDescriptor(pool, readU2(code, bci + 1));
+                pushDescriptorType(stack, descriptor->bytes, 0);
+                break;
+            }
+
+            case OPC_PUTSTATIC: {
+                auto descriptor = getMemberDescriptor(pool, readU2(code, bci + 1));
+                pop(stack, getSlotCount(descriptor->bytes[0]));
+                break;
+            }
+
+            case OPC_GETFIELD: {
+                auto descriptor = getMemberDescriptor(pool, readU2(code, bci + 1));
+                pop(stack, 1);
+                pushDescriptorType(stack, descriptor->bytes, 0);
+                break;
+            }
+
+            case OPC_PUTFIELD: {
+                auto descriptor = getMemberDescriptor(pool, readU2(code, bci + 1));
+                pop(stack, getSlotCount(descriptor->bytes[0]) + 1);
+                break;
+            }
+
+            case OPC_INVOKEVIRTUAL:
+            case OPC_INVOKESPECIAL:
+            case OPC_INVOKEINTERFACE:
+                doInvoke(state, pool, readU2(code, bci + 1), true);
+                break;
+
+            case OPC_INVOKESTATIC:
+            case OPC_INVOKEDYNAMIC:
+                doInvoke(state, pool, readU2(code, bci + 1), false);
+                break;
+
+            case OPC_NEWARRAY:
+            case OPC_ANEWARRAY:
+                pop(stack, 1);
+                push(stack, SLOT_OOP);
+                break;
+
+            case OPC_ARRAYLENGTH:
+            case OPC_INSTANCEOF:
+                pop(stack, 1);
+                push(stack, SLOT_VALUE);
+                break;
+
+            case OPC_MULTIANEWARRAY:
+                pop(stack, code[bci + 3]);
+                push(stack, SLOT_OOP);
+                break;
+
+            case OPC_WIDE: {
+                int widened = code[bci + 1];
+                int index = readU2(code, bci + 2);
+                switch (widened) {
+                    case OPC_ILOAD:
+                    case OPC_LLOAD:
+                    case OPC_FLOAD:
+                    case OPC_DLOAD:
+                    case OPC_ALOAD:
+                        doLoad(state, widened);
+                        break;
+                    case OPC_ISTORE:
+                    case OPC_LSTORE:
+                    case OPC_FSTORE:
+                    case OPC_DSTORE:
+                    case OPC_ASTORE:
+                        doStore(state, widened, index);
+                        break;
+                    default:
+                        // iinc and ret
+                        break;
+                }
+                break;
+            }
+
+            default:
+                PANIC("OopMap: unknown bytecode %d at %d", opcode, bci);
+        }
+    }
+}
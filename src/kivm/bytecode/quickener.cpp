@@ -0,0 +1,153 @@
+//
+// Rewriting of resolved instructions into quickened variants
+//
+
+#include <kivm/bytecode/quickener.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/oop/instanceKlass.h>
+
+namespace kivm {
+    static inline bool isInitialized(InstanceKlass *klass) {
+        return klass->getClassState() == ClassState::FULLY_INITIALIZED;
+    }
+
+    static int selectGetField(ValueType valueType) {
+        switch (valueType) {
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                return OPC_FAST_AGETFIELD;
+            case ValueType::INT:
+                return OPC_FAST_IGETFIELD;
+            case ValueType::LONG:
+                return OPC_FAST_LGETFIELD;
+            case ValueType::FLOAT:
+                return OPC_FAST_FGETFIELD;
+            case ValueType::DOUBLE:
+                return OPC_FAST_DGETFIELD;
+            default:
+                return -1;
+        }
+    }
+
+    static int selectPutField(ValueType valueType) {
+        switch (valueType) {
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                return OPC_FAST_APUTFIELD;
+            case ValueType::INT:
+                return OPC_FAST_IPUTFIELD;
+            case ValueType::LONG:
+                return OPC_FAST_LPUTFIELD;
+            case ValueType::FLOAT:
+                return OPC_FAST_FPUTFIELD;
+            case ValueType::DOUBLE:
+                return OPC_FAST_DPUTFIELD;
+            default:
+                return -1;
+        }
+    }
+
+    void Quickener::quickenField(RuntimeConstantPool *rt, CodeBlob &code,
+                                 int bci, int constantIndex) {
+        int opcode = code[bci];
+        bool isStatic = opcode == OPC_GETSTATIC || opcode == OPC_PUTSTATIC;
+        auto field = isStatic
+                     ? rt->getStaticField(constantIndex)
+                     : rt->getInstanceField(constantIndex);
+
+        auto holder = field->_field->getClass();
+        if (!isInitialized(holder)) {
+            return;
+        }
+
+        ValueType valueType = field->_field->getValueType();
+        int fastOpcode = -1;
+        switch (opcode) {
+            case OPC_GETSTATIC:
+                fastOpcode = OPC_FAST_GETSTATIC;
+                break;
+            case OPC_PUTSTATIC:
+                fastOpcode = OPC_FAST_PUTSTATIC;
+                break;
+            case OPC_GETFIELD:
+                fastOpcode = selectGetField(valueType);
+                break;
+            case OPC_PUTFIELD:
+                fastOpcode = selectPutField(valueType);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+
+        if (fastOpcode < 0) {
+            return;
+        }
+
+        auto entry = rt->getResolvedEntry(constantIndex);
+        entry->_klass = holder;
+        entry->_offset = field->_offset;
+        entry->_valueType = valueType;
+        code.rewrite(bci, (u1) fastOpcode);
+    }
+
+    void Quickener::quickenNew(RuntimeConstantPool *rt, CodeBlob &code,
+                               int bci, int constantIndex) {
+        auto klass = rt->getClass(constantIndex);
+        if (klass->getClassType() != ClassType::INSTANCE_CLASS
+            || !isInitialized((InstanceKlass *) klass)) {
+            return;
+        }
+
+        rt->getResolvedEntry(constantIndex)->_klass = (InstanceKlass *) klass;
+        code.rewrite(bci, OPC_FAST_NEW);
+    }
+
+    void Quickener::quickenInvoke(RuntimeConstantPool *rt, CodeBlob &code,
+                                  int bci, int constantIndex) {
+        Method *method = rt->getMethod(constantIndex);
+        if (method == nullptr || !isInitialized(method->getClass())) {
+            return;
+        }
+
+        // the same choice as JavaCall::invokeSimple(), native methods
+        // are never dispatched
+        bool isVirtual = code[bci] == OPC_INVOKEVIRTUAL
+                         && !method->isNative()
+                         && (method->isAbstract() || (method->isPublic() && !method->isFinal()));
+
+        // vtable indices of interfaces mean nothing to their implementations
+        if (isVirtual && method->getClass()->isInterface()) {
+            return;
+        }
+
+        auto entry = rt->getResolvedEntry(constantIndex);
+        entry->_method = method;
+        if (!isVirtual) {
+            code.rewrite(bci, OPC_FAST_INVOKEDIRECT);
+            return;
+        }
+
+        int slots = 0;
+        for (auto valueType : method->getArgumentValueTypes()) {
+            slots += (valueType == ValueType::LONG || valueType == ValueType::DOUBLE) ? 2 : 1;
+        }
+        entry->_argumentSlots = slots;
+        code.rewrite(bci, OPC_FAST_INVOKEVIRTUAL);
+    }
+
+    void Quickener::quickenLoadConstant(RuntimeConstantPool *rt, CodeBlob &code,
+                                        int bci, int constantIndex) {
+        bool wide = code[bci] == OPC_LDC_W;
+        switch (rt->getConstantTag(constantIndex)) {
+            case CONSTANT_Integer:
+            case CONSTANT_Float:
+                code.rewrite(bci, wide ? OPC_FAST_LDC_W : OPC_FAST_LDC);
+                break;
+            case CONSTANT_String:
+                code.rewrite(bci, wide ? OPC_FAST_ALDC_W : OPC_FAST_ALDC);
+                break;
+            default:
+                break;
+        }
+    }
+}
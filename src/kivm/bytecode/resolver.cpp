@@ -8,10 +8,20 @@
 #include <kivm/oop/primitiveOop.h>
 #include <kivm/oop/mirrorOop.h>
 #include <kivm/memory/universe.h>
+#include <kivm/runtime/javaThread.h>
 
 namespace kivm {
     oop Resolver::javaOop(jobject obj) {
-        if (obj != nullptr && Universe::isHeapObject(obj)) {
+        if (obj == nullptr) {
+            return nullptr;
+        }
+        if (Universe::isHeapObject(obj)) {
+            return (oop) obj;
+        }
+
+        // objects that never escape the frame of the current thread
+        auto thread = Threads::currentThread();
+        if (thread != nullptr && thread->getFrameArena().contains(obj)) {
             return (oop) obj;
         }
         return nullptr;
@@ -72,10 +82,17 @@ namespace kivm {
     }
 
     Klass *Resolver::javaClass(jclass clazz) {
-        if (clazz != nullptr) {
-            return (Klass *) clazz;
+        if (clazz == nullptr) {
+            return nullptr;
         }
-        return nullptr;
+
+        // jclass from JNI functions (like FindClass) is a java mirror,
+        // while native methods receive the Klass itself.
+        if (Universe::isHeapObject(clazz)) {
+            auto m = mirror(clazz);
+            return m != nullptr ? m->getTarget() : nullptr;
+        }
+        return (Klass *) clazz;
     }
 
     InstanceKlass *Resolver::instanceClass(jclass clazz) {
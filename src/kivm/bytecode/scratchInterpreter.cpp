@@ -5,6 +5,7 @@
 #include <kivm/bytecode/bytecodeInterpreter.h>
 #include <kivm/bytecode/bytecodes.h>
 #include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/tosCachedStack.h>
 #include <kivm/oop/instanceOop.h>
 #include <kivm/oop/arrayOop.h>
 #include <kivm/oop/primitiveOop.h>
@@ -43,8 +44,9 @@ namespace kivm {
          * Run a thread method
          *
          * @param thread Java Thread that contains method
-         * @return method return value(nullptr if void) o
-         *         exception object(if thrown and not handled)
+         * @return returned reference, or exception object(if thrown and not handled),
+         *         nullptr otherwise, primitive results are left in
+         *         {@code JavaThread::_returnValue}
          */
         static oop interp(JavaThread *thread);
     };
@@ -63,7 +65,7 @@ namespace kivm {
             (currentMethod->getName()).c_str(),
             (currentMethod->getDescriptor()).c_str());
 
-        Stack &stack = currentFrame->getStack();
+        TosCachedStack stack(currentFrame->getStack());
         Locals &locals = currentFrame->getLocals();
 
         thread->enterSafepointIfNeeded();
@@ -165,24 +167,26 @@ namespace kivm {
                 OPCODE(LDC)
                 {
                     int constantIndex = codeBlob[pc++];
-                    Execution::loadConstant(currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex);
+                    Execution::loadConstant(thread, currentClass->getRuntimeConstantPool(),
+                        stack.flush(), constantIndex);
+                    CHECK_EXCEPTION();
                     NEXT();
                 }
                 OPCODE(LDC_W)
                 {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
-                    Execution::loadConstant(currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex);
+                    Execution::loadConstant(thread, currentClass->getRuntimeConstantPool(),
+                        stack.flush(), constantIndex);
+                    CHECK_EXCEPTION();
                     NEXT();
                 }
                 OPCODE(LDC2_W)
                 {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
-                    Execution::loadConstant(currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex);
+                    Execution::loadConstant(thread, currentClass->getRuntimeConstantPool(),
+                        stack.flush(), constantIndex);
                     NEXT();
                 }
                 OPCODE(ILOAD)
@@ -317,32 +321,45 @@ namespace kivm {
                 }
 
                 OPCODE(IALOAD)
+                {
+                    LOAD_ARRAY_ELEMENT(jint, typeArray, pushInt);
+                    NEXT();
+                }
                 OPCODE(SALOAD)
+                {
+                    LOAD_ARRAY_ELEMENT(jshort, typeArray, pushInt);
+                    NEXT();
+                }
                 OPCODE(CALOAD)
+                {
+                    LOAD_ARRAY_ELEMENT(jchar, typeArray, pushInt);
+                    NEXT();
+                }
                 OPCODE(BALOAD)
                 {
-                    LOAD_ARRAY_ELEMENT(intOop, element, typeArray, pushInt, element->getValue());
+                    // shared by byte[] and boolean[], both are 1 byte per element
+                    LOAD_ARRAY_ELEMENT(jbyte, typeArray, pushInt);
                     NEXT();
                 }
 
                 OPCODE(LALOAD)
                 {
-                    LOAD_ARRAY_ELEMENT(longOop, element, typeArray, pushLong, element->getValue());
+                    LOAD_ARRAY_ELEMENT(jlong, typeArray, pushLong);
                     NEXT();
                 }
                 OPCODE(FALOAD)
                 {
-                    LOAD_ARRAY_ELEMENT(floatOop, element, typeArray, pushFloat, element->getValue());
+                    LOAD_ARRAY_ELEMENT(jfloat, typeArray, pushFloat);
                     NEXT();
                 }
                 OPCODE(DALOAD)
                 {
-                    LOAD_ARRAY_ELEMENT(doubleOop, element, typeArray, pushDouble, element->getValue());
+                    LOAD_ARRAY_ELEMENT(jdouble, typeArray, pushDouble);
                     NEXT();
                 }
                 OPCODE(AALOAD)
                 {
-                    LOAD_ARRAY_ELEMENT(oop, element, objectArray, pushReference, element);
+                    LOAD_ARRAY_ELEMENT(oop, objectArray, pushReference);
                     NEXT();
                 }
                 OPCODE(ISTORE)
@@ -477,32 +494,48 @@ namespace kivm {
                 }
 
                 OPCODE(BASTORE)
+                {
+                    // boolean[] only keeps the lowest bit
+                    STORE_ARRAY_ELEMENT(jbyte, value, typeArray, popInt,
+                        ((TypeArrayKlass *) array->getClass())->getComponentType() == ValueType::BOOLEAN
+                        ? (value & 1) : value);
+                    NEXT();
+                }
                 OPCODE(CASTORE)
+                {
+                    STORE_ARRAY_ELEMENT(jchar, value, typeArray, popInt, value);
+                    NEXT();
+                }
                 OPCODE(SASTORE)
+                {
+                    STORE_ARRAY_ELEMENT(jshort, value, typeArray, popInt, value);
+                    NEXT();
+                }
                 OPCODE(IASTORE)
                 {
-                    STORE_ARRAY_ELEMENT(value, typeArray, popInt, new intOopDesc(value));
+                    STORE_ARRAY_ELEMENT(jint, value, typeArray, popInt, value);
                     NEXT();
                 }
 
                 OPCODE(LASTORE)
                 {
-                    STORE_ARRAY_ELEMENT(value, typeArray, popLong, new longOopDesc(value));
+                    STORE_ARRAY_ELEMENT(jlong, value, typeArray, popLong, value);
                     NEXT();
                 }
                 OPCODE(FASTORE)
                 {
-                    STORE_ARRAY_ELEMENT(value, typeArray, popFloat, new floatOopDesc(value));
+                    STORE_ARRAY_ELEMENT(jfloat, value, typeArray, popFloat, value);
                     NEXT();
                 }
                 OPCODE(DASTORE)
                 {
-                    STORE_ARRAY_ELEMENT(value, typeArray, popDouble, new doubleOopDesc(value));
+                    STORE_ARRAY_ELEMENT(jdouble, value, typeArray, popDouble, value);
                     NEXT();
                 }
                 OPCODE(AASTORE)
                 {
-                    STORE_ARRAY_ELEMENT(value, objectArray, popReference, Resolver::javaOop(value));
+                    STORE_ARRAY_ELEMENT(oop, value, objectArray, popReference, Resolver::javaOop(value));
+                    Universe::writeBarrier(array->getElementAddress<oop>(index));
                     NEXT();
                 }
 
@@ -1214,9 +1247,9 @@ namespace kivm {
                     if (topValue > (int) (jumpTable.size() - 1 + lowByte)
                         || topValue < lowByte) {
                         // jump to default
-                        GOTO_ABSOLUTE_WITH_OCCUPIED(static_cast<u4>(jumpTable.back()), 1);
+                        SWITCH_GOTO_ABSOLUTE(static_cast<u4>(jumpTable.back()), originBc);
                     } else {
-                        GOTO_ABSOLUTE_WITH_OCCUPIED(static_cast<u4>(jumpTable[topValue - lowByte]), 1);
+                        SWITCH_GOTO_ABSOLUTE(static_cast<u4>(jumpTable[topValue - lowByte]), originBc);
                     }
                 }
                 NEXT();
@@ -1260,39 +1293,49 @@ namespace kivm {
                     int topValue = stack.popInt();
                     auto iter = jumpTable.find(topValue);
                     if (iter == jumpTable.end()) {
-                        GOTO_ABSOLUTE_WITH_OCCUPIED(defaultByte + originBc, 1);
+                        SWITCH_GOTO_ABSOLUTE(defaultByte + originBc, originBc);
                     } else {
-                        GOTO_ABSOLUTE_WITH_OCCUPIED(iter->second, 1);
+                        SWITCH_GOTO_ABSOLUTE(iter->second, originBc);
                     }
                 }
                 NEXT();
                 OPCODE(IRETURN)
                 {
-                    return new intOopDesc(stack.popInt());
+                    SAFEPOINT_POLL();
+                    thread->_returnValue.i = stack.popInt();
+                    return nullptr;
                     NEXT();
                 }
                 OPCODE(LRETURN)
                 {
-                    return new longOopDesc(stack.popLong());
+                    SAFEPOINT_POLL();
+                    thread->_returnValue.j = stack.popLong();
+                    return nullptr;
                     NEXT();
                 }
                 OPCODE(FRETURN)
                 {
-                    return new floatOopDesc(stack.popFloat());
+                    SAFEPOINT_POLL();
+                    thread->_returnValue.f = stack.popFloat();
+                    return nullptr;
                     NEXT();
                 }
                 OPCODE(DRETURN)
                 {
-                    return new doubleOopDesc(stack.popDouble());
+                    SAFEPOINT_POLL();
+                    thread->_returnValue.d = stack.popDouble();
+                    return nullptr;
                     NEXT();
                 }
                 OPCODE(ARETURN)
                 {
+                    SAFEPOINT_POLL();
                     return Resolver::javaOop(stack.popReference());
                     NEXT();
                 }
                 OPCODE(RETURN)
                 {
+                    SAFEPOINT_POLL();
                     // monitor released in invokeXXX
                     return nullptr;
                     NEXT();
@@ -1302,7 +1345,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::getField(thread, currentClass->getRuntimeConstantPool(),
-                        nullptr, stack, constantIndex);
+                        nullptr, stack.flush(), constantIndex);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1311,7 +1354,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::putField(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex, true);
+                        stack.flush(), constantIndex, true);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1330,7 +1373,7 @@ namespace kivm {
                             SHOULD_NOT_REACH_HERE_M("Not an instance oop");
                         }
                         Execution::getField(thread, currentClass->getRuntimeConstantPool(),
-                            receiver, stack, constantIndex);
+                            receiver, stack.flush(), constantIndex);
                         CHECK_EXCEPTION();
                     }
                     NEXT();
@@ -1340,7 +1383,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::putField(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex, false);
+                        stack.flush(), constantIndex, false);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1349,7 +1392,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::invokeVirtual(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex);
+                        stack.flush(), constantIndex);
 
                     CHECK_EXCEPTION();
                     NEXT();
@@ -1359,7 +1402,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::invokeSpecial(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex);
+                        stack.flush(), constantIndex);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1368,7 +1411,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::invokeStatic(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex);
+                        stack.flush(), constantIndex);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1385,7 +1428,7 @@ namespace kivm {
                         // continue
                     }
                     Execution::invokeInterface(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex, count);
+                        stack.flush(), constantIndex, count);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1399,7 +1442,7 @@ namespace kivm {
                     }
                     pc += 4;
 
-                    Execution::invokeDynamic(thread, currentClass, stack, constantIndex);
+                    Execution::invokeDynamic(thread, currentClass, stack.flush(), constantIndex);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1407,8 +1450,10 @@ namespace kivm {
                 {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
-                    auto instance = Execution::newInstance(thread, currentClass->getRuntimeConstantPool(),
-                        constantIndex);
+                    // allocation may collect garbage
+                    stack.flush();
+                    auto instance = Execution::newInstance(thread, currentFrame, currentClass->getRuntimeConstantPool(),
+                        constantIndex, pc - 3);
                     CHECK_EXCEPTION();
                     stack.pushReference(instance);
                     NEXT();
@@ -1424,6 +1469,7 @@ namespace kivm {
                         HANDLE_EXCEPTION();
                     }
                     auto array = Execution::newPrimitiveArray(thread, arrayType, length);
+                    CHECK_EXCEPTION();
                     stack.pushReference(array);
                     NEXT();
                 }
@@ -1489,7 +1535,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::instanceOf(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex, true);
+                        stack.flush(), constantIndex, true);
                     CHECK_EXCEPTION();
                     NEXT();
                 }
@@ -1498,7 +1544,7 @@ namespace kivm {
                     int constantIndex = codeBlob[pc] << 8 | codeBlob[pc + 1];
                     pc += 2;
                     Execution::instanceOf(thread, currentClass->getRuntimeConstantPool(),
-                        stack, constantIndex, false);
+                        stack.flush(), constantIndex, false);
                     NEXT();
                 }
                 OPCODE(MONITORENTER)
@@ -1513,7 +1559,7 @@ namespace kivm {
                             // TODO: throw an exception
                             SHOULD_NOT_REACH_HERE_M("not an object");
                         }
-                        object->getMarkOop()->monitorEnter();
+                        thread->monitorEnter(object);
                     }
                     NEXT();
                 }
@@ -1529,7 +1575,7 @@ namespace kivm {
                             // TODO: throw an exception
                             SHOULD_NOT_REACH_HERE_M("not an object");
                         }
-                        object->getMarkOop()->monitorExit();
+                        thread->monitorExit(object);
                     }
                     NEXT();
                 }
@@ -1554,9 +1600,11 @@ namespace kivm {
                         }
                         length.push_back(sub);
                     }
-                    stack.pushReference(Execution::newMultiObjectArray(thread,
+                    auto array = Execution::newMultiObjectArray(thread,
                         currentClass->getRuntimeConstantPool(),
-                        constantIndex, dimension, length));
+                        constantIndex, dimension, length);
+                    CHECK_EXCEPTION();
+                    stack.pushReference(array);
                 }
                 NEXT();
                 OPCODE(IFNULL)
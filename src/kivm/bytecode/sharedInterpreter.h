@@ -6,6 +6,24 @@
 #undef D
 #define D(...)
 
+// Interpreters that don't keep pc up to date while running define
+// SYNC_PC() before including this file, the handlers below call it
+// before anything that may throw or reach a safepoint.
+#ifndef SYNC_PC
+#define SYNC_PC()
+#endif
+
+// Threads only stop for GC at method entries, backward branches
+// and returns, so that a loop cannot delay a GC forever.
+// pc stays inside the polling instruction, oop maps depend on it.
+// GC scans the frame stack, so the cached top of stack goes back first.
+#define SAFEPOINT_POLL() \
+                    if (GCThread::isSafepointPollArmed()) { \
+                        SYNC_PC(); \
+                        stack.flush(); \
+                        thread->enterSafepoint(); \
+                    }
+
 #define GOTO_BY_OFFSET(branch) \
                     pc += branch
 
@@ -15,11 +33,20 @@
 
 #define GOTO_BY_OFFSET_HARDCODEDED(occupied) \
                     short branch = codeBlob[pc] << 8 | codeBlob[pc + 1]; \
+                    if (branch <= 0) { \
+                        SAFEPOINT_POLL(); \
+                    } \
                     GOTO_BY_OFFSET_WITH_OCCUPIED(branch, occupied)
 
 #define GOTO_ABSOLUTE(newPc) \
                     pc = newPc
 
+#define SWITCH_GOTO_ABSOLUTE(newPc, originBc) \
+                    if ((int) (newPc) <= (originBc)) { \
+                        SAFEPOINT_POLL(); \
+                    } \
+                    GOTO_ABSOLUTE_WITH_OCCUPIED(newPc, 1)
+
 #define GOTO_ABSOLUTE_WITH_OCCUPIED(newPc, occupied) \
                     GOTO_ABSOLUTE(newPc); \
                     GOTO_BY_OFFSET(-((occupied) - 1))
@@ -56,40 +83,330 @@
         HANDLE_EXCEPTION(); \
     }
 
-#define LOAD_ARRAY_ELEMENT(oopType, varName, resolveFunc, pushFunc, exp) \
-    int index = stack.popInt(); \
-    jobject ref = stack.popReference(); \
-    auto array = Resolver::resolveFunc(ref); \
-    if (array == nullptr) { \
-        thread->throwException(Global::_NullPointerException, false); \
-        HANDLE_EXCEPTION(); \
-    } \
-    if (index < 0 || index >= array->getLength()) { \
+#define THROW_NULL_POINTER() \
+    SYNC_PC(); \
+    thread->throwException(Global::_NullPointerException, false); \
+    HANDLE_EXCEPTION()
+
+#define THROW_BY_NAME(className, message) \
+    SYNC_PC(); \
+    thread->throwException((InstanceKlass *) BootstrapClassLoader::get() \
+        ->loadClass(className), message, false); \
+    HANDLE_EXCEPTION()
+
+#define CHECK_ARRAY_INDEX(array, index) \
+    if ((index) < 0 || (index) >= (array)->getLength()) { \
+        SYNC_PC(); \
         thread->throwException(Global::_ArrayIndexOutOfBoundsException, \
             L"length is " \
-            + std::to_wstring(array->getLength()) \
+            + std::to_wstring((array)->getLength()) \
             + L", but index is " \
             + std::to_wstring(index), false); \
         HANDLE_EXCEPTION(); \
+    }
+
+#define CHECK_ARRAY_LENGTH(length) \
+    if ((length) < 0) { \
+        THROW_BY_NAME(L"java/lang/NegativeArraySizeException", std::to_wstring(length)); \
+    }
+
+#define CHECK_DIVISOR(v2) \
+    if ((v2) == 0) { \
+        THROW_BY_NAME(L"java/lang/ArithmeticException", L"divide by zero"); \
+    }
+
+#define LOAD_ARRAY_ELEMENT(elementType, resolveFunc, pushFunc) \
+    int index = stack.popInt(); \
+    jobject ref = stack.popReference(); \
+    LOAD_ARRAY_ELEMENT_AT(elementType, resolveFunc, pushFunc)
+
+#define LOAD_ARRAY_ELEMENT_AT(elementType, resolveFunc, pushFunc) \
+    auto array = Resolver::resolveFunc(ref); \
+    if (array == nullptr) { \
+        THROW_NULL_POINTER(); \
     } \
-    auto varName = (oopType) array->getElementAt(index);\
-    stack.pushFunc(exp)
+    CHECK_ARRAY_INDEX(array, index); \
+    stack.pushFunc(*array->getElementAddress<elementType>(index))
 
-#define STORE_ARRAY_ELEMENT(varName, resolveFunc, popFunc, exp) \
+#define STORE_ARRAY_ELEMENT(elementType, varName, resolveFunc, popFunc, exp) \
     auto varName = stack.popFunc(); \
     int index = stack.popInt(); \
     auto ref = stack.popReference(); \
     auto array = Resolver::resolveFunc(ref); \
     if (array == nullptr) { \
-        thread->throwException(Global::_NullPointerException, false); \
-        HANDLE_EXCEPTION(); \
+        THROW_NULL_POINTER(); \
     } \
-    if (index < 0 || index >= array->getLength()) { \
-        thread->throwException(Global::_ArrayIndexOutOfBoundsException, \
-            L"length is " \
-            + std::to_wstring(array->getLength()) \
-            + L", but index is " \
-            + std::to_wstring(index), false); \
-        HANDLE_EXCEPTION(); \
+    CHECK_ARRAY_INDEX(array, index); \
+    if (std::is_same<elementType, oop>::value) { \
+        Universe::preWriteBarrier(array->getElementAddress<elementType>(index)); \
+    } \
+    *array->getElementAddress<elementType>(index) = (elementType) (exp);
+
+#define ARRAYLENGTH_OP() \
+    jobject ref = stack.popReference(); \
+    if (ref == nullptr) { \
+        THROW_NULL_POINTER(); \
+    } \
+    arrayOop array = Resolver::array(ref); \
+    if (array == nullptr) { \
+        THROW_BY_NAME(L"java/lang/IncompatibleClassChangeError", \
+            L"arraylength on a non-array object"); \
+    } \
+    stack.pushInt(array->getLength())
+
+// Slots are copied as they are, whatever type they hold.
+#define STACK_DUP() \
+    auto v1 = stack.popReference(); \
+    stack.pushReference(v1); \
+    stack.pushReference(v1)
+
+#define STACK_DUP_X1() \
+    auto v1 = stack.popReference(); \
+    auto v2 = stack.popReference(); \
+    stack.pushReference(v1); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1)
+
+#define STACK_DUP_X2() \
+    auto v1 = stack.popReference(); \
+    auto v2 = stack.popReference(); \
+    auto v3 = stack.popReference(); \
+    stack.pushReference(v1); \
+    stack.pushReference(v3); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1)
+
+#define STACK_DUP2() \
+    auto v1 = stack.popReference(); \
+    auto v2 = stack.popReference(); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1)
+
+#define STACK_DUP2_X1() \
+    auto v1 = stack.popReference(); \
+    auto v2 = stack.popReference(); \
+    auto v3 = stack.popReference(); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1); \
+    stack.pushReference(v3); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1)
+
+#define STACK_DUP2_X2() \
+    auto v1 = stack.popReference(); \
+    auto v2 = stack.popReference(); \
+    auto v3 = stack.popReference(); \
+    auto v4 = stack.popReference(); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1); \
+    stack.pushReference(v4); \
+    stack.pushReference(v3); \
+    stack.pushReference(v2); \
+    stack.pushReference(v1)
+
+#define STACK_SWAP() \
+    auto v1 = stack.popReference(); \
+    auto v2 = stack.popReference(); \
+    stack.pushReference(v1); \
+    stack.pushReference(v2)
+
+#define INCREMENT_LOCAL(index, factor) \
+    locals.setInt(index, locals.getInt(index) + (factor))
+
+#define BINARY_OP(popFunc, pushFunc, op) \
+    auto v2 = stack.popFunc(); \
+    auto v1 = stack.popFunc(); \
+    stack.pushFunc(v1 op v2)
+
+#define DIVIDE_OP(popFunc, pushFunc) \
+    auto v2 = stack.popFunc(); \
+    auto v1 = stack.popFunc(); \
+    CHECK_DIVISOR(v2); \
+    stack.pushFunc(v1 / v2)
+
+#define REMAINDER_OP(popFunc, pushFunc) \
+    auto v2 = stack.popFunc(); \
+    auto v1 = stack.popFunc(); \
+    CHECK_DIVISOR(v2); \
+    stack.pushFunc(v1 - (v1 / v2) * v2)
+
+#define SHIFT_OP(popFunc, pushFunc, mask, op) \
+    auto v2 = stack.popInt(); \
+    auto v1 = stack.popFunc(); \
+    stack.pushFunc(v1 op (v2 & (mask)))
+
+#define UNSIGNED_SHIFT_OP(popFunc, pushFunc, mask) \
+    auto v2 = stack.popInt(); \
+    auto v1 = stack.popFunc(); \
+    auto s = v2 & (mask); \
+    if (v1 >= 0) { \
+        stack.pushFunc(v1 >> s); \
+    } else { \
+        stack.pushFunc((v1 >> s) + (2 << ~s)); \
+    }
+
+#define CONVERT(popFunc, pushFunc, type) \
+    stack.pushFunc((type) stack.popFunc())
+
+// NaN converts to 0, infinities saturate.
+// kind is FLOAT or DOUBLE, which picks the NaN and infinity tests.
+#define CONVERT_FLOATING(popFunc, pushFunc, type, kind, maxValue, minValue) \
+    auto v1 = stack.popFunc(); \
+    if (kind##_IS_NAN(v1)) { \
+        stack.pushFunc(0); \
+    } else if (kind##_IS_POSITIVE_INFINITY(v1)) { \
+        stack.pushFunc(maxValue); \
+    } else if (kind##_IS_NEGATIVE_INFINITY(v1)) { \
+        stack.pushFunc(minValue); \
+    } else { \
+        stack.pushFunc((type) v1); \
+    }
+
+#define COMPARE_OP(popFunc) \
+    auto v1 = stack.popFunc(); \
+    auto v2 = stack.popFunc(); \
+    stack.pushInt(v1 > v2 ? -1 : v1 < v2 ? 1 : 0)
+
+#define COMPARE_FLOATING_OP(popFunc, kind, nanResult) \
+    auto v1 = stack.popFunc(); \
+    auto v2 = stack.popFunc(); \
+    if (kind##_IS_NAN(v1) || kind##_IS_NAN(v2)) { \
+        stack.pushInt(nanResult); \
+    } else { \
+        stack.pushInt(v1 > v2 ? -1 : v1 < v2 ? 1 : 0); \
+    }
+
+// The handlers below leave quickening to the interpreter,
+// each one keeps the rewritten code in its own way.
+#define LOAD_CONSTANT_OP(constantIndex) \
+    SYNC_PC(); \
+    Execution::loadConstant(thread, rt, stack.flush(), constantIndex); \
+    CHECK_EXCEPTION()
+
+#define GETSTATIC_OP(constantIndex) \
+    SYNC_PC(); \
+    Execution::getField(thread, rt, nullptr, stack.flush(), constantIndex); \
+    CHECK_EXCEPTION()
+
+#define PUTSTATIC_OP(constantIndex) \
+    SYNC_PC(); \
+    Execution::putField(thread, rt, stack.flush(), constantIndex, true); \
+    CHECK_EXCEPTION()
+
+#define GETFIELD_OP(constantIndex) \
+    jobject ref = stack.popReference(); \
+    if (ref == nullptr) { \
+        THROW_NULL_POINTER(); \
+    } \
+    instanceOop receiver = Resolver::instance(ref); \
+    if (receiver == nullptr) { \
+        THROW_BY_NAME(L"java/lang/IncompatibleClassChangeError", \
+            L"getfield on a non-instance object"); \
+    } \
+    SYNC_PC(); \
+    Execution::getField(thread, rt, receiver, stack.flush(), constantIndex); \
+    CHECK_EXCEPTION()
+
+#define PUTFIELD_OP(constantIndex) \
+    SYNC_PC(); \
+    Execution::putField(thread, rt, stack.flush(), constantIndex, false); \
+    CHECK_EXCEPTION()
+
+// target is the constant pool or the resolved entry,
+// the rest are the operands after the stack.
+#define INVOKE_OP(invokeFunc, target, ...) \
+    SYNC_PC(); \
+    Execution::invokeFunc(thread, target, stack.flush(), ##__VA_ARGS__); \
+    CHECK_EXCEPTION()
+
+// allocation may collect garbage
+#define NEW_OP(...) \
+    SYNC_PC(); \
+    stack.flush(); \
+    auto instance = Execution::newInstance(thread, currentFrame, __VA_ARGS__); \
+    CHECK_EXCEPTION(); \
+    stack.pushReference(instance)
+
+#define NEWARRAY_OP(arrayType) \
+    int length = stack.popInt(); \
+    CHECK_ARRAY_LENGTH(length); \
+    SYNC_PC(); \
+    auto array = Execution::newPrimitiveArray(thread, arrayType, length); \
+    CHECK_EXCEPTION(); \
+    stack.pushReference(array)
+
+#define ANEWARRAY_OP(constantIndex) \
+    int length = stack.popInt(); \
+    CHECK_ARRAY_LENGTH(length); \
+    SYNC_PC(); \
+    auto array = Execution::newObjectArray(thread, rt, constantIndex, length); \
+    CHECK_EXCEPTION(); \
+    stack.pushReference(array)
+
+#define MULTIANEWARRAY_OP(constantIndex, dimension) \
+    std::deque<int> length; \
+    for (int i = 0; i < (dimension); ++i) { \
+        int sub = stack.popInt(); \
+        CHECK_ARRAY_LENGTH(sub); \
+        length.push_back(sub); \
     } \
-    array->setElementAt(index, exp);
+    SYNC_PC(); \
+    auto array = Execution::newMultiObjectArray(thread, rt, constantIndex, dimension, length); \
+    CHECK_EXCEPTION(); \
+    stack.pushReference(array)
+
+#define INSTANCEOF_OP(constantIndex, checkCast) \
+    SYNC_PC(); \
+    Execution::instanceOf(thread, rt, stack.flush(), constantIndex, checkCast); \
+    CHECK_EXCEPTION()
+
+#define MONITOR_OP(monitorFunc) \
+    jobject ref = stack.popReference(); \
+    if (ref == nullptr) { \
+        THROW_NULL_POINTER(); \
+    } \
+    auto object = Resolver::javaOop(ref); \
+    if (object == nullptr) { \
+        THROW_BY_NAME(L"java/lang/IncompatibleClassChangeError", \
+            L"monitor on a non-object"); \
+    } \
+    thread->monitorFunc(object)
+
+// Quickened instructions keep the constant index of the original ones.
+#define RESOLVED_ENTRY() \
+    rt->getResolvedEntry(codeBlob[pc] << 8 | codeBlob[pc + 1])
+
+#define GETFIELD_AT(entry, fieldType, pushFunc) \
+    jobject ref = stack.popReference(); \
+    if (ref == nullptr) { \
+        THROW_NULL_POINTER(); \
+    } \
+    stack.pushFunc(*((instanceOop) ref)->getFieldAddress<fieldType>((entry)->_offset))
+
+// Stores into reference fields go through both write barriers.
+#define PUTFIELD_AT(entry, fieldType, popFunc) \
+    auto value = stack.popFunc(); \
+    jobject ref = stack.popReference(); \
+    if (ref == nullptr) { \
+        THROW_NULL_POINTER(); \
+    } \
+    auto address = ((instanceOop) ref)->getFieldAddress<fieldType>((entry)->_offset); \
+    if (std::is_same<fieldType, oop>::value) { \
+        Universe::preWriteBarrier(address); \
+    } \
+    *address = (fieldType) value; \
+    if (std::is_same<fieldType, oop>::value) { \
+        Universe::writeBarrier(address); \
+    }
+
+#define FAST_GETFIELD(fieldType, pushFunc) \
+    auto entry = RESOLVED_ENTRY(); \
+    pc += 2; \
+    GETFIELD_AT(entry, fieldType, pushFunc)
+
+#define FAST_PUTFIELD(fieldType, popFunc) \
+    auto entry = RESOLVED_ENTRY(); \
+    pc += 2; \
+    PUTFIELD_AT(entry, fieldType, popFunc)
@@ -0,0 +1,82 @@
+//
+// Superinstructions fused from hot instruction sequences
+//
+
+#include <kivm/bytecode/superinstructions.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <sstream>
+
+namespace kivm {
+    static const Superinstructions::Superinstruction SUPERINSTRUCTIONS[] = {
+        {"aload_0_getfield",      OPC_ALOAD_0_GETFIELD,      2, {OPC_ALOAD_0, OPC_GETFIELD}},
+        {"iload_iload_if_icmpge", OPC_ILOAD_ILOAD_IF_ICMPGE, 3, {OPC_ILOAD, OPC_ILOAD, OPC_IF_ICMPGE}},
+        {"iload_iinc_goto",       OPC_ILOAD_IINC_GOTO,       3, {OPC_ILOAD, OPC_IINC, OPC_GOTO}},
+        {"aload_iload_iaload",    OPC_ALOAD_ILOAD_IALOAD,    3, {OPC_ALOAD, OPC_ILOAD, OPC_IALOAD}},
+    };
+
+    static const int SUPERINSTRUCTION_COUNT = sizeof(SUPERINSTRUCTIONS) / sizeof(SUPERINSTRUCTIONS[0]);
+
+    const Superinstructions::Superinstruction *Superinstructions::getAll(int *count) {
+        *count = SUPERINSTRUCTION_COUNT;
+        return SUPERINSTRUCTIONS;
+    }
+
+    bool Superinstructions::parse(const std::string &names, u4 *set) {
+        if (names == "all") {
+            *set = (1U << SUPERINSTRUCTION_COUNT) - 1;
+            return true;
+        }
+
+        u4 parsed = 0;
+        if (names != "none") {
+            std::stringstream ss(names);
+            std::string name;
+            while (std::getline(ss, name, ',')) {
+                int i = 0;
+                while (i < SUPERINSTRUCTION_COUNT && name != SUPERINSTRUCTIONS[i]._name) {
+                    ++i;
+                }
+                if (i == SUPERINSTRUCTION_COUNT) {
+                    return false;
+                }
+                parsed |= 1U << i;
+            }
+        }
+        *set = parsed;
+        return true;
+    }
+
+    static bool matches(const CodeBlob &code, int bci,
+                        const Superinstructions::Superinstruction &superinstruction) {
+        int size = code.getSize();
+        for (int i = 0; i < superinstruction._length; ++i) {
+            if (bci >= size || code[bci] != superinstruction._sequence[i]) {
+                return false;
+            }
+            bci += OopMap::getInstructionLength(code, bci);
+        }
+        // the last instruction must fit in the code
+        return bci <= size;
+    }
+
+    void Superinstructions::fuse(const CodeBlob &code, CodeBlob &rewritten) {
+        u4 enabled = RuntimeConfig::get().superinstructions;
+        if (enabled == 0) {
+            return;
+        }
+
+        int size = code.getSize();
+        int bci = 0;
+        while (bci < size) {
+            for (int i = 0; i < SUPERINSTRUCTION_COUNT; ++i) {
+                if ((enabled & (1U << i)) != 0 && matches(code, bci, SUPERINSTRUCTIONS[i])) {
+                    rewritten.rewrite(bci, SUPERINSTRUCTIONS[i]._opcode);
+                    break;
+                }
+            }
+            bci += OopMap::getInstructionLength(code, bci);
+        }
+    }
+}
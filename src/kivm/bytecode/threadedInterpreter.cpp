@@ -8,6 +8,9 @@
 
 #include <kivm/bytecode/bytecodes.h>
 #include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/quickener.h>
+#include <kivm/bytecode/bytecodeProfile.h>
+#include <kivm/bytecode/tosCachedStack.h>
 #include <kivm/oop/instanceOop.h>
 #include <kivm/oop/arrayOop.h>
 #include <kivm/oop/primitiveOop.h>
@@ -38,6 +41,7 @@
 
 namespace kivm {
     void *ThreadedInterpreter::_jumpTable[OPC_NUM_OPCODES] = {nullptr};
+    void *ThreadedInterpreter::_profilingJumpTable[OPC_NUM_OPCODES] = {nullptr};
 
     void ThreadedInterpreter::initialize() {
         static u4 emptyPc;
@@ -55,7 +59,7 @@ namespace kivm {
         Frame *currentFrame = thread->getCurrentFrame();
         auto currentMethod = currentFrame->getMethod();
         auto currentClass = currentMethod->getClass();
-        const CodeBlob &codeBlob = currentMethod->getCodeBlob();
+        CodeBlob &codeBlob = currentMethod->getRewrittenCode();
         u4 &pc = thread->_pc;
         Stack &stack = currentFrame->getStack();
         Locals &locals = currentFrame->getLocals();
@@ -67,7 +71,11 @@ namespace kivm {
 
         thread->enterSafepointIfNeeded();
 
-        return threaded(thread, ThreadedInterpreter::_jumpTable,
+        void **jump = BytecodeProfile::isEnabled()
+                      ? ThreadedInterpreter::_profilingJumpTable
+                      : ThreadedInterpreter::_jumpTable;
+
+        return threaded(thread, jump,
             currentFrame, currentMethod, currentClass,
             codeBlob, pc, stack, locals);
     }
@@ -76,10 +84,16 @@ namespace kivm {
                                       Frame *currentFrame,
                                       Method *currentMethod,
                                       InstanceKlass *currentClass,
-                                      const CodeBlob &codeBlob,
+                                      CodeBlob &codeBlob,
                                       u4 &pc,
-                                      Stack &stack,
+                                      Stack &frameStack,
                                       Locals &locals) {
+        TosCachedStack stack(frameStack);
+        BytecodeProfile::Cursor cursor;
+        RuntimeConstantPool *rt = currentClass != nullptr
+                                  ? currentClass->getRuntimeConstantPool()
+                                  : nullptr;
+
         if (thread != nullptr && jump[0] != nullptr) {
             NEXT();
         }
@@ -286,8 +300,41 @@ namespace kivm {
         jump[OPC_IFNONNULL] = &&OPCODE_LABEL(IFNONNULL);
         jump[OPC_GOTO_W] = &&OPCODE_LABEL(GOTO_W);
         jump[OPC_JSR_W] = &&OPCODE_LABEL(JSR_W);
+        jump[OPC_FAST_AGETFIELD] = &&OPCODE_LABEL(FAST_AGETFIELD);
+        jump[OPC_FAST_IGETFIELD] = &&OPCODE_LABEL(FAST_IGETFIELD);
+        jump[OPC_FAST_LGETFIELD] = &&OPCODE_LABEL(FAST_LGETFIELD);
+        jump[OPC_FAST_FGETFIELD] = &&OPCODE_LABEL(FAST_FGETFIELD);
+        jump[OPC_FAST_DGETFIELD] = &&OPCODE_LABEL(FAST_DGETFIELD);
+        jump[OPC_FAST_APUTFIELD] = &&OPCODE_LABEL(FAST_APUTFIELD);
+        jump[OPC_FAST_IPUTFIELD] = &&OPCODE_LABEL(FAST_IPUTFIELD);
+        jump[OPC_FAST_LPUTFIELD] = &&OPCODE_LABEL(FAST_LPUTFIELD);
+        jump[OPC_FAST_FPUTFIELD] = &&OPCODE_LABEL(FAST_FPUTFIELD);
+        jump[OPC_FAST_DPUTFIELD] = &&OPCODE_LABEL(FAST_DPUTFIELD);
+        jump[OPC_FAST_GETSTATIC] = &&OPCODE_LABEL(FAST_GETSTATIC);
+        jump[OPC_FAST_PUTSTATIC] = &&OPCODE_LABEL(FAST_PUTSTATIC);
+        jump[OPC_FAST_NEW] = &&OPCODE_LABEL(FAST_NEW);
+        jump[OPC_FAST_INVOKEVIRTUAL] = &&OPCODE_LABEL(FAST_INVOKEVIRTUAL);
+        jump[OPC_FAST_INVOKEDIRECT] = &&OPCODE_LABEL(FAST_INVOKEDIRECT);
+        jump[OPC_FAST_LDC] = &&OPCODE_LABEL(FAST_LDC);
+        jump[OPC_FAST_LDC_W] = &&OPCODE_LABEL(FAST_LDC_W);
+        jump[OPC_FAST_ALDC] = &&OPCODE_LABEL(FAST_ALDC);
+        jump[OPC_FAST_ALDC_W] = &&OPCODE_LABEL(FAST_ALDC_W);
+        jump[OPC_ALOAD_0_GETFIELD] = &&OPCODE_LABEL(ALOAD_0_GETFIELD);
+        jump[OPC_ILOAD_ILOAD_IF_ICMPGE] = &&OPCODE_LABEL(ILOAD_ILOAD_IF_ICMPGE);
+        jump[OPC_ILOAD_IINC_GOTO] = &&OPCODE_LABEL(ILOAD_IINC_GOTO);
+        jump[OPC_ALOAD_ILOAD_IALOAD] = &&OPCODE_LABEL(ALOAD_ILOAD_IALOAD);
+
+        for (auto &entry : _profilingJumpTable) {
+            entry = &&label_profile;
+        }
         return nullptr;
 
+        // every instruction comes here first when profiling, and runs
+        // as it is in the class file, neither quickened nor fused
+        label_profile:
+        BytecodeProfile::record(currentMethod, pc - 1, cursor);
+        goto *_jumpTable[currentMethod->getCodeBlob()[pc - 1]];
+
 #include "instruction.cpp-inc"
 
         return nullptr;
@@ -1,11 +1,138 @@
 //
 // Created by kiva on 2019-06-28.
 //
-
+#include <compileTimeConfig.h>
 #include <kivm/bytecode2/interpreterMacroAssembler.h>
 
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
+#include <kivm/bytecode2/templateInterpreter.h>
+#include <kivm/memory/gcThread.h>
+#include <cstddef>
+
 namespace kivm {
+    void InterpreterMacroAssembler::pushI(Register r) {
+        movl(Address(rstack), r);
+        addq(rstack, sizeof(Slot));
+    }
+
+    void InterpreterMacroAssembler::popI(Register r) {
+        subq(rstack, sizeof(Slot));
+        movl(r, Address(rstack));
+    }
+
+    void InterpreterMacroAssembler::pushL(Register r) {
+        storeLong(Address(rstack), r);
+        addq(rstack, 2 * sizeof(Slot));
+    }
+
+    void InterpreterMacroAssembler::popL(Register r) {
+        subq(rstack, 2 * sizeof(Slot));
+        loadLong(r, Address(rstack));
+    }
+
+    void InterpreterMacroAssembler::pushPtr(Register r) {
+        movq(Address(rstack), r);
+        addq(rstack, sizeof(Slot));
+    }
+
+    void InterpreterMacroAssembler::popPtr(Register r) {
+        subq(rstack, sizeof(Slot));
+        movq(r, Address(rstack));
+    }
+
+    void InterpreterMacroAssembler::push(TosState state) {
+        switch (state) {
+            case btos:
+            case ztos:
+            case ctos:
+            case stos:
+            case itos:
+            case ftos:
+                pushI();
+                break;
+            case ltos:
+            case dtos:
+                pushL();
+                break;
+            case atos:
+                pushPtr();
+                break;
+            case vtos:
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    void InterpreterMacroAssembler::pop(TosState state) {
+        switch (state) {
+            case btos:
+            case ztos:
+            case ctos:
+            case stos:
+            case itos:
+            case ftos:
+                popI();
+                break;
+            case ltos:
+            case dtos:
+                popL();
+                break;
+            case atos:
+                popPtr();
+                break;
+            case vtos:
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    void InterpreterMacroAssembler::loadLong(Register dst, const Address &slot) {
+        movl(dst, slot);
+        shlq(dst, 32);
+        movl(r11, slot.plusDisp(sizeof(Slot)));
+        orq(dst, r11);
+    }
+
+    void InterpreterMacroAssembler::storeLong(const Address &slot, Register src) {
+        movl(slot.plusDisp(sizeof(Slot)), src);
+        movq(r11, src);
+        shrq(r11, 32);
+        movl(slot, r11);
+    }
+
+    void InterpreterMacroAssembler::dispatchNext(TosState state, int step) {
+        movzbl(r11, Address(rbcp, step));
+        if (step != 0) {
+            addq(rbcp, step);
+        }
+        jmp(Address(rdispatch, r11, Address::times8, state * OPC_NUM_OPCODES * sizeof(address)));
+    }
+
+    void InterpreterMacroAssembler::callVM(address entry) {
+        movq(Address(rstate, offsetof(InterpreterState, _bcp)), rbcp);
+        movq(Address(rstate, offsetof(InterpreterState, _sp)), rstack);
+        movq(rdi, rstate);
+        mov64(r11, (jlong) entry);
+        call(r11);
+        movq(rbcp, Address(rstate, offsetof(InterpreterState, _bcp)));
+        movq(rstack, Address(rstate, offsetof(InterpreterState, _sp)));
+        testl(rax, rax);
+        jcc(notEqual, _exceptionExit);
+    }
+
+    void InterpreterMacroAssembler::testSafepointPoll() {
+        mov64(r11, (jlong) GCThread::getSafepointPollAddress());
+        cmpb(Address(r11), 0);
+    }
+
     void InterpreterMacroAssembler::flush() {
-        // TODO
+        auto end = pc();
+        __builtin___clear_cache((char *) _flushed, (char *) end);
+        _flushed = end;
     }
-}
\ No newline at end of file
+}
+
+#endif
@@ -1,7 +1,11 @@
 //
 // Created by kiva on 2019-06-28.
 //
+#include <compileTimeConfig.h>
 #include <kivm/bytecode2/template.h>
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
 #include <kivm/bytecode2/templateTable.h>
 
 namespace kivm {
@@ -14,9 +18,7 @@ namespace kivm {
     }
 
     Bytecodes::Code Template::getBytecode() const {
-        int i = this - TemplateTable::_templateTable;
-        if (i < 0 || i >= Bytecodes::number_of_codes) i = this - TemplateTable::_templateTableWide;
-        return static_cast<Bytecodes::Code>(i);
+        return static_cast<Bytecodes::Code>(this - TemplateTable::_templateTable);
     }
 
     void Template::generate(InterpreterMacroAssembler *masm) {
@@ -25,6 +27,12 @@ namespace kivm {
         TemplateTable::_masm = masm;
         // code generation
         _gen(_arg);
+        // templates that do not dispatch themselves continue with the next bytecode
+        if (!doesDispatch()) {
+            masm->dispatchNext(_tosOut, Bytecodes::lengthFor(getBytecode()));
+        }
         masm->flush();
     }
 }
+
+#endif
@@ -0,0 +1,665 @@
+//
+// Template interpreter for x86_64
+//
+
+#include <kivm/bytecode2/templateInterpreter.h>
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
+#include <kivm/asm/assembler.h>
+#include <kivm/bytecode/interpreter.h>
+#include <kivm/bytecode/bytecodeProfile.h>
+#include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/quickener.h>
+#include <kivm/bytecode/tosCachedStack.h>
+#include <kivm/bytecode2/bytecodes.h>
+#include <kivm/bytecode2/interpreterMacroAssembler.h>
+#include <kivm/bytecode2/templateTable.h>
+#include <kivm/classpath/classLoader.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/memory/universe.h>
+#include <kivm/oop/instanceOop.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/oop/primitiveOop.h>
+#include <kivm/oop/method.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <climits>
+#include <cstddef>
+#include <deque>
+
+#include "../bytecode/sharedInterpreter.h"
+
+#undef HANDLE_EXCEPTION
+#define HANDLE_EXCEPTION() \
+    return leaveVM(state, stack.flush(), true)
+
+#define NEXT(length) \
+    state->_bcp += (length); \
+    return leaveVM(state, stack.flush(), false)
+
+// Rewrites the instruction unless another interpreter quickened it already.
+#define QUICKEN(quickenFunc, constantIndex) \
+    if (quickened == *bcp) { \
+        Quickener::quickenFunc(rt, rewrittenCode, bci, constantIndex); \
+    }
+
+namespace kivm {
+    CodeBuffer *TemplateInterpreter::_code = nullptr;
+    TemplateInterpreter::EntryPoint TemplateInterpreter::_entry = nullptr;
+    address TemplateInterpreter::_dispatchTable[number_of_states][OPC_NUM_OPCODES];
+
+    static inline int readU2(const u1 *bcp) {
+        return bcp[0] << 8 | bcp[1];
+    }
+
+    static inline int readS4(const u1 *bcp) {
+        return (int) ((u4) bcp[0] << 24 | (u4) bcp[1] << 16 | (u4) bcp[2] << 8 | (u4) bcp[3]);
+    }
+
+    /**
+     * States whose value lives in the same register,
+     * moving between them needs no code.
+     */
+    static inline int tosRegister(TosState state) {
+        switch (state) {
+            case ltos:
+            case dtos:
+                return ltos;
+            case atos:
+            case vtos:
+                return state;
+            default:
+                return itos;
+        }
+    }
+
+    void TemplateInterpreter::initialize() {
+        CppInterpreter::initialize();
+        TemplateTable::initialize();
+        generate();
+    }
+
+    void TemplateInterpreter::generate() {
+        _code = new CodeBuffer(SIZE_KB(256));
+        InterpreterMacroAssembler masm(_code);
+
+        generateExits(&masm);
+        generateVMBytecodes(&masm);
+        generateTemplates(&masm);
+        generateEntry(&masm);
+
+        masm.flush();
+        _code->makeExecutable();
+        D("template interpreter: %zu bytes of code", _code->getSize());
+    }
+
+    void TemplateInterpreter::generateEntry(InterpreterMacroAssembler *masm) {
+        auto entry = (EntryPoint) masm->pc();
+
+        // int entry(InterpreterState *state), keeping the stack 16-byte aligned
+        masm->pushq(rbp);
+        masm->movq(rbp, rsp);
+        masm->pushq(rbx);
+        masm->pushq(r12);
+        masm->pushq(r13);
+        masm->pushq(r14);
+        masm->pushq(r15);
+        masm->subq(rsp, 8);
+
+        masm->movq(rstate, rdi);
+        masm->movq(rlocals, Address(rstate, offsetof(InterpreterState, _locals)));
+        masm->movq(rstack, Address(rstate, offsetof(InterpreterState, _sp)));
+        masm->movq(rbcp, Address(rstate, offsetof(InterpreterState, _bcp)));
+        masm->mov64(rdispatch, (jlong) _dispatchTable);
+        masm->dispatchNext(vtos, 0);
+
+        _entry = entry;
+    }
+
+    void TemplateInterpreter::generateExits(InterpreterMacroAssembler *masm) {
+        masm->bind(masm->leave());
+        masm->movq(Address(rstate, offsetof(InterpreterState, _bcp)), rbcp);
+        masm->movq(Address(rstate, offsetof(InterpreterState, _sp)), rstack);
+        masm->addq(rsp, 8);
+        masm->popq(r15);
+        masm->popq(r14);
+        masm->popq(r13);
+        masm->popq(r12);
+        masm->popq(rbx);
+        masm->popq(rbp);
+        masm->ret();
+
+        masm->bind(masm->exceptionExit());
+        masm->movl(rax, EXIT_EXCEPTION);
+        masm->jmp(masm->leave());
+    }
+
+    void TemplateInterpreter::generateVMBytecodes(InterpreterMacroAssembler *masm) {
+        for (TosState state : {itos, ltos, ftos, dtos, atos, vtos}) {
+            masm->bind(masm->vmBytecode(state));
+            masm->push(state);
+            masm->callVM((address) runtimeBytecode);
+            masm->dispatchNext(vtos, 0);
+        }
+    }
+
+    void TemplateInterpreter::generateTemplates(InterpreterMacroAssembler *masm) {
+        address illegal = masm->pc();
+        masm->callVM((address) illegalBytecode);
+
+        for (auto &row : _dispatchTable) {
+            for (auto &entry : row) {
+                entry = illegal;
+            }
+        }
+
+        for (int code = 0; code < Bytecodes::number_of_java_codes; ++code) {
+            Template *t = TemplateTable::templateFor((Bytecodes::Code) code);
+            if (!t->isValid()) {
+                continue;
+            }
+
+            // entries for other states move the top of stack to where the template wants it
+            Label body;
+            address entries[number_of_states] = {nullptr};
+            for (TosState state : {itos, ltos, ftos, dtos, atos, vtos}) {
+                if (tosRegister(state) == tosRegister(t->tosIn())) {
+                    continue;
+                }
+                entries[state] = masm->pc();
+                masm->push(state);
+                masm->pop(t->tosIn());
+                masm->jmp(body);
+            }
+
+            masm->bind(body);
+            address bodyEntry = masm->pc();
+            t->generate(masm);
+
+            for (TosState state : {itos, ltos, ftos, dtos, atos, vtos}) {
+                _dispatchTable[state][code] = entries[state] != nullptr ? entries[state] : bodyEntry;
+            }
+            for (TosState state : {btos, ztos, ctos, stos}) {
+                _dispatchTable[state][code] = _dispatchTable[itos][code];
+            }
+        }
+    }
+
+    Stack &TemplateInterpreter::enterVM(InterpreterState *state) {
+        Stack &stack = state->_frame->getStack();
+        stack._sp = (int) (state->_sp - stack._array._elements);
+        state->_thread->_pc = (u4) (state->_bcp - state->_code + 1);
+        return stack;
+    }
+
+    int TemplateInterpreter::leaveVM(InterpreterState *state, Stack &stack, bool exceptionPending) {
+        state->_sp = stack._array._elements + stack._sp;
+        return exceptionPending ? 1 : 0;
+    }
+
+    int TemplateInterpreter::safepoint(InterpreterState *state) {
+        Stack &stack = enterVM(state);
+        state->_thread->enterSafepoint();
+        return leaveVM(state, stack, false);
+    }
+
+    int TemplateInterpreter::illegalBytecode(InterpreterState *state) {
+        PANIC("Use of undefined bytecode: %d at %d",
+            *state->_bcp, (int) (state->_bcp - state->_code));
+        return 1;
+    }
+
+    int TemplateInterpreter::runtimeBytecode(InterpreterState *state) {
+        TosCachedStack stack(enterVM(state));
+        JavaThread *thread = state->_thread;
+        Frame *currentFrame = state->_frame;
+        RuntimeConstantPool *rt = state->_rt;
+        CodeBlob &rewrittenCode = state->_method->getRewrittenCode();
+        const u1 *bcp = state->_bcp;
+        int bci = (int) (bcp - state->_code);
+
+        // quickened instructions keep the constant index of the original ones
+        u1 quickened = rewrittenCode[bci];
+
+        switch (*bcp) {
+            case OPC_LDC:
+            case OPC_LDC_W: {
+                bool wide = *bcp == OPC_LDC_W;
+                int constantIndex = wide ? readU2(bcp + 1) : bcp[1];
+                if (quickened == OPC_FAST_LDC || quickened == OPC_FAST_LDC_W) {
+                    stack.pushInt(rt->getResolved<jint>(constantIndex));
+                } else if (quickened == OPC_FAST_ALDC || quickened == OPC_FAST_ALDC_W) {
+                    stack.pushReference(rt->getResolved<jobject>(constantIndex));
+                } else {
+                    LOAD_CONSTANT_OP(constantIndex);
+                    QUICKEN(quickenLoadConstant, constantIndex);
+                }
+                NEXT(wide ? 3 : 2);
+            }
+            case OPC_LDC2_W: {
+                LOAD_CONSTANT_OP(readU2(bcp + 1));
+                NEXT(3);
+            }
+
+            // templates come here when the array is null or the index is out of bounds
+            case OPC_IALOAD: {
+                LOAD_ARRAY_ELEMENT(jint, typeArray, pushInt);
+                NEXT(1);
+            }
+            case OPC_LALOAD: {
+                LOAD_ARRAY_ELEMENT(jlong, typeArray, pushLong);
+                NEXT(1);
+            }
+            case OPC_FALOAD: {
+                LOAD_ARRAY_ELEMENT(jfloat, typeArray, pushFloat);
+                NEXT(1);
+            }
+            case OPC_DALOAD: {
+                LOAD_ARRAY_ELEMENT(jdouble, typeArray, pushDouble);
+                NEXT(1);
+            }
+            case OPC_AALOAD: {
+                LOAD_ARRAY_ELEMENT(oop, objectArray, pushReference);
+                NEXT(1);
+            }
+            case OPC_BALOAD: {
+                LOAD_ARRAY_ELEMENT(jbyte, typeArray, pushInt);
+                NEXT(1);
+            }
+            case OPC_CALOAD: {
+                LOAD_ARRAY_ELEMENT(jchar, typeArray, pushInt);
+                NEXT(1);
+            }
+            case OPC_SALOAD: {
+                LOAD_ARRAY_ELEMENT(jshort, typeArray, pushInt);
+                NEXT(1);
+            }
+            case OPC_IASTORE: {
+                STORE_ARRAY_ELEMENT(jint, value, typeArray, popInt, value);
+                NEXT(1);
+            }
+            case OPC_LASTORE: {
+                STORE_ARRAY_ELEMENT(jlong, value, typeArray, popLong, value);
+                NEXT(1);
+            }
+            case OPC_FASTORE: {
+                STORE_ARRAY_ELEMENT(jfloat, value, typeArray, popFloat, value);
+                NEXT(1);
+            }
+            case OPC_DASTORE: {
+                STORE_ARRAY_ELEMENT(jdouble, value, typeArray, popDouble, value);
+                NEXT(1);
+            }
+            case OPC_AASTORE: {
+                STORE_ARRAY_ELEMENT(oop, value, objectArray, popReference, Resolver::javaOop(value));
+                Universe::writeBarrier(array->getElementAddress<oop>(index));
+                NEXT(1);
+            }
+            case OPC_BASTORE: {
+                // boolean[] only keeps the lowest bit
+                STORE_ARRAY_ELEMENT(jbyte, value, typeArray, popInt,
+                    ((TypeArrayKlass *) array->getClass())->getComponentType() == ValueType::BOOLEAN
+                    ? (value & 1) : value);
+                NEXT(1);
+            }
+            case OPC_CASTORE: {
+                STORE_ARRAY_ELEMENT(jchar, value, typeArray, popInt, value);
+                NEXT(1);
+            }
+            case OPC_SASTORE: {
+                STORE_ARRAY_ELEMENT(jshort, value, typeArray, popInt, value);
+                NEXT(1);
+            }
+            case OPC_ARRAYLENGTH: {
+                ARRAYLENGTH_OP();
+                NEXT(1);
+            }
+
+            // templates come here for a zero divisor only
+            case OPC_IDIV: {
+                DIVIDE_OP(popInt, pushInt);
+                NEXT(1);
+            }
+            case OPC_IREM: {
+                REMAINDER_OP(popInt, pushInt);
+                NEXT(1);
+            }
+            case OPC_LDIV: {
+                DIVIDE_OP(popLong, pushLong);
+                NEXT(1);
+            }
+            case OPC_LREM: {
+                REMAINDER_OP(popLong, pushLong);
+                NEXT(1);
+            }
+            case OPC_FDIV: {
+                DIVIDE_OP(popFloat, pushFloat);
+                NEXT(1);
+            }
+            case OPC_DDIV: {
+                DIVIDE_OP(popDouble, pushDouble);
+                NEXT(1);
+            }
+            case OPC_FREM:
+                PANIC("Use of deprecated instruction frem, please check your Java compiler");
+                break;
+            case OPC_DREM:
+                PANIC("Use of deprecated instruction drem, please check your Java compiler");
+                break;
+            case OPC_FNEG:
+                PANIC("Use of deprecated instruction fneg, please check your Java compiler");
+                break;
+            case OPC_DNEG:
+                PANIC("Use of deprecated instruction dneg, please check your Java compiler");
+                break;
+
+            case OPC_F2I: {
+                CONVERT_FLOATING(popFloat, pushInt, jint, FLOAT, INT_MAX, INT_MIN);
+                NEXT(1);
+            }
+            case OPC_F2L: {
+                CONVERT_FLOATING(popFloat, pushLong, jlong, FLOAT, LONG_MAX, LONG_MIN);
+                NEXT(1);
+            }
+            case OPC_D2I: {
+                CONVERT_FLOATING(popDouble, pushInt, jint, DOUBLE, INT_MAX, INT_MIN);
+                NEXT(1);
+            }
+            case OPC_D2L: {
+                CONVERT_FLOATING(popDouble, pushLong, jlong, DOUBLE, LONG_MAX, LONG_MIN);
+                NEXT(1);
+            }
+            case OPC_FCMPL:
+            case OPC_FCMPG: {
+                COMPARE_FLOATING_OP(popFloat, FLOAT, *bcp == OPC_FCMPL ? -1 : 1);
+                NEXT(1);
+            }
+            case OPC_DCMPL:
+            case OPC_DCMPG: {
+                COMPARE_FLOATING_OP(popDouble, DOUBLE, *bcp == OPC_DCMPL ? -1 : 1);
+                NEXT(1);
+            }
+
+            case OPC_TABLESWITCH:
+            case OPC_LOOKUPSWITCH: {
+                // operands start at the next multiple of 4 from the method start
+                const u1 *ptr = state->_code + ((bci + 4) & ~3);
+                int key = stack.popInt();
+                int offset = readS4(ptr);
+                if (*bcp == OPC_TABLESWITCH) {
+                    int low = readS4(ptr + 4);
+                    int high = readS4(ptr + 8);
+                    if (key >= low && key <= high) {
+                        offset = readS4(ptr + 12 + 4 * (key - low));
+                    }
+                } else {
+                    int count = readS4(ptr + 4);
+                    for (int i = 0; i < count; ++i) {
+                        if (readS4(ptr + 8 + 8 * i) == key) {
+                            offset = readS4(ptr + 12 + 8 * i);
+                            break;
+                        }
+                    }
+                }
+                if (offset <= 0) {
+                    SAFEPOINT_POLL();
+                }
+                NEXT(offset);
+            }
+
+            case OPC_GETSTATIC: {
+                int constantIndex = readU2(bcp + 1);
+                if (quickened == OPC_FAST_GETSTATIC) {
+                    Execution::getStatic(rt->getResolvedEntry(constantIndex), stack.flush());
+                    NEXT(3);
+                }
+                GETSTATIC_OP(constantIndex);
+                QUICKEN(quickenField, constantIndex);
+                NEXT(3);
+            }
+            case OPC_PUTSTATIC: {
+                int constantIndex = readU2(bcp + 1);
+                if (quickened == OPC_FAST_PUTSTATIC) {
+                    Execution::putStatic(rt->getResolvedEntry(constantIndex), stack.flush());
+                    NEXT(3);
+                }
+                PUTSTATIC_OP(constantIndex);
+                QUICKEN(quickenField, constantIndex);
+                NEXT(3);
+            }
+            case OPC_GETFIELD: {
+                int constantIndex = readU2(bcp + 1);
+                auto entry = rt->getResolvedEntry(constantIndex);
+                switch (quickened) {
+                    case OPC_FAST_AGETFIELD: {
+                        GETFIELD_AT(entry, oop, pushReference);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_IGETFIELD: {
+                        GETFIELD_AT(entry, jint, pushInt);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_LGETFIELD: {
+                        GETFIELD_AT(entry, jlong, pushLong);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_FGETFIELD: {
+                        GETFIELD_AT(entry, jfloat, pushFloat);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_DGETFIELD: {
+                        GETFIELD_AT(entry, jdouble, pushDouble);
+                        NEXT(3);
+                    }
+                    default:
+                        break;
+                }
+                GETFIELD_OP(constantIndex);
+                QUICKEN(quickenField, constantIndex);
+                NEXT(3);
+            }
+            case OPC_PUTFIELD: {
+                int constantIndex = readU2(bcp + 1);
+                auto entry = rt->getResolvedEntry(constantIndex);
+                switch (quickened) {
+                    case OPC_FAST_APUTFIELD: {
+                        PUTFIELD_AT(entry, oop, popReference);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_IPUTFIELD: {
+                        PUTFIELD_AT(entry, jint, popInt);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_LPUTFIELD: {
+                        PUTFIELD_AT(entry, jlong, popLong);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_FPUTFIELD: {
+                        PUTFIELD_AT(entry, jfloat, popFloat);
+                        NEXT(3);
+                    }
+                    case OPC_FAST_DPUTFIELD: {
+                        PUTFIELD_AT(entry, jdouble, popDouble);
+                        NEXT(3);
+                    }
+                    default:
+                        break;
+                }
+                PUTFIELD_OP(constantIndex);
+                QUICKEN(quickenField, constantIndex);
+                NEXT(3);
+            }
+
+            case OPC_INVOKEVIRTUAL:
+            case OPC_INVOKESPECIAL:
+            case OPC_INVOKESTATIC: {
+                int constantIndex = readU2(bcp + 1);
+                if (quickened == OPC_FAST_INVOKEVIRTUAL) {
+                    INVOKE_OP(invokeVirtual, rt->getResolvedEntry(constantIndex));
+                    NEXT(3);
+                }
+                if (quickened == OPC_FAST_INVOKEDIRECT) {
+                    INVOKE_OP(invokeDirect, rt->getResolvedEntry(constantIndex));
+                    NEXT(3);
+                }
+                if (*bcp == OPC_INVOKEVIRTUAL) {
+                    INVOKE_OP(invokeVirtual, rt, constantIndex);
+                } else if (*bcp == OPC_INVOKESPECIAL) {
+                    INVOKE_OP(invokeSpecial, rt, constantIndex);
+                } else {
+                    INVOKE_OP(invokeStatic, rt, constantIndex);
+                }
+                QUICKEN(quickenInvoke, constantIndex);
+                NEXT(3);
+            }
+            case OPC_INVOKEINTERFACE: {
+                INVOKE_OP(invokeInterface, rt, readU2(bcp + 1), bcp[3]);
+                NEXT(5);
+            }
+            case OPC_INVOKEDYNAMIC: {
+                INVOKE_OP(invokeDynamic, state->_method->getClass(), readU2(bcp + 1));
+                NEXT(5);
+            }
+
+            case OPC_NEW: {
+                int constantIndex = readU2(bcp + 1);
+                if (quickened == OPC_FAST_NEW) {
+                    NEW_OP(rt->getResolvedEntry(constantIndex)->_klass, bci);
+                    NEXT(3);
+                }
+                NEW_OP(rt, constantIndex, bci);
+                QUICKEN(quickenNew, constantIndex);
+                NEXT(3);
+            }
+            case OPC_NEWARRAY: {
+                NEWARRAY_OP(bcp[1]);
+                NEXT(2);
+            }
+            case OPC_ANEWARRAY: {
+                ANEWARRAY_OP(readU2(bcp + 1));
+                NEXT(3);
+            }
+            case OPC_MULTIANEWARRAY: {
+                MULTIANEWARRAY_OP(readU2(bcp + 1), bcp[3]);
+                NEXT(4);
+            }
+
+            case OPC_ATHROW: {
+                auto exceptionOop = Resolver::instance(stack.popReference());
+                if (exceptionOop == nullptr) {
+                    THROW_NULL_POINTER();
+                }
+                thread->_exceptionOop = exceptionOop;
+                HANDLE_EXCEPTION();
+            }
+            case OPC_CHECKCAST: {
+                INSTANCEOF_OP(readU2(bcp + 1), true);
+                NEXT(3);
+            }
+            case OPC_INSTANCEOF: {
+                INSTANCEOF_OP(readU2(bcp + 1), false);
+                NEXT(3);
+            }
+            case OPC_MONITORENTER: {
+                MONITOR_OP(monitorEnter);
+                NEXT(1);
+            }
+            case OPC_MONITOREXIT: {
+                MONITOR_OP(monitorExit);
+                NEXT(1);
+            }
+
+            case OPC_JSR:
+                PANIC("Use of deprecated instruction jsr, please check your Java compiler");
+                break;
+            case OPC_RET:
+                PANIC("Use of deprecated instruction ret, please check your Java compiler");
+                break;
+            case OPC_WIDE:
+                PANIC("Use of deprecated instruction wide, please check your Java compiler");
+                break;
+            case OPC_GOTO_W:
+                PANIC("Use of deprecated instruction goto_w, please check your Java compiler");
+                break;
+            case OPC_JSR_W:
+                PANIC("Use of deprecated instruction jsr_w, please check your Java compiler");
+                break;
+
+            default:
+                PANIC("Use of undefined bytecode: %d at %d", *bcp, bci);
+                break;
+        }
+
+        SHOULD_NOT_REACH_HERE();
+        return leaveVM(state, stack.flush(), true);
+    }
+
+    oop TemplateInterpreter::interp(JavaThread *thread) {
+        // profiles count the bytecodes
+        if (_entry == nullptr
+            || !RuntimeConfig::get().useTemplateInterpreter
+            || BytecodeProfile::isEnabled()) {
+            return CppInterpreter::interp(thread);
+        }
+
+        Frame *currentFrame = thread->getCurrentFrame();
+        auto currentMethod = currentFrame->getMethod();
+        Stack &stack = currentFrame->getStack();
+        Locals &locals = currentFrame->getLocals();
+
+        D("currentMethod: %s.%s:%s",
+            strings::toStdString(currentMethod->getClass()->getName()).c_str(),
+            strings::toStdString(currentMethod->getName()).c_str(),
+            strings::toStdString(currentMethod->getDescriptor()).c_str());
+
+        InterpreterState state{};
+        state._locals = locals._array._elements;
+        state._sp = stack._array._elements + stack._sp;
+        state._code = currentMethod->getCodeBlob().getCode();
+        state._bcp = state._code;
+        state._thread = thread;
+        state._frame = currentFrame;
+        state._method = currentMethod;
+        state._rt = currentMethod->getClass()->getRuntimeConstantPool();
+
+        thread->enterSafepointIfNeeded();
+
+        for (;;) {
+            int exitCode = _entry(&state);
+            switch (exitCode) {
+                case itos:
+                case ltos:
+                case ftos:
+                case dtos:
+                    thread->_returnValue = state._result;
+                    return nullptr;
+                case atos:
+                    return Resolver::javaOop(state._result.l);
+                case vtos:
+                    // monitor released in invokeXXX
+                    return nullptr;
+                case EXIT_EXCEPTION:
+                    break;
+                default:
+                    SHOULD_NOT_REACH_HERE();
+            }
+
+            stack._sp = (int) (state._sp - stack._array._elements);
+            thread->_pc = (u4) (state._bcp - state._code + 1);
+            auto exceptionOop = thread->_exceptionOop;
+            int handler = thread->tryHandleException(exceptionOop);
+            if (handler <= 0) {
+                D("athrow: exception handler not found, rethrowing it to caller");
+                return exceptionOop;
+            }
+
+            D("athrow: exception handler found at offset: %d", handler);
+            stack.clear();
+            stack.pushReference(exceptionOop);
+            state._sp = stack._array._elements + stack._sp;
+            state._bcp = state._code + handler;
+        }
+    }
+}
+
+#endif
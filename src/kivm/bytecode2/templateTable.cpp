@@ -1,17 +1,981 @@
 //
 // Created by kiva on 2019-06-28.
 //
+#include <compileTimeConfig.h>
 #include <kivm/bytecode2/templateTable.h>
 
+#ifdef KIVM_TEMPLATE_INTERPRETER
+
+#include <kivm/bytecode2/templateInterpreter.h>
+#include <kivm/oop/arrayOop.h>
+#include <cstddef>
+
+#define __ _masm->
+
 namespace kivm {
     bool TemplateTable::_is_initialized = false;
     Template TemplateTable::_templateTable[Bytecodes::number_of_codes];
-    Template TemplateTable::_templateTableWide[Bytecodes::number_of_codes];
     Template *TemplateTable::_desc = nullptr;
     InterpreterMacroAssembler *TemplateTable::_masm = nullptr;
 
+    static inline Assembler::Condition j_not(TemplateTable::Condition cc) {
+        switch (cc) {
+            case TemplateTable::equal:
+                return Assembler::notEqual;
+            case TemplateTable::not_equal:
+                return Assembler::equal;
+            case TemplateTable::less:
+                return Assembler::greaterEqual;
+            case TemplateTable::less_equal:
+                return Assembler::greater;
+            case TemplateTable::greater:
+                return Assembler::lessEqual;
+            case TemplateTable::greater_equal:
+                return Assembler::less;
+        }
+        SHOULD_NOT_REACH_HERE();
+        return Assembler::equal;
+    }
+
+    Address TemplateTable::atBcp(int offset) {
+        return Address(rbcp, offset);
+    }
+
+    Address TemplateTable::atLocal(int n) {
+        return Address(rlocals, n * (int) sizeof(Slot));
+    }
+
+    void TemplateTable::nop() {
+    }
+
+    void TemplateTable::aconst_null() {
+        __ xorl(rax, rax);
+    }
+
+    void TemplateTable::iconst(int value) {
+        __ movl(rax, value);
+    }
+
+    void TemplateTable::lconst(int value) {
+        __ mov64(rax, value);
+    }
+
+    void TemplateTable::fconst(int value) {
+        union {
+            jfloat f;
+            jint i;
+        } bits{};
+        bits.f = (jfloat) value;
+        __ movl(rax, bits.i);
+    }
+
+    void TemplateTable::dconst(int value) {
+        union {
+            jdouble d;
+            jlong j;
+        } bits{};
+        bits.d = (jdouble) value;
+        __ mov64(rax, bits.j);
+    }
+
+    void TemplateTable::bipush() {
+        __ movsbl(rax, atBcp(1));
+    }
+
+    void TemplateTable::sipush() {
+        __ movzwl(rax, atBcp(1));
+        __ bswapl(rax);
+        __ sarl(rax, 16);
+    }
+
+    void TemplateTable::locals_index(Register reg, int offset) {
+        __ movzbl(reg, atBcp(offset));
+    }
+
+    void TemplateTable::iload() {
+        locals_index(rdx);
+        __ movl(rax, Address(rlocals, rdx, Address::times8));
+    }
+
+    void TemplateTable::lload() {
+        locals_index(rdx);
+        __ loadLong(rax, Address(rlocals, rdx, Address::times8));
+    }
+
+    void TemplateTable::fload() {
+        iload();
+    }
+
+    void TemplateTable::dload() {
+        lload();
+    }
+
+    void TemplateTable::aload() {
+        locals_index(rdx);
+        __ movq(rax, Address(rlocals, rdx, Address::times8));
+    }
+
+    void TemplateTable::iload(int n) {
+        __ movl(rax, atLocal(n));
+    }
+
+    void TemplateTable::lload(int n) {
+        __ loadLong(rax, atLocal(n));
+    }
+
+    void TemplateTable::fload(int n) {
+        iload(n);
+    }
+
+    void TemplateTable::dload(int n) {
+        lload(n);
+    }
+
+    void TemplateTable::aload(int n) {
+        __ movq(rax, atLocal(n));
+    }
+
+    void TemplateTable::index_check(Register array, Register index) {
+        // the array stays on the stack until it is known to be good
+        __ movq(array, Address(rstack, -(int) sizeof(Slot)));
+        __ testq(array, array);
+        __ jcc(Assembler::equal, __ vmBytecode(itos));
+        // negative indices are above every length
+        __ cmpl(index, Address(array, arrayOopDesc::getLengthOffset()));
+        __ jcc(Assembler::aboveEqual, __ vmBytecode(itos));
+        __ subq(rstack, sizeof(Slot));
+        __ movslq(index, index);
+    }
+
+    void TemplateTable::iaload() {
+        index_check(rdx, rax);
+        __ movl(rax, Address(rdx, rax, Address::times4, arrayOopDesc::HEADER_SIZE));
+    }
+
+    void TemplateTable::laload() {
+        index_check(rdx, rax);
+        __ movq(rax, Address(rdx, rax, Address::times8, arrayOopDesc::HEADER_SIZE));
+    }
+
+    void TemplateTable::faload() {
+        iaload();
+    }
+
+    void TemplateTable::daload() {
+        laload();
+    }
+
+    void TemplateTable::aaload() {
+        index_check(rdx, rax);
+        __ movq(rax, Address(rdx, rax, Address::times8, arrayOopDesc::HEADER_SIZE));
+    }
+
+    void TemplateTable::baload() {
+        index_check(rdx, rax);
+        __ movsbl(rax, Address(rdx, rax, Address::times1, arrayOopDesc::HEADER_SIZE));
+    }
+
+    void TemplateTable::caload() {
+        index_check(rdx, rax);
+        __ movzwl(rax, Address(rdx, rax, Address::times2, arrayOopDesc::HEADER_SIZE));
+    }
+
+    void TemplateTable::saload() {
+        index_check(rdx, rax);
+        __ movswl(rax, Address(rdx, rax, Address::times2, arrayOopDesc::HEADER_SIZE));
+    }
+
+    void TemplateTable::istore() {
+        locals_index(rdx);
+        __ movl(Address(rlocals, rdx, Address::times8), rax);
+    }
+
+    void TemplateTable::lstore() {
+        locals_index(rdx);
+        __ storeLong(Address(rlocals, rdx, Address::times8), rax);
+    }
+
+    void TemplateTable::fstore() {
+        istore();
+    }
+
+    void TemplateTable::dstore() {
+        lstore();
+    }
+
+    void TemplateTable::astore() {
+        locals_index(rdx);
+        __ movq(Address(rlocals, rdx, Address::times8), rax);
+    }
+
+    void TemplateTable::istore(int n) {
+        __ movl(atLocal(n), rax);
+    }
+
+    void TemplateTable::lstore(int n) {
+        __ storeLong(atLocal(n), rax);
+    }
+
+    void TemplateTable::fstore(int n) {
+        istore(n);
+    }
+
+    void TemplateTable::dstore(int n) {
+        lstore(n);
+    }
+
+    void TemplateTable::astore(int n) {
+        __ movq(atLocal(n), rax);
+    }
+
+    void TemplateTable::store_index_check(Register array, Register index) {
+        // the value is in rax, the index and the array stay on the stack
+        // until they are known to be good
+        TosState state = _desc->tosIn();
+        __ movl(index, Address(rstack, -(int) sizeof(Slot)));
+        __ movq(array, Address(rstack, -2 * (int) sizeof(Slot)));
+        __ testq(array, array);
+        __ jcc(Assembler::equal, __ vmBytecode(state));
+        __ cmpl(index, Address(array, arrayOopDesc::getLengthOffset()));
+        __ jcc(Assembler::aboveEqual, __ vmBytecode(state));
+        __ subq(rstack, 2 * sizeof(Slot));
+        __ movslq(index, index);
+    }
+
+    void TemplateTable::iastore() {
+        store_index_check(rdx, rcx);
+        __ movl(Address(rdx, rcx, Address::times4, arrayOopDesc::HEADER_SIZE), rax);
+    }
+
+    void TemplateTable::lastore() {
+        store_index_check(rdx, rcx);
+        __ movq(Address(rdx, rcx, Address::times8, arrayOopDesc::HEADER_SIZE), rax);
+    }
+
+    void TemplateTable::fastore() {
+        iastore();
+    }
+
+    void TemplateTable::dastore() {
+        lastore();
+    }
+
+    void TemplateTable::castore() {
+        store_index_check(rdx, rcx);
+        __ movw(Address(rdx, rcx, Address::times2, arrayOopDesc::HEADER_SIZE), rax);
+    }
+
+    void TemplateTable::sastore() {
+        castore();
+    }
+
+    void TemplateTable::arraylength() {
+        __ testq(rax, rax);
+        __ jcc(Assembler::equal, __ vmBytecode(atos));
+        __ movl(rax, Address(rax, arrayOopDesc::getLengthOffset()));
+    }
+
+    // stack operations move whole slots
+    static inline Address atStack(int n) {
+        return Address(rstack, -n * (int) sizeof(Slot));
+    }
+
+    void TemplateTable::pop() {
+        __ subq(rstack, sizeof(Slot));
+    }
+
+    void TemplateTable::pop2() {
+        __ subq(rstack, 2 * sizeof(Slot));
+    }
+
+    void TemplateTable::dup() {
+        // ..., a => ..., a, a
+        __ movq(r10, atStack(1));
+        __ movq(atStack(0), r10);
+        __ addq(rstack, sizeof(Slot));
+    }
+
+    void TemplateTable::dup_x1() {
+        // ..., b, a => ..., a, b, a
+        __ movq(r10, atStack(1));
+        __ movq(r11, atStack(2));
+        __ movq(atStack(2), r10);
+        __ movq(atStack(1), r11);
+        __ movq(atStack(0), r10);
+        __ addq(rstack, sizeof(Slot));
+    }
+
+    void TemplateTable::dup_x2() {
+        // ..., c, b, a => ..., a, c, b, a
+        __ movq(r10, atStack(1));
+        __ movq(r11, atStack(2));
+        __ movq(rdx, atStack(3));
+        __ movq(atStack(3), r10);
+        __ movq(atStack(2), rdx);
+        __ movq(atStack(1), r11);
+        __ movq(atStack(0), r10);
+        __ addq(rstack, sizeof(Slot));
+    }
+
+    void TemplateTable::dup2() {
+        // ..., b, a => ..., b, a, b, a
+        __ movq(r10, atStack(1));
+        __ movq(r11, atStack(2));
+        __ movq(atStack(0), r11);
+        __ movq(atStack(-1), r10);
+        __ addq(rstack, 2 * sizeof(Slot));
+    }
+
+    void TemplateTable::dup2_x1() {
+        // ..., c, b, a => ..., b, a, c, b, a
+        __ movq(r10, atStack(1));
+        __ movq(r11, atStack(2));
+        __ movq(rdx, atStack(3));
+        __ movq(atStack(3), r11);
+        __ movq(atStack(2), r10);
+        __ movq(atStack(1), rdx);
+        __ movq(atStack(0), r11);
+        __ movq(atStack(-1), r10);
+        __ addq(rstack, 2 * sizeof(Slot));
+    }
+
+    void TemplateTable::dup2_x2() {
+        // ..., d, c, b, a => ..., b, a, d, c, b, a
+        __ movq(r10, atStack(1));
+        __ movq(r11, atStack(2));
+        __ movq(rdx, atStack(3));
+        __ movq(rcx, atStack(4));
+        __ movq(atStack(4), r11);
+        __ movq(atStack(3), r10);
+        __ movq(atStack(2), rcx);
+        __ movq(atStack(1), rdx);
+        __ movq(atStack(0), r11);
+        __ movq(atStack(-1), r10);
+        __ addq(rstack, 2 * sizeof(Slot));
+    }
+
+    void TemplateTable::swap() {
+        // ..., b, a => ..., a, b
+        __ movq(r10, atStack(1));
+        __ movq(r11, atStack(2));
+        __ movq(atStack(2), r10);
+        __ movq(atStack(1), r11);
+    }
+
+    void TemplateTable::iop2(Operation op) {
+        switch (op) {
+            case add:
+                __ popI(rdx);
+                __ addl(rax, rdx);
+                break;
+            case sub:
+                __ movl(rdx, rax);
+                __ popI(rax);
+                __ subl(rax, rdx);
+                break;
+            case mul:
+                __ popI(rdx);
+                __ imull(rax, rdx);
+                break;
+            case _and:
+                __ popI(rdx);
+                __ andl(rax, rdx);
+                break;
+            case _or:
+                __ popI(rdx);
+                __ orl(rax, rdx);
+                break;
+            case _xor:
+                __ popI(rdx);
+                __ xorl(rax, rdx);
+                break;
+            case shl:
+                // the count is masked to 5 bits by the hardware too
+                __ movl(rcx, rax);
+                __ popI(rax);
+                __ shll(rax);
+                break;
+            case shr:
+                __ movl(rcx, rax);
+                __ popI(rax);
+                __ sarl(rax);
+                break;
+            case ushr:
+                __ movl(rcx, rax);
+                __ popI(rax);
+                __ shrl(rax);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    void TemplateTable::lop2(Operation op) {
+        switch (op) {
+            case add:
+                __ popL(rdx);
+                __ addq(rax, rdx);
+                break;
+            case sub:
+                __ movq(rdx, rax);
+                __ popL(rax);
+                __ subq(rax, rdx);
+                break;
+            case mul:
+                __ popL(rdx);
+                __ imulq(rax, rdx);
+                break;
+            case _and:
+                __ popL(rdx);
+                __ andq(rax, rdx);
+                break;
+            case _or:
+                __ popL(rdx);
+                __ orq(rax, rdx);
+                break;
+            case _xor:
+                __ popL(rdx);
+                __ xorq(rax, rdx);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    void TemplateTable::fop2(Operation op) {
+        __ movdl(xmm1, rax);
+        __ popI(rax);
+        __ movdl(xmm0, rax);
+        switch (op) {
+            case add:
+                __ addss(xmm0, xmm1);
+                break;
+            case sub:
+                __ subss(xmm0, xmm1);
+                break;
+            case mul:
+                __ mulss(xmm0, xmm1);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+        __ movdl(rax, xmm0);
+    }
+
+    void TemplateTable::dop2(Operation op) {
+        __ movdq(xmm1, rax);
+        __ popL(rax);
+        __ movdq(xmm0, rax);
+        switch (op) {
+            case add:
+                __ addsd(xmm0, xmm1);
+                break;
+            case sub:
+                __ subsd(xmm0, xmm1);
+                break;
+            case mul:
+                __ mulsd(xmm0, xmm1);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+        __ movdq(rax, xmm0);
+    }
+
+    void TemplateTable::idiv_or_irem(bool isRem) {
+        Label normal;
+        Label done;
+        // the VM throws the ArithmeticException
+        __ testl(rax, rax);
+        __ jcc(Assembler::equal, __ vmBytecode(itos));
+        __ movl(rcx, rax);
+        __ popI(rax);
+        // MIN_VALUE / -1 overflows in hardware but not in Java
+        __ cmpl(rcx, -1);
+        __ jcc(Assembler::notEqual, normal);
+        if (isRem) {
+            __ xorl(rax, rax);
+        } else {
+            __ negl(rax);
+        }
+        __ jmp(done);
+        __ bind(normal);
+        __ cdql();
+        __ idivl(rcx);
+        if (isRem) {
+            __ movl(rax, rdx);
+        }
+        __ bind(done);
+    }
+
+    void TemplateTable::ldiv_or_lrem(bool isRem) {
+        Label normal;
+        Label done;
+        __ testq(rax, rax);
+        __ jcc(Assembler::equal, __ vmBytecode(ltos));
+        __ movq(rcx, rax);
+        __ popL(rax);
+        __ cmpq(rcx, -1);
+        __ jcc(Assembler::notEqual, normal);
+        if (isRem) {
+            __ xorl(rax, rax);
+        } else {
+            __ negq(rax);
+        }
+        __ jmp(done);
+        __ bind(normal);
+        __ cqto();
+        __ idivq(rcx);
+        if (isRem) {
+            __ movq(rax, rdx);
+        }
+        __ bind(done);
+    }
+
+    void TemplateTable::idiv() {
+        idiv_or_irem(false);
+    }
+
+    void TemplateTable::irem() {
+        idiv_or_irem(true);
+    }
+
+    void TemplateTable::ldiv() {
+        ldiv_or_lrem(false);
+    }
+
+    void TemplateTable::lrem() {
+        ldiv_or_lrem(true);
+    }
+
+    void TemplateTable::lshl() {
+        // the count is masked to 6 bits by the hardware too
+        __ movl(rcx, rax);
+        __ popL(rax);
+        __ shlq(rax);
+    }
+
+    void TemplateTable::lshr() {
+        __ movl(rcx, rax);
+        __ popL(rax);
+        __ sarq(rax);
+    }
+
+    void TemplateTable::lushr() {
+        __ movl(rcx, rax);
+        __ popL(rax);
+        __ shrq(rax);
+    }
+
+    void TemplateTable::ineg() {
+        __ negl(rax);
+    }
+
+    void TemplateTable::lneg() {
+        __ negq(rax);
+    }
+
+    void TemplateTable::iinc() {
+        locals_index(rdx);
+        __ movsbl(rcx, atBcp(2));
+        __ addl(Address(rlocals, rdx, Address::times8), rcx);
+    }
+
+    void TemplateTable::convert() {
+        switch (getBytecode()) {
+            case Bytecodes::_i2l:
+                __ movslq(rax, rax);
+                break;
+            case Bytecodes::_i2f:
+                __ cvtsi2ssl(xmm0, rax);
+                __ movdl(rax, xmm0);
+                break;
+            case Bytecodes::_i2d:
+                __ cvtsi2sdl(xmm0, rax);
+                __ movdq(rax, xmm0);
+                break;
+            case Bytecodes::_l2i:
+                __ movl(rax, rax);
+                break;
+            case Bytecodes::_l2f:
+                __ cvtsi2ssq(xmm0, rax);
+                __ movdl(rax, xmm0);
+                break;
+            case Bytecodes::_l2d:
+                __ cvtsi2sdq(xmm0, rax);
+                __ movdq(rax, xmm0);
+                break;
+            case Bytecodes::_f2d:
+                __ movdl(xmm0, rax);
+                __ cvtss2sd(xmm0, xmm0);
+                __ movdq(rax, xmm0);
+                break;
+            case Bytecodes::_d2f:
+                __ movdq(xmm0, rax);
+                __ cvtsd2ss(xmm0, xmm0);
+                __ movdl(rax, xmm0);
+                break;
+            case Bytecodes::_i2b:
+                __ movsbl(rax, rax);
+                break;
+            case Bytecodes::_i2c:
+                __ movzwl(rax, rax);
+                break;
+            case Bytecodes::_i2s:
+                __ movswl(rax, rax);
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    void TemplateTable::lcmp() {
+        // (value1 > value2) - (value1 < value2)
+        __ movq(rcx, rax);
+        __ popL(rdx);
+        __ cmpq(rdx, rcx);
+        __ setb(Assembler::greater, rax);
+        __ setb(Assembler::less, rcx);
+        __ movzbl(rax, rax);
+        __ movzbl(rcx, rcx);
+        __ subl(rax, rcx);
+    }
+
+    void TemplateTable::branch() {
+        Label forward;
+        // threads only stop for GC at backward branches, pc stays here
+        __ movzwl(rdx, atBcp(1));
+        __ bswapl(rdx);
+        __ sarl(rdx, 16);
+        __ testl(rdx, rdx);
+        __ jcc(Assembler::greater, forward);
+        __ testSafepointPoll();
+        __ jcc(Assembler::equal, forward);
+        __ callVM((address) TemplateInterpreter::safepoint);
+        __ movzwl(rdx, atBcp(1));
+        __ bswapl(rdx);
+        __ sarl(rdx, 16);
+        __ bind(forward);
+        __ movslq(rdx, rdx);
+        __ addq(rbcp, rdx);
+        __ dispatchNext(vtos, 0);
+    }
+
+    void TemplateTable::if_0cmp(Condition cc) {
+        Label notTaken;
+        __ testl(rax, rax);
+        __ jcc(j_not(cc), notTaken);
+        branch();
+        __ bind(notTaken);
+    }
+
+    void TemplateTable::if_icmp(Condition cc) {
+        Label notTaken;
+        __ popI(rdx);
+        __ cmpl(rdx, rax);
+        __ jcc(j_not(cc), notTaken);
+        branch();
+        __ bind(notTaken);
+    }
+
+    void TemplateTable::if_nullcmp(Condition cc) {
+        Label notTaken;
+        __ testq(rax, rax);
+        __ jcc(j_not(cc), notTaken);
+        branch();
+        __ bind(notTaken);
+    }
+
+    void TemplateTable::if_acmp(Condition cc) {
+        Label notTaken;
+        __ popPtr(rdx);
+        __ cmpq(rdx, rax);
+        __ jcc(j_not(cc), notTaken);
+        branch();
+        __ bind(notTaken);
+    }
+
+    void TemplateTable::_goto() {
+        branch();
+    }
+
+    void TemplateTable::_return(TosState state) {
+        Label notArmed;
+        // the result goes back to the stack while the thread is stopped
+        __ testSafepointPoll();
+        __ jcc(Assembler::equal, notArmed);
+        __ push(state);
+        __ callVM((address) TemplateInterpreter::safepoint);
+        __ pop(state);
+        __ bind(notArmed);
+
+        switch (state) {
+            case itos:
+            case ftos:
+                __ movl(Address(rstate, offsetof(InterpreterState, _result)), rax);
+                break;
+            case ltos:
+            case dtos:
+            case atos:
+                __ movq(Address(rstate, offsetof(InterpreterState, _result)), rax);
+                break;
+            case vtos:
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+        __ movl(rax, state);
+        __ jmp(__ leave());
+    }
+
+    void TemplateTable::vm_bytecode() {
+        __ jmp(__ vmBytecode(vtos));
+    }
+
+    void TemplateTable::def(Bytecodes::Code code, int flags, TosState in, TosState out,
+                            void (*gen)(), char filler) {
+        _templateTable[code].initialize(flags, in, out, (Template::generator) gen, 0);
+    }
+
+    void TemplateTable::def(Bytecodes::Code code, int flags, TosState in, TosState out,
+                            void (*gen)(int arg), int arg) {
+        _templateTable[code].initialize(flags, in, out, gen, arg);
+    }
+
+    void TemplateTable::def(Bytecodes::Code code, int flags, TosState in, TosState out,
+                            void (*gen)(TosState tos), TosState tos) {
+        _templateTable[code].initialize(flags, in, out, (Template::generator) gen, tos);
+    }
+
+    void TemplateTable::def(Bytecodes::Code code, int flags, TosState in, TosState out,
+                            void (*gen)(Operation op), Operation op) {
+        _templateTable[code].initialize(flags, in, out, (Template::generator) gen, op);
+    }
+
+    void TemplateTable::def(Bytecodes::Code code, int flags, TosState in, TosState out,
+                            void (*gen)(Condition cc), Condition cc) {
+        _templateTable[code].initialize(flags, in, out, (Template::generator) gen, cc);
+    }
 
     void TemplateTable::initialize() {
-        // TODO
+        if (_is_initialized) {
+            return;
+        }
+
+        // For better readability
+        const char _ = ' ';
+        const int ____ = 0;
+        const int ubcp = 1 << Template::usesBcpBit;
+        const int disp = 1 << Template::doesDispatchBit;
+        const int clvm = 1 << Template::callsVMBit;
+        const int vmbc = ubcp | disp | clvm;
+
+        // Java spec bytecodes                ubcp|disp|clvm  in    out   generator             argument
+        def(Bytecodes::_nop                 , ____          , vtos, vtos, nop                 ,  _           );
+        def(Bytecodes::_aconst_null         , ____          , vtos, atos, aconst_null         ,  _           );
+        def(Bytecodes::_iconst_m1           , ____          , vtos, itos, iconst              , -1           );
+        def(Bytecodes::_iconst_0            , ____          , vtos, itos, iconst              ,  0           );
+        def(Bytecodes::_iconst_1            , ____          , vtos, itos, iconst              ,  1           );
+        def(Bytecodes::_iconst_2            , ____          , vtos, itos, iconst              ,  2           );
+        def(Bytecodes::_iconst_3            , ____          , vtos, itos, iconst              ,  3           );
+        def(Bytecodes::_iconst_4            , ____          , vtos, itos, iconst              ,  4           );
+        def(Bytecodes::_iconst_5            , ____          , vtos, itos, iconst              ,  5           );
+        def(Bytecodes::_lconst_0            , ____          , vtos, ltos, lconst              ,  0           );
+        def(Bytecodes::_lconst_1            , ____          , vtos, ltos, lconst              ,  1           );
+        def(Bytecodes::_fconst_0            , ____          , vtos, ftos, fconst              ,  0           );
+        def(Bytecodes::_fconst_1            , ____          , vtos, ftos, fconst              ,  1           );
+        def(Bytecodes::_fconst_2            , ____          , vtos, ftos, fconst              ,  2           );
+        def(Bytecodes::_dconst_0            , ____          , vtos, dtos, dconst              ,  0           );
+        def(Bytecodes::_dconst_1            , ____          , vtos, dtos, dconst              ,  1           );
+        def(Bytecodes::_bipush              , ubcp          , vtos, itos, bipush              ,  _           );
+        def(Bytecodes::_sipush              , ubcp          , vtos, itos, sipush              ,  _           );
+        def(Bytecodes::_ldc                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ldc_w               , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ldc2_w              , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_iload               , ubcp          , vtos, itos, iload               ,  _           );
+        def(Bytecodes::_lload               , ubcp          , vtos, ltos, lload               ,  _           );
+        def(Bytecodes::_fload               , ubcp          , vtos, ftos, fload               ,  _           );
+        def(Bytecodes::_dload               , ubcp          , vtos, dtos, dload               ,  _           );
+        def(Bytecodes::_aload               , ubcp          , vtos, atos, aload               ,  _           );
+        def(Bytecodes::_iload_0             , ____          , vtos, itos, iload               ,  0           );
+        def(Bytecodes::_iload_1             , ____          , vtos, itos, iload               ,  1           );
+        def(Bytecodes::_iload_2             , ____          , vtos, itos, iload               ,  2           );
+        def(Bytecodes::_iload_3             , ____          , vtos, itos, iload               ,  3           );
+        def(Bytecodes::_lload_0             , ____          , vtos, ltos, lload               ,  0           );
+        def(Bytecodes::_lload_1             , ____          , vtos, ltos, lload               ,  1           );
+        def(Bytecodes::_lload_2             , ____          , vtos, ltos, lload               ,  2           );
+        def(Bytecodes::_lload_3             , ____          , vtos, ltos, lload               ,  3           );
+        def(Bytecodes::_fload_0             , ____          , vtos, ftos, fload               ,  0           );
+        def(Bytecodes::_fload_1             , ____          , vtos, ftos, fload               ,  1           );
+        def(Bytecodes::_fload_2             , ____          , vtos, ftos, fload               ,  2           );
+        def(Bytecodes::_fload_3             , ____          , vtos, ftos, fload               ,  3           );
+        def(Bytecodes::_dload_0             , ____          , vtos, dtos, dload               ,  0           );
+        def(Bytecodes::_dload_1             , ____          , vtos, dtos, dload               ,  1           );
+        def(Bytecodes::_dload_2             , ____          , vtos, dtos, dload               ,  2           );
+        def(Bytecodes::_dload_3             , ____          , vtos, dtos, dload               ,  3           );
+        def(Bytecodes::_aload_0             , ____          , vtos, atos, aload               ,  0           );
+        def(Bytecodes::_aload_1             , ____          , vtos, atos, aload               ,  1           );
+        def(Bytecodes::_aload_2             , ____          , vtos, atos, aload               ,  2           );
+        def(Bytecodes::_aload_3             , ____          , vtos, atos, aload               ,  3           );
+        def(Bytecodes::_iaload              , ____          , itos, itos, iaload              ,  _           );
+        def(Bytecodes::_laload              , ____          , itos, ltos, laload              ,  _           );
+        def(Bytecodes::_faload              , ____          , itos, ftos, faload              ,  _           );
+        def(Bytecodes::_daload              , ____          , itos, dtos, daload              ,  _           );
+        def(Bytecodes::_aaload              , ____          , itos, atos, aaload              ,  _           );
+        def(Bytecodes::_baload              , ____          , itos, itos, baload              ,  _           );
+        def(Bytecodes::_caload              , ____          , itos, itos, caload              ,  _           );
+        def(Bytecodes::_saload              , ____          , itos, itos, saload              ,  _           );
+        def(Bytecodes::_istore              , ubcp          , itos, vtos, istore              ,  _           );
+        def(Bytecodes::_lstore              , ubcp          , ltos, vtos, lstore              ,  _           );
+        def(Bytecodes::_fstore              , ubcp          , ftos, vtos, fstore              ,  _           );
+        def(Bytecodes::_dstore              , ubcp          , dtos, vtos, dstore              ,  _           );
+        def(Bytecodes::_astore              , ubcp          , atos, vtos, astore              ,  _           );
+        def(Bytecodes::_istore_0            , ____          , itos, vtos, istore              ,  0           );
+        def(Bytecodes::_istore_1            , ____          , itos, vtos, istore              ,  1           );
+        def(Bytecodes::_istore_2            , ____          , itos, vtos, istore              ,  2           );
+        def(Bytecodes::_istore_3            , ____          , itos, vtos, istore              ,  3           );
+        def(Bytecodes::_lstore_0            , ____          , ltos, vtos, lstore              ,  0           );
+        def(Bytecodes::_lstore_1            , ____          , ltos, vtos, lstore              ,  1           );
+        def(Bytecodes::_lstore_2            , ____          , ltos, vtos, lstore              ,  2           );
+        def(Bytecodes::_lstore_3            , ____          , ltos, vtos, lstore              ,  3           );
+        def(Bytecodes::_fstore_0            , ____          , ftos, vtos, fstore              ,  0           );
+        def(Bytecodes::_fstore_1            , ____          , ftos, vtos, fstore              ,  1           );
+        def(Bytecodes::_fstore_2            , ____          , ftos, vtos, fstore              ,  2           );
+        def(Bytecodes::_fstore_3            , ____          , ftos, vtos, fstore              ,  3           );
+        def(Bytecodes::_dstore_0            , ____          , dtos, vtos, dstore              ,  0           );
+        def(Bytecodes::_dstore_1            , ____          , dtos, vtos, dstore              ,  1           );
+        def(Bytecodes::_dstore_2            , ____          , dtos, vtos, dstore              ,  2           );
+        def(Bytecodes::_dstore_3            , ____          , dtos, vtos, dstore              ,  3           );
+        def(Bytecodes::_astore_0            , ____          , atos, vtos, astore              ,  0           );
+        def(Bytecodes::_astore_1            , ____          , atos, vtos, astore              ,  1           );
+        def(Bytecodes::_astore_2            , ____          , atos, vtos, astore              ,  2           );
+        def(Bytecodes::_astore_3            , ____          , atos, vtos, astore              ,  3           );
+        def(Bytecodes::_iastore             , ____          , itos, vtos, iastore             ,  _           );
+        def(Bytecodes::_lastore             , ____          , ltos, vtos, lastore             ,  _           );
+        def(Bytecodes::_fastore             , ____          , ftos, vtos, fastore             ,  _           );
+        def(Bytecodes::_dastore             , ____          , dtos, vtos, dastore             ,  _           );
+        def(Bytecodes::_aastore             , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_bastore             , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_castore             , ____          , itos, vtos, castore             ,  _           );
+        def(Bytecodes::_sastore             , ____          , itos, vtos, sastore             ,  _           );
+        def(Bytecodes::_pop                 , ____          , vtos, vtos, pop                 ,  _           );
+        def(Bytecodes::_pop2                , ____          , vtos, vtos, pop2                ,  _           );
+        def(Bytecodes::_dup                 , ____          , vtos, vtos, dup                 ,  _           );
+        def(Bytecodes::_dup_x1              , ____          , vtos, vtos, dup_x1              ,  _           );
+        def(Bytecodes::_dup_x2              , ____          , vtos, vtos, dup_x2              ,  _           );
+        def(Bytecodes::_dup2                , ____          , vtos, vtos, dup2                ,  _           );
+        def(Bytecodes::_dup2_x1             , ____          , vtos, vtos, dup2_x1             ,  _           );
+        def(Bytecodes::_dup2_x2             , ____          , vtos, vtos, dup2_x2             ,  _           );
+        def(Bytecodes::_swap                , ____          , vtos, vtos, swap                ,  _           );
+        def(Bytecodes::_iadd                , ____          , itos, itos, iop2                , add          );
+        def(Bytecodes::_ladd                , ____          , ltos, ltos, lop2                , add          );
+        def(Bytecodes::_fadd                , ____          , ftos, ftos, fop2                , add          );
+        def(Bytecodes::_dadd                , ____          , dtos, dtos, dop2                , add          );
+        def(Bytecodes::_isub                , ____          , itos, itos, iop2                , sub          );
+        def(Bytecodes::_lsub                , ____          , ltos, ltos, lop2                , sub          );
+        def(Bytecodes::_fsub                , ____          , ftos, ftos, fop2                , sub          );
+        def(Bytecodes::_dsub                , ____          , dtos, dtos, dop2                , sub          );
+        def(Bytecodes::_imul                , ____          , itos, itos, iop2                , mul          );
+        def(Bytecodes::_lmul                , ____          , ltos, ltos, lop2                , mul          );
+        def(Bytecodes::_fmul                , ____          , ftos, ftos, fop2                , mul          );
+        def(Bytecodes::_dmul                , ____          , dtos, dtos, dop2                , mul          );
+        def(Bytecodes::_idiv                , clvm          , itos, itos, idiv                ,  _           );
+        def(Bytecodes::_ldiv                , clvm          , ltos, ltos, ldiv                ,  _           );
+        def(Bytecodes::_fdiv                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ddiv                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_irem                , clvm          , itos, itos, irem                ,  _           );
+        def(Bytecodes::_lrem                , clvm          , ltos, ltos, lrem                ,  _           );
+        def(Bytecodes::_frem                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_drem                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ineg                , ____          , itos, itos, ineg                ,  _           );
+        def(Bytecodes::_lneg                , ____          , ltos, ltos, lneg                ,  _           );
+        def(Bytecodes::_fneg                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_dneg                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ishl                , ____          , itos, itos, iop2                , shl          );
+        def(Bytecodes::_lshl                , ____          , itos, ltos, lshl                ,  _           );
+        def(Bytecodes::_ishr                , ____          , itos, itos, iop2                , shr          );
+        def(Bytecodes::_lshr                , ____          , itos, ltos, lshr                ,  _           );
+        def(Bytecodes::_iushr               , ____          , itos, itos, iop2                , ushr         );
+        def(Bytecodes::_lushr               , ____          , itos, ltos, lushr               ,  _           );
+        def(Bytecodes::_iand                , ____          , itos, itos, iop2                , _and         );
+        def(Bytecodes::_land                , ____          , ltos, ltos, lop2                , _and         );
+        def(Bytecodes::_ior                 , ____          , itos, itos, iop2                , _or          );
+        def(Bytecodes::_lor                 , ____          , ltos, ltos, lop2                , _or          );
+        def(Bytecodes::_ixor                , ____          , itos, itos, iop2                , _xor         );
+        def(Bytecodes::_lxor                , ____          , ltos, ltos, lop2                , _xor         );
+        def(Bytecodes::_iinc                , ubcp          , vtos, vtos, iinc                ,  _           );
+        def(Bytecodes::_i2l                 , ____          , itos, ltos, convert             ,  _           );
+        def(Bytecodes::_i2f                 , ____          , itos, ftos, convert             ,  _           );
+        def(Bytecodes::_i2d                 , ____          , itos, dtos, convert             ,  _           );
+        def(Bytecodes::_l2i                 , ____          , ltos, itos, convert             ,  _           );
+        def(Bytecodes::_l2f                 , ____          , ltos, ftos, convert             ,  _           );
+        def(Bytecodes::_l2d                 , ____          , ltos, dtos, convert             ,  _           );
+        def(Bytecodes::_f2i                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_f2l                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_f2d                 , ____          , ftos, dtos, convert             ,  _           );
+        def(Bytecodes::_d2i                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_d2l                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_d2f                 , ____          , dtos, ftos, convert             ,  _           );
+        def(Bytecodes::_i2b                 , ____          , itos, itos, convert             ,  _           );
+        def(Bytecodes::_i2c                 , ____          , itos, itos, convert             ,  _           );
+        def(Bytecodes::_i2s                 , ____          , itos, itos, convert             ,  _           );
+        def(Bytecodes::_lcmp                , ____          , ltos, itos, lcmp                ,  _           );
+        def(Bytecodes::_fcmpl               , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_fcmpg               , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_dcmpl               , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_dcmpg               , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ifeq                , ubcp|clvm     , itos, vtos, if_0cmp             , equal        );
+        def(Bytecodes::_ifne                , ubcp|clvm     , itos, vtos, if_0cmp             , not_equal    );
+        def(Bytecodes::_iflt                , ubcp|clvm     , itos, vtos, if_0cmp             , less         );
+        def(Bytecodes::_ifge                , ubcp|clvm     , itos, vtos, if_0cmp             , greater_equal);
+        def(Bytecodes::_ifgt                , ubcp|clvm     , itos, vtos, if_0cmp             , greater      );
+        def(Bytecodes::_ifle                , ubcp|clvm     , itos, vtos, if_0cmp             , less_equal   );
+        def(Bytecodes::_if_icmpeq           , ubcp|clvm     , itos, vtos, if_icmp             , equal        );
+        def(Bytecodes::_if_icmpne           , ubcp|clvm     , itos, vtos, if_icmp             , not_equal    );
+        def(Bytecodes::_if_icmplt           , ubcp|clvm     , itos, vtos, if_icmp             , less         );
+        def(Bytecodes::_if_icmpge           , ubcp|clvm     , itos, vtos, if_icmp             , greater_equal);
+        def(Bytecodes::_if_icmpgt           , ubcp|clvm     , itos, vtos, if_icmp             , greater      );
+        def(Bytecodes::_if_icmple           , ubcp|clvm     , itos, vtos, if_icmp             , less_equal   );
+        def(Bytecodes::_if_acmpeq           , ubcp|clvm     , atos, vtos, if_acmp             , equal        );
+        def(Bytecodes::_if_acmpne           , ubcp|clvm     , atos, vtos, if_acmp             , not_equal    );
+        def(Bytecodes::_goto                , ubcp|disp|clvm, vtos, vtos, _goto               ,  _           );
+        def(Bytecodes::_jsr                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ret                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_tableswitch         , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_lookupswitch        , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ireturn             , disp|clvm     , itos, itos, _return             , itos         );
+        def(Bytecodes::_lreturn             , disp|clvm     , ltos, ltos, _return             , ltos         );
+        def(Bytecodes::_freturn             , disp|clvm     , ftos, ftos, _return             , ftos         );
+        def(Bytecodes::_dreturn             , disp|clvm     , dtos, dtos, _return             , dtos         );
+        def(Bytecodes::_areturn             , disp|clvm     , atos, atos, _return             , atos         );
+        def(Bytecodes::_return              , disp|clvm     , vtos, vtos, _return             , vtos         );
+        def(Bytecodes::_getstatic           , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_putstatic           , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_getfield            , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_putfield            , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_invokevirtual       , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_invokespecial       , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_invokestatic        , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_invokeinterface     , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_invokedynamic       , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_new                 , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_newarray            , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_anewarray           , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_arraylength         , ____          , atos, itos, arraylength         ,  _           );
+        def(Bytecodes::_athrow              , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_checkcast           , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_instanceof          , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_monitorenter        , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_monitorexit         , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_wide                , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_multianewarray      , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_ifnull              , ubcp|clvm     , atos, vtos, if_nullcmp          , equal        );
+        def(Bytecodes::_ifnonnull           , ubcp|clvm     , atos, vtos, if_nullcmp          , not_equal    );
+        def(Bytecodes::_goto_w              , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+        def(Bytecodes::_jsr_w               , vmbc          , vtos, vtos, vm_bytecode         ,  _           );
+
+        _is_initialized = true;
     }
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,276 @@
+//
+// Basic blocks of a method
+//
+
+#include <kivm/cfg/basicBlock.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/classfile/constantPool.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/runtime/constantPool.h>
+#include <iomanip>
+#include <sstream>
+
+namespace kivm {
+    namespace instr {
+        BasicBlock *BasicBlock::requireBasicBlock(IBlock *block) {
+            auto basicBlock = dynamic_cast<BasicBlock *>(block);
+            if (basicBlock == nullptr) {
+                throw std::invalid_argument("block must be a BasicBlock");
+            }
+            return basicBlock;
+        }
+
+        void BasicBlock::connect(IBlock *src, IBlock *dest, EdgeType type, Object metaData) {
+            auto edge = new Edge(src, dest, type, metaData);
+            for (auto existing : _edges) {
+                if (existing->equals(edge)) {
+                    delete edge;
+                    return;
+                }
+            }
+            requireBasicBlock(src)->_edges.insert(edge);
+            requireBasicBlock(dest)->_edges.insert(edge);
+        }
+
+        void BasicBlock::addExceptionHandler(IBlock *block, String exceptionType) {
+            _exceptionTypes.push_back(std::move(exceptionType));
+            connect(this, block, CAUGHT_EXCEPTION, &_exceptionTypes.back());
+        }
+
+        void BasicBlock::addInstructionNum(int num) {
+            _instructionNums.insert(num);
+        }
+
+        void BasicBlock::addInstructionNums(IBlock *other) {
+            const auto &nums = other->getInstructionNums();
+            _instructionNums.insert(nums.begin(), nums.end());
+        }
+
+        void BasicBlock::addPredecessor(IBlock *block, EdgeType type, Object metaData) {
+            connect(block, this, type, metaData);
+        }
+
+        void BasicBlock::addRegularPredecessor(IBlock *block) {
+            addPredecessor(block, REGULAR, nullptr);
+        }
+
+        void BasicBlock::addRegularSuccessor(IBlock *block) {
+            addSuccessor(block, REGULAR, nullptr);
+        }
+
+        void BasicBlock::addSuccessor(IBlock *block, EdgeType type, Object metaData) {
+            connect(this, block, type, metaData);
+        }
+
+        void BasicBlock::onBlockReplaced(IBlock *oldBlock, IBlock *newBlock) {
+            auto replacement = requireBasicBlock(newBlock);
+            for (auto edge : _edges) {
+                if (edge->src == oldBlock) {
+                    edge->withSource(newBlock);
+                    replacement->_edges.insert(edge);
+                }
+                if (edge->dest == oldBlock) {
+                    edge->withDestination(newBlock);
+                    replacement->_edges.insert(edge);
+                }
+            }
+        }
+
+        bool BasicBlock::containsInstructionNum(int num) {
+            return _instructionNums.find(num) != _instructionNums.end();
+        }
+
+        String BasicBlock::disassemble(Method *method, bool includeVirtual, bool printInstrIndices) {
+            // blocks are built from class files, there are no virtual instructions
+            const CodeBlob &code = method->getCodeBlob();
+            std::wstringstream ss;
+            for (int bci : _instructionNums) {
+                if (printInstrIndices) {
+                    ss << std::setw(5) << bci << L": ";
+                }
+                int length = OopMap::getInstructionLength(code, bci);
+                ss << L"0x" << std::hex << std::setw(2) << std::setfill(L'0') << (int) code[bci];
+                for (int i = 1; i < length; ++i) {
+                    ss << L' ' << std::setw(2) << (int) code[bci + i];
+                }
+                ss << std::dec << std::setfill(L' ') << std::endl;
+            }
+            return ss.str();
+        }
+
+        int BasicBlock::getByteCodeInstructionCount(Method *method) {
+            return (int) _instructionNums.size();
+        }
+
+        std::set<Edge *> BasicBlock::getEdges() {
+            return _edges;
+        }
+
+        int BasicBlock::getFirstByteCodeInstructionNum(Method *method) {
+            return getFirstInstructionNum();
+        }
+
+        int BasicBlock::getFirstInstructionNum() {
+            return _instructionNums.empty() ? -1 : *_instructionNums.begin();
+        }
+
+        String BasicBlock::getId() {
+            return _id;
+        }
+
+        int BasicBlock::getIndexOfSuperConstructorCall(Method *method) {
+            auto superClass = method->getClass()->getSuperClass();
+            if (superClass == nullptr || method->getName() != L"<init>") {
+                return -1;
+            }
+
+            const CodeBlob &code = method->getCodeBlob();
+            cp_info **pool = method->getClass()->getRuntimeConstantPool()->getRawPool();
+            for (int bci : _instructionNums) {
+                if (code[bci] != OPC_INVOKESPECIAL) {
+                    continue;
+                }
+
+                int index = code[bci + 1] << 8 | code[bci + 2];
+                auto methodRef = requireConstant<CONSTANT_Methodref_info>(pool, index);
+                auto classInfo = requireConstant<CONSTANT_Class_info>(pool, methodRef->class_index);
+                auto nameAndType = requireConstant<CONSTANT_NameAndType_info>(pool,
+                    methodRef->name_and_type_index);
+                if (requireConstant<CONSTANT_Utf8_info>(pool, nameAndType->name_index)->getConstant() == L"<init>"
+                    && requireConstant<CONSTANT_Utf8_info>(pool, classInfo->name_index)->getConstant()
+                       == superClass->getName()) {
+                    return bci;
+                }
+            }
+            return -1;
+        }
+
+        std::set<int> BasicBlock::getInstructionNums() {
+            return _instructionNums;
+        }
+
+        IBlock *BasicBlock::getRegularPredecessor() {
+            const auto &predecessors = getRegularPredecessors();
+            return predecessors.size() == 1 ? *predecessors.begin() : nullptr;
+        }
+
+        int BasicBlock::getRegularPredecessorCount() {
+            return (int) getRegularPredecessors().size();
+        }
+
+        std::set<IBlock *> BasicBlock::getRegularPredecessors() {
+            std::set<IBlock *> predecessors;
+            for (auto edge : _edges) {
+                if (edge->isPredecessor(this) && edge->hasType(REGULAR)) {
+                    predecessors.insert(edge->src);
+                }
+            }
+            return predecessors;
+        }
+
+        IBlock *BasicBlock::getRegularSuccessor() {
+            const auto &successors = getRegularSuccessors();
+            return successors.size() == 1 ? *successors.begin() : nullptr;
+        }
+
+        int BasicBlock::getRegularSuccessorCount() {
+            return (int) getRegularSuccessors().size();
+        }
+
+        std::set<IBlock *> BasicBlock::getRegularSuccessors() {
+            std::set<IBlock *> successors;
+            for (auto edge : _edges) {
+                if (edge->isSuccessor(this) && edge->hasType(REGULAR)) {
+                    successors.insert(edge->dest);
+                }
+            }
+            return successors;
+        }
+
+        bool BasicBlock::hasRegularPredecessor() {
+            return getRegularPredecessorCount() > 0;
+        }
+
+        bool BasicBlock::hasRegularSuccessor() {
+            return getRegularSuccessorCount() > 0;
+        }
+
+        bool BasicBlock::isVirtual(Method *method) {
+            return false;
+        }
+
+        bool BasicBlock::removeRegularSuccessor(IBlock *block) {
+            for (auto edge : _edges) {
+                if (edge->isSuccessor(this) && edge->dest == block && edge->hasType(REGULAR)) {
+                    _edges.erase(edge);
+                    requireBasicBlock(block)->_edges.erase(edge);
+                    delete edge;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void BasicBlock::setId(String id) {
+            this->_id = std::move(id);
+        }
+
+        String BasicBlock::toSimpleString() {
+            std::wstringstream ss;
+            ss << L"block " << _id;
+            if (!_instructionNums.empty()) {
+                ss << L" [" << *_instructionNums.begin() << L", " << *_instructionNums.rbegin() << L"]";
+            }
+            return ss.str();
+        }
+
+        String BasicBlock::toString() {
+            std::wstringstream ss;
+            ss << toSimpleString() << L" ->";
+            for (auto edge : _edges) {
+                if (!edge->isSuccessor(this)) {
+                    continue;
+                }
+                ss << L" " << edge->dest->getId();
+                switch (edge->type) {
+                    case CAUGHT_EXCEPTION:
+                        ss << L"(catch " << *(String *) edge->metaData << L")";
+                        break;
+                    case LOOKUP_SWITCH:
+                    case TABLE_SWITCH:
+                        if (edge->metaData == nullptr) {
+                            ss << L"(default)";
+                        } else {
+                            ss << L"(case " << (intptr_t) edge->metaData << L")";
+                        }
+                        break;
+                    default:
+                        if (edge->metaData != nullptr) {
+                            ss << L"(" << *(String *) edge->metaData << L")";
+                        }
+                        break;
+                }
+            }
+            return ss.str();
+        }
+
+        std::set<BasicBlock *> BasicBlock::getAllSuccessors() {
+            std::set<BasicBlock *> successors;
+            for (auto edge : _edges) {
+                if (edge->isSuccessor(this)) {
+                    successors.insert(requireBasicBlock(edge->dest));
+                }
+            }
+            return successors;
+        }
+
+        int BasicBlock::getEndInstructionNum(Method *method) {
+            if (_instructionNums.empty()) {
+                return -1;
+            }
+            int last = *_instructionNums.rbegin();
+            return last + OopMap::getInstructionLength(method->getCodeBlob(), last);
+        }
+    }
+}
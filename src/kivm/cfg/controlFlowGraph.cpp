@@ -0,0 +1,292 @@
+//
+// Control flow graph of a method
+//
+
+#include <kivm/cfg/controlFlowGraph.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/classfile/constantPool.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/runtime/constantPool.h>
+#include <algorithm>
+#include <sstream>
+
+namespace kivm {
+    namespace instr {
+        static String TRUE_LABEL = L"true";
+        static String FALSE_LABEL = L"false";
+
+        static inline int readS2(const CodeBlob &code, int offset) {
+            return (short) (code[offset] << 8 | code[offset + 1]);
+        }
+
+        static inline int readS4(const CodeBlob &code, int offset) {
+            return (int) ((u4) code[offset] << 24
+                          | (u4) code[offset + 1] << 16
+                          | (u4) code[offset + 2] << 8
+                          | (u4) code[offset + 3]);
+        }
+
+        static inline int getSwitchBase(int bci) {
+            return (bci + 4) & ~3;
+        }
+
+        static bool isConditionalBranch(int opcode) {
+            return (opcode >= OPC_IFEQ && opcode <= OPC_IF_ACMPNE)
+                   || opcode == OPC_IFNULL
+                   || opcode == OPC_IFNONNULL;
+        }
+
+        /**
+         * Call {@code visitor} with the target, the edge type and
+         * the edge meta-data of every jump of the instruction at {@code bci}.
+         * Falling through to the next instruction is not a jump.
+         */
+        template <typename Visitor>
+        static void forEachJump(const CodeBlob &code, int bci, Visitor &&visitor) {
+            int opcode = code[bci];
+            if (isConditionalBranch(opcode)) {
+                visitor(bci + readS2(code, bci + 1), REGULAR, (Object) &TRUE_LABEL);
+                return;
+            }
+
+            switch (opcode) {
+                case OPC_GOTO:
+                case OPC_JSR:
+                    visitor(bci + readS2(code, bci + 1), REGULAR, nullptr);
+                    break;
+
+                case OPC_GOTO_W:
+                case OPC_JSR_W:
+                    visitor(bci + readS4(code, bci + 1), REGULAR, nullptr);
+                    break;
+
+                case OPC_TABLESWITCH: {
+                    int base = getSwitchBase(bci);
+                    visitor(bci + readS4(code, base), TABLE_SWITCH, nullptr);
+                    int low = readS4(code, base + 4);
+                    int high = readS4(code, base + 8);
+                    for (int i = 0; i <= high - low; ++i) {
+                        visitor(bci + readS4(code, base + 12 + i * 4), TABLE_SWITCH,
+                            (Object) (intptr_t) (low + i));
+                    }
+                    break;
+                }
+
+                case OPC_LOOKUPSWITCH: {
+                    int base = getSwitchBase(bci);
+                    visitor(bci + readS4(code, base), LOOKUP_SWITCH, nullptr);
+                    int pairs = readS4(code, base + 4);
+                    for (int i = 0; i < pairs; ++i) {
+                        visitor(bci + readS4(code, base + 8 + i * 8 + 4), LOOKUP_SWITCH,
+                            (Object) (intptr_t) readS4(code, base + 8 + i * 8));
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+
+        static bool canFallThrough(const CodeBlob &code, int bci) {
+            switch (code[bci]) {
+                case OPC_GOTO:
+                case OPC_GOTO_W:
+                case OPC_JSR:
+                case OPC_JSR_W:
+                case OPC_RET:
+                case OPC_TABLESWITCH:
+                case OPC_LOOKUPSWITCH:
+                case OPC_IRETURN:
+                case OPC_LRETURN:
+                case OPC_FRETURN:
+                case OPC_DRETURN:
+                case OPC_ARETURN:
+                case OPC_RETURN:
+                case OPC_ATHROW:
+                    return false;
+                case OPC_WIDE:
+                    return code[bci + 1] != OPC_RET;
+                default:
+                    return true;
+            }
+        }
+
+        ControlFlowGraph::ControlFlowGraph(Method *method)
+            : _method(method) {
+            if (method->getCodeAttribute() == nullptr) {
+                return;
+            }
+            buildBlocks();
+            buildEdges();
+        }
+
+        ControlFlowGraph::~ControlFlowGraph() {
+            std::set<Edge *> edges;
+            for (auto block : _blocks) {
+                const auto &blockEdges = block->getEdges();
+                edges.insert(blockEdges.begin(), blockEdges.end());
+            }
+            for (auto edge : edges) {
+                delete edge;
+            }
+            for (auto block : _blocks) {
+                delete block;
+            }
+        }
+
+        void ControlFlowGraph::buildBlocks() {
+            const CodeBlob &code = _method->getCodeBlob();
+            auto codeAttr = _method->getCodeAttribute();
+            int codeLength = codeAttr->code_length;
+
+            _instructionStarts.resize((size_t) codeLength, false);
+            std::vector<bool> blockStarts((size_t) codeLength, false);
+            blockStarts[0] = true;
+
+            auto markBlockStart = [&](int bci) {
+                if (bci >= 0 && bci < codeLength) {
+                    blockStarts[bci] = true;
+                }
+            };
+
+            for (int bci = 0; bci < codeLength; bci += OopMap::getInstructionLength(code, bci)) {
+                _instructionStarts[bci] = true;
+
+                bool jumps = false;
+                forEachJump(code, bci, [&](int target, EdgeType, Object) {
+                    markBlockStart(target);
+                    jumps = true;
+                });
+                if (jumps || !canFallThrough(code, bci)) {
+                    markBlockStart(bci + OopMap::getInstructionLength(code, bci));
+                }
+            }
+
+            for (int i = 0; i < codeAttr->exception_table_length; ++i) {
+                const auto &entry = codeAttr->exception_table[i];
+                markBlockStart(entry.start_pc);
+                markBlockStart(entry.end_pc);
+                markBlockStart(entry.handler_pc);
+            }
+
+            _blockIndexes.resize((size_t) codeLength, -1);
+            BasicBlock *current = nullptr;
+            for (int bci = 0; bci < codeLength; bci += OopMap::getInstructionLength(code, bci)) {
+                if (blockStarts[bci]) {
+                    current = new BasicBlock;
+                    current->setId(L"B" + std::to_wstring(_blocks.size()));
+                    _blocks.push_back(current);
+                }
+                current->addInstructionNum(bci);
+                _blockIndexes[bci] = (int) _blocks.size() - 1;
+            }
+        }
+
+        void ControlFlowGraph::buildEdges() {
+            const CodeBlob &code = _method->getCodeBlob();
+            auto codeAttr = _method->getCodeAttribute();
+            cp_info **pool = _method->getClass()->getRuntimeConstantPool()->getRawPool();
+
+            for (auto block : _blocks) {
+                int last = *block->getInstructionNums().rbegin();
+                forEachJump(code, last, [&](int target, EdgeType type, Object metaData) {
+                    auto dest = getBlockAt(target);
+                    if (dest != nullptr) {
+                        block->addSuccessor(dest, type, metaData);
+                    }
+                });
+
+                if (canFallThrough(code, last)) {
+                    auto next = getBlockAt(block->getEndInstructionNum(_method));
+                    if (next != nullptr) {
+                        block->addSuccessor(next, REGULAR,
+                            isConditionalBranch(code[last]) ? (Object) &FALSE_LABEL : nullptr);
+                    }
+                }
+            }
+
+            for (int i = 0; i < codeAttr->exception_table_length; ++i) {
+                const auto &entry = codeAttr->exception_table[i];
+                auto handler = getBlockAt(entry.handler_pc);
+                if (handler == nullptr) {
+                    continue;
+                }
+
+                String exceptionType = L"java/lang/Throwable";
+                if (entry.catch_type != 0) {
+                    auto classInfo = requireConstant<CONSTANT_Class_info>(pool, entry.catch_type);
+                    exceptionType = requireConstant<CONSTANT_Utf8_info>(pool, classInfo->name_index)->getConstant();
+                }
+
+                for (auto block : _blocks) {
+                    int first = block->getFirstInstructionNum();
+                    if (first >= entry.start_pc && first < entry.end_pc) {
+                        block->addExceptionHandler(handler, exceptionType);
+                    }
+                }
+            }
+        }
+
+        BasicBlock *ControlFlowGraph::getBlockAt(int bci) const {
+            if (bci < 0 || bci >= (int) _blockIndexes.size()) {
+                return nullptr;
+            }
+            // bytes inside an instruction belong to the block of the instruction
+            while (bci > 0 && _blockIndexes[bci] < 0) {
+                --bci;
+            }
+            int index = _blockIndexes[bci];
+            return index < 0 ? nullptr : _blocks[index];
+        }
+
+        std::vector<BasicBlock *> ControlFlowGraph::getReversePostOrder() const {
+            std::vector<BasicBlock *> postOrder;
+            if (_blocks.empty()) {
+                return postOrder;
+            }
+
+            // iterative depth first search, successors are visited by bci
+            std::set<BasicBlock *> visited;
+            std::vector<std::pair<BasicBlock *, std::vector<BasicBlock *>>> stack;
+
+            auto visit = [&](BasicBlock *block) {
+                visited.insert(block);
+                const auto &successors = block->getAllSuccessors();
+                std::vector<BasicBlock *> pending(successors.begin(), successors.end());
+                std::sort(pending.begin(), pending.end(), [](BasicBlock *lhs, BasicBlock *rhs) {
+                    return lhs->getFirstInstructionNum() > rhs->getFirstInstructionNum();
+                });
+                stack.emplace_back(block, std::move(pending));
+            };
+
+            visit(getEntryBlock());
+            while (!stack.empty()) {
+                auto &top = stack.back();
+                if (top.second.empty()) {
+                    postOrder.push_back(top.first);
+                    stack.pop_back();
+                    continue;
+                }
+
+                auto successor = top.second.back();
+                top.second.pop_back();
+                if (visited.find(successor) == visited.end()) {
+                    visit(successor);
+                }
+            }
+
+            std::reverse(postOrder.begin(), postOrder.end());
+            return postOrder;
+        }
+
+        String ControlFlowGraph::toString() {
+            std::wstringstream ss;
+            for (auto block : _blocks) {
+                ss << block->toString() << std::endl;
+            }
+            return ss.str();
+        }
+    }
+}
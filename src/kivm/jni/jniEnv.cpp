@@ -7,6 +7,98 @@
 #include <kivm/oop/instanceKlass.h>
 #include <kivm/classpath/classLoader.h>
 #include <kivm/native/java_lang_Class.h>
+#include <kivm/oop/instanceOop.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/bytecode/execution.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/memory/universe.h>
+
+static jfieldID getJniFieldID(jclass clazz, const char *name, const char *sig, bool isStatic) {
+    using namespace kivm;
+    auto klass = Resolver::instanceClass(clazz);
+    if (klass == nullptr) {
+        return nullptr;
+    }
+
+    // GetStaticFieldID causes an uninitialized class to be initialized
+    if (isStatic && !Execution::initializeClass(Threads::currentThread(), klass)) {
+        return nullptr;
+    }
+
+    const String &fieldName = strings::fromStdString(name);
+    const String &fieldDesc = strings::fromStdString(sig);
+
+    // fields declared in superclasses are keyed by their declaring class
+    for (auto current = klass; current != nullptr; current = current->getSuperClass()) {
+        auto fieldID = isStatic
+                       ? current->getStaticFieldInfo(current->getName(), fieldName, fieldDesc)
+                       : klass->getInstanceFieldInfo(current->getName(), fieldName, fieldDesc);
+        if (fieldID != nullptr) {
+            return fieldID;
+        }
+    }
+    return nullptr;
+}
+
+template <typename T>
+static T *getJniInstanceFieldAddress(jobject obj, jfieldID fieldID) {
+    using namespace kivm;
+    auto instance = Resolver::instance(obj);
+    auto field = (FieldID *) fieldID;
+    assert(instance != nullptr && field != nullptr);
+    return instance->getFieldAddress<T>(field->_offset);
+}
+
+template <typename T>
+static T *getJniStaticFieldAddress(jfieldID fieldID) {
+    using namespace kivm;
+    auto field = (FieldID *) fieldID;
+    assert(field != nullptr);
+    return field->_field->getClass()->getStaticFieldAddress<T>(field->_offset);
+}
+
+/**
+ * Allocating in native code may reach a safepoint and move the array,
+ * so natives are handed a copy of the elements, written back on release.
+ */
+template <typename T>
+static T *getJniArrayElements(jarray array, jboolean *isCopy) {
+    using namespace kivm;
+    auto arrayOop = Resolver::array(array);
+    assert(arrayOop != nullptr);
+    size_t size = arrayOop->getElementSize() * (size_t) arrayOop->getLength();
+    // malloc(0) may return nullptr, which means failure to natives
+    auto elements = (T *) Universe::allocCObject(size > 0 ? size : 1);
+    if (elements == nullptr) {
+        return nullptr;
+    }
+    memcpy(elements, arrayOop->getElements(), size);
+    if (isCopy != nullptr) {
+        *isCopy = JNI_TRUE;
+    }
+    return elements;
+}
+
+static void releaseJniArrayElements(jarray array, void *elements, jint mode) {
+    using namespace kivm;
+    auto arrayOop = Resolver::array(array);
+    assert(arrayOop != nullptr && elements != nullptr);
+    if (mode != JNI_ABORT) {
+        memcpy(arrayOop->getElements(), elements, arrayOop->getElementSize() * (size_t) arrayOop->getLength());
+    }
+    if (mode != JNI_COMMIT) {
+        Universe::deallocCObject(elements);
+    }
+}
+
+template <typename T>
+static T *getJniArrayRegion(jarray array, jsize start, jsize len) {
+    using namespace kivm;
+    auto arrayOop = Resolver::array(array);
+    assert(arrayOop != nullptr);
+    assert(start >= 0 && len >= 0 && start <= arrayOop->getLength() - len);
+    return arrayOop->getElementAddress<T>(start);
+}
 
 JNI_ENTRY(jint, GetVersion(JNIEnv *env)) {
     return JNI_VERSION_1_8;
@@ -375,79 +467,82 @@ JNI_ENTRY(void, CallNonvirtualVoidMethodA(JNIEnv *env, jobject obj, jclass clazz
 }
 
 JNI_ENTRY(jfieldID, GetFieldID(JNIEnv *env, jclass clazz, const char *name, const char *sig)) {
-    PANIC("not implemented");
+    return getJniFieldID(clazz, name, sig, false);
 }
 
 JNI_ENTRY(jobject, GetObjectField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<kivm::oop>(obj, fieldID);
 }
 
 JNI_ENTRY(jboolean, GetBooleanField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jboolean>(obj, fieldID);
 }
 
 JNI_ENTRY(jbyte, GetByteField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jbyte>(obj, fieldID);
 }
 
 JNI_ENTRY(jchar, GetCharField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jchar>(obj, fieldID);
 }
 
 JNI_ENTRY(jshort, GetShortField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jshort>(obj, fieldID);
 }
 
 JNI_ENTRY(jint, GetIntField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jint>(obj, fieldID);
 }
 
 JNI_ENTRY(jlong, GetLongField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jlong>(obj, fieldID);
 }
 
 JNI_ENTRY(jfloat, GetFloatField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jfloat>(obj, fieldID);
 }
 
 JNI_ENTRY(jdouble, GetDoubleField(JNIEnv *env, jobject obj, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniInstanceFieldAddress<jdouble>(obj, fieldID);
 }
 
 JNI_ENTRY(void, SetObjectField(JNIEnv *env, jobject obj, jfieldID fieldID, jobject val)) {
-    PANIC("not implemented");
+    auto address = getJniInstanceFieldAddress<kivm::oop>(obj, fieldID);
+    kivm::Universe::preWriteBarrier(address);
+    *address = kivm::Resolver::javaOop(val);
+    kivm::Universe::writeBarrier(address);
 }
 
 JNI_ENTRY(void, SetBooleanField(JNIEnv *env, jobject obj, jfieldID fieldID, jboolean val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jboolean>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetByteField(JNIEnv *env, jobject obj, jfieldID fieldID, jbyte val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jbyte>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetCharField(JNIEnv *env, jobject obj, jfieldID fieldID, jchar val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jchar>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetShortField(JNIEnv *env, jobject obj, jfieldID fieldID, jshort val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jshort>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetIntField(JNIEnv *env, jobject obj, jfieldID fieldID, jint val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jint>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetLongField(JNIEnv *env, jobject obj, jfieldID fieldID, jlong val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jlong>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetFloatField(JNIEnv *env, jobject obj, jfieldID fieldID, jfloat val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jfloat>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(void, SetDoubleField(JNIEnv *env, jobject obj, jfieldID fieldID, jdouble val)) {
-    PANIC("not implemented");
+    *getJniInstanceFieldAddress<jdouble>(obj, fieldID) = val;
 }
 
 JNI_ENTRY(jmethodID, GetStaticMethodID(JNIEnv *env, jclass clazz, const char *name, const char *sig)) {
@@ -575,79 +670,79 @@ JNI_ENTRY(void, CallStaticVoidMethodA(JNIEnv *env, jclass cls, jmethodID methodI
 }
 
 JNI_ENTRY(jfieldID, GetStaticFieldID(JNIEnv *env, jclass clazz, const char *name, const char *sig)) {
-    PANIC("not implemented");
+    return getJniFieldID(clazz, name, sig, true);
 }
 
 JNI_ENTRY(jobject, GetStaticObjectField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<kivm::oop>(fieldID);
 }
 
 JNI_ENTRY(jboolean, GetStaticBooleanField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jboolean>(fieldID);
 }
 
 JNI_ENTRY(jbyte, GetStaticByteField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jbyte>(fieldID);
 }
 
 JNI_ENTRY(jchar, GetStaticCharField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jchar>(fieldID);
 }
 
 JNI_ENTRY(jshort, GetStaticShortField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jshort>(fieldID);
 }
 
 JNI_ENTRY(jint, GetStaticIntField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jint>(fieldID);
 }
 
 JNI_ENTRY(jlong, GetStaticLongField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jlong>(fieldID);
 }
 
 JNI_ENTRY(jfloat, GetStaticFloatField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jfloat>(fieldID);
 }
 
 JNI_ENTRY(jdouble, GetStaticDoubleField(JNIEnv *env, jclass clazz, jfieldID fieldID)) {
-    PANIC("not implemented");
+    return *getJniStaticFieldAddress<jdouble>(fieldID);
 }
 
 JNI_ENTRY(void, SetStaticObjectField(JNIEnv *env, jclass clazz, jfieldID fieldID, jobject value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<kivm::oop>(fieldID) = kivm::Resolver::javaOop(value);
 }
 
 JNI_ENTRY(void, SetStaticBooleanField(JNIEnv *env, jclass clazz, jfieldID fieldID, jboolean value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jboolean>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticByteField(JNIEnv *env, jclass clazz, jfieldID fieldID, jbyte value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jbyte>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticCharField(JNIEnv *env, jclass clazz, jfieldID fieldID, jchar value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jchar>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticShortField(JNIEnv *env, jclass clazz, jfieldID fieldID, jshort value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jshort>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticIntField(JNIEnv *env, jclass clazz, jfieldID fieldID, jint value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jint>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticLongField(JNIEnv *env, jclass clazz, jfieldID fieldID, jlong value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jlong>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticFloatField(JNIEnv *env, jclass clazz, jfieldID fieldID, jfloat value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jfloat>(fieldID) = value;
 }
 
 JNI_ENTRY(void, SetStaticDoubleField(JNIEnv *env, jclass clazz, jfieldID fieldID, jdouble value)) {
-    PANIC("not implemented");
+    *getJniStaticFieldAddress<jdouble>(fieldID) = value;
 }
 
 JNI_ENTRY(jstring, NewString(JNIEnv *env, const jchar *unicode, jsize len)) {
@@ -683,179 +778,206 @@ JNI_ENTRY(void, ReleaseStringUTFChars(JNIEnv *env, jstring str, const char *char
 }
 
 JNI_ENTRY(jsize, GetArrayLength(JNIEnv *env, jarray array)) {
-    PANIC("not implemented");
+    auto arrayOop = kivm::Resolver::array(array);
+    assert(arrayOop != nullptr);
+    return arrayOop->getLength();
 }
 
 JNI_ENTRY(jobjectArray, NewObjectArray(JNIEnv *env, jsize len, jclass clazz, jobject init)) {
-    PANIC("not implemented");
+    using namespace kivm;
+    auto componentClass = Resolver::javaClass(clazz);
+    if (componentClass == nullptr) {
+        return nullptr;
+    }
+
+    const String &arrayClassName = componentClass->getClassType() == ClassType::INSTANCE_CLASS
+                                   ? L"[L" + componentClass->getName() + L";"
+                                   : L"[" + componentClass->getName();
+    auto arrayClass = (ObjectArrayKlass *) BootstrapClassLoader::get()->loadClass(arrayClassName);
+    if (arrayClass == nullptr) {
+        return nullptr;
+    }
+
+    auto arrayOop = arrayClass->newInstance(len);
+    oop initOop = Resolver::javaOop(init);
+    if (initOop != nullptr) {
+        for (int i = 0; i < len; ++i) {
+            arrayOop->setElementAt(i, initOop);
+        }
+    }
+    return arrayOop;
 }
 
 JNI_ENTRY(jobject, GetObjectArrayElement(JNIEnv *env, jobjectArray array, jsize index)) {
-    PANIC("not implemented");
+    auto arrayOop = kivm::Resolver::array(array);
+    assert(arrayOop != nullptr);
+    return arrayOop->getElementAt(index);
 }
 
 JNI_ENTRY(void, SetObjectArrayElement(JNIEnv *env, jobjectArray array, jsize index, jobject val)) {
-    PANIC("not implemented");
+    auto arrayOop = kivm::Resolver::array(array);
+    assert(arrayOop != nullptr);
+    arrayOop->setElementAt(index, kivm::Resolver::javaOop(val));
 }
 
 JNI_ENTRY(jbooleanArray, NewBooleanArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_BOOLEAN, len);
 }
 
 JNI_ENTRY(jbyteArray, NewByteArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_BYTE, len);
 }
 
 JNI_ENTRY(jcharArray, NewCharArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_CHAR, len);
 }
 
 JNI_ENTRY(jshortArray, NewShortArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_SHORT, len);
 }
 
 JNI_ENTRY(jintArray, NewIntArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_INT, len);
 }
 
 JNI_ENTRY(jlongArray, NewLongArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_LONG, len);
 }
 
 JNI_ENTRY(jfloatArray, NewFloatArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_FLOAT, len);
 }
 
 JNI_ENTRY(jdoubleArray, NewDoubleArray(JNIEnv *env, jsize len)) {
-    PANIC("not implemented");
+    return kivm::Execution::newPrimitiveArray(kivm::Threads::currentThread(), T_DOUBLE, len);
 }
 
 JNI_ENTRY(jboolean *,GetBooleanArrayElements(JNIEnv *env, jbooleanArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jboolean>(array, isCopy);
 }
 
 JNI_ENTRY(jbyte *,GetByteArrayElements(JNIEnv *env, jbyteArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jbyte>(array, isCopy);
 }
 
 JNI_ENTRY(jchar *,GetCharArrayElements(JNIEnv *env, jcharArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jchar>(array, isCopy);
 }
 
 JNI_ENTRY(jshort *,GetShortArrayElements(JNIEnv *env, jshortArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jshort>(array, isCopy);
 }
 
 JNI_ENTRY(jint *,GetIntArrayElements(JNIEnv *env, jintArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jint>(array, isCopy);
 }
 
 JNI_ENTRY(jlong *,GetLongArrayElements(JNIEnv *env, jlongArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jlong>(array, isCopy);
 }
 
 JNI_ENTRY(jfloat *,GetFloatArrayElements(JNIEnv *env, jfloatArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jfloat>(array, isCopy);
 }
 
 JNI_ENTRY(jdouble *,GetDoubleArrayElements(JNIEnv *env, jdoubleArray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<jdouble>(array, isCopy);
 }
 
 JNI_ENTRY(void, ReleaseBooleanArrayElements(JNIEnv *env, jbooleanArray array, jboolean *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseByteArrayElements(JNIEnv *env, jbyteArray array, jbyte *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseCharArrayElements(JNIEnv *env, jcharArray array, jchar *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseShortArrayElements(JNIEnv *env, jshortArray array, jshort *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseIntArrayElements(JNIEnv *env, jintArray array, jint *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseLongArrayElements(JNIEnv *env, jlongArray array, jlong *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseFloatArrayElements(JNIEnv *env, jfloatArray array, jfloat *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, ReleaseDoubleArrayElements(JNIEnv *env, jdoubleArray array, jdouble *elems, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, elems, mode);
 }
 
 JNI_ENTRY(void, GetBooleanArrayRegion(JNIEnv *env, jbooleanArray array, jsize start, jsize l, jboolean *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jboolean>(array, start, l), l * sizeof(jboolean));
 }
 
 JNI_ENTRY(void, GetByteArrayRegion(JNIEnv *env, jbyteArray array, jsize start, jsize len, jbyte *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jbyte>(array, start, len), len * sizeof(jbyte));
 }
 
 JNI_ENTRY(void, GetCharArrayRegion(JNIEnv *env, jcharArray array, jsize start, jsize len, jchar *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jchar>(array, start, len), len * sizeof(jchar));
 }
 
 JNI_ENTRY(void, GetShortArrayRegion(JNIEnv *env, jshortArray array, jsize start, jsize len, jshort *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jshort>(array, start, len), len * sizeof(jshort));
 }
 
 JNI_ENTRY(void, GetIntArrayRegion(JNIEnv *env, jintArray array, jsize start, jsize len, jint *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jint>(array, start, len), len * sizeof(jint));
 }
 
 JNI_ENTRY(void, GetLongArrayRegion(JNIEnv *env, jlongArray array, jsize start, jsize len, jlong *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jlong>(array, start, len), len * sizeof(jlong));
 }
 
 JNI_ENTRY(void, GetFloatArrayRegion(JNIEnv *env, jfloatArray array, jsize start, jsize len, jfloat *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jfloat>(array, start, len), len * sizeof(jfloat));
 }
 
 JNI_ENTRY(void, GetDoubleArrayRegion(JNIEnv *env, jdoubleArray array, jsize start, jsize len, jdouble *buf)) {
-    PANIC("not implemented");
+    memcpy(buf, getJniArrayRegion<jdouble>(array, start, len), len * sizeof(jdouble));
 }
 
 JNI_ENTRY(void, SetBooleanArrayRegion(JNIEnv *env, jbooleanArray array, jsize start, jsize l, const jboolean *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jboolean>(array, start, l), buf, l * sizeof(jboolean));
 }
 
 JNI_ENTRY(void, SetByteArrayRegion(JNIEnv *env, jbyteArray array, jsize start, jsize len, const jbyte *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jbyte>(array, start, len), buf, len * sizeof(jbyte));
 }
 
 JNI_ENTRY(void, SetCharArrayRegion(JNIEnv *env, jcharArray array, jsize start, jsize len, const jchar *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jchar>(array, start, len), buf, len * sizeof(jchar));
 }
 
 JNI_ENTRY(void, SetShortArrayRegion(JNIEnv *env, jshortArray array, jsize start, jsize len, const jshort *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jshort>(array, start, len), buf, len * sizeof(jshort));
 }
 
 JNI_ENTRY(void, SetIntArrayRegion(JNIEnv *env, jintArray array, jsize start, jsize len, const jint *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jint>(array, start, len), buf, len * sizeof(jint));
 }
 
 JNI_ENTRY(void, SetLongArrayRegion(JNIEnv *env, jlongArray array, jsize start, jsize len, const jlong *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jlong>(array, start, len), buf, len * sizeof(jlong));
 }
 
 JNI_ENTRY(void, SetFloatArrayRegion(JNIEnv *env, jfloatArray array, jsize start, jsize len, const jfloat *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jfloat>(array, start, len), buf, len * sizeof(jfloat));
 }
 
 JNI_ENTRY(void, SetDoubleArrayRegion(JNIEnv *env, jdoubleArray array, jsize start, jsize len, const jdouble *buf)) {
-    PANIC("not implemented");
+    memcpy(getJniArrayRegion<jdouble>(array, start, len), buf, len * sizeof(jdouble));
 }
 
 JNI_ENTRY(jint, RegisterNatives(JNIEnv *env, jclass clazz, const JNINativeMethod *methods, jint nMethods)) {
@@ -887,11 +1009,11 @@ JNI_ENTRY(void, GetStringUTFRegion(JNIEnv *env, jstring str, jsize start, jsize
 }
 
 JNI_ENTRY(void *,GetPrimitiveArrayCritical(JNIEnv *env, jarray array, jboolean *isCopy)) {
-    PANIC("not implemented");
+    return getJniArrayElements<void>(array, isCopy);
 }
 
 JNI_ENTRY(void, ReleasePrimitiveArrayCritical(JNIEnv *env, jarray array, void *carray, jint mode)) {
-    PANIC("not implemented");
+    releaseJniArrayElements(array, carray, mode);
 }
 
 JNI_ENTRY(const jchar *,GetStringCritical(JNIEnv *env, jstring string, jboolean *isCopy)) {
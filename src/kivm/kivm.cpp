@@ -9,7 +9,11 @@
 #include <kivm/classpath/classPathManager.h>
 #include <kivm/bytecode/interpreter.h>
 #include <kivm/memory/gcThread.h>
+#include <kivm/memory/heapDumper.h>
 #include <kivm/bytecode/javaCall.h>
+#include <kivm/bytecode/bytecodeProfile.h>
+#include <kivm/native/sun_misc_Signal.h>
+#include <kivm/runtime/runtimeConfig.h>
 
 #if defined(KIVM_PLATFORM_UNIX) || defined(KIVM_PLATFORM_APPLE)
 #   define PATH_SEPARATOR_CHAR L"/"
@@ -36,8 +40,10 @@ namespace kivm {
     InstanceKlass *Global::_ClassNotFoundException = nullptr;
     InstanceKlass *Global::_InternalError = nullptr;
     InstanceKlass *Global::_IOException = nullptr;
+    InstanceKlass *Global::_OutOfMemoryError = nullptr;
 
     JavaObject("java/nio/charset/Charset") Global::DEFAULT_UTF8_CHARSET = nullptr;
+    JavaObject("java/lang/OutOfMemoryError") Global::OUT_OF_MEMORY_ERROR = nullptr;
 
     bool Global::jvmBooted = false;
 
@@ -61,6 +67,9 @@ namespace kivm {
             WARN("createVirtualMachine: failed to init gc thread");
         }
 
+        // heap dumps on SIGUSR1
+        sun::misc::Signal::initialize();
+
         // initialize classpath
         ClassPathManager::initialize();
 
@@ -92,6 +101,15 @@ namespace kivm {
             return JNI_ERR;
         }
 
+        // all Java threads have exited
+        if (RuntimeConfig::get().heapDumpAtExit) {
+            HeapDumper::dump(HeapDumper::getDefaultPath());
+        }
+
+        if (BytecodeProfile::isEnabled()) {
+            BytecodeProfile::dump(RuntimeConfig::get().bytecodeProfilePath);
+        }
+
         auto gc = GCThread::get();
         if (gc != nullptr) {
             gc->stop();
@@ -0,0 +1,71 @@
+//
+// Allocation sites sampled on allocation slow paths
+//
+#include <kivm/memory/allocationSampler.h>
+#include <kivm/runtime/javaThread.h>
+#include <shared/lock.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace kivm {
+    std::atomic<bool> AllocationSampler::sEnabled{false};
+
+    static Lock &sitesLock() {
+        static Lock lock;
+        return lock;
+    }
+
+    static std::map<std::pair<Method *, u4>, AllocationSite> &getSites() {
+        static std::map<std::pair<Method *, u4>, AllocationSite> sites;
+        return sites;
+    }
+
+    void AllocationSampler::setEnabled(bool enabled) {
+        sEnabled.store(enabled, std::memory_order_relaxed);
+        if (!enabled) {
+            LockGuard lockGuard(sitesLock());
+            getSites().clear();
+        }
+    }
+
+    void AllocationSampler::record(JavaThread *thread, size_t bytes) {
+        // allocations of the VM itself have no site
+        if (thread == nullptr) {
+            return;
+        }
+        Method *method = thread->getCurrentMethod();
+        if (method == nullptr) {
+            return;
+        }
+
+        u4 pc = thread->getPc();
+        LockGuard lockGuard(sitesLock());
+        auto &site = getSites()[std::make_pair(method, pc)];
+        site._method = method;
+        site._pc = pc;
+        site._bytes += bytes;
+        ++site._samples;
+    }
+
+    int AllocationSampler::takeTopSites(AllocationSite *sites, int max) {
+        std::vector<AllocationSite> all;
+        {
+            LockGuard lockGuard(sitesLock());
+            auto &recorded = getSites();
+            all.reserve(recorded.size());
+            for (const auto &e : recorded) {
+                all.push_back(e.second);
+            }
+            recorded.clear();
+        }
+
+        int count = std::min((int) all.size(), max);
+        std::partial_sort(all.begin(), all.begin() + count, all.end(),
+            [](const AllocationSite &a, const AllocationSite &b) {
+                return a._bytes > b._bytes;
+            });
+        std::copy(all.begin(), all.begin() + count, sites);
+        return count;
+    }
+}
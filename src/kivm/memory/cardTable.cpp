@@ -0,0 +1,57 @@
+//
+// Card table remembering old-to-young references
+//
+
+#include <kivm/memory/cardTable.h>
+#include <kivm/memory/universe.h>
+#include <cstring>
+
+namespace kivm {
+    CardTable::~CardTable() {
+        Universe::deallocCObject(_cards);
+        Universe::deallocCObject(_objectStarts);
+    }
+
+    void CardTable::initialize(jbyte *coveredStart, size_t coveredSize) {
+        size_t cardCount = (coveredSize + CARD_SIZE - 1) >> CARD_SHIFT;
+        _coveredStart = coveredStart;
+        _coveredEnd = coveredStart + coveredSize;
+        _cards = (jbyte *) Universe::allocCObject(cardCount);
+        _objectStarts = (u1 *) Universe::allocCObject(cardCount);
+        memset(_objectStarts, NO_OBJECT_START, cardCount);
+        D("CardTable: %zd cards covering %p ~ %p", cardCount, _coveredStart, _coveredEnd);
+    }
+
+    void CardTable::markCards(const void *start, size_t size) {
+        if (size == 0 || !isCovered(start)) {
+            return;
+        }
+        size_t first = getCardIndex(start);
+        size_t last = getCardIndex(((jbyte *) start) + size - 1);
+        memset(_cards + first, DIRTY_CARD, last - first + 1);
+    }
+
+    void CardTable::reset(const void *start, size_t size) {
+        size_t first = getCardIndex(start);
+        size_t count = (size + CARD_SIZE - 1) >> CARD_SHIFT;
+        memset(_cards + first, CLEAN_CARD, count);
+        memset(_objectStarts + first, NO_OBJECT_START, count);
+    }
+
+    jbyte *CardTable::findObjectStart(size_t cardIndex, jbyte *spaceStart) const {
+        if (_objectStarts[cardIndex] == 0) {
+            return getCardStart(cardIndex);
+        }
+
+        // The first object starting inside this card may be preceded
+        // by an object covering the card start, which starts earlier.
+        size_t spaceCard = getCardIndex(spaceStart);
+        while (cardIndex > spaceCard) {
+            --cardIndex;
+            if (_objectStarts[cardIndex] != NO_OBJECT_START) {
+                return getCardStart(cardIndex) + _objectStarts[cardIndex] * sizeof(jlong);
+            }
+        }
+        return spaceStart;
+    }
+}
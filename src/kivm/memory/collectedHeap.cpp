@@ -0,0 +1,140 @@
+//
+// Parts shared by all collected heaps
+//
+
+#include <kivm/memory/collectedHeap.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/memory/allocationSampler.h>
+#include <kivm/memory/gcRoots.h>
+#include <kivm/memory/heapRegion.h>
+#include <kivm/memory/heapDumper.h>
+#include <kivm/memory/referenceProcessor.h>
+#include <kivm/memory/universe.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <atomic>
+
+namespace kivm {
+    CollectedHeap::CollectedHeap()
+        : _referenceProcessor(new ReferenceProcessor) {
+    }
+
+    CollectedHeap::~CollectedHeap() {
+        delete _referenceProcessor;
+    }
+
+    bool CollectedHeap::collectAndWait(JavaThread *thread) {
+        auto gc = GCThread::get();
+        if (gc == nullptr) {
+            return false;
+        }
+
+        gc->required();
+
+        // this will block current thread until GC is finished
+        thread->enterSafepoint();
+        return true;
+    }
+
+    bool CollectedHeap::collectClearingSoftReferences(JavaThread *thread) {
+        D("CollectedHeap: collecting with soft references cleared");
+        _clearAllSoftReferences = true;
+        return collectAndWait(thread);
+    }
+
+    void CollectedHeap::beginReferenceDiscovery(size_t usedBefore, bool wholeHeap) {
+        size_t maxSize = RuntimeConfig::get().maxHeapSizeInBytes;
+        size_t freeBytes = maxSize > usedBefore ? maxSize - usedBefore : 0;
+        bool clearAllSoftReferences = wholeHeap && _clearAllSoftReferences.exchange(false);
+        _referenceProcessor->beginDiscovery(freeBytes, clearAllSoftReferences);
+    }
+
+    void CollectedHeap::dumpHeapOnOutOfMemory() {
+        // like HotSpot, only the first OutOfMemoryError is dumped
+        static std::atomic<bool> dumped(false);
+        if (!RuntimeConfig::get().heapDumpOnOutOfMemory || dumped.exchange(true)) {
+            return;
+        }
+
+        auto path = HeapDumper::getDefaultPath();
+        auto gc = GCThread::get();
+        if (gc == nullptr) {
+            // nothing else can be running
+            HeapDumper::dump(path);
+            return;
+        }
+
+        // The allocating thread may hold heap locks that other threads
+        // need before their next poll, so it must not wait here.
+        // The heap is dumped when it reaches a poll itself.
+        gc->requestHeapDump(path);
+    }
+
+    void *CollectedHeap::throwOutOfMemoryError(size_t size) {
+        dumpHeapOnOutOfMemory();
+
+        auto currentThread = Threads::currentThread();
+        auto error = Global::OUT_OF_MEMORY_ERROR;
+
+        // the VM is still booting, or the caller does not check for nullptr
+        if (currentThread == nullptr || error == nullptr
+            || !currentThread->isAllocationRecoverable()
+            || currentThread->getCurrentMethod() == nullptr) {
+            PANIC("OutOfMemoryError: Java heap space, required size: %zd", size);
+        }
+
+        D("CollectedHeap: throwing OutOfMemoryError, required size: %zd", size);
+        currentThread->throwException(error, false);
+        return nullptr;
+    }
+
+    void CollectedHeap::walkRegion(const HeapRegion *region, const std::function<void(oop)> &callback) {
+        jbyte *p = region->_regionStart;
+        jbyte *top = region->_current;
+        while (p < top) {
+            if (HeapRegion::isFiller(p)) {
+                p += HeapRegion::getFillerSize(p);
+                continue;
+            }
+
+            auto object = (oop) p;
+            // the callback may not change the object's size
+            p += alignUp(object->getObjectSize(), sizeof(jlong));
+            callback(object);
+        }
+    }
+
+    GCEvent CollectedHeap::beginPause(const char *collection, size_t usedBefore) {
+        _pauseStartedAt = std::chrono::steady_clock::now();
+        GCRoots::resetScanTimes();
+
+        GCEvent event;
+        event._type = GC_PAUSE_START;
+        event._id = ++_collections;
+        event._collection = collection;
+        event._uptime = std::chrono::duration_cast<std::chrono::microseconds>(_pauseStartedAt - _createdAt);
+        event._timeToSafepoint = _timeToSafepoint;
+        event._usedBefore = usedBefore;
+        event._heapSize = getHeapSize();
+        Universe::notifyGCListeners(event);
+
+        // a collection not requested through GCThread waited for nothing
+        _timeToSafepoint = std::chrono::microseconds(0);
+        return event;
+    }
+
+    void CollectedHeap::endPause(GCEvent &event, size_t usedAfter, size_t objectsCopied) {
+        event._type = GC_PAUSE_END;
+        event._pauseTime = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - _pauseStartedAt);
+        event._usedAfter = usedAfter;
+        event._heapSize = getHeapSize();
+        event._objectsCopied = objectsCopied;
+        for (int i = 0; i < ROOT_CATEGORY_COUNT; ++i) {
+            event._rootScanTime[i] = GCRoots::getScanTime((GCRootCategory) i);
+        }
+        event._allocationSiteCount = AllocationSampler::takeTopSites(
+            event._allocationSites, MAX_ALLOCATION_SITES);
+        Universe::notifyGCListeners(event);
+    }
+}
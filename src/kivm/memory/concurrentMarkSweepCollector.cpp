@@ -0,0 +1,418 @@
+//
+// Marking and sweeping of the concurrent mark-sweep heap
+//
+
+#include <kivm/memory/concurrentMarkSweepHeap.h>
+#include <kivm/oop/monitorTable.h>
+#include <kivm/memory/referenceProcessor.h>
+#include <cstring>
+
+// Marking works like MarkCompactHeap: a side bitmap, roots claimed task by
+// task, and work-stealing queues, but only the roots are scanned in the
+// initial mark pause. GC workers then trace the object graph in steps,
+// while Java threads run. A step ends when all queues are drained, or
+// early when a pause asks concurrent work to yield. Queues are kept
+// between steps, so an interrupted step is simply run again.
+//
+// Mutators only ever overwrite references after logging the previous
+// value, and objects they allocate are marked, so the marker sees the
+// graph as it was at the initial mark. The remark pause drains the logs,
+// which are then turned off.
+//
+// The sweeper walks the space up to its top at the remark. Everything
+// below is either marked, or dead: Java threads allocate above it,
+// or in chunks the sweeper has already freed behind itself.
+
+namespace kivm {
+    /**
+     * Size of the object or filler at {@code p}, aligned.
+     */
+    static inline size_t getBlockSize(jbyte *p) {
+        if (HeapRegion::isFiller(p)) {
+            return HeapRegion::getFillerSize(p);
+        }
+        return alignUp(((oop) p)->getObjectSize(), sizeof(jlong));
+    }
+
+    void ConcurrentMarkingWorker::doOop(oop *slot) {
+        _heap->markObject(this, *slot);
+    }
+
+    bool ConcurrentMarkSweepHeap::tryMark(const void *addr) {
+        size_t index = getBitIndex(addr);
+        u8 *word = _markBits + index / 64;
+        u8 bit = 1ULL << (index % 64);
+
+        u8 value;
+        do {
+            value = *word;
+            if ((value & bit) != 0) {
+                return false;
+            }
+        } while (cmpxchg(word, value, value | bit) != value);
+        return true;
+    }
+
+    void ConcurrentMarkSweepHeap::clearMarkBits(jbyte *top) {
+        size_t bitCount = alignUp(getBitIndex(top), 64);
+        memset(_markBits, 0, bitCount / 8);
+    }
+
+    void ConcurrentMarkSweepHeap::markObject(ConcurrentMarkingWorker *worker, oop object) {
+        if (object == nullptr || !_space.contains(object)) {
+            return;
+        }
+
+        if (tryMark(object)) {
+            ++worker->_markedObjects;
+            worker->_queue.push(object);
+        }
+    }
+
+    void ConcurrentMarkSweepHeap::workOn(ConcurrentMarkingWorker *worker, bool concurrent) {
+        size_t task;
+        while ((task = _nextRootTask++) < _rootTasks.size()) {
+            _rootTasks[task](worker);
+        }
+
+        oop object = nullptr;
+        while (true) {
+            while (worker->_queue.pop(object)) {
+                if (concurrent && shouldYield()) {
+                    // left for the next step
+                    worker->_queue.push(object);
+                    _markingInterrupted = true;
+                    _queueSet.abandonTermination();
+                    return;
+                }
+
+                // only full pauses discover references
+                auto start = (jbyte *) object;
+                oop *referent = _referenceProcessor->discover(object, start, start + object->getObjectSize(),
+                    [this](oop target) {
+                        return _space.contains(target);
+                    });
+
+                OopIterator::iterate(object, [=](oop *slot) {
+                    if (slot != referent) {
+                        markObject(worker, *slot);
+                    }
+                });
+            }
+
+            if (_queueSet.steal(worker->_workerId, object)) {
+                worker->_queue.push(object);
+                continue;
+            }
+
+            if (concurrent && shouldYield()) {
+                _markingInterrupted = true;
+                _queueSet.abandonTermination();
+                return;
+            }
+
+            if (_queueSet.offerTermination()) {
+                break;
+            }
+        }
+    }
+
+    void ConcurrentMarkSweepHeap::runMarking(bool concurrent) {
+        _queueSet.resetTermination();
+        _workerPool->runTask([this, concurrent](int workerId) {
+            workOn(_workers[workerId], concurrent);
+        });
+    }
+
+    size_t ConcurrentMarkSweepHeap::processReferences() {
+        return _referenceProcessor->process([this](oop *slot) {
+            return isMarked(*slot);
+        }, [](oop *) {});
+    }
+
+    void ConcurrentMarkSweepHeap::markSatbBuffers() {
+        size_t next = 0;
+        for (const auto &buffer : _satbQueueSet.takeCompletedBuffers()) {
+            for (oop object : buffer) {
+                // workers are idle, their queues can be filled from here
+                markObject(_workers[next], object);
+                next = (next + 1) % _workers.size();
+            }
+        }
+    }
+
+    size_t ConcurrentMarkSweepHeap::collectMarkedObjects() {
+        size_t marked = 0;
+        for (auto worker : _workers) {
+            marked += worker->_markedObjects;
+            worker->_markedObjects = 0;
+        }
+        return marked;
+    }
+
+    void ConcurrentMarkSweepHeap::initialMark() {
+        if (_phase != CYCLE_IDLE) {
+            return;
+        }
+
+        GCEvent event = beginPause("initial-mark", getHeapUsed());
+        _markedObjects = 0;
+        _cycleAborted = false;
+        _phase = CYCLE_MARKING;
+        _satbQueueSet.setActive(true);
+        _allocateBlack = true;
+
+        D("[GCThread]: marking roots with %d workers", _workerPool->getWorkerCount());
+        _rootTasks.clear();
+        _nextRootTask = 0;
+        GCRoots::collectTasks(_rootTasks);
+
+        // only roots, objects are scanned concurrently
+        _workerPool->runTask([this](int workerId) {
+            auto worker = _workers[workerId];
+            size_t task;
+            while ((task = _nextRootTask++) < _rootTasks.size()) {
+                _rootTasks[task](worker);
+            }
+        });
+        _rootTasks.clear();
+
+        _markedObjects += collectMarkedObjects();
+        endPause(event, getHeapUsed(), _markedObjects);
+    }
+
+    bool ConcurrentMarkSweepHeap::concurrentMark() {
+        if (_phase != CYCLE_MARKING) {
+            return false;
+        }
+
+        beginConcurrentWork();
+        bool finished = false;
+        while (!_cycleAborted) {
+            markSatbBuffers();
+            _markingInterrupted = false;
+            runMarking(true);
+
+            if (_markingInterrupted) {
+                if (!yieldConcurrentWork()) {
+                    break;
+                }
+                continue;
+            }
+
+            // buffers filled by mutators while the step ran
+            if (!_satbQueueSet.hasCompletedBuffers()) {
+                finished = true;
+                break;
+            }
+        }
+
+        if (finished) {
+            _markedObjects += collectMarkedObjects();
+            D("[GCDetails]: [concurrent-mark: oops: %zd]", _markedObjects);
+        }
+        endConcurrentWork();
+        return finished;
+    }
+
+    void ConcurrentMarkSweepHeap::remark() {
+        if (_phase != CYCLE_MARKING) {
+            return;
+        }
+
+        GCEvent event = beginPause("remark", getHeapUsed());
+
+        // what mutators logged since the last step
+        _satbQueueSet.flushThreadBuffers();
+        markSatbBuffers();
+        runMarking(false);
+        _markedObjects += collectMarkedObjects();
+
+        _satbQueueSet.setActive(false);
+        _allocateBlack = false;
+
+        // Dead runs and free chunks below the top are swept into a new
+        // free list, Java threads allocate above the top meanwhile.
+        retireTlabs();
+        {
+            LockGuard guard(_freeListLock);
+            _freeChunks.clear();
+            _freeBytes = 0;
+        }
+        _sweepTop = _space._current;
+        _phase = CYCLE_SWEEPING;
+
+        // there is no young generation, the sweep covers them
+        MonitorTable::takeYoungOwners();
+
+        endPause(event, getHeapUsed(), _markedObjects);
+    }
+
+    void ConcurrentMarkSweepHeap::freeRun(jbyte *start, size_t size) {
+        if (size < MIN_FREE_CHUNK) {
+            HeapRegion::fill(start, size);
+            return;
+        }
+
+        {
+            LockGuard guard(_freeListLock);
+            addFreeChunkLocked(start, size);
+        }
+        _freeListCond.notify_all();
+    }
+
+    bool ConcurrentMarkSweepHeap::sweep(jbyte *top, bool concurrent) {
+        jbyte *deadStart = nullptr;
+        jbyte *p = _space._regionStart;
+        size_t blocks = 0;
+
+        while (p < top) {
+            if (concurrent && ++blocks % SWEEP_YIELD_INTERVAL == 0 && shouldYield()) {
+                // leave the space walkable while suspended
+                if (deadStart != nullptr) {
+                    freeRun(deadStart, p - deadStart);
+                    deadStart = nullptr;
+                }
+                if (!yieldConcurrentWork()) {
+                    return false;
+                }
+            }
+
+            size_t size = getBlockSize(p);
+            if (!HeapRegion::isFiller(p) && isMarked(p)) {
+                if (deadStart != nullptr) {
+                    freeRun(deadStart, p - deadStart);
+                    deadStart = nullptr;
+                }
+                p += size;
+                continue;
+            }
+
+            if (!HeapRegion::isFiller(p)) {
+                auto mark = ((oop) p)->getMarkOop();
+                if (mark->hasMonitor()) {
+                    MonitorTable::release(mark->getMonitorIndex());
+                }
+            }
+            if (deadStart == nullptr) {
+                deadStart = p;
+            }
+            p += size;
+        }
+
+        if (deadStart != nullptr) {
+            if (!concurrent && top == _space._current) {
+                // a dead tail is given back to the top
+                _space._current = deadStart;
+            } else {
+                freeRun(deadStart, top - deadStart);
+            }
+        }
+        return true;
+    }
+
+    bool ConcurrentMarkSweepHeap::concurrentSweep() {
+        if (_phase != CYCLE_SWEEPING) {
+            return false;
+        }
+
+        beginConcurrentWork();
+        bool finished = !_cycleAborted && sweep(_sweepTop, true);
+        if (finished) {
+            clearMarkBits(_sweepTop);
+            {
+                LockGuard guard(_freeListLock);
+                _phase = CYCLE_IDLE;
+            }
+            _freeListCond.notify_all();
+
+            growSpaceIfNeeded();
+            ++_concurrentCycles;
+            D("[GCDetails]: [concurrent-sweep: used: %zd(%zd)]", getHeapUsed(), _space.getSize());
+        }
+        endConcurrentWork();
+        return finished;
+    }
+
+    void ConcurrentMarkSweepHeap::collectConcurrently() {
+        LockGuard guard(_cycleLock);
+        if (!runPause([this]() { initialMark(); })) {
+            return;
+        }
+
+        concurrentMark();
+        if (!runPause([this]() { remark(); })) {
+            return;
+        }
+
+        concurrentSweep();
+    }
+
+    void ConcurrentMarkSweepHeap::abortCycle() {
+        if (_phase == CYCLE_IDLE) {
+            return;
+        }
+
+        D("[GCThread]: concurrent cycle given up");
+        _cycleAborted = true;
+        _satbQueueSet.setActive(false);
+        _satbQueueSet.abandon();
+        _allocateBlack = false;
+
+        // drop objects left for the next marking step
+        oop object = nullptr;
+        for (auto worker : _workers) {
+            while (worker->_queue.pop(object)) {
+            }
+            worker->_markedObjects = 0;
+        }
+
+        {
+            LockGuard guard(_freeListLock);
+            _phase = CYCLE_IDLE;
+        }
+        _freeListCond.notify_all();
+    }
+
+    void ConcurrentMarkSweepHeap::doGarbageCollection() {
+        suspendConcurrentWork();
+        abortCycle();
+
+        size_t beforeUsed = getHeapUsed();
+        GCEvent event = beginPause("mark-sweep", beforeUsed);
+        beginReferenceDiscovery(beforeUsed, true);
+
+        retireTlabs();
+        {
+            LockGuard guard(_freeListLock);
+            _freeChunks.clear();
+            _freeBytes = 0;
+        }
+        // a cycle given up may have left marks anywhere
+        clearMarkBits(_space._current);
+
+        D("[GCThread]: marking with %d workers", _workerPool->getWorkerCount());
+        _rootTasks.clear();
+        _nextRootTask = 0;
+        GCRoots::collectTasks(_rootTasks);
+        runMarking(false);
+        _rootTasks.clear();
+        _markedObjects = collectMarkedObjects();
+
+        D("[GCThread]: clearing references to unreachable objects");
+        size_t clearedReferences = processReferences();
+
+        D("[GCThread]: sweeping");
+        jbyte *top = _space._current;
+        sweep(top, false);
+        clearMarkBits(top);
+        MonitorTable::takeYoungOwners();
+
+        adjustSpace();
+
+        D("[GCDetails]: [mark-sweep: %zd -> %zd(%zd), oops: %zd, cleared references: %zd]",
+            beforeUsed, getHeapUsed(), _space.getSize(), _markedObjects, clearedReferences);
+        endPause(event, getHeapUsed(), _markedObjects);
+        resumeConcurrentWork();
+    }
+}
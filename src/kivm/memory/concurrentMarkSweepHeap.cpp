@@ -0,0 +1,469 @@
+//
+// Mostly-concurrent mark-sweep heap
+//
+
+#include <kivm/memory/concurrentMarkSweepHeap.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/memory/universe.h>
+#include <kivm/memory/allocationSampler.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <kivm/runtime/javaThread.h>
+#include <algorithm>
+#include <chrono>
+
+#define SPACE_ALIGNMENT (64 * 1024)
+
+// One mark bit for every heap word
+#define HEAP_BYTES_PER_MARK_BYTE (sizeof(jlong) * 8)
+
+namespace kivm {
+    class ConcurrentMarkThread : public VMThread {
+    private:
+        ConcurrentMarkSweepHeap *_heap;
+
+    protected:
+        void run() override {
+            setThreadName(L"ConcurrentMarkThread");
+            _heap->markThreadLoop();
+        }
+
+    public:
+        explicit ConcurrentMarkThread(ConcurrentMarkSweepHeap *heap)
+            : _heap(heap) {
+        }
+
+        void join() {
+            if (_nativeThread != nullptr && _nativeThread->joinable()) {
+                _nativeThread->join();
+            }
+        }
+    };
+
+    ConcurrentMarkSweepHeap::ConcurrentMarkSweepHeap()
+        : _initialSize(RuntimeConfig::get().initialHeapSizeInBytes),
+          _maxSize(RuntimeConfig::get().maxHeapSizeInBytes),
+          _tlabSize(alignUp(RuntimeConfig::get().tlabSizeInBytes, sizeof(jlong))),
+          _nextRootTask(0),
+          _allocateBlack(false),
+          _phase(CYCLE_IDLE),
+          _cycleAborted(false),
+          _suspendRequested(false),
+          _markingInterrupted(false),
+          _cycleRequested(false) {
+        if (_maxSize < _initialSize) {
+            _maxSize = _initialSize;
+        }
+        D("ConcurrentMarkSweepHeap: initialHeapSize: %zd, maxHeapSize: %zd, tlabSize: %zd",
+            _initialSize, _maxSize, _tlabSize);
+    }
+
+    ConcurrentMarkSweepHeap::~ConcurrentMarkSweepHeap() {
+        stopMarkThread();
+
+        delete _workerPool;
+        for (auto worker : _workers) {
+            delete worker;
+        }
+
+        if (_markBits != nullptr) {
+            Universe::releaseVirtual(_markBits, _markBitsReservedSize);
+            _markBits = nullptr;
+        }
+
+        if (_memoryStart != nullptr) {
+            Universe::releaseVirtual(_memoryStart, _reservedSize);
+            _memoryStart = nullptr;
+        }
+    }
+
+    void *ConcurrentMarkSweepHeap::allocate(size_t size) {
+        // keep objects aligned, so that the space can be walked
+        size = alignUp(size, sizeof(jlong));
+
+        auto currentThread = Threads::currentThread();
+        void *m = allocateInSpace(currentThread, size);
+        if (m == nullptr && currentThread != nullptr) {
+            m = waitForSweep(currentThread, size);
+        }
+
+        if (m == nullptr) {
+            // out of memory, let's try GC
+            if (currentThread == nullptr) {
+                PANIC("OutOfMemoryError: heap (not in JavaThread)");
+            }
+
+            D("ConcurrentMarkSweepHeap: out of memory, will retry after GC, required size: %zd", size);
+            if (size > _requiredSize) {
+                _requiredSize = size;
+            }
+            if (!collectAndWait(currentThread)) {
+                return throwOutOfMemoryError(size);
+            }
+
+            // try again
+            D("ConcurrentMarkSweepHeap: retry");
+            m = allocateInSpace(currentThread, size);
+
+            // last try, with everything softly reachable freed
+            if (m == nullptr && collectClearingSoftReferences(currentThread)) {
+                m = allocateInSpace(currentThread, size);
+            }
+            if (m == nullptr) {
+                return throwOutOfMemoryError(size);
+            }
+            D("ConcurrentMarkSweepHeap: successfully allocated %zd bytes after GC", size);
+        }
+
+        // objects allocated while marking are live for the whole cycle
+        if (_allocateBlack.load(std::memory_order_relaxed)) {
+            tryMark(m);
+        }
+        return m;
+    }
+
+    void *ConcurrentMarkSweepHeap::allocateInSpace(JavaThread *thread, size_t size) {
+        // threads other than JavaThreads have no TLAB
+        if (thread == nullptr) {
+            return allocateShared(size);
+        }
+
+        // fast path
+        auto &tlab = thread->getTlab();
+        void *m = tlab.allocate(size);
+        if (m != nullptr) {
+            return m;
+        }
+
+        // Do not throw away a TLAB with much free space for a big object,
+        // allocate it directly instead.
+        if (size >= _tlabSize
+            || (size > _tlabSize / 8 && tlab.getFree() > _tlabSize / 8)) {
+            AllocationSampler::sample(thread, size);
+            return allocateShared(size);
+        }
+
+        // refill, from the free list first
+        jbyte *chunk = nullptr;
+        size_t chunkSize = 0;
+        if (!takeFreeChunk(size, _tlabSize, chunk, chunkSize)) {
+            chunk = (jbyte *) _space.allocateAtomic(_tlabSize);
+            chunkSize = _tlabSize;
+        }
+        if (chunk == nullptr) {
+            // the space is nearly full, but the remaining space may be enough
+            AllocationSampler::sample(thread, size);
+            return allocateShared(size);
+        }
+        AllocationSampler::sample(thread, chunkSize);
+
+        HeapRegion::fill(tlab._top, tlab.getFree());
+        tlab.fill(chunk, chunkSize);
+        startCycleIfNeeded();
+        return tlab.allocate(size);
+    }
+
+    void *ConcurrentMarkSweepHeap::allocateShared(size_t size) {
+        jbyte *chunk = nullptr;
+        size_t chunkSize = 0;
+        if (takeFreeChunk(size, size, chunk, chunkSize)) {
+            // too small to be a free chunk
+            HeapRegion::fill(chunk + size, chunkSize - size);
+            return chunk;
+        }
+
+        void *m = _space.allocateAtomic(size);
+        if (m != nullptr) {
+            startCycleIfNeeded();
+        }
+        return m;
+    }
+
+    bool ConcurrentMarkSweepHeap::takeFreeChunk(size_t minSize, size_t maxSize,
+                                                jbyte *&chunk, size_t &chunkSize) {
+        LockGuard guard(_freeListLock);
+        auto fit = _freeChunks.lower_bound(maxSize);
+        if (fit == _freeChunks.end()) {
+            fit = _freeChunks.lower_bound(minSize);
+            if (fit == _freeChunks.end()) {
+                return false;
+            }
+        }
+
+        chunk = fit->second;
+        chunkSize = fit->first;
+        _freeChunks.erase(fit);
+        _freeBytes -= chunkSize;
+
+        // the rest stays free
+        if (chunkSize > maxSize && chunkSize - maxSize >= MIN_FREE_CHUNK) {
+            addFreeChunkLocked(chunk + maxSize, chunkSize - maxSize);
+            chunkSize = maxSize;
+        }
+        return true;
+    }
+
+    void ConcurrentMarkSweepHeap::addFreeChunkLocked(jbyte *start, size_t size) {
+        HeapRegion::fill(start, size);
+        _freeChunks.insert(std::make_pair(size, start));
+        _freeBytes += size;
+    }
+
+    void *ConcurrentMarkSweepHeap::waitForSweep(JavaThread *thread, size_t size) {
+        while (_phase.load() == CYCLE_SWEEPING) {
+            {
+                std::unique_lock<Lock> guard(_freeListLock);
+                _freeListCond.wait_for(guard, std::chrono::milliseconds(1), [&]() {
+                    return _phase.load() != CYCLE_SWEEPING
+                           || _freeChunks.lower_bound(size) != _freeChunks.end();
+                });
+            }
+
+            // a pause may be waiting for this thread
+            thread->enterSafepointIfNeeded();
+
+            void *m = allocateInSpace(thread, size);
+            if (m != nullptr) {
+                return m;
+            }
+        }
+        return nullptr;
+    }
+
+    void ConcurrentMarkSweepHeap::retireTlabs() {
+        Threads::forEach([](JavaThread *thread) {
+            auto &tlab = thread->getTlab();
+            if (tlab._start != nullptr) {
+                HeapRegion::fill(tlab._top, tlab.getFree());
+            }
+            tlab.reset();
+            return false;
+        });
+    }
+
+    void ConcurrentMarkSweepHeap::objectIterate(const std::function<void(oop)> &callback) {
+        // the sweeper rewrites dead runs
+        suspendConcurrentWork();
+        retireTlabs();
+        walkRegion(&_space, callback);
+        resumeConcurrentWork();
+    }
+
+    void ConcurrentMarkSweepHeap::initializeAll() {
+        initializeSpace();
+
+        _workerPool = new GCWorkerPool(RuntimeConfig::get().gcWorkerThreads);
+        for (int i = 0; i < _workerPool->getWorkerCount(); ++i) {
+            auto worker = new ConcurrentMarkingWorker(this, i);
+            _workers.push_back(worker);
+            _queueSet.addQueue(&worker->_queue);
+        }
+    }
+
+    void ConcurrentMarkSweepHeap::initializeSpace() {
+        size_t initialSize = alignDown(_initialSize, SPACE_ALIGNMENT);
+        _reservedSize = alignDown(_maxSize, SPACE_ALIGNMENT);
+        if (initialSize == 0) {
+            PANIC("Heap size too small: %zd", _initialSize);
+        }
+
+        _memoryStart = (jbyte *) Universe::reserveHeapVirtual(_reservedSize);
+        if (_memoryStart == nullptr) {
+            PANIC("ConcurrentMarkSweepHeap: cannot reserve %zd bytes", _reservedSize);
+        }
+        D("ConcurrentMarkSweepHeap: virtual memory reserved: %p", _memoryStart);
+
+        // Mark bits are committed at once, the space may grow
+        // while Java threads run. Pages never touched cost nothing.
+        _markBitsReservedSize = _reservedSize / HEAP_BYTES_PER_MARK_BYTE;
+        _markBits = (u8 *) Universe::reserveVirtual(_markBitsReservedSize);
+        if (_markBits == nullptr) {
+            PANIC("ConcurrentMarkSweepHeap: cannot reserve %zd bytes for mark bits", _markBitsReservedSize);
+        }
+
+        if (!Universe::commitVirtual(_memoryStart, initialSize)
+            || !Universe::commitVirtual(_markBits, _markBitsReservedSize)) {
+            PANIC("ConcurrentMarkSweepHeap: cannot commit %zd bytes", initialSize);
+        }
+
+        _space._regionStart = _memoryStart;
+        _space._current = _memoryStart;
+        _space._regionSize = initialSize;
+        _initialSize = initialSize;
+        D("ConcurrentMarkSweepHeap: space: %zd, max: %zd", initialSize, _reservedSize);
+    }
+
+    bool ConcurrentMarkSweepHeap::resizeSpace(size_t newSize) {
+        newSize = alignUp(newSize, SPACE_ALIGNMENT);
+        if (newSize < _initialSize) {
+            newSize = _initialSize;
+        }
+        if (newSize > _reservedSize) {
+            newSize = _reservedSize;
+        }
+
+        size_t currentSize = _space.getSize();
+        if (newSize == currentSize) {
+            return true;
+        }
+
+        if (newSize > currentSize) {
+            // Java threads may be allocating, the end only moves
+            // when the memory below it is accessible
+            if (!Universe::commitVirtual(_memoryStart + currentSize, newSize - currentSize)) {
+                return false;
+            }
+        } else {
+            // only the tail above the top can be given back
+            if (newSize < _space.getUsed()) {
+                return false;
+            }
+            Universe::uncommitVirtual(_memoryStart + newSize, currentSize - newSize);
+        }
+
+        _space._regionSize = newSize;
+        D("ConcurrentMarkSweepHeap: space resized: %zd -> %zd", currentSize, newSize);
+        return true;
+    }
+
+    void ConcurrentMarkSweepHeap::adjustSpace() {
+        size_t live = getHeapUsed();
+        size_t capacity = _space.getSize();
+
+        // leave room for the allocation that asked for this collection
+        size_t required = _space.getUsed() + _requiredSize + _tlabSize;
+        _requiredSize = 0;
+
+        if (required > capacity || live * 100 > capacity * GROW_OCCUPANCY) {
+            _lowOccupancyCollections = 0;
+            resizeSpace(std::max(capacity * 2, required));
+
+        } else if (live * 100 < capacity * SHRINK_OCCUPANCY) {
+            if (++_lowOccupancyCollections >= SHRINK_DELAY) {
+                _lowOccupancyCollections = 0;
+                resizeSpace(std::max(capacity / 2, required));
+            }
+
+        } else {
+            _lowOccupancyCollections = 0;
+        }
+    }
+
+    void ConcurrentMarkSweepHeap::growSpaceIfNeeded() {
+        size_t capacity = _space.getSize();
+        if (getHeapUsed() * 100 > capacity * GROW_OCCUPANCY) {
+            resizeSpace(capacity * 2);
+        }
+    }
+
+    void ConcurrentMarkSweepHeap::startCycleIfNeeded() {
+        if (_phase.load(std::memory_order_relaxed) != CYCLE_IDLE
+            || _cycleRequested.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        if (getHeapUsed() * 100 < _space.getSize() * INITIATING_OCCUPANCY) {
+            return;
+        }
+
+        // without a GC thread, nothing could stop Java threads for the pauses
+        if (!GCThread::isInitialized()) {
+            return;
+        }
+
+        LockGuard guard(_markThreadLock);
+        if (_markThreadStopped || _cycleRequested) {
+            return;
+        }
+        if (_markThread == nullptr) {
+            _markThread = new ConcurrentMarkThread(this);
+            _markThread->start();
+        }
+        _cycleRequested = true;
+        _markThreadCond.notify_all();
+    }
+
+    void ConcurrentMarkSweepHeap::markThreadLoop() {
+        while (true) {
+            {
+                std::unique_lock<Lock> guard(_markThreadLock);
+                _markThreadCond.wait(guard, [this]() {
+                    return _markThreadStopped || _cycleRequested;
+                });
+                if (_markThreadStopped) {
+                    return;
+                }
+            }
+
+            collectConcurrently();
+            _cycleRequested = false;
+        }
+    }
+
+    void ConcurrentMarkSweepHeap::stopMarkThread() {
+        ConcurrentMarkThread *thread = nullptr;
+        {
+            LockGuard guard(_markThreadLock);
+            _markThreadStopped = true;
+            thread = _markThread;
+            _markThread = nullptr;
+        }
+        if (thread == nullptr) {
+            return;
+        }
+
+        // stop the cycle in progress
+        _cycleAborted = true;
+        _markThreadCond.notify_all();
+        thread->join();
+        delete thread;
+    }
+
+    bool ConcurrentMarkSweepHeap::runPause(const std::function<void()> &operation) {
+        if (GCThread::isInitialized()) {
+            return GCThread::get()->runAtSafepoint(GC_CONCURRENT, operation);
+        }
+
+        // no Java thread runs without a GC thread, e.g. in tests
+        operation();
+        return true;
+    }
+
+    void ConcurrentMarkSweepHeap::beginConcurrentWork() {
+        std::unique_lock<Lock> guard(_suspendLock);
+        _suspendCond.wait(guard, [this]() {
+            return !_suspendRequested;
+        });
+        _concurrentWorkActive = true;
+    }
+
+    void ConcurrentMarkSweepHeap::endConcurrentWork() {
+        std::lock_guard<Lock> guard(_suspendLock);
+        _concurrentWorkActive = false;
+        _suspendCond.notify_all();
+    }
+
+    bool ConcurrentMarkSweepHeap::yieldConcurrentWork() {
+        std::unique_lock<Lock> guard(_suspendLock);
+        _concurrentWorkActive = false;
+        _suspendCond.notify_all();
+        _suspendCond.wait(guard, [this]() {
+            return !_suspendRequested;
+        });
+        _concurrentWorkActive = true;
+        return !_cycleAborted;
+    }
+
+    void ConcurrentMarkSweepHeap::suspendConcurrentWork() {
+        std::unique_lock<Lock> guard(_suspendLock);
+        _suspendRequested = true;
+        _suspendCond.wait(guard, [this]() {
+            return !_concurrentWorkActive;
+        });
+    }
+
+    void ConcurrentMarkSweepHeap::resumeConcurrentWork() {
+        std::lock_guard<Lock> guard(_suspendLock);
+        _suspendRequested = false;
+        _suspendCond.notify_all();
+    }
+}
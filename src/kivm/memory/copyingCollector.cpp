@@ -3,236 +3,495 @@
 //
 
 #include <kivm/memory/copyingHeap.h>
-#include <kivm/oop/instanceKlass.h>
-#include <kivm/oop/instanceOop.h>
-#include <kivm/oop/arrayOop.h>
-#include <kivm/oop/mirrorOop.h>
+#include <kivm/memory/gcRoots.h>
+#include <kivm/memory/oopClosure.h>
 #include <kivm/runtime/javaThread.h>
-#include <sparsepp/spp.h>
-#include <kivm/bytecode/execution.h>
-#include <kivm/native/java_lang_Class.h>
-
-
-// GC-Roots include:
-// [*] 0. InstanceKlass::_staticFieldValues
-// [*] 1. InstanceKlass::_javaMirror
-// [*] 2. InstanceKlass::_javaLoader
-// [*] 3. InstanceKlass::_runtimePool's Strings
-// [*] 4. instanceOopDesc::_instanceFieldValues
-// [*] 5. arrayOopDesc::_elements
-// [*] 6. JavaThread::_javaThreadObject
-// [*] 7. JavaThread::_exceptionOop
-// [*] 8. JavaThread::_frames[0 ~ the last frame]::_locals
-// [*] 9. JavaThread::_frames[0 ~ the last frame]::_stack
+#include <kivm/memory/referenceProcessor.h>
+#include <cstring>
+#include <kivm/oop/monitorTable.h>
+
+// Size of promotion buffers, a multiple of the card size.
+#define PROMOTION_BUFFER_SIZE (32 * 1024)
+
+// Objects larger than this are copied outside promotion buffers.
+#define PROMOTION_BUFFER_MAX_OBJECT (PROMOTION_BUFFER_SIZE / 4)
+
+#define CARDS_PER_TASK 1024
+
+// Objects are evacuated in parallel by GC workers.
+// Forwarding pointers are stored in the old object's header,
+// see markOopDesc::tryClaim() and markOopDesc::forwardTo().
+// Copied objects are queued in the copying worker's deque,
+// idle workers steal from others.
+//
+// Minor collections copy eden and survivor space only,
+// dirty cards of the old generation are scanned as extra roots.
+// Full collections copy everything into the other old semispace.
+//
+// Promotion buffers in the old generation start at card boundaries
+// during collections, so every card is owned by a single worker,
+// and object starts can be recorded without synchronization.
+//
+// Roots are enumerated by GCRoots, with copying workers as closures.
+// Dirty cards of the old generation are extra roots in minor collections.
 
 namespace kivm {
-    void CopyingHeap::copyObject(HeapRegion *newRegion, HashMap<oop, oop> &map,
-                                 oop &target) {
-        // there is no need to copy null objects
+    /**
+     * Size of the object or filler at {@code p}, aligned.
+     */
+    static inline size_t getBlockSize(jbyte *p) {
+        if (HeapRegion::isFiller(p)) {
+            return HeapRegion::getFillerSize(p);
+        }
+        return alignUp(((oop) p)->getObjectSize(), sizeof(jlong));
+    }
+
+    void CopyingWorker::doOop(oop *slot) {
+        _heap->copyObject(this, *slot);
+    }
+
+    void *CopyingHeap::allocateCopy(CopyingWorker *worker, oop object, size_t size) {
+        HeapRegion *preferred = nullptr;
+        HeapRegion *fallback = nullptr;
+
+        if (_fullCollection) {
+            preferred = _oldTarget;
+            fallback = _survivorTo;
+        } else if (_eden->contains(object)) {
+            // first survival
+            preferred = _survivorTo;
+            fallback = _oldTarget;
+        } else {
+            // survived twice, promote it
+            preferred = _oldTarget;
+            fallback = _survivorTo;
+        }
+
+        void *m = allocateCopyIn(worker, preferred, size);
+        if (m == nullptr) {
+            m = allocateCopyIn(worker, fallback, size);
+        }
+        if (m == nullptr) {
+            PANIC("CopyingHeap: to-space overflow");
+        }
+        return m;
+    }
+
+    void *CopyingHeap::allocateCopyIn(CopyingWorker *worker, HeapRegion *region, size_t size) {
+        bool isOld = region == _oldTarget;
+        auto &buffer = isOld ? worker->_oldBuffer : worker->_survivorBuffer;
+
+        // fast path
+        void *m = buffer.allocate(size);
+        if (m != nullptr) {
+            return m;
+        }
+
+        if (size <= PROMOTION_BUFFER_MAX_OBJECT) {
+            // refill
+            auto chunk = (jbyte *) region->allocateAtomic(PROMOTION_BUFFER_SIZE);
+            if (chunk != nullptr) {
+                retireBuffer(buffer, region, false);
+                buffer.fill(chunk, PROMOTION_BUFFER_SIZE);
+                return buffer.allocate(size);
+            }
+        }
+
+        // Allocate directly in the region, old objects
+        // take whole cards to keep buffers card-aligned.
+        size_t chunkSize = isOld ? alignUp(size, CardTable::CARD_SIZE) : size;
+        auto chunk = (jbyte *) region->allocateAtomic(chunkSize);
+        if (chunk != nullptr && chunkSize > size) {
+            HeapRegion::fill(chunk + size, chunkSize - size);
+        }
+        return chunk;
+    }
+
+    void CopyingHeap::retireBuffer(ThreadLocalAllocBuffer &buffer, HeapRegion *region, bool giveBack) {
+        if (buffer._start == nullptr) {
+            return;
+        }
+
+        jbyte *top = buffer._top;
+        jbyte *end = buffer._end;
+        buffer.reset();
+        if (top == end) {
+            return;
+        }
+
+        // Only when nobody has allocated after this buffer
+        if (giveBack && cmpxchg(&region->_current, end, top) == end) {
+            return;
+        }
+        HeapRegion::fill(top, end - top);
+    }
+
+    void CopyingHeap::copyObject(CopyingWorker *worker, oop &target) {
         if (target == nullptr) {
             return;
         }
 
-        // Object has been already copied to new region
-        auto iter = map.find(target);
-        if (iter != map.end()) {
-            target = iter->second;
+        // large objects never move, full collections mark them
+        if (_fullCollection && _largeObjects.contains(target)) {
+            if (_largeObjects.mark(target)) {
+                if (target->getMarkOop()->hasMonitor()) {
+                    MonitorTable::markLive(target->getMarkOop()->getMonitorIndex());
+                }
+                worker->_queue.push(target);
+            }
             return;
         }
 
-        // Copy to new region
-        auto newOop = target->copy();
-        map.insert(std::make_pair(target, newOop));
+        // there is no need to copy objects outside the collected generation
+        if (!shouldCopy(target)) {
+            return;
+        }
 
-        assert(target->getMarkOop() != newOop->getMarkOop());
+        // Object has been already copied to new region,
+        // or is being copied by another worker
+        auto mark = target->getMarkOop();
+        u8 header = mark->getValue();
+        if (mark->isForwarded()) {
+            target = mark->waitForForwardee();
+            return;
+        }
+        if (_workers.size() > 1 && !mark->tryClaim(header)) {
+            target = mark->waitForForwardee();
+            return;
+        }
+
+        // Copy to new region, header and body as a whole.
+        // Objects in the new region are kept aligned
+        // so that scanning can walk them one by one.
+        size_t size = alignUp(target->getObjectSize(), sizeof(jlong));
+        auto newOop = (oop) allocateCopy(worker, target, size);
+        memcpy((void *) newOop, (void *) target, size);
+
+        // the header was replaced by our claim
+        newOop->getMarkOop()->setValue(header);
+        if (_oldTarget->contains(newOop)) {
+            _cardTable.recordObjectStart(newOop);
+        }
+
+        // only full collections see every live monitor,
+        // minor collections only follow monitors of young objects
+        if (newOop->getMarkOop()->hasMonitor()) {
+            u4 monitorIndex = newOop->getMarkOop()->getMonitorIndex();
+            if (_fullCollection) {
+                MonitorTable::markLive(monitorIndex);
+            }
+            if (isYoung(newOop)) {
+                MonitorTable::recordYoungOwner(monitorIndex, newOop->getMarkOop());
+            }
+        }
+
+        // leave the new address in the old header
+        std::atomic_thread_fence(std::memory_order_release);
+        mark->forwardTo(newOop);
         target = newOop;
+        ++worker->_copiedObjects;
+        worker->_queue.push(newOop);
+    }
+
+    void CopyingHeap::copyField(CopyingWorker *worker, oop *slot) {
+        copyObject(worker, *slot);
+        if (*slot != nullptr && isOld(slot) && isYoung(*slot)) {
+            _cardTable.markCard(slot);
+        }
+    }
 
-        assert(target == newOop);
-        assert(target->getMarkOop() == newOop->getMarkOop());
-        assert(target->getClass() == newOop->getClass());
+    void CopyingHeap::scanObject(CopyingWorker *worker, oop object, jbyte *from, jbyte *to) {
+        // a referent that may die is left to processReferences()
+        oop *referent = _referenceProcessor->discover(object, from, to, [this](oop target) {
+            return shouldCopy(target) || (_fullCollection && _largeObjects.contains(target));
+        });
 
-        // Copy object's data
-        oopType type = target->getMarkOop()->getOopType();
-        switch (type) {
-            case oopType::INSTANCE_OOP: {
-                auto instance = (instanceOop) target;
+        OopIterator::iterate(object, from, to, [=](oop *slot) {
+            if (slot != referent) {
+                copyField(worker, slot);
+            }
+        });
+    }
 
-                // instance fields
-                for (auto &item : instance->_instanceFieldValues) {
-                    copyObject(newRegion, map, item);
-                }
-                break;
+    void CopyingHeap::scanDirtyCards(CopyingWorker *worker, size_t firstCard, size_t lastCard,
+                                     jbyte *scanEnd) {
+        jbyte *spaceStart = _oldFrom->_regionStart;
+
+        for (size_t card = firstCard; card <= lastCard; ++card) {
+            if (!_cardTable.isDirty(card)) {
+                continue;
             }
 
-            case oopType::OBJECT_ARRAY_OOP:
-            case oopType::TYPE_ARRAY_OOP: {
-                auto array = (arrayOop) target;
+            // copyField() dirties the card again
+            // if it still holds old-to-young references
+            _cardTable.cleanCard(card);
+
+            jbyte *cardStart = _cardTable.getCardStart(card);
+            jbyte *cardEnd = cardStart + CardTable::CARD_SIZE;
+            if (cardEnd > scanEnd) {
+                cardEnd = scanEnd;
+            }
 
-                // array elements
-                for (auto &item : array->_elements) {
-                    copyObject(newRegion, map, item);
+            // walk objects covering this card
+            jbyte *p = _cardTable.findObjectStart(card, spaceStart);
+            while (p < cardEnd) {
+                size_t size = getBlockSize(p);
+                if (p + size > cardStart && !HeapRegion::isFiller(p)) {
+                    scanObject(worker, (oop) p, cardStart, cardEnd);
                 }
-                break;
+                p += size;
             }
+        }
+    }
 
-            case oopType::PRIMITIVE_OOP:
-                // everything is copied in oopDesc::copy(), so here do nothing
-                break;
+    void CopyingHeap::scanLargeObjectCards(CopyingWorker *worker, jbyte *chunk, size_t size) {
+        // the object is only read when it has dirty cards
+        auto object = (oop) chunk;
+        size_t firstCard = _cardTable.getCardIndex(chunk);
+        size_t lastCard = _cardTable.getCardIndex(chunk + size - 1);
 
-            default:
-                SHOULD_NOT_REACH_HERE();
+        for (size_t card = firstCard; card <= lastCard; ++card) {
+            if (!_cardTable.isDirty(card)) {
+                continue;
+            }
+
+            // copyField() dirties the card again
+            // if it still holds old-to-young references
+            _cardTable.cleanCard(card);
+            jbyte *cardStart = _cardTable.getCardStart(card);
+            scanObject(worker, object, cardStart, cardStart + CardTable::CARD_SIZE);
         }
     }
 
-    void CopyingHeap::copyClass(HeapRegion *newRegion, HashMap<oop, oop> &map,
-                                Klass *klass) {
-        if (klass == nullptr) {
-            return;
+    void CopyingHeap::prepareRootTasks(jbyte *scanEnd) {
+        _rootTasks.clear();
+        _nextRootTask = 0;
+
+        std::vector<GCRoots::Task> tasks;
+        GCRoots::collectTasks(tasks);
+        for (auto &task : tasks) {
+            _rootTasks.emplace_back([task](CopyingWorker *worker) {
+                task(worker);
+            });
         }
 
-        // java mirror
-        oop javaMirror = klass->_javaMirror;
-        copyObject(newRegion, map, javaMirror);
-        klass->_javaMirror = (mirrorOop) javaMirror;
+        // dirty cards, in ranges
+        if (scanEnd != nullptr && scanEnd > _oldFrom->_regionStart) {
+            size_t firstCard = _cardTable.getCardIndex(_oldFrom->_regionStart);
+            size_t lastCard = _cardTable.getCardIndex(scanEnd - 1);
+            for (size_t begin = firstCard; begin <= lastCard; begin += CARDS_PER_TASK) {
+                size_t end = std::min(begin + CARDS_PER_TASK - 1, lastCard);
+                _rootTasks.emplace_back([this, begin, end, scanEnd](CopyingWorker *worker) {
+                    auto start = std::chrono::steady_clock::now();
+                    scanDirtyCards(worker, begin, end, scanEnd);
+                    GCRoots::addScanTime(ROOTS_DIRTY_CARDS, std::chrono::steady_clock::now() - start);
+                });
+            }
+        }
 
-        switch (klass->getClassType()) {
-            case ClassType::INSTANCE_CLASS: {
-                // java loader
-                auto instanceClass = (InstanceKlass *) klass;
-                oop javaLoader = instanceClass->_javaLoader;
-                copyObject(newRegion, map, javaLoader);
-                instanceClass->_javaLoader = (mirrorOop) javaLoader;
+        // dirty cards of large objects, one task per object
+        if (scanEnd != nullptr) {
+            _largeObjects.chunkIterate([this](jbyte *chunk, size_t size) {
+                _rootTasks.emplace_back([this, chunk, size](CopyingWorker *worker) {
+                    auto start = std::chrono::steady_clock::now();
+                    scanLargeObjectCards(worker, chunk, size);
+                    GCRoots::addScanTime(ROOTS_DIRTY_CARDS, std::chrono::steady_clock::now() - start);
+                });
+            });
+        }
+    }
 
-                // static fields
-                for (auto &item : instanceClass->_staticFieldValues) {
-                    copyObject(newRegion, map, item);
-                }
+    void CopyingHeap::workOn(CopyingWorker *worker) {
+        size_t task;
+        while ((task = _nextRootTask++) < _rootTasks.size()) {
+            _rootTasks[task](worker);
+        }
 
-                // runtime constant pool strings
-                auto rt = instanceClass->getRuntimeConstantPool();
-                for (int i = 1; i < rt->_entryCount; ++i) {
-                    if (rt->_rawPool[i] != nullptr
-                        && rt->getConstantTag(i) == CONSTANT_String) {
-                        oop stringOop = Resolver::instance(rt->_pool[i]);
-                        if (stringOop == nullptr) {
-                            continue;
-                        }
-                        copyObject(newRegion, map, stringOop);
-                        rt->_pool[i] = stringOop;
-                    }
-                }
-                break;
+        oop object = nullptr;
+        while (true) {
+            while (worker->_queue.pop(object)) {
+                jbyte *start = (jbyte *) object;
+                scanObject(worker, object, start, start + object->getObjectSize());
             }
 
-            case ClassType::OBJECT_ARRAY_CLASS:
-            case ClassType::TYPE_ARRAY_CLASS: {
-                // java loader
-                auto arrayClass = (ArrayKlass *) klass;
-                oop javaLoader = arrayClass->_javaLoader;
-                copyObject(newRegion, map, javaLoader);
-                arrayClass->_javaLoader = (mirrorOop) javaLoader;
-                break;
+            if (_queueSet.steal(worker->_workerId, object)) {
+                worker->_queue.push(object);
+                continue;
             }
 
-            default:
-                SHOULD_NOT_REACH_HERE();
+            if (_queueSet.offerTermination()) {
+                break;
+            }
         }
     }
 
-    void CopyingHeap::copyThread(HeapRegion *newRegion, HashMap<oop, oop> &map,
-                                 JavaThread *thread) {
-        D("[GCThread]: copying exception oop");
-        oop exceptionOop = thread->_exceptionOop;
-        copyObject(newRegion, map, exceptionOop);
-        thread->_exceptionOop = (instanceOop) exceptionOop;
-
-        D("[GCThread]: copying thread oop");
-        oop javaThreadOop = thread->_javaThreadObject;
-        copyObject(newRegion, map, javaThreadOop);
-        thread->_javaThreadObject = (instanceOop) javaThreadOop;
+    void CopyingHeap::evacuate(HeapRegion *oldTarget) {
+        _oldTarget = oldTarget;
 
-        D("[GCThread]: copying thread arguments");
-        for (auto &item : thread->_args) {
-            copyObject(newRegion, map, item);
+        // start promotion buffers at a card boundary
+        jbyte *top = oldTarget->_current;
+        size_t gap = alignUp((size_t) top, CardTable::CARD_SIZE) - (size_t) top;
+        if (gap > 0 && oldTarget->shouldAllocate(gap)) {
+            oldTarget->allocate(gap);
+            HeapRegion::fill(top, gap);
+            _cardTable.recordObjectStart(top);
         }
 
-        auto currentFrame = thread->_frames._current;
-        while (currentFrame != nullptr) {
-            D("[GCThread]: copying frame %p: locals", currentFrame);
-            copySlotArray(newRegion, map, &currentFrame->_locals._array, currentFrame->_locals._array._size);
-            D("[GCThread]: copying frame %p: stacks", currentFrame);
-            copySlotArray(newRegion, map, &currentFrame->_stack._array, currentFrame->_stack._sp);
-            currentFrame = currentFrame->getPrevious();
+        _queueSet.resetTermination();
+        _workerPool->runTask([this](int workerId) {
+            workOn(_workers[workerId]);
+        });
+
+        for (auto worker : _workers) {
+            retireBuffer(worker->_survivorBuffer, _survivorTo, true);
+            retireBuffer(worker->_oldBuffer, oldTarget, true);
+            _copiedObjects += worker->_copiedObjects;
+            worker->_copiedObjects = 0;
         }
+        _rootTasks.clear();
     }
 
-    void CopyingHeap::copySlotArray(HeapRegion *newRegion, HashMap<oop, oop> &map,
-                                    SlotArray *slotArray, int size) {
-        for (int i = 0; i < size; ++i) {
-            Slot *slot = slotArray->_elements + i;
-            if (slot->isObject) {
-                auto object = Resolver::javaOop(slot->ref);
-                if (object != nullptr) {
-                    copyObject(newRegion, map, object);
-                    slot->ref = object;
-                }
+    size_t CopyingHeap::processReferences() {
+        auto keepAlive = [this](oop *slot) {
+            oop referent = *slot;
+            if (_largeObjects.contains(referent)) {
+                return _largeObjects.isMarked(referent);
             }
-        }
-    }
 
-    void CopyingHeap::doGarbageCollection() {
-        HeapRegion *current = this->_currentRegion;
-        HeapRegion *next = this->_nextRegion;
+            auto mark = referent->getMarkOop();
+            if (mark->isForwarded()) {
+                *slot = mark->getForwardee();
+                return true;
+            }
+            return false;
+        };
 
-        size_t total = current->getSize();
-        size_t beforeUsed = current->getUsed();
+        // cleared references are linked into the pending list
+        auto onStore = [this](oop *slot) {
+            if (*slot != nullptr && isOld(slot) && isYoung(*slot)) {
+                _cardTable.markCard(slot);
+            }
+        };
+        return _referenceProcessor->process(keepAlive, onStore);
+    }
 
-        // TODO: use a more elegant way to allocate new objects during gc
-        // CopyingHeap::copy() need to use oopDesc::copy() which may cause allocation,
-        // and there is no need to lock, because we have already stopped the world.
-        // In further implementations, it is important to deprecate this ugly workaround
-        // if we are implementing an concurrent garbage collector.
-        this->_currentRegion = next;
+    size_t CopyingHeap::freeYoungMonitors(const std::vector<std::pair<u4, markOop>> &youngOwners) {
+        size_t freed = 0;
+        for (const auto &owner : youngOwners) {
+            markOop mark = owner.second;
 
-        // the old->new oop map
-        HashMap<oop, oop> map;
+            // Objects outside eden and from-survivor were not collected,
+            // and survivors were recorded again when they were copied.
+            // Objects left behind are dead, their headers are intact.
+            if (!shouldCopy(mark) || mark->isForwarded()) {
+                continue;
+            }
+            if (mark->hasMonitor() && mark->getMonitorIndex() == owner.first) {
+                MonitorTable::release(owner.first);
+                ++freed;
+            }
+        }
+        return freed;
+    }
 
-        D("[GCThread]: copying primitive types's java mirrors");
-        for (auto &item :java::lang::Class::_primitiveTypeMirrors) {
-            oop mirror = item.second;
-            copyObject(next, map, mirror);
-            item.second = (mirrorOop) mirror;
+    void CopyingHeap::doGarbageCollection() {
+        // a minor collection may promote every young object
+        size_t worstPromotion = _eden->getUsed() + _survivorFrom->getUsed();
+        if (_fullCollectionRequired || _oldFrom->getFree() <= worstPromotion) {
+            doFullCollection();
+        } else {
+            doMinorCollection();
         }
+    }
 
-        D("[GCThread]: copying intern string pool");
-        auto internStringPool = java::lang::InternStringPool::getGlobal();
-        for (auto &item : internStringPool->_pool) {
-            oop stringOop = item.second;
-            copyObject(next, map, stringOop);
-            item.second = (instanceOop) stringOop;
+    void CopyingHeap::doMinorCollection() {
+        size_t youngUsed = _eden->getUsed() + _survivorFrom->getUsed();
+        size_t oldUsed = _oldFrom->getUsed() + _largeObjects.getUsed();
+        GCEvent event = beginPause("minor", youngUsed + oldUsed);
+        this->_fullCollection = false;
+        this->_copiedObjects = 0;
+        beginReferenceDiscovery(youngUsed + oldUsed, false);
+
+        auto youngOwners = MonitorTable::takeYoungOwners();
+        prepareRootTasks(_oldFrom->_current);
+
+        D("[GCThread]: evacuating with %d workers", _workerPool->getWorkerCount());
+        evacuate(_oldFrom);
+        size_t clearedReferences = processReferences();
+        size_t freedMonitors = freeYoungMonitors(youngOwners);
+
+        // Done, eden and from-survivor are free now
+        retireTlabs();
+        _eden->reset();
+        _survivorFrom->reset();
+        std::swap(_survivorFrom, _survivorTo);
+
+        // promotion of the next minor collection may not fit
+        _heapExhausted = false;
+        if (_oldFrom->getFree() <= _eden->getSize() + _survivorFrom->getUsed()) {
+            _fullCollectionRequired = true;
         }
 
-        D("[GCThread]: copying loaded classes");
-        auto sd = SystemDictionary::get();
-        for (const auto &loadedClass : sd->getLoadedClasses()) {
-            auto klass = loadedClass.second;
-            copyClass(next, map, klass);
+        D("[GCDetails]: [minor: young %zd -> %zd, old %zd -> %zd, oops: %zd, freed monitors: %zd, "
+          "cleared references: %zd]",
+            youngUsed, _survivorFrom->getUsed(), oldUsed, _oldFrom->getUsed() + _largeObjects.getUsed(),
+            _copiedObjects, freedMonitors, clearedReferences);
+        endPause(event, _survivorFrom->getUsed() + _oldFrom->getUsed() + _largeObjects.getUsed(), _copiedObjects);
+    }
+
+    void CopyingHeap::doFullCollection() {
+        size_t beforeUsed = _eden->getUsed() + _survivorFrom->getUsed() + _oldFrom->getUsed()
+                            + _largeObjects.getUsed();
+        GCEvent event = beginPause("full", beforeUsed);
+        this->_fullCollection = true;
+        this->_fullCollectionRequired = false;
+        this->_copiedObjects = 0;
+        beginReferenceDiscovery(beforeUsed, true);
+
+        expandForFullCollection();
+
+        // the sweep below frees monitors of all dead objects
+        MonitorTable::takeYoungOwners();
+
+        // every old object will be copied and re-recorded
+        _cardTable.reset(_oldTo->_regionStart, _oldTo->getSize());
+        // and every live large object will be scanned as a whole
+        if (_largeObjects.getTop() > _largeObjects.getStart()) {
+            _cardTable.reset(_largeObjects.getStart(), _largeObjects.getTop() - _largeObjects.getStart());
         }
 
-        D("[GCThread]: copying threads, locals and stacks");
-        Threads::forEach([&](JavaThread *thread) {
-            copyThread(next, map, thread);
-            return false;
-        });
+        prepareRootTasks(nullptr);
+
+        D("[GCThread]: evacuating with %d workers", _workerPool->getWorkerCount());
+        evacuate(_oldTo);
+
+        // before large objects are swept, their marks are needed
+        D("[GCThread]: clearing references to unreachable objects");
+        size_t clearedReferences = processReferences();
+
+        D("[GCThread]: freeing monitors of unreachable objects");
+        size_t freedMonitors = MonitorTable::sweep();
+
+        D("[GCThread]: freeing unreachable large objects");
+        size_t freedLarge = _largeObjects.sweep();
 
         // Done, free all unreachable objects
         // and make preparations for the next routine of gc
-        current->reset();
-        memset(current->_regionStart, '\0', current->_regionSize);
-        this->_nextRegion = current;
-
-        size_t afterUsed = next->getUsed();
-        D("[GCDetails]: [%zd -> %zd(%zd), oops: %zd]",
-            beforeUsed, afterUsed, total, map.size());
+        retireTlabs();
+        _eden->reset();
+        _survivorFrom->reset();
+        _oldFrom->reset();
+        std::swap(_survivorFrom, _survivorTo);
+        std::swap(_oldFrom, _oldTo);
+        this->_fullCollection = false;
+
+        adjustOldGeneration();
+
+        size_t afterUsed = _survivorFrom->getUsed() + _oldFrom->getUsed() + _largeObjects.getUsed();
+        D("[GCDetails]: [full: %zd -> %zd(%zd), oops: %zd, freed monitors: %zd, freed large: %zd, "
+          "cleared references: %zd]",
+            beforeUsed, afterUsed, getHeapSize(), _copiedObjects, freedMonitors, freedLarge,
+            clearedReferences);
+        endPause(event, afterUsed, _copiedObjects);
     }
 }
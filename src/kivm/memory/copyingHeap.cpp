@@ -4,94 +4,372 @@
 
 #include <kivm/memory/copyingHeap.h>
 #include <kivm/memory/universe.h>
+#include <kivm/memory/allocationSampler.h>
 #include <kivm/runtime/runtimeConfig.h>
 #include <cmath>
-#include <kivm/memory/gcThread.h>
+#include <algorithm>
 #include <kivm/runtime/javaThread.h>
 
-#define REGION_COUNT 2
+#define REGION_COUNT 5
+#define REGION_ALIGNMENT (64 * 1024)
 
 namespace kivm {
     CopyingHeap::CopyingHeap()
         : _memoryStart(nullptr),
-          _totalSize(RuntimeConfig::get().initialHeapSizeInBytes),
+          _initialSize(RuntimeConfig::get().initialHeapSizeInBytes),
+          _maxSize(RuntimeConfig::get().maxHeapSizeInBytes),
           _regions(nullptr),
-          _currentRegion(nullptr),
-          _nextRegion(nullptr) {
-        D("CopyingHeap: initialHeapSize: %zd", _totalSize);
+          _largeObjectThreshold(RuntimeConfig::get().largeObjectThresholdInBytes),
+          _tlabSize(alignUp(RuntimeConfig::get().tlabSizeInBytes, sizeof(jlong))),
+          _nextRootTask(0) {
+        if (_maxSize < _initialSize) {
+            _maxSize = _initialSize;
+        }
+        D("CopyingHeap: initialHeapSize: %zd, maxHeapSize: %zd, tlabSize: %zd",
+            _initialSize, _maxSize, _tlabSize);
     }
 
     CopyingHeap::~CopyingHeap() {
+        delete _workerPool;
+        for (auto worker : _workers) {
+            delete worker;
+        }
+
         if (_memoryStart != nullptr) {
-            Universe::deallocVirtual(_memoryStart);
+            Universe::releaseVirtual(_memoryStart, _reservedSize);
             _memoryStart = nullptr;
         }
     }
 
     void *CopyingHeap::allocate(size_t size) {
-        if (_currentRegion->shouldAllocate(size)) {
-            return _currentRegion->allocate(size);
+        // keep objects aligned, so that copied objects can be walked
+        size = alignUp(size, sizeof(jlong));
+
+        if (size >= _largeObjectThreshold) {
+            AllocationSampler::sample(Threads::currentThread(), size);
+            return allocateLarge(size);
+        }
+
+        if (size >= _pretenureThreshold) {
+            AllocationSampler::sample(Threads::currentThread(), size);
+            return allocateOld(size);
         }
 
-        // out of memory, let's try GC
         auto currentThread = Threads::currentThread();
+        void *m = allocateYoung(currentThread, size);
+        if (m != nullptr) {
+            return m;
+        }
+
+        // out of memory, let's try GC
         if (currentThread == nullptr) {
             PANIC("OutOfMemoryError: heap (not in JavaThread)");
         }
 
-        auto gc = GCThread::get();
-        if (gc != nullptr) {
-            D("CopyingHeap: out of memory, will retry after GC, required size: %zd", size);
-            auto triggeredMonitor = gc->required();
+        D("CopyingHeap: out of memory, will retry after GC, required size: %zd", size);
+        if (collectAndWait(currentThread) && !_heapExhausted) {
+            // try again
+            D("CopyingHeap: retry");
+            m = allocateYoung(currentThread, size);
+            if (m != nullptr) {
+                D("CopyingHeap: successfully allocated %zd bytes after GC", size);
+                return m;
+            }
+        }
+
+        // last try, with everything softly reachable freed
+        _fullCollectionRequired = true;
+        if (collectClearingSoftReferences(currentThread) && !_heapExhausted) {
+            m = allocateYoung(currentThread, size);
+            if (m != nullptr) {
+                return m;
+            }
+        }
 
-            // this will block current thread until GC is finished
-            currentThread->enterSafepoint();
+        return throwOutOfMemoryError(size);
+    }
+
+    void *CopyingHeap::allocateYoung(JavaThread *thread, size_t size) {
+        // threads other than JavaThreads have no TLAB
+        if (thread == nullptr) {
+            return allocateEden(size);
+        }
+
+        // fast path
+        auto &tlab = thread->getTlab();
+        void *m = tlab.allocate(size);
+        if (m != nullptr) {
+            return m;
+        }
 
-            // GCThread->require() will enter this monitor
-            // we should leave this monitor for the coming GC
-            if (triggeredMonitor != nullptr) {
-                triggeredMonitor->leave();
+        // Do not throw away a TLAB with much free space for a big object,
+        // allocate it directly in eden instead.
+        if (size >= _tlabSize
+            || (size > _tlabSize / 8 && tlab.getFree() > _tlabSize / 8)) {
+            AllocationSampler::sample(thread, size);
+            return allocateEden(size);
+        }
+
+        // refill
+        auto chunk = (jbyte *) allocateEden(_tlabSize);
+        if (chunk == nullptr) {
+            // eden is nearly full, but the remaining space may be enough
+            AllocationSampler::sample(thread, size);
+            return allocateEden(size);
+        }
+        AllocationSampler::sample(thread, _tlabSize);
+        // keep eden walkable
+        HeapRegion::fill(tlab._top, tlab.getFree());
+        tlab.fill(chunk, _tlabSize);
+        return tlab.allocate(size);
+    }
+
+    void *CopyingHeap::allocateEden(size_t size) {
+        if (!fitsFullCollection(size)) {
+            return nullptr;
+        }
+        return _eden->allocateAtomic(size);
+    }
+
+    void CopyingHeap::retireTlabs() {
+        Threads::forEach([](JavaThread *thread) {
+            auto &tlab = thread->getTlab();
+            if (tlab._start != nullptr) {
+                // keep eden walkable
+                HeapRegion::fill(tlab._top, tlab.getFree());
             }
+            tlab.reset();
+            return false;
+        });
+    }
 
-            // try again
-            D("CopyingHeap: retry");
-            if (_currentRegion->shouldAllocate(size)) {
-                D("CopyingHeap: successfully allocated %zd bytes after GC", size);
-                return _currentRegion->allocate(size);
+    void CopyingHeap::objectIterate(const std::function<void(oop)> &callback) {
+        retireTlabs();
+        walkRegion(_oldFrom, callback);
+        walkRegion(_survivorFrom, callback);
+        walkRegion(_eden, callback);
+        _largeObjects.objectIterate(callback);
+    }
+
+    void *CopyingHeap::allocateOld(size_t size) {
+        // object starts must be recorded in address order
+        LockGuard guard(_oldLock);
+
+        if (!_oldFrom->shouldAllocate(size) || !fitsFullCollection(size)) {
+            auto currentThread = Threads::currentThread();
+            if (currentThread == nullptr) {
+                PANIC("OutOfMemoryError: old generation (not in JavaThread)");
+            }
+
+            D("CopyingHeap: old generation is full, required size: %zd", size);
+            // release the lock, or the safepoint would never be reached
+            // by other threads allocating old objects
+            _oldLock.unlock();
+            _fullCollectionRequired = true;
+            if (size > _requiredOldSize) {
+                _requiredOldSize = size;
+            }
+            bool collected = collectAndWait(currentThread);
+
+            // last try, with everything softly reachable freed
+            if (collected && (!_oldFrom->shouldAllocate(size) || !fitsFullCollection(size))) {
+                _fullCollectionRequired = true;
+                collected = collectClearingSoftReferences(currentThread);
+            }
+            _oldLock.lock();
+
+            if (!collected || !_oldFrom->shouldAllocate(size) || !fitsFullCollection(size)) {
+                return throwOutOfMemoryError(size);
             }
         }
 
-        PANIC("OutOfMemoryError: heap");
-        return nullptr;
+        void *m = _oldFrom->allocate(size);
+        _cardTable.recordObjectStart(m);
+        return m;
     }
 
-    void CopyingHeap::initializeAll() {
-        _memoryStart = (jbyte *) Universe::allocVirtual(_totalSize);
-        D("CopyingHeap: virtual memory allocated: %p", _memoryStart);
+    void *CopyingHeap::allocateLarge(size_t size) {
+        void *m = _largeObjects.allocate(size, getLargeObjectLimit());
+        if (m != nullptr) {
+            return m;
+        }
+
+        auto currentThread = Threads::currentThread();
+        if (currentThread == nullptr) {
+            PANIC("OutOfMemoryError: large object space (not in JavaThread)");
+        }
+
+        // only full collections free large objects
+        D("CopyingHeap: large object space is full, required size: %zd", size);
+        _fullCollectionRequired = true;
+        if (collectAndWait(currentThread)) {
+            m = _largeObjects.allocate(size, getLargeObjectLimit());
+            if (m != nullptr) {
+                return m;
+            }
+
+            // last try, with everything softly reachable freed
+            _fullCollectionRequired = true;
+            if (collectClearingSoftReferences(currentThread)) {
+                m = _largeObjects.allocate(size, getLargeObjectLimit());
+                if (m != nullptr) {
+                    return m;
+                }
+            }
+        }
+        return throwOutOfMemoryError(size);
+    }
 
+    void CopyingHeap::initializeAll() {
         initializeRegions();
+        _cardTable.initialize(_memoryStart, _reservedSize);
+
+        _workerPool = new GCWorkerPool(RuntimeConfig::get().gcWorkerThreads);
+        for (int i = 0; i < _workerPool->getWorkerCount(); ++i) {
+            auto worker = new CopyingWorker(this, i);
+            _workers.push_back(worker);
+            _queueSet.addQueue(&worker->_queue);
+        }
     }
 
     void CopyingHeap::initializeRegions() {
-        if (_totalSize < 2 || ((_totalSize & (_totalSize - 1)) != 0)) {
-            PANIC("Heap size should be power of 2");
+        // young generation takes a quarter of the initial heap,
+        // with eden taking 3/4 of young generation.
+        // Every region is aligned so that it can be committed
+        // page by page, and cards never span regions.
+        size_t youngSize = alignDown(_initialSize / 4, REGION_ALIGNMENT);
+        size_t survivorSize = alignDown(youngSize / 8, REGION_ALIGNMENT);
+        size_t edenSize = youngSize - survivorSize * 2;
+        _oldInitialSize = alignDown((_initialSize - youngSize) / 2, REGION_ALIGNMENT);
+        _oldReservedSize = alignDown((_maxSize - youngSize) / 2, REGION_ALIGNMENT);
+        if (survivorSize == 0 || _oldInitialSize == 0) {
+            PANIC("Heap size too small: %zd", _initialSize);
         }
 
-        size_t regionSize = _totalSize / REGION_COUNT;
+        // large objects may take the whole heap
+        size_t largeReservedSize = alignUp(_maxSize, REGION_ALIGNMENT);
+        _reservedSize = youngSize + _oldReservedSize * 2 + largeReservedSize;
+        _memoryStart = (jbyte *) Universe::reserveHeapVirtual(_reservedSize);
+        if (_memoryStart == nullptr) {
+            PANIC("CopyingHeap: cannot reserve %zd bytes", _reservedSize);
+        }
+        D("CopyingHeap: virtual memory reserved: %p", _memoryStart);
+
         _regions = (HeapRegion *) Universe::allocCObject(sizeof(HeapRegion) * REGION_COUNT);
-        _currentRegion = _regions;
-        _nextRegion = _regions + 1;
+        _eden = _regions;
+        _survivorFrom = _regions + 1;
+        _survivorTo = _regions + 2;
+        _oldFrom = _regions + 3;
+        _oldTo = _regions + 4;
 
+        // old semispaces are laid out at their maximum size,
+        // but only the initial size is committed
+        size_t sizes[REGION_COUNT] = {edenSize, survivorSize, survivorSize,
+                                      _oldInitialSize, _oldInitialSize};
+        size_t reserved[REGION_COUNT] = {edenSize, survivorSize, survivorSize,
+                                         _oldReservedSize, _oldReservedSize};
         jbyte *delivering = _memoryStart;
 
-        // setup current and next region
+        // setup all regions
         HeapRegion *hr = nullptr;
         for (int i = 0; i < REGION_COUNT; ++i) {
             hr = _regions + i;
-            hr->_regionSize = regionSize;
+            hr->_regionSize = sizes[i];
             hr->_regionStart = delivering;
             hr->_current = delivering;
-            delivering += regionSize;
+            if (!Universe::commitVirtual(delivering, sizes[i])) {
+                PANIC("CopyingHeap: cannot commit %zd bytes", sizes[i]);
+            }
+            delivering += reserved[i];
+        }
+        _largeObjects.initialize(delivering, largeReservedSize);
+        _totalSize = youngSize + _oldInitialSize * 2;
+
+        // objects that would hardly fit in survivor space go to old generation directly
+        _pretenureThreshold = survivorSize / 2;
+
+        // promotion buffers are retired with some space left, keep an eighth for that
+        _fullCollectionRoom = _oldReservedSize + survivorSize;
+        _fullCollectionRoom -= _fullCollectionRoom / 8;
+        D("CopyingHeap: eden: %zd, survivor: %zd, old: %zd (x2), max old: %zd (x2)",
+            edenSize, survivorSize, _oldInitialSize, _oldReservedSize);
+    }
+
+    bool CopyingHeap::resizeOldGeneration(size_t newSize) {
+        newSize = alignUp(newSize, REGION_ALIGNMENT);
+        if (newSize < _oldInitialSize) {
+            newSize = _oldInitialSize;
         }
+        if (newSize > _oldReservedSize) {
+            newSize = _oldReservedSize;
+        }
+
+        size_t currentSize = _oldFrom->getSize();
+        if (newSize == currentSize) {
+            return true;
+        }
+
+        if (newSize > currentSize) {
+            size_t delta = newSize - currentSize;
+            if (!Universe::commitVirtual(_oldFrom->_regionStart + currentSize, delta)) {
+                return false;
+            }
+            if (!Universe::commitVirtual(_oldTo->_regionStart + currentSize, delta)) {
+                Universe::uncommitVirtual(_oldFrom->_regionStart + currentSize, delta);
+                return false;
+            }
+        } else {
+            // only the tail above live objects can be given back
+            if (newSize < _oldFrom->getUsed() || newSize < _oldTo->getUsed()) {
+                return false;
+            }
+            size_t delta = currentSize - newSize;
+            for (auto region : {_oldFrom, _oldTo}) {
+                _cardTable.reset(region->_regionStart + newSize, delta);
+                Universe::uncommitVirtual(region->_regionStart + newSize, delta);
+            }
+        }
+
+        _oldFrom->_regionSize = newSize;
+        _oldTo->_regionSize = newSize;
+        _totalSize = _eden->getSize() + _survivorFrom->getSize() * 2 + newSize * 2;
+        D("CopyingHeap: old generation resized: %zd -> %zd (x2)", currentSize, newSize);
+        return true;
+    }
+
+    void CopyingHeap::expandForFullCollection() {
+        // every live object may end up in old to-space
+        size_t worstCase = _oldFrom->getUsed() + _eden->getUsed()
+                           + _survivorFrom->getUsed() + _requiredOldSize;
+        if (worstCase > _oldTo->getSize()) {
+            resizeOldGeneration(worstCase);
+        }
+    }
+
+    void CopyingHeap::adjustOldGeneration() {
+        size_t live = _oldFrom->getUsed();
+        size_t capacity = _oldFrom->getSize();
+
+        // leave room for the worst-case promotion of the next minor collection
+        // and the old allocation that asked for this collection
+        size_t required = live + _eden->getSize() + _survivorFrom->getUsed() + _requiredOldSize;
+        _requiredOldSize = 0;
+
+        if (required > capacity || live * 100 > capacity * GROW_OCCUPANCY) {
+            _lowOccupancyCollections = 0;
+            resizeOldGeneration(std::max(capacity * 2, required));
+
+        } else if (live * 100 < capacity * SHRINK_OCCUPANCY) {
+            if (++_lowOccupancyCollections >= SHRINK_DELAY) {
+                _lowOccupancyCollections = 0;
+                resizeOldGeneration(std::max(capacity / 2, required));
+            }
+
+        } else {
+            _lowOccupancyCollections = 0;
+        }
+
+        // still no room at the maximum size
+        _heapExhausted = _oldFrom->getFree() <= _eden->getSize() + _survivorFrom->getUsed();
     }
 }
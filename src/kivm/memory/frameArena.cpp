@@ -0,0 +1,90 @@
+//
+// Per-thread arena for objects that never escape their frame
+//
+
+#include <kivm/memory/frameArena.h>
+#include <kivm/memory/universe.h>
+#include <kivm/oop/oop.h>
+#include <kivm/runtime/runtimeConfig.h>
+
+namespace kivm {
+    FrameArena::~FrameArena() {
+        for (auto &chunk : _chunks) {
+            Universe::deallocCObject(chunk._start);
+        }
+    }
+
+    void *FrameArena::allocateSlow(size_t size) {
+        if (size > CHUNK_SIZE) {
+            return nullptr;
+        }
+
+        // the rest of the current chunk is wasted until frames return
+        size_t next = 0;
+        if (_top != nullptr) {
+            _chunks[_current]._top = _top;
+            next = _current + 1;
+        }
+
+        if (next == _chunks.size()) {
+            if ((next + 1) * CHUNK_SIZE > RuntimeConfig::get().frameArenaSizeInBytes) {
+                return nullptr;
+            }
+            auto start = (jbyte *) Universe::allocCObject(CHUNK_SIZE);
+            if (start == nullptr) {
+                return nullptr;
+            }
+            _chunks.push_back(Chunk{start, start + CHUNK_SIZE, start});
+        }
+
+        _current = next;
+        _top = _chunks[next]._start;
+        _end = _chunks[next]._end;
+        return allocate(size);
+    }
+
+    bool FrameArena::contains(void *addr) const {
+        if (_top == nullptr) {
+            return false;
+        }
+
+        for (size_t i = 0; i <= _current; ++i) {
+            const auto &chunk = _chunks[i];
+            jbyte *top = i == _current ? _top : chunk._top;
+            if (addr >= chunk._start && addr < top) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t FrameArena::getUsed() const {
+        if (_top == nullptr) {
+            return 0;
+        }
+
+        size_t used = 0;
+        for (size_t i = 0; i <= _current; ++i) {
+            const auto &chunk = _chunks[i];
+            used += (i == _current ? _top : chunk._top) - chunk._start;
+        }
+        return used;
+    }
+
+    void FrameArena::objectIterate(const std::function<void(oop)> &callback) const {
+        if (_top == nullptr) {
+            return;
+        }
+
+        for (size_t i = 0; i <= _current; ++i) {
+            const auto &chunk = _chunks[i];
+            jbyte *top = i == _current ? _top : chunk._top;
+            jbyte *current = chunk._start;
+            while (current < top) {
+                auto object = (oop) current;
+                current += alignUp(object->getObjectSize(), sizeof(jlong));
+                callback(object);
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+//
+// JSON lines logger of GC events
+//
+#include <kivm/memory/gcLogger.h>
+#include <kivm/kivm.h>
+#include <kivm/oop/method.h>
+#include <kivm/oop/instanceKlass.h>
+#include <cerrno>
+#include <cstring>
+
+namespace kivm {
+    GCLogger *GCLogger::open(const std::string &path) {
+        if (path.empty()) {
+            return new GCLogger(stdout, false);
+        }
+
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            WARN("GCLogger: cannot open %s: %s", path.c_str(), strerror(errno));
+            return nullptr;
+        }
+        return new GCLogger(file, true);
+    }
+
+    GCLogger::~GCLogger() {
+        if (_ownsFile) {
+            fclose(_file);
+        } else {
+            fflush(_file);
+        }
+    }
+
+    void GCLogger::onGCEvent(const GCEvent &event) {
+        bool end = event._type == GC_PAUSE_END;
+        fprintf(_file, "{\"event\":\"%s\",\"id\":%zu,\"collection\":\"%s\","
+                       "\"uptime_us\":%lld,\"time_to_safepoint_us\":%lld,"
+                       "\"used_before\":%zu,\"heap_size\":%zu",
+            end ? "pause_end" : "pause_start",
+            event._id, event._collection,
+            (long long) event._uptime.count(),
+            (long long) event._timeToSafepoint.count(),
+            event._usedBefore, event._heapSize);
+
+        if (end) {
+            fprintf(_file, ",\"pause_us\":%lld,\"used_after\":%zu,\"objects_copied\":%zu,\"root_scan_us\":{",
+                (long long) event._pauseTime.count(), event._usedAfter, event._objectsCopied);
+            for (int i = 0; i < ROOT_CATEGORY_COUNT; ++i) {
+                fprintf(_file, "%s\"%s\":%lld", i == 0 ? "" : ",",
+                    GCEvent::getRootCategoryName((GCRootCategory) i),
+                    (long long) event._rootScanTime[i].count());
+            }
+            fputc('}', _file);
+
+            fputs(",\"allocation_sites\":[", _file);
+            for (int i = 0; i < event._allocationSiteCount; ++i) {
+                const AllocationSite &site = event._allocationSites[i];
+                Method *method = site._method;
+                fprintf(_file, "%s{\"method\":\"%s.%s%s\",\"pc\":%u,\"bytes\":%zu,\"samples\":%zu}",
+                    i == 0 ? "" : ",",
+                    strings::toStdString(method->getClass()->getName()).c_str(),
+                    strings::toStdString(method->getName()).c_str(),
+                    strings::toStdString(method->getDescriptor()).c_str(),
+                    site._pc, site._bytes, site._samples);
+            }
+            fputc(']', _file);
+        }
+
+        fputs("}\n", _file);
+
+        // lines are read while the VM runs
+        fflush(_file);
+    }
+}
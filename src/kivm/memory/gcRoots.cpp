@@ -0,0 +1,250 @@
+//
+// Enumeration of GC roots
+//
+
+#include <kivm/memory/gcRoots.h>
+#include <kivm/memory/universe.h>
+#include <kivm/memory/referenceProcessor.h>
+#include <kivm/oop/mirrorOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/classpath/system.h>
+#include <kivm/native/java_lang_Class.h>
+#include <kivm/native/java_lang_String.h>
+
+#define CLASSES_PER_TASK 32
+
+// GC-Roots include:
+// [*] 0. InstanceKlass::_staticFieldValues (at _staticOopOffsets)
+// [*] 1. InstanceKlass::_javaMirror
+// [*] 2. InstanceKlass::_javaLoader
+// [*] 3. InstanceKlass::_runtimePool's Strings
+// [*] 4. JavaThread::_javaThreadObject
+// [*] 5. JavaThread::_exceptionOop
+// [*] 6. JavaThread::_args
+// [*] 7. JavaThread::_frames[0 ~ the last frame]::_locals
+// [*] 8. JavaThread::_frames[0 ~ the last frame]::_stack
+//        (only slots holding references at the frame's pc, see OopMap)
+// [*] 9. Objects held by Global
+// [*] 10. Java mirrors of primitive types
+// [*] 11. Intern strings
+// [*] 12. Fields of JavaThread::_frameArena objects
+// [*] 13. ReferenceProcessor::sPendingList
+// [*] 14. JavaThread::_blockedOn
+//
+// References inside objects are visited with OopIterator.
+
+namespace kivm {
+    std::atomic<u8> GCRoots::sScanTimeNanos[ROOT_CATEGORY_COUNT];
+
+    /**
+     * Visit a root whose static type is a subclass of oopDesc.
+     */
+    template <typename T>
+    static inline void doRoot(T *&root, OopClosure *closure) {
+        oop object = root;
+        closure->doOop(&object);
+        root = (T *) object;
+    }
+
+    void GCRoots::doGlobals(OopClosure *closure) {
+        D("[GCRoots]: global objects");
+        doRoot(Global::DEFAULT_UTF8_CHARSET, closure);
+        doRoot(Global::OUT_OF_MEMORY_ERROR, closure);
+
+        D("[GCRoots]: references waiting for the reference handler");
+        closure->doOop(&ReferenceProcessor::sPendingList);
+
+        D("[GCRoots]: primitive types's java mirrors");
+        for (auto &item : java::lang::Class::_primitiveTypeMirrors) {
+            doRoot(item.second, closure);
+        }
+    }
+
+    void GCRoots::doInternStrings(OopClosure *closure) {
+        D("[GCRoots]: intern string pool");
+        auto internStringPool = java::lang::InternStringPool::getGlobal();
+        for (auto &item : internStringPool->_pool) {
+            doRoot(item.second, closure);
+        }
+    }
+
+    void GCRoots::doClass(Klass *klass, OopClosure *closure) {
+        if (klass == nullptr) {
+            return;
+        }
+
+        doRoot(klass->_javaMirror, closure);
+
+        switch (klass->getClassType()) {
+            case ClassType::INSTANCE_CLASS: {
+                auto instanceClass = (InstanceKlass *) klass;
+                doRoot(instanceClass->_javaLoader, closure);
+
+                // static fields, only references need to be followed
+                for (int offset : instanceClass->_staticOopOffsets) {
+                    closure->doOop(instanceClass->getStaticFieldAddress<oop>(offset));
+                }
+
+                // runtime constant pool strings
+                auto rt = instanceClass->getRuntimeConstantPool();
+                for (int i = 1; i < rt->_entryCount; ++i) {
+                    if (rt->_rawPool[i] != nullptr
+                        && rt->getConstantTag(i) == CONSTANT_String) {
+                        oop stringOop = Resolver::instance(rt->_pool[i]);
+                        if (stringOop == nullptr) {
+                            continue;
+                        }
+                        closure->doOop(&stringOop);
+                        rt->_pool[i] = stringOop;
+                    }
+                }
+                break;
+            }
+
+            case ClassType::OBJECT_ARRAY_CLASS:
+            case ClassType::TYPE_ARRAY_CLASS: {
+                auto arrayClass = (ArrayKlass *) klass;
+                doRoot(arrayClass->_javaLoader, closure);
+                break;
+            }
+
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    void GCRoots::doThread(JavaThread *thread, OopClosure *closure) {
+        D("[GCRoots]: thread %p", thread);
+        doRoot(thread->_exceptionOop, closure);
+        doRoot(thread->_javaThreadObject, closure);
+        doRoot(thread->_blockedOn, closure);
+
+        for (auto &item : thread->_args) {
+            closure->doOop(&item);
+        }
+
+        doFrames(thread, [closure](Frame *frame, u4 pc) {
+            if (!frame->isNativeFrame()) {
+                doFrame(frame, pc, closure);
+            }
+        });
+
+        // objects in the arena are never moved, but may point into the heap
+        thread->_frameArena.objectIterate([closure](oop object) {
+            OopIterator::iterate(object, [closure](oop *slot) {
+                closure->doOop(slot);
+            });
+        });
+    }
+
+    void GCRoots::doFrames(JavaThread *thread, const std::function<void(Frame *, u4)> &visit) {
+        // the top frame is at the thread's pc, every other frame
+        // is at the instruction that called the frame above it
+        u4 pc = thread->_pc;
+        auto currentFrame = thread->_frames._current;
+        while (currentFrame != nullptr) {
+            visit(currentFrame, pc);
+            pc = currentFrame->getReturnPc();
+            currentFrame = currentFrame->getPrevious();
+        }
+    }
+
+    void GCRoots::doFrame(Frame *frame, u4 pc, OopClosure *closure) {
+        auto oopMap = frame->getMethod()->getOopMap();
+        if (oopMap == nullptr) {
+            return;
+        }
+        const OopMapEntry *entry = oopMap->lookup(pc);
+
+        SlotArray &locals = frame->_locals._array;
+        for (int i = 0; i < locals._size; ++i) {
+            if (entry->isLocalOop(i)) {
+                doSlot(locals._elements + i, closure);
+            }
+        }
+
+        // operands may have been popped by the current instruction
+        SlotArray &stack = frame->_stack._array;
+        int depth = std::min(frame->_stack._sp, entry->getStackDepth());
+        for (int i = 0; i < depth; ++i) {
+            if (entry->isStackOop(i)) {
+                doSlot(stack._elements + i, closure);
+            }
+        }
+    }
+
+    void GCRoots::doSlot(Slot *slot, OopClosure *closure) {
+        // frame arena objects are not moved, their fields are roots instead
+        if (slot->ref == nullptr || !Universe::isHeapObject(slot->ref)) {
+            return;
+        }
+        auto object = (oop) slot->ref;
+        closure->doOop(&object);
+        slot->ref = object;
+    }
+
+    void GCRoots::collectTasks(std::vector<Task> &tasks) {
+        tasks.push_back(timed(ROOTS_GLOBALS, [](OopClosure *closure) {
+            doGlobals(closure);
+        }));
+        tasks.push_back(timed(ROOTS_INTERN_STRINGS, [](OopClosure *closure) {
+            doInternStrings(closure);
+        }));
+
+        // loaded classes, in batches
+        std::vector<Klass *> classes;
+        for (const auto &loadedClass : SystemDictionary::get()->getLoadedClasses()) {
+            classes.push_back(loadedClass.second);
+        }
+        for (size_t begin = 0; begin < classes.size(); begin += CLASSES_PER_TASK) {
+            size_t end = std::min(begin + CLASSES_PER_TASK, classes.size());
+            std::vector<Klass *> batch(classes.begin() + begin, classes.begin() + end);
+            tasks.push_back(timed(ROOTS_CLASSES, [batch](OopClosure *closure) {
+                for (auto klass : batch) {
+                    doClass(klass, closure);
+                }
+            }));
+        }
+
+        // threads, locals and stacks
+        Threads::forEach([&](JavaThread *thread) {
+            tasks.push_back(timed(ROOTS_THREADS, [thread](OopClosure *closure) {
+                doThread(thread, closure);
+            }));
+            return false;
+        });
+    }
+
+    void GCRoots::doAll(OopClosure *closure) {
+        std::vector<Task> tasks;
+        collectTasks(tasks);
+        for (auto &task : tasks) {
+            task(closure);
+        }
+    }
+
+    GCRoots::Task GCRoots::timed(GCRootCategory category, Task body) {
+        return [category, body](OopClosure *closure) {
+            auto start = std::chrono::steady_clock::now();
+            body(closure);
+            addScanTime(category, std::chrono::steady_clock::now() - start);
+        };
+    }
+
+    void GCRoots::resetScanTimes() {
+        for (auto &time : sScanTimeNanos) {
+            time = 0;
+        }
+    }
+
+    void GCRoots::addScanTime(GCRootCategory category, std::chrono::nanoseconds time) {
+        sScanTimeNanos[category] += (u8) time.count();
+    }
+
+    std::chrono::microseconds GCRoots::getScanTime(GCRootCategory category) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::nanoseconds(sScanTimeNanos[category].load()));
+    }
+}
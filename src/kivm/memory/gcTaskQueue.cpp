@@ -0,0 +1,106 @@
+//
+// Work-stealing task queues of GC workers
+//
+
+#include <kivm/memory/gcTaskQueue.h>
+#include <thread>
+
+namespace kivm {
+    GCTaskQueue::GCTaskQueue()
+        : _top(0), _bottom(0) {
+        _elements = new std::atomic<oop>[CAPACITY];
+    }
+
+    GCTaskQueue::~GCTaskQueue() {
+        delete[] _elements;
+    }
+
+    void GCTaskQueue::push(oop object) {
+        jlong bottom = _bottom.load(std::memory_order_relaxed);
+        jlong top = _top.load(std::memory_order_acquire);
+        if (bottom - top >= CAPACITY) {
+            _overflow.push_back(object);
+            return;
+        }
+
+        _elements[bottom & MASK].store(object, std::memory_order_relaxed);
+        _bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    bool GCTaskQueue::pop(oop &object) {
+        if (!_overflow.empty()) {
+            object = _overflow.back();
+            _overflow.pop_back();
+            return true;
+        }
+
+        jlong bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        jlong top = _top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            // empty
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        object = _elements[bottom & MASK].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // the last one, race against thieves
+            bool won = _top.compare_exchange_strong(top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool GCTaskQueue::steal(oop &object) {
+        jlong top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        jlong bottom = _bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+
+        object = _elements[top & MASK].load(std::memory_order_relaxed);
+        return _top.compare_exchange_strong(top, top + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    GCTaskQueueSet::GCTaskQueueSet()
+        : _offeredTermination(0) {
+    }
+
+    bool GCTaskQueueSet::steal(int workerId, oop &object) {
+        int count = (int) _queues.size();
+        for (int i = 1; i < count; ++i) {
+            if (_queues[(workerId + i) % count]->steal(object)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool GCTaskQueueSet::offerTermination() {
+        int workers = (int) _queues.size();
+        ++_offeredTermination;
+
+        while (true) {
+            // Idle workers never push, so once everyone has offered,
+            // no more work can appear.
+            if (_offeredTermination.load() == workers) {
+                return true;
+            }
+
+            for (auto queue : _queues) {
+                if (!queue->isEmpty()) {
+                    --_offeredTermination;
+                    return false;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+}
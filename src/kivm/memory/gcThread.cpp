@@ -3,112 +3,224 @@
 //
 #include <kivm/memory/gcThread.h>
 #include <kivm/runtime/javaThread.h>
-#include <sched.h>
+#include <algorithm>
 #include <kivm/memory/universe.h>
+#include <kivm/memory/heapDumper.h>
 
 namespace kivm {
-    static Lock sGCTriggerLock;
     GCThread *GCThread::sGCThreadInstance = nullptr;
+    std::atomic<bool> GCThread::sSafepointPollArmed(false);
+    std::atomic<bool> GCThread::sHeapDumpSignaled(false);
 
     void GCThread::initialize() {
         GCThread::sGCThreadInstance = new GCThread;
         sGCThreadInstance->_gcState = GCState::ENJOYING_HOLIDAY;
     }
 
+    void GCThread::onHeapDumpSignal() {
+        sHeapDumpSignaled.store(true);
+        sSafepointPollArmed.store(true, std::memory_order_relaxed);
+    }
+
     void GCThread::run() {
         setThreadName(L"GCThread");
 
-        while (getThreadState() != ThreadState::DIED) {
-            // Wait until GC is required
-            if (getState() == GCState::ENJOYING_HOLIDAY) {
+        _safepointMonitor.enter();
+        while (_gcState != GCState::GC_STOPPED) {
+            // Wait until GC is required, and then until
+            // the last running thread arrives at the safepoint
+            if (_gcState == GCState::ENJOYING_HOLIDAY || !isAllThreadInSafePoint()) {
                 D("[GCThread]: waiting to be woken up");
-                _triggerMonitor.enter();
-                _triggerMonitor.wait();
-                _triggerMonitor.leave();
-
-                auto state = getState();
-                if (state == GCState::WAITING_FOR_SAFEPOINT) {
-                    D("[GCThread]: stopping the world");
-
-                } else if (state == GCState::GC_STOPPED) {
-                    D("GCThread: VM exited, stopping GC thread");
-                    break;
-                }
-            }
-
-            // Wait until all threads are in safepoint
-            if (isAllThreadInSafePoint()) {
-                D("[GCThread]: collecting");
-                doGarbageCollection();
+                _safepointMonitor.wait();
                 continue;
             }
 
-            sched_yield();
+            doSafepointOperations();
         }
+        _safepointMonitor.leave();
+        D("[GCThread]: VM exited, stopping GC thread");
     }
 
     bool GCThread::isAllThreadInSafePoint() {
-        int total = 0;
-        int inSafepoint = 0;
-
-        Threads::forEach([&](JavaThread *thread) {
-            ++total;
-            if (thread->getThreadState() != ThreadState::DIED
-                && thread->isInSafepoint()) {
-                ++inSafepoint;
-            }
-            return false;
-        });
+        return _threadsInSafepoint >= Threads::getRunningJavaThreadCountLocked();
+    }
+
+    std::chrono::microseconds GCThread::recordTimeToSafepoint() {
+        auto timeToSafepoint = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - _safepointRequestedAt);
 
-        return inSafepoint == total;
+        auto &stats = _safepointStatistics;
+        ++stats._safepoints;
+        stats._totalTimeToSafepoint += timeToSafepoint;
+        stats._maxTimeToSafepoint = std::max(stats._maxTimeToSafepoint, timeToSafepoint);
+
+        D("[GCThread]: time to safepoint: %lld us, average: %lld us, max: %lld us",
+            (long long) timeToSafepoint.count(),
+            (long long) (stats._totalTimeToSafepoint.count() / stats._safepoints),
+            (long long) stats._maxTimeToSafepoint.count());
+        return timeToSafepoint;
     }
 
-    void GCThread::doGarbageCollection() {
+    void GCThread::doSafepointOperations() {
+        auto timeToSafepoint = recordTimeToSafepoint();
         _gcState = GCState::GC_RUNNING;
-        Universe::sCollectedHeapInstance->doGarbageCollection();
+
+        if (_collectionRequested) {
+            _collectionRequested = false;
+            D("[GCThread]: collecting");
+            Universe::sCollectedHeapInstance->setTimeToSafepoint(timeToSafepoint);
+            Universe::sCollectedHeapInstance->doGarbageCollection();
+        }
+
+        if (_pendingOperation != nullptr) {
+            D("[GCThread]: running operation, reason: %d", _pendingOperationReason);
+            Universe::sCollectedHeapInstance->setTimeToSafepoint(timeToSafepoint);
+            (*_pendingOperation)();
+            _pendingOperation = nullptr;
+        }
+
+        if (_heapDumpRequested) {
+            _heapDumpRequested = false;
+            D("[GCThread]: dumping heap to %s", _heapDumpPath.c_str());
+            HeapDumper::dump(_heapDumpPath);
+        }
+
         _gcState = GCState::ENJOYING_HOLIDAY;
 
+        // a signal during this safepoint is handled at the next one
+        sSafepointPollArmed.store(sHeapDumpSignaled.load(), std::memory_order_relaxed);
+
         // wake up all threads to continue their jobs
-        _gcWaitMonitor.notifyAll();
+        _safepointMonitor.notifyAll();
     }
 
-    Monitor *GCThread::required() {
-        LockGuard lockGuard(sGCTriggerLock);
-        if (_gcState != GCState::WAITING_FOR_SAFEPOINT) {
-            // it is much safer to change status before triggering gc
+    void GCThread::requestSafepointLocked() {
+        if (_gcState == GCState::ENJOYING_HOLIDAY) {
             _gcState = GCState::WAITING_FOR_SAFEPOINT;
-
-            // enter monitor so that other threads can do wait on it
-            // and when gc finishes, just notify this monitor to wake
-            // up all waiting threads to continue their jobs
-            _gcWaitMonitor.enter();
+            _safepointRequestedAt = std::chrono::steady_clock::now();
+            sSafepointPollArmed.store(true, std::memory_order_relaxed);
 
             // notify our gc thread to work
-            _triggerMonitor.notify();
-
-            // if one triggered gc successfully
-            // it should be responsible for this lock
-            return &_gcWaitMonitor;
+            _safepointMonitor.notifyAll();
         }
-        return nullptr;
     }
 
-    void GCThread::stop() {
-        if (_gcState == GCState::ENJOYING_HOLIDAY) {
-            _gcState = GCState::GC_STOPPED;
-            setThreadState(ThreadState::DIED);
-            _triggerMonitor.notify();
-            return;
+    void GCThread::required() {
+        _safepointMonitor.enter();
+        _collectionRequested = true;
+        requestSafepointLocked();
+        _safepointMonitor.leave();
+    }
+
+    bool GCThread::runAtSafepoint(GCReason reason, const std::function<void()> &operation) {
+        _safepointMonitor.enter();
+        // one operation at a time
+        while (_pendingOperation != nullptr && _gcState != GCState::GC_STOPPED) {
+            _safepointMonitor.wait();
         }
 
-        if (_gcState == GCState::GC_RUNNING
-            || _gcState == GCState::WAITING_FOR_SAFEPOINT) {
-            setThreadState(ThreadState::DIED);
-            this->_nativeThread->join();
+        bool done = false;
+        if (_gcState != GCState::GC_STOPPED) {
+            _pendingOperation = &operation;
+            _pendingOperationReason = reason;
+            requestSafepointLocked();
+
+            while (_pendingOperation == &operation && _gcState != GCState::GC_STOPPED) {
+                _safepointMonitor.wait();
+            }
+            done = _pendingOperation != &operation;
+            if (!done) {
+                _pendingOperation = nullptr;
+            }
         }
+        _safepointMonitor.leave();
+        return done;
+    }
+
+    void GCThread::requestHeapDump(const std::string &path) {
+        _safepointMonitor.enter();
+        _heapDumpRequested = true;
+        _heapDumpPath = path;
+        requestSafepointLocked();
+        _safepointMonitor.leave();
     }
 
     void GCThread::wait() {
-        _gcWaitMonitor.wait();
+        _safepointMonitor.enter();
+        if (sHeapDumpSignaled.exchange(false)) {
+            D("[GCThread]: heap dump requested by signal");
+            _heapDumpRequested = true;
+            _heapDumpPath = HeapDumper::getDefaultPath();
+            requestSafepointLocked();
+        }
+
+        if (_gcState == GCState::WAITING_FOR_SAFEPOINT) {
+            ++_threadsInSafepoint;
+            _safepointMonitor.notifyAll();
+
+            while (_gcState == GCState::WAITING_FOR_SAFEPOINT
+                   || _gcState == GCState::GC_RUNNING) {
+                _safepointMonitor.wait();
+            }
+            --_threadsInSafepoint;
+        }
+        _safepointMonitor.leave();
+    }
+
+    void GCThread::enterSafeRegion() {
+        _safepointMonitor.enter();
+        ++_threadsInSafepoint;
+        // it may be the last thread the pending safepoint waits for
+        _safepointMonitor.notifyAll();
+        _safepointMonitor.leave();
+    }
+
+    void GCThread::leaveSafeRegion() {
+        _safepointMonitor.enter();
+        while (_gcState == GCState::WAITING_FOR_SAFEPOINT
+               || _gcState == GCState::GC_RUNNING) {
+            _safepointMonitor.wait();
+        }
+        --_threadsInSafepoint;
+        _safepointMonitor.leave();
+    }
+
+    void GCThread::onJavaThreadExited() {
+        _safepointMonitor.enter();
+        _safepointMonitor.notifyAll();
+        _safepointMonitor.leave();
+    }
+
+    bool GCThread::attachJavaThread() {
+        _safepointMonitor.enter();
+        while (_gcState == GCState::WAITING_FOR_SAFEPOINT
+               || _gcState == GCState::GC_RUNNING) {
+            _safepointMonitor.wait();
+        }
+
+        bool attached = _gcState != GCState::GC_STOPPED;
+        if (attached) {
+            Threads::attachJavaThreadLocked();
+        }
+        _safepointMonitor.leave();
+        return attached;
+    }
+
+    void GCThread::detachJavaThread() {
+        Threads::detachJavaThreadLocked();
+        onJavaThreadExited();
+    }
+
+    void GCThread::stop() {
+        _safepointMonitor.enter();
+        _gcState = GCState::GC_STOPPED;
+        sSafepointPollArmed.store(false, std::memory_order_relaxed);
+        setThreadState(ThreadState::DIED);
+        _safepointMonitor.notifyAll();
+        _safepointMonitor.leave();
+
+        if (this->_nativeThread != nullptr && this->_nativeThread->joinable()) {
+            this->_nativeThread->join();
+        }
     }
 }
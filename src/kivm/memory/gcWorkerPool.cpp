@@ -0,0 +1,95 @@
+//
+// Pool of parallel GC worker threads
+//
+
+#include <kivm/memory/gcWorkerPool.h>
+
+namespace kivm {
+    class GCWorkerThread : public VMThread {
+    private:
+        GCWorkerPool *_pool;
+        int _workerId;
+
+    protected:
+        void run() override {
+            setThreadName(L"GCWorker#" + std::to_wstring(_workerId));
+            _pool->workerLoop(_workerId);
+        }
+
+    public:
+        GCWorkerThread(GCWorkerPool *pool, int workerId)
+            : _pool(pool), _workerId(workerId) {
+        }
+
+        void join() {
+            if (_nativeThread != nullptr && _nativeThread->joinable()) {
+                _nativeThread->join();
+            }
+        }
+    };
+
+    GCWorkerPool::GCWorkerPool(int workerCount)
+        : _workerCount(workerCount < 1 ? 1 : workerCount) {
+        for (int i = 1; i < _workerCount; ++i) {
+            auto thread = new GCWorkerThread(this, i);
+            _threads.push_back(thread);
+            thread->start();
+        }
+        D("GCWorkerPool: %d workers", _workerCount);
+    }
+
+    GCWorkerPool::~GCWorkerPool() {
+        {
+            std::lock_guard<Lock> guard(_lock);
+            _stopped = true;
+        }
+        _taskCond.notify_all();
+
+        for (auto thread : _threads) {
+            thread->join();
+            delete thread;
+        }
+    }
+
+    void GCWorkerPool::workerLoop(int workerId) {
+        u8 finishedSerial = 0;
+        while (true) {
+            std::unique_lock<Lock> guard(_lock);
+            _taskCond.wait(guard, [&]() {
+                return _stopped || _taskSerial != finishedSerial;
+            });
+            if (_stopped) {
+                return;
+            }
+
+            finishedSerial = _taskSerial;
+            const Task *task = _task;
+            guard.unlock();
+
+            (*task)(workerId);
+
+            guard.lock();
+            if (--_busyWorkers == 0) {
+                _doneCond.notify_all();
+            }
+        }
+    }
+
+    void GCWorkerPool::runTask(const Task &task) {
+        {
+            std::lock_guard<Lock> guard(_lock);
+            _task = &task;
+            _busyWorkers = _workerCount - 1;
+            ++_taskSerial;
+        }
+        _taskCond.notify_all();
+
+        task(0);
+
+        std::unique_lock<Lock> guard(_lock);
+        _doneCond.wait(guard, [&]() {
+            return _busyWorkers == 0;
+        });
+        _task = nullptr;
+    }
+}
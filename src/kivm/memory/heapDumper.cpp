@@ -0,0 +1,839 @@
+//
+// HPROF heap dumper
+//
+#include <kivm/memory/heapDumper.h>
+#include <kivm/memory/universe.h>
+#include <kivm/memory/gcRoots.h>
+#include <kivm/oop/mirrorOop.h>
+#include <kivm/oop/method.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <kivm/bytecode/execution.h>
+#include <kivm/classpath/system.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+
+#if defined(KIVM_PLATFORM_WINDOWS)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// A heap dump is written in one pass over each of:
+// [*] classes: a LOAD CLASS record per class, names as UTF8 records
+// [*] threads: a STACK TRACE record per thread, with a FRAME record per frame
+// [*] HEAP DUMP SEGMENT records holding roots, class dumps and objects
+//
+// Identifiers are addresses. A class is identified by its Java mirror,
+// so that references to java.lang.Class objects point to the class,
+// or by its Klass if it has no mirror yet.
+//
+// Segments are written with a placeholder length, patched when the
+// segment is closed, so nothing is buffered besides stdio's own buffer.
+
+#define HPROF_HEADER "JAVA PROFILE 1.0.2"
+#define HPROF_ID_SIZE 8
+
+// Keep segments far below the 4GB a u4 length can describe.
+#define HPROF_SEGMENT_LIMIT ((u8) 1 << 30)
+
+// Objects reported without a stack trace use the empty one.
+#define HPROF_EMPTY_TRACE 1
+
+#define HPROF_LINE_UNKNOWN (-1)
+#define HPROF_LINE_NATIVE (-3)
+
+namespace kivm {
+    enum HprofTag {
+        HPROF_UTF8 = 0x01,
+        HPROF_LOAD_CLASS = 0x02,
+        HPROF_FRAME = 0x04,
+        HPROF_TRACE = 0x05,
+        HPROF_HEAP_DUMP_SEGMENT = 0x1C,
+        HPROF_HEAP_DUMP_END = 0x2C,
+    };
+
+    enum HprofSubTag {
+        HPROF_GC_ROOT_JAVA_FRAME = 0x03,
+        HPROF_GC_ROOT_STICKY_CLASS = 0x05,
+        HPROF_GC_ROOT_THREAD_OBJ = 0x08,
+        HPROF_GC_CLASS_DUMP = 0x20,
+        HPROF_GC_INSTANCE_DUMP = 0x21,
+        HPROF_GC_OBJ_ARRAY_DUMP = 0x22,
+        HPROF_GC_PRIM_ARRAY_DUMP = 0x23,
+        HPROF_GC_ROOT_UNKNOWN = 0xFF,
+    };
+
+    enum HprofType {
+        HPROF_OBJECT = 2,
+        HPROF_BOOLEAN = 4,
+        HPROF_CHAR = 5,
+        HPROF_FLOAT = 6,
+        HPROF_DOUBLE = 7,
+        HPROF_BYTE = 8,
+        HPROF_SHORT = 9,
+        HPROF_INT = 10,
+        HPROF_LONG = 11,
+    };
+
+    static u1 toHprofType(ValueType valueType) {
+        switch (valueType) {
+            case ValueType::BOOLEAN:
+                return HPROF_BOOLEAN;
+            case ValueType::BYTE:
+                return HPROF_BYTE;
+            case ValueType::CHAR:
+                return HPROF_CHAR;
+            case ValueType::SHORT:
+                return HPROF_SHORT;
+            case ValueType::INT:
+                return HPROF_INT;
+            case ValueType::FLOAT:
+                return HPROF_FLOAT;
+            case ValueType::LONG:
+                return HPROF_LONG;
+            case ValueType::DOUBLE:
+                return HPROF_DOUBLE;
+            case ValueType::OBJECT:
+            case ValueType::ARRAY:
+                return HPROF_OBJECT;
+            default:
+                SHOULD_NOT_REACH_HERE_M("field type required");
+        }
+    }
+
+    static size_t getHprofValueSize(u1 type) {
+        switch (type) {
+            case HPROF_BOOLEAN:
+            case HPROF_BYTE:
+                return 1;
+            case HPROF_CHAR:
+            case HPROF_SHORT:
+                return 2;
+            case HPROF_INT:
+            case HPROF_FLOAT:
+                return 4;
+            case HPROF_LONG:
+            case HPROF_DOUBLE:
+                return 8;
+            case HPROF_OBJECT:
+                return HPROF_ID_SIZE;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+    }
+
+    struct HprofField {
+        u8 _nameId;
+        u1 _type;
+        int _offset;
+    };
+
+    struct HprofClass {
+        Klass *_klass;
+        u4 _serial;
+        u8 _nameId;
+
+        /**
+         * Fields declared by the class itself, in layout order.
+         */
+        std::vector<HprofField> _instanceFields;
+        std::vector<HprofField> _staticFields;
+    };
+
+    struct HprofThread {
+        JavaThread *_thread;
+        u4 _serial;
+    };
+
+    struct RootClosure final : public OopClosure {
+        std::function<void(oop)> _visit;
+
+        explicit RootClosure(std::function<void(oop)> visit)
+            : _visit(std::move(visit)) {
+        }
+
+        void doOop(oop *slot) override {
+            oop object = *slot;
+            if (object != nullptr && object->getMarkOop()->getOopType() != oopType::PRIMITIVE_OOP) {
+                _visit(object);
+            }
+        }
+    };
+
+    class HprofWriter final {
+    private:
+        FILE *_file;
+
+        /**
+         * Position of the length of the open segment.
+         */
+        fpos_t _segmentLengthPos{};
+        bool _inSegment = false;
+        u8 _segmentLength = 0;
+
+        std::unordered_map<std::string, u8> _strings;
+        std::vector<HprofClass> _classes;
+        std::unordered_map<Klass *, size_t> _classIndexes;
+        std::vector<HprofThread> _threads;
+
+        u8 _nextStringId = 1;
+        u8 _nextFrameId = 1;
+
+        size_t _objects = 0;
+
+    public:
+        explicit HprofWriter(FILE *file)
+            : _file(file) {
+        }
+
+        void writeAll();
+
+        inline size_t getObjectCount() const {
+            return _objects;
+        }
+
+    private:
+        void writeBytes(const void *data, size_t size) {
+            fwrite(data, 1, size, _file);
+            if (_inSegment) {
+                _segmentLength += size;
+            }
+        }
+
+        void writeU1(u1 value) {
+            writeBytes(&value, 1);
+        }
+
+        void writeU2(u2 value) {
+            u1 bytes[2] = {(u1) (value >> 8), (u1) value};
+            writeBytes(bytes, sizeof(bytes));
+        }
+
+        void writeU4(u4 value) {
+            u1 bytes[4] = {(u1) (value >> 24), (u1) (value >> 16), (u1) (value >> 8), (u1) value};
+            writeBytes(bytes, sizeof(bytes));
+        }
+
+        void writeU8(u8 value) {
+            writeU4((u4) (value >> 32));
+            writeU4((u4) value);
+        }
+
+        void writeId(const void *address) {
+            writeU8((u8) (uintptr_t) address);
+        }
+
+        /**
+         * Write a value stored unboxed at {@code address}.
+         */
+        void writeValue(u1 type, const jbyte *address) {
+            switch (getHprofValueSize(type)) {
+                case 1:
+                    writeU1(*(const u1 *) address);
+                    break;
+                case 2: {
+                    u2 value;
+                    memcpy(&value, address, sizeof(value));
+                    writeU2(value);
+                    break;
+                }
+                case 4: {
+                    u4 value;
+                    memcpy(&value, address, sizeof(value));
+                    writeU4(value);
+                    break;
+                }
+                case 8: {
+                    u8 value;
+                    memcpy(&value, address, sizeof(value));
+                    writeU8(value);
+                    break;
+                }
+                default:
+                    SHOULD_NOT_REACH_HERE();
+            }
+        }
+
+        void writeRecordHeader(u1 tag, u4 length) {
+            writeU1(tag);
+            // microseconds since the header's timestamp
+            writeU4(0);
+            writeU4(length);
+        }
+
+        /**
+         * Make room for a sub-record of {@code size} bytes,
+         * in the open segment or in a new one.
+         */
+        void beginSubRecord(u8 size) {
+            if (_inSegment && _segmentLength + size > HPROF_SEGMENT_LIMIT) {
+                endSegment();
+            }
+            if (!_inSegment) {
+                beginSegment();
+            }
+        }
+
+        void beginSegment() {
+            writeU1(HPROF_HEAP_DUMP_SEGMENT);
+            writeU4(0);
+            fgetpos(_file, &_segmentLengthPos);
+            // patched in endSegment()
+            writeU4(0);
+            _inSegment = true;
+            _segmentLength = 0;
+        }
+
+        void endSegment() {
+            if (!_inSegment) {
+                return;
+            }
+            _inSegment = false;
+
+            fpos_t end{};
+            fgetpos(_file, &end);
+            fsetpos(_file, &_segmentLengthPos);
+            writeU4((u4) _segmentLength);
+            fsetpos(_file, &end);
+        }
+
+        /**
+         * @return id of the UTF8 record holding {@code str},
+         *         which is written the first time it is seen
+         */
+        u8 getStringId(const String &str);
+
+        u8 getClassId(Klass *klass) const {
+            mirrorOop mirror = klass->getJavaMirror();
+            return mirror != nullptr ? (u8) (uintptr_t) mirror : (u8) (uintptr_t) klass;
+        }
+
+        u4 getClassSerial(Klass *klass) const {
+            auto iter = _classIndexes.find(klass);
+            return iter == _classIndexes.end() ? 0 : _classes[iter->second]._serial;
+        }
+
+        void addClass(Klass *klass);
+
+        /**
+         * Heap objects, then objects in frame arenas of threads.
+         */
+        void forEachObject(const std::function<void(oop)> &visit);
+
+        void collectClasses();
+
+        void collectFields(HprofClass &hprofClass);
+
+        void collectThreads();
+
+        void writeHeader();
+
+        void writeLoadClasses();
+
+        void writeStackTraces();
+
+        void writeRoots();
+
+        void writeRoot(u1 tag, oop object);
+
+        void writeClassDump(const HprofClass &hprofClass);
+
+        void writeObject(oop object);
+
+        void writeInstance(instanceOop instance);
+
+        void writeObjectArray(arrayOop array);
+
+        void writePrimitiveArray(arrayOop array, ValueType componentType);
+    };
+
+    u8 HprofWriter::getStringId(const String &str) {
+        std::string utf8 = strings::toStdString(str);
+        auto iter = _strings.find(utf8);
+        if (iter != _strings.end()) {
+            return iter->second;
+        }
+
+        // strings are only added before the first segment
+        assert(!_inSegment);
+        u8 id = _nextStringId++;
+        writeRecordHeader(HPROF_UTF8, (u4) (HPROF_ID_SIZE + utf8.size()));
+        writeU8(id);
+        writeBytes(utf8.data(), utf8.size());
+        _strings.insert(std::make_pair(utf8, id));
+        return id;
+    }
+
+    void HprofWriter::addClass(Klass *klass) {
+        // superclasses first, instance dumps need their fields
+        while (klass != nullptr && _classIndexes.find(klass) == _classIndexes.end()) {
+            HprofClass hprofClass{};
+            hprofClass._klass = klass;
+            hprofClass._serial = (u4) _classes.size() + 1;
+            _classIndexes.insert(std::make_pair(klass, _classes.size()));
+            _classes.push_back(hprofClass);
+            klass = klass->getSuperClass();
+        }
+    }
+
+    void HprofWriter::forEachObject(const std::function<void(oop)> &visit) {
+        Universe::getCollectedHeap()->objectIterate(visit);
+        Threads::forEach([&](JavaThread *thread) {
+            thread->getFrameArena().objectIterate(visit);
+            return false;
+        });
+    }
+
+    void HprofWriter::collectClasses() {
+        for (const auto &loadedClass : SystemDictionary::get()->getLoadedClasses()) {
+            addClass(loadedClass.second);
+        }
+
+        // classes of objects, arrays classes may not be in the dictionary
+        forEachObject([this](oop object) {
+            if (object->getMarkOop()->getOopType() == oopType::PRIMITIVE_OOP) {
+                return;
+            }
+            addClass(object->getClass());
+
+            if (object->getClass() != nullptr && Global::_Class != nullptr && object->getClass() == Global::_Class) {
+                Klass *target = ((mirrorOop) object)->getTarget();
+                if (target != nullptr) {
+                    addClass(target);
+                }
+            }
+        });
+
+        if (Global::_Object != nullptr) {
+            addClass(Global::_Object);
+        }
+
+        for (auto &hprofClass : _classes) {
+            collectFields(hprofClass);
+        }
+    }
+
+    void HprofWriter::collectFields(HprofClass &hprofClass) {
+        if (hprofClass._klass->getClassType() != ClassType::INSTANCE_CLASS) {
+            return;
+        }
+
+        auto instanceClass = (InstanceKlass *) hprofClass._klass;
+        auto collect = [&](const HashMap<String, FieldID *> &fields, std::vector<HprofField> &result) {
+            for (const auto &item : fields) {
+                FieldID *fieldID = item.second;
+                // inherited fields are dumped with their own classes
+                if (fieldID->_field->getClass() != instanceClass) {
+                    continue;
+                }
+                result.push_back(HprofField{getStringId(fieldID->_field->getName()),
+                                            toHprofType(fieldID->_field->getValueType()),
+                                            fieldID->_offset});
+            }
+            std::sort(result.begin(), result.end(), [](const HprofField &a, const HprofField &b) {
+                return a._offset < b._offset;
+            });
+        };
+
+        collect(instanceClass->getInstanceFields(), hprofClass._instanceFields);
+        if (instanceClass->getStaticFieldValues() != nullptr) {
+            collect(instanceClass->getStaticFields(), hprofClass._staticFields);
+        }
+    }
+
+    void HprofWriter::collectThreads() {
+        Threads::forEach([this](JavaThread *thread) {
+            _threads.push_back(HprofThread{thread, (u4) _threads.size() + 1});
+            return false;
+        });
+    }
+
+    void HprofWriter::writeHeader() {
+        writeBytes(HPROF_HEADER, sizeof(HPROF_HEADER));
+        writeU4(HPROF_ID_SIZE);
+
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        writeU8((u8) now.count());
+    }
+
+    void HprofWriter::writeLoadClasses() {
+        for (auto &hprofClass : _classes) {
+            hprofClass._nameId = getStringId(hprofClass._klass->getName());
+
+            writeRecordHeader(HPROF_LOAD_CLASS, 4 + HPROF_ID_SIZE + 4 + HPROF_ID_SIZE);
+            writeU4(hprofClass._serial);
+            writeU8(getClassId(hprofClass._klass));
+            writeU4(HPROF_EMPTY_TRACE);
+            writeU8(hprofClass._nameId);
+        }
+    }
+
+    void HprofWriter::writeStackTraces() {
+        writeRecordHeader(HPROF_TRACE, 4 + 4 + 4);
+        writeU4(HPROF_EMPTY_TRACE);
+        writeU4(0);
+        writeU4(0);
+
+        for (const auto &hprofThread : _threads) {
+            std::vector<u8> frameIds;
+            GCRoots::doFrames(hprofThread._thread, [&](Frame *frame, u4 pc) {
+                auto method = frame->getMethod();
+                auto methodClass = method->getClass();
+                u8 nameId = getStringId(method->getName());
+                u8 descriptorId = getStringId(method->getDescriptor());
+                u8 sourceFileId = getStringId(methodClass->getSourceFile());
+
+                int line = HPROF_LINE_NATIVE;
+                if (!frame->isNativeFrame()) {
+                    line = method->getLineNumber(pc);
+                    if (line <= 0) {
+                        line = HPROF_LINE_UNKNOWN;
+                    }
+                }
+
+                u8 frameId = _nextFrameId++;
+                writeRecordHeader(HPROF_FRAME, 4 * HPROF_ID_SIZE + 4 + 4);
+                writeU8(frameId);
+                writeU8(nameId);
+                writeU8(descriptorId);
+                writeU8(sourceFileId);
+                writeU4(getClassSerial(methodClass));
+                writeU4((u4) line);
+                frameIds.push_back(frameId);
+            });
+
+            writeRecordHeader(HPROF_TRACE, (u4) (4 + 4 + 4 + frameIds.size() * HPROF_ID_SIZE));
+            // trace serials of threads follow the empty one
+            writeU4(hprofThread._serial + HPROF_EMPTY_TRACE);
+            writeU4(hprofThread._serial);
+            writeU4((u4) frameIds.size());
+            for (u8 frameId : frameIds) {
+                writeU8(frameId);
+            }
+        }
+    }
+
+    void HprofWriter::writeRoot(u1 tag, oop object) {
+        beginSubRecord(1 + HPROF_ID_SIZE);
+        writeU1(tag);
+        writeId(object);
+    }
+
+    void HprofWriter::writeRoots() {
+        RootClosure unknownRoots([this](oop object) {
+            writeRoot(HPROF_GC_ROOT_UNKNOWN, object);
+        });
+        GCRoots::doGlobals(&unknownRoots);
+        GCRoots::doInternStrings(&unknownRoots);
+
+        for (const auto &hprofClass : _classes) {
+            beginSubRecord(1 + HPROF_ID_SIZE);
+            writeU1(HPROF_GC_ROOT_STICKY_CLASS);
+            writeU8(getClassId(hprofClass._klass));
+        }
+
+        for (const auto &hprofThread : _threads) {
+            JavaThread *thread = hprofThread._thread;
+            if (thread->_javaThreadObject != nullptr) {
+                beginSubRecord(1 + HPROF_ID_SIZE + 4 + 4);
+                writeU1(HPROF_GC_ROOT_THREAD_OBJ);
+                writeId(thread->_javaThreadObject);
+                writeU4(hprofThread._serial);
+                writeU4(hprofThread._serial + HPROF_EMPTY_TRACE);
+            }
+
+            // pending exception, blocked-on object and arguments
+            RootClosure threadRoots([this](oop object) {
+                writeRoot(HPROF_GC_ROOT_UNKNOWN, object);
+            });
+            oop exception = thread->_exceptionOop;
+            threadRoots.doOop(&exception);
+            oop blockedOn = thread->_blockedOn;
+            threadRoots.doOop(&blockedOn);
+            for (auto &item : thread->_args) {
+                threadRoots.doOop(&item);
+            }
+
+            // objects that never escape their frame are not in the heap
+            thread->getFrameArena().objectIterate([&](oop object) {
+                threadRoots.doOop(&object);
+            });
+
+            // frames are numbered from the top, as in the stack trace
+            u4 depth = 0;
+            GCRoots::doFrames(thread, [&](Frame *frame, u4 pc) {
+                RootClosure frameRoots([&](oop object) {
+                    beginSubRecord(1 + HPROF_ID_SIZE + 4 + 4);
+                    writeU1(HPROF_GC_ROOT_JAVA_FRAME);
+                    writeId(object);
+                    writeU4(hprofThread._serial);
+                    writeU4(depth);
+                });
+                if (!frame->isNativeFrame()) {
+                    GCRoots::doFrame(frame, pc, &frameRoots);
+                }
+                ++depth;
+            });
+        }
+    }
+
+    void HprofWriter::writeClassDump(const HprofClass &hprofClass) {
+        Klass *klass = hprofClass._klass;
+        Klass *superClass = klass->getSuperClass();
+        oop loader = nullptr;
+        size_t instanceSize = 0;
+
+        // strings resolved in the constant pool
+        std::vector<std::pair<u2, oop>> constants;
+
+        if (klass->getClassType() == ClassType::INSTANCE_CLASS) {
+            auto instanceClass = (InstanceKlass *) klass;
+            loader = instanceClass->_javaLoader;
+            instanceSize = instanceClass->getInstanceHeaderSize() + instanceClass->getInstanceFieldSize();
+
+            auto rt = instanceClass->getRuntimeConstantPool();
+            for (int i = 1; rt != nullptr && i < rt->_entryCount; ++i) {
+                if (rt->_rawPool[i] != nullptr
+                    && rt->getConstantTag(i) == CONSTANT_String) {
+                    oop stringOop = Resolver::instance(rt->_pool[i]);
+                    if (stringOop != nullptr) {
+                        constants.emplace_back((u2) i, stringOop);
+                    }
+                }
+            }
+        } else {
+            // arrays extend java.lang.Object
+            loader = ((ArrayKlass *) klass)->getJavaLoader();
+            superClass = Global::_Object;
+        }
+
+        u8 size = 1 + HPROF_ID_SIZE + 4 + 6 * HPROF_ID_SIZE + 4
+                  + 2 + constants.size() * (2 + 1 + HPROF_ID_SIZE)
+                  + 2 + 2 + hprofClass._instanceFields.size() * (HPROF_ID_SIZE + 1);
+        for (const auto &field : hprofClass._staticFields) {
+            size += HPROF_ID_SIZE + 1 + getHprofValueSize(field._type);
+        }
+
+        beginSubRecord(size);
+        writeU1(HPROF_GC_CLASS_DUMP);
+        writeU8(getClassId(klass));
+        writeU4(HPROF_EMPTY_TRACE);
+        writeU8(superClass != nullptr ? getClassId(superClass) : 0);
+        writeId(loader);
+        // signers, protection domain and two reserved ids
+        writeU8(0);
+        writeU8(0);
+        writeU8(0);
+        writeU8(0);
+        writeU4((u4) instanceSize);
+
+        writeU2((u2) constants.size());
+        for (const auto &constant : constants) {
+            writeU2(constant.first);
+            writeU1(HPROF_OBJECT);
+            writeId(constant.second);
+        }
+
+        writeU2((u2) hprofClass._staticFields.size());
+        for (const auto &field : hprofClass._staticFields) {
+            writeU8(field._nameId);
+            writeU1(field._type);
+            writeValue(field._type, ((InstanceKlass *) klass)->getStaticFieldAddress<jbyte>(field._offset));
+        }
+
+        writeU2((u2) hprofClass._instanceFields.size());
+        for (const auto &field : hprofClass._instanceFields) {
+            writeU8(field._nameId);
+            writeU1(field._type);
+        }
+    }
+
+    void HprofWriter::writeObject(oop object) {
+        if (object->getClass() == nullptr) {
+            // allocated while the VM was booting
+            return;
+        }
+
+        switch (object->getMarkOop()->getOopType()) {
+            case oopType::INSTANCE_OOP:
+                // a mirror of a class is dumped as the class itself
+                if (Global::_Class != nullptr && object->getClass() == Global::_Class
+                    && ((mirrorOop) object)->getTarget() != nullptr) {
+                    return;
+                }
+                writeInstance((instanceOop) object);
+                break;
+
+            case oopType::OBJECT_ARRAY_OOP:
+            case oopType::TYPE_ARRAY_OOP: {
+                auto array = (arrayOop) object;
+                auto arrayClass = (ArrayKlass *) array->getClass();
+                if (arrayClass->hasOopElements()) {
+                    writeObjectArray(array);
+                } else {
+                    writePrimitiveArray(array, ((TypeArrayKlass *) arrayClass)->getComponentType());
+                }
+                break;
+            }
+
+            case oopType::PRIMITIVE_OOP:
+                // values boxed by the VM itself, invisible to Java code
+                return;
+
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
+        ++_objects;
+    }
+
+    void HprofWriter::writeInstance(instanceOop instance) {
+        // values of the class's fields, then of its superclass's
+        std::vector<const HprofClass *> hierarchy;
+        u8 valuesSize = 0;
+        for (Klass *klass = instance->getClass(); klass != nullptr; klass = klass->getSuperClass()) {
+            const HprofClass &hprofClass = _classes[_classIndexes.at(klass)];
+            hierarchy.push_back(&hprofClass);
+            for (const auto &field : hprofClass._instanceFields) {
+                valuesSize += getHprofValueSize(field._type);
+            }
+        }
+
+        beginSubRecord(1 + HPROF_ID_SIZE + 4 + HPROF_ID_SIZE + 4 + valuesSize);
+        writeU1(HPROF_GC_INSTANCE_DUMP);
+        writeId(instance);
+        writeU4(HPROF_EMPTY_TRACE);
+        writeU8(getClassId(instance->getClass()));
+        writeU4((u4) valuesSize);
+        for (auto hprofClass : hierarchy) {
+            for (const auto &field : hprofClass->_instanceFields) {
+                writeValue(field._type, instance->getFieldAddress<jbyte>(field._offset));
+            }
+        }
+    }
+
+    /**
+     * A segment cannot hold more than {@code HPROF_SEGMENT_LIMIT} bytes,
+     * elements that do not fit are left out.
+     */
+    static u4 getDumpedLength(arrayOop array, size_t elementSize) {
+        u4 length = (u4) array->getLength();
+        u8 maxLength = (HPROF_SEGMENT_LIMIT - 64) / elementSize;
+        if (length > maxLength) {
+            WARN("HeapDumper: array %p truncated from %u to %llu elements",
+                array, length, (unsigned long long) maxLength);
+            return (u4) maxLength;
+        }
+        return length;
+    }
+
+    void HprofWriter::writeObjectArray(arrayOop array) {
+        u4 length = getDumpedLength(array, HPROF_ID_SIZE);
+        beginSubRecord(1 + HPROF_ID_SIZE + 4 + 4 + HPROF_ID_SIZE + (u8) length * HPROF_ID_SIZE);
+        writeU1(HPROF_GC_OBJ_ARRAY_DUMP);
+        writeId(array);
+        writeU4(HPROF_EMPTY_TRACE);
+        writeU4(length);
+        writeU8(getClassId(array->getClass()));
+        for (u4 i = 0; i < length; ++i) {
+            writeId(array->getElementAt(i));
+        }
+    }
+
+    void HprofWriter::writePrimitiveArray(arrayOop array, ValueType componentType) {
+        u1 type = toHprofType(componentType);
+        size_t elementSize = getHprofValueSize(type);
+
+        u4 length = getDumpedLength(array, elementSize);
+        beginSubRecord(1 + HPROF_ID_SIZE + 4 + 4 + 1 + (u8) length * elementSize);
+        writeU1(HPROF_GC_PRIM_ARRAY_DUMP);
+        writeId(array);
+        writeU4(HPROF_EMPTY_TRACE);
+        writeU4(length);
+        writeU1(type);
+
+        const jbyte *elements = array->getElements();
+        if (elementSize == 1) {
+            writeBytes(elements, length);
+            return;
+        }
+
+        // swap to big endian a chunk at a time
+        u1 chunk[8192];
+        size_t chunkElements = sizeof(chunk) / elementSize;
+        for (u4 begin = 0; begin < length; begin += chunkElements) {
+            size_t count = std::min((size_t) (length - begin), chunkElements);
+            const jbyte *from = elements + begin * elementSize;
+            for (size_t i = 0; i < count; ++i) {
+                for (size_t b = 0; b < elementSize; ++b) {
+                    chunk[i * elementSize + b] = (u1) from[i * elementSize + elementSize - 1 - b];
+                }
+            }
+            writeBytes(chunk, count * elementSize);
+        }
+    }
+
+    void HprofWriter::writeAll() {
+        writeHeader();
+
+        collectClasses();
+        collectThreads();
+        writeLoadClasses();
+        writeStackTraces();
+
+        writeRoots();
+        for (const auto &hprofClass : _classes) {
+            writeClassDump(hprofClass);
+        }
+        forEachObject([this](oop object) {
+            writeObject(object);
+        });
+        endSegment();
+
+        writeRecordHeader(HPROF_HEAP_DUMP_END, 0);
+    }
+
+    bool HeapDumper::dump(const std::string &path) {
+        FILE *file = fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            WARN("HeapDumper: cannot open %s: %s", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        auto startedAt = std::chrono::steady_clock::now();
+        HprofWriter writer(file);
+        writer.writeAll();
+
+        bool failed = ferror(file) != 0;
+        if (fclose(file) != 0 || failed) {
+            WARN("HeapDumper: failed to write %s", path.c_str());
+            return false;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startedAt);
+        D("HeapDumper: dumped %zu objects to %s in %lld ms",
+            writer.getObjectCount(), path.c_str(), (long long) elapsed.count());
+        return true;
+    }
+
+    std::string HeapDumper::getDefaultPath() {
+        const auto &path = RuntimeConfig::get().heapDumpPath;
+        std::string fileName = "java_pid" + std::to_string(getpid()) + ".hprof";
+        if (path.empty()) {
+            return fileName;
+        }
+
+        struct stat status{};
+        if (stat(path.c_str(), &status) == 0 && (status.st_mode & S_IFMT) == S_IFDIR) {
+            return path + "/" + fileName;
+        }
+        return path;
+    }
+}
@@ -0,0 +1,177 @@
+//
+// Non-moving space for large objects
+//
+#include <kivm/memory/largeObjectSpace.h>
+#include <kivm/memory/universe.h>
+
+namespace kivm {
+    void LargeObjectSpace::initialize(jbyte *start, size_t reservedSize) {
+        _start = start;
+        _end = start + reservedSize;
+        _top = start;
+        D("LargeObjectSpace: %p ~ %p", _start, _end);
+    }
+
+    void LargeObjectSpace::addFreeChunk(jbyte *start, size_t size) {
+        _freeChunks.insert(std::make_pair(size, start));
+    }
+
+    void LargeObjectSpace::removeFreeChunk(jbyte *start, size_t size) {
+        auto range = _freeChunks.equal_range(size);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (iter->second == start) {
+                _freeChunks.erase(iter);
+                return;
+            }
+        }
+        SHOULD_NOT_REACH_HERE();
+    }
+
+    jbyte *LargeObjectSpace::takeChunk(size_t size) {
+        // best fit
+        auto fit = _freeChunks.lower_bound(size);
+        if (fit != _freeChunks.end()) {
+            jbyte *start = fit->second;
+            size_t chunkSize = fit->first;
+            _freeChunks.erase(fit);
+
+            auto &chunk = _chunks.at(start);
+            chunk._free = false;
+            chunk._size = size;
+
+            // the rest stays free
+            if (chunkSize > size) {
+                _chunks.emplace(std::piecewise_construct,
+                    std::forward_as_tuple(start + size),
+                    std::forward_as_tuple(chunkSize - size, true));
+                addFreeChunk(start + size, chunkSize - size);
+            }
+            return start;
+        }
+
+        if ((size_t) (_end - _top) < size) {
+            return nullptr;
+        }
+        jbyte *start = _top;
+        _top += size;
+        _chunks.emplace(std::piecewise_construct,
+            std::forward_as_tuple(start),
+            std::forward_as_tuple(size, false));
+        return start;
+    }
+
+    void *LargeObjectSpace::allocate(size_t size, size_t limit) {
+        size = alignUp(size, Universe::getPageSize());
+
+        LockGuard guard(_lock);
+        if (_used + size > limit) {
+            return nullptr;
+        }
+
+        jbyte *start = takeChunk(size);
+        if (start == nullptr) {
+            return nullptr;
+        }
+
+        if (!Universe::commitVirtual(start, size)) {
+            freeChunk(_chunks.find(start));
+            return nullptr;
+        }
+
+        _used += size;
+        ++_objectCount;
+        return start;
+    }
+
+    void LargeObjectSpace::freeChunk(std::map<jbyte *, Chunk>::iterator chunk) {
+        jbyte *start = chunk->first;
+        size_t size = chunk->second._size;
+        Universe::uncommitVirtual(start, size);
+
+        // merge with the next chunk
+        auto next = std::next(chunk);
+        if (next != _chunks.end() && next->second._free) {
+            removeFreeChunk(next->first, next->second._size);
+            size += next->second._size;
+            _chunks.erase(next);
+        }
+
+        // merge with the previous chunk
+        if (chunk != _chunks.begin()) {
+            auto previous = std::prev(chunk);
+            if (previous->second._free) {
+                removeFreeChunk(previous->first, previous->second._size);
+                start = previous->first;
+                size += previous->second._size;
+                _chunks.erase(chunk);
+                chunk = previous;
+            }
+        }
+
+        // give the tail back to space never used
+        if (start + size == _top) {
+            _top = start;
+            _chunks.erase(chunk);
+            return;
+        }
+
+        chunk->second._free = true;
+        chunk->second._size = size;
+        chunk->second._marked = false;
+        addFreeChunk(start, size);
+    }
+
+    bool LargeObjectSpace::mark(oop object) {
+        auto &chunk = _chunks.at((jbyte *) object);
+        if (chunk._marked.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return !chunk._marked.exchange(true);
+    }
+
+    bool LargeObjectSpace::isMarked(oop object) const {
+        return _chunks.at((jbyte *) object)._marked.load(std::memory_order_relaxed);
+    }
+
+    size_t LargeObjectSpace::sweep() {
+        size_t freed = 0;
+        auto iter = _chunks.begin();
+        while (iter != _chunks.end()) {
+            auto chunk = iter++;
+            if (chunk->second._free) {
+                continue;
+            }
+
+            if (chunk->second._marked) {
+                chunk->second._marked = false;
+                continue;
+            }
+
+            // the next chunk may be merged into this one
+            jbyte *next = iter == _chunks.end() ? nullptr : iter->first;
+            size_t size = chunk->second._size;
+            freed += size;
+            _used -= size;
+            --_objectCount;
+            freeChunk(chunk);
+            iter = next == nullptr ? _chunks.end() : _chunks.lower_bound(next);
+        }
+        return freed;
+    }
+
+    void LargeObjectSpace::objectIterate(const std::function<void(oop)> &callback) {
+        for (auto &chunk : _chunks) {
+            if (!chunk.second._free) {
+                callback((oop) chunk.first);
+            }
+        }
+    }
+
+    void LargeObjectSpace::chunkIterate(const std::function<void(jbyte *, size_t)> &callback) {
+        for (auto &chunk : _chunks) {
+            if (!chunk.second._free) {
+                callback(chunk.first, chunk.second._size);
+            }
+        }
+    }
+}
@@ -0,0 +1,260 @@
+//
+// Marking and compaction of the mark-compact heap
+//
+
+#include <kivm/memory/markCompactHeap.h>
+#include <kivm/oop/monitorTable.h>
+#include <kivm/memory/referenceProcessor.h>
+#include <cstring>
+
+// Live objects are marked in a side bitmap by GC workers in parallel,
+// roots are enumerated by GCRoots and claimed task by task, marked objects
+// are queued in the marking worker's deque, idle workers steal from others.
+//
+// The remaining phases run on the GC thread alone, each a linear walk
+// of the space. Objects only move towards the heap start, and in address
+// order, so sliding one never overwrites another that has not moved yet.
+//
+// While forwarded, a header keeps its oop type, so that objects can still
+// be walked. Hashes and monitor indexes are preserved aside, and restored
+// when objects arrive at their new addresses.
+
+namespace kivm {
+    /**
+     * Size of the object or filler at {@code p}, aligned.
+     */
+    static inline size_t getBlockSize(jbyte *p) {
+        if (HeapRegion::isFiller(p)) {
+            return HeapRegion::getFillerSize(p);
+        }
+        return alignUp(((oop) p)->getObjectSize(), sizeof(jlong));
+    }
+
+    /**
+     * Point a reference to the new address of the object.
+     */
+    static inline void adjustSlot(oop *slot) {
+        oop object = *slot;
+        if (object != nullptr && object->getMarkOop()->isForwarded()) {
+            *slot = object->getMarkOop()->getForwardee();
+        }
+    }
+
+    struct AdjustClosure final : public OopClosure {
+        void doOop(oop *slot) override {
+            adjustSlot(slot);
+        }
+    };
+
+    void MarkingWorker::doOop(oop *slot) {
+        _heap->markObject(this, *slot);
+    }
+
+    bool MarkCompactHeap::tryMark(const void *addr) {
+        size_t index = getBitIndex(addr);
+        u8 *word = _markBits + index / 64;
+        u8 bit = 1ULL << (index % 64);
+
+        u8 value;
+        do {
+            value = *word;
+            if ((value & bit) != 0) {
+                return false;
+            }
+        } while (cmpxchg(word, value, value | bit) != value);
+        return true;
+    }
+
+    void MarkCompactHeap::markObject(MarkingWorker *worker, oop object) {
+        if (object == nullptr || !_space.contains(object)) {
+            return;
+        }
+
+        if (tryMark(object)) {
+            ++worker->_markedObjects;
+            worker->_queue.push(object);
+        }
+    }
+
+    void MarkCompactHeap::workOn(MarkingWorker *worker) {
+        size_t task;
+        while ((task = _nextRootTask++) < _rootTasks.size()) {
+            _rootTasks[task](worker);
+        }
+
+        oop object = nullptr;
+        while (true) {
+            while (worker->_queue.pop(object)) {
+                // a referent that may die is left to processReferences()
+                auto start = (jbyte *) object;
+                oop *referent = _referenceProcessor->discover(object, start, start + object->getObjectSize(),
+                    [this](oop target) {
+                        return _space.contains(target);
+                    });
+
+                OopIterator::iterate(object, [=](oop *slot) {
+                    if (slot != referent) {
+                        markObject(worker, *slot);
+                    }
+                });
+            }
+
+            if (_queueSet.steal(worker->_workerId, object)) {
+                worker->_queue.push(object);
+                continue;
+            }
+
+            if (_queueSet.offerTermination()) {
+                break;
+            }
+        }
+    }
+
+    void MarkCompactHeap::markLiveObjects() {
+        _rootTasks.clear();
+        _nextRootTask = 0;
+        GCRoots::collectTasks(_rootTasks);
+
+        _queueSet.resetTermination();
+        _workerPool->runTask([this](int workerId) {
+            workOn(_workers[workerId]);
+        });
+
+        for (auto worker : _workers) {
+            _markedObjects += worker->_markedObjects;
+            worker->_markedObjects = 0;
+        }
+        _rootTasks.clear();
+    }
+
+    size_t MarkCompactHeap::processReferences() {
+        // referents kept alive are moved by adjustReferences()
+        return _referenceProcessor->process([this](oop *slot) {
+            return isMarked(*slot);
+        }, [](oop *) {});
+    }
+
+    jbyte *MarkCompactHeap::computeAddresses() {
+        jbyte *compactTop = _space._regionStart;
+        jbyte *deadStart = nullptr;
+        jbyte *p = _space._regionStart;
+        jbyte *top = _space._current;
+
+        _preservedHeaders.clear();
+        while (p < top) {
+            size_t size = getBlockSize(p);
+            if (HeapRegion::isFiller(p) || !isMarked(p)) {
+                if (deadStart == nullptr) {
+                    deadStart = p;
+                }
+                p += size;
+                continue;
+            }
+
+            // a dead run ends here, skip it as a whole in later walks
+            if (deadStart != nullptr) {
+                HeapRegion::fill(deadStart, p - deadStart);
+                deadStart = nullptr;
+            }
+
+            auto mark = ((oop) p)->getMarkOop();
+            u8 header = mark->getValue();
+            if (mark->hasMonitor()) {
+                MonitorTable::markLive(mark->getMonitorIndex());
+            }
+            if (header != (u8) mark->getOopType()) {
+                _preservedHeaders.emplace_back((oop) compactTop, header);
+            }
+
+            mark->forwardKeepingType((oop) compactTop);
+            compactTop += size;
+            p += size;
+        }
+
+        if (deadStart != nullptr) {
+            HeapRegion::fill(deadStart, top - deadStart);
+        }
+        return compactTop;
+    }
+
+    void MarkCompactHeap::adjustReferences() {
+        AdjustClosure closure;
+        GCRoots::doAll(&closure);
+
+        // only live objects are left after computeAddresses()
+        jbyte *p = _space._regionStart;
+        jbyte *top = _space._current;
+        while (p < top) {
+            size_t size = getBlockSize(p);
+            if (!HeapRegion::isFiller(p)) {
+                OopIterator::iterate((oop) p, [](oop *slot) {
+                    adjustSlot(slot);
+                });
+            }
+            p += size;
+        }
+    }
+
+    void MarkCompactHeap::slideObjects() {
+        jbyte *p = _space._regionStart;
+        jbyte *top = _space._current;
+        while (p < top) {
+            size_t size = getBlockSize(p);
+            if (!HeapRegion::isFiller(p)) {
+                auto mark = ((oop) p)->getMarkOop();
+                oopType type = mark->getOopType();
+                oop newOop = mark->getForwardee();
+                if ((jbyte *) newOop != p) {
+                    memmove((void *) newOop, p, size);
+                }
+                newOop->getMarkOop()->setValue((u8) type);
+            }
+            p += size;
+        }
+
+        for (const auto &item : _preservedHeaders) {
+            item.first->getMarkOop()->setValue(item.second);
+        }
+        _preservedHeaders.clear();
+
+        // mark bits of everything walked
+        size_t bitCount = alignUp(getBitIndex(top), 64);
+        memset(_markBits, 0, bitCount / 8);
+    }
+
+    void MarkCompactHeap::doGarbageCollection() {
+        size_t beforeUsed = _space.getUsed();
+        GCEvent event = beginPause("mark-compact", beforeUsed);
+        _markedObjects = 0;
+        beginReferenceDiscovery(beforeUsed, true);
+
+        retireTlabs();
+
+        D("[GCThread]: marking with %d workers", _workerPool->getWorkerCount());
+        markLiveObjects();
+
+        D("[GCThread]: clearing references to unreachable objects");
+        size_t clearedReferences = processReferences();
+
+        D("[GCThread]: computing new addresses");
+        jbyte *newTop = computeAddresses();
+
+        D("[GCThread]: freeing monitors of unreachable objects");
+        size_t freedMonitors = MonitorTable::sweep();
+        // there is no young generation, the sweep covers them
+        MonitorTable::takeYoungOwners();
+
+        D("[GCThread]: adjusting references");
+        adjustReferences();
+
+        D("[GCThread]: sliding objects");
+        slideObjects();
+        _space._current = newTop;
+
+        adjustSpace();
+
+        D("[GCDetails]: [mark-compact: %zd -> %zd(%zd), oops: %zd, freed monitors: %zd, cleared references: %zd]",
+            beforeUsed, _space.getUsed(), _space.getSize(), _markedObjects, freedMonitors, clearedReferences);
+        endPause(event, _space.getUsed(), _markedObjects);
+    }
+}
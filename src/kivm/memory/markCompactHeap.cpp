@@ -0,0 +1,243 @@
+//
+// Mark-compact heap
+//
+
+#include <kivm/memory/markCompactHeap.h>
+#include <kivm/memory/universe.h>
+#include <kivm/memory/allocationSampler.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <kivm/runtime/javaThread.h>
+#include <algorithm>
+
+#define SPACE_ALIGNMENT (64 * 1024)
+
+// One mark bit for every heap word
+#define HEAP_BYTES_PER_MARK_BYTE (sizeof(jlong) * 8)
+
+namespace kivm {
+    jbyte *MarkCompactHeap::getMarkBytes(size_t heapOffset) const {
+        return (jbyte *) _markBits + heapOffset / HEAP_BYTES_PER_MARK_BYTE;
+    }
+
+    MarkCompactHeap::MarkCompactHeap()
+        : _initialSize(RuntimeConfig::get().initialHeapSizeInBytes),
+          _maxSize(RuntimeConfig::get().maxHeapSizeInBytes),
+          _tlabSize(alignUp(RuntimeConfig::get().tlabSizeInBytes, sizeof(jlong))),
+          _nextRootTask(0) {
+        if (_maxSize < _initialSize) {
+            _maxSize = _initialSize;
+        }
+        D("MarkCompactHeap: initialHeapSize: %zd, maxHeapSize: %zd, tlabSize: %zd",
+            _initialSize, _maxSize, _tlabSize);
+    }
+
+    MarkCompactHeap::~MarkCompactHeap() {
+        delete _workerPool;
+        for (auto worker : _workers) {
+            delete worker;
+        }
+
+        if (_markBits != nullptr) {
+            Universe::releaseVirtual(_markBits, _markBitsReservedSize);
+            _markBits = nullptr;
+        }
+
+        if (_memoryStart != nullptr) {
+            Universe::releaseVirtual(_memoryStart, _reservedSize);
+            _memoryStart = nullptr;
+        }
+    }
+
+    void *MarkCompactHeap::allocate(size_t size) {
+        // keep objects aligned, so that the space can be walked
+        size = alignUp(size, sizeof(jlong));
+
+        auto currentThread = Threads::currentThread();
+        void *m = allocateInSpace(currentThread, size);
+        if (m != nullptr) {
+            return m;
+        }
+
+        // out of memory, let's try GC
+        if (currentThread == nullptr) {
+            PANIC("OutOfMemoryError: heap (not in JavaThread)");
+        }
+
+        D("MarkCompactHeap: out of memory, will retry after GC, required size: %zd", size);
+        if (size > _requiredSize) {
+            _requiredSize = size;
+        }
+        if (collectAndWait(currentThread)) {
+            // try again
+            D("MarkCompactHeap: retry");
+            m = allocateInSpace(currentThread, size);
+            if (m != nullptr) {
+                D("MarkCompactHeap: successfully allocated %zd bytes after GC", size);
+                return m;
+            }
+
+            // last try, with everything softly reachable freed
+            if (collectClearingSoftReferences(currentThread)) {
+                m = allocateInSpace(currentThread, size);
+                if (m != nullptr) {
+                    return m;
+                }
+            }
+        }
+
+        return throwOutOfMemoryError(size);
+    }
+
+    void *MarkCompactHeap::allocateInSpace(JavaThread *thread, size_t size) {
+        // threads other than JavaThreads have no TLAB
+        if (thread == nullptr) {
+            return _space.allocateAtomic(size);
+        }
+
+        // fast path
+        auto &tlab = thread->getTlab();
+        void *m = tlab.allocate(size);
+        if (m != nullptr) {
+            return m;
+        }
+
+        // Do not throw away a TLAB with much free space for a big object,
+        // allocate it directly in the space instead.
+        if (size >= _tlabSize
+            || (size > _tlabSize / 8 && tlab.getFree() > _tlabSize / 8)) {
+            AllocationSampler::sample(thread, size);
+            return _space.allocateAtomic(size);
+        }
+
+        // refill
+        auto chunk = (jbyte *) _space.allocateAtomic(_tlabSize);
+        if (chunk == nullptr) {
+            // the space is nearly full, but the remaining space may be enough
+            AllocationSampler::sample(thread, size);
+            return _space.allocateAtomic(size);
+        }
+        AllocationSampler::sample(thread, _tlabSize);
+        HeapRegion::fill(tlab._top, tlab.getFree());
+        tlab.fill(chunk, _tlabSize);
+        return tlab.allocate(size);
+    }
+
+    void MarkCompactHeap::retireTlabs() {
+        Threads::forEach([](JavaThread *thread) {
+            auto &tlab = thread->getTlab();
+            if (tlab._start != nullptr) {
+                HeapRegion::fill(tlab._top, tlab.getFree());
+            }
+            tlab.reset();
+            return false;
+        });
+    }
+
+    void MarkCompactHeap::objectIterate(const std::function<void(oop)> &callback) {
+        retireTlabs();
+        walkRegion(&_space, callback);
+    }
+
+    void MarkCompactHeap::initializeAll() {
+        initializeSpace();
+
+        _workerPool = new GCWorkerPool(RuntimeConfig::get().gcWorkerThreads);
+        for (int i = 0; i < _workerPool->getWorkerCount(); ++i) {
+            auto worker = new MarkingWorker(this, i);
+            _workers.push_back(worker);
+            _queueSet.addQueue(&worker->_queue);
+        }
+    }
+
+    void MarkCompactHeap::initializeSpace() {
+        size_t initialSize = alignDown(_initialSize, SPACE_ALIGNMENT);
+        _reservedSize = alignDown(_maxSize, SPACE_ALIGNMENT);
+        if (initialSize == 0) {
+            PANIC("Heap size too small: %zd", _initialSize);
+        }
+
+        _memoryStart = (jbyte *) Universe::reserveHeapVirtual(_reservedSize);
+        if (_memoryStart == nullptr) {
+            PANIC("MarkCompactHeap: cannot reserve %zd bytes", _reservedSize);
+        }
+        D("MarkCompactHeap: virtual memory reserved: %p", _memoryStart);
+
+        _markBitsReservedSize = _reservedSize / HEAP_BYTES_PER_MARK_BYTE;
+        _markBits = (u8 *) Universe::reserveVirtual(_markBitsReservedSize);
+        if (_markBits == nullptr) {
+            PANIC("MarkCompactHeap: cannot reserve %zd bytes for mark bits", _markBitsReservedSize);
+        }
+
+        if (!Universe::commitVirtual(_memoryStart, initialSize)
+            || !Universe::commitVirtual(_markBits, initialSize / HEAP_BYTES_PER_MARK_BYTE)) {
+            PANIC("MarkCompactHeap: cannot commit %zd bytes", initialSize);
+        }
+
+        _space._regionStart = _memoryStart;
+        _space._current = _memoryStart;
+        _space._regionSize = initialSize;
+        _initialSize = initialSize;
+        D("MarkCompactHeap: space: %zd, max: %zd", initialSize, _reservedSize);
+    }
+
+    bool MarkCompactHeap::resizeSpace(size_t newSize) {
+        newSize = alignUp(newSize, SPACE_ALIGNMENT);
+        if (newSize < _initialSize) {
+            newSize = _initialSize;
+        }
+        if (newSize > _reservedSize) {
+            newSize = _reservedSize;
+        }
+
+        size_t currentSize = _space.getSize();
+        if (newSize == currentSize) {
+            return true;
+        }
+
+        if (newSize > currentSize) {
+            size_t delta = newSize - currentSize;
+            if (!Universe::commitVirtual(_memoryStart + currentSize, delta)) {
+                return false;
+            }
+            if (!Universe::commitVirtual(getMarkBytes(currentSize), delta / HEAP_BYTES_PER_MARK_BYTE)) {
+                Universe::uncommitVirtual(_memoryStart + currentSize, delta);
+                return false;
+            }
+        } else {
+            // only the tail above live objects can be given back
+            if (newSize < _space.getUsed()) {
+                return false;
+            }
+            size_t delta = currentSize - newSize;
+            Universe::uncommitVirtual(_memoryStart + newSize, delta);
+            Universe::uncommitVirtual(getMarkBytes(newSize), delta / HEAP_BYTES_PER_MARK_BYTE);
+        }
+
+        _space._regionSize = newSize;
+        D("MarkCompactHeap: space resized: %zd -> %zd", currentSize, newSize);
+        return true;
+    }
+
+    void MarkCompactHeap::adjustSpace() {
+        size_t live = _space.getUsed();
+        size_t capacity = _space.getSize();
+
+        // leave room for the allocation that asked for this collection
+        size_t required = live + _requiredSize + _tlabSize;
+        _requiredSize = 0;
+
+        if (required > capacity || live * 100 > capacity * GROW_OCCUPANCY) {
+            _lowOccupancyCollections = 0;
+            resizeSpace(std::max(capacity * 2, required));
+
+        } else if (live * 100 < capacity * SHRINK_OCCUPANCY) {
+            if (++_lowOccupancyCollections >= SHRINK_DELAY) {
+                _lowOccupancyCollections = 0;
+                resizeSpace(std::max(capacity / 2, required));
+            }
+
+        } else {
+            _lowOccupancyCollections = 0;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+//
+// Discovery and processing of soft, weak and phantom references
+//
+
+#include <kivm/memory/referenceProcessor.h>
+#include <kivm/memory/universe.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <chrono>
+
+namespace kivm {
+    int ReferenceProcessor::sReferentOffset = -1;
+    int ReferenceProcessor::sQueueOffset = -1;
+    int ReferenceProcessor::sDiscoveredOffset = -1;
+
+    InstanceKlass *ReferenceProcessor::sSoftReferenceClass = nullptr;
+    int ReferenceProcessor::sSoftClockOffset = -1;
+    int ReferenceProcessor::sSoftTimestampOffset = -1;
+
+    oop ReferenceProcessor::sPendingList = nullptr;
+    Monitor ReferenceProcessor::sPendingListMonitor;
+
+    static int requireInstanceField(InstanceKlass *klass, const String &name, const String &descriptor) {
+        auto id = klass->getInstanceFieldInfo(klass->getName(), name, descriptor);
+        if (id == nullptr) {
+            PANIC("%S: missing field %S %S",
+                klass->getName().c_str(), name.c_str(), descriptor.c_str());
+        }
+        return id->_offset;
+    }
+
+    // SoftReference.clock starts at 0 when the class is initialized,
+    // so does our clock, or every idle time would look huge at first
+    static const auto sStartedAt = std::chrono::steady_clock::now();
+
+    jlong ReferenceProcessor::currentTimeMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - sStartedAt).count();
+    }
+
+    void ReferenceProcessor::onReferenceClassLinked(InstanceKlass *referenceClass) {
+        sReferentOffset = requireInstanceField(referenceClass, L"referent", L"Ljava/lang/Object;");
+        sQueueOffset = requireInstanceField(referenceClass, L"queue", L"Ljava/lang/ref/ReferenceQueue;");
+        sDiscoveredOffset = requireInstanceField(referenceClass, L"discovered", L"Ljava/lang/ref/Reference;");
+    }
+
+    void ReferenceProcessor::onSoftReferenceClassLinked(InstanceKlass *softReferenceClass) {
+        sSoftTimestampOffset = requireInstanceField(softReferenceClass, L"timestamp", L"J");
+
+        auto clock = softReferenceClass->getStaticFieldInfo(softReferenceClass->getName(), L"clock", L"J");
+        if (clock == nullptr) {
+            PANIC("java/lang/ref/SoftReference: missing field clock J");
+        }
+        sSoftClockOffset = clock->_offset;
+        sSoftReferenceClass = softReferenceClass;
+    }
+
+    void ReferenceProcessor::waitForPendingReferences() {
+        sPendingListMonitor.enter();
+        while (sPendingList == nullptr) {
+            sPendingListMonitor.wait();
+        }
+        sPendingListMonitor.leave();
+    }
+
+    instanceOop ReferenceProcessor::takePendingList() {
+        sPendingListMonitor.enter();
+        auto pending = (instanceOop) sPendingList;
+        sPendingList = nullptr;
+        sPendingListMonitor.leave();
+        return pending;
+    }
+
+    bool ReferenceProcessor::shouldDiscoverSoftReference(instanceOop reference) const {
+        if (_clearAllSoftReferences) {
+            return true;
+        }
+        jlong timestamp = *reference->getFieldAddress<jlong>(sSoftTimestampOffset);
+        return _softClock - timestamp > _softMaxInterval;
+    }
+
+    void ReferenceProcessor::beginDiscovery(size_t freeBytes, bool clearAllSoftReferences) {
+        if (sReferentOffset < 0) {
+            // no reference can exist yet
+            return;
+        }
+
+        _discovered.clear();
+        _clearAllSoftReferences = clearAllSoftReferences;
+        _softMaxInterval = (jlong) (freeBytes / SIZE_MB(1))
+                           * RuntimeConfig::get().softRefLRUPolicyMSPerMB;
+        _softClock = sSoftReferenceClass == nullptr
+                     ? 0
+                     : *sSoftReferenceClass->getStaticFieldAddress<jlong>(sSoftClockOffset);
+        _discoveryEnabled = true;
+    }
+
+    size_t ReferenceProcessor::process(const std::function<bool(oop *)> &keepAlive,
+                                       const std::function<void(oop *)> &onStore) {
+        if (!_discoveryEnabled) {
+            return 0;
+        }
+        _discoveryEnabled = false;
+
+        size_t cleared = 0;
+        sPendingListMonitor.enter();
+        for (auto reference : _discovered) {
+            oop *referent = getReferentAddress(reference);
+            if (keepAlive(referent)) {
+                onStore(referent);
+                continue;
+            }
+
+            // nothing else is tracing now, there is no need for barriers
+            *referent = nullptr;
+            oop *discovered = getDiscoveredAddress(reference);
+            *discovered = sPendingList;
+            onStore(discovered);
+            sPendingList = reference;
+            ++cleared;
+        }
+        if (cleared > 0) {
+            sPendingListMonitor.notifyAll();
+        }
+        sPendingListMonitor.leave();
+        _discovered.clear();
+
+        // referents read before this collection are idle since now
+        if (sSoftReferenceClass != nullptr) {
+            *sSoftReferenceClass->getStaticFieldAddress<jlong>(sSoftClockOffset) = currentTimeMillis();
+        }
+        return cleared;
+    }
+}
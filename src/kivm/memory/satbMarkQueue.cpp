@@ -0,0 +1,77 @@
+//
+// Snapshot-at-the-beginning mark queues
+//
+#include <kivm/memory/satbMarkQueue.h>
+#include <kivm/runtime/javaThread.h>
+
+namespace kivm {
+    SatbMarkQueueSet::SatbMarkQueueSet()
+        : _active(false), _completedBufferCount(0) {
+    }
+
+    void SatbMarkQueueSet::setActive(bool active) {
+        _active.store(active, std::memory_order_relaxed);
+    }
+
+    void SatbMarkQueueSet::completeBufferLocked(std::vector<oop> &buffer) {
+        _completedBuffers.push_back(std::move(buffer));
+        buffer = std::vector<oop>();
+        _completedBufferCount.store(_completedBuffers.size(), std::memory_order_relaxed);
+    }
+
+    void SatbMarkQueueSet::enqueue(oop previous) {
+        auto thread = Threads::currentThread();
+        if (thread == nullptr) {
+            LockGuard guard(_lock);
+            _sharedBuffer.push_back(previous);
+            if (_sharedBuffer.size() >= SatbMarkQueue::CAPACITY) {
+                completeBufferLocked(_sharedBuffer);
+            }
+            return;
+        }
+
+        auto &buffer = thread->getSatbQueue()._buffer;
+        if (buffer.capacity() == 0) {
+            buffer.reserve(SatbMarkQueue::CAPACITY);
+        }
+        buffer.push_back(previous);
+        if (buffer.size() >= SatbMarkQueue::CAPACITY) {
+            LockGuard guard(_lock);
+            completeBufferLocked(buffer);
+        }
+    }
+
+    std::vector<std::vector<oop>> SatbMarkQueueSet::takeCompletedBuffers() {
+        LockGuard guard(_lock);
+        std::vector<std::vector<oop>> buffers;
+        buffers.swap(_completedBuffers);
+        _completedBufferCount.store(0, std::memory_order_relaxed);
+        return buffers;
+    }
+
+    void SatbMarkQueueSet::flushThreadBuffers() {
+        LockGuard guard(_lock);
+        Threads::forEach([this](JavaThread *thread) {
+            auto &buffer = thread->getSatbQueue()._buffer;
+            if (!buffer.empty()) {
+                completeBufferLocked(buffer);
+            }
+            return false;
+        });
+
+        if (!_sharedBuffer.empty()) {
+            completeBufferLocked(_sharedBuffer);
+        }
+    }
+
+    void SatbMarkQueueSet::abandon() {
+        LockGuard guard(_lock);
+        Threads::forEach([](JavaThread *thread) {
+            thread->getSatbQueue()._buffer.clear();
+            return false;
+        });
+        _sharedBuffer.clear();
+        _completedBuffers.clear();
+        _completedBufferCount.store(0, std::memory_order_relaxed);
+    }
+}
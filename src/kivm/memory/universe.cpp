@@ -3,29 +3,283 @@
 //
 #include <kivm/memory/universe.h>
 #include <kivm/memory/copyingHeap.h>
+#include <kivm/memory/markCompactHeap.h>
+#include <kivm/memory/concurrentMarkSweepHeap.h>
+#include <kivm/memory/gcLogger.h>
+#include <kivm/memory/allocationSampler.h>
+#include <kivm/runtime/runtimeConfig.h>
 #include <shared/mmap.h>
 #include <cstring>
 #include <cerrno>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if !defined(KIVM_PLATFORM_WINDOWS)
+#include <sys/syscall.h>
+#endif
 
 namespace kivm {
     CollectedHeap *Universe::sCollectedHeapInstance = nullptr;
+    CardTable *Universe::sCardTable = nullptr;
+    SatbMarkQueueSet *Universe::sSatbMarkQueueSet = nullptr;
+    static GCLogger *sGCLogger = nullptr;
 
     struct VirtualMemoryInfo {
         size_t memorySize;
     };
 
+    /**
+     * A Java heap reserved by {@code Universe::reserveHeapVirtual()}.
+     */
+    struct HeapReservation {
+        jbyte *start;
+        size_t size;
+
+        /**
+         * Granularity of commits, large pages for hugetlb heaps.
+         */
+        size_t pageSize;
+        bool hugeTLB;
+        bool numaPolicyApplied;
+
+        /**
+         * Large pages mapped from the hugetlb pool, only tracked for hugetlb heaps.
+         */
+        std::vector<bool> committed;
+    };
+
+    static std::vector<HeapReservation> &getHeapReservations() {
+        static std::vector<HeapReservation> reservations;
+        return reservations;
+    }
+
+    static Lock &heapReservationLock() {
+        static Lock lock;
+        return lock;
+    }
+
+    static HeapReservation *findHeapReservation(const void *addr) {
+        for (auto &reservation : getHeapReservations()) {
+            if (addr >= reservation.start && addr < reservation.start + reservation.size) {
+                return &reservation;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Touch one word of every page, so that the system backs them now
+     * instead of when Java threads first allocate there.
+     * Adding zero writes a page without changing what it holds,
+     * the heap may already have objects there when it grows.
+     */
+    static void preTouch(jbyte *start, jbyte *end, size_t pageSize) {
+        for (jbyte *page = start; page < end; page += pageSize) {
+            reinterpret_cast<std::atomic<int> *>(page)->fetch_add(0, std::memory_order_relaxed);
+        }
+    }
+
+#if !defined(KIVM_PLATFORM_WINDOWS)
+    /**
+     * @return the number after {@code key} in /proc/meminfo
+     */
+    static size_t readMemInfo(const char *key, size_t defaultValue) {
+        std::ifstream in("/proc/meminfo");
+        std::string line;
+        size_t keyLength = strlen(key);
+        while (std::getline(in, line)) {
+            if (line.compare(0, keyLength, key) == 0) {
+                return (size_t) strtoull(line.c_str() + keyLength, nullptr, 10);
+            }
+        }
+        return defaultValue;
+    }
+
+    /**
+     * @return online NUMA nodes, as listed like "0-3,6" by sysfs
+     */
+    static std::vector<int> getOnlineNumaNodes() {
+        std::vector<int> nodes;
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string range;
+        while (std::getline(in, range, ',')) {
+            int first = 0;
+            int last = 0;
+            int count = sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (count < 1) {
+                continue;
+            }
+            for (int node = first; node <= (count == 2 ? last : first); ++node) {
+                nodes.push_back(node);
+            }
+        }
+
+        if (nodes.empty()) {
+            nodes.push_back(0);
+        }
+        return nodes;
+    }
+
+    /**
+     * Set the NUMA policy of RuntimeConfig on {@code [memory, memory + size)}.
+     * It calls mbind() directly, so that KiVM does not depend on libnuma.
+     */
+    static bool applyNumaPolicy(void *memory, size_t size) {
+        auto &config = RuntimeConfig::get();
+        if (config.heapNumaPolicy == HEAP_NUMA_DEFAULT) {
+            return false;
+        }
+
+#if defined(SYS_mbind)
+        // values of MPOL_BIND and MPOL_INTERLEAVE in <linux/mempolicy.h>
+        const int POLICY_BIND = 2;
+        const int POLICY_INTERLEAVE = 3;
+        const size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+
+        std::vector<int> nodes = getOnlineNumaNodes();
+        if (config.heapNumaPolicy == HEAP_NUMA_BIND) {
+            if (std::find(nodes.begin(), nodes.end(), config.heapNumaNode) == nodes.end()) {
+                WARN("Universe: NUMA node %d is not online, heap is not bound", config.heapNumaNode);
+                return false;
+            }
+            nodes = {config.heapNumaNode};
+        }
+
+        std::vector<unsigned long> mask((size_t) *std::max_element(nodes.begin(), nodes.end()) / BITS_PER_WORD + 1);
+        for (int node : nodes) {
+            mask[node / BITS_PER_WORD] |= 1UL << (node % BITS_PER_WORD);
+        }
+
+        int mode = config.heapNumaPolicy == HEAP_NUMA_BIND ? POLICY_BIND : POLICY_INTERLEAVE;
+        if (syscall(SYS_mbind, memory, size, mode, mask.data(), mask.size() * BITS_PER_WORD + 1, 0) != 0) {
+            WARN("Universe: mbind() failed: %s", strerror(errno));
+            return false;
+        }
+        return true;
+#else
+        WARN("Universe: NUMA policies are not supported on this platform");
+        return false;
+#endif
+    }
+
+#if defined(MAP_HUGETLB)
+    /**
+     * Map uncommitted large pages in {@code [start, end)} from the hugetlb pool.
+     * Pages are taken from the pool when they are mapped, so running out
+     * of them fails here, instead of raising SIGBUS when they are touched.
+     * Pages mapped before a failure stay committed for the next commit.
+     */
+    static bool commitHugeTLBPages(HeapReservation *heap, jbyte *start, jbyte *end) {
+        size_t page = (start - heap->start) / heap->pageSize;
+        size_t lastPage = (end - heap->start) / heap->pageSize;
+
+        while (page < lastPage) {
+            if (heap->committed[page]) {
+                ++page;
+                continue;
+            }
+
+            // map a run of uncommitted pages at once, committed pages
+            // may hold objects and must not be mapped again
+            size_t runEnd = page;
+            while (runEnd < lastPage && !heap->committed[runEnd]) {
+                ++runEnd;
+            }
+
+            jbyte *runStart = heap->start + page * heap->pageSize;
+            size_t runSize = (runEnd - page) * heap->pageSize;
+            if (mmap(runStart, runSize, PROT_READ | PROT_WRITE,
+                MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED | MAP_HUGETLB, -1, 0) == MAP_FAILED) {
+                return false;
+            }
+
+            // the new mapping dropped the policy of the reserved one
+            if (heap->numaPolicyApplied) {
+                applyNumaPolicy(runStart, runSize);
+            }
+
+            std::fill(heap->committed.begin() + page, heap->committed.begin() + runEnd, true);
+            page = runEnd;
+        }
+        return true;
+    }
+
+    static void uncommitHugeTLBPages(HeapReservation *heap, jbyte *start, jbyte *end) {
+        // mapping them again without backing gives them back to the pool
+        mmap(start, end - start, PROT_NONE,
+            MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED | MAP_HUGETLB | MAP_NORESERVE, -1, 0);
+
+        size_t firstPage = (start - heap->start) / heap->pageSize;
+        size_t lastPage = (end - heap->start) / heap->pageSize;
+        std::fill(heap->committed.begin() + firstPage, heap->committed.begin() + lastPage, false);
+    }
+#endif
+#endif
+
     void Universe::initialize() {
-        Universe::sCollectedHeapInstance = new CopyingHeap;
+        switch (RuntimeConfig::get().heapType) {
+            case HEAP_COPYING:
+                Universe::sCollectedHeapInstance = new CopyingHeap;
+                break;
+            case HEAP_MARK_COMPACT:
+                Universe::sCollectedHeapInstance = new MarkCompactHeap;
+                break;
+            case HEAP_CONCURRENT_MARK_SWEEP:
+                Universe::sCollectedHeapInstance = new ConcurrentMarkSweepHeap;
+                break;
+            default:
+                SHOULD_NOT_REACH_HERE();
+        }
         Universe::sCollectedHeapInstance->initializeAll();
+        Universe::sCardTable = Universe::sCollectedHeapInstance->getCardTable();
+        Universe::sSatbMarkQueueSet = Universe::sCollectedHeapInstance->getSatbMarkQueueSet();
+
+        if (RuntimeConfig::get().gcLogEnabled) {
+            sGCLogger = GCLogger::open(RuntimeConfig::get().gcLogPath);
+            if (sGCLogger != nullptr) {
+                Universe::addGCListener(sGCLogger);
+            }
+        }
     }
 
     void Universe::destroy() {
+        if (sGCLogger != nullptr) {
+            Universe::removeGCListener(sGCLogger);
+            delete sGCLogger;
+            sGCLogger = nullptr;
+        }
+
         if (Universe::sCollectedHeapInstance != nullptr) {
+            Universe::sCardTable = nullptr;
+            Universe::sSatbMarkQueueSet = nullptr;
             delete Universe::sCollectedHeapInstance;
             Universe::sCollectedHeapInstance = nullptr;
         }
     }
 
+    void Universe::addGCListener(GCListener *listener) {
+        LockGuard lockGuard(gcListenerLock());
+        getGCListeners().push_back(listener);
+        AllocationSampler::setEnabled(true);
+    }
+
+    void Universe::removeGCListener(GCListener *listener) {
+        LockGuard lockGuard(gcListenerLock());
+        auto &listeners = getGCListeners();
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+        AllocationSampler::setEnabled(!listeners.empty());
+    }
+
+    void Universe::notifyGCListeners(const GCEvent &event) {
+        LockGuard lockGuard(gcListenerLock());
+        for (auto listener : getGCListeners()) {
+            listener->onGCEvent(event);
+        }
+    }
+
     void *Universe::allocVirtual(size_t size) {
         D("allocVirtual: %zd", size);
 
@@ -60,6 +314,206 @@ namespace kivm {
         munmap(m, memoryInfo->memorySize);
     }
 
+    void *Universe::reserveVirtual(size_t size) {
+        D("reserveVirtual: %zd", size);
+
+        void *memory = nullptr;
+        void *FAILURE;
+
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        FAILURE = nullptr;
+        memory = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+        FAILURE = MAP_FAILED;
+        memory = mmap(nullptr, size, PROT_NONE,
+            MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+#endif
+
+        if (memory == FAILURE) {
+            WARN("Universe::reserveVirtual(): failed: %s", strerror(errno));
+            return nullptr;
+        }
+        return memory;
+    }
+
+    void Universe::releaseVirtual(void *memory, size_t size) {
+        {
+            LockGuard guard(heapReservationLock());
+            auto &reservations = getHeapReservations();
+            auto heap = std::find_if(reservations.begin(), reservations.end(),
+                [memory](const HeapReservation &reservation) {
+                    return reservation.start == memory;
+                });
+            if (heap != reservations.end()) {
+                // hugetlb heaps were reserved in whole large pages
+                size = heap->size;
+                reservations.erase(heap);
+            }
+        }
+
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        VirtualFree(memory, 0, MEM_RELEASE);
+#else
+        munmap(memory, size);
+#endif
+    }
+
+    void *Universe::reserveHeapVirtual(size_t size) {
+        auto &config = RuntimeConfig::get();
+
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        if (config.heapPageType != HEAP_PAGES_DEFAULT || config.heapNumaPolicy != HEAP_NUMA_DEFAULT) {
+            WARN("Universe: huge pages and NUMA policies are not supported on this platform");
+        }
+        return reserveVirtual(size);
+#else
+        size = alignUp(size, getPageSize());
+        size_t largePageSize = getLargePageSize();
+        bool hugeTLB = config.heapPageType == HEAP_PAGES_HUGETLB;
+        jbyte *memory = nullptr;
+
+        if (hugeTLB) {
+#if defined(MAP_HUGETLB)
+            if (readMemInfo("HugePages_Total:", 0) == 0) {
+                WARN("Universe: no hugetlb pages are configured, using default pages");
+                hugeTLB = false;
+            } else {
+                size = alignUp(size, largePageSize);
+                auto m = mmap(nullptr, size, PROT_NONE,
+                    MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE | MAP_HUGETLB, -1, 0);
+                if (m == MAP_FAILED) {
+                    WARN("Universe: cannot reserve hugetlb pages: %s, using default pages", strerror(errno));
+                    hugeTLB = false;
+                } else {
+                    memory = (jbyte *) m;
+                }
+            }
+#else
+            WARN("Universe: hugetlb pages are not supported on this platform");
+            hugeTLB = false;
+#endif
+        }
+
+        if (memory == nullptr) {
+            // start at a large page boundary, so that
+            // transparent huge pages can back the heap from its first byte
+            auto reserved = (jbyte *) reserveVirtual(size + largePageSize);
+            if (reserved == nullptr) {
+                return nullptr;
+            }
+            memory = (jbyte *) alignUp((size_t) reserved, largePageSize);
+            if (memory > reserved) {
+                munmap(reserved, memory - reserved);
+            }
+            munmap(memory + size, reserved + largePageSize - memory);
+        }
+
+        if (config.heapPageType == HEAP_PAGES_TRANSPARENT) {
+#if defined(MADV_HUGEPAGE)
+            if (madvise(memory, size, MADV_HUGEPAGE) != 0) {
+                WARN("Universe: madvise(MADV_HUGEPAGE) failed: %s", strerror(errno));
+            }
+#else
+            WARN("Universe: transparent huge pages are not supported on this platform");
+#endif
+        }
+
+        HeapReservation reservation;
+        reservation.start = memory;
+        reservation.size = size;
+        reservation.pageSize = hugeTLB ? largePageSize : getPageSize();
+        reservation.hugeTLB = hugeTLB;
+        reservation.numaPolicyApplied = applyNumaPolicy(memory, size);
+        if (hugeTLB) {
+            reservation.committed.resize(size / largePageSize, false);
+        }
+
+        LockGuard guard(heapReservationLock());
+        getHeapReservations().push_back(std::move(reservation));
+        D("reserveHeapVirtual: %zd at %p, page size %zd", size, memory, getHeapReservations().back().pageSize);
+        return memory;
+#endif
+    }
+
+    bool Universe::commitVirtual(void *memory, size_t size) {
+        LockGuard guard(heapReservationLock());
+        HeapReservation *heap = findHeapReservation(memory);
+
+        size_t pageSize = heap != nullptr ? heap->pageSize : getPageSize();
+        auto start = (jbyte *) alignDown((size_t) memory, pageSize);
+        auto end = (jbyte *) alignUp((size_t) memory + size, pageSize);
+        if (start >= end) {
+            return true;
+        }
+
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        bool success = VirtualAlloc(start, end - start, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#elif defined(MAP_HUGETLB)
+        bool success = heap != nullptr && heap->hugeTLB
+                       ? commitHugeTLBPages(heap, start, end)
+                       : mprotect(start, end - start, PROT_READ | PROT_WRITE) == 0;
+#else
+        bool success = mprotect(start, end - start, PROT_READ | PROT_WRITE) == 0;
+#endif
+
+        if (!success) {
+            WARN("Universe::commitVirtual(): failed: %s", strerror(errno));
+            return false;
+        }
+
+        if (heap != nullptr && RuntimeConfig::get().heapPreTouch) {
+            preTouch(start, end, pageSize);
+        }
+        return true;
+    }
+
+    void Universe::uncommitVirtual(void *memory, size_t size) {
+        LockGuard guard(heapReservationLock());
+        HeapReservation *heap = findHeapReservation(memory);
+
+        size_t pageSize = heap != nullptr ? heap->pageSize : getPageSize();
+        auto start = (jbyte *) alignUp((size_t) memory, pageSize);
+        auto end = (jbyte *) alignDown((size_t) memory + size, pageSize);
+        if (start >= end) {
+            return;
+        }
+
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        VirtualFree(start, end - start, MEM_DECOMMIT);
+#else
+#if defined(MAP_HUGETLB)
+        if (heap != nullptr && heap->hugeTLB) {
+            uncommitHugeTLBPages(heap, start, end);
+            return;
+        }
+#endif
+        // MADV_DONTNEED drops private anonymous pages immediately,
+        // they read back as zero if committed again.
+        madvise(start, end - start, MADV_DONTNEED);
+        mprotect(start, end - start, PROT_NONE);
+#endif
+    }
+
+    size_t Universe::getPageSize() {
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        static size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+        return pageSize;
+#endif
+    }
+
+    size_t Universe::getLargePageSize() {
+#if  defined(KIVM_PLATFORM_WINDOWS)
+        return SIZE_MB(2);
+#else
+        static size_t largePageSize = readMemInfo("Hugepagesize:", SIZE_MB(2) / SIZE_KB(1)) * SIZE_KB(1);
+        return largePageSize;
+#endif
+    }
+
     void *Universe::allocHeap(size_t size) {
         if (sCollectedHeapInstance == nullptr) {
             WARN("heap not initialized");
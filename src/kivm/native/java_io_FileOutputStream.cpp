@@ -31,7 +31,7 @@ JAVA_NATIVE void Java_java_io_FileOutputStream_writeBytes(JNIEnv *env, jobject j
         SHOULD_NOT_REACH_HERE();
     }
 
-    if (byteArray->getLength() <= off && byteArray->getLength() < (off + len)) {
+    if (off < 0 || len < 0 || off > byteArray->getLength() - len) {
         auto thread = Threads::currentThread();
         assert(thread != nullptr);
         thread->throwException(Global::_ArrayIndexOutOfBoundsException,
@@ -43,26 +43,18 @@ JAVA_NATIVE void Java_java_io_FileOutputStream_writeBytes(JNIEnv *env, jobject j
     }
 
     auto streamOop = Resolver::instance(javaOutputStream);
-    instanceOop fdOop = nullptr;
-    if (!streamOop->getFieldValue(FD_FIELD, (oop *) &fdOop)) {
+    auto fdOop = Resolver::instance(*streamOop->getFieldAddress<oop>(FD_FIELD->_offset));
+    if (fdOop == nullptr) {
         SHOULD_NOT_REACH_HERE();
     }
 
-    intOop fdInt = nullptr;
-    if (!fdOop->getFieldValue(FD_INT_FIELD, (oop *) &fdInt)) {
-        SHOULD_NOT_REACH_HERE();
-    }
+    int fd = *fdOop->getFieldAddress<jint>(FD_INT_FIELD->_offset);
 
-    int fd = fdInt->getValue();
-    auto *buf = (char *) Universe::allocCObject(sizeof(char) * len);
-    for (int i = off, j = 0; i < off + len; i++, j++) {
-        buf[j] = (char) ((intOop) byteArray->getElementAt(i))->getValue();
-    }
-    if (write(fd, buf, (size_t) len) == -1) {
+    // elements are stored unboxed, so write them without copying
+    if (write(fd, byteArray->getElementAddress<jbyte>(off), (size_t) len) == -1) {
         auto thread = Threads::currentThread();
         assert(thread != nullptr);
         thread->throwException(Global::_IOException, L"write() failed");
         return;
     }
-    Universe::deallocCObject(buf);
 }
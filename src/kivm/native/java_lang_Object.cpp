@@ -21,9 +21,10 @@ JAVA_NATIVE jint Java_java_lang_Object_hashCode(JNIEnv *env, jobject javaObject)
         return hash;
     }
 
-    auto value = intptr_t(javaObject);
-    obj->getMarkOop()->setHash((jint) value);
-    return (jint) value;
+    // only 31 bits are kept in the header, and 0 means no hash yet
+    auto value = (jint) ((intptr_t(javaObject) >> 3) & markOopDesc::HASH_MASK);
+    obj->getMarkOop()->setHash(value == 0 ? 1 : value);
+    return obj->getMarkOop()->getHash();
 }
 
 JAVA_NATIVE jobject Java_java_lang_Object_clone(JNIEnv *env, jobject javaObject) {
@@ -65,9 +66,5 @@ JAVA_NATIVE void Java_java_lang_Object_notify(JNIEnv *env, jobject javaObject) {
 
 JAVA_NATIVE void Java_java_lang_Object_wait(JNIEnv *env, jobject javaObject, jlong timeout) {
     auto object = Resolver::javaOop(javaObject);
-    if (timeout == 0) {
-        object->getMarkOop()->wait();
-    } else {
-        object->getMarkOop()->wait(timeout);
-    }
+    Threads::currentThread()->monitorWait(object, timeout);
 }
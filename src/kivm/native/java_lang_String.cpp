@@ -31,33 +31,31 @@ namespace kivm {
 
                 // No cache, create new.
                 instanceOop javaString = String::from(string);
-                _pool.insert(std::make_pair(hash, javaString));
+                if (javaString != nullptr) {
+                    _pool.insert(std::make_pair(hash, javaString));
+                }
                 return javaString;
             }
 
             int StringHash::operator()(instanceOop string) const noexcept {
                 // if has a hash_val cache, need no calculate.
-                oop hashOop = nullptr;
-
                 auto klass = (InstanceKlass *) string->getClass();
                 FieldID *hashFieldId = klass->getInstanceFieldInfo(J_STRING, L"hash", L"I");
-                if (string->getFieldValue(hashFieldId, &hashOop)) {
-                    int cachedHash = ((intOop) hashOop)->getValue();
-                    if (cachedHash != 0) {
-                        return cachedHash;
-                    }
+                jint *cachedHash = string->getFieldAddress<jint>(hashFieldId->_offset);
+                if (*cachedHash != 0) {
+                    return *cachedHash;
                 }
 
                 // get string's content which is typed `TypeArrayOop` and calculate hash value.
                 typeArrayOop valueOop = nullptr;
                 if (string->getFieldValue(J_STRING, L"value", L"[C", (oop *) &valueOop)) {
                     int length = valueOop->getLength();
+                    jchar *chars = valueOop->getElementAddress<jchar>(0);
                     int hash = 0;
                     for (int i = 0; i < length; i++) {
-                        auto charElement = (intOop) valueOop->getElementAt(i);
-                        hash = 31 * hash + charElement->getValue();
+                        hash = 31 * hash + chars[i];
                     }
-                    string->setFieldValue(hashFieldId, new intOopDesc(hash));
+                    *cachedHash = hash;
                     return hash;
                 }
 
@@ -95,26 +93,28 @@ namespace kivm {
                     return false;
                 }
 
-                for (int i = 0; i < lhsLength; ++i) {
-                    auto lhsChar = (intOop) lhsValue->getElementAt(i);
-                    auto rhsChar = (intOop) rhsValue->getElementAt(i);
-                    if (lhsChar->getValue() != rhsChar->getValue()) {
-                        return false;
-                    }
-                }
-                return true;
+                return memcmp(lhsValue->getElements(), rhsValue->getElements(),
+                    lhsLength * sizeof(jchar)) == 0;
             }
 
             instanceOop String::from(const kivm::String &string) {
                 auto *charArrayKlass = (TypeArrayKlass *) BootstrapClassLoader::get()->loadClass(L"[C");
                 auto *stringKlass = (InstanceKlass *) BootstrapClassLoader::get()->loadClass(J_STRING);
 
+                // nullptr only inside a RecoverableAllocation
                 typeArrayOop chars = charArrayKlass->newInstance((int) string.size());
+                if (chars == nullptr) {
+                    return nullptr;
+                }
+                jchar *elements = chars->getElementAddress<jchar>(0);
                 for (int i = 0; i < string.size(); ++i) {
-                    chars->setElementAt(i, new intOopDesc((unsigned short) string[i]));
+                    elements[i] = (jchar) string[i];
                 }
 
                 instanceOop javaString = stringKlass->newInstance();
+                if (javaString == nullptr) {
+                    return nullptr;
+                }
                 javaString->setFieldValue(J_STRING, L"value", L"[C", chars);
                 return javaString;
             }
@@ -124,9 +124,9 @@ namespace kivm {
                 std::wstringstream builder;
                 if (stringOop->getFieldValue(J_STRING, L"value", L"[C", (oop *) &valueOop)) {
                     int length = valueOop->getLength();
+                    jchar *chars = valueOop->getElementAddress<jchar>(0);
                     for (int i = 0; i < length; i++) {
-                        auto charElement = (intOop) valueOop->getElementAt(i);
-                        builder << (wchar_t) charElement->getValue();
+                        builder << (wchar_t) chars[i];
                     }
                 }
                 return builder.str();
@@ -88,7 +88,9 @@ void Java_java_lang_System_arraycopy(JNIEnv *env, jclass java_lang_System,
         auto destOop_ = (typeArrayOop) destOop;
         auto srcClass_ = (TypeArrayKlass *) srcOop_->getClass();
         auto destClass_ = (TypeArrayKlass *) destOop_->getClass();
-        if (destClass_->getComponentType() != srcClass_->getComponentType()) {
+        // element sizes differ unless both component type and dimension match
+        if (destClass_->getComponentType() != srcClass_->getComponentType()
+            || destClass_->getDimension() != srcClass_->getDimension()) {
             thread->throwException((InstanceKlass *) BootstrapClassLoader::get()
                 ->loadClass(L"java/lang/ArrayStoreException"), false);
             return;
@@ -7,6 +7,7 @@
 #include <kivm/bytecode/execution.h>
 #include <kivm/native/classNames.h>
 #include <kivm/oop/primitiveOop.h>
+#include <kivm/runtime/referenceHandlerThread.h>
 
 #include <pthread.h>
 #include <csignal>
@@ -63,7 +64,11 @@ JAVA_NATIVE void Java_java_lang_Thread_start0(JNIEnv *env, jobject threadObject)
     auto threadOop = Resolver::instance(threadObject);
     auto klass = threadOop->getInstanceClass();
 
+    // The VM hands discovered references to its own handler thread,
+    // it never sets the Reference.pending that run() waits for.
     if (klass->getName() == L"java/lang/ref/Reference$ReferenceHandler") {
+        auto handler = new ReferenceHandlerThread;
+        handler->start(threadOop);
         return;
     }
 
@@ -74,5 +79,5 @@ JAVA_NATIVE void Java_java_lang_Thread_start0(JNIEnv *env, jobject threadObject)
 }
 
 JAVA_NATIVE void Java_java_lang_Thread_sleep(JNIEnv *env, jclass threadCls, jlong ms) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    Threads::currentThread()->sleep(ms);
 }
@@ -4,6 +4,8 @@
 
 #include <kivm/kivm.h>
 #include <kivm/native/classNames.h>
+#include <kivm/native/sun_misc_Signal.h>
+#include <kivm/memory/gcThread.h>
 #include <sparsepp/spp.h>
 #include <kivm/bytecode/execution.h>
 #include <csignal>
@@ -21,6 +23,31 @@ static void CDECL defaultSignalHandler(int signo) {
         D("VM: DefaultSignalHandler: received SIGINT, exiting...");
         exit(0);
     }
+
+#if !defined(KIVM_PLATFORM_WINDOWS)
+    if (signo == SIGUSR1) {
+        // nothing but atomics can be touched in a signal handler
+        GCThread::onHeapDumpSignal();
+    }
+#endif
+}
+
+namespace kivm {
+    namespace sun {
+        namespace misc {
+            void Signal::initialize() {
+#if !defined(KIVM_PLATFORM_WINDOWS)
+                struct sigaction act{};
+                sigfillset(&act.sa_mask);
+                act.sa_flags = SA_RESTART;
+                act.sa_handler = defaultSignalHandler;
+                if (sigaction(SIGUSR1, &act, nullptr) == -1) {
+                    WARN("Signal: cannot install the heap dump handler");
+                }
+#endif
+            }
+        }
+    }
 }
 
 JAVA_NATIVE jint Java_sun_misc_Signal_findSignal(JNIEnv *env, jclass unused, jstring javaSignalName) {
@@ -48,18 +48,21 @@ static std::tuple<int, bool> decodeOffset(jlong encoded) {
     return OffsetEncoder(encoded).decode();
 };
 
-oop *getFieldByOffset(oop owner, int offset, bool isStatic) {
+/**
+ * Get the raw address of a field or an array element.
+ * Fields and array elements are both stored unboxed.
+ */
+jbyte *getFieldByOffset(oop owner, int offset, bool isStatic) {
     switch (owner->getMarkOop()->getOopType()) {
         case oopType::OBJECT_ARRAY_OOP:
         case oopType::TYPE_ARRAY_OOP: {
-            int arrayIndex = offset / sizeof(intptr_t);
             auto array = Resolver::array(owner);
-            return array->getElementUnsafe(arrayIndex);
+            return array->getElements() + offset;
         }
 
         case oopType::INSTANCE_OOP: {
             auto instance = Resolver::instance(owner);
-            oop *result = nullptr;
+            jbyte *result = nullptr;
             if (isStatic) {
                 auto klass = (InstanceKlass *) owner->getClass();
                 if (!klass->getStaticFieldValueUnsafe(offset, &result)) {
@@ -94,7 +97,11 @@ JAVA_NATIVE jint
 Java_sun_misc_Unsafe_arrayIndexScale(JNIEnv *env, jobject javaUnsafe,
                                      jobject mirror) {
     D("sun/misc/Unsafe.arrayIndexScale(Ljava/lang/Class;)I");
-    return sizeof(intptr_t);
+    auto arrayClass = (ArrayKlass *) Resolver::mirror(mirror)->getTarget();
+    if (arrayClass == nullptr) {
+        SHOULD_NOT_REACH_HERE();
+    }
+    return (jint) arrayClass->getElementSize();
 }
 
 JAVA_NATIVE jint
@@ -175,14 +182,14 @@ Java_sun_misc_Unsafe_staticFieldOffset(JNIEnv *env, jobject javaUnsafe, jobject
 JAVA_NATIVE jint
 Java_sun_misc_Unsafe_getIntVolatile(JNIEnv *env, jobject javaUnsafe, jobject javaOwner, jlong encodedOffset) {
     DECODE_OFFSET_AND_OWNER(javaOwner, encodedOffset);
-    oop *addr = getFieldByOffset(owner, offset, isStatic);
-    return (*((volatile intOop *) addr))->getValueVolatile();
+    auto addr = (jint *) getFieldByOffset(owner, offset, isStatic);
+    return *((volatile jint *) addr);
 }
 
 JAVA_NATIVE jobject
 Java_sun_misc_Unsafe_getObjectVolatile(JNIEnv *env, jobject javaUnsafe, jobject javaOwner, jlong encodedOffset) {
     DECODE_OFFSET_AND_OWNER(javaOwner, encodedOffset);
-    oop *addr = getFieldByOffset(owner, offset, isStatic);
+    auto addr = (oop *) getFieldByOffset(owner, offset, isStatic);
     return *((volatile oop *) addr);
 }
 
@@ -190,8 +197,10 @@ JAVA_NATIVE void
 Java_sun_misc_Unsafe_putObjectVolatile(JNIEnv *env, jobject javaUnsafe, jobject javaOwner, jlong encodedOffset,
                                        jobject obj) {
     DECODE_OFFSET_AND_OWNER(javaOwner, encodedOffset);
-    oop *addr = getFieldByOffset(owner, offset, isStatic);
+    auto addr = (oop *) getFieldByOffset(owner, offset, isStatic);
+    Universe::preWriteBarrier(addr);
     *((volatile oop *) addr) = Resolver::javaOop(obj);
+    Universe::writeBarrier(addr);
 }
 
 JAVA_NATIVE jboolean
@@ -199,8 +208,7 @@ Java_sun_misc_Unsafe_compareAndSwapInt(JNIEnv *env, jobject javaUnsafe,
                                        jobject javaOwner, jlong encodedOffset,
                                        jint expected, jint update) {
     DECODE_OFFSET_AND_OWNER(javaOwner, encodedOffset);
-    oop *addr = getFieldByOffset(owner, offset, isStatic);
-    volatile jint *ptr = (*((intOop *) addr))->getValueUnsafe();
+    auto ptr = (volatile jint *) getFieldByOffset(owner, offset, isStatic);
     return JBOOLEAN(cmpxchg(ptr, expected, update) == expected);
 }
 
@@ -209,8 +217,7 @@ Java_sun_misc_Unsafe_compareAndSwapLong(JNIEnv *env, jobject javaUnsafe,
                                         jobject javaOwner, jlong encodedOffset,
                                         jlong expected, jlong update) {
     DECODE_OFFSET_AND_OWNER(javaOwner, encodedOffset);
-    oop *addr = getFieldByOffset(owner, offset, isStatic);
-    volatile jlong *ptr = (*((longOop *) addr))->getValueUnsafe();
+    auto ptr = (volatile jlong *) getFieldByOffset(owner, offset, isStatic);
     return JBOOLEAN(cmpxchg(ptr, expected, update) == expected);
 }
 
@@ -220,7 +227,13 @@ Java_sun_misc_Unsafe_compareAndSwapObject(JNIEnv *env, jobject javaUnsafe,
                                           jobject expected, jobject update) {
     DECODE_OFFSET_AND_OWNER(javaOwner, encodedOffset);
     auto ptr = (volatile uintptr_t *) getFieldByOffset(owner, offset, isStatic);
-    return JBOOLEAN(cmpxchg(ptr, (uintptr_t) expected, (uintptr_t) update) == (uintptr_t) expected);
+    // logs the current value even if the swap fails, which is harmless
+    Universe::preWriteBarrier((void *) ptr);
+    bool swapped = cmpxchg(ptr, (uintptr_t) expected, (uintptr_t) update) == (uintptr_t) expected;
+    if (swapped) {
+        Universe::writeBarrier((void *) ptr);
+    }
+    return JBOOLEAN(swapped);
 }
 
 JAVA_NATIVE jlong Java_sun_misc_Unsafe_allocateMemory(JNIEnv *env, jobject javaUnsafe, jlong size) {
@@ -6,6 +6,7 @@
 #include <kivm/oop/arrayOop.h>
 #include <kivm/native/java_lang_Class.h>
 #include <sstream>
+#include <cstring>
 
 namespace kivm {
 
@@ -40,6 +41,10 @@ namespace kivm {
         }
         ss << valueTypeToPrimitiveType(componentType);
         this->setName(ss.str());
+
+        if (dimension == 1) {
+            this->_elementSize = valueTypeSizeOf(componentType);
+        }
     }
 
     TypeArrayKlass::TypeArrayKlass(ClassLoader *classLoader, TypeArrayKlass *downType)
@@ -51,7 +56,8 @@ namespace kivm {
     }
 
     typeArrayOop TypeArrayKlass::newInstance(int length) {
-        return new typeArrayOopDesc(this, length);
+        return new(arrayOopDesc::getPayloadSize(getElementSize(), length))
+            typeArrayOopDesc(this, length);
     }
 
     void TypeArrayKlass::linkClass() {
@@ -64,11 +70,11 @@ namespace kivm {
     }
 
     void TypeArrayKlass::copyArrayTo(arrayOop src, arrayOop dest, int srcPos, int destPos, int length) {
-        auto srcOop = (typeArrayOop) src;
-        auto destOop = (typeArrayOop) dest;
-        std::copy(srcOop->_elements.begin() + srcPos,
-            srcOop->_elements.begin() + srcPos + length,
-            destOop->_elements.begin() + destPos);
+        // src and dest may be the same array with overlapping ranges
+        size_t elementSize = getElementSize();
+        memmove(dest->getElements() + destPos * elementSize,
+            src->getElements() + srcPos * elementSize,
+            length * elementSize);
     }
 
     ObjectArrayKlass::ObjectArrayKlass(ClassLoader *classLoader, mirrorOop javaLoader,
@@ -93,7 +99,8 @@ namespace kivm {
     }
 
     objectArrayOop ObjectArrayKlass::newInstance(int length) {
-        return new objectArrayOopDesc(this, length);
+        return new(arrayOopDesc::getPayloadSize(getElementSize(), length))
+            objectArrayOopDesc(this, length);
     }
 
     void ObjectArrayKlass::linkClass() {
@@ -102,10 +109,11 @@ namespace kivm {
     }
 
     void ObjectArrayKlass::copyArrayTo(arrayOop src, arrayOop dest, int srcPos, int destPos, int length) {
-        auto srcOop = (objectArrayOop) src;
-        auto destOop = (objectArrayOop) dest;
-        std::copy(srcOop->_elements.begin() + srcPos,
-            srcOop->_elements.begin() + srcPos + length,
-            destOop->_elements.begin() + destPos);
+        Universe::preWriteBarrier(dest->getElementAddress<oop>(destPos), (size_t) length);
+        // src and dest may be the same array with overlapping ranges
+        memmove(dest->getElementAddress<oop>(destPos),
+            src->getElementAddress<oop>(srcPos),
+            length * sizeof(oop));
+        Universe::writeBarrier(dest->getElementAddress<oop>(destPos), length * sizeof(oop));
     }
 }
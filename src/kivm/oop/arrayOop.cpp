@@ -3,45 +3,31 @@
 //
 
 #include <kivm/oop/arrayOop.h>
-#include <kivm/oop/primitiveOop.h>
+#include <cstring>
 
 namespace kivm {
     arrayOopDesc::arrayOopDesc(ArrayKlass *arrayClass, oopType type, int length)
-        : oopDesc(arrayClass, type) {
-        _elements.resize(static_cast<unsigned>(length));
+        : oopDesc(arrayClass, type), _length(length) {
+        // Elements need no initialization here:
+        // the heap hands out zeroed memory, and zero is the
+        // default value of every element type (0, 0.0, false, null).
+        static_assert(HEADER_SIZE >= sizeof(arrayOopDesc), "array header overlaps elements");
+    }
+
+    arrayOop arrayOopDesc::copy() {
+        auto arrayClass = (ArrayKlass *) getClass();
+        size_t payloadSize = getPayloadSize(getElementSize(), getLength());
+        auto copied = new(payloadSize) arrayOopDesc(arrayClass,
+            getMarkOop()->getOopType(), getLength());
+        memcpy(copied->getElements(), getElements(), payloadSize);
+        if (arrayClass->hasOopElements()) {
+            Universe::writeBarrier(copied->getElements(), payloadSize);
+        }
+        return copied;
     }
 
     typeArrayOopDesc::typeArrayOopDesc(TypeArrayKlass *arrayClass, int length)
         : arrayOopDesc(arrayClass, oopType::TYPE_ARRAY_OOP, length) {
-        switch (arrayClass->getComponentType()) {
-            case ValueType::INT:
-            case ValueType::CHAR:
-            case ValueType::BYTE:
-            case ValueType::SHORT:
-            case ValueType::BOOLEAN:
-                for (int i = 0; i < getLength(); ++i) {
-                    this->_elements[i] = new intOopDesc(0);
-                }
-                break;
-            case ValueType::FLOAT:
-                for (int i = 0; i < getLength(); ++i) {
-                    this->_elements[i] = new floatOopDesc(0.0f);
-                }
-                break;
-            case ValueType::LONG:
-                for (int i = 0; i < getLength(); ++i) {
-                    this->_elements[i] = new longOopDesc(0L);
-                }
-                break;
-            case ValueType::DOUBLE:
-                for (int i = 0; i < getLength(); ++i) {
-                    this->_elements[i] = new doubleOopDesc(0.0);
-                }
-                break;
-
-            default:
-                SHOULD_NOT_REACH_HERE();
-        }
     }
 
     objectArrayOopDesc::objectArrayOopDesc(ObjectArrayKlass *arrayClass, int length)
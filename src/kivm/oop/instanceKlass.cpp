@@ -5,10 +5,13 @@
 #include <kivm/oop/instanceKlass.h>
 #include <kivm/oop/primitiveOop.h>
 #include <kivm/oop/instanceOop.h>
+#include <kivm/oop/mirrorOop.h>
 #include <kivm/oop/helper.h>
 #include <kivm/oop/method.h>
 #include <kivm/oop/field.h>
 #include <kivm/native/java_lang_Class.h>
+#include <kivm/memory/universe.h>
+#include <kivm/memory/referenceProcessor.h>
 #include <sstream>
 
 namespace kivm {
@@ -77,6 +80,7 @@ namespace kivm {
 
         linkSuperClass(pool);
         linkFields(pool);
+        linkReferenceType();
 
         linkInterfaces(pool);
         linkMethods(pool);
@@ -125,6 +129,7 @@ namespace kivm {
         if (getSuperClass() != nullptr) {
             auto *sc = getSuperClass();
             this->_vtable = sc->_vtable;
+            this->_vtableMethods = sc->_vtableMethods;
         }
 
         for (int i = 0; i < _classFile->methods_count; ++i) {
@@ -143,63 +148,119 @@ namespace kivm {
                     D("%S: New override method %S",
                         (getName()).c_str(),
                         (id).c_str());
+                    method->_vtableIndex = (*ret.first).second->_method->_vtableIndex;
                     (*ret.first).second = methodID;
                 } else {
                     D("%S: New virtual method %S",
                         (getName()).c_str(),
                         (id).c_str());
+                    method->_vtableIndex = (int) _vtableMethods.size();
+                    _vtableMethods.push_back(nullptr);
                 }
+                _vtableMethods[method->_vtableIndex] = method;
             }
         }
     }
 
     void InstanceKlass::linkFields(cp_info **pool) {
-        using std::make_pair;
-
-        // for a easy implementation, I just copy superclass's instance fields layout.
-        int instanceFieldIndex = 0;
-
-        // instance fields in superclass
+        // java/lang/Class instances are mirrors, whose header is larger.
+        this->_instanceHeaderSize = getName() == L"java/lang/Class"
+                                    ? alignUp(sizeof(mirrorOopDesc), sizeof(jlong))
+                                    : alignUp(sizeof(instanceOopDesc), sizeof(jlong));
+
+        // Subclass fields are laid out after superclass fields,
+        // so inherited fields keep their offsets.
+        size_t instanceFieldStart = 0;
         if (this->_superClass != nullptr) {
             auto *super = this->_superClass;
             this->_instanceFields = super->_instanceFields;
-            instanceFieldIndex += (int) this->_instanceFields.size();
+            this->_instanceOopOffsets = super->_instanceOopOffsets;
+            instanceFieldStart = super->_instanceFieldSize;
         }
 
-        D("%S: Extended instance field count: %d",
+        D("%S: Extended instance field count: %zd, size: %zd",
             (getName()).c_str(),
-            instanceFieldIndex);
+            this->_instanceFields.size(),
+            instanceFieldStart);
 
         // link our fields
-        int staticFieldIndex = 0;
+        std::vector<Field *> staticFields;
+        std::vector<Field *> instanceFields;
         for (int i = 0; i < _classFile->fields_count; ++i) {
             auto *field = new Field(this, _classFile->fields + i);
             field->linkField(pool);
             FieldPool::add(field);
 
-            bool isStatic = field->isStatic();
-            D("%S: New %s field (final: %s): #%-d %S",
-                (getName()).c_str(),
-                isStatic ? "static" : "instance",
-                field->isFinal() ? "true" : "false",
-                isStatic ? staticFieldIndex : instanceFieldIndex,
-                (Field::makeIdentity(this, field)).c_str());
-
-            if (isStatic) {
-                _staticFields.insert(make_pair(Field::makeIdentity(this, field),
-                    new FieldID(staticFieldIndex++, field)));
+            if (field->isStatic()) {
+                staticFields.push_back(field);
             } else {
-                _instanceFields.insert(make_pair(Field::makeIdentity(this, field),
-                    new FieldID(instanceFieldIndex++, field)));
+                instanceFields.push_back(field);
             }
         }
 
-        this->_nStaticFields = staticFieldIndex;
-        this->_nInstanceFields = instanceFieldIndex;
+        this->_instanceFieldSize = layoutFields(instanceFields, instanceFieldStart,
+            _instanceFields, _instanceOopOffsets);
+        this->_staticFieldSize = layoutFields(staticFields, 0,
+            _staticFields, _staticOopOffsets);
+
+        this->_nStaticFields = (int) this->_staticFields.size();
+        this->_nInstanceFields = (int) this->_instanceFields.size();
 
         // We need to allocate memory
         // because before initClass(), there might be field access
-        this->_staticFieldValues.resize(this->_staticFields.size(), nullptr);
+        if (this->_staticFieldSize > 0) {
+            this->_staticFieldValues = (jbyte *) Universe::allocCObject(this->_staticFieldSize);
+        }
+    }
+
+    void InstanceKlass::linkReferenceType() {
+        const String &name = getName();
+        if (name == L"java/lang/ref/Reference") {
+            ReferenceProcessor::onReferenceClassLinked(this);
+        } else if (name == L"java/lang/ref/SoftReference") {
+            this->_referenceType = REF_SOFT;
+            ReferenceProcessor::onSoftReferenceClassLinked(this);
+        } else if (name == L"java/lang/ref/WeakReference") {
+            this->_referenceType = REF_WEAK;
+        } else if (name == L"java/lang/ref/FinalReference") {
+            this->_referenceType = REF_FINAL;
+        } else if (name == L"java/lang/ref/PhantomReference") {
+            this->_referenceType = REF_PHANTOM;
+        } else if (this->_superClass != nullptr) {
+            this->_referenceType = this->_superClass->_referenceType;
+        }
+    }
+
+    size_t InstanceKlass::layoutFields(const std::vector<Field *> &fields, size_t start,
+                                       HashMap<String, FieldID *> &fieldIDs,
+                                       std::vector<int> &oopOffsets) {
+        using std::make_pair;
+
+        size_t offset = start;
+        for (size_t size = sizeof(jlong); size > 0; size >>= 1) {
+            offset = alignUp(offset, size);
+            for (auto field : fields) {
+                ValueType valueType = field->getValueType();
+                if (valueTypeSizeOf(valueType) != size) {
+                    continue;
+                }
+
+                D("%S: New %s field (final: %s): +%-zd %S",
+                    (getName()).c_str(),
+                    field->isStatic() ? "static" : "instance",
+                    field->isFinal() ? "true" : "false",
+                    offset,
+                    (Field::makeIdentity(this, field)).c_str());
+
+                if (valueType == ValueType::OBJECT || valueType == ValueType::ARRAY) {
+                    oopOffsets.push_back((int) offset);
+                }
+                fieldIDs.insert(make_pair(Field::makeIdentity(this, field),
+                    new FieldID((int) offset, field)));
+                offset += size;
+            }
+        }
+        return alignUp(offset, sizeof(jlong));
     }
 
     void InstanceKlass::linkConstantPool(cp_info **pool) {
@@ -318,15 +379,15 @@ namespace kivm {
     }
 
     void InstanceKlass::setStaticFieldValue(FieldID *fieldID, oop value) {
-        D("Set field %S::%S(%S) (slot: %d, max: %zd) to %p in %S",
+        D("Set field %S::%S(%S) (offset: %d, max: %zd) to %p in %S",
             (fieldID->_field->getClass()->getName()).c_str(),
             (fieldID->_field->getName()).c_str(),
             (fieldID->_field->getDescriptor()).c_str(),
             fieldID->_offset,
-            this->_staticFieldValues.size(),
+            this->_staticFieldSize,
             value,
             (this->getName()).c_str());
-        this->_staticFieldValues[fieldID->_offset] = value;
+        helperStoreField(this->_staticFieldValues, fieldID->_offset, fieldID->_field, value);
     }
 
     bool InstanceKlass::getStaticFieldValue(const String &className,
@@ -342,7 +403,7 @@ namespace kivm {
             return false;
         }
 
-        *result = this->_staticFieldValues[fieldID->_offset];
+        *result = helperLoadField(this->_staticFieldValues, fieldID->_offset, fieldID->_field);
         return true;
     }
 
@@ -361,7 +422,7 @@ namespace kivm {
             (fieldID->_field->getName()).c_str(),
             (fieldID->_field->getDescriptor()).c_str(),
             value);
-        receiver->_instanceFieldValues[fieldID->_offset] = value;
+        helperStoreField(receiver->getFieldValues(), fieldID->_offset, fieldID->_field, value);
     }
 
     bool InstanceKlass::getInstanceFieldValue(instanceOop receiver, const String &className,
@@ -378,30 +439,30 @@ namespace kivm {
             return false;
         }
 
-        *result = receiver->_instanceFieldValues[fieldID->_offset];
+        *result = helperLoadField(receiver->getFieldValues(), fieldID->_offset, fieldID->_field);
         return true;
     }
 
-    bool InstanceKlass::getInstanceFieldValueUnsafe(instanceOop receiver, int offset, oop **result) {
-        if (offset >= receiver->_instanceFieldValues.size()) {
+    bool InstanceKlass::getInstanceFieldValueUnsafe(instanceOop receiver, int offset, jbyte **result) {
+        if (offset < 0 || offset >= receiver->getInstanceClass()->_instanceFieldSize) {
             return false;
         }
 
-        *result = &(receiver->_instanceFieldValues[offset]);
+        *result = receiver->getFieldValues() + offset;
         return true;
     }
 
-    bool InstanceKlass::getStaticFieldValueUnsafe(int offset, oop **result) {
-        if (offset >= _staticFieldValues.size()) {
+    bool InstanceKlass::getStaticFieldValueUnsafe(int offset, jbyte **result) {
+        if (offset < 0 || offset >= _staticFieldSize) {
             return false;
         }
 
-        *result = &(_staticFieldValues[offset]);
+        *result = _staticFieldValues + offset;
         return true;
     }
 
     instanceOop InstanceKlass::newInstance() {
-        return new instanceOopDesc(this);
+        return new(_instanceFieldSize) instanceOopDesc(this);
     }
 
     bool InstanceKlass::checkInterface(InstanceKlass *interfaceClass) {
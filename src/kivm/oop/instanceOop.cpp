@@ -4,15 +4,26 @@
 
 #include <kivm/oop/reflection.h>
 #include <kivm/oop/instanceOop.h>
-#include <kivm/oop/helper.h>
+#include <kivm/memory/universe.h>
+#include <cstring>
 
 namespace kivm {
 
     instanceOopDesc::instanceOopDesc(InstanceKlass *klass)
         : oopDesc(klass, oopType::INSTANCE_OOP) {
-        this->_instanceFieldValues.resize(klass->_instanceFields.size());
-        for (auto &e : klass->_instanceFields) {
-            helperInitField(this->_instanceFieldValues, e.second->_offset, e.second->_field);
-        }
+        // Field values need no initialization here:
+        // the heap hands out zeroed memory, and zero is the
+        // default value of every field type (0, 0.0, false, null).
+        static_assert(sizeof(instanceOopDesc) % sizeof(jlong) == 0,
+            "getObjectSize() requires an aligned header");
+    }
+
+    instanceOop instanceOopDesc::copy() {
+        auto klass = getInstanceClass();
+        size_t fieldSize = klass->getInstanceFieldSize();
+        auto copied = new(fieldSize) instanceOopDesc(klass);
+        memcpy(copied->getFieldValues(), getFieldValues(), fieldSize);
+        Universe::writeBarrier(copied->getFieldValues(), fieldSize);
+        return copied;
     }
 }
@@ -9,6 +9,10 @@
 #include <kivm/oop/method.h>
 #include <kivm/oop/instanceKlass.h>
 #include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/bytecode/escapeAnalysis.h>
+#include <kivm/bytecode/superinstructions.h>
+#include <kivm/bytecode/decodedCode.h>
 #include <kivm/native/java_lang_Class.h>
 #include <kivm/jni/nativeMethod.h>
 
@@ -365,6 +369,7 @@ namespace kivm {
         }
 
         // link attributes
+        StackMapTable_attribute *stackMapTable = nullptr;
         for (int i = 0; i < attr->attributes_count; ++i) {
             attribute_info *sub_attr = attr->attributes[i];
             switch (AttributeParser::toAttributeTag(sub_attr->attribute_name_index, pool)) {
@@ -376,8 +381,11 @@ namespace kivm {
                     }
                     break;
                 }
+                case ATTRIBUTE_StackMapTable: {
+                    stackMapTable = (StackMapTable_attribute *) sub_attr;
+                    break;
+                }
                 case ATTRIBUTE_RuntimeVisibleTypeAnnotations:
-                case ATTRIBUTE_StackMapTable:
                 case ATTRIBUTE_LocalVariableTable:
                 case ATTRIBUTE_LocalVariableTypeTable:
                 case ATTRIBUTE_RuntimeInvisibleTypeAnnotations:
@@ -388,6 +396,20 @@ namespace kivm {
         }
 
         _codeBlob.init(_codeAttr->code, _codeAttr->code_length);
+        _rewrittenCode.initCopy(_codeAttr->code, _codeAttr->code_length);
+        Superinstructions::fuse(_codeBlob, _rewrittenCode);
+        _oopMap = new OopMap(this, stackMapTable);
+        _escapeAnalysis = new EscapeAnalysis(this);
+    }
+
+    DecodedCode *Method::installDecodedCode(DecodedCode *code) {
+        DecodedCode *expected = nullptr;
+        if (__atomic_compare_exchange_n(&_decodedCode, &expected, code,
+            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return code;
+        }
+        delete code;
+        return expected;
     }
 
     JavaNativeMethod *Method::getNativeMethod() {
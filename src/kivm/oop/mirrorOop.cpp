@@ -3,12 +3,26 @@
 //
 
 #include <kivm/oop/mirrorOop.h>
+#include <kivm/memory/universe.h>
+#include <cstring>
 
 namespace kivm {
 
-    mirrorOopDesc::mirrorOopDesc(Klass *mirror)
-            : instanceOopDesc((InstanceKlass *) BootstrapClassLoader::get()->loadClass(L"java/lang/Class")),
+    mirrorOopDesc::mirrorOopDesc(InstanceKlass *javaLangClass, Klass *mirror)
+            : instanceOopDesc(javaLangClass),
               _mirrorTarget(mirror),
               _mirroringPrimitiveType(ValueType::OBJECT) {
+        static_assert(sizeof(mirrorOopDesc) % sizeof(jlong) == 0,
+            "getObjectSize() requires an aligned header");
+    }
+
+    mirrorOop mirrorOopDesc::copy() {
+        auto klass = getInstanceClass();
+        size_t fieldSize = klass->getInstanceFieldSize();
+        auto copied = new(fieldSize) mirrorOopDesc(klass, _mirrorTarget);
+        copied->_mirroringPrimitiveType = _mirroringPrimitiveType;
+        memcpy(copied->getFieldValues(), getFieldValues(), fieldSize);
+        Universe::writeBarrier(copied->getFieldValues(), fieldSize);
+        return copied;
     }
 }
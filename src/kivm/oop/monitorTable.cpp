@@ -0,0 +1,118 @@
+//
+// Side table of inflated object monitors
+//
+
+#include <kivm/oop/monitorTable.h>
+
+namespace kivm {
+    Lock &MonitorTable::getLock() {
+        static Lock lock;
+        return lock;
+    }
+
+    Monitor ***MonitorTable::getChunks() {
+        static Monitor **chunks[MAX_CHUNKS];
+        return chunks;
+    }
+
+    std::vector<u4> &MonitorTable::getFreeIndexes() {
+        static std::vector<u4> freeIndexes;
+        return freeIndexes;
+    }
+
+    std::vector<bool> &MonitorTable::getLiveIndexes() {
+        static std::vector<bool> liveIndexes;
+        return liveIndexes;
+    }
+
+    std::vector<std::pair<u4, markOop>> &MonitorTable::getYoungOwners() {
+        static std::vector<std::pair<u4, markOop>> youngOwners;
+        return youngOwners;
+    }
+
+    u4 &MonitorTable::getNextIndex() {
+        // index 0 means no monitor
+        static u4 nextIndex = 1;
+        return nextIndex;
+    }
+
+    u4 MonitorTable::allocate() {
+        LockGuard guard(getLock());
+
+        u4 index;
+        auto &freeIndexes = getFreeIndexes();
+        if (!freeIndexes.empty()) {
+            index = freeIndexes.back();
+            freeIndexes.pop_back();
+        } else {
+            index = getNextIndex()++;
+            if ((index >> CHUNK_BITS) >= MAX_CHUNKS) {
+                PANIC("MonitorTable: too many inflated monitors");
+            }
+        }
+
+        auto chunks = getChunks();
+        auto &chunk = chunks[index >> CHUNK_BITS];
+        if (chunk == nullptr) {
+            chunk = new Monitor *[CHUNK_SIZE]();
+        }
+        chunk[index & (CHUNK_SIZE - 1)] = new Monitor;
+        return index;
+    }
+
+    void MonitorTable::release(u4 index) {
+        LockGuard guard(getLock());
+        auto &slot = getChunks()[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+        delete slot;
+        slot = nullptr;
+        getFreeIndexes().push_back(index);
+    }
+
+    void MonitorTable::recordYoungOwner(u4 index, markOop owner) {
+        // called by mutators and parallel GC workers
+        LockGuard guard(getLock());
+        getYoungOwners().emplace_back(index, owner);
+    }
+
+    std::vector<std::pair<u4, markOop>> MonitorTable::takeYoungOwners() {
+        LockGuard guard(getLock());
+        std::vector<std::pair<u4, markOop>> youngOwners;
+        youngOwners.swap(getYoungOwners());
+        return youngOwners;
+    }
+
+    void MonitorTable::markLive(u4 index) {
+        // called by parallel GC workers
+        LockGuard guard(getLock());
+        auto &liveIndexes = getLiveIndexes();
+        if (liveIndexes.size() <= index) {
+            liveIndexes.resize(getNextIndex(), false);
+        }
+        liveIndexes[index] = true;
+    }
+
+    size_t MonitorTable::sweep() {
+        LockGuard guard(getLock());
+
+        size_t deleted = 0;
+        auto chunks = getChunks();
+        auto &liveIndexes = getLiveIndexes();
+        u4 nextIndex = getNextIndex();
+        for (u4 index = 1; index < nextIndex; ++index) {
+            if (index < liveIndexes.size() && liveIndexes[index]) {
+                continue;
+            }
+
+            auto &slot = chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+            if (slot != nullptr) {
+                delete slot;
+                slot = nullptr;
+                getFreeIndexes().push_back(index);
+                ++deleted;
+            }
+        }
+
+        liveIndexes.clear();
+        return deleted;
+    }
+}
@@ -3,18 +3,48 @@
 //
 
 #include <kivm/oop/oop.h>
+#include <kivm/oop/monitorTable.h>
+#include <shared/atomic.h>
 
 namespace kivm {
     markOopDesc::markOopDesc(oopType type)
-        : _type(type), _hash(0) {
+        : _value((u8) type) {
     }
 
-    oopDesc::oopDesc(Klass *klass, oopType type) {
-        this->_klass = klass;
-        this->_mark = new markOopDesc(type);
+    void markOopDesc::setHash(jint hash) {
+        u8 hashBits = ((u8) hash & HASH_MASK) << HASH_SHIFT;
+        u8 value;
+        // the monitor bits may be updated concurrently
+        do {
+            value = _value;
+        } while (cmpxchg(&_value, value, (value & ~(HASH_MASK << HASH_SHIFT)) | hashBits) != value);
     }
 
-    oopDesc::~oopDesc() {
-        delete this->_mark;
+    Monitor *markOopDesc::getMonitor() {
+        u8 value = _value;
+        if ((value & MONITOR_BIT) != 0) {
+            return MonitorTable::get(getMonitorIndex());
+        }
+
+        // Inflate a new monitor and publish it in the header.
+        // If another thread wins the race, use its monitor instead.
+        u4 index = MonitorTable::allocate();
+        assert(index <= MONITOR_MASK);
+        u8 inflated = MONITOR_BIT | ((u8) index << MONITOR_SHIFT);
+        do {
+            value = _value;
+            if ((value & MONITOR_BIT) != 0) {
+                MonitorTable::release(index);
+                return MonitorTable::get(getMonitorIndex());
+            }
+        } while (cmpxchg(&_value, value, value | inflated) != value);
+
+        // most objects are young, the collector drops old ones
+        MonitorTable::recordYoungOwner(index, this);
+        return MonitorTable::get(index);
+    }
+
+    oopDesc::oopDesc(Klass *klass, oopType type)
+        : _mark(type), _klass(klass) {
     }
 }
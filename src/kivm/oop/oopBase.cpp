@@ -18,7 +18,10 @@ namespace kivm {
 #else
         void *ptr = Universe::allocHeap(size);
 #endif
-        memset(ptr, '\0', size);
+        // nullptr means out of memory, and an OutOfMemoryError is pending
+        if (ptr != nullptr) {
+            memset(ptr, '\0', size);
+        }
         return ptr;
     }
 
@@ -32,6 +35,10 @@ namespace kivm {
         return allocate(size);
     }
 
+    void *GCJavaObject::operator new(size_t size, size_t extraSize) noexcept {
+        return allocate(size + extraSize);
+    }
+
     void *GCJavaObject::operator new[](size_t size, bool addToPool) noexcept {
         return allocate(size);
     }
@@ -24,6 +24,7 @@ namespace kivm {
 
     void AbstractThread::start() {
         this->_nativeThread = new std::thread([this] {
+            this->onThreadStarted();
             this->run();
             this->onDestroy();
         });
@@ -34,6 +35,10 @@ namespace kivm {
         // Do nothing.
     }
 
+    void AbstractThread::onThreadStarted() {
+        // Do nothing.
+    }
+
     void AbstractThread::onDestroy() {
         // Do nothing.
     }
@@ -5,6 +5,7 @@
 #include <kivm/runtime/constantPool.h>
 #include <kivm/oop/instanceKlass.h>
 #include <kivm/oop/arrayOop.h>
+#include <cstring>
 
 namespace kivm {
     RuntimeConstantPool::RuntimeConstantPool(InstanceKlass *instanceKlass)
@@ -12,6 +13,43 @@ namespace kivm {
           _rawPool(nullptr), _entryCount(0) {
     }
 
+    void RuntimeConstantPool::decodePrimitiveConstants() {
+        static_assert(sizeof(void *) >= sizeof(jlong), "a pool slot cannot hold a long constant");
+
+        // index 0 is unused, and entries may be null after a long or double
+        for (int index = 1; index < _entryCount; ++index) {
+            cp_info *info = _rawPool[index];
+            if (info == nullptr) {
+                continue;
+            }
+
+            switch (info->tag) {
+                case CONSTANT_Integer: {
+                    jint value = ((CONSTANT_Integer_info *) info)->getConstant();
+                    memcpy(&_pool[index], &value, sizeof(value));
+                    break;
+                }
+                case CONSTANT_Float: {
+                    jfloat value = ((CONSTANT_Float_info *) info)->getConstant();
+                    memcpy(&_pool[index], &value, sizeof(value));
+                    break;
+                }
+                case CONSTANT_Long: {
+                    jlong value = ((CONSTANT_Long_info *) info)->getConstant();
+                    memcpy(&_pool[index], &value, sizeof(value));
+                    break;
+                }
+                case CONSTANT_Double: {
+                    jdouble value = ((CONSTANT_Double_info *) info)->getConstant();
+                    memcpy(&_pool[index], &value, sizeof(value));
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
     namespace pools {
         namespace impl {
             typedef FieldID *(InstanceKlass::*FieldInfoGetterType)(const String &,
@@ -82,18 +82,8 @@ namespace kivm {
         this->_nativeThread->join();
 
         // Then, let's wait for all app threads to finish
-        for (;;) {
-            int threads = Threads::getRunningJavaThreadCountLocked();
-            assert(threads >= 0);
-
-
-            if (threads == 0) {
-                D("no remaining java thread, exiting...");
-                break;
-            }
-
-            sched_yield();
-        }
+        Threads::waitForJavaThreadsDeadLocked();
+        D("no remaining java thread, exiting...");
     }
 
     void Threads::initializeJVM(JavaMainThread *thread) {
@@ -175,6 +165,12 @@ namespace kivm {
         // re-enable sun.security.util.Debug
         sunDebugClass->setClassState(ClassState::FULLY_INITIALIZED);
 
+        // Preallocate the OutOfMemoryError
+        auto oomCtor = Global::_OutOfMemoryError->getThisClassMethod(L"<init>", L"(Ljava/lang/String;)V");
+        Global::OUT_OF_MEMORY_ERROR = Global::_OutOfMemoryError->newInstance();
+        JavaCall::withArgs(thread, oomCtor,
+            {Global::OUT_OF_MEMORY_ERROR, java::lang::String::intern(L"Java heap space")});
+
         Global::jvmBooted = true;
     }
 
@@ -193,6 +189,7 @@ namespace kivm {
         Global::_ClassNotFoundException = use(cl, thread, J_CLASS_NOT_FOUND);
         Global::_InternalError = use(cl, thread, J_INTERNAL_ERROR);
         Global::_IOException = use(cl, thread, J_IOEXCEPTION);
+        Global::_OutOfMemoryError = use(cl, thread, J_OUT_OF_MEMORY_ERROR);
         java::lang::reflect::Constructor::initialize();
         java::lang::reflect::Method::initialize();
 
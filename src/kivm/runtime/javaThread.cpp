@@ -8,6 +8,8 @@
 #include <kivm/oop/primitiveOop.h>
 #include <kivm/bytecode/javaCall.h>
 #include <kivm/memory/gcThread.h>
+#include <chrono>
+#include <thread>
 
 namespace kivm {
     JavaThread::JavaThread(Method *method, const std::list<oop> &args)
@@ -40,6 +42,10 @@ namespace kivm {
         AbstractThread::start();
     }
 
+    void JavaThread::onThreadStarted() {
+        Threads::setCurrentThread(this);
+    }
+
     void JavaThread::start() {
         PANIC("java thread object required");
     }
@@ -65,6 +71,11 @@ namespace kivm {
         // do not remove thread instance in thread list
         // just tell thread list how many active thread are still running
         Threads::notifyJavaThreadDeadLocked(this);
+
+        auto gc = GCThread::get();
+        if (gc != nullptr) {
+            gc->onJavaThreadExited();
+        }
     }
 
     void JavaThread::throwException(InstanceKlass *exceptionClass, bool rethrow) {
@@ -74,7 +85,15 @@ namespace kivm {
         }
 
         auto ctor = exceptionClass->getThisClassMethod(L"<init>", L"()V");
-        auto exceptionOop = exceptionClass->newInstance();
+        instanceOop exceptionOop = nullptr;
+        {
+            RecoverableAllocation recoverable(this);
+            exceptionOop = exceptionClass->newInstance();
+        }
+        if (exceptionOop == nullptr) {
+            // the OutOfMemoryError is thrown instead
+            return;
+        }
         JavaCall::withArgs(this, ctor,
             {exceptionOop},
             true);
@@ -95,9 +114,21 @@ namespace kivm {
         }
 
         auto ctor = exceptionClass->getThisClassMethod(L"<init>", L"(Ljava/lang/String;)V");
-        auto exceptionOop = exceptionClass->newInstance();
+        instanceOop exceptionOop = nullptr;
+        instanceOop messageOop = nullptr;
+        {
+            RecoverableAllocation recoverable(this);
+            exceptionOop = exceptionClass->newInstance();
+            if (exceptionOop != nullptr) {
+                messageOop = java::lang::String::from(message);
+            }
+        }
+        if (messageOop == nullptr) {
+            // the OutOfMemoryError is thrown instead
+            return;
+        }
         JavaCall::withArgs(this, ctor,
-            {exceptionOop, java::lang::String::from(message)},
+            {exceptionOop, messageOop},
             true);
         if (this->isExceptionOccurred()) {
             // exception occurred in exception's ctor
@@ -133,29 +164,50 @@ namespace kivm {
         }
     }
 
-    void JavaThread::enterSafepointIfNeeded() {
-        auto gc = GCThread::get();
-        if (gc != nullptr && gc->getState() == GCState::WAITING_FOR_SAFEPOINT) {
-            enterSafepoint();
+    void JavaThread::blockInSafeRegion(oop object, const std::function<void()> &operation) {
+        auto gc = GCThread::isInitialized() ? GCThread::get() : nullptr;
+        if (gc == nullptr) {
+            operation();
+            return;
         }
+
+        ThreadState originalState = getThreadState();
+        Threads::setThreadStateLocked(this, ThreadState::BLOCKED);
+        _blockedOn = object;
+        gc->enterSafeRegion();
+        operation();
+        gc->leaveSafeRegion();
+        _blockedOn = nullptr;
+        Threads::setThreadStateLocked(this, originalState);
     }
 
-    JavaThread *Threads::currentThread() {
-        JavaThread *found = nullptr;
-        std::thread::id currentThreadID = std::this_thread::get_id();
+    void JavaThread::monitorEnter(oop object) {
+        // the monitor does not move with the object
+        Monitor *monitor = object->getMarkOop()->getMonitor();
+        if (!monitor->tryEnter()) {
+            blockInSafeRegion(object, [monitor] { monitor->enter(); });
+        }
+    }
 
-        Threads::forEach([&](JavaThread *thread) {
-            if (thread->getThreadState() != ThreadState::DIED) {
-                std::thread::id checkThreadID = thread->_nativeThread->get_id();
-                if (checkThreadID == currentThreadID) {
-                    found = thread;
-                    return true;
-                }
+    void JavaThread::monitorExit(oop object) {
+        object->getMarkOop()->monitorExit();
+    }
+
+    void JavaThread::monitorWait(oop object, jlong timeout) {
+        Monitor *monitor = object->getMarkOop()->getMonitor();
+        blockInSafeRegion(object, [monitor, timeout] {
+            if (timeout == 0) {
+                monitor->wait();
+            } else {
+                monitor->wait(timeout);
             }
-            return false;
         });
+    }
 
-        return found;
+    void JavaThread::sleep(jlong millis) {
+        blockInSafeRegion(nullptr, [millis] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+        });
     }
 
     JavaThread *Threads::searchNativeThread(instanceOop threadObject) {
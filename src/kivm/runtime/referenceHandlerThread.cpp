@@ -0,0 +1,88 @@
+//
+// Thread running Cleaners and enqueueing processed references
+//
+
+#include <kivm/runtime/referenceHandlerThread.h>
+#include <kivm/bytecode/javaCall.h>
+#include <kivm/memory/referenceProcessor.h>
+#include <kivm/memory/universe.h>
+#include <kivm/oop/method.h>
+
+namespace kivm {
+    ReferenceHandlerThread::ReferenceHandlerThread()
+        : JavaThread(nullptr, {}) {
+    }
+
+    void ReferenceHandlerThread::start(instanceOop javaThread) {
+        this->_javaThreadObject = javaThread;
+        Threads::addDetachedJavaThread(this);
+        AbstractThread::start();
+    }
+
+    void ReferenceHandlerThread::run() {
+        this->setThreadName(L"Reference Handler");
+
+        while (true) {
+            ReferenceProcessor::waitForPendingReferences();
+
+            auto gc = GCThread::isInitialized() ? GCThread::get() : nullptr;
+            if (gc == nullptr) {
+                Threads::attachJavaThreadLocked();
+            } else if (!gc->attachJavaThread()) {
+                // the VM is exiting
+                break;
+            }
+
+            handlePendingList();
+
+            if (gc == nullptr) {
+                Threads::detachJavaThreadLocked();
+            } else {
+                gc->detachJavaThread();
+            }
+        }
+    }
+
+    void ReferenceHandlerThread::handlePendingList() {
+        // Java code may run a collection, the current reference
+        // and the rest of the list are kept as roots in _args
+        _args.assign({nullptr, ReferenceProcessor::takePendingList()});
+        while (_args.back() != nullptr) {
+            auto reference = (instanceOop) _args.back();
+            oop *discovered = ReferenceProcessor::getDiscoveredAddress(reference);
+            _args.front() = reference;
+            _args.back() = *discovered;
+
+            Universe::preWriteBarrier(discovered);
+            *discovered = nullptr;
+
+            handle(reference);
+        }
+        _args.clear();
+    }
+
+    void ReferenceHandlerThread::handle(instanceOop reference) {
+        auto referenceClass = reference->getInstanceClass();
+        if (referenceClass->getName() == L"sun/misc/Cleaner") {
+            auto clean = referenceClass->getVirtualMethod(L"clean", L"()V");
+            JavaCall::withArgs(this, clean, {reference});
+            return;
+        }
+
+        // ReferenceQueue.NULL ignores references enqueued onto it
+        oop queue = *ReferenceProcessor::getQueueAddress(reference);
+        if (queue == nullptr) {
+            return;
+        }
+        auto queueClass = ((instanceOop) queue)->getInstanceClass();
+        auto enqueue = queueClass->getVirtualMethod(L"enqueue", L"(Ljava/lang/ref/Reference;)Z");
+        JavaCall::withArgs(this, enqueue, {queue, reference});
+    }
+
+    void ReferenceHandlerThread::onDestroy() {
+        AbstractThread::onDestroy();
+
+        // it was never counted as running when it stopped
+        Threads::setThreadStateLocked(this, ThreadState::DIED);
+    }
+}
@@ -2,6 +2,8 @@
 // Created by kiva on 2018/3/25.
 //
 #include <kivm/runtime/runtimeConfig.h>
+#include <algorithm>
+#include <thread>
 
 namespace kivm {
     RuntimeConfig &RuntimeConfig::get() {
@@ -13,5 +15,26 @@ namespace kivm {
         threadMaxStackFrames = 1024;
         initialHeapSizeInBytes = SIZE_MB(512L);
         maxHeapSizeInBytes = SIZE_MB(2048L);
+        tlabSizeInBytes = SIZE_KB(64L);
+        largeObjectThresholdInBytes = SIZE_KB(256L);
+
+        // one GC worker per core, up to 8
+        gcWorkerThreads = (int) std::min(std::max(std::thread::hardware_concurrency(), 1U), 8U);
+        heapType = HEAP_COPYING;
+        heapPageType = HEAP_PAGES_DEFAULT;
+        heapPreTouch = false;
+        heapNumaPolicy = HEAP_NUMA_DEFAULT;
+        heapNumaNode = 0;
+        gcLogEnabled = false;
+        heapDumpOnOutOfMemory = false;
+        heapDumpAtExit = false;
+        doEscapeAnalysis = true;
+        frameArenaSizeInBytes = SIZE_MB(1L);
+        softRefLRUPolicyMSPerMB = 1000;
+
+        // all of them
+        superinstructions = ~0U;
+        useDirectThreading = true;
+        useTemplateInterpreter = true;
     }
 }
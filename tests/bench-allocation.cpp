@@ -3,9 +3,13 @@
 //
 
 #include <kivm/memory/universe.h>
+#include <kivm/runtime/javaThread.h>
 #include <chrono>
+#include <thread>
+#include <vector>
 
 #define TIMES 1000000
+#define MAX_THREADS 8
 
 using namespace kivm;
 
@@ -31,8 +35,73 @@ void benchUniverse() {
     }
 }
 
+void allocateInUniverse(int times) {
+    for (int i = 0; i < times; ++i) {
+        auto m = (int *) Universe::allocHeap(sizeof(int));
+        *m = i;
+    }
+}
+
+// Allocates through its own TLAB
+class AllocationThread : public JavaThread {
+private:
+    int _times;
+
+protected:
+    void run() override {
+        allocateInUniverse(_times);
+    }
+
+public:
+    explicit AllocationThread(int times)
+        : JavaThread(nullptr, {}), _times(times) {
+    }
+
+    void join() {
+        _nativeThread->join();
+    }
+};
+
+// TIMES allocations in total, shared by all threads
+void benchThreads(const char *tag, int threadCount, bool useTlab) {
+    int times = TIMES / threadCount;
+    auto start = std::chrono::system_clock::now();
+
+    if (useTlab) {
+        std::vector<AllocationThread *> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            auto thread = new AllocationThread(times);
+            thread->start(nullptr);
+            threads.push_back(thread);
+        }
+        for (auto thread : threads) {
+            thread->join();
+        }
+    } else {
+        // not JavaThreads, so every allocation bumps eden atomically
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back(allocateInUniverse, times);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    auto end = std::chrono::system_clock::now();
+    auto cost = end - start;
+    printf("benchmark %s (%d threads): %lld\n", tag, threadCount, cost.count());
+}
+
 int main() {
     Universe::initialize();
     bench("malloc", benchMalloc);
     bench("universe", benchUniverse);
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        benchThreads("universe-shared", threads, false);
+    }
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        benchThreads("universe-tlab", threads, true);
+    }
 }
@@ -0,0 +1,305 @@
+//
+// Benchmark for KiVM interpreters
+//
+
+#include <compileTimeConfig.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/interpreter.h>
+#include <kivm/bytecode/javaCall.h>
+#include <kivm/classfile/classFile.h>
+#include <kivm/classpath/classLoader.h>
+#include <kivm/classpath/classPathManager.h>
+#include <kivm/memory/universe.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/method.h>
+#include <kivm/oop/primitiveOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#define TIMES 1000000
+
+using namespace kivm;
+
+class BenchThread : public JavaThread {
+public:
+    BenchThread()
+        : JavaThread(nullptr, {}) {
+    }
+};
+
+struct BenchMethod {
+    std::string name;
+    std::string descriptor;
+    int maxStack;
+    int maxLocals;
+    std::vector<u1> code;
+};
+
+// Just enough of a class file for public static methods, there is no javac here
+class BenchClass {
+private:
+    std::string _name;
+    std::vector<u1> _pool;
+    int _poolCount = 1;
+    std::map<std::string, int> _utf8;
+    std::vector<BenchMethod> _methods;
+
+    static void writeU2(std::vector<u1> &out, int v) {
+        out.push_back((u1) (v >> 8));
+        out.push_back((u1) v);
+    }
+
+    static void writeU4(std::vector<u1> &out, int v) {
+        writeU2(out, v >> 16);
+        writeU2(out, v);
+    }
+
+    int utf8(const std::string &s) {
+        auto iter = _utf8.find(s);
+        if (iter != _utf8.end()) {
+            return iter->second;
+        }
+        _pool.push_back(CONSTANT_Utf8);
+        writeU2(_pool, (int) s.size());
+        _pool.insert(_pool.end(), s.begin(), s.end());
+        return _utf8[s] = _poolCount++;
+    }
+
+    int classRef(const std::string &name) {
+        int nameIndex = utf8(name);
+        _pool.push_back(CONSTANT_Class);
+        writeU2(_pool, nameIndex);
+        return _poolCount++;
+    }
+
+public:
+    explicit BenchClass(std::string name)
+        : _name(std::move(name)) {
+    }
+
+    int methodRef(const std::string &name, const std::string &descriptor) {
+        int classIndex = classRef(_name);
+        int nameIndex = utf8(name);
+        int descriptorIndex = utf8(descriptor);
+        _pool.push_back(CONSTANT_NameAndType);
+        writeU2(_pool, nameIndex);
+        writeU2(_pool, descriptorIndex);
+        _pool.push_back(CONSTANT_Methodref);
+        writeU2(_pool, classIndex);
+        writeU2(_pool, _poolCount++);
+        return _poolCount++;
+    }
+
+    void addMethod(const BenchMethod &method) {
+        _methods.push_back(method);
+    }
+
+    std::vector<u1> build() {
+        int thisClass = classRef(_name);
+        int superClass = _name == "java/lang/Object" ? 0 : classRef("java/lang/Object");
+        int codeName = utf8("Code");
+        std::vector<std::pair<int, int>> signatures;
+        for (const auto &m : _methods) {
+            signatures.emplace_back(utf8(m.name), utf8(m.descriptor));
+        }
+
+        std::vector<u1> w;
+        writeU4(w, (int) 0xCAFEBABE);
+        writeU2(w, 0);
+        writeU2(w, 49);
+        writeU2(w, _poolCount);
+        w.insert(w.end(), _pool.begin(), _pool.end());
+        writeU2(w, ACC_PUBLIC);
+        writeU2(w, thisClass);
+        writeU2(w, superClass);
+        writeU2(w, 0); // interfaces
+        writeU2(w, 0); // fields
+
+        writeU2(w, (int) _methods.size());
+        for (size_t i = 0; i < _methods.size(); ++i) {
+            const auto &m = _methods[i];
+            writeU2(w, ACC_PUBLIC | ACC_STATIC);
+            writeU2(w, signatures[i].first);
+            writeU2(w, signatures[i].second);
+            writeU2(w, 1);
+            writeU2(w, codeName);
+            writeU4(w, 12 + (int) m.code.size());
+            writeU2(w, m.maxStack);
+            writeU2(w, m.maxLocals);
+            writeU4(w, (int) m.code.size());
+            w.insert(w.end(), m.code.begin(), m.code.end());
+            writeU2(w, 0); // exception table
+            writeU2(w, 0); // attributes
+        }
+        writeU2(w, 0); // attributes
+        return w;
+    }
+};
+
+static std::string classPathDir;
+static InstanceKlass *benchClass;
+
+static InstanceKlass *loadClass(const std::string &name, BenchClass &benchClass) {
+    std::string dir = classPathDir;
+    size_t begin = 0;
+    size_t slash;
+    while ((slash = name.find('/', begin)) != std::string::npos) {
+        dir += "/" + name.substr(begin, slash - begin);
+        mkdir(dir.c_str(), 0755);
+        begin = slash + 1;
+    }
+
+    const auto &bytes = benchClass.build();
+    std::ofstream out(classPathDir + "/" + name + ".class", std::ios::binary);
+    out.write((const char *) bytes.data(), bytes.size());
+    out.close();
+    return (InstanceKlass *) BootstrapClassLoader::get()->loadClass(strings::fromStdString(name));
+}
+
+static bool loadBenchClass() {
+    char dirTemplate[] = "/tmp/kivm-bench-XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr) {
+        return false;
+    }
+    classPathDir = dirTemplate;
+    ClassPathManager::get()->addClassPath(strings::fromStdString(classPathDir));
+
+    BenchClass object("java/lang/Object");
+    loadClass("java/lang/Object", object);
+
+    BenchClass bench("Bench");
+    int add = bench.methodRef("add", "(II)I");
+
+    bench.addMethod({"add", "(II)I", 2, 2, {
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_IADD, OPC_IRETURN,
+    }});
+
+    // int s = 0; for (int i = 0; i < n; i++) s += i * 3 ^ i; return s;
+    bench.addMethod({"loop", "(I)I", 3, 3, {
+        OPC_ICONST_0,                               // 0
+        OPC_ISTORE_1,                               // 1
+        OPC_ICONST_0,                               // 2
+        OPC_ISTORE_2,                               // 3
+        OPC_ILOAD_2,                                // 4
+        OPC_ILOAD_0,                                // 5
+        OPC_IF_ICMPGE, 0, 17,                       // 6 -> 23
+        OPC_ILOAD_1,                                // 9
+        OPC_ILOAD_2,                                // 10
+        OPC_ICONST_3,                               // 11
+        OPC_IMUL,                                   // 12
+        OPC_ILOAD_2,                                // 13
+        OPC_IXOR,                                   // 14
+        OPC_IADD,                                   // 15
+        OPC_ISTORE_1,                               // 16
+        OPC_IINC, 2, 1,                             // 17
+        OPC_GOTO, 0xff, 0xf0,                       // 20 -> 4
+        OPC_ILOAD_1,                                // 23
+        OPC_IRETURN,                                // 24
+    }});
+
+    // int s = 0; for (int i = 0; i < n; i++) s = add(s, i); return s;
+    bench.addMethod({"calls", "(I)I", 2, 3, {
+        OPC_ICONST_0,                               // 0
+        OPC_ISTORE_1,                               // 1
+        OPC_ICONST_0,                               // 2
+        OPC_ISTORE_2,                               // 3
+        OPC_ILOAD_2,                                // 4
+        OPC_ILOAD_0,                                // 5
+        OPC_IF_ICMPGE, 0, 15,                       // 6 -> 21
+        OPC_ILOAD_1,                                // 9
+        OPC_ILOAD_2,                                // 10
+        OPC_INVOKESTATIC, 0, (u1) add,              // 11
+        OPC_ISTORE_1,                               // 14
+        OPC_IINC, 2, 1,                             // 15
+        OPC_GOTO, 0xff, 0xf2,                       // 18 -> 4
+        OPC_ILOAD_1,                                // 21
+        OPC_IRETURN,                                // 22
+    }});
+
+    // long s = 0; for (int i = 0; i < n; i++) s += (long) i << 1; return (int) (s >> 1);
+    bench.addMethod({"longs", "(I)I", 4, 4, {
+        OPC_LCONST_0,                               // 0
+        OPC_LSTORE_1,                               // 1
+        OPC_ICONST_0,                               // 2
+        OPC_ISTORE_3,                               // 3
+        OPC_ILOAD_3,                                // 4
+        OPC_ILOAD_0,                                // 5
+        OPC_IF_ICMPGE, 0, 16,                       // 6 -> 22
+        OPC_LLOAD_1,                                // 9
+        OPC_ILOAD_3,                                // 10
+        OPC_I2L,                                    // 11
+        OPC_ICONST_1,                               // 12
+        OPC_LSHL,                                   // 13
+        OPC_LADD,                                   // 14
+        OPC_LSTORE_1,                               // 15
+        OPC_IINC, 3, 1,                             // 16
+        OPC_GOTO, 0xff, 0xf1,                       // 19 -> 4
+        OPC_LLOAD_1,                                // 22
+        OPC_ICONST_1,                               // 23
+        OPC_LSHR,                                   // 24
+        OPC_L2I,                                    // 25
+        OPC_IRETURN,                                // 26
+    }});
+
+    benchClass = loadClass("Bench", bench);
+    return benchClass != nullptr;
+}
+
+static jint callInt(JavaThread *thread, const char *name, int n) {
+    auto method = benchClass->getStaticMethod(strings::fromStdString(name), L"(I)I");
+    auto result = JavaCall::withArgs(thread, method, {new intOopDesc(n)});
+    return result == nullptr ? -1 : ((intOop) result)->getValue();
+}
+
+struct Mode {
+    const char *name;
+    bool direct;
+    bool generated;
+};
+
+void bench(JavaThread *thread, const char *name) {
+    std::vector<Mode> modes = {{"threaded", false, false}, {"direct threaded", true, false}};
+#ifdef KIVM_TEMPLATE_INTERPRETER
+    modes.push_back({"template", true, true});
+#endif
+    for (const Mode &mode : modes) {
+        RuntimeConfig::get().useDirectThreading = mode.direct;
+        RuntimeConfig::get().useTemplateInterpreter = mode.generated;
+        // decode and quicken first
+        callInt(thread, name, 10);
+
+        auto start = std::chrono::system_clock::now();
+        jint result = callInt(thread, name, TIMES);
+        auto end = std::chrono::system_clock::now();
+        auto cost = end - start;
+        printf("benchmark %s (%s): %lld, result %d\n", name,
+            mode.name, cost.count(), result);
+    }
+}
+
+int main() {
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(64L);
+    Universe::initialize();
+    DefaultInterpreter::initialize();
+
+    auto thread = new BenchThread;
+    Threads::addJavaThread(thread);
+    Threads::setCurrentThread(thread);
+
+    if (!loadBenchClass()) {
+        printf("cannot load the benchmark class\n");
+        return 1;
+    }
+
+    bench(thread, "loop");
+    bench(thread, "calls");
+    bench(thread, "longs");
+    return 0;
+}
@@ -0,0 +1,352 @@
+//
+// Test for KiVM concurrent mark-sweep heap
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/concurrentMarkSweepHeap.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr, nullptr, nullptr}) {
+    }
+
+    oop &getRoot(int index) {
+        auto iter = _args.begin();
+        std::advance(iter, index);
+        return *iter;
+    }
+};
+
+// Counts pauses by kind, and keeps the longest one
+class PauseCounter : public GCListener {
+public:
+    std::map<std::string, size_t> _pauses;
+    std::chrono::microseconds _maxPause{0};
+
+    void onGCEvent(const GCEvent &event) override {
+        if (event._type == GC_PAUSE_END) {
+            ++_pauses[event._collection];
+            _maxPause = std::max(_maxPause, event._pauseTime);
+        }
+    }
+};
+
+static arrayOop newValue(TypeArrayKlass *valueClass, int length, jint id) {
+    auto value = valueClass->newInstance(length);
+    for (int i = 0; i < length; ++i) {
+        *value->getElementAddress<jint>(i) = id + i;
+    }
+    return value;
+}
+
+static bool checkValue(oop object, int length, jint id) {
+    if (object == nullptr || !Universe::isHeapObject(object)
+        || HeapRegion::isFiller((jbyte *) object)) {
+        return false;
+    }
+    auto value = (arrayOop) object;
+    if (value->getLength() != length) {
+        return false;
+    }
+    for (int i = 0; i < length; ++i) {
+        if (*value->getElementAddress<jint>(i) != id + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testSnapshotAtTheBeginning(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Snapshot-at-the-beginning Marking ===" << std::endl;
+
+    const int LENGTH = 64;
+    auto heap = (ConcurrentMarkSweepHeap *) Universe::getCollectedHeap();
+    // [[I, its elements are arrays
+    auto nodeClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    auto valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+
+    // root -> outer -> inner -> hidden
+    auto outer = nodeClass->newInstance(1);
+    auto inner = nodeClass->newInstance(1);
+    auto hidden = newValue(valueClass, LENGTH, 1000);
+    auto garbage = newValue(valueClass, LENGTH, 2000);
+    outer->setElementAt(0, inner);
+    inner->setElementAt(0, hidden);
+    holder->getRoot(0) = outer;
+    garbage = nullptr;
+
+    heap->initialMark();
+    if (!heap->isMarkingActive() || !heap->getSatbMarkQueueSet()->isActive()) {
+        printError("Marking is not active after the initial mark");
+        return false;
+    }
+
+    // Move the only reference to hidden into a root, which is not scanned
+    // again. It is found because the barrier logs the overwritten field.
+    holder->getRoot(1) = hidden;
+    inner->setElementAt(0, nullptr);
+
+    // reachable only from a root stored after the initial mark
+    auto allocated = newValue(valueClass, LENGTH, 3000);
+    holder->getRoot(2) = allocated;
+
+    if (!heap->concurrentMark()) {
+        printError("Concurrent marking was given up");
+        return false;
+    }
+    heap->remark();
+    if (heap->getSatbMarkQueueSet()->isActive()) {
+        printError("Barrier still logging after the remark");
+        return false;
+    }
+    if (!heap->concurrentSweep()) {
+        printError("Concurrent sweep was given up");
+        return false;
+    }
+
+    if (!checkValue(holder->getRoot(1), LENGTH, 1000)) {
+        printError("Object unlinked during marking was freed");
+        return false;
+    }
+    printSuccess("Object unlinked during marking survived through the barrier log");
+
+    if (!checkValue(holder->getRoot(2), LENGTH, 3000)) {
+        printError("Object allocated during marking was freed");
+        return false;
+    }
+    printSuccess("Object allocated during marking survived");
+
+    // allocated right after hidden, which is live, so a dead run starts there
+    auto dead = (jbyte *) hidden + alignUp(hidden->getObjectSize(), sizeof(jlong));
+    if (!HeapRegion::isFiller(dead)) {
+        printError("Unreachable object was not swept");
+        return false;
+    }
+    printSuccess("Unreachable object was swept");
+
+    for (int i = 0; i < 3; ++i) {
+        holder->getRoot(i) = nullptr;
+    }
+    return true;
+}
+
+bool testCycleGivenUp(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Concurrent Cycle Given Up by a Full Collection ===" << std::endl;
+
+    const int LENGTH = 16;
+    const int GARBAGE = 20000;
+    auto heap = (ConcurrentMarkSweepHeap *) Universe::getCollectedHeap();
+    auto valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+
+    holder->getRoot(0) = newValue(valueClass, LENGTH, 42);
+    heap->initialMark();
+    for (int i = 0; i < GARBAGE; ++i) {
+        valueClass->newInstance(LENGTH);
+    }
+    size_t usedBefore = heap->getHeapUsed();
+
+    heap->doGarbageCollection();
+    if (heap->isMarkingActive() || heap->getSatbMarkQueueSet()->isActive()) {
+        printError("Marking is still active after a full collection");
+        return false;
+    }
+    if (heap->concurrentMark()) {
+        printError("Marking went on after the cycle was given up");
+        return false;
+    }
+    heap->remark();
+    heap->concurrentSweep();
+
+    if (!checkValue(holder->getRoot(0), LENGTH, 42)) {
+        printError("Live object was lost");
+        return false;
+    }
+    printInfo("  used: " + std::to_string(usedBefore) + " -> " + std::to_string(heap->getHeapUsed()));
+    if (heap->getHeapUsed() * 4 > usedBefore) {
+        printError("Objects allocated marked by the given up cycle were not freed");
+        return false;
+    }
+    printSuccess("Full collection gave up the cycle and freed everything unreachable");
+
+    holder->getRoot(0) = nullptr;
+    return true;
+}
+
+// Runs on a plain native thread, polling like the interpreter does
+class MutatorThread : public JavaThread {
+public:
+    MutatorThread()
+        : JavaThread(nullptr, {nullptr}) {
+    }
+
+    oop &getRoot() {
+        return _args.front();
+    }
+};
+
+static std::atomic<bool> sBroken(false);
+static std::atomic<jint> sNextId(0);
+
+// Shuffles and replaces values of a large array while concurrent
+// cycles trace it, then checks that no value was freed.
+static void mutate(MutatorThread *thread, int slots, int iterations, unsigned seed) {
+    const int LENGTH = 4;
+
+    Threads::setCurrentThread(thread);
+    auto holderClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    auto valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    std::mt19937 random(seed);
+
+    thread->getRoot() = holderClass->newInstance(slots);
+    for (int i = 0; i < slots; ++i) {
+        ((arrayOop) thread->getRoot())->setElementAt(i, newValue(valueClass, LENGTH, sNextId++ * 16));
+    }
+
+    for (int i = 0; i < iterations && !sBroken; ++i) {
+        auto holder = (arrayOop) thread->getRoot();
+        int a = random() % slots;
+        int b = random() % slots;
+
+        // Swapping moves references behind the marker, a value may
+        // only be reachable from an array slot it has already scanned.
+        oop first = holder->getElementAt(a);
+        oop second = holder->getElementAt(b);
+        holder->setElementAt(a, second);
+        holder->setElementAt(b, first);
+
+        if (i % 4 == 0) {
+            holder->setElementAt(random() % slots, newValue(valueClass, LENGTH, sNextId++ * 16));
+        }
+
+        // garbage
+        valueClass->newInstance(64);
+
+        thread->enterSafepointIfNeeded();
+    }
+
+    auto holder = (arrayOop) thread->getRoot();
+    std::unordered_set<jint> ids;
+    for (int i = 0; i < slots; ++i) {
+        oop value = holder->getElementAt(i);
+        jint id = value == nullptr ? -1 : *((arrayOop) value)->getElementAddress<jint>(0);
+        if (!checkValue(value, LENGTH, id) || !ids.insert(id).second) {
+            sBroken = true;
+            break;
+        }
+    }
+    thread->getRoot() = nullptr;
+    thread->onDestroy();
+}
+
+bool testConcurrentCycles() {
+    std::cout << "\n=== Testing Concurrent Cycles with Running Mutators ===" << std::endl;
+
+    const int MUTATORS = 2;
+    const int SLOTS = 20000;
+    const int ITERATIONS = 400000;
+
+    auto heap = (ConcurrentMarkSweepHeap *) Universe::getCollectedHeap();
+    PauseCounter counter;
+    Universe::addGCListener(&counter);
+
+    std::vector<MutatorThread *> mutators;
+    for (int i = 0; i < MUTATORS; ++i) {
+        mutators.push_back(new MutatorThread);
+        Threads::addJavaThread(mutators.back());
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < MUTATORS; ++i) {
+        threads.emplace_back(mutate, mutators[i], SLOTS, ITERATIONS, 17 + i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    Threads::waitForJavaThreadsDeadLocked();
+    Universe::removeGCListener(&counter);
+
+    if (sBroken) {
+        printError("A value was freed while still reachable");
+        return false;
+    }
+    printSuccess("Values shuffled by " + std::to_string(MUTATORS) + " mutators survived all cycles");
+
+    printInfo("  concurrent cycles: " + std::to_string(heap->getConcurrentCycles())
+              + ", initial marks: " + std::to_string(counter._pauses["initial-mark"])
+              + ", remarks: " + std::to_string(counter._pauses["remark"])
+              + ", full collections: " + std::to_string(counter._pauses["mark-sweep"])
+              + ", longest pause: " + std::to_string(counter._maxPause.count()) + " us"
+              + ", heap: " + std::to_string(heap->getHeapSize() >> 20) + " MB");
+    if (heap->getConcurrentCycles() == 0 || counter._pauses["remark"] == 0) {
+        printError("No concurrent cycle completed");
+        return false;
+    }
+    printSuccess("Collected by concurrent cycles while mutators ran");
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Concurrent Mark-Sweep Heap Test ===" << std::endl;
+
+    RuntimeConfig::get().heapType = HEAP_CONCURRENT_MARK_SWEEP;
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(16L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().gcWorkerThreads = 4;
+    Universe::initialize();
+    printSuccess("Universe initialized");
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    if (!testSnapshotAtTheBeginning(holder)) {
+        return 1;
+    }
+
+    if (!testCycleGivenUp(holder)) {
+        return 1;
+    }
+
+    // the holder never polls, it must not hold up safepoints
+    GCThread::initialize();
+    holder->onDestroy();
+    GCThread::get()->start();
+
+    if (!testConcurrentCycles()) {
+        return 1;
+    }
+
+    GCThread::get()->stop();
+    Universe::destroy();
+    printSuccess("All Concurrent Mark-Sweep tests completed!");
+    return 0;
+}
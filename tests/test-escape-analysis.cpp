@@ -0,0 +1,422 @@
+//
+// Test for KiVM escape analysis, control flow graphs and frame arenas
+//
+
+#include <kivm/bytecode/escapeAnalysis.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/cfg/controlFlowGraph.h>
+#include <kivm/classfile/classFile.h>
+#include <kivm/classfile/classFileParser.h>
+#include <kivm/memory/frameArena.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/method.h>
+#include <kivm/oop/primitiveOop.h>
+#include <kivm/runtime/constantPool.h>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+// Class files are assembled by hand, there is no javac here
+class ClassWriter {
+private:
+    std::vector<u1> _bytes;
+
+public:
+    void writeU1(int v) {
+        _bytes.push_back((u1) v);
+    }
+
+    void writeU2(int v) {
+        writeU1(v >> 8);
+        writeU1(v);
+    }
+
+    void writeU4(int v) {
+        writeU2(v >> 16);
+        writeU2(v);
+    }
+
+    void writeUtf8(const std::string &s) {
+        writeU1(CONSTANT_Utf8);
+        writeU2((int) s.size());
+        for (char c : s) {
+            writeU1(c);
+        }
+    }
+
+    void writeBytes(const std::vector<u1> &b) {
+        _bytes.insert(_bytes.end(), b.begin(), b.end());
+    }
+
+    std::vector<u1> &get() {
+        return _bytes;
+    }
+};
+
+enum {
+    CP_THIS_NAME = 1,
+    CP_THIS_CLASS,
+    CP_OBJECT_NAME,
+    CP_OBJECT_CLASS,
+    CP_CODE,
+    CP_FIELD_NAME,
+    CP_OBJECT_DESC,
+    CP_FIELD_NAME_AND_TYPE,
+    CP_FIELD,
+    CP_SINK_NAME,
+    CP_SINK_DESC,
+    CP_SINK_NAME_AND_TYPE,
+    CP_SINK_METHOD,
+    CP_VOID_DESC,
+    CP_MAKE_DESC,
+    CP_PASS_DESC,
+    CP_BRANCH_DESC,
+    CP_METHOD_NAME,
+    CP_COUNT
+};
+
+struct TestMethod {
+    int descriptor;
+    int maxLocals;
+    std::vector<u1> code;
+    std::vector<u1> exceptionTable;
+};
+
+enum {
+    M_LOOP,
+    M_KEEP,
+    M_STORE,
+    M_RETURN,
+    M_CALL,
+    M_PASS,
+    M_BRANCH,
+    M_COUNT
+};
+
+static const std::vector<TestMethod> METHODS = {
+    // static void loop(): the previous object is dead when NEW is reached again
+    {CP_VOID_DESC, 1, {
+        OPC_NEW, 0, CP_THIS_CLASS,               // 0
+        OPC_ASTORE_0,                            // 3
+        OPC_ALOAD_0,                             // 4
+        OPC_POP,                                 // 5
+        OPC_GOTO, 0xFF, 0xFA,                    // 6 -> 0
+    }, {}},
+
+    // static void keep(): the previous object is still read in local 0
+    {CP_VOID_DESC, 2, {
+        OPC_ACONST_NULL,                         // 0
+        OPC_ASTORE_0,                            // 1
+        OPC_NEW, 0, CP_THIS_CLASS,               // 2
+        OPC_ASTORE_1,                            // 5
+        OPC_ALOAD_0,                             // 6
+        OPC_POP,                                 // 7
+        OPC_ALOAD_1,                             // 8
+        OPC_ASTORE_0,                            // 9
+        OPC_GOTO, 0xFF, 0xF8,                    // 10 -> 2
+    }, {}},
+
+    // static void store(): stored into a static field
+    {CP_VOID_DESC, 0, {
+        OPC_NEW, 0, CP_THIS_CLASS,               // 0
+        OPC_PUTSTATIC, 0, CP_FIELD,              // 3
+        OPC_RETURN,                              // 6
+    }, {}},
+
+    // static Object make(): returned
+    {CP_MAKE_DESC, 0, {
+        OPC_NEW, 0, CP_THIS_CLASS,               // 0
+        OPC_ARETURN,                             // 3
+    }, {}},
+
+    // static void call(): passed to a method of a class that is not loaded
+    {CP_VOID_DESC, 0, {
+        OPC_NEW, 0, CP_THIS_CLASS,               // 0
+        OPC_INVOKESTATIC, 0, CP_SINK_METHOD,     // 3
+        OPC_RETURN,                              // 6
+    }, {}},
+
+    // static Object pass(Object a, Object b): returns a, stores b
+    {CP_PASS_DESC, 2, {
+        OPC_ALOAD_1,                             // 0
+        OPC_PUTSTATIC, 0, CP_FIELD,              // 1
+        OPC_ALOAD_0,                             // 4
+        OPC_ARETURN,                             // 5
+    }, {}},
+
+    // static void branch(int a): throws in a try block if a is not 0
+    {CP_BRANCH_DESC, 1, {
+        OPC_ILOAD_0,                             // 0
+        OPC_IFEQ, 0, 6,                          // 1 -> 7
+        OPC_ACONST_NULL,                         // 4
+        OPC_ATHROW,                              // 5
+        OPC_POP,                                 // 6
+        OPC_RETURN,                              // 7
+    }, {0, 4, 0, 6, 0, 6, 0, 0}},
+};
+
+static void writeCode(ClassWriter &w, const TestMethod &method) {
+    ClassWriter attr;
+    attr.writeU2(2);
+    attr.writeU2(method.maxLocals);
+    attr.writeU4((int) method.code.size());
+    attr.writeBytes(method.code);
+    attr.writeU2((int) method.exceptionTable.size() / 8);
+    attr.writeBytes(method.exceptionTable);
+    attr.writeU2(0);
+
+    w.writeU2(CP_CODE);
+    w.writeU4((int) attr.get().size());
+    w.writeBytes(attr.get());
+}
+
+static ClassFile *makeClassFile(ClassWriter &w) {
+    w.writeU4((int) 0xCAFEBABE);
+    w.writeU2(0);
+    w.writeU2(49);
+
+    w.writeU2(CP_COUNT);
+    w.writeUtf8("T");
+    w.writeU1(CONSTANT_Class);
+    w.writeU2(CP_THIS_NAME);
+    w.writeUtf8("java/lang/Object");
+    w.writeU1(CONSTANT_Class);
+    w.writeU2(CP_OBJECT_NAME);
+    w.writeUtf8("Code");
+    w.writeUtf8("f");
+    w.writeUtf8("Ljava/lang/Object;");
+    w.writeU1(CONSTANT_NameAndType);
+    w.writeU2(CP_FIELD_NAME);
+    w.writeU2(CP_OBJECT_DESC);
+    w.writeU1(CONSTANT_Fieldref);
+    w.writeU2(CP_THIS_CLASS);
+    w.writeU2(CP_FIELD_NAME_AND_TYPE);
+    w.writeUtf8("sink");
+    w.writeUtf8("(Ljava/lang/Object;)V");
+    w.writeU1(CONSTANT_NameAndType);
+    w.writeU2(CP_SINK_NAME);
+    w.writeU2(CP_SINK_DESC);
+    w.writeU1(CONSTANT_Methodref);
+    w.writeU2(CP_THIS_CLASS);
+    w.writeU2(CP_SINK_NAME_AND_TYPE);
+    w.writeUtf8("()V");
+    w.writeUtf8("()Ljava/lang/Object;");
+    w.writeUtf8("(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+    w.writeUtf8("(I)V");
+    w.writeUtf8("m");
+
+    w.writeU2(ACC_PUBLIC);
+    w.writeU2(CP_THIS_CLASS);
+    w.writeU2(CP_OBJECT_CLASS);
+    w.writeU2(0); // interfaces
+    w.writeU2(0); // fields
+
+    w.writeU2((int) METHODS.size());
+    for (const auto &method : METHODS) {
+        w.writeU2(ACC_PUBLIC | ACC_STATIC);
+        w.writeU2(CP_METHOD_NAME);
+        w.writeU2(method.descriptor);
+        w.writeU2(1);
+        writeCode(w, method);
+    }
+
+    w.writeU2(0); // attributes
+
+    ClassFileParser parser(L"T.class", w.get().data(), w.get().size());
+    return parser.getParsedClassFile();
+}
+
+static Method *makeMethod(InstanceKlass *klass, ClassFile *classFile, int index) {
+    auto method = new Method(klass, &classFile->methods[index]);
+    method->linkMethod(classFile->constant_pool);
+    return method;
+}
+
+static bool check(bool condition, const std::string &message) {
+    if (!condition) {
+        printError(message);
+    }
+    return condition;
+}
+
+bool testEscapeAnalysis(const std::vector<Method *> &methods) {
+    std::cout << "\n=== Testing escape analysis ===" << std::endl;
+
+    auto loop = methods[M_LOOP]->getEscapeAnalysis();
+    if (!check(loop->getFrameLocalSite(0) == 0, "loop: site should be frame local")
+        || !check(loop->getFrameLocalSite(3) == -1, "loop: bci 3 is not a site")
+        || !check(loop->isReusableSite(0), "loop: site should be reusable")) {
+        return false;
+    }
+    printSuccess("Objects dead before the next NEW reuse their memory");
+
+    auto keep = methods[M_KEEP]->getEscapeAnalysis();
+    if (!check(keep->getFrameLocalSite(2) == 0, "keep: site should be frame local")
+        || !check(!keep->isReusableSite(0), "keep: site should not be reusable")) {
+        return false;
+    }
+    printSuccess("Objects still read later keep their memory");
+
+    if (!check(methods[M_STORE]->getEscapeAnalysis()->getFrameLocalSite(0) == -1,
+        "store: site should escape")
+        || !check(methods[M_RETURN]->getEscapeAnalysis()->getFrameLocalSite(0) == -1,
+            "make: site should escape")
+        || !check(methods[M_CALL]->getEscapeAnalysis()->getFrameLocalSite(0) == -1,
+            "call: site should escape")) {
+        return false;
+    }
+    printSuccess("Stored, returned and unknown arguments escape");
+
+    auto pass = methods[M_PASS]->getEscapeAnalysis();
+    if (!check(!pass->isArgumentEscaping(0) && pass->isArgumentReturned(0), "pass: a is only returned")
+        || !check(pass->isArgumentEscaping(1) && !pass->isArgumentReturned(1), "pass: b escapes")) {
+        return false;
+    }
+    printSuccess("Argument summaries");
+    return true;
+}
+
+bool testControlFlowGraph(Method *method) {
+    std::cout << "\n=== Testing control flow graph ===" << std::endl;
+
+    instr::ControlFlowGraph cfg(method);
+    const auto &blocks = cfg.getBlocks();
+    if (!check(blocks.size() == 4, "branch: expected 4 blocks")) {
+        return false;
+    }
+
+    std::vector<int> firsts = {0, 4, 6, 7};
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!check(blocks[i]->getFirstInstructionNum() == firsts[i],
+            "wrong start of block " + std::to_string(i))) {
+            return false;
+        }
+    }
+
+    if (!check(cfg.getBlockAt(5) == blocks[1] && cfg.getBlockAt(2) == blocks[0], "wrong block of bci")
+        || !check(!cfg.isInstructionStart(2) && cfg.isInstructionStart(4), "wrong instruction starts")) {
+        return false;
+    }
+
+    auto hasEdge = [](instr::BasicBlock *src, instr::BasicBlock *dest, instr::EdgeType type) {
+        for (auto edge : src->getEdges()) {
+            if (edge->src == src && edge->dest == dest && edge->hasType(type)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (!check(hasEdge(blocks[0], blocks[3], instr::REGULAR), "missing edge of the taken branch")
+        || !check(hasEdge(blocks[0], blocks[1], instr::REGULAR), "missing edge of the fall through")
+        || !check(hasEdge(blocks[1], blocks[2], instr::CAUGHT_EXCEPTION), "missing edge to the handler")
+        || !check(hasEdge(blocks[2], blocks[3], instr::REGULAR), "missing edge out of the handler")
+        || !check(!hasEdge(blocks[1], blocks[3], instr::REGULAR), "athrow does not fall through")) {
+        return false;
+    }
+    printSuccess("Blocks and edges");
+
+    auto order = cfg.getReversePostOrder();
+    if (!check(order == std::vector<instr::BasicBlock *>(blocks.begin(), blocks.end()),
+        "wrong reverse post order")) {
+        return false;
+    }
+    printSuccess("Reverse post order");
+    return true;
+}
+
+bool testFrameArena() {
+    std::cout << "\n=== Testing frame arena ===" << std::endl;
+
+    FrameArena arena;
+    if (!check(arena.getUsed() == 0 && arena.allocate(FrameArena::CHUNK_SIZE + 1) == nullptr,
+        "objects larger than a chunk are not allocated")) {
+        return false;
+    }
+
+    auto outer = (oop) ::new(arena.allocate(sizeof(intOopDesc))) intOopDesc(1);
+    auto mark = arena.mark();
+    auto inner = (oop) ::new(arena.allocate(sizeof(longOopDesc))) longOopDesc(2);
+    if (!check(arena.contains(outer) && arena.contains(inner), "objects should be in the arena")) {
+        return false;
+    }
+
+    int count = 0;
+    arena.objectIterate([&](oop object) {
+        ++count;
+    });
+    if (!check(count == 2, "expected 2 objects")) {
+        return false;
+    }
+
+    arena.release(mark);
+    if (!check(arena.contains(outer) && !arena.contains(inner), "inner object should be freed")) {
+        return false;
+    }
+    printSuccess("Mark and release");
+
+    // fill more than a chunk
+    auto chunkMark = arena.mark();
+    size_t allocated = 0;
+    while (allocated <= FrameArena::CHUNK_SIZE) {
+        if (!check(arena.allocate(sizeof(intOopDesc)) != nullptr, "arena should not be full")) {
+            return false;
+        }
+        allocated += alignUp(sizeof(intOopDesc), sizeof(jlong));
+    }
+    if (!check(arena.getUsed() > FrameArena::CHUNK_SIZE, "a second chunk should be used")) {
+        return false;
+    }
+    arena.release(chunkMark);
+    if (!check(arena.getUsed() == alignUp(sizeof(intOopDesc), sizeof(jlong)), "wrong size after release")) {
+        return false;
+    }
+    printSuccess("Chunks");
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Escape Analysis Test ===" << std::endl;
+
+    ClassWriter w;
+    auto classFile = makeClassFile(w);
+    if (classFile == nullptr) {
+        printError("Cannot parse class file");
+        return 1;
+    }
+
+    auto klass = new InstanceKlass(classFile, nullptr, nullptr, ClassType::INSTANCE_CLASS);
+    klass->getRuntimeConstantPool()->attachConstantPool(classFile->constant_pool,
+        classFile->constant_pool_count);
+
+    std::vector<Method *> methods;
+    for (int i = 0; i < M_COUNT; ++i) {
+        methods.push_back(makeMethod(klass, classFile, i));
+    }
+
+    if (!testEscapeAnalysis(methods)) {
+        return 1;
+    }
+
+    if (!testControlFlowGraph(methods[M_BRANCH])) {
+        return 1;
+    }
+
+    if (!testFrameArena()) {
+        return 1;
+    }
+
+    printSuccess("All escape analysis tests completed!");
+    return 0;
+}
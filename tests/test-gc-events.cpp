@@ -0,0 +1,173 @@
+//
+// Test for KiVM GC events and the GC log
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/gcEvent.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+static const char *GC_LOG_PATH = "test-gc-events.log";
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr}) {
+    }
+
+    oop &getRoot() {
+        return _args.front();
+    }
+};
+
+class RecordingListener : public GCListener {
+public:
+    std::vector<GCEvent> _events;
+
+    void onGCEvent(const GCEvent &event) override {
+        _events.push_back(event);
+    }
+};
+
+bool checkEvents(const std::vector<GCEvent> &events, int collections, size_t liveObjects) {
+    if (events.size() != (size_t) collections * 2) {
+        printError("Expected " + std::to_string(collections * 2) + " events, got "
+                   + std::to_string(events.size()));
+        return false;
+    }
+
+    for (int i = 0; i < collections; ++i) {
+        const GCEvent &start = events[i * 2];
+        const GCEvent &end = events[i * 2 + 1];
+        std::string where = "collection " + std::to_string(i + 1) + ": ";
+
+        if (start._type != GC_PAUSE_START || end._type != GC_PAUSE_END) {
+            printError(where + "pause start and end are not paired");
+            return false;
+        }
+        if (start._id != (size_t) i + 1 || end._id != start._id) {
+            printError(where + "wrong id " + std::to_string(end._id));
+            return false;
+        }
+        if (end._usedBefore != start._usedBefore || end._usedAfter >= end._usedBefore) {
+            printError(where + "garbage was not reported as freed");
+            return false;
+        }
+        if (end._objectsCopied < liveObjects) {
+            printError(where + "only " + std::to_string(end._objectsCopied) + " objects copied");
+            return false;
+        }
+        if (end._uptime != start._uptime || end._pauseTime.count() <= 0) {
+            printError(where + "wrong pause timing");
+            return false;
+        }
+
+        printInfo("  " + std::string(end._collection) + ": "
+                  + std::to_string(end._usedBefore >> 10) + " KB -> "
+                  + std::to_string(end._usedAfter >> 10) + " KB, "
+                  + std::to_string(end._objectsCopied) + " objects, "
+                  + std::to_string(end._pauseTime.count()) + " us, threads scanned in "
+                  + std::to_string(end._rootScanTime[ROOTS_THREADS].count()) + " us");
+    }
+    return true;
+}
+
+bool checkLogFile(int collections) {
+    std::ifstream in(GC_LOG_PATH);
+    std::string line;
+    int starts = 0;
+    int ends = 0;
+    while (std::getline(in, line)) {
+        if (line.front() != '{' || line.back() != '}') {
+            printError("Not a JSON object: " + line);
+            return false;
+        }
+        if (line.find("\"event\":\"pause_start\"") != std::string::npos) {
+            ++starts;
+        } else if (line.find("\"event\":\"pause_end\"") != std::string::npos
+                   && line.find("\"root_scan_us\":{\"globals\":") != std::string::npos
+                   && line.find("\"allocation_sites\":[") != std::string::npos) {
+            ++ends;
+        } else {
+            printError("Unexpected line: " + line);
+            return false;
+        }
+    }
+
+    if (starts != collections || ends != collections) {
+        printError("Expected " + std::to_string(collections) + " pauses in the log, got "
+                   + std::to_string(starts) + " starts and " + std::to_string(ends) + " ends");
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM GC Events Test ===" << std::endl;
+
+    const int COLLECTIONS = 3;
+    const int LIVE_OBJECTS = 1000;
+
+    RuntimeConfig::get().gcWorkerThreads = 2;
+    RuntimeConfig::get().gcLogEnabled = true;
+    RuntimeConfig::get().gcLogPath = GC_LOG_PATH;
+    Universe::initialize();
+    printSuccess("Universe initialized with a GC log");
+
+    RecordingListener listener;
+    Universe::addGCListener(&listener);
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    // [[I, its elements are [I
+    auto holderClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    for (int i = 0; i < COLLECTIONS; ++i) {
+        auto live = holderClass->newInstance(LIVE_OBJECTS);
+        holder->getRoot() = live;
+        for (int j = 0; j < LIVE_OBJECTS; ++j) {
+            // garbage
+            arrayClass->newInstance(64);
+            live->setElementAt(j, arrayClass->newInstance(4));
+        }
+        Universe::getCollectedHeap()->doGarbageCollection();
+    }
+
+    Universe::removeGCListener(&listener);
+    if (!checkEvents(listener._events, COLLECTIONS, LIVE_OBJECTS)) {
+        return 1;
+    }
+    printSuccess("Listener received paired pause events");
+
+    // closes the log
+    Universe::destroy();
+    if (!checkLogFile(COLLECTIONS)) {
+        return 1;
+    }
+    printSuccess("GC log has a JSON line for every event");
+
+    printSuccess("All GC events tests completed!");
+    return 0;
+}
@@ -0,0 +1,418 @@
+//
+// Test for KiVM HPROF heap dumps
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/heapDumper.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/native/sun_misc_Signal.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <csignal>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+static const char *DUMP_PATH = "test-heap-dump.hprof";
+static const char *SIGNAL_DUMP_PATH = "test-heap-dump-signal.hprof";
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr}) {
+    }
+
+    oop &getRoot() {
+        return _args.front();
+    }
+};
+
+// What the test reads back from a dump
+struct ParsedDump {
+    int _strings = 0;
+    int _loadClasses = 0;
+    int _segments = 0;
+    int _unknownRoots = 0;
+    int _classDumps = 0;
+    // id -> elements of int arrays
+    std::map<u8, std::vector<jint>> _intArrays;
+    // id -> elements of object arrays
+    std::map<u8, std::vector<u8>> _objectArrays;
+    std::vector<u8> _rootIds;
+};
+
+class HprofReader {
+private:
+    std::vector<u1> _data;
+    size_t _pos = 0;
+
+public:
+    explicit HprofReader(const char *path) {
+        std::ifstream in(path, std::ios::binary);
+        _data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    bool atEnd() const {
+        return _pos >= _data.size();
+    }
+
+    size_t getPos() const {
+        return _pos;
+    }
+
+    bool has(size_t size) const {
+        return _pos + size <= _data.size();
+    }
+
+    u8 read(int size) {
+        u8 value = 0;
+        for (int i = 0; i < size; ++i) {
+            value = (value << 8) | _data[_pos++];
+        }
+        return value;
+    }
+
+    void skip(size_t size) {
+        _pos += size;
+    }
+
+    std::string readString() {
+        std::string result;
+        while (_data[_pos] != 0) {
+            result.push_back((char) _data[_pos++]);
+        }
+        ++_pos;
+        return result;
+    }
+};
+
+static size_t getValueSize(u1 type) {
+    switch (type) {
+        case 2:
+            return 8;
+        case 4:
+        case 8:
+            return 1;
+        case 5:
+        case 9:
+            return 2;
+        case 6:
+        case 10:
+            return 4;
+        case 7:
+        case 11:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+// Parse sub-records until the end of a segment
+static bool parseSegment(HprofReader &reader, size_t end, ParsedDump &dump) {
+    while (reader.getPos() < end) {
+        u1 tag = (u1) reader.read(1);
+        switch (tag) {
+            case 0xFF:
+                ++dump._unknownRoots;
+                dump._rootIds.push_back(reader.read(8));
+                break;
+            case 0x05:
+                reader.skip(8);
+                break;
+            case 0x03:
+            case 0x08:
+                reader.skip(8 + 4 + 4);
+                break;
+            case 0x20: {
+                ++dump._classDumps;
+                reader.skip(8 + 4 + 6 * 8 + 4);
+                u2 constants = (u2) reader.read(2);
+                for (int i = 0; i < constants; ++i) {
+                    reader.skip(2);
+                    reader.skip(getValueSize((u1) reader.read(1)));
+                }
+                u2 statics = (u2) reader.read(2);
+                for (int i = 0; i < statics; ++i) {
+                    reader.skip(8);
+                    reader.skip(getValueSize((u1) reader.read(1)));
+                }
+                u2 fields = (u2) reader.read(2);
+                reader.skip(fields * (8 + 1));
+                break;
+            }
+            case 0x21: {
+                reader.skip(8 + 4 + 8);
+                reader.skip(reader.read(4));
+                break;
+            }
+            case 0x22: {
+                u8 id = reader.read(8);
+                reader.skip(4);
+                u4 length = (u4) reader.read(4);
+                reader.skip(8);
+                auto &elements = dump._objectArrays[id];
+                for (u4 i = 0; i < length; ++i) {
+                    elements.push_back(reader.read(8));
+                }
+                break;
+            }
+            case 0x23: {
+                u8 id = reader.read(8);
+                reader.skip(4);
+                u4 length = (u4) reader.read(4);
+                u1 type = (u1) reader.read(1);
+                if (type != 10) {
+                    reader.skip(length * getValueSize(type));
+                    break;
+                }
+                auto &elements = dump._intArrays[id];
+                for (u4 i = 0; i < length; ++i) {
+                    elements.push_back((jint) reader.read(4));
+                }
+                break;
+            }
+            default:
+                printError("Unknown sub-record tag " + std::to_string(tag));
+                return false;
+        }
+    }
+
+    if (reader.getPos() != end) {
+        printError("Sub-records overrun their segment");
+        return false;
+    }
+    return true;
+}
+
+static bool parseDump(const char *path, ParsedDump &dump) {
+    HprofReader reader(path);
+    if (reader.readString() != "JAVA PROFILE 1.0.2" || reader.read(4) != 8) {
+        printError("Bad HPROF header");
+        return false;
+    }
+    reader.skip(8);
+
+    bool ended = false;
+    while (!reader.atEnd()) {
+        if (ended) {
+            printError("Records after HEAP DUMP END");
+            return false;
+        }
+        if (!reader.has(9)) {
+            printError("Truncated record header");
+            return false;
+        }
+
+        u1 tag = (u1) reader.read(1);
+        reader.skip(4);
+        u4 length = (u4) reader.read(4);
+        if (!reader.has(length)) {
+            printError("Truncated record, tag " + std::to_string(tag));
+            return false;
+        }
+
+        switch (tag) {
+            case 0x01:
+                ++dump._strings;
+                reader.skip(length);
+                break;
+            case 0x02:
+                ++dump._loadClasses;
+                reader.skip(length);
+                break;
+            case 0x1C:
+                ++dump._segments;
+                if (!parseSegment(reader, reader.getPos() + length, dump)) {
+                    return false;
+                }
+                break;
+            case 0x2C:
+                ended = true;
+                break;
+            default:
+                reader.skip(length);
+                break;
+        }
+    }
+
+    if (!ended) {
+        printError("No HEAP DUMP END record");
+        return false;
+    }
+    return true;
+}
+
+// The holder array is a root, its elements are its int arrays
+static bool checkHolder(const ParsedDump &dump, arrayOop holder, int liveArrays) {
+    u8 holderId = (u8) (uintptr_t) holder;
+    if (std::find(dump._rootIds.begin(), dump._rootIds.end(), holderId) == dump._rootIds.end()) {
+        printError("Holder is not reported as a root");
+        return false;
+    }
+
+    auto iter = dump._objectArrays.find(holderId);
+    if (iter == dump._objectArrays.end() || iter->second.size() != (size_t) liveArrays) {
+        printError("Holder array not dumped with its elements");
+        return false;
+    }
+
+    for (int i = 0; i < liveArrays; ++i) {
+        auto element = dump._intArrays.find(iter->second[i]);
+        if (element == dump._intArrays.end() || element->second.size() != (size_t) i + 1) {
+            printError("Element " + std::to_string(i) + " of holder not dumped");
+            return false;
+        }
+        for (int j = 0; j <= i; ++j) {
+            if (element->second[j] != i * 1000 + j) {
+                printError("Wrong value in int array " + std::to_string(i));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool testDump(RootHolderThread *holderThread, int liveArrays, int garbageArrays) {
+    std::cout << "\n=== Testing Heap Dump ===" << std::endl;
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    // [[I, its elements are [I
+    auto holderClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+
+    auto holder = holderClass->newInstance(liveArrays);
+    holderThread->getRoot() = holder;
+    for (int i = 0; i < liveArrays; ++i) {
+        // garbage in between
+        for (int k = 0; k < garbageArrays / liveArrays; ++k) {
+            arrayClass->newInstance(16);
+        }
+
+        auto array = arrayClass->newInstance(i + 1);
+        for (int j = 0; j <= i; ++j) {
+            *array->getElementAddress<jint>(j) = i * 1000 + j;
+        }
+        holder->setElementAt(i, array);
+    }
+
+    if (!HeapDumper::dump(DUMP_PATH)) {
+        printError("Dump failed");
+        return false;
+    }
+
+    ParsedDump dump;
+    if (!parseDump(DUMP_PATH, dump)) {
+        return false;
+    }
+    printInfo("  " + std::to_string(dump._strings) + " strings, "
+              + std::to_string(dump._loadClasses) + " classes, "
+              + std::to_string(dump._segments) + " segments, "
+              + std::to_string(dump._intArrays.size()) + " int arrays");
+
+    if (dump._loadClasses < 2 || dump._classDumps != dump._loadClasses) {
+        printError("Array classes are missing");
+        return false;
+    }
+    // unreachable arrays are still in the heap
+    if (dump._intArrays.size() < (size_t) (liveArrays + garbageArrays)) {
+        printError("Only " + std::to_string(dump._intArrays.size()) + " int arrays dumped");
+        return false;
+    }
+    if (!checkHolder(dump, (arrayOop) holderThread->getRoot(), liveArrays)) {
+        return false;
+    }
+    printSuccess("Dump before GC holds all objects");
+
+    Universe::getCollectedHeap()->doGarbageCollection();
+
+    ParsedDump afterGC;
+    if (!HeapDumper::dump(DUMP_PATH) || !parseDump(DUMP_PATH, afterGC)) {
+        return false;
+    }
+    if (afterGC._intArrays.size() != (size_t) liveArrays) {
+        printError("Expected " + std::to_string(liveArrays) + " int arrays after GC, got "
+                   + std::to_string(afterGC._intArrays.size()));
+        return false;
+    }
+    if (!checkHolder(afterGC, (arrayOop) holderThread->getRoot(), liveArrays)) {
+        return false;
+    }
+    printSuccess("Dump after GC holds only live objects, at their new addresses");
+    return true;
+}
+
+bool testSignal(RootHolderThread *holderThread, int liveArrays) {
+    std::cout << "\n=== Testing Heap Dump on SIGUSR1 ===" << std::endl;
+
+    remove(SIGNAL_DUMP_PATH);
+    RuntimeConfig::get().heapDumpPath = SIGNAL_DUMP_PATH;
+    GCThread::initialize();
+    GCThread::get()->start();
+    sun::misc::Signal::initialize();
+
+    raise(SIGUSR1);
+    if (!GCThread::isSafepointPollArmed()) {
+        printError("Signal did not arm the safepoint poll");
+        return false;
+    }
+
+    // polls like the interpreter, the dump is done when it returns
+    Threads::setCurrentThread(holderThread);
+    holderThread->enterSafepointIfNeeded();
+    GCThread::get()->stop();
+
+    ParsedDump dump;
+    if (!parseDump(SIGNAL_DUMP_PATH, dump)
+        || !checkHolder(dump, (arrayOop) holderThread->getRoot(), liveArrays)) {
+        return false;
+    }
+    if (GCThread::isSafepointPollArmed()) {
+        printError("Poll is still armed after the dump");
+        return false;
+    }
+    printSuccess("Heap dumped by the GC thread at a safepoint");
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Heap Dump Test ===" << std::endl;
+
+    RuntimeConfig::get().gcWorkerThreads = 2;
+    Universe::initialize();
+    printSuccess("Universe initialized");
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    if (!testDump(holder, 200, 2000)) {
+        return 1;
+    }
+
+    if (!testSignal(holder, 200)) {
+        return 1;
+    }
+
+    Universe::destroy();
+    printSuccess("All Heap Dump tests completed!");
+    return 0;
+}
@@ -0,0 +1,250 @@
+//
+// Test for KiVM heap page options
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/markCompactHeap.h>
+#include <kivm/memory/copyingHeap.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <shared/mmap.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr}) {
+    }
+
+    oop &getRoot() {
+        return _args.front();
+    }
+};
+
+// Count pages of [start, start + size) that are backed by memory
+static size_t countResidentPages(void *start, size_t size) {
+    size_t pageSize = Universe::getPageSize();
+    std::vector<unsigned char> residency(size / pageSize);
+    if (mincore(start, size, residency.data()) != 0) {
+        return 0;
+    }
+
+    size_t resident = 0;
+    for (auto page : residency) {
+        resident += page & 1;
+    }
+    return resident;
+}
+
+// VmFlags of the mapping containing start, from /proc/self/smaps
+static std::string findVmFlags(void *start) {
+    std::ifstream in("/proc/self/smaps");
+    std::string line;
+    bool inMapping = false;
+    while (std::getline(in, line)) {
+        unsigned long first = 0;
+        unsigned long last = 0;
+        if (sscanf(line.c_str(), "%lx-%lx ", &first, &last) == 2) {
+            inMapping = (unsigned long) start >= first && (unsigned long) start < last;
+        } else if (inMapping && line.compare(0, 8, "VmFlags:") == 0) {
+            return line;
+        }
+    }
+    return "";
+}
+
+// Policy of the mapping starting at start, from /proc/self/numa_maps
+static std::string findNumaPolicy(void *start) {
+    std::ifstream in("/proc/self/numa_maps");
+    unsigned long address = 0;
+    std::string policy;
+    std::string rest;
+    while (in >> std::hex >> address >> policy && std::getline(in, rest)) {
+        if (address == (unsigned long) start) {
+            return policy;
+        }
+    }
+    return "";
+}
+
+// A number from /proc/meminfo
+static long readMemInfo(const std::string &key) {
+    std::ifstream in("/proc/meminfo");
+    std::string name;
+    long value = 0;
+    std::string rest;
+    while (in >> name >> value && std::getline(in, rest)) {
+        if (name == key) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+bool testPreTouchedTransparentHeap(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Pre-touched Heap with Transparent Huge Pages ===" << std::endl;
+
+    const int CHUNK_COUNT = 48;
+    const int CHUNK_SIZE = 1024 * 1024;
+
+    RuntimeConfig::get().heapType = HEAP_MARK_COMPACT;
+    RuntimeConfig::get().heapPageType = HEAP_PAGES_TRANSPARENT;
+    RuntimeConfig::get().heapPreTouch = true;
+    RuntimeConfig::get().heapNumaPolicy = HEAP_NUMA_INTERLEAVE;
+    Universe::initialize();
+
+    auto heap = (MarkCompactHeap *) Universe::getCollectedHeap();
+    auto start = (jbyte *) heap->getHeapStart();
+    if ((uintptr_t) start % Universe::getLargePageSize() != 0) {
+        printError("Heap does not start at a large page boundary");
+        return false;
+    }
+
+    size_t pageSize = Universe::getPageSize();
+    size_t committed = heap->getHeapSize();
+    if (countResidentPages(start, committed) != committed / pageSize) {
+        printError("Committed heap was not pre-touched");
+        return false;
+    }
+    printSuccess("All " + std::to_string(committed >> 20) + " MB of the initial heap are resident");
+
+    std::string flags = findVmFlags(start);
+    if (flags.empty()) {
+        printInfo("  /proc/self/smaps is not available, skipping madvise check");
+    } else if (flags.find(" hg") == std::string::npos) {
+        printError("Heap is not advised to use huge pages: " + flags);
+        return false;
+    } else {
+        printSuccess("Heap is advised to use transparent huge pages");
+    }
+
+    // a failed mbind() is only warned about, e.g. in containers
+    std::string policy = findNumaPolicy(start);
+    printInfo("  NUMA policy: " + (policy.empty() ? std::string("unknown") : policy));
+
+    // grown pages are pre-touched too, and must keep the objects
+    auto rootClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::BYTE);
+    auto chunkClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::BYTE);
+    holder->getRoot() = rootClass->newInstance(CHUNK_COUNT);
+    for (int i = 0; i < CHUNK_COUNT; ++i) {
+        auto chunk = chunkClass->newInstance(CHUNK_SIZE);
+        *chunk->getElementAddress<jbyte>(CHUNK_SIZE - 1) = (jbyte) i;
+        ((arrayOop) holder->getRoot())->setElementAt(i, chunk);
+        if ((i + 1) % 4 == 0) {
+            heap->doGarbageCollection();
+        }
+    }
+
+    committed = heap->getHeapSize();
+    if (countResidentPages(start, committed) != committed / pageSize) {
+        printError("Grown heap was not pre-touched");
+        return false;
+    }
+    auto roots = (arrayOop) holder->getRoot();
+    for (int i = 0; i < CHUNK_COUNT; ++i) {
+        auto chunk = (arrayOop) roots->getElementAt(i);
+        if (chunk == nullptr || *chunk->getElementAddress<jbyte>(CHUNK_SIZE - 1) != (jbyte) i) {
+            printError("Wrong chunk at index " + std::to_string(i));
+            return false;
+        }
+    }
+    printSuccess("Heap grew to " + std::to_string(committed >> 20) + " MB, all of it resident and intact");
+
+    holder->getRoot() = nullptr;
+    Universe::destroy();
+    return true;
+}
+
+bool testHugeTLBHeap(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Heap with hugetlb Pages ===" << std::endl;
+
+    const int ARRAY_COUNT = 20000;
+
+    RuntimeConfig::get().heapType = HEAP_COPYING;
+    RuntimeConfig::get().heapPageType = HEAP_PAGES_HUGETLB;
+    RuntimeConfig::get().heapPreTouch = false;
+    RuntimeConfig::get().heapNumaPolicy = HEAP_NUMA_BIND;
+    RuntimeConfig::get().heapNumaNode = 0;
+    // falls back to default pages if no hugetlb pages are configured
+    Universe::initialize();
+
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto holderClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    holder->getRoot() = holderClass->newInstance(ARRAY_COUNT);
+    for (int i = 0; i < ARRAY_COUNT; ++i) {
+        auto array = arrayClass->newInstance(16);
+        *array->getElementAddress<jint>(15) = i;
+        ((arrayOop) holder->getRoot())->setElementAt(i, array);
+        arrayClass->newInstance(64);
+        if ((i + 1) % 2000 == 0) {
+            heap->doMinorCollection();
+        }
+    }
+    heap->doFullCollection();
+
+    auto roots = (arrayOop) holder->getRoot();
+    for (int i = 0; i < ARRAY_COUNT; ++i) {
+        auto array = (arrayOop) roots->getElementAt(i);
+        if (array == nullptr || *array->getElementAddress<jint>(15) != i) {
+            printError("Wrong array at index " + std::to_string(i));
+            return false;
+        }
+    }
+    long poolSize = readMemInfo("HugePages_Total:");
+    long poolFree = readMemInfo("HugePages_Free:");
+    if (poolSize == 0) {
+        printSuccess("Copying heap works with default pages when no hugetlb pages are configured");
+    } else if (poolFree < poolSize) {
+        printSuccess("Copying heap works with " + std::to_string(poolSize - poolFree) + " hugetlb pages");
+    } else {
+        printError("Heap took no pages from the hugetlb pool");
+        return false;
+    }
+
+    holder->getRoot() = nullptr;
+    Universe::destroy();
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Heap Pages Test ===" << std::endl;
+
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(16L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(128L);
+    RuntimeConfig::get().gcWorkerThreads = 2;
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    if (!testPreTouchedTransparentHeap(holder)) {
+        return 1;
+    }
+
+    if (!testHugeTLBHeap(holder)) {
+        return 1;
+    }
+
+    printSuccess("All Heap Pages tests completed!");
+    return 0;
+}
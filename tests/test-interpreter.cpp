@@ -0,0 +1,1206 @@
+//
+// Test for KiVM interpreters: calls, returns, the operand stack, quickening
+// and superinstructions
+//
+
+#include <compileTimeConfig.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/bytecode/bytecodeProfile.h>
+#include <kivm/bytecode/decodedCode.h>
+#include <kivm/bytecode/directThreadedInterpreter.h>
+#include <kivm/bytecode/execution.h>
+#include <kivm/bytecode/superinstructions.h>
+#include <kivm/bytecode/interpreter.h>
+#include <kivm/bytecode/javaCall.h>
+#include <kivm/classfile/classFile.h>
+#include <kivm/classpath/classLoader.h>
+#include <kivm/classpath/classPathManager.h>
+#include <kivm/memory/gcEvent.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/memory/universe.h>
+#include <kivm/native/java_lang_String.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/method.h>
+#include <kivm/oop/primitiveOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <sys/stat.h>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+class TestThread : public JavaThread {
+public:
+    TestThread()
+        : JavaThread(nullptr, {nullptr}) {
+    }
+
+    oop &getRoot() {
+        return _args.front();
+    }
+};
+
+// Class files are assembled by hand, there is no javac here
+class ClassWriter {
+private:
+    std::vector<u1> _bytes;
+
+public:
+    void writeU1(int v) {
+        _bytes.push_back((u1) v);
+    }
+
+    void writeU2(int v) {
+        writeU1(v >> 8);
+        writeU1(v);
+    }
+
+    void writeU4(int v) {
+        writeU2(v >> 16);
+        writeU2(v);
+    }
+
+    void writeBytes(const std::vector<u1> &b) {
+        _bytes.insert(_bytes.end(), b.begin(), b.end());
+    }
+
+    std::vector<u1> &get() {
+        return _bytes;
+    }
+};
+
+struct TestMethod {
+    std::string name;
+    std::string descriptor;
+    int maxStack;
+    int maxLocals;
+    std::vector<u1> code;
+};
+
+// A public class with public members, constants are added on demand
+class TestClass {
+private:
+    std::string _name;
+    std::string _superName;
+    ClassWriter _pool;
+    int _poolCount = 1;
+    std::map<std::string, int> _entries;
+    std::vector<TestMethod> _methods;
+    std::vector<int> _methodAccess;
+    std::vector<int> _methodHandlers;
+    std::vector<std::pair<std::string, std::string>> _staticFields;
+    std::vector<std::pair<std::string, std::string>> _instanceFields;
+
+    int utf8(const std::string &s) {
+        auto iter = _entries.find("U" + s);
+        if (iter != _entries.end()) {
+            return iter->second;
+        }
+        _pool.writeU1(CONSTANT_Utf8);
+        _pool.writeU2((int) s.size());
+        for (char c : s) {
+            _pool.writeU1(c);
+        }
+        return _entries["U" + s] = _poolCount++;
+    }
+
+public:
+    explicit TestClass(std::string name, std::string superName = "java/lang/Object")
+        : _name(std::move(name)), _superName(std::move(superName)) {
+    }
+
+    int classRef(const std::string &name) {
+        int nameIndex = utf8(name);
+        auto iter = _entries.find("C" + name);
+        if (iter != _entries.end()) {
+            return iter->second;
+        }
+        _pool.writeU1(CONSTANT_Class);
+        _pool.writeU2(nameIndex);
+        return _entries["C" + name] = _poolCount++;
+    }
+
+    int memberRef(int tag, const std::string &className,
+                  const std::string &name, const std::string &descriptor) {
+        int classIndex = classRef(className);
+        int nameIndex = utf8(name);
+        int descriptorIndex = utf8(descriptor);
+        _pool.writeU1(CONSTANT_NameAndType);
+        _pool.writeU2(nameIndex);
+        _pool.writeU2(descriptorIndex);
+        int nameAndType = _poolCount++;
+        _pool.writeU1(tag);
+        _pool.writeU2(classIndex);
+        _pool.writeU2(nameAndType);
+        return _poolCount++;
+    }
+
+    // a method of this class, to be called by invokestatic
+    int methodRef(const std::string &name, const std::string &descriptor) {
+        return memberRef(CONSTANT_Methodref, _name, name, descriptor);
+    }
+
+    int methodRef(const std::string &className, const std::string &name, const std::string &descriptor) {
+        return memberRef(CONSTANT_Methodref, className, name, descriptor);
+    }
+
+    // a static field of this class
+    int fieldRef(const std::string &name, const std::string &descriptor) {
+        _staticFields.emplace_back(name, descriptor);
+        return memberRef(CONSTANT_Fieldref, _name, name, descriptor);
+    }
+
+    int fieldRef(const std::string &className, const std::string &name, const std::string &descriptor) {
+        return memberRef(CONSTANT_Fieldref, className, name, descriptor);
+    }
+
+    int stringConstant(const std::string &value) {
+        int valueIndex = utf8(value);
+        _pool.writeU1(CONSTANT_String);
+        _pool.writeU2(valueIndex);
+        return _poolCount++;
+    }
+
+    int intConstant(int value) {
+        _pool.writeU1(CONSTANT_Integer);
+        _pool.writeU4(value);
+        return _poolCount++;
+    }
+
+    void addInstanceField(const std::string &name, const std::string &descriptor) {
+        _instanceFields.emplace_back(name, descriptor);
+    }
+
+    void addMethod(const TestMethod &method) {
+        addMethod(method, -1);
+    }
+
+    // the handler at {@code handler} catches everything thrown before it
+    void addMethod(const TestMethod &method, int handler) {
+        _methods.push_back(method);
+        _methodAccess.push_back(ACC_PUBLIC | ACC_STATIC);
+        _methodHandlers.push_back(handler);
+    }
+
+    void addInstanceMethod(const TestMethod &method) {
+        _methods.push_back(method);
+        _methodAccess.push_back(ACC_PUBLIC);
+        _methodHandlers.push_back(-1);
+    }
+
+    std::vector<u1> build() {
+        int thisClass = classRef(_name);
+        int superClass = _name == "java/lang/Object" ? 0 : classRef(_superName);
+        int codeName = utf8("Code");
+        std::vector<std::pair<int, int>> fields;
+        for (const auto &f : _staticFields) {
+            fields.emplace_back(utf8(f.first), utf8(f.second));
+        }
+        for (const auto &f : _instanceFields) {
+            fields.emplace_back(utf8(f.first), utf8(f.second));
+        }
+        std::vector<std::pair<int, int>> signatures;
+        for (const auto &m : _methods) {
+            signatures.emplace_back(utf8(m.name), utf8(m.descriptor));
+        }
+
+        ClassWriter w;
+        w.writeU4((int) 0xCAFEBABE);
+        w.writeU2(0);
+        w.writeU2(49); // no StackMapTable needed
+        w.writeU2(_poolCount);
+        w.writeBytes(_pool.get());
+
+        w.writeU2(ACC_PUBLIC);
+        w.writeU2(thisClass);
+        w.writeU2(superClass);
+        w.writeU2(0); // interfaces
+
+        w.writeU2((int) fields.size());
+        for (size_t i = 0; i < fields.size(); ++i) {
+            const auto &f = fields[i];
+            w.writeU2(i < _staticFields.size() ? ACC_PUBLIC | ACC_STATIC : ACC_PUBLIC);
+            w.writeU2(f.first);
+            w.writeU2(f.second);
+            w.writeU2(0);
+        }
+
+        w.writeU2((int) _methods.size());
+        for (size_t i = 0; i < _methods.size(); ++i) {
+            const auto &m = _methods[i];
+            w.writeU2(_methodAccess[i]);
+            w.writeU2(signatures[i].first);
+            w.writeU2(signatures[i].second);
+            w.writeU2(1);
+            w.writeU2(codeName);
+            int handler = _methodHandlers[i];
+            int handlers = handler < 0 ? 0 : 1;
+            w.writeU4(12 + (int) m.code.size() + 8 * handlers);
+            w.writeU2(m.maxStack);
+            w.writeU2(m.maxLocals);
+            w.writeU4((int) m.code.size());
+            w.writeBytes(m.code);
+            w.writeU2(handlers);
+            if (handlers != 0) {
+                w.writeU2(0);
+                w.writeU2(handler);
+                w.writeU2(handler);
+                w.writeU2(0); // any
+            }
+            w.writeU2(0); // attributes
+        }
+        w.writeU2(0); // attributes
+        return w.get();
+    }
+};
+
+static std::string classPathDir;
+
+static InstanceKlass *loadClass(const std::string &name, TestClass &testClass) {
+    std::string path = classPathDir;
+    size_t begin = 0;
+    size_t slash;
+    while ((slash = name.find('/', begin)) != std::string::npos) {
+        path += "/" + name.substr(begin, slash - begin);
+        mkdir(path.c_str(), 0755);
+        begin = slash + 1;
+    }
+
+    const auto &bytes = testClass.build();
+    std::ofstream out(classPathDir + "/" + name + ".class", std::ios::binary);
+    out.write((const char *) bytes.data(), bytes.size());
+    out.close();
+    return (InstanceKlass *) BootstrapClassLoader::get()->loadClass(strings::fromStdString(name));
+}
+
+static InstanceKlass *calcClass;
+static InstanceKlass *pointClass;
+static InstanceKlass *subClass;
+
+static bool loadCalcClass() {
+    char dirTemplate[] = "/tmp/kivm-interpreter-XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr) {
+        printError("Cannot create class path");
+        return false;
+    }
+    classPathDir = dirTemplate;
+    ClassPathManager::get()->addClassPath(strings::fromStdString(classPathDir));
+
+    TestClass object("java/lang/Object");
+    loadClass("java/lang/Object", object);
+
+    // class Point { int x; double d; Object o; int get() { return x; } }
+    TestClass point("Point");
+    point.addInstanceField("x", "I");
+    point.addInstanceField("d", "D");
+    point.addInstanceField("o", "Ljava/lang/Object;");
+    int pointX = point.fieldRef("Point", "x", "I");
+    point.addInstanceMethod({"get", "()I", 1, 1, {
+        OPC_ALOAD_0, OPC_GETFIELD, 0, (u1) pointX, OPC_IRETURN,
+    }});
+    pointClass = loadClass("Point", point);
+
+    // class Sub extends Point { int get() { return x + 100; } }
+    TestClass sub("Sub", "Point");
+    int subX = sub.fieldRef("Point", "x", "I");
+    sub.addInstanceMethod({"get", "()I", 2, 1, {
+        OPC_ALOAD_0, OPC_GETFIELD, 0, (u1) subX, OPC_BIPUSH, 100, OPC_IADD, OPC_IRETURN,
+    }});
+    subClass = loadClass("Sub", sub);
+
+    TestClass calc("Calc");
+    int add = calc.methodRef("add", "(II)I");
+    int half = calc.methodRef("half", "(F)F");
+    int lmul = calc.methodRef("lmul", "(JJ)J");
+    int dadd = calc.methodRef("dadd", "(DD)D");
+    int id = calc.methodRef("id", "(Ljava/lang/Object;)Ljava/lang/Object;");
+
+    calc.addMethod({"add", "(II)I", 2, 2, {
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_IADD, OPC_IRETURN,
+    }});
+
+    // int s = 0; for (int i = 0; i < n; i++) s = add(s, i); return s;
+    calc.addMethod({"sum", "(I)I", 2, 3, {
+        OPC_ICONST_0,                               // 0
+        OPC_ISTORE_1,                               // 1
+        OPC_ICONST_0,                               // 2
+        OPC_ISTORE_2,                               // 3
+        OPC_ILOAD_2,                                // 4
+        OPC_ILOAD_0,                                // 5
+        OPC_IF_ICMPGE, 0, 15,                       // 6 -> 21
+        OPC_ILOAD_1,                                // 9
+        OPC_ILOAD_2,                                // 10
+        OPC_INVOKESTATIC, 0, (u1) add,              // 11
+        OPC_ISTORE_1,                               // 14
+        OPC_IINC, 2, 1,                             // 15
+        OPC_GOTO, 0xff, 0xf2,                       // 18 -> 4
+        OPC_ILOAD_1,                                // 21
+        OPC_IRETURN,                                // 22
+    }});
+
+    // ((b - a) * 2) * 7, shuffling values through the stack
+    calc.addMethod({"shuffle", "(II)I", 2, 2, {
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_SWAP, OPC_ISUB,
+        OPC_DUP, OPC_IADD,
+        OPC_ILOAD_0, OPC_POP,
+        OPC_BIPUSH, 7, OPC_IMUL,
+        OPC_IRETURN,
+    }});
+
+    // a + b + a + b
+    calc.addMethod({"dup2", "(II)I", 4, 2, {
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_DUP2, OPC_IADD, OPC_IADD, OPC_IADD,
+        OPC_IRETURN,
+    }});
+
+    // a + a
+    calc.addMethod({"twice", "(J)J", 4, 2, {
+        OPC_LLOAD_0, OPC_DUP2, OPC_LADD, OPC_LRETURN,
+    }});
+
+    calc.addMethod({"half", "(F)F", 2, 1, {
+        OPC_FLOAD_0, OPC_FCONST_2, OPC_FDIV, OPC_FRETURN,
+    }});
+
+    calc.addMethod({"lmul", "(JJ)J", 4, 4, {
+        OPC_LLOAD_0, OPC_LLOAD_2, OPC_LMUL, OPC_LRETURN,
+    }});
+
+    calc.addMethod({"dadd", "(DD)D", 4, 4, {
+        OPC_DLOAD_0, OPC_DLOAD_2, OPC_DADD, OPC_DRETURN,
+    }});
+
+    // half(n) + n * n, with values of every kind returned from calls
+    calc.addMethod({"mix", "(I)D", 6, 1, {
+        OPC_ILOAD_0, OPC_I2F,
+        OPC_INVOKESTATIC, 0, (u1) half,
+        OPC_F2D,
+        OPC_ILOAD_0, OPC_I2L, OPC_ILOAD_0, OPC_I2L,
+        OPC_INVOKESTATIC, 0, (u1) lmul,
+        OPC_L2D,
+        OPC_INVOKESTATIC, 0, (u1) dadd,
+        OPC_DRETURN,
+    }});
+
+    calc.addMethod({"id", "(Ljava/lang/Object;)Ljava/lang/Object;", 1, 1, {
+        OPC_ALOAD_0, OPC_ARETURN,
+    }});
+
+    // id(b), after a detour of a through the stack
+    calc.addMethod({"second", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;", 2, 2, {
+        OPC_ALOAD_0, OPC_ALOAD_1, OPC_SWAP, OPC_POP,
+        OPC_INVOKESTATIC, 0, (u1) id,
+        OPC_ARETURN,
+    }});
+
+    // for (int i = 0; i < n; i++) { sink = id(new Calc()); }, and a stays
+    // on the stack while objects are allocated, the collector must move it
+    int calcRef = calc.classRef("Calc");
+    int sink = calc.fieldRef("sink", "Ljava/lang/Object;");
+    calc.addMethod({"churn", "(Ljava/lang/Object;I)Ljava/lang/Object;", 2, 3, {
+        OPC_ICONST_0,                               // 0
+        OPC_ISTORE_2,                               // 1
+        OPC_ILOAD_2,                                // 2
+        OPC_ILOAD_1,                                // 3
+        OPC_IF_ICMPGE, 0, 20,                       // 4 -> 24
+        OPC_ALOAD_0,                                // 7
+        OPC_NEW, 0, (u1) calcRef,                   // 8
+        OPC_INVOKESTATIC, 0, (u1) id,               // 11
+        OPC_PUTSTATIC, 0, (u1) sink,                // 14
+        OPC_ASTORE_0,                               // 17
+        OPC_IINC, 2, 1,                             // 18
+        OPC_GOTO, 0xff, 0xed,                       // 21 -> 2
+        OPC_ALOAD_0,                                // 24
+        OPC_ARETURN,                                // 25
+    }});
+
+    // p.x++; return p.get();
+    int x = calc.fieldRef("Point", "x", "I");
+    int get = calc.methodRef("Point", "get", "()I");
+    calc.addMethod({"bump", "(LPoint;)I", 3, 1, {
+        OPC_ALOAD_0,                                // 0
+        OPC_ALOAD_0,                                // 1
+        OPC_GETFIELD, 0, (u1) x,                    // 2
+        OPC_ICONST_1,                               // 5
+        OPC_IADD,                                   // 6
+        OPC_PUTFIELD, 0, (u1) x,                    // 7
+        OPC_ALOAD_0,                                // 10
+        OPC_INVOKEVIRTUAL, 0, (u1) get,             // 11
+        OPC_IRETURN,                                // 14
+    }});
+
+    // p.d += 1; return p.d;
+    int d = calc.fieldRef("Point", "d", "D");
+    calc.addMethod({"bumpD", "(LPoint;)D", 5, 1, {
+        OPC_ALOAD_0,                                // 0
+        OPC_ALOAD_0,                                // 1
+        OPC_GETFIELD, 0, (u1) d,                    // 2
+        OPC_DCONST_1,                               // 5
+        OPC_DADD,                                   // 6
+        OPC_PUTFIELD, 0, (u1) d,                    // 7
+        OPC_ALOAD_0,                                // 10
+        OPC_GETFIELD, 0, (u1) d,                    // 11
+        OPC_DRETURN,                                // 14
+    }});
+
+    // Object old = p.o; p.o = v; return old;
+    int o = calc.fieldRef("Point", "o", "Ljava/lang/Object;");
+    calc.addMethod({"swapObject", "(LPoint;Ljava/lang/Object;)Ljava/lang/Object;", 3, 2, {
+        OPC_ALOAD_0,                                // 0
+        OPC_GETFIELD, 0, (u1) o,                    // 1
+        OPC_ALOAD_0,                                // 4
+        OPC_ALOAD_1,                                // 5
+        OPC_PUTFIELD, 0, (u1) o,                    // 6
+        OPC_ARETURN,                                // 9
+    }});
+
+    int answer = calc.intConstant(42);
+    calc.addMethod({"answer", "()I", 1, 0, {
+        OPC_LDC, (u1) answer, OPC_IRETURN,
+    }});
+
+    // int s = 0; for (int i = 0; ; i++) { int t = s + i; if (i >= n) return t; s = t; }
+    calc.addMethod({"sumTo", "(I)I", 2, 3, {
+        OPC_ICONST_0,                               // 0
+        OPC_ICONST_0,                               // 1
+        OPC_ISTORE_1,                               // 2
+        OPC_ILOAD, 1,                               // 3
+        OPC_IADD,                                   // 5
+        OPC_ISTORE_2,                               // 6
+        OPC_ILOAD, 1,                               // 7
+        OPC_ILOAD, 0,                               // 9
+        OPC_IF_ICMPGE, 0, 11,                       // 11 -> 22
+        OPC_ILOAD, 2,                               // 14
+        OPC_IINC, 1, 1,                             // 16
+        OPC_GOTO, 0xff, 0xf0,                       // 19 -> 3
+        OPC_ILOAD, 2,                               // 22
+        OPC_IRETURN,                                // 24
+    }});
+
+    // return a[i];
+    calc.addMethod({"at", "([II)I", 2, 2, {
+        OPC_ALOAD, 0,                               // 0
+        OPC_ILOAD, 1,                               // 2
+        OPC_IALOAD,                                 // 4
+        OPC_IRETURN,                                // 5
+    }});
+
+    // switch (n) { case 0: return 10; case 1: return 20; default: return -1; }
+    calc.addMethod({"pick", "(I)I", 1, 1, {
+        OPC_ILOAD_0,                                // 0
+        OPC_TABLESWITCH, 0, 0,                      // 1
+        0, 0, 0, 29,                                // 4, default -> 30
+        0, 0, 0, 0,                                 // 8, low
+        0, 0, 0, 1,                                 // 12, high
+        0, 0, 0, 23,                                // 16, 0 -> 24
+        0, 0, 0, 26,                                // 20, 1 -> 27
+        OPC_BIPUSH, 10,                             // 24
+        OPC_IRETURN,                                // 26
+        OPC_BIPUSH, 20,                             // 27
+        OPC_IRETURN,                                // 29
+        OPC_ICONST_M1,                              // 30
+        OPC_IRETURN,                                // 31
+    }});
+
+    // switch (n) { case -5: return 1; case 100: return 2; case 1000: return 3; default: return 0; }
+    calc.addMethod({"lookup", "(I)I", 1, 1, {
+        OPC_ILOAD_0,                                // 0
+        OPC_LOOKUPSWITCH, 0, 0,                     // 1
+        0, 0, 0, 43,                                // 4, default -> 44
+        0, 0, 0, 3,                                 // 8, pairs
+        0xff, 0xff, 0xff, 0xfb, 0, 0, 0, 35,        // 12, -5 -> 36
+        0, 0, 0, 100, 0, 0, 0, 37,                  // 20, 100 -> 38
+        0, 0, 0x03, 0xe8, 0, 0, 0, 39,              // 28, 1000 -> 40
+        OPC_ICONST_1,                               // 36
+        OPC_IRETURN,                                // 37
+        OPC_ICONST_2,                               // 38
+        OPC_IRETURN,                                // 39
+        OPC_ICONST_3,                               // 40
+        OPC_IRETURN,                                // 41
+        OPC_NOP,                                    // 42
+        OPC_NOP,                                    // 43
+        OPC_ICONST_0,                               // 44
+        OPC_IRETURN,                                // 45
+    }});
+
+    // ((a / b + a % b) << 3) - (a > b ? 1 : a < b ? -1 : 0)
+    calc.addMethod({"lmath", "(JJ)J", 6, 4, {
+        OPC_LLOAD_0, OPC_LLOAD_2, OPC_LDIV,
+        OPC_LLOAD_0, OPC_LLOAD_2, OPC_LREM,
+        OPC_LADD, OPC_ICONST_3, OPC_LSHL,
+        OPC_LLOAD_0, OPC_LLOAD_2, OPC_LCMP, OPC_I2L,
+        OPC_LSUB, OPC_LRETURN,
+    }});
+
+    // a[1] = -n; return a[1] + a.length;
+    calc.addMethod({"fill", "([JI)J", 4, 2, {
+        OPC_ALOAD_0, OPC_ICONST_1, OPC_ILOAD_1, OPC_I2L, OPC_LNEG, OPC_LASTORE,
+        OPC_ALOAD_0, OPC_ICONST_1, OPC_LALOAD,
+        OPC_ALOAD_0, OPC_ARRAYLENGTH, OPC_I2L,
+        OPC_LADD, OPC_LRETURN,
+    }});
+
+    // a / b + a % b
+    calc.addMethod({"div", "(II)I", 4, 2, {
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_IDIV,
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_IREM,
+        OPC_IADD, OPC_IRETURN,
+    }});
+
+    // b * (a - b)
+    calc.addMethod({"dups", "(II)I", 3, 2, {
+        OPC_ILOAD_0, OPC_ILOAD_1, OPC_DUP_X1, OPC_ISUB, OPC_IMUL, OPC_IRETURN,
+    }});
+
+    calcClass = loadClass("Calc", calc);
+    if (calcClass == nullptr || pointClass == nullptr || subClass == nullptr) {
+        printError("Cannot load test classes");
+        return false;
+    }
+    printSuccess("Test classes loaded");
+    return true;
+}
+
+static oop call(JavaThread *thread, const std::string &name, const std::string &descriptor,
+                const std::list<oop> &args) {
+    auto method = calcClass->getStaticMethod(strings::fromStdString(name),
+        strings::fromStdString(descriptor));
+    if (method == nullptr) {
+        printError("No method " + name);
+        return nullptr;
+    }
+    return JavaCall::withArgs(thread, method, args);
+}
+
+static size_t countPrimitiveOops() {
+    size_t count = 0;
+    Universe::getCollectedHeap()->objectIterate([&](oop object) {
+        if (object->getMarkOop()->getOopType() == oopType::PRIMITIVE_OOP) {
+            ++count;
+        }
+    });
+    return count;
+}
+
+bool testPrimitiveReturns(JavaThread *thread) {
+    std::cout << "\n=== Testing primitive returns ===" << std::endl;
+
+    auto result = call(thread, "add", "(II)I", {new intOopDesc(40), new intOopDesc(2)});
+    if (result == nullptr || ((intOop) result)->getValue() != 42) {
+        printError("add(40, 2) should be 42");
+        return false;
+    }
+
+    result = call(thread, "twice", "(J)J", {new longOopDesc(1L << 40)});
+    if (result == nullptr || ((longOop) result)->getValue() != (1L << 41)) {
+        printError("twice(2^40) should be 2^41");
+        return false;
+    }
+
+    result = call(thread, "mix", "(I)D", {new intOopDesc(6)});
+    if (result == nullptr || ((doubleOop) result)->getValue() != 39.0) {
+        printError("mix(6) should be 39.0");
+        return false;
+    }
+    printSuccess("Returned ints, longs, floats and doubles");
+
+    size_t before = countPrimitiveOops();
+    result = call(thread, "sum", "(I)I", {new intOopDesc(10000)});
+    if (result == nullptr || ((intOop) result)->getValue() != 49995000) {
+        printError("sum(10000) should be 49995000");
+        return false;
+    }
+
+    // only the argument and the result of the outermost call are boxed
+    size_t boxed = countPrimitiveOops() - before;
+    if (boxed > 2) {
+        printError("Returns into the interpreter allocated " + std::to_string(boxed) + " boxes");
+        return false;
+    }
+    printSuccess("Returns into the interpreter allocate nothing");
+    return true;
+}
+
+bool testOperandStack(JavaThread *thread) {
+    std::cout << "\n=== Testing operand stack ===" << std::endl;
+
+    auto result = call(thread, "shuffle", "(II)I", {new intOopDesc(3), new intOopDesc(10)});
+    if (result == nullptr || ((intOop) result)->getValue() != 98) {
+        printError("shuffle(3, 10) should be 98");
+        return false;
+    }
+
+    result = call(thread, "dup2", "(II)I", {new intOopDesc(5), new intOopDesc(8)});
+    if (result == nullptr || ((intOop) result)->getValue() != 26) {
+        printError("dup2(5, 8) should be 26");
+        return false;
+    }
+    printSuccess("Swapped, duplicated and dropped values");
+
+    auto a = calcClass->newInstance();
+    auto b = calcClass->newInstance();
+    result = call(thread, "second", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;", {a, b});
+    if (result != b) {
+        printError("second(a, b) should be b");
+        return false;
+    }
+    printSuccess("Returned references");
+    return true;
+}
+
+static bool expectOpcodes(const std::string &name, const std::string &descriptor,
+                          const std::map<int, int> &opcodes) {
+    auto method = calcClass->getStaticMethod(strings::fromStdString(name),
+        strings::fromStdString(descriptor));
+    for (const auto &e : opcodes) {
+        int rewritten = method->getRewrittenCode()[e.first];
+        if (rewritten != e.second) {
+            printError(name + ": opcode at " + std::to_string(e.first) + " is "
+                       + std::to_string(rewritten) + ", not " + std::to_string(e.second));
+            return false;
+        }
+        if (method->getCodeBlob()[e.first] == rewritten) {
+            printError(name + ": the class file was rewritten");
+            return false;
+        }
+    }
+    return true;
+}
+
+static jint callInt(JavaThread *thread, const std::string &name, const std::string &descriptor,
+                    const std::list<oop> &args) {
+    auto result = call(thread, name, descriptor, args);
+    return result == nullptr ? -1 : ((intOop) result)->getValue();
+}
+
+bool testQuickening(JavaThread *thread) {
+    std::cout << "\n=== Testing quickening ===" << std::endl;
+
+    auto p = pointClass->newInstance();
+    if (callInt(thread, "bump", "(LPoint;)I", {p}) != 1
+        || callInt(thread, "bump", "(LPoint;)I", {p}) != 2) {
+        printError("bump(p) should count from 1");
+        return false;
+    }
+    if (!expectOpcodes("bump", "(LPoint;)I", {
+        {2, OPC_FAST_IGETFIELD}, {7, OPC_FAST_IPUTFIELD}, {11, OPC_FAST_INVOKEVIRTUAL}})) {
+        return false;
+    }
+
+    // the quickened call site still dispatches on the receiver
+    auto s = subClass->newInstance();
+    if (callInt(thread, "bump", "(LPoint;)I", {s}) != 101) {
+        printError("bump(s) should call Sub.get()");
+        return false;
+    }
+    printSuccess("Quickened int fields and virtual calls");
+
+    auto result = call(thread, "bumpD", "(LPoint;)D", {p});
+    result = call(thread, "bumpD", "(LPoint;)D", {p});
+    if (result == nullptr || ((doubleOop) result)->getValue() != 2.0) {
+        printError("bumpD(p) should count from 1.0");
+        return false;
+    }
+    if (!expectOpcodes("bumpD", "(LPoint;)D", {
+        {2, OPC_FAST_DGETFIELD}, {7, OPC_FAST_DPUTFIELD}, {11, OPC_FAST_DGETFIELD}})) {
+        return false;
+    }
+
+    auto a = calcClass->newInstance();
+    auto b = calcClass->newInstance();
+    const std::string swapDescriptor = "(LPoint;Ljava/lang/Object;)Ljava/lang/Object;";
+    if (call(thread, "swapObject", swapDescriptor, {p, a}) != nullptr
+        || call(thread, "swapObject", swapDescriptor, {p, b}) != a
+        || call(thread, "swapObject", swapDescriptor, {p, nullptr}) != b) {
+        printError("swapObject(p, v) should return the previous value");
+        return false;
+    }
+    if (!expectOpcodes("swapObject", swapDescriptor, {
+        {1, OPC_FAST_AGETFIELD}, {6, OPC_FAST_APUTFIELD}})) {
+        return false;
+    }
+    printSuccess("Quickened double and reference fields");
+
+    if (callInt(thread, "answer", "()I", {}) != 42
+        || callInt(thread, "answer", "()I", {}) != 42
+        || !expectOpcodes("answer", "()I", {{0, OPC_FAST_LDC}})) {
+        printError("answer() should be 42");
+        return false;
+    }
+
+    call(thread, "churn", "(Ljava/lang/Object;I)Ljava/lang/Object;", {a, new intOopDesc(2)});
+    if (!expectOpcodes("sum", "(I)I", {{11, OPC_FAST_INVOKEDIRECT}})
+        || !expectOpcodes("churn", "(Ljava/lang/Object;I)Ljava/lang/Object;", {
+            {8, OPC_FAST_NEW}, {11, OPC_FAST_INVOKEDIRECT}, {14, OPC_FAST_PUTSTATIC}})) {
+        return false;
+    }
+    printSuccess("Quickened constants, allocations, static fields and static calls");
+    return true;
+}
+
+bool testSuperinstructions(JavaThread *thread) {
+    std::cout << "\n=== Testing superinstructions ===" << std::endl;
+
+    u4 set = 0;
+    if (!Superinstructions::parse("iload_iinc_goto,aload_0_getfield", &set) || set != 0x5
+        || !Superinstructions::parse("none", &set) || set != 0
+        || !Superinstructions::parse("all", &set) || set != 0xf
+        || Superinstructions::parse("iload_iload", &set)) {
+        printError("Superinstruction names are not parsed");
+        return false;
+    }
+
+    if (callInt(thread, "sumTo", "(I)I", {new intOopDesc(10)}) != 55
+        || callInt(thread, "sumTo", "(I)I", {new intOopDesc(0)}) != 0) {
+        printError("sumTo(n) should be n * (n + 1) / 2");
+        return false;
+    }
+    if (!expectOpcodes("sumTo", "(I)I", {
+        {7, OPC_ILOAD_ILOAD_IF_ICMPGE}, {14, OPC_ILOAD_IINC_GOTO}})) {
+        return false;
+    }
+    printSuccess("Fused loops");
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto array = arrayClass->newInstance(3);
+    for (int i = 0; i < 3; ++i) {
+        *array->getElementAddress<jint>(i) = 10 * (i + 1);
+    }
+    if (callInt(thread, "at", "([II)I", {array, new intOopDesc(0)}) != 10
+        || callInt(thread, "at", "([II)I", {array, new intOopDesc(2)}) != 30
+        || !expectOpcodes("at", "([II)I", {{0, OPC_ALOAD_ILOAD_IALOAD}})) {
+        printError("at(a, i) should be a[i]");
+        return false;
+    }
+
+    // the GETFIELD after ALOAD_0 is quickened on its own
+    auto p = pointClass->newInstance();
+    callInt(thread, "bump", "(LPoint;)I", {p});
+    if (!expectOpcodes("bump", "(LPoint;)I", {{1, OPC_ALOAD_0_GETFIELD}, {2, OPC_FAST_IGETFIELD}})) {
+        return false;
+    }
+    printSuccess("Fused field and array loads");
+    return true;
+}
+
+#if defined(KIVM_THREADED) && !defined(KIVM_DEBUG)
+bool testBytecodeProfile(JavaThread *thread) {
+    std::cout << "\n=== Testing bytecode profiles ===" << std::endl;
+
+    std::string path = classPathDir + "/bytecodes.profile";
+    RuntimeConfig::get().bytecodeProfilePath = path;
+    callInt(thread, "add", "(II)I", {new intOopDesc(1), new intOopDesc(2)});
+    callInt(thread, "add", "(II)I", {new intOopDesc(3), new intOopDesc(4)});
+    callInt(thread, "sumTo", "(I)I", {new intOopDesc(10)});
+    RuntimeConfig::get().bytecodeProfilePath.clear();
+
+    // superinstructions are counted as the instructions they replaced
+    if (BytecodeProfile::getPairCount(OPC_ILOAD_0, OPC_ILOAD_1) != 2
+        || BytecodeProfile::getTripleCount(OPC_ILOAD_0, OPC_ILOAD_1, OPC_IADD) != 2
+        || BytecodeProfile::getTripleCount(OPC_ILOAD, OPC_ILOAD, OPC_IF_ICMPGE) != 11
+        || BytecodeProfile::getTripleCount(OPC_ILOAD, OPC_IINC, OPC_GOTO) != 10) {
+        printError("Wrong pair or triple counts");
+        return false;
+    }
+
+    // taken branches end sequences
+    if (BytecodeProfile::getPairCount(OPC_GOTO, OPC_ILOAD) != 0
+        || BytecodeProfile::getPairCount(OPC_IF_ICMPGE, OPC_ILOAD) != 10) {
+        printError("Sequences should not go through taken branches");
+        return false;
+    }
+
+    if (!BytecodeProfile::dump(path)) {
+        printError("Cannot write the profile");
+        return false;
+    }
+    std::ifstream in(path);
+    std::string line;
+    bool found = false;
+    while (std::getline(in, line)) {
+        found = found || line == "triple iload_0 iload_1 iadd 2";
+    }
+    if (!found) {
+        printError("Triple iload_0 iload_1 iadd is not in the profile");
+        return false;
+    }
+    printSuccess("Counted pairs and triples");
+    return true;
+}
+#endif
+
+#if defined(KIVM_THREADED) && !defined(KIVM_DEBUG)
+static DecodedCode *getDecodedCode(const std::string &name, const std::string &descriptor) {
+    auto method = calcClass->getStaticMethod(strings::fromStdString(name),
+        strings::fromStdString(descriptor));
+    return method->getDecodedCode();
+}
+
+bool testDirectThreading(JavaThread *thread) {
+    std::cout << "\n=== Testing direct threading ===" << std::endl;
+
+    // methods are only decoded when the C++ interpreters run them
+    RuntimeConfig::get().useTemplateInterpreter = false;
+    callInt(thread, "sum", "(I)I", {new intOopDesc(1)});
+
+    auto code = getDecodedCode("sum", "(I)I");
+    if (code == nullptr || !code->isDecoded() || code->getCount() != 15
+        || code->getInstructionAt(4) != code->getEntry() + 4
+        || code->getInstructionAt(7) != nullptr) {
+        printError("sum(n) should be decoded one record per instruction");
+        return false;
+    }
+    printSuccess("Decoded loops and calls");
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto array = arrayClass->newInstance(3);
+    *array->getElementAddress<jint>(2) = 30;
+
+    // the same methods with the bytecodes, and back again
+    for (bool direct : {false, true}) {
+        RuntimeConfig::get().useDirectThreading = direct;
+        auto p = pointClass->newInstance();
+        auto result = call(thread, "mix", "(I)D", {new intOopDesc(6)});
+        if (callInt(thread, "sum", "(I)I", {new intOopDesc(100)}) != 4950
+            || callInt(thread, "sumTo", "(I)I", {new intOopDesc(100)}) != 5050
+            || callInt(thread, "bump", "(LPoint;)I", {p}) != 1
+            || callInt(thread, "bump", "(LPoint;)I", {p}) != 2
+            || callInt(thread, "at", "([II)I", {array, new intOopDesc(2)}) != 30
+            || result == nullptr || ((doubleOop) result)->getValue() != 39.0) {
+            printError(std::string("Wrong results with direct threading ") + (direct ? "on" : "off"));
+            return false;
+        }
+    }
+
+    // fused sequences run as one record, the records after it are kept
+    auto sumTo = getDecodedCode("sumTo", "(I)I");
+    auto bump = getDecodedCode("bump", "(LPoint;)I");
+    auto at = getDecodedCode("at", "([II)I");
+    if (sumTo == nullptr || !sumTo->isDecoded()
+        || sumTo->getInstructionAt(7)->_handler != DirectThreadedInterpreter::getHandler(OPC_ILOAD_ILOAD_IF_ICMPGE)
+        || sumTo->getInstructionAt(14)->_handler != DirectThreadedInterpreter::getHandler(OPC_ILOAD_IINC_GOTO)
+        || sumTo->getInstructionAt(9)->_handler != DirectThreadedInterpreter::getHandler(OPC_ILOAD)
+        || bump == nullptr || !bump->isDecoded()
+        || bump->getInstructionAt(1)->_handler != DirectThreadedInterpreter::getHandler(OPC_ALOAD_0_GETFIELD)
+        || at == nullptr || !at->isDecoded()
+        || at->getInstructionAt(0)->_handler != DirectThreadedInterpreter::getHandler(OPC_ALOAD_ILOAD_IALOAD)) {
+        printError("Fused sequences should be decoded with their own handlers");
+        return false;
+    }
+    printSuccess("Both interpreters agree");
+
+    // switches jump through their decoded tables, in and out of range
+    for (jint n : {0, 1, -1, 2, 7, INT_MIN}) {
+        jint expected = n == 0 ? 10 : n == 1 ? 20 : -1;
+        if (callInt(thread, "pick", "(I)I", {new intOopDesc(n)}) != expected) {
+            printError("pick(" + std::to_string(n) + ") should be " + std::to_string(expected));
+            return false;
+        }
+    }
+    for (jint n : {-5, 100, 1000, 0, 99, INT_MAX}) {
+        jint expected = n == -5 ? 1 : n == 100 ? 2 : n == 1000 ? 3 : 0;
+        if (callInt(thread, "lookup", "(I)I", {new intOopDesc(n)}) != expected) {
+            printError("lookup(" + std::to_string(n) + ") should be " + std::to_string(expected));
+            return false;
+        }
+    }
+    auto pick = getDecodedCode("pick", "(I)I");
+    auto lookup = getDecodedCode("lookup", "(I)I");
+    if (pick == nullptr || !pick->isDecoded()
+        || pick->getInstructionAt(1)->_switch->_targets.size() != 2
+        || pick->getInstructionAt(1)->_target != pick->getInstructionAt(30)
+        || lookup == nullptr || !lookup->isDecoded()
+        || lookup->getInstructionAt(1)->_switch->_keys.size() != 3) {
+        printError("Switches should be decoded");
+        return false;
+    }
+    printSuccess("Switches are direct-threaded");
+    RuntimeConfig::get().useTemplateInterpreter = true;
+    return true;
+}
+#endif
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+bool testTemplateInterpreter(JavaThread *thread) {
+    std::cout << "\n=== Testing template interpreter ===" << std::endl;
+
+    if (!TemplateInterpreter::isGenerated()) {
+        printError("Templates should be generated at startup");
+        return false;
+    }
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::LONG);
+    auto array = arrayClass->newInstance(4);
+
+    // the same methods in C++, and back again
+    for (bool generated : {false, true}) {
+        RuntimeConfig::get().useTemplateInterpreter = generated;
+        auto lmath = call(thread, "lmath", "(JJ)J", {new longOopDesc(1L << 40), new longOopDesc(-7)});
+        auto fill = call(thread, "fill", "([JI)J", {array, new intOopDesc(9)});
+        if (callInt(thread, "div", "(II)I", {new intOopDesc(7), new intOopDesc(-2)}) != -2
+            || callInt(thread, "dups", "(II)I", {new intOopDesc(10), new intOopDesc(3)}) != 21
+            || callInt(thread, "sumTo", "(I)I", {new intOopDesc(100)}) != 5050
+            || lmath == nullptr
+            || ((longOop) lmath)->getValue() != ((((1L << 40) / -7) + ((1L << 40) % -7)) << 3) - 1
+            || fill == nullptr || ((longOop) fill)->getValue() != -9 + 4
+            || *array->getElementAddress<jlong>(1) != -9) {
+            printError(std::string("Wrong results with the template interpreter ") + (generated ? "on" : "off"));
+            return false;
+        }
+    }
+    printSuccess("Both interpreters agree");
+
+    // idiv faults on this one, Java wraps around
+    if (callInt(thread, "div", "(II)I", {new intOopDesc(INT_MIN), new intOopDesc(-1)}) != INT_MIN) {
+        printError("div(MIN_VALUE, -1) should be MIN_VALUE");
+        return false;
+    }
+    printSuccess("Divided MIN_VALUE by -1");
+
+    // the slow paths of templates run the bytecode in the VM
+    auto p = pointClass->newInstance();
+    if (callInt(thread, "bump", "(LPoint;)I", {p}) != 1
+        || callInt(thread, "pick", "(I)I", {new intOopDesc(1)}) != 20
+        || callInt(thread, "answer", "()I", {}) != 42) {
+        printError("Bytecodes without templates should run in the VM");
+        return false;
+    }
+    printSuccess("Ran fields, switches and constants in the VM");
+    return true;
+}
+#endif
+
+bool testOutOfMemory(TestThread *thread) {
+    std::cout << "\n=== Testing OutOfMemoryError in the VM ===" << std::endl;
+
+    TestClass string("java/lang/String");
+    string.addInstanceField("value", "[C");
+    string.addInstanceField("hash", "I");
+    auto stringClass = loadClass("java/lang/String", string);
+
+    TestClass error("java/lang/OutOfMemoryError");
+    Global::_OutOfMemoryError = loadClass("java/lang/OutOfMemoryError", error);
+    Global::OUT_OF_MEMORY_ERROR = Global::_OutOfMemoryError->newInstance();
+
+    TestClass arithmetic("java/lang/ArithmeticException");
+    arithmetic.addInstanceMethod({"<init>", "()V", 0, 1, {OPC_RETURN}});
+    arithmetic.addInstanceMethod({"<init>", "(Ljava/lang/String;)V", 0, 2, {OPC_RETURN}});
+    auto arithmeticClass = loadClass("java/lang/ArithmeticException", arithmetic);
+
+    const std::string text = "interned when the ldc runs, long enough not to fit in what is left";
+    TestClass hog("Hog");
+    int root = hog.fieldRef("root", "Ljava/lang/Object;");
+    int object = hog.classRef("java/lang/Object");
+    int constant = hog.stringConstant(text);
+
+    // Exceptions reaching the VM are fatal, so they are returned.
+    // No method takes arguments, boxes cannot be allocated on a full heap.
+    // for (;;) { int[] a = new int[length]; root = new Object[] {root, a}; }
+    auto fill = [&](const char *name, std::vector<u1> length) {
+        std::vector<u1> code = length;              // 0
+        code.insert(code.end(), {
+            OPC_NEWARRAY, T_INT,                    // 3
+            OPC_ASTORE_0,                           // 5
+            OPC_ICONST_2,                           // 6
+            OPC_ANEWARRAY, 0, (u1) object,          // 7
+            OPC_DUP,                                // 10
+            OPC_ICONST_0,                           // 11
+            OPC_GETSTATIC, 0, (u1) root,            // 12
+            OPC_AASTORE,                            // 15
+            OPC_DUP,                                // 16
+            OPC_ICONST_1,                           // 17
+            OPC_ALOAD_0,                            // 18
+            OPC_AASTORE,                            // 19
+            OPC_PUTSTATIC, 0, (u1) root,            // 20
+            OPC_GOTO, 0xff, 0xe9,                   // 23 -> 0
+            OPC_ARETURN,                            // 26
+        });
+        hog.addMethod({name, "()Ljava/lang/Object;", 4, 1, code}, 26);
+    };
+    fill("fill", {OPC_SIPUSH, 0x10, 0x00});
+    fill("fillGaps", {OPC_ICONST_0, OPC_NOP, OPC_NOP});
+    hog.addMethod({"release", "()V", 1, 0, {
+        OPC_ACONST_NULL, OPC_PUTSTATIC, 0, (u1) root, OPC_RETURN,
+    }});
+    hog.addMethod({"text", "()Ljava/lang/Object;", 1, 0, {
+        OPC_LDC, (u1) constant, OPC_ARETURN,        // 0
+        OPC_ARETURN,                                // 3
+    }}, 3);
+    hog.addMethod({"divide", "()Ljava/lang/Object;", 2, 0, {
+        OPC_ICONST_1, OPC_ICONST_0, OPC_IDIV, OPC_POP, // 0
+        OPC_ACONST_NULL, OPC_ARETURN,               // 4
+        OPC_ARETURN,                                // 6
+    }}, 6);
+    auto hogClass = loadClass("Hog", hog);
+    // newarray only finds array classes that are loaded
+    BootstrapClassLoader::get()->loadClass(L"[I");
+
+    auto run = [&](const char *name) {
+        auto method = hogClass->getStaticMethod(strings::fromStdString(name), L"()Ljava/lang/Object;");
+        return JavaCall::withArgs(thread, method, {});
+    };
+
+    // large chunks first, then the gaps they leave
+    if (run("fill") != Global::OUT_OF_MEMORY_ERROR
+        || run("fillGaps") != Global::OUT_OF_MEMORY_ERROR) {
+        printError("Filling the heap should throw OutOfMemoryError");
+        return false;
+    }
+    printSuccess("Filled the heap from Java");
+
+    if (run("text") != Global::OUT_OF_MEMORY_ERROR) {
+        printError("Interning a string constant should throw OutOfMemoryError");
+        return false;
+    }
+    printSuccess("Interning a string on a full heap threw OutOfMemoryError");
+
+    if (run("divide") != Global::OUT_OF_MEMORY_ERROR) {
+        printError("Constructing an ArithmeticException should throw OutOfMemoryError");
+        return false;
+    }
+    printSuccess("Constructing an exception on a full heap threw OutOfMemoryError");
+
+    JavaCall::withArgs(thread, hogClass->getStaticMethod(L"release", L"()V"), {});
+    auto result = (instanceOop) run("text");
+    if (result == nullptr || result->getInstanceClass() != stringClass
+        || java::lang::String::toNativeString(result) != strings::fromStdString(text)) {
+        printError("text() should return the interned string once memory is released");
+        return false;
+    }
+
+    auto exception = (instanceOop) run("divide");
+    if (exception == nullptr || exception->getInstanceClass() != arithmeticClass) {
+        printError("divide() should throw ArithmeticException once memory is released");
+        return false;
+    }
+    printSuccess("Recovered after the heap was released");
+    return true;
+}
+
+class PauseCounter : public GCListener {
+public:
+    size_t _pauses = 0;
+    size_t _churnSites = 0;
+
+    void onGCEvent(const GCEvent &event) override {
+        if (event._type != GC_PAUSE_END) {
+            return;
+        }
+        ++_pauses;
+        for (int i = 0; i < event._allocationSiteCount; ++i) {
+            if (event._allocationSites[i]._method->getName() == L"churn") {
+                ++_churnSites;
+            }
+        }
+    }
+};
+
+bool testCollection(TestThread *thread) {
+    std::cout << "\n=== Testing collections in interpreted code ===" << std::endl;
+
+    PauseCounter counter;
+    Universe::addGCListener(&counter);
+    thread->getRoot() = calcClass->newInstance();
+    auto result = call(thread, "churn", "(Ljava/lang/Object;I)Ljava/lang/Object;",
+        {thread->getRoot(), new intOopDesc(1000000)});
+    Universe::removeGCListener(&counter);
+
+    if (counter._pauses == 0) {
+        printError("No collection happened");
+        return false;
+    }
+
+    if (result != thread->getRoot()) {
+        printError("Reference on the operand stack was not moved");
+        return false;
+    }
+    printSuccess("References on the operand stack survive collections");
+
+    if (counter._churnSites == 0) {
+        printError("Allocating method was not reported as an allocation site");
+        return false;
+    }
+    printSuccess("Allocation sites are reported at pause end");
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Interpreter Test ===" << std::endl;
+
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(8L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(8L);
+    Universe::initialize();
+    DefaultInterpreter::initialize();
+
+    auto thread = new TestThread;
+    Threads::addJavaThread(thread);
+    Threads::setCurrentThread(thread);
+
+    if (!loadCalcClass()) {
+        return 1;
+    }
+
+    if (!testPrimitiveReturns(thread)) {
+        return 1;
+    }
+
+    if (!testOperandStack(thread)) {
+        return 1;
+    }
+
+    if (!testQuickening(thread)) {
+        return 1;
+    }
+
+    if (!testSuperinstructions(thread)) {
+        return 1;
+    }
+
+#if defined(KIVM_THREADED) && !defined(KIVM_DEBUG)
+    if (!testBytecodeProfile(thread)) {
+        return 1;
+    }
+
+    if (!testDirectThreading(thread)) {
+        return 1;
+    }
+#endif
+
+#ifdef KIVM_TEMPLATE_INTERPRETER
+    if (!testTemplateInterpreter(thread)) {
+        return 1;
+    }
+#endif
+
+    GCThread::initialize();
+    GCThread::get()->start();
+
+    if (!testCollection(thread)) {
+        return 1;
+    }
+
+    if (!testOutOfMemory(thread)) {
+        return 1;
+    }
+
+    GCThread::get()->stop();
+
+    printSuccess("All interpreter tests completed!");
+    return 0;
+}
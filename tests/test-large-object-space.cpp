@@ -0,0 +1,194 @@
+//
+// Test for KiVM large object space
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/copyingHeap.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <iostream>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr, nullptr}) {
+    }
+
+    oop &getFirst() {
+        return _args.front();
+    }
+
+    oop &getLast() {
+        return _args.back();
+    }
+};
+
+static bool checkIntArray(arrayOop array, int length) {
+    for (int i = 0; i < length; ++i) {
+        if (*array->getElementAddress<jint>(i) != i * 7) {
+            printError("Wrong value at index " + std::to_string(i));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testLargeArrayNeverMoves(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Large Arrays Are Not Moved ===" << std::endl;
+
+    const int LENGTH = 1024 * 1024;
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+
+    auto array = arrayClass->newInstance(LENGTH);
+    if (!heap->getLargeObjectSpace().contains(array)) {
+        printError("4MB array is not in the large object space");
+        return false;
+    }
+    for (int i = 0; i < LENGTH; ++i) {
+        *array->getElementAddress<jint>(i) = i * 7;
+    }
+    holder->getFirst() = array;
+
+    heap->doMinorCollection();
+    heap->doFullCollection();
+
+    if (holder->getFirst() != array) {
+        printError("Large array was moved");
+        return false;
+    }
+    if (!checkIntArray(array, LENGTH)) {
+        return false;
+    }
+    printSuccess("Large array keeps its address and contents through minor and full GCs");
+    holder->getFirst() = nullptr;
+    return true;
+}
+
+bool testYoungReferencesFromLargeArray(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Young Objects Referenced by a Large Array ===" << std::endl;
+
+    const int LENGTH = 64 * 1024;
+    const int STEP = 997;
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+    auto valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    // [[I, its elements are [I
+    auto holderClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+
+    auto large = holderClass->newInstance(LENGTH);
+    if (!heap->getLargeObjectSpace().contains(large)) {
+        printError("Object array is not in the large object space");
+        return false;
+    }
+    holder->getLast() = large;
+
+    // young arrays are reachable only through the large array
+    for (int i = 0; i < LENGTH; i += STEP) {
+        auto value = valueClass->newInstance(1);
+        *value->getElementAddress<jint>(0) = i;
+        large->setElementAt(i, value);
+    }
+
+    for (int round = 0; round < 3; ++round) {
+        heap->doMinorCollection();
+        for (int i = 0; i < LENGTH; i += STEP) {
+            auto value = (arrayOop) large->getElementAt(i);
+            if (value == nullptr || !Universe::isHeapObject(value)
+                || *value->getElementAddress<jint>(0) != i) {
+                printError("Lost element " + std::to_string(i) + " after minor GC " + std::to_string(round));
+                return false;
+            }
+        }
+    }
+    printSuccess("Dirty cards of the large array keep young objects alive");
+
+    heap->doFullCollection();
+    for (int i = 0; i < LENGTH; i += STEP) {
+        auto value = (arrayOop) large->getElementAt(i);
+        if (value == nullptr || *value->getElementAddress<jint>(0) != i) {
+            printError("Lost element " + std::to_string(i) + " after full GC");
+            return false;
+        }
+    }
+    printSuccess("Full GC marks through the large array");
+    return true;
+}
+
+bool testUnreachableLargeArraysAreFreed(RootHolderThread *holder) {
+    std::cout << "\n=== Testing Unreachable Large Arrays Are Freed ===" << std::endl;
+
+    const int ROUNDS = 400;
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::BYTE);
+    auto &space = heap->getLargeObjectSpace();
+
+    size_t liveUsed = space.getUsed();
+    size_t liveCount = space.getObjectCount();
+    for (int i = 0; i < ROUNDS; ++i) {
+        // 1MB of garbage each time, with a growing size to fragment the space
+        arrayClass->newInstance(SIZE_MB(1) + (i % 8) * SIZE_KB(64));
+        if (i % 16 == 15) {
+            heap->doFullCollection();
+        }
+    }
+    heap->doFullCollection();
+
+    printInfo("  large objects: " + std::to_string(space.getObjectCount())
+              + ", used: " + std::to_string(space.getUsed()));
+    if (space.getUsed() != liveUsed || space.getObjectCount() != liveCount) {
+        printError("Unreachable large arrays were not freed");
+        return false;
+    }
+    if (holder->getLast() == nullptr || !space.contains(holder->getLast())) {
+        printError("Live large array was freed");
+        return false;
+    }
+    printSuccess("Full GC frees unreachable large arrays and reuses their chunks");
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Large Object Space Test ===" << std::endl;
+
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(32L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().gcWorkerThreads = 4;
+    Universe::initialize();
+    printSuccess("Universe initialized");
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    if (!testLargeArrayNeverMoves(holder)) {
+        return 1;
+    }
+
+    if (!testYoungReferencesFromLargeArray(holder)) {
+        return 1;
+    }
+
+    if (!testUnreachableLargeArraysAreFreed(holder)) {
+        return 1;
+    }
+
+    Universe::destroy();
+    printSuccess("All Large Object Space tests completed!");
+    return 0;
+}
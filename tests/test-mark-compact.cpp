@@ -0,0 +1,303 @@
+//
+// Test for KiVM mark-compact heap
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/markCompactHeap.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr, nullptr}) {
+    }
+
+    oop &getFirst() {
+        return _args.front();
+    }
+
+    oop &getLast() {
+        return _args.back();
+    }
+};
+
+bool checkLinkedList(Klass *nodeClass, oop head, int expectedCount) {
+    oop node = head;
+    int count = 0;
+    while (node != nullptr) {
+        if (!Universe::isHeapObject(node) || node->getClass() != nodeClass) {
+            printError("Broken node at index " + std::to_string(count));
+            return false;
+        }
+
+        auto array = (arrayOop) node;
+        auto value = (arrayOop) array->getElementAt(0);
+        if (*value->getElementAddress<jint>(0) != count) {
+            printError("Wrong value at index " + std::to_string(count));
+            return false;
+        }
+
+        node = array->getElementAt(1);
+        ++count;
+    }
+
+    if (count != expectedCount) {
+        printError("Expected " + std::to_string(expectedCount) + " nodes, got " + std::to_string(count));
+        return false;
+    }
+    return true;
+}
+
+bool testLinkedListCompaction() {
+    std::cout << "\n=== Testing Compaction with a Linked List ===" << std::endl;
+
+    const int NODE_COUNT = 200000;
+    const int NODES_PER_GC = 50000;
+
+    // node[0] is a [I holding the node index, node[1] is the next node.
+    auto nodeClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    auto valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto heap = (MarkCompactHeap *) Universe::getCollectedHeap();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    long gcTime = 0;
+    for (int i = 0; i < NODE_COUNT; ++i) {
+        // garbage between live objects, so that they have to slide
+        valueClass->newInstance(4);
+
+        auto value = valueClass->newInstance(1);
+        *value->getElementAddress<jint>(0) = i;
+
+        auto node = nodeClass->newInstance(2);
+        node->setElementAt(0, value);
+        if (holder->getLast() == nullptr) {
+            holder->getFirst() = node;
+        } else {
+            ((arrayOop) holder->getLast())->setElementAt(1, node);
+        }
+        holder->getLast() = node;
+
+        if ((i + 1) % NODES_PER_GC == 0) {
+            size_t beforeUsed = heap->getHeapUsed();
+            auto start = std::chrono::high_resolution_clock::now();
+            heap->doGarbageCollection();
+            auto end = std::chrono::high_resolution_clock::now();
+            gcTime += std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+            if (heap->getHeapUsed() >= beforeUsed) {
+                printError("Garbage was not reclaimed");
+                return false;
+            }
+        }
+    }
+    printInfo("  GC time: " + std::to_string(gcTime / (NODE_COUNT / NODES_PER_GC)) + " ms on average");
+
+    if (!checkLinkedList(nodeClass, holder->getFirst(), NODE_COUNT)) {
+        return false;
+    }
+    printSuccess("All " + std::to_string(NODE_COUNT) + " nodes survived compaction in order");
+
+    // the first value was preceded by garbage, now it starts the heap
+    if ((void *) ((arrayOop) holder->getFirst())->getElementAt(0) != heap->getHeapStart()) {
+        printError("Live objects did not slide to the heap start");
+        return false;
+    }
+    printSuccess("Live objects slid to the heap start");
+
+    holder->getFirst() = nullptr;
+    holder->getLast() = nullptr;
+    heap->doGarbageCollection();
+    if (heap->getHeapUsed() != 0) {
+        printError("Heap still used after dropping everything: " + std::to_string(heap->getHeapUsed()));
+        return false;
+    }
+    printSuccess("Heap is empty after dropping the list");
+    return true;
+}
+
+bool testHeaderPreservation() {
+    std::cout << "\n=== Testing Header Preservation ===" << std::endl;
+
+    auto objectClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto heap = (MarkCompactHeap *) Universe::getCollectedHeap();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    // garbage before the object, so that it moves
+    for (int i = 0; i < 1000; ++i) {
+        objectClass->newInstance(16);
+    }
+
+    auto object = objectClass->newInstance(1);
+    object->getMarkOop()->setHash(0x12345);
+    object->getMarkOop()->monitorEnter();
+    object->getMarkOop()->monitorExit();
+    u4 monitorIndex = object->getMarkOop()->getMonitorIndex();
+    holder->getFirst() = object;
+
+    heap->doGarbageCollection();
+
+    auto moved = holder->getFirst();
+    if ((oop) moved == (oop) object) {
+        printError("Object was not moved");
+        return false;
+    }
+    if (moved->getMarkOop()->getHash() != 0x12345) {
+        printError("Identity hash was lost");
+        return false;
+    }
+    if (!moved->getMarkOop()->hasMonitor()
+        || moved->getMarkOop()->getMonitorIndex() != monitorIndex) {
+        printError("Monitor was lost");
+        return false;
+    }
+    if (moved->getMarkOop()->getOopType() != oopType::TYPE_ARRAY_OOP) {
+        printError("Oop type was lost");
+        return false;
+    }
+    printSuccess("Hash, monitor and oop type survived compaction");
+
+    holder->getFirst() = nullptr;
+    return true;
+}
+
+bool testHeapResizing() {
+    std::cout << "\n=== Testing Heap Growth and Shrinking ===" << std::endl;
+
+    const int CHUNK_COUNT = 160;
+    const int CHUNK_SIZE = 1024 * 1024;
+    const int CHUNKS_PER_GC = 16;
+
+    auto rootClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::BYTE);
+    auto chunkClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::BYTE);
+    auto heap = (MarkCompactHeap *) Universe::getCollectedHeap();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+    holder->getFirst() = rootClass->newInstance(CHUNK_COUNT);
+
+    size_t initialSize = heap->getHeapSize();
+    size_t maxSize = initialSize;
+    for (int i = 0; i < CHUNK_COUNT; ++i) {
+        auto chunk = chunkClass->newInstance(CHUNK_SIZE);
+        *chunk->getElementAddress<jbyte>(0) = (jbyte) i;
+        ((arrayOop) holder->getFirst())->setElementAt(i, chunk);
+
+        if ((i + 1) % CHUNKS_PER_GC == 0) {
+            heap->doGarbageCollection();
+            maxSize = std::max(maxSize, heap->getHeapSize());
+        }
+    }
+    printInfo("  Heap size: " + std::to_string(initialSize >> 20) + " MB -> "
+              + std::to_string(maxSize >> 20) + " MB");
+
+    if (maxSize <= initialSize) {
+        printError("Heap did not grow with " + std::to_string(CHUNK_COUNT) + " MB live");
+        return false;
+    }
+
+    // drop everything, sustained low occupancy should shrink the heap
+    holder->getFirst() = nullptr;
+    for (int i = 0; i < 12; ++i) {
+        heap->doGarbageCollection();
+    }
+    printInfo("  Heap size after release: " + std::to_string(heap->getHeapSize() >> 20) + " MB");
+
+    if (heap->getHeapSize() >= maxSize) {
+        printError("Heap did not shrink");
+        return false;
+    }
+    printSuccess("Heap shrank after sustained low occupancy");
+    return true;
+}
+
+bool testTlabSizedAllocations() {
+    std::cout << "\n=== Testing Allocations Bigger than a TLAB ===" << std::endl;
+
+    const size_t tlabSize = RuntimeConfig::get().tlabSizeInBytes;
+    // there is no large object space, everything above a TLAB goes to the space
+    const std::vector<size_t> sizes = {tlabSize + 8, 100000, SIZE_MB(1)};
+
+    bool passed = true;
+    for (size_t size : sizes) {
+        // once with an empty TLAB, once with a nearly full one
+        auto holder = new RootHolderThread;
+        Threads::addJavaThread(holder);
+        Threads::setCurrentThread(holder);
+
+        void *fresh = Universe::allocHeap(size);
+        while (holder->getTlab().getFree() > tlabSize / 16) {
+            Universe::allocHeap(64);
+        }
+        void *refilled = Universe::allocHeap(size);
+
+        if (fresh == nullptr || refilled == nullptr) {
+            printError("Failed to allocate " + std::to_string(size) + " bytes");
+            passed = false;
+            break;
+        }
+        memset(fresh, 0x55, size);
+        memset(refilled, 0x55, size);
+    }
+
+    Threads::setCurrentThread(nullptr);
+    if (passed) {
+        printSuccess("Objects bigger than a TLAB are allocated outside of it");
+    }
+    return passed;
+}
+
+int main() {
+    std::cout << "=== KiVM Mark-Compact Heap Test ===" << std::endl;
+
+    RuntimeConfig::get().heapType = HEAP_MARK_COMPACT;
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(512L);
+    RuntimeConfig::get().gcWorkerThreads = 4;
+    Universe::initialize();
+    printSuccess("Universe initialized with mark-compact heap");
+
+    if (!testLinkedListCompaction()) {
+        return 1;
+    }
+
+    if (!testHeaderPreservation()) {
+        return 1;
+    }
+
+    if (!testHeapResizing()) {
+        return 1;
+    }
+
+    if (!testTlabSizedAllocations()) {
+        return 1;
+    }
+
+    printSuccess("All Mark-Compact tests completed!");
+    return 0;
+}
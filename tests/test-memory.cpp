@@ -5,7 +5,12 @@
 
 #include <kivm/memory/universe.h>
 #include <kivm/memory/copyingHeap.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
 #include <iostream>
+#include <fstream>
 #include <chrono>
 
 using namespace kivm;
@@ -26,6 +31,10 @@ bool initializeMemory() {
     try {
         std::cout << "Initializing KiVM Memory System..." << std::endl;
         
+        // Collect with several workers even on a single core,
+        // so that parallel copying is always exercised
+        RuntimeConfig::get().gcWorkerThreads = 4;
+
         // Initialize Universe
         Universe::initialize();
         printSuccess("Universe initialized");
@@ -126,6 +135,314 @@ void testLargeAllocation() {
     }
 }
 
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr, nullptr}) {
+    }
+
+    oop &getFirst() {
+        return _args.front();
+    }
+
+    oop &getLast() {
+        return _args.back();
+    }
+};
+
+bool checkLinkedList(Klass *nodeClass, oop head, int expectedCount) {
+    oop node = head;
+    int count = 0;
+    while (node != nullptr) {
+        if (!Universe::isHeapObject(node) || node->getClass() != nodeClass) {
+            printError("Broken node at index " + std::to_string(count));
+            return false;
+        }
+
+        auto array = (arrayOop) node;
+        auto value = (arrayOop) array->getElementAt(0);
+        if (*value->getElementAddress<jint>(0) != count) {
+            printError("Wrong value at index " + std::to_string(count));
+            return false;
+        }
+
+        node = array->getElementAt(1);
+        ++count;
+    }
+
+    if (count != expectedCount) {
+        printError("Expected " + std::to_string(expectedCount) + " nodes, got " + std::to_string(count));
+        return false;
+    }
+    return true;
+}
+
+bool testLinkedListCollection() {
+    std::cout << "\n=== Testing GC with a Million-Node Linked List ===" << std::endl;
+
+    const int NODE_COUNT = 1000000;
+    const int NODES_PER_GC = 100000;
+
+    // Any array of arrays has reference elements, which is all the collector needs:
+    // node[0] is a [I holding the node index, node[1] is the next node.
+    auto nodeClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    auto valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    // Nodes are appended at the tail. Collecting twice in a row promotes
+    // the tail, so the next node is stored into an old object, and can
+    // only be found through the card table.
+    long minorTime = 0;
+    for (int i = 0; i < NODE_COUNT; ++i) {
+        auto value = valueClass->newInstance(1);
+        *value->getElementAddress<jint>(0) = i;
+
+        auto node = nodeClass->newInstance(2);
+        node->setElementAt(0, value);
+        if (holder->getLast() == nullptr) {
+            holder->getFirst() = node;
+        } else {
+            ((arrayOop) holder->getLast())->setElementAt(1, node);
+        }
+        holder->getLast() = node;
+
+        // garbage that should not survive
+        valueClass->newInstance(4);
+
+        if ((i + 1) % NODES_PER_GC == 0) {
+            auto start = std::chrono::high_resolution_clock::now();
+            heap->doMinorCollection();
+            heap->doMinorCollection();
+            auto end = std::chrono::high_resolution_clock::now();
+            minorTime += std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        }
+    }
+    printInfo("  Minor GC time: " + std::to_string(minorTime / (NODE_COUNT / NODES_PER_GC * 2)) + " ms on average");
+
+    if (!checkLinkedList(nodeClass, holder->getFirst(), NODE_COUNT)) {
+        return false;
+    }
+    printSuccess("All " + std::to_string(NODE_COUNT) + " nodes survived minor GCs in order");
+
+    oop head = holder->getFirst();
+    auto start = std::chrono::high_resolution_clock::now();
+    heap->doFullCollection();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    printInfo("  Full GC time: " + std::to_string(duration.count()) + " ms");
+
+    if (holder->getFirst() == head) {
+        printError("List head was not moved");
+        return false;
+    }
+
+    if (!checkLinkedList(nodeClass, holder->getFirst(), NODE_COUNT)) {
+        return false;
+    }
+    printSuccess("All " + std::to_string(NODE_COUNT) + " nodes survived full GC in order");
+    return true;
+}
+
+bool testHeapResizing() {
+    std::cout << "\n=== Testing Old Generation Growth and Shrinking ===" << std::endl;
+
+    const int CHUNK_COUNT = 320;
+    const int CHUNK_SIZE = 1024 * 1024;
+    const int CHUNKS_PER_GC = 16;
+
+    auto rootClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::BYTE);
+    auto chunkClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::BYTE);
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+    holder->getFirst() = rootClass->newInstance(CHUNK_COUNT);
+
+    size_t initialSize = heap->getHeapSize();
+    size_t maxSize = initialSize;
+    for (int i = 0; i < CHUNK_COUNT; ++i) {
+        auto chunk = chunkClass->newInstance(CHUNK_SIZE);
+        *chunk->getElementAddress<jbyte>(0) = (jbyte) i;
+        ((arrayOop) holder->getFirst())->setElementAt(i, chunk);
+
+        if ((i + 1) % CHUNKS_PER_GC == 0) {
+            heap->doFullCollection();
+            maxSize = std::max(maxSize, heap->getHeapSize());
+        }
+    }
+    printInfo("  Heap size: " + std::to_string(initialSize >> 20) + " MB -> "
+              + std::to_string(maxSize >> 20) + " MB");
+
+    if (maxSize <= initialSize) {
+        printError("Heap did not grow with " + std::to_string(CHUNK_COUNT) + " MB live");
+        return false;
+    }
+
+    auto roots = (arrayOop) holder->getFirst();
+    for (int i = 0; i < CHUNK_COUNT; ++i) {
+        auto chunk = (arrayOop) roots->getElementAt(i);
+        if (chunk == nullptr || *chunk->getElementAddress<jbyte>(0) != (jbyte) i) {
+            printError("Wrong chunk at index " + std::to_string(i));
+            return false;
+        }
+    }
+    printSuccess("All chunks survived heap growth");
+
+    // drop everything, sustained low occupancy should shrink the heap
+    holder->getFirst() = nullptr;
+    for (int i = 0; i < 12; ++i) {
+        heap->doFullCollection();
+    }
+    printInfo("  Heap size after release: " + std::to_string(heap->getHeapSize() >> 20) + " MB");
+
+    if (heap->getHeapSize() >= maxSize) {
+        printError("Heap did not shrink");
+        return false;
+    }
+    printSuccess("Heap shrank after sustained low occupancy");
+    return true;
+}
+
+bool testTlabSizedAllocations() {
+    std::cout << "\n=== Testing Allocations Bigger than a TLAB ===" << std::endl;
+
+    const size_t tlabSize = RuntimeConfig::get().tlabSizeInBytes;
+    // bigger than a TLAB, smaller than a large object
+    const std::vector<size_t> sizes = {tlabSize, tlabSize + 8, 100000, 200000};
+
+    bool passed = true;
+    for (size_t size : sizes) {
+        // once with an empty TLAB, once with a nearly full one
+        auto holder = new RootHolderThread;
+        Threads::addJavaThread(holder);
+        Threads::setCurrentThread(holder);
+
+        void *fresh = Universe::allocHeap(size);
+        while (holder->getTlab().getFree() > tlabSize / 16) {
+            Universe::allocHeap(64);
+        }
+        void *refilled = Universe::allocHeap(size);
+
+        if (fresh == nullptr || refilled == nullptr) {
+            printError("Failed to allocate " + std::to_string(size) + " bytes");
+            passed = false;
+            break;
+        }
+        memset(fresh, 0x55, size);
+        memset(refilled, 0x55, size);
+    }
+
+    Threads::setCurrentThread(nullptr);
+    if (passed) {
+        printSuccess("Objects bigger than a TLAB are allocated outside of it");
+    }
+    return passed;
+}
+
+bool testEdenWalkAfterRefills() {
+    std::cout << "\n=== Testing Eden Walk after TLAB Refills ===" << std::endl;
+
+    const int ARRAY_COUNT = 500;
+    const int ARRAY_LENGTH = 1000;
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+
+    // start from an empty eden, the tests above left raw memory in it
+    heap->doMinorCollection();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+    Threads::setCurrentThread(holder);
+    // each refill leaves the tail of the previous TLAB behind
+    for (int i = 0; i < ARRAY_COUNT; ++i) {
+        arrayClass->newInstance(ARRAY_LENGTH);
+    }
+    Threads::setCurrentThread(nullptr);
+
+    int count = 0;
+    bool broken = false;
+    heap->objectIterate([&](oop object) {
+        if (object->getClass() == arrayClass) {
+            ++count;
+        } else if (object->getClass() == nullptr) {
+            broken = true;
+        }
+    });
+
+    if (broken || count != ARRAY_COUNT) {
+        printError("Walked " + std::to_string(count) + " of " + std::to_string(ARRAY_COUNT) + " arrays");
+        return false;
+    }
+    printSuccess("Eden walk finds all " + std::to_string(ARRAY_COUNT) + " arrays after TLAB refills");
+    return true;
+}
+
+// Resident set size of this process, in bytes
+static size_t getResidentSize() {
+    std::ifstream in("/proc/self/statm");
+    size_t totalPages = 0;
+    size_t residentPages = 0;
+    in >> totalPages >> residentPages;
+    return residentPages * Universe::getPageSize();
+}
+
+bool testResidentSizeAcrossCollections() {
+    std::cout << "\n=== Testing Native Memory across Thousands of GCs ===" << std::endl;
+
+    const int GC_COUNT = 3000;
+    const int WARMUP_GC_COUNT = 200;
+    const int MONITORS_PER_GC = 64;
+    const int GARBAGE_PER_GC = 256;
+    const size_t MAX_GROWTH = SIZE_MB(4);
+
+    auto objectClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto holderClass = new TypeArrayKlass(nullptr, nullptr, 2, ValueType::INT);
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    // Objects synchronized on are kept for one GC, then die as survivors,
+    // or die in eden. Their monitors must be freed by minor GCs.
+    size_t baseline = 0;
+    for (int gc = 0; gc < GC_COUNT; ++gc) {
+        auto objects = holderClass->newInstance(MONITORS_PER_GC);
+        holder->getFirst() = objects;
+        for (int i = 0; i < MONITORS_PER_GC; ++i) {
+            auto object = objectClass->newInstance(4);
+            object->getMarkOop()->monitorEnter();
+            object->getMarkOop()->monitorExit();
+            if (i % 2 == 0) {
+                objects->setElementAt(i, object);
+            }
+        }
+        for (int i = 0; i < GARBAGE_PER_GC; ++i) {
+            objectClass->newInstance(16);
+        }
+
+        heap->doMinorCollection();
+        if (gc + 1 == WARMUP_GC_COUNT) {
+            baseline = getResidentSize();
+        }
+    }
+
+    size_t residentSize = getResidentSize();
+    printInfo("  RSS after " + std::to_string(WARMUP_GC_COUNT) + " GCs: " + std::to_string(baseline >> 10)
+              + " KB, after " + std::to_string(GC_COUNT) + " GCs: " + std::to_string(residentSize >> 10) + " KB");
+    if (residentSize > baseline + MAX_GROWTH) {
+        printError("RSS grew by " + std::to_string((residentSize - baseline) >> 10) + " KB");
+        return false;
+    }
+    holder->getFirst() = nullptr;
+    printSuccess("RSS stayed flat across " + std::to_string(GC_COUNT) + " minor GCs");
+    return true;
+}
+
 int main() {
     std::cout << "=== KiVM Memory Management Test ===" << std::endl;
     
@@ -136,6 +453,26 @@ int main() {
     testBasicAllocation();
     testAllocationPerformance();
     testLargeAllocation();
+
+    if (!testLinkedListCollection()) {
+        return 1;
+    }
+
+    if (!testHeapResizing()) {
+        return 1;
+    }
+
+    if (!testTlabSizedAllocations()) {
+        return 1;
+    }
+
+    if (!testEdenWalkAfterRefills()) {
+        return 1;
+    }
+
+    if (!testResidentSizeAcrossCollections()) {
+        return 1;
+    }
     
     printSuccess("All Memory Management tests completed!");
     return 0;
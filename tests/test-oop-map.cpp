@@ -0,0 +1,296 @@
+//
+// Test for KiVM oop maps of interpreted frames
+//
+
+#include <kivm/bytecode/oopMap.h>
+#include <kivm/bytecode/bytecodes.h>
+#include <kivm/classfile/classFile.h>
+#include <kivm/classfile/classFileParser.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/method.h>
+#include <kivm/runtime/constantPool.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+// Class files are assembled by hand, there is no javac here
+class ClassWriter {
+private:
+    std::vector<u1> _bytes;
+
+public:
+    void writeU1(int v) {
+        _bytes.push_back((u1) v);
+    }
+
+    void writeU2(int v) {
+        writeU1(v >> 8);
+        writeU1(v);
+    }
+
+    void writeU4(int v) {
+        writeU2(v >> 16);
+        writeU2(v);
+    }
+
+    void writeUtf8(const std::string &s) {
+        writeU1(CONSTANT_Utf8);
+        writeU2((int) s.size());
+        for (char c : s) {
+            writeU1(c);
+        }
+    }
+
+    void writeBytes(const std::vector<u1> &b) {
+        _bytes.insert(_bytes.end(), b.begin(), b.end());
+    }
+
+    std::vector<u1> &get() {
+        return _bytes;
+    }
+};
+
+// Constant pool shared by both classes
+enum {
+    CP_THIS_NAME = 1,
+    CP_THIS_CLASS,
+    CP_OBJECT_NAME,
+    CP_OBJECT_CLASS,
+    CP_PICK_NAME,
+    CP_PICK_DESC,
+    CP_ID_NAME,
+    CP_ID_DESC,
+    CP_ID_NAME_AND_TYPE,
+    CP_ID_METHOD,
+    CP_CODE,
+    CP_STACK_MAP_TABLE,
+    CP_GUARD_NAME,
+    CP_COUNT
+};
+
+// static Object pick(Object a, int b):
+// calls id(a), then stores either a or 0 into local 2, and
+// returns the result of id(a), which stays on the stack across the branch.
+static const std::vector<u1> PICK_CODE = {
+    OPC_ALOAD_0,                             // 0
+    OPC_INVOKESTATIC, 0, CP_ID_METHOD,       // 1
+    OPC_ILOAD_1,                             // 4
+    OPC_IFEQ, 0, 8,                          // 5 -> 13
+    OPC_ALOAD_0,                             // 8
+    OPC_ASTORE_2,                            // 9
+    OPC_GOTO, 0, 6,                          // 10 -> 16
+    OPC_ICONST_0,                            // 13
+    OPC_ISTORE_2,                            // 14
+    OPC_NOP,                                 // 15
+    OPC_ARETURN,                             // 16
+};
+
+// static Object guard(Object a):
+// in a try block, stores null, a and then 0 into local 1, and returns null,
+// the handler returns the exception.
+static const std::vector<u1> GUARD_CODE = {
+    OPC_ACONST_NULL,                         // 0
+    OPC_ASTORE_1,                            // 1
+    OPC_ALOAD_0,                             // 2
+    OPC_ASTORE_1,                            // 3
+    OPC_ICONST_0,                            // 4
+    OPC_ISTORE_1,                            // 5
+    OPC_ACONST_NULL,                         // 6
+    OPC_ARETURN,                             // 7
+    OPC_ASTORE_2,                            // 8
+    OPC_ALOAD_2,                             // 9
+    OPC_ARETURN,                             // 10
+};
+
+static void writeCode(ClassWriter &w, const std::vector<u1> &code, int maxStack, int maxLocals,
+                      const std::vector<u1> &exceptionTable, const std::vector<u1> &stackMapTable) {
+    ClassWriter attr;
+    attr.writeU2(maxStack);
+    attr.writeU2(maxLocals);
+    attr.writeU4((int) code.size());
+    attr.writeBytes(code);
+    attr.writeU2((int) exceptionTable.size() / 8);
+    attr.writeBytes(exceptionTable);
+    if (stackMapTable.empty()) {
+        attr.writeU2(0);
+    } else {
+        attr.writeU2(1);
+        attr.writeU2(CP_STACK_MAP_TABLE);
+        attr.writeU4((int) stackMapTable.size());
+        attr.writeBytes(stackMapTable);
+    }
+
+    w.writeU2(CP_CODE);
+    w.writeU4((int) attr.get().size());
+    w.writeBytes(attr.get());
+}
+
+static ClassFile *makeClassFile(ClassWriter &w, int majorVersion, bool withStackMapTable) {
+    w.writeU4((int) 0xCAFEBABE);
+    w.writeU2(0);
+    w.writeU2(majorVersion);
+
+    w.writeU2(CP_COUNT);
+    w.writeUtf8("T");
+    w.writeU1(CONSTANT_Class);
+    w.writeU2(CP_THIS_NAME);
+    w.writeUtf8("java/lang/Object");
+    w.writeU1(CONSTANT_Class);
+    w.writeU2(CP_OBJECT_NAME);
+    w.writeUtf8("pick");
+    w.writeUtf8("(Ljava/lang/Object;I)Ljava/lang/Object;");
+    w.writeUtf8("id");
+    w.writeUtf8("(Ljava/lang/Object;)Ljava/lang/Object;");
+    w.writeU1(CONSTANT_NameAndType);
+    w.writeU2(CP_ID_NAME);
+    w.writeU2(CP_ID_DESC);
+    w.writeU1(CONSTANT_Methodref);
+    w.writeU2(CP_THIS_CLASS);
+    w.writeU2(CP_ID_NAME_AND_TYPE);
+    w.writeUtf8("Code");
+    w.writeUtf8("StackMapTable");
+    w.writeUtf8("guard");
+
+    w.writeU2(ACC_PUBLIC);
+    w.writeU2(CP_THIS_CLASS);
+    w.writeU2(CP_OBJECT_CLASS);
+    w.writeU2(0); // interfaces
+    w.writeU2(0); // fields
+
+    w.writeU2(2); // methods
+    w.writeU2(ACC_PUBLIC | ACC_STATIC);
+    w.writeU2(CP_PICK_NAME);
+    w.writeU2(CP_PICK_DESC);
+    w.writeU2(1);
+    writeCode(w, PICK_CODE, 2, 3, {}, !withStackMapTable ? std::vector<u1>() : std::vector<u1>{
+        0, 2,
+        // same_locals_1_stack_item_frame at 13, stack: [Object]
+        64 + 13, ITEM_Object, 0, CP_OBJECT_CLASS,
+        // same_locals_1_stack_item_frame at 16, stack: [Object]
+        64 + 2, ITEM_Object, 0, CP_OBJECT_CLASS,
+    });
+
+    w.writeU2(ACC_PUBLIC | ACC_STATIC);
+    w.writeU2(CP_GUARD_NAME);
+    w.writeU2(CP_ID_DESC);
+    w.writeU2(1);
+    writeCode(w, GUARD_CODE, 1, 3, {0, 2, 0, 6, 0, 8, 0, 0}, !withStackMapTable ? std::vector<u1>() : std::vector<u1>{
+        0, 1,
+        // full_frame at 8, locals: [Object, Top], stack: [Object]
+        255, 0, 8, 0, 2, ITEM_Object, 0, CP_OBJECT_CLASS, ITEM_Top, 0, 1, ITEM_Object, 0, CP_OBJECT_CLASS,
+    });
+
+    w.writeU2(0); // attributes
+
+    ClassFileParser parser(L"T.class", w.get().data(), w.get().size());
+    return parser.getParsedClassFile();
+}
+
+static Method *makeMethod(InstanceKlass *klass, ClassFile *classFile, int index) {
+    auto method = new Method(klass, &classFile->methods[index]);
+    method->linkMethod(classFile->constant_pool);
+    return method;
+}
+
+struct Expected {
+    u4 pc;
+    std::vector<bool> locals;
+    std::vector<bool> stack;
+};
+
+static bool checkEntries(Method *method, const std::vector<Expected> &expected) {
+    auto oopMap = method->getOopMap();
+    for (const auto &e : expected) {
+        auto entry = oopMap->lookup(e.pc);
+        std::string where = "pc " + std::to_string(e.pc);
+
+        for (size_t i = 0; i < e.locals.size(); ++i) {
+            if (entry->isLocalOop((int) i) != e.locals[i]) {
+                printError(where + ": wrong type of local " + std::to_string(i));
+                return false;
+            }
+        }
+
+        if (entry->getStackDepth() != (int) e.stack.size()) {
+            printError(where + ": wrong stack depth " + std::to_string(entry->getStackDepth()));
+            return false;
+        }
+        for (size_t i = 0; i < e.stack.size(); ++i) {
+            if (entry->isStackOop((int) i) != e.stack[i]) {
+                printError(where + ": wrong type of stack slot " + std::to_string(i));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The pc of a frame points past the opcode of the instruction being executed
+static const std::vector<Expected> PICK_EXPECTED = {
+    {0,  {true, false, false}, {}},              // method entry
+    {4,  {true, false, false}, {true}},          // calling id(a)
+    {10, {true, false, false}, {true, true}},    // astore_2
+    {11, {true, false, true},  {true}},          // goto
+    {15, {true, false, false}, {true, false}},   // istore_2
+    {17, {true, false, false}, {true}},          // areturn, c was merged with an int
+};
+
+static const std::vector<Expected> GUARD_EXPECTED = {
+    {4,  {true, true, false},  {true}},          // astore_1
+    {6,  {true, true, false},  {false}},         // istore_1
+    {9,  {true, false, false}, {true}},          // handler
+    {10, {true, false, true},  {}},              // aload_2
+};
+
+bool testClass(const std::string &name, int majorVersion, bool withStackMapTable) {
+    std::cout << "\n=== Testing " << name << " ===" << std::endl;
+
+    ClassWriter w;
+    auto classFile = makeClassFile(w, majorVersion, withStackMapTable);
+    if (classFile == nullptr) {
+        printError("Cannot parse class file");
+        return false;
+    }
+
+    auto klass = new InstanceKlass(classFile, nullptr, nullptr, ClassType::INSTANCE_CLASS);
+    klass->getRuntimeConstantPool()->attachConstantPool(classFile->constant_pool,
+        classFile->constant_pool_count);
+
+    auto pick = makeMethod(klass, classFile, 0);
+    if (!checkEntries(pick, PICK_EXPECTED)) {
+        return false;
+    }
+    printSuccess("Branches merged, call results kept on the stack");
+
+    auto guard = makeMethod(klass, classFile, 1);
+    if (!checkEntries(guard, GUARD_EXPECTED)) {
+        return false;
+    }
+    printSuccess("Exception handler sees locals of the whole try block");
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM OopMap Test ===" << std::endl;
+
+    if (!testClass("StackMapTable", 52, true)) {
+        return 1;
+    }
+
+    if (!testClass("Data flow analysis", 49, false)) {
+        return 1;
+    }
+
+    printSuccess("All OopMap tests completed!");
+    return 0;
+}
@@ -0,0 +1,407 @@
+//
+// Test for KiVM soft, weak and phantom reference processing
+//
+
+#include <kivm/classfile/classFile.h>
+#include <kivm/classpath/classLoader.h>
+#include <kivm/classpath/classPathManager.h>
+#include <kivm/memory/universe.h>
+#include <kivm/memory/copyingHeap.h>
+#include <kivm/memory/referenceProcessor.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/oop/instanceKlass.h>
+#include <kivm/oop/instanceOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+// Holds GC roots in thread arguments, without running a thread
+class RootHolderThread : public JavaThread {
+public:
+    RootHolderThread()
+        : JavaThread(nullptr, {nullptr, nullptr, nullptr, nullptr}) {
+    }
+
+    oop &getRoot(int index) {
+        auto iter = _args.begin();
+        std::advance(iter, index);
+        return *iter;
+    }
+};
+
+struct TestField {
+    std::string name;
+    std::string descriptor;
+    bool isStatic;
+};
+
+// Class files are assembled by hand, there is no javac here.
+// They only hold fields, which is all collectors look at.
+static std::vector<u1> makeClassBytes(const std::string &name, const std::string &superName,
+                                      const std::vector<TestField> &fields) {
+    std::vector<u1> bytes;
+    auto writeU1 = [&](int v) { bytes.push_back((u1) v); };
+    auto writeU2 = [&](int v) { writeU1(v >> 8); writeU1(v); };
+    auto writeU4 = [&](int v) { writeU2(v >> 16); writeU2(v); };
+    auto writeUtf8 = [&](const std::string &s) {
+        writeU1(CONSTANT_Utf8);
+        writeU2((int) s.size());
+        for (char c : s) {
+            writeU1(c);
+        }
+    };
+
+    writeU4((int) 0xCAFEBABE);
+    writeU2(0);
+    writeU2(49);
+
+    // this class, super class, then a name and a descriptor for every field
+    int superIndex = superName.empty() ? 0 : 4;
+    int fieldStart = superName.empty() ? 3 : 5;
+    writeU2(fieldStart + (int) fields.size() * 2);
+    writeUtf8(name);
+    writeU1(CONSTANT_Class);
+    writeU2(1);
+    if (!superName.empty()) {
+        writeUtf8(superName);
+        writeU1(CONSTANT_Class);
+        writeU2(3);
+    }
+    for (const auto &field : fields) {
+        writeUtf8(field.name);
+        writeUtf8(field.descriptor);
+    }
+
+    writeU2(ACC_PUBLIC);
+    writeU2(2);
+    writeU2(superIndex);
+    writeU2(0); // interfaces
+
+    writeU2((int) fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+        writeU2(fields[i].isStatic ? ACC_STATIC : 0);
+        writeU2(fieldStart + (int) i * 2);
+        writeU2(fieldStart + (int) i * 2 + 1);
+        writeU2(0);
+    }
+
+    writeU2(0); // methods
+    writeU2(0); // attributes
+    return bytes;
+}
+
+static std::string classPathDir;
+
+static InstanceKlass *loadClass(const std::string &name, const std::string &superName,
+                                const std::vector<TestField> &fields) {
+    // classes are loaded by name, so that their super classes resolve
+    std::string path = classPathDir;
+    size_t begin = 0;
+    size_t slash;
+    while ((slash = name.find('/', begin)) != std::string::npos) {
+        path += "/" + name.substr(begin, slash - begin);
+        mkdir(path.c_str(), 0755);
+        begin = slash + 1;
+    }
+
+    const auto &bytes = makeClassBytes(name, superName, fields);
+    std::ofstream out(classPathDir + "/" + name + ".class", std::ios::binary);
+    out.write((const char *) bytes.data(), bytes.size());
+    out.close();
+    return (InstanceKlass *) BootstrapClassLoader::get()->loadClass(strings::fromStdString(name));
+}
+
+static InstanceKlass *softReferenceClass;
+static InstanceKlass *weakReferenceClass;
+static InstanceKlass *phantomReferenceClass;
+static TypeArrayKlass *valueClass;
+
+static bool loadReferenceClasses() {
+    char dirTemplate[] = "/tmp/kivm-reference-XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr) {
+        printError("Cannot create class path");
+        return false;
+    }
+    classPathDir = dirTemplate;
+    ClassPathManager::get()->addClassPath(strings::fromStdString(classPathDir));
+
+    loadClass("java/lang/Object", "", {});
+    loadClass("java/lang/ref/Reference", "java/lang/Object", {
+        {"referent", "Ljava/lang/Object;", false},
+        {"queue", "Ljava/lang/ref/ReferenceQueue;", false},
+        {"next", "Ljava/lang/ref/Reference;", false},
+        {"discovered", "Ljava/lang/ref/Reference;", false},
+    });
+    softReferenceClass = loadClass("java/lang/ref/SoftReference", "java/lang/ref/Reference", {
+        {"clock", "J", true},
+        {"timestamp", "J", false},
+    });
+    weakReferenceClass = loadClass("java/lang/ref/WeakReference", "java/lang/ref/Reference", {});
+    phantomReferenceClass = loadClass("java/lang/ref/PhantomReference", "java/lang/ref/Reference", {});
+    auto cacheEntryClass = loadClass("CacheEntry", "java/lang/ref/WeakReference", {
+        {"key", "Ljava/lang/Object;", false},
+    });
+
+    if (softReferenceClass == nullptr || weakReferenceClass == nullptr
+        || phantomReferenceClass == nullptr || cacheEntryClass == nullptr) {
+        printError("Cannot load reference classes");
+        return false;
+    }
+
+    if (softReferenceClass->getReferenceType() != REF_SOFT
+        || weakReferenceClass->getReferenceType() != REF_WEAK
+        || phantomReferenceClass->getReferenceType() != REF_PHANTOM
+        || cacheEntryClass->getReferenceType() != REF_WEAK) {
+        printError("Wrong reference types");
+        return false;
+    }
+
+    valueClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    printSuccess("Reference classes linked");
+    return true;
+}
+
+static instanceOop newReference(InstanceKlass *referenceClass, oop referent) {
+    auto reference = referenceClass->newInstance();
+    *ReferenceProcessor::getReferentAddress(reference) = referent;
+    return reference;
+}
+
+static arrayOop newValue(jint id) {
+    auto value = valueClass->newInstance(4);
+    for (int i = 0; i < 4; ++i) {
+        *value->getElementAddress<jint>(i) = id + i;
+    }
+    return value;
+}
+
+static bool checkValue(oop object, jint id) {
+    if (object == nullptr || !Universe::isHeapObject(object)) {
+        return false;
+    }
+    auto value = (arrayOop) object;
+    for (int i = 0; i < 4; ++i) {
+        if (*value->getElementAddress<jint>(i) != id + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static oop getReferent(oop reference) {
+    return *ReferenceProcessor::getReferentAddress((instanceOop) reference);
+}
+
+/**
+ * @return number of references in the pending list, which is emptied
+ */
+static int drainPendingList() {
+    int count = 0;
+    auto reference = ReferenceProcessor::takePendingList();
+    while (reference != nullptr) {
+        ++count;
+        oop *discovered = ReferenceProcessor::getDiscoveredAddress(reference);
+        reference = (instanceOop) *discovered;
+        *discovered = nullptr;
+    }
+    return count;
+}
+
+bool testWeakReferences(CopyingHeap *heap) {
+    std::cout << "\n=== Testing weak and phantom references ===" << std::endl;
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    // only reachable through references
+    holder->getRoot(0) = newReference(weakReferenceClass, newValue(100));
+    holder->getRoot(1) = newReference(phantomReferenceClass, newValue(200));
+
+    // also reachable from a root
+    holder->getRoot(2) = newValue(300);
+    holder->getRoot(3) = newReference(weakReferenceClass, holder->getRoot(2));
+
+    heap->doMinorCollection();
+
+    if (getReferent(holder->getRoot(0)) != nullptr) {
+        printError("Weak referent should be cleared");
+        return false;
+    }
+    if (getReferent(holder->getRoot(1)) != nullptr) {
+        printError("Phantom referent should be cleared");
+        return false;
+    }
+    oop kept = getReferent(holder->getRoot(3));
+    if (kept != holder->getRoot(2) || !checkValue(kept, 300)) {
+        printError("Strongly reachable referent should be kept and moved");
+        return false;
+    }
+    printSuccess("Minor collection cleared unreachable referents");
+
+    int pending = drainPendingList();
+    if (pending != 2) {
+        printError("Expected 2 pending references, got " + std::to_string(pending));
+        return false;
+    }
+    printSuccess("Cleared references are pending");
+
+    // a cleared reference is not discovered again
+    heap->doFullCollection();
+    if (drainPendingList() != 0) {
+        printError("Cleared references should not be pending again");
+        return false;
+    }
+
+    // promote both, then drop the strong path
+    heap->doMinorCollection();
+    heap->doMinorCollection();
+    holder->getRoot(2) = nullptr;
+    heap->doFullCollection();
+    if (getReferent(holder->getRoot(3)) != nullptr || drainPendingList() != 1) {
+        printError("Full collection should clear the old referent");
+        return false;
+    }
+    printSuccess("Full collection cleared an old referent");
+
+    for (int i = 0; i < 4; ++i) {
+        holder->getRoot(i) = nullptr;
+    }
+    return true;
+}
+
+bool testSoftReferences(CopyingHeap *heap) {
+    std::cout << "\n=== Testing soft references ===" << std::endl;
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    auto clockField = softReferenceClass->getStaticFieldInfo(softReferenceClass->getName(), L"clock", L"J");
+    jlong clock = *softReferenceClass->getStaticFieldAddress<jlong>(clockField->_offset);
+    auto timestampField = softReferenceClass->getInstanceFieldInfo(softReferenceClass->getName(), L"timestamp", L"J");
+
+    // read just now, and idle far longer than any free heap allows
+    auto recent = newReference(softReferenceClass, newValue(400));
+    *recent->getFieldAddress<jlong>(timestampField->_offset) = clock;
+    holder->getRoot(0) = recent;
+    auto idle = newReference(softReferenceClass, newValue(500));
+    *idle->getFieldAddress<jlong>(timestampField->_offset) = clock - 1000L * 1000L * 1000L;
+    holder->getRoot(1) = idle;
+
+    heap->doMinorCollection();
+
+    if (!checkValue(getReferent(holder->getRoot(0)), 400)) {
+        printError("Recently read soft referent should be kept");
+        return false;
+    }
+    if (getReferent(holder->getRoot(1)) != nullptr || drainPendingList() != 1) {
+        printError("Idle soft referent should be cleared");
+        return false;
+    }
+    printSuccess("Soft references cleared by idle time");
+
+    jlong newClock = *softReferenceClass->getStaticFieldAddress<jlong>(clockField->_offset);
+    if (newClock < clock) {
+        printError("SoftReference.clock should advance");
+        return false;
+    }
+    printSuccess("SoftReference.clock advanced");
+
+    holder->getRoot(0) = nullptr;
+    holder->getRoot(1) = nullptr;
+    return true;
+}
+
+bool testReferenceInOldGeneration(CopyingHeap *heap) {
+    std::cout << "\n=== Testing old references to young referents ===" << std::endl;
+
+    auto holder = new RootHolderThread;
+    Threads::addJavaThread(holder);
+
+    // promote the reference
+    holder->getRoot(0) = newReference(weakReferenceClass, nullptr);
+    heap->doMinorCollection();
+    heap->doMinorCollection();
+
+    // a young referent, stored like the interpreter would
+    auto reference = (instanceOop) holder->getRoot(0);
+    holder->getRoot(1) = newValue(600);
+    oop *referent = ReferenceProcessor::getReferentAddress(reference);
+    *referent = holder->getRoot(1);
+    Universe::writeBarrier(referent);
+
+    // kept while strongly reachable, the card stays dirty for later ones
+    heap->doMinorCollection();
+    if (!checkValue(getReferent(holder->getRoot(0)), 600)
+        || getReferent(holder->getRoot(0)) != holder->getRoot(1)) {
+        printError("Young referent of an old reference should be kept");
+        return false;
+    }
+    heap->doMinorCollection();
+    if (getReferent(holder->getRoot(0)) != holder->getRoot(1)) {
+        printError("Young referent should be promoted with its reference");
+        return false;
+    }
+
+    // now the referent is old too, only a full collection sees it die
+    holder->getRoot(1) = nullptr;
+    heap->doMinorCollection();
+    if (getReferent(holder->getRoot(0)) == nullptr) {
+        printError("Minor collections should not clear old referents");
+        return false;
+    }
+    heap->doFullCollection();
+    if (getReferent(holder->getRoot(0)) != nullptr || drainPendingList() != 1) {
+        printError("Old referent should be cleared by a full collection");
+        return false;
+    }
+    printSuccess("Old references to young referents");
+
+    holder->getRoot(0) = nullptr;
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Reference Processing Test ===" << std::endl;
+
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(256L);
+    RuntimeConfig::get().gcWorkerThreads = 4;
+    Universe::initialize();
+    auto heap = (CopyingHeap *) Universe::getCollectedHeap();
+    printSuccess("Universe initialized with copying heap");
+
+    if (!loadReferenceClasses()) {
+        return 1;
+    }
+
+    if (!testWeakReferences(heap)) {
+        return 1;
+    }
+
+    if (!testSoftReferences(heap)) {
+        return 1;
+    }
+
+    if (!testReferenceInOldGeneration(heap)) {
+        return 1;
+    }
+
+    printSuccess("All reference processing tests completed!");
+    return 0;
+}
@@ -0,0 +1,242 @@
+//
+// Test for KiVM safepoints
+//
+
+#include <kivm/memory/universe.h>
+#include <kivm/memory/gcThread.h>
+#include <kivm/oop/arrayKlass.h>
+#include <kivm/oop/arrayOop.h>
+#include <kivm/runtime/javaThread.h>
+#include <kivm/runtime/runtimeConfig.h>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace kivm;
+
+void printSuccess(const std::string& message) {
+    std::cout << "✓ " << message << std::endl;
+}
+
+void printError(const std::string& message) {
+    std::cerr << "✗ " << message << std::endl;
+}
+
+void printInfo(const std::string& message) {
+    std::cout << "  " << message << std::endl;
+}
+
+// Runs on a plain native thread, polling like the interpreter does
+class MutatorThread : public JavaThread {
+public:
+    MutatorThread()
+        : JavaThread(nullptr, {nullptr}) {
+    }
+
+    oop &getRoot() {
+        return _args.front();
+    }
+};
+
+static std::atomic<bool> sBroken(false);
+
+// Allocates until collections are triggered, and checks that
+// its only live object is still intact after each of them.
+static void allocate(MutatorThread *thread, TypeArrayKlass *arrayClass, int iterations) {
+    Threads::setCurrentThread(thread);
+    for (int i = 0; i < iterations && !sBroken; ++i) {
+        // garbage
+        arrayClass->newInstance(256);
+
+        auto array = arrayClass->newInstance(16);
+        *array->getElementAddress<jint>(15) = i;
+        thread->getRoot() = array;
+
+        thread->enterSafepointIfNeeded();
+
+        auto root = (arrayOop) thread->getRoot();
+        if (!Universe::isHeapObject(root) || *root->getElementAddress<jint>(15) != i) {
+            sBroken = true;
+        }
+    }
+    thread->onDestroy();
+}
+
+// Never allocates, only polls like a loop without calls would do
+static void spin(MutatorThread *thread, std::atomic<bool> *stop, long *polls) {
+    Threads::setCurrentThread(thread);
+    while (!*stop) {
+        thread->enterSafepointIfNeeded();
+        ++*polls;
+    }
+    thread->onDestroy();
+}
+
+bool testHandshake() {
+    std::cout << "\n=== Testing Safepoint Handshake ===" << std::endl;
+
+    const int ALLOCATING_THREADS = 4;
+    const int ITERATIONS = 200000;
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto gc = GCThread::get();
+
+    std::vector<MutatorThread *> allocators;
+    for (int i = 0; i < ALLOCATING_THREADS; ++i) {
+        allocators.push_back(new MutatorThread);
+        Threads::addJavaThread(allocators.back());
+    }
+    auto spinner = new MutatorThread;
+    Threads::addJavaThread(spinner);
+
+    std::atomic<bool> stop(false);
+    long polls = 0;
+    std::thread spinnerThread(spin, spinner, &stop, &polls);
+
+    std::vector<std::thread> allocatorThreads;
+    for (auto thread : allocators) {
+        allocatorThreads.emplace_back(allocate, thread, arrayClass, ITERATIONS);
+    }
+    for (auto &thread : allocatorThreads) {
+        thread.join();
+    }
+
+    stop = true;
+    spinnerThread.join();
+
+    // returns only after every thread exited
+    Threads::waitForJavaThreadsDeadLocked();
+
+    if (sBroken) {
+        printError("A root was lost or corrupted across a safepoint");
+        return false;
+    }
+    printSuccess("Roots of " + std::to_string(ALLOCATING_THREADS) + " allocating threads survived collections");
+
+    const auto &stats = gc->getSafepointStatistics();
+    if (stats._safepoints == 0) {
+        printError("No safepoint was reached");
+        return false;
+    }
+    printInfo("  Safepoints: " + std::to_string(stats._safepoints)
+              + ", average time to safepoint: "
+              + std::to_string(stats._totalTimeToSafepoint.count() / stats._safepoints) + " us"
+              + ", max: " + std::to_string(stats._maxTimeToSafepoint.count()) + " us");
+    printSuccess("Spinning thread polled " + std::to_string(polls) + " times and did not block GC");
+
+    if (GCThread::isSafepointPollArmed()) {
+        printError("Poll is still armed without a pending collection");
+        return false;
+    }
+    printSuccess("Poll disarmed after collections");
+    return true;
+}
+
+// Sleeps without polling, like Thread.sleep()
+static void sleepFor(MutatorThread *thread, jlong millis, std::atomic<bool> *awake) {
+    Threads::setCurrentThread(thread);
+    thread->sleep(millis);
+    *awake = true;
+    thread->onDestroy();
+}
+
+// Waits on its root without a timeout, like Object.wait()
+static void waitForNotify(MutatorThread *thread, std::atomic<bool> *waiting) {
+    Threads::setCurrentThread(thread);
+    thread->monitorEnter(thread->getRoot());
+    *waiting = true;
+    thread->monitorWait(thread->getRoot(), 0);
+    thread->monitorExit(thread->getRoot());
+    thread->onDestroy();
+}
+
+bool testBlockedThreads() {
+    std::cout << "\n=== Testing Collections while Threads Block ===" << std::endl;
+
+    const int ITERATIONS = 200000;
+    const jlong SLEEP_MILLIS = 30000;
+
+    auto arrayClass = new TypeArrayKlass(nullptr, nullptr, 1, ValueType::INT);
+    auto gc = GCThread::get();
+    size_t safepointsBefore = gc->getSafepointStatistics()._safepoints;
+
+    auto sleeper = new MutatorThread;
+    auto waiter = new MutatorThread;
+    auto notifier = new MutatorThread;
+    Threads::addJavaThread(sleeper);
+    Threads::addJavaThread(waiter);
+    Threads::addJavaThread(notifier);
+
+    // the waiter is notified only after the notifier collected
+    waiter->getRoot() = arrayClass->newInstance(1);
+    // outlives this test, the sleeper is not joined
+    static std::atomic<bool> awake(false);
+    std::atomic<bool> waiting(false);
+    std::thread sleeperThread(sleepFor, sleeper, SLEEP_MILLIS, &awake);
+    std::thread waiterThread(waitForNotify, waiter, &waiting);
+    while (!waiting) {
+        std::this_thread::yield();
+    }
+
+    std::thread notifierThread([&] {
+        Threads::setCurrentThread(notifier);
+        for (int i = 0; i < ITERATIONS; ++i) {
+            arrayClass->newInstance(256);
+            notifier->enterSafepointIfNeeded();
+        }
+        // blocks until the waiter released the monitor in wait()
+        oop object = waiter->getRoot();
+        notifier->monitorEnter(object);
+        object->getMarkOop()->notifyAll();
+        notifier->monitorExit(object);
+        notifier->onDestroy();
+    });
+    notifierThread.join();
+    waiterThread.join();
+
+    size_t safepoints = gc->getSafepointStatistics()._safepoints - safepointsBefore;
+    if (safepoints == 0) {
+        printError("No safepoint was reached");
+        return false;
+    }
+    if (awake) {
+        printError("Collections waited for the sleeping thread");
+        return false;
+    }
+    if (!Universe::isHeapObject(waiter->getRoot())) {
+        printError("Object waited on was lost");
+        return false;
+    }
+    printSuccess("Safepoints: " + std::to_string(safepoints) + ", reached while threads were sleeping and waiting");
+
+    // the sleeper counts as stopped until it wakes up
+    sleeperThread.detach();
+    return true;
+}
+
+int main() {
+    std::cout << "=== KiVM Safepoint Test ===" << std::endl;
+
+    RuntimeConfig::get().heapType = HEAP_MARK_COMPACT;
+    RuntimeConfig::get().initialHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().maxHeapSizeInBytes = SIZE_MB(64L);
+    RuntimeConfig::get().gcWorkerThreads = 2;
+    Universe::initialize();
+
+    GCThread::initialize();
+    GCThread::get()->start();
+    printSuccess("Universe and GC thread initialized");
+
+    if (!testHandshake()) {
+        return 1;
+    }
+
+    if (!testBlockedThreads()) {
+        return 1;
+    }
+
+    GCThread::get()->stop();
+    printSuccess("All Safepoint tests completed!");
+    return 0;
+}